@@ -148,6 +148,18 @@ typedef struct svn_cache__info_t
    */
   apr_uint64_t failures;
 
+  /** Number of cache accesses that had to wait for or to be retried
+   * because of concurrent modifications.
+   * May be 0 if that information is not available.
+   */
+  apr_uint64_t contentions;
+
+  /** Number of setter calls whose data the cache's admission policy
+   * refused to store.
+   * May be 0 if the cache does not have such a policy.
+   */
+  apr_uint64_t rejections;
+
   /** Size of the data currently stored in the cache.
    * May be 0 if that information is not available.
    */
@@ -310,6 +322,26 @@ svn_cache__membuffer_cache_create(svn_membuffer_t **cache,
                                   svn_boolean_t allow_blocking_writes,
                                   apr_pool_t *result_pool);
 
+/**
+ * Same as svn_cache__membuffer_cache_create() but allocate the cache
+ * in memory that will be shared with all processes being forked from
+ * the current process after this call.  All of them will then see and
+ * add to the same cache contents.  Access to the cache will always be
+ * serialized across threads and processes.
+ *
+ * Return #SVN_ERR_UNSUPPORTED_FEATURE, if the platform does not support
+ * shared memory or forking processes.
+ *
+ * @since New in 1.15.
+ */
+svn_error_t *
+svn_cache__membuffer_cache_create_shared(svn_membuffer_t **cache,
+                                         apr_size_t total_size,
+                                         apr_size_t directory_size,
+                                         apr_size_t segment_count,
+                                         svn_boolean_t allow_blocking_writes,
+                                         apr_pool_t *result_pool);
+
 /**
  * @defgroup Standard priority classes for #svn_cache__create_membuffer_cache.
  * @{
@@ -378,6 +410,67 @@ svn_cache__create_membuffer_cache(svn_cache__t **cache_p,
                                   apr_pool_t *result_pool,
                                   apr_pool_t *scratch_pool);
 
+/**
+ * An opaque structure representing a store of LZ4-compressed cache
+ * entries that may be shared by several cache objects.
+ */
+typedef struct svn_cache__compressed_store_t svn_cache__compressed_store_t;
+
+/**
+ * Creates a new compressed store object in @a *store.  It will hold up
+ * to @a total_size bytes of compressed data, including per-entry
+ * overhead.  Entries are evicted in LRU order.
+ *
+ * Once the store is full, new entries will only be admitted if their
+ * key has been looked up more often recently than the keys of the
+ * entries they would displace (TinyLFU).  The access frequencies are
+ * tracked by a compact, approximate counter structure.  Rejected entries
+ * are reported as #svn_cache__info_t.rejections.
+ *
+ * If access to the store is guaranteed to be serialized, @a thread_safe
+ * may be set to @c FALSE.  All allocations for management structures
+ * will be made in @a result_pool.  The entries themselves are kept
+ * outside any pool and get released together with @a result_pool.
+ *
+ * @since New in 1.15.
+ */
+svn_error_t *
+svn_cache__compressed_store_create(svn_cache__compressed_store_t **store,
+                                   apr_size_t total_size,
+                                   svn_boolean_t thread_safe,
+                                   apr_pool_t *result_pool);
+
+/**
+ * Creates a new cache in @a *cache_p, storing LZ4-compressed copies of
+ * the serialized data in the potentially shared @a store object.  The
+ * elements in the cache will be indexed by keys of length @a klen, which
+ * may be APR_HASH_KEY_STRING if they are strings.  Values will be
+ * serialized using @a serialize and deserialized using @a deserialize.
+ * Because the same store may hold many different kinds of values,
+ * @a prefix should be specified to differentiate this cache from other
+ * caches.  @a *cache_p will be allocated in @a result_pool.
+ *
+ * If @a deserialize is NULL, then the data is returned as an
+ * svn_stringbuf_t; if @a serialize is NULL, then the data is
+ * assumed to be an svn_stringbuf_t.
+ *
+ * Compressing and decompressing the data is relatively expensive.  These
+ * caches are therefore best suited for large objects that are even more
+ * expensive to re-create.
+ *
+ * These caches do not support svn_cache__iter.
+ *
+ * @since New in 1.15.
+ */
+svn_error_t *
+svn_cache__create_compressed(svn_cache__t **cache_p,
+                             svn_cache__compressed_store_t *store,
+                             svn_cache__serialize_func_t serialize,
+                             svn_cache__deserialize_func_t deserialize,
+                             apr_ssize_t klen,
+                             const char *prefix,
+                             apr_pool_t *result_pool);
+
 /**
  * Creates a null-cache instance in @a *cache_p, allocated from
  * @a result_pool.  The given @c id is the only data stored in it and can
@@ -561,6 +654,18 @@ svn_cache__get_global_membuffer_cache(void);
 svn_cache__info_t *
 svn_cache__membuffer_get_global_info(apr_pool_t *pool);
 
+/**
+ * Set @a *gets and @a *hits to the total number of lookups and of hits
+ * in the global membuffer cache so far.  Unlike
+ * svn_cache__membuffer_get_global_info(), this neither locks nor scans
+ * the segments and is cheap enough to be called around every request.
+ * The counters are not synchronized and may be slightly off.  Both will
+ * be 0 if there is no global membuffer cache.
+ */
+void
+svn_cache__membuffer_get_global_counters(apr_uint64_t *gets,
+                                         apr_uint64_t *hits);
+
 /**
  * Remove all current contents from CACHE.
  *
@@ -570,6 +675,79 @@ svn_cache__membuffer_get_global_info(apr_pool_t *pool);
 svn_error_t *
 svn_cache__membuffer_clear(svn_membuffer_t *cache);
 
+/**
+ * A callback type used by svn_cache__membuffer_save() to decide whether
+ * the entries stored under the key @a prefix shall be written to the
+ * snapshot.  Set @a *tag to NULL to skip them.  Otherwise, set it to some
+ * string that will be passed to the #svn_cache__snapshot_accept_func_t
+ * when the snapshot gets loaded again.  @a baton is the caller-provided
+ * context.  Allocate @a *tag in @a result_pool.
+ *
+ * @since New in 1.15.
+ */
+typedef svn_error_t *
+(*svn_cache__snapshot_tag_func_t)(const char **tag,
+                                  void *baton,
+                                  const char *prefix,
+                                  apr_pool_t *result_pool);
+
+/**
+ * A callback type used by svn_cache__membuffer_load() to decide whether
+ * the entries that had been stored under key @a prefix and @a tag shall
+ * be put into the cache again.  Set @a *accept accordingly.  @a baton is
+ * the caller-provided context.  Use @a scratch_pool for temporaries.
+ *
+ * @since New in 1.15.
+ */
+typedef svn_error_t *
+(*svn_cache__snapshot_accept_func_t)(svn_boolean_t *accept,
+                                     void *baton,
+                                     const char *prefix,
+                                     const char *tag,
+                                     apr_pool_t *scratch_pool);
+
+/**
+ * Write the current contents of @a cache to @a stream, including the
+ * keys and priorities.  For every key prefix found, call @a tag_func
+ * with @a tag_baton to decide whether and how to store the respective
+ * entries.  The data is written in serialized form, i.e. no serializer
+ * functions get called.
+ *
+ * The snapshot format is specific to the current platform and build.
+ * Concurrent readers and writers may access the cache while the snapshot
+ * is being written but they may find some segments temporarily locked.
+ *
+ * Use @a scratch_pool for temporary allocations.
+ *
+ * @since New in 1.15.
+ */
+svn_error_t *
+svn_cache__membuffer_save(svn_membuffer_t *cache,
+                          svn_stream_t *stream,
+                          svn_cache__snapshot_tag_func_t tag_func,
+                          void *tag_baton,
+                          apr_pool_t *scratch_pool);
+
+/**
+ * Read a snapshot written by svn_cache__membuffer_save() from @a stream
+ * and add its entries to @a cache.  For every key prefix found in the
+ * snapshot, call @a accept_func with @a accept_baton to decide whether
+ * the respective entries shall be added.  Entries may get evicted again
+ * while loading if @a cache is smaller than the one the snapshot has
+ * been taken from.
+ *
+ * Return #SVN_ERR_STREAM_MALFORMED_DATA if @a stream does not contain
+ * a compatible snapshot.  Use @a scratch_pool for temporary allocations.
+ *
+ * @since New in 1.15.
+ */
+svn_error_t *
+svn_cache__membuffer_load(svn_membuffer_t *cache,
+                          svn_stream_t *stream,
+                          svn_cache__snapshot_accept_func_t accept_func,
+                          void *accept_baton,
+                          apr_pool_t *scratch_pool);
+
 /** @} */
 
 
@@ -102,12 +102,42 @@ svn_delta__delta_from_editor(const svn_delta_editor_t **deditor,
                              apr_pool_t *pool);
 
 /** Read the txdelta window header from @a stream and return the total
-    length of the unparsed window data in @a *window_len. */
+    length of the unparsed window data in @a *window_len.  The window is
+    expected to be in svndiff format version @a svndiff_version. */
 svn_error_t *
 svn_txdelta__read_raw_window_len(apr_size_t *window_len,
                                  svn_stream_t *stream,
+                                 int svndiff_version,
                                  apr_pool_t *pool);
 
+/** Like svn_txdelta_parse_svndiff() but if @a allow_large_windows is
+    TRUE, also accept svndiff version 3 data and its larger window limits.
+    The public parser rejects version 3 because no peer negotiates it. */
+svn_stream_t *
+svn_txdelta__parse_svndiff(svn_txdelta_window_handler_t handler,
+                           void *handler_baton,
+                           svn_boolean_t error_on_early_close,
+                           svn_boolean_t allow_large_windows,
+                           apr_pool_t *pool);
+
+/** The maximum size of the source and target views of svndiff version 3
+ * windows.  Delta windows of up to this size may be created using
+ * svn_txdelta__target_push().
+ */
+#define SVN_DELTA__LARGE_WINDOW_SIZE (4 * 1024 * 1024)
+
+/** Like svn_txdelta_target_push() but use delta windows of up to
+ * @a window_size bytes.  For sizes larger than the default window size,
+ * the resulting windows can only be encoded using svndiff version 3 or
+ * higher.  @a window_size must not exceed #SVN_DELTA__LARGE_WINDOW_SIZE.
+ */
+svn_stream_t *
+svn_txdelta__target_push(svn_txdelta_window_handler_t handler,
+                         void *handler_baton,
+                         svn_stream_t *source,
+                         apr_size_t window_size,
+                         apr_pool_t *pool);
+
 /* Return a debug editor that wraps @a wrapped_editor.
  *
  * The debug editor simply prints an indication of what callbacks are being
@@ -126,6 +156,33 @@ svn_delta__get_debug_editor(const svn_delta_editor_t **editor,
                             const char *prefix,
                             apr_pool_t *pool);
 
+/* The implementations of the xdelta algorithm behind svn_txdelta2() and
+ * friends.  They all produce the same deltas.
+ */
+typedef enum svn_txdelta__xdelta_impl_t
+{
+  /* The fastest implementation that the CPU supports. */
+  svn_txdelta__xdelta_impl_auto = 0,
+
+  /* Portable C code. */
+  svn_txdelta__xdelta_impl_scalar,
+
+  /* x86 SSE4.1 code. */
+  svn_txdelta__xdelta_impl_sse41,
+
+  /* x86 AVX2 code. */
+  svn_txdelta__xdelta_impl_avx2
+} svn_txdelta__xdelta_impl_t;
+
+/* Make all subsequent deltifications use the xdelta implementation
+ * @a impl.  Return FALSE and change nothing, if this build or the CPU
+ * does not support @a impl.
+ *
+ * This is not thread-safe and only meant for tests and benchmarks.
+ */
+svn_boolean_t
+svn_txdelta__xdelta_set_impl(svn_txdelta__xdelta_impl_t impl);
+
 
 #ifdef __cplusplus
 }
@@ -364,6 +364,18 @@ typedef struct svn_fs_fs__ioctl_build_rep_cache_input_t
 /* See svn_fs_fs__build_rep_cache(). */
 SVN_FS_DECLARE_IOCTL_CODE(SVN_FS_FS__IOCTL_BUILD_REP_CACHE, SVN_FS_TYPE_FSFS, 1004);
 
+typedef struct svn_fs_fs__ioctl_cache_snapshot_input_t
+{
+  /* Path of the snapshot file. */
+  const char *path;
+} svn_fs_fs__ioctl_cache_snapshot_input_t;
+
+/* See svn_fs_fs__save_cache_snapshot().  Pass NULL as the filesystem. */
+SVN_FS_DECLARE_IOCTL_CODE(SVN_FS_FS__IOCTL_SAVE_CACHE_SNAPSHOT, SVN_FS_TYPE_FSFS, 1005);
+
+/* See svn_fs_fs__load_cache_snapshot().  Pass NULL as the filesystem. */
+SVN_FS_DECLARE_IOCTL_CODE(SVN_FS_FS__IOCTL_LOAD_CACHE_SNAPSHOT, SVN_FS_TYPE_FSFS, 1006);
+
 #ifdef __cplusplus
 }
 #endif /* __cplusplus */
@@ -27,6 +27,7 @@
 #ifndef SVN_RA_SVN_PRIVATE_H
 #define SVN_RA_SVN_PRIVATE_H
 
+#include "svn_ra.h"
 #include "svn_ra_svn.h"
 #include "svn_editor.h"
 
@@ -146,6 +147,80 @@ svn_ra_svn__set_shim_callbacks(svn_ra_svn_conn_t *conn,
 apr_pool_t *
 svn_ra_svn__get_pool(svn_ra_svn_conn_t *conn);
 
+/** Callback used by the editor of svn_ra_svn__get_editor() to decide
+ * whether the contents of the file at @a path, relative to the edit root,
+ * shall be fetched by the client separately instead of being sent as part
+ * of the edit.  If so, set @a *fetch_path to the file's path relative to
+ * the repository root and @a *fetch_rev to the revision to fetch.  Else,
+ * set @a *fetch_path to NULL.  Use @a pool for allocations.
+ */
+typedef svn_error_t *(*svn_ra_svn__defer_contents_func_t)(
+  const char **fetch_path,
+  svn_revnum_t *fetch_rev,
+  void *baton,
+  const char *path,
+  apr_pool_t *pool);
+
+/** Like svn_ra_svn_get_editor() but call @a defer_func with @a defer_baton
+ * for every file whose contents would be sent without a delta base.  If
+ * the callback returns a path, send a "fetch-file" command instead of the
+ * text delta.  @a defer_func may be NULL.
+ */
+void
+svn_ra_svn__get_editor(const svn_delta_editor_t **editor,
+                       void **edit_baton,
+                       svn_ra_svn_conn_t *conn,
+                       apr_pool_t *pool,
+                       svn_ra_svn_edit_callback callback,
+                       void *callback_baton,
+                       svn_ra_svn__defer_contents_func_t defer_func,
+                       void *defer_baton);
+
+/** Callbacks used by svn_ra_svn__drive_editor() to retrieve the contents
+ * of files announced by "fetch-file" commands while the edit continues.
+ */
+typedef struct svn_ra_svn__fetcher_t
+{
+  /** Start retrieving @a file, with a path relative to the repository
+   * root, in the background.  @a file_baton identifies the file in the
+   * results of @c fetch_next.  Use @a scratch_pool for temporary
+   * allocations.
+   */
+  svn_error_t *(*fetch_start)(void *baton,
+                              const svn_ra_file_request_t *file,
+                              void *file_baton,
+                              apr_pool_t *scratch_pool);
+
+  /** Wait for the next retrieval to complete, in the order they finish,
+   * and set @a *file_baton to the baton given to @c fetch_start and
+   * @a *contents to a readable stream of the file contents.  The stream
+   * remains valid until the next call.  Set @a *file_baton to NULL if
+   * no retrievals are left.  Use @a scratch_pool for temporary
+   * allocations.
+   */
+  svn_error_t *(*fetch_next)(void **file_baton,
+                             svn_stream_t **contents,
+                             void *baton,
+                             apr_pool_t *scratch_pool);
+} svn_ra_svn__fetcher_t;
+
+/** Like svn_ra_svn_drive_editor2() but accept "fetch-file" commands if
+ * @a fetcher is not NULL.  The contents of these files get requested
+ * through @a fetcher with @a fetch_baton as soon as the command arrives.
+ * The files will be kept open until the edit is complete.  Then, their
+ * contents get applied to @a editor as they become available, before
+ * the edit gets closed.
+ */
+svn_error_t *
+svn_ra_svn__drive_editor(svn_ra_svn_conn_t *conn,
+                         apr_pool_t *pool,
+                         const svn_delta_editor_t *editor,
+                         void *edit_baton,
+                         svn_boolean_t *aborted,
+                         svn_boolean_t for_replay,
+                         const svn_ra_svn__fetcher_t *fetcher,
+                         void *fetch_baton);
+
 /**
  * @defgroup ra_svn_deprecated ra_svn low-level functions
  * @{
@@ -178,6 +253,80 @@ svn_ra_svn__write_cstring(svn_ra_svn_conn_t *conn,
                           apr_pool_t *pool,
                           const char *s);
 
+/** Set @a *bytes_in and @a *bytes_out to the number of protocol bytes
+ * received and sent through @a conn since it has been created.  Unlike
+ * the per-command I/O limit counters, these never get reset.
+ */
+void
+svn_ra_svn__get_io_totals(apr_uint64_t *bytes_in,
+                          apr_uint64_t *bytes_out,
+                          svn_ra_svn_conn_t *conn);
+
+/** Return the name of the command that the latest call to
+ * svn_ra_svn__handle_command() on @a conn dispatched, or NULL if it did
+ * not find a known command.  The string lives as long as the command
+ * table.
+ */
+const char *
+svn_ra_svn__get_last_command(svn_ra_svn_conn_t *conn);
+
+/** Whole-stream compression methods for ra_svn connections. */
+typedef enum svn_ra_svn__stream_compression_t
+{
+  /** Plain protocol data. */
+  svn_ra_svn__stream_compression_none = 0,
+
+  /** LZ4 frames; cheap enough to keep up with fast LANs. */
+  svn_ra_svn__stream_compression_lz4,
+
+  /** zlib frames; smaller output for slow links. */
+  svn_ra_svn__stream_compression_zlib
+} svn_ra_svn__stream_compression_t;
+
+/** Traffic and timing counters of a compressed ra_svn connection. */
+typedef struct svn_ra_svn__compression_stats_t
+{
+  /** Protocol bytes before compression / after decompression. */
+  apr_uint64_t raw_out;
+  apr_uint64_t raw_in;
+
+  /** Bytes actually sent / received on the underlying stream. */
+  apr_uint64_t wire_out;
+  apr_uint64_t wire_in;
+
+  /** Time spent in the compressor and decompressor, respectively. */
+  apr_interval_time_t compress_time;
+  apr_interval_time_t decompress_time;
+} svn_ra_svn__compression_stats_t;
+
+/** Return the capability word that announces @a method, or NULL for
+ * #svn_ra_svn__stream_compression_none.
+ */
+const char *
+svn_ra_svn__stream_compression_cap(svn_ra_svn__stream_compression_t method);
+
+/** Compress everything sent and received through @a conn from now on,
+ * using @a method.  Pending output gets flushed first.  Both sides must
+ * switch at the same point in the protocol.  Calling this for
+ * #svn_ra_svn__stream_compression_none or on a connection that already
+ * is compressed is a no-op.  Use @a scratch_pool for temporaries.
+ */
+svn_error_t *
+svn_ra_svn__enable_stream_compression(svn_ra_svn_conn_t *conn,
+                                      svn_ra_svn__stream_compression_t method,
+                                      apr_pool_t *scratch_pool);
+
+/** Return the compression method active on @a conn.
+ */
+svn_ra_svn__stream_compression_t
+svn_ra_svn__get_stream_compression(svn_ra_svn_conn_t *conn);
+
+/** Return the compression counters of @a conn.  All of them will be 0
+ * unless whole-stream compression has been enabled.
+ */
+const svn_ra_svn__compression_stats_t *
+svn_ra_svn__get_compression_stats(svn_ra_svn_conn_t *conn);
+
 /** Write a word over the net.
  *
  * Writes will be buffered until the next read or flush.
@@ -605,6 +754,18 @@ svn_ra_svn__write_cmd_textdelta_end(svn_ra_svn_conn_t *conn,
                                     apr_pool_t *pool,
                                     const svn_string_t *token);
 
+/** Send a "fetch-file" command over connection @a conn.  The contents of
+ * the file identified by @a token will not be sent as part of the edit.
+ * Instead, the client shall fetch them from @a path relative to the
+ * repository root in revision @a rev.  Use @a pool for allocations.
+ */
+svn_error_t *
+svn_ra_svn__write_cmd_fetch_file(svn_ra_svn_conn_t *conn,
+                                 apr_pool_t *pool,
+                                 const svn_string_t *token,
+                                 const char *path,
+                                 svn_revnum_t rev);
+
 /** Send a "close-edit" command over connection @a conn.  Ends the editor
  * drive (successfully).  Use @a pool for allocations.
  */
@@ -770,7 +931,9 @@ svn_ra_svn__write_cmd_get_file(svn_ra_svn_conn_t *conn,
                                svn_boolean_t props,
                                svn_boolean_t stream);
 
-/** Send a "update" command over connection @a conn.
+/** Send a "update" command over connection @a conn.  If @a defer_size
+ * is not 0, ask the server to announce files of at least that size with
+ * "fetch-file" instead of sending their contents.
  * Use @a pool for allocations.
  *
  * @see #svn_ra_do_update3 for a description.
@@ -783,7 +946,8 @@ svn_ra_svn__write_cmd_update(svn_ra_svn_conn_t *conn,
                              svn_boolean_t recurse,
                              svn_depth_t depth,
                              svn_boolean_t send_copyfrom_args,
-                             svn_boolean_t ignore_ancestry);
+                             svn_boolean_t ignore_ancestry,
+                             apr_uint64_t defer_size);
 
 /** Send a "switch" command over connection @a conn.
  * Use @a pool for allocations.
@@ -178,6 +178,96 @@ svn_repos__get_logs_compat(svn_repos_t *repos,
                            void *receiver_baton,
                            apr_pool_t *pool);
 
+/**
+ * Create the log index of @a repos, if it does not exist yet, and add all
+ * revisions to it that it does not cover, yet.  Set @a *indexed_rev to
+ * the youngest revision covered by the index afterwards; may be @c NULL.
+ *
+ * The log index lists the revisions in which paths changed and allows
+ * svn_repos_get_logs5() to skip walking the node history of the paths
+ * given to it.  Once created, it is kept up to date by
+ * svn_repos_fs_commit_txn().  Deleting the database file in the
+ * repository's "db" directory disables it again.
+ *
+ * Call @a cancel_func with @a cancel_baton between revisions.  Use
+ * @a scratch_pool for temporary allocations.
+ */
+svn_error_t *
+svn_repos__log_index_build(svn_revnum_t *indexed_rev,
+                           svn_repos_t *repos,
+                           svn_cancel_func_t cancel_func,
+                           void *cancel_baton,
+                           apr_pool_t *scratch_pool);
+
+/* Set *COPY to a new authz object in RESULT_POOL that shares the parsed
+ * rules of AUTHZ but keeps its own per-user filtered rules.  Unlike AUTHZ
+ * itself, which must not be accessed concurrently, AUTHZ may thus serve
+ * many threads each using their own copy.  AUTHZ must remain valid for
+ * as long as *COPY is being used.
+ */
+void
+svn_repos__authz_share(svn_authz_t **copy,
+                       const svn_authz_t *authz,
+                       apr_pool_t *result_pool);
+
+/* Like svn_repos_authz_check_access() but check all paths (const char *)
+ * in PATHS at once and set ACCESS_GRANTED[i] for the i-th element of
+ * PATHS.  ACCESS_GRANTED must provide space for PATHS->NELTS elements.
+ * Paths not starting with '/' will be taken relative to the repository
+ * root.  PATHS does not need to be sorted.  The lookups share a single walk
+ * through the rule tree for all paths with a common parent and whole
+ * sub-trees with uniform access will be decided at once.
+ * Use SCRATCH_POOL for temporary allocations.
+ */
+svn_error_t *
+svn_repos__authz_check_paths(svn_boolean_t *access_granted,
+                             svn_authz_t *authz,
+                             const char *repos_name,
+                             const apr_array_header_t *paths,
+                             const char *user,
+                             svn_repos_authz_access_t required_access,
+                             apr_pool_t *scratch_pool);
+
+/* Callback invoked by svn_repos__authz_read_func() for every PATH that
+ * has been found to be unreadable.  BATON is the DENIED_BATON given in
+ * svn_repos__authz_read_baton_t.  Use SCRATCH_POOL for temporaries.
+ */
+typedef svn_error_t *
+(*svn_repos__authz_denied_func_t)(const char *path,
+                                  void *baton,
+                                  apr_pool_t *scratch_pool);
+
+/* Baton type to be used with svn_repos__authz_read_func().
+ */
+typedef struct svn_repos__authz_read_baton_t
+{
+  /* Authz rules to check against. */
+  svn_authz_t *authz;
+
+  /* Repository name and user to pass to svn_repos_authz_check_access(). */
+  const char *repos_name;
+  const char *user;
+
+  /* Optional notification about denied paths.  May be NULL. */
+  svn_repos__authz_denied_func_t denied_func;
+  void *denied_baton;
+} svn_repos__authz_read_baton_t;
+
+/* Implements svn_repos_authz_func_t for read access with BATON being a
+ * svn_repos__authz_read_baton_t.  Paths not starting with '/' will be
+ * taken relative to the repository root.  ROOT is not used.
+ *
+ * Code in this library that needs to check many paths at once, e.g.
+ * log and replay, recognizes this function and will use
+ * svn_repos__authz_check_paths() instead of calling it for every path.
+ */
+svn_error_t *
+svn_repos__authz_read_func(svn_boolean_t *allowed,
+                           svn_fs_root_t *root,
+                           const char *path,
+                           void *baton,
+                           apr_pool_t *pool);
+
 /**
  * @defgroup svn_config_pool Configuration object pool API
  * @{
@@ -2128,6 +2128,33 @@ svn_wc__translated_stream(svn_stream_t **stream,
                           apr_pool_t *result_pool,
                           apr_pool_t *scratch_pool);
 
+/* The change journal protocol of svn-wc-watcher.
+ *
+ * svn-wc-watcher records the paths that change below a working copy root
+ * and serves them on a Unix domain socket named SVN_WC__WATCHER_SOCKET in
+ * the administrative directory of that root.  A client sends the line
+ * SVN_WC__WATCHER_CMD_JOURNAL and the watcher answers with the lines
+ *
+ *   SVN_WC__WATCHER_GREETING
+ *   session SESSION-ID
+ *   path RELPATH          (repeated for every changed path)
+ *   end
+ *
+ * and closes the connection.  The RELPATHs are relative to the working
+ * copy root and in the local encoding.  They cover every change since
+ * the session identified by SESSION-ID started.  The watcher starts a new
+ * session whenever it may have missed a change and answers with the
+ * greeting alone while it can't watch the whole working copy.  The line
+ * SVN_WC__WATCHER_CMD_STOP makes the watcher exit without answering.
+ *
+ * Clients ignore the socket unless it is owned by the owner of the
+ * administrative directory.
+ */
+#define SVN_WC__WATCHER_SOCKET      "watcher.sock"
+#define SVN_WC__WATCHER_GREETING    "svn-wc-watcher 1"
+#define SVN_WC__WATCHER_CMD_JOURNAL "journal"
+#define SVN_WC__WATCHER_CMD_STOP    "stop"
+
 #ifdef __cplusplus
 }
 #endif /* __cplusplus */
@@ -83,6 +83,25 @@ svn_cache_config_get(void);
 void
 svn_cache_config_set(const svn_cache_config_t *settings);
 
+/** Create the process-wide cache as configured by svn_cache_config_set()
+ * in memory that is shared with all processes being forked from the
+ * calling process afterwards, e.g. the worker processes of a pre-fork
+ * server.  Instead of each of them warming its own copy, they will then
+ * all see and add to the same cache contents.
+ *
+ * Call this from the processes' initialization code after
+ * svn_cache_config_set() and before forking the worker processes or
+ * accessing any repository.  If the cache has already been created,
+ * this function has no effect.
+ *
+ * Returns #SVN_ERR_UNSUPPORTED_FEATURE if the platform does not support
+ * shared memory or forking processes.
+ *
+ * @since New in 1.15.
+ */
+svn_error_t *
+svn_cache_config_create_shared(void);
+
 /** @} */
 
 /** @} */
@@ -166,6 +166,32 @@ typedef struct svn_fs_t svn_fs_t;
  */
 #define SVN_FS_CONFIG_FSFS_LOG_ADDRESSING       "fsfs-log-addressing"
 
+/** Enable large delta windows (the "large-delta-windows" option in
+ * fsfs.conf) in a new FSFS repository.  String, defaults to "false".
+ *
+ * This requires FSFS format 9, which Subversion releases prior to 1.15
+ * cannot read.  Unless this is set or #SVN_FS_CONFIG_COMPATIBLE_VERSION
+ * explicitly asks for 1.15 or newer, new repositories use format 8.
+ *
+ * This option will only be used during the creation of new repositories
+ * and is otherwise ignored.
+ *
+ * @since New in 1.15.
+ */
+#define SVN_FS_CONFIG_FSFS_LARGE_DELTA_WINDOWS  "fsfs-large-delta-windows"
+
+/** String with a decimal representation of the maximum number of FSFS
+ * shards that svn_fs_pack2() may pack concurrently.  Defaults to "1".
+ *
+ * Values larger than 1 only take effect if APR supports threads and the
+ * cache configuration allows for multi-threaded access, see
+ * #svn_cache_config_t.single_threaded.  Every concurrent job may use as
+ * much temporary memory as a sequential pack does.
+ *
+ * @since New in 1.15.
+ */
+#define SVN_FS_CONFIG_FSFS_PACK_JOBS            "fsfs-pack-jobs"
+
 /* Note to maintainers: if you add further SVN_FS_CONFIG_FSFS_CACHE_* knobs,
    update fs_fs.c:verify_as_revision_before_current_plus_plus(). */
 
@@ -3300,12 +3326,48 @@ typedef svn_error_t *(*svn_fs_pack_notify_t)(void *baton,
                                              svn_fs_pack_notify_action_t action,
                                              apr_pool_t *pool);
 
+/** Like #svn_fs_pack_notify_t but also provides the @a duration of the
+ * action.  For #svn_fs_pack_notify_end and #svn_fs_pack_notify_end_revprop,
+ * @a duration is the time it took to pack the respective shard.  It is 0
+ * for all other actions.
+ *
+ * @since New in 1.15.
+ */
+typedef svn_error_t *(*svn_fs_pack_notify2_t)(
+  void *baton,
+  apr_int64_t shard,
+  svn_fs_pack_notify_action_t action,
+  apr_interval_time_t duration,
+  apr_pool_t *scratch_pool);
+
 /**
- * Possibly update the filesystem located in the directory @a path
+ * Possibly update the filesystem located in the directory @a db_path
  * to use disk space more efficiently.
  *
+ * @a fs_config is passed to the filesystem backend as in svn_fs_open2().
+ * It may be @c NULL.  See #SVN_FS_CONFIG_FSFS_PACK_JOBS for packing
+ * multiple shards concurrently.  Notifications will always be sent from
+ * the calling thread and in shard order.
+ *
+ * @since New in 1.15.
+ */
+svn_error_t *
+svn_fs_pack2(const char *db_path,
+             apr_hash_t *fs_config,
+             svn_fs_pack_notify2_t notify_func,
+             void *notify_baton,
+             svn_cancel_func_t cancel_func,
+             void *cancel_baton,
+             apr_pool_t *scratch_pool);
+
+/**
+ * Like svn_fs_pack2(), but without @a fs_config and without reporting
+ * the duration of the pack steps.
+ *
  * @since New in 1.6.
+ * @deprecated Provided for backward compatibility with the 1.14 API.
  */
+SVN_DEPRECATED
 svn_error_t *
 svn_fs_pack(const char *db_path,
             svn_fs_pack_notify_t notify_func,
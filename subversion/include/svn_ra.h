@@ -1101,6 +1101,72 @@ svn_ra_get_file(svn_ra_session_t *session,
                 apr_hash_t **props,
                 apr_pool_t *pool);
 
+/**
+ * A file to fetch with svn_ra_get_files().
+ *
+ * @since New in 1.15.
+ */
+typedef struct svn_ra_file_request_t
+{
+  /** The file's path relative to the session URL. */
+  const char *path;
+
+  /** The revision to fetch or @c SVN_INVALID_REVNUM for HEAD. */
+  svn_revnum_t revision;
+} svn_ra_file_request_t;
+
+/**
+ * Callback type to be used with svn_ra_get_files().  It will be invoked
+ * once for every requested file, in request order, before the contents
+ * of that file are delivered.
+ *
+ * @a path is the path as given in the request and @a fetched_rev is the
+ * revision actually retrieved.  @a props contains all properties of the
+ * file, as in svn_ra_get_file(), or is @c NULL if they were not requested.
+ *
+ * Set @a *stream to the stream that shall receive the file's contents or
+ * to @c NULL to discard them.  The stream will not be closed.  It must
+ * remain valid until the next invocation of the callback or until
+ * svn_ra_get_files() returns.
+ *
+ * @a baton is the user-provided receiver baton.  @a scratch_pool may be
+ * used for temporary allocations.
+ *
+ * @since New in 1.15.
+ */
+typedef svn_error_t *(* svn_ra_file_receiver_t)(svn_stream_t **stream,
+                                                void *baton,
+                                                const char *path,
+                                                svn_revnum_t fetched_rev,
+                                                apr_hash_t *props,
+                                                apr_pool_t *scratch_pool);
+
+/**
+ * Fetch the contents and, if @a want_props is set, the properties of all
+ * files in @a files, an array of <tt>svn_ra_file_request_t *</tt>, and
+ * pass them to @a receiver with @a receiver_baton.
+ *
+ * This is equivalent to calling svn_ra_get_file() for each element of
+ * @a files but RA layers may fetch all of them with a single request,
+ * saving a network round trip per file.  RA layers that can't do that
+ * fall back to individual svn_ra_get_file() calls.
+ *
+ * The first file that can't be fetched terminates the operation and
+ * its error will be returned.  The callback and stream handlers may not
+ * perform any RA operations using @a session.
+ *
+ * Use @a scratch_pool for temporary allocations.
+ *
+ * @since New in 1.15.
+ */
+svn_error_t *
+svn_ra_get_files(svn_ra_session_t *session,
+                 const apr_array_header_t *files,
+                 svn_boolean_t want_props,
+                 svn_ra_file_receiver_t receiver,
+                 void *receiver_baton,
+                 apr_pool_t *scratch_pool);
+
 /**
  * If @a dirents is non @c NULL, set @a *dirents to contain all the entries
  * of directory @a path at @a revision.  The keys of @a dirents will be
@@ -71,6 +71,17 @@ extern "C" {
 #define SVN_RA_SVN_CAP_GET_FILE_REVS_REVERSE "file-revs-reverse"
 /* maps to SVN_RA_CAPABILITY_LIST */
 #define SVN_RA_SVN_CAP_LIST "list"
+/* server supports the get-files command
+ * @since New in 1.15. */
+#define SVN_RA_SVN_CAP_GET_FILES "get-files"
+/* whole-stream compression after the capability exchange
+ * @since New in 1.15. */
+#define SVN_RA_SVN_CAP_STREAM_LZ4 "compressed-stream-lz4"
+#define SVN_RA_SVN_CAP_STREAM_ZLIB "compressed-stream-zlib"
+/* update may announce large file contents with fetch-file instead of
+ * sending them inline
+ * @since New in 1.15. */
+#define SVN_RA_SVN_CAP_DEFER_CONTENTS "defer-file-contents"
 
 
 /** ra_svn passes @c svn_dirent_t fields over the wire as a list of
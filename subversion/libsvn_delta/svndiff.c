@@ -39,13 +39,16 @@
 static const char SVNDIFF_V0[] = { 'S', 'V', 'N', 0 };
 static const char SVNDIFF_V1[] = { 'S', 'V', 'N', 1 };
 static const char SVNDIFF_V2[] = { 'S', 'V', 'N', 2 };
+static const char SVNDIFF_V3[] = { 'S', 'V', 'N', 3 };
 
 #define SVNDIFF_HEADER_SIZE (sizeof(SVNDIFF_V0))
 
 static const char *
 get_svndiff_header(int version)
 {
-  if (version == 2)
+  if (version == 3)
+    return SVNDIFF_V3;
+  else if (version == 2)
     return SVNDIFF_V2;
   else if (version == 1)
     return SVNDIFF_V1;
@@ -74,6 +77,27 @@ struct encoder_baton {
    1-byte copy-from-source instructions (though this is very unlikely). */
 #define MAX_INSTRUCTION_SECTION_LEN (SVN_DELTA_WINDOW_SIZE*MAX_INSTRUCTION_LEN)
 
+/* Same as MAX_INSTRUCTION_SECTION_LEN but for svndiff3 windows. */
+#define MAX_LARGE_INSTRUCTION_SECTION_LEN \
+  (SVN_DELTA__LARGE_WINDOW_SIZE*MAX_INSTRUCTION_LEN)
+
+/* Return the maximum size of source and target views in windows of
+   svndiff version VERSION. */
+static apr_size_t
+max_window_size(int version)
+{
+  return version >= 3 ? SVN_DELTA__LARGE_WINDOW_SIZE : SVN_DELTA_WINDOW_SIZE;
+}
+
+/* Return the maximum size of the instructions section in windows of
+   svndiff version VERSION. */
+static apr_size_t
+max_instruction_section_len(int version)
+{
+  return version >= 3 ? MAX_LARGE_INSTRUCTION_SECTION_LEN
+                      : MAX_INSTRUCTION_SECTION_LEN;
+}
+
 
 /* Append an encoded integer to a string.  */
 static void
@@ -206,7 +230,7 @@ encode_window(svn_stringbuf_t **instructions_p,
                                 compressed_instructions));
       instructions = compressed_instructions;
     }
-  else if (version == 1)
+  else if (version == 1 || version == 3)
     {
       svn_stringbuf_t *compressed_instructions;
       compressed_instructions = svn_stringbuf_create_empty(pool);
@@ -225,7 +249,7 @@ encode_window(svn_stringbuf_t **instructions_p,
                                 compressed));
       newdata = svn_stringbuf__morph_into_string(compressed);
     }
-  else if (version == 1)
+  else if (version == 1 || version == 3)
     {
       svn_stringbuf_t *compressed = svn_stringbuf_create_empty(pool);
 
@@ -256,6 +280,14 @@ window_handler(svn_txdelta_window_t *window, void *baton)
   svn_stringbuf_t *header;
   const svn_string_t *newdata;
 
+  /* Older svndiff versions cannot represent large windows. */
+  if (window
+      && (window->sview_len > max_window_size(eb->version)
+          || window->tview_len > max_window_size(eb->version)))
+    return svn_error_createf(SVN_ERR_SVNDIFF_CORRUPT_WINDOW, NULL,
+                             _("Delta window too large for svndiff "
+                               "version %d"), eb->version);
+
   /* use specialized code if there is no source */
   if (window && !window->src_ops && window->num_ops == 1 && !eb->version)
     return svn_error_trace(send_simple_insertion_window(window, eb));
@@ -380,6 +412,9 @@ struct decode_baton
      be FALSE. */
   svn_boolean_t error_on_early_close;
 
+  /* Accept svndiff version 3 data with its larger window limits?  */
+  svn_boolean_t allow_large_windows;
+
   /* svndiff version in use by delta.  */
   unsigned char version;
 
@@ -571,9 +606,9 @@ decode_window(svn_txdelta_window_t *window, svn_filesize_t sview_offset,
       svn_stringbuf_t *ndout = svn_stringbuf_create_empty(pool);
 
       SVN_ERR(svn__decompress_lz4(insend, newlen, ndout,
-                                  SVN_DELTA_WINDOW_SIZE));
+                                  max_window_size(version)));
       SVN_ERR(svn__decompress_lz4(data, insend - data, instout,
-                                  MAX_INSTRUCTION_SECTION_LEN));
+                                  max_instruction_section_len(version)));
 
       newlen = ndout->len;
       data = (unsigned char *)instout->data;
@@ -581,15 +616,15 @@ decode_window(svn_txdelta_window_t *window, svn_filesize_t sview_offset,
 
       new_data = svn_stringbuf__morph_into_string(ndout);
     }
-  else if (version == 1)
+  else if (version == 1 || version == 3)
     {
       svn_stringbuf_t *instout = svn_stringbuf_create_empty(pool);
       svn_stringbuf_t *ndout = svn_stringbuf_create_empty(pool);
 
       SVN_ERR(svn__decompress_zlib(insend, newlen, ndout,
-                                   SVN_DELTA_WINDOW_SIZE));
+                                   max_window_size(version)));
       SVN_ERR(svn__decompress_zlib(data, insend - data, instout,
-                                   MAX_INSTRUCTION_SECTION_LEN));
+                                   max_instruction_section_len(version)));
 
       newlen = ndout->len;
       data = (unsigned char *)instout->data;
@@ -653,6 +688,9 @@ write_handler(void *baton,
         db->version = 1;
       else if (memcmp(buffer, SVNDIFF_V2 + db->header_bytes, nheader) == 0)
         db->version = 2;
+      else if (db->allow_large_windows
+               && memcmp(buffer, SVNDIFF_V3 + db->header_bytes, nheader) == 0)
+        db->version = 3;
       else
         return svn_error_create(SVN_ERR_SVNDIFF_INVALID_HEADER, NULL,
                                 _("Svndiff has invalid header"));
@@ -710,11 +748,12 @@ write_handler(void *baton,
           if (p == NULL)
               break;
 
-          if (tview_len > SVN_DELTA_WINDOW_SIZE ||
-              sview_len > SVN_DELTA_WINDOW_SIZE ||
+          if (tview_len > max_window_size(db->version) ||
+              sview_len > max_window_size(db->version) ||
               /* for svndiff1, newlen includes the original length */
-              newlen > SVN_DELTA_WINDOW_SIZE + SVN__MAX_ENCODED_UINT_LEN ||
-              inslen > MAX_INSTRUCTION_SECTION_LEN)
+              newlen > max_window_size(db->version)
+                       + SVN__MAX_ENCODED_UINT_LEN ||
+              inslen > max_instruction_section_len(db->version))
             return svn_error_create(
                      SVN_ERR_SVNDIFF_CORRUPT_WINDOW, NULL,
                      _("Svndiff contains a too-large window"));
@@ -818,10 +857,11 @@ close_handler(void *baton)
 
 
 svn_stream_t *
-svn_txdelta_parse_svndiff(svn_txdelta_window_handler_t handler,
-                          void *handler_baton,
-                          svn_boolean_t error_on_early_close,
-                          apr_pool_t *pool)
+svn_txdelta__parse_svndiff(svn_txdelta_window_handler_t handler,
+                           void *handler_baton,
+                           svn_boolean_t error_on_early_close,
+                           svn_boolean_t allow_large_windows,
+                           apr_pool_t *pool)
 {
   svn_stream_t *stream;
 
@@ -839,6 +879,7 @@ svn_txdelta_parse_svndiff(svn_txdelta_window_handler_t handler,
       db->last_sview_len = 0;
       db->header_bytes = 0;
       db->error_on_early_close = error_on_early_close;
+      db->allow_large_windows = allow_large_windows;
       db->window_header_len = 0;
       stream = svn_stream_create(db, pool);
 
@@ -855,6 +896,16 @@ svn_txdelta_parse_svndiff(svn_txdelta_window_handler_t handler,
   return stream;
 }
 
+svn_stream_t *
+svn_txdelta_parse_svndiff(svn_txdelta_window_handler_t handler,
+                          void *handler_baton,
+                          svn_boolean_t error_on_early_close,
+                          apr_pool_t *pool)
+{
+  return svn_txdelta__parse_svndiff(handler, handler_baton,
+                                    error_on_early_close, FALSE, pool);
+}
+
 
 /* Routines for reading one svndiff window at a time. */
 
@@ -894,12 +945,13 @@ read_one_size(apr_size_t *size,
   return SVN_NO_ERROR;
 }
 
-/* Read a window header from STREAM and check it for integer overflow. */
+/* Read a window header from STREAM and check it for integer overflow
+   and the size limits of svndiff version VERSION. */
 static svn_error_t *
 read_window_header(svn_stream_t *stream, svn_filesize_t *sview_offset,
                    apr_size_t *sview_len, apr_size_t *tview_len,
                    apr_size_t *inslen, apr_size_t *newlen,
-                   apr_size_t *header_len)
+                   apr_size_t *header_len, int version)
 {
   unsigned char c;
 
@@ -921,11 +973,11 @@ read_window_header(svn_stream_t *stream, svn_filesize_t *sview_offset,
   SVN_ERR(read_one_size(inslen, header_len, stream));
   SVN_ERR(read_one_size(newlen, header_len, stream));
 
-  if (*tview_len > SVN_DELTA_WINDOW_SIZE ||
-      *sview_len > SVN_DELTA_WINDOW_SIZE ||
+  if (*tview_len > max_window_size(version) ||
+      *sview_len > max_window_size(version) ||
       /* for svndiff1, newlen includes the original length */
-      *newlen > SVN_DELTA_WINDOW_SIZE + SVN__MAX_ENCODED_UINT_LEN ||
-      *inslen > MAX_INSTRUCTION_SECTION_LEN)
+      *newlen > max_window_size(version) + SVN__MAX_ENCODED_UINT_LEN ||
+      *inslen > max_instruction_section_len(version))
     return svn_error_create(SVN_ERR_SVNDIFF_CORRUPT_WINDOW, NULL,
                             _("Svndiff contains a too-large window"));
 
@@ -950,7 +1002,8 @@ svn_txdelta_read_svndiff_window(svn_txdelta_window_t **window,
   unsigned char *buf;
 
   SVN_ERR(read_window_header(stream, &sview_offset, &sview_len, &tview_len,
-                             &inslen, &newlen, &header_len));
+                             &inslen, &newlen, &header_len,
+                             svndiff_version));
   len = inslen + newlen;
   buf = apr_palloc(pool, len);
   SVN_ERR(svn_stream_read_full(stream, (char*)buf, &len));
@@ -974,7 +1027,8 @@ svn_txdelta_skip_svndiff_window(apr_file_t *file,
   apr_off_t offset;
 
   SVN_ERR(read_window_header(stream, &sview_offset, &sview_len, &tview_len,
-                             &inslen, &newlen, &header_len));
+                             &inslen, &newlen, &header_len,
+                             svndiff_version));
 
   offset = inslen + newlen;
   return svn_io_file_seek(file, APR_CUR, &offset, pool);
@@ -983,13 +1037,15 @@ svn_txdelta_skip_svndiff_window(apr_file_t *file,
 svn_error_t *
 svn_txdelta__read_raw_window_len(apr_size_t *window_len,
                                  svn_stream_t *stream,
+                                 int svndiff_version,
                                  apr_pool_t *pool)
 {
   svn_filesize_t sview_offset;
   apr_size_t sview_len, tview_len, inslen, newlen, header_len;
 
   SVN_ERR(read_window_header(stream, &sview_offset, &sview_len, &tview_len,
-                             &inslen, &newlen, &header_len));
+                             &inslen, &newlen, &header_len,
+                             svndiff_version));
 
   *window_len = inslen + newlen + header_len;
   return SVN_NO_ERROR;
@@ -29,8 +29,20 @@
 
 #include "svn_hash.h"
 #include "svn_delta.h"
+#include "private/svn_atomic.h"
+#include "private/svn_delta_private.h"
 #include "private/svn_string_private.h"
 #include "delta.h"
+
+/* GCC and Clang let us enable instruction set extensions per function.
+   So, we can always compile the vectorized x86 kernels below and pick
+   them at runtime if the CPU supports them. */
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__)) \
+    && (defined(__clang__) || __GNUC__ > 4 \
+        || (__GNUC__ == 4 && __GNUC_MINOR__ >= 9))
+#define XDELTA_X86_KERNELS
+#include <immintrin.h>
+#endif
 
 /* This is pseudo-adler32. It is adler32 without the prime modulus.
    The idea is borrowed from monotone, and is a translation of the C++
@@ -44,15 +56,22 @@
  */
 #define MATCH_BLOCKSIZE 64
 
-/* Size of the checksum presence FLAGS array in BLOCKS_T.  With standard
-   MATCH_BLOCKSIZE and SVN_DELTA_WINDOW_SIZE, 32k entries is about 20x
-   the number of checksums that actually occur, i.e. we expect a >95%
+/* Minimum size of the checksum presence FLAGS array in BLOCKS_T.  With
+   standard MATCH_BLOCKSIZE and SVN_DELTA_WINDOW_SIZE, 32k entries is about
+   20x the number of checksums that actually occur, i.e. we expect a >95%
    probability that non-matching checksums get already detected by checking
-   against the FLAGS array.
+   against the FLAGS array.  Larger windows use proportionally larger
+   arrays, up to MAX_FLAGS_COUNT entries.
    Must be a power of 2.
  */
 #define FLAGS_COUNT (32 * 1024)
 
+/* Upper limit to the size of the FLAGS array in BLOCKS_T.  The flags are
+   addressed by 16 bits of the adler32 checksum plus 3 bits for the bit
+   position within the respective byte.
+ */
+#define MAX_FLAGS_COUNT (8 * 0x10000)
+
 /* "no" / "invalid" / "unused" value for positions within the delta windows
  */
 #define NO_POSITION ((apr_uint32_t)-1)
@@ -138,7 +157,10 @@ struct blocks
      The mapping of adler32 checksum bits is [0..2][16..27] (LSB -> MSB),
      i.e. address the byte by the multiplicative part of adler32 and address
      the bits in that byte by the additive part of adler32. */
-  char flags[FLAGS_COUNT / 8];
+  char *flags;
+
+  /* Number of bytes in FLAGS minus 1. */
+  apr_uint32_t flags_mask;
 
   /* The vector of blocks.  A pos value of NO_POSITION represents an unused
      slot. */
@@ -156,13 +178,14 @@ static apr_uint32_t hash_func(apr_uint32_t sum)
   return sum ^ (sum >> 12);
 }
 
-/* Return the offset in BLOCKS.FLAGS for the adler32 SUM. */
-static apr_uint32_t hash_flags(apr_uint32_t sum)
+/* Return the offset in BLOCKS.FLAGS for the adler32 SUM.  MASK is the
+   BLOCKS.FLAGS_MASK value. */
+static apr_uint32_t hash_flags(apr_uint32_t sum, apr_uint32_t mask)
 {
   /* The upper half of SUM has a wider value range than the lower 16 bit.
      Also, we want to a different folding than HASH_FUNC to minimize
      correlation between different hash levels. */
-  return (sum >> 16) & ((FLAGS_COUNT / 8) - 1);
+  return (sum >> 16) & mask;
 }
 
 /* Insert a block with the checksum ADLERSUM at position POS in the source
@@ -182,7 +205,8 @@ add_block(struct blocks *blocks, apr_uint32_t adlersum, apr_uint32_t pos)
 
   blocks->slots[h].adlersum = adlersum;
   blocks->slots[h].pos = pos;
-  blocks->flags[hash_flags(adlersum)] |= 1 << (adlersum & 7);
+  blocks->flags[hash_flags(adlersum, blocks->flags_mask)]
+    |= 1 << (adlersum & 7);
 }
 
 /* Find a block in BLOCKS with the checksum ADLERSUM and matching the content
@@ -204,11 +228,393 @@ find_block(const struct blocks *blocks,
   return NO_POSITION;
 }
 
+/* Return TRUE if BLOCKS may contain a block with the adler32 checksum SUM,
+   i.e. if the respective bit in BLOCKS->FLAGS is set. */
+static APR_INLINE svn_boolean_t
+is_flagged(const struct blocks *blocks, apr_uint32_t sum)
+{
+  return (blocks->flags[hash_flags(sum, blocks->flags_mask)]
+          & (1 << (sum & 7))) != 0;
+}
+
+/* The parts of compute_delta() that have vectorized implementations. */
+typedef struct xdelta_kernel_t
+{
+  /* Same as init_adler32(). */
+  apr_uint32_t (*init_adler32)(const char *data);
+
+  /* Starting at position *LO in B with the checksum *ROLLING, advance *LO
+     up to UPPER until it points to a block whose checksum is flagged in
+     BLOCKS.  Update *ROLLING accordingly.  UPPER + MATCH_BLOCKSIZE must
+     not exceed the size of B. */
+  void (*skip)(apr_size_t *lo,
+               apr_uint32_t *rolling,
+               const struct blocks *blocks,
+               const char *b,
+               apr_size_t upper);
+
+  /* Same as svn_cstring__match_length(). */
+  apr_size_t (*match_length)(const char *a,
+                             const char *b,
+                             apr_size_t max_len);
+} xdelta_kernel_t;
+
+/* Portable implementation of xdelta_kernel_t.skip. */
+static void
+skip_scalar(apr_size_t *lo,
+            apr_uint32_t *rolling,
+            const struct blocks *blocks,
+            const char *b,
+            apr_size_t upper)
+{
+  apr_size_t pos = *lo;
+  apr_uint32_t sum = *rolling;
+
+  while (!is_flagged(blocks, sum) && pos < upper)
+    {
+      sum = adler32_replace(sum, b[pos], b[pos + MATCH_BLOCKSIZE]);
+      pos++;
+    }
+
+  *lo = pos;
+  *rolling = sum;
+}
+
+/* Portable implementation of xdelta_kernel_t.init_adler32. */
+static apr_uint32_t
+init_adler32_scalar(const char *data)
+{
+  return init_adler32(data);
+}
+
+static const xdelta_kernel_t scalar_kernel =
+  { init_adler32_scalar, skip_scalar, svn_cstring__match_length };
+
+#ifdef XDELTA_X86_KERNELS
+
+/* The vectorized skip loops compute the checksums for the next N positions
+   in one go instead of rolling them one by one.  With s1 being the lower
+   and s2 being the upper 16 bits of the checksum at position P, the
+   checksum at position P + J + 1 is
+
+     s1[J] = s1 + sum(k = 0..J) (B[P + MATCH_BLOCKSIZE + k] - B[P + k])
+     s2[J] = s2 + sum(k = 0..J) (s1[k] - MATCH_BLOCKSIZE * B[P + k])
+
+   modulo 0x10000, i.e. two prefix sums over vectors of 16 bit values.
+   The filter lookups for those N checksums are then independent of each
+   other, which the scalar loop's dependency chain prevents. */
+
+/* Return the checksum at position P + LANE + 1 from the vectors stored
+   in S1 and S2. */
+static APR_INLINE apr_uint32_t
+lane_checksum(const apr_uint16_t *s1, const apr_uint16_t *s2, int lane)
+{
+  return ((apr_uint32_t)s2[lane] << 16) | s1[lane];
+}
+
+/* SSE4.1 implementation of xdelta_kernel_t.init_adler32.  s1 is the sum
+   of all bytes, s2 the sum of the bytes weighted by 64 ... 1. */
+static apr_uint32_t __attribute__((target("sse4.1")))
+init_adler32_sse41(const char *data)
+{
+  const __m128i zero = _mm_setzero_si128();
+  const __m128i ones = _mm_set1_epi16(1);
+  __m128i s1 = zero;
+  __m128i s2 = zero;
+  int i;
+
+  for (i = 0; i < MATCH_BLOCKSIZE; i += 16)
+    {
+      const __m128i weights
+        = _mm_setr_epi8(64 - i, 63 - i, 62 - i, 61 - i,
+                        60 - i, 59 - i, 58 - i, 57 - i,
+                        56 - i, 55 - i, 54 - i, 53 - i,
+                        52 - i, 51 - i, 50 - i, 49 - i);
+      __m128i chunk = _mm_loadu_si128((const __m128i *)(data + i));
+
+      s1 = _mm_add_epi64(s1, _mm_sad_epu8(chunk, zero));
+      s2 = _mm_add_epi32(s2, _mm_madd_epi16(_mm_maddubs_epi16(chunk,
+                                                              weights),
+                                            ones));
+    }
+
+  s1 = _mm_add_epi64(s1, _mm_unpackhi_epi64(s1, s1));
+  s2 = _mm_add_epi32(s2, _mm_unpackhi_epi64(s2, s2));
+  s2 = _mm_add_epi32(s2, _mm_srli_epi64(s2, 32));
+
+  return (apr_uint32_t)_mm_cvtsi128_si32(s2) * 0x10000
+       + (apr_uint32_t)_mm_cvtsi128_si32(s1);
+}
+
+/* Return the prefix sums of the 8 16 bit values in X. */
+static APR_INLINE __m128i __attribute__((target("sse4.1")))
+prefix_sum_sse41(__m128i x)
+{
+  x = _mm_add_epi16(x, _mm_slli_si128(x, 2));
+  x = _mm_add_epi16(x, _mm_slli_si128(x, 4));
+  return _mm_add_epi16(x, _mm_slli_si128(x, 8));
+}
+
+/* SSE4.1 implementation of xdelta_kernel_t.skip. */
+static void __attribute__((target("sse4.1")))
+skip_sse41(apr_size_t *lo,
+           apr_uint32_t *rolling,
+           const struct blocks *blocks,
+           const char *b,
+           apr_size_t upper)
+{
+  const unsigned char *data = (const unsigned char *)b;
+  apr_size_t pos = *lo;
+  apr_uint32_t sum = *rolling;
+
+  while (!is_flagged(blocks, sum) && pos + 8 <= upper)
+    {
+      apr_uint16_t s1[8], s2[8];
+      __m128i out, in, v1, v2;
+      int i;
+
+      out = _mm_cvtepu8_epi16(_mm_loadl_epi64((const __m128i *)(data + pos)));
+      in = _mm_cvtepu8_epi16(_mm_loadl_epi64(
+                               (const __m128i *)(data + pos
+                                                 + MATCH_BLOCKSIZE)));
+
+      v1 = _mm_add_epi16(prefix_sum_sse41(_mm_sub_epi16(in, out)),
+                         _mm_set1_epi16((short)sum));
+      v2 = _mm_sub_epi16(v1, _mm_slli_epi16(out, 6));
+      v2 = _mm_add_epi16(prefix_sum_sse41(v2),
+                         _mm_set1_epi16((short)(sum >> 16)));
+      _mm_storeu_si128((__m128i *)s1, v1);
+      _mm_storeu_si128((__m128i *)s2, v2);
+
+      for (i = 0; i < 8; i++)
+        if (is_flagged(blocks, lane_checksum(s1, s2, i)))
+          {
+            *lo = pos + i + 1;
+            *rolling = lane_checksum(s1, s2, i);
+            return;
+          }
+
+      pos += 8;
+      sum = lane_checksum(s1, s2, 7);
+    }
+
+  *lo = pos;
+  *rolling = sum;
+  skip_scalar(lo, rolling, blocks, b, upper);
+}
+
+/* SSE4.1 implementation of xdelta_kernel_t.match_length. */
+static apr_size_t __attribute__((target("sse4.1")))
+match_length_sse41(const char *a, const char *b, apr_size_t max_len)
+{
+  apr_size_t pos = 0;
+
+  for (; max_len - pos >= 16; pos += 16)
+    {
+      __m128i va = _mm_loadu_si128((const __m128i *)(a + pos));
+      __m128i vb = _mm_loadu_si128((const __m128i *)(b + pos));
+      unsigned int mask
+        = ~(unsigned int)_mm_movemask_epi8(_mm_cmpeq_epi8(va, vb)) & 0xffff;
+
+      if (mask)
+        return pos + __builtin_ctz(mask);
+    }
+
+  return pos + svn_cstring__match_length(a + pos, b + pos, max_len - pos);
+}
+
+static const xdelta_kernel_t sse41_kernel =
+  { init_adler32_sse41, skip_sse41, match_length_sse41 };
+
+/* AVX2 implementation of xdelta_kernel_t.init_adler32. */
+static apr_uint32_t __attribute__((target("avx2")))
+init_adler32_avx2(const char *data)
+{
+  const __m256i zero = _mm256_setzero_si256();
+  const __m256i ones = _mm256_set1_epi16(1);
+  const __m256i weights_lo
+    = _mm256_setr_epi8(64, 63, 62, 61, 60, 59, 58, 57,
+                       56, 55, 54, 53, 52, 51, 50, 49,
+                       48, 47, 46, 45, 44, 43, 42, 41,
+                       40, 39, 38, 37, 36, 35, 34, 33);
+  const __m256i weights_hi
+    = _mm256_setr_epi8(32, 31, 30, 29, 28, 27, 26, 25,
+                       24, 23, 22, 21, 20, 19, 18, 17,
+                       16, 15, 14, 13, 12, 11, 10,  9,
+                        8,  7,  6,  5,  4,  3,  2,  1);
+  __m256i lo = _mm256_loadu_si256((const __m256i *)data);
+  __m256i hi = _mm256_loadu_si256((const __m256i *)(data + 32));
+  __m256i s1_wide, s2_wide;
+  __m128i s1, s2;
+
+  s1_wide = _mm256_add_epi64(_mm256_sad_epu8(lo, zero),
+                             _mm256_sad_epu8(hi, zero));
+  s2_wide = _mm256_add_epi32(
+              _mm256_madd_epi16(_mm256_maddubs_epi16(lo, weights_lo), ones),
+              _mm256_madd_epi16(_mm256_maddubs_epi16(hi, weights_hi), ones));
+
+  s1 = _mm_add_epi64(_mm256_castsi256_si128(s1_wide),
+                     _mm256_extracti128_si256(s1_wide, 1));
+  s2 = _mm_add_epi32(_mm256_castsi256_si128(s2_wide),
+                     _mm256_extracti128_si256(s2_wide, 1));
+  s1 = _mm_add_epi64(s1, _mm_unpackhi_epi64(s1, s1));
+  s2 = _mm_add_epi32(s2, _mm_unpackhi_epi64(s2, s2));
+  s2 = _mm_add_epi32(s2, _mm_srli_epi64(s2, 32));
+
+  return (apr_uint32_t)_mm_cvtsi128_si32(s2) * 0x10000
+       + (apr_uint32_t)_mm_cvtsi128_si32(s1);
+}
+
+/* Return the prefix sums of the 16 16 bit values in X. */
+static APR_INLINE __m256i __attribute__((target("avx2")))
+prefix_sum_avx2(__m256i x)
+{
+  __m256i carry;
+
+  x = _mm256_add_epi16(x, _mm256_slli_si256(x, 2));
+  x = _mm256_add_epi16(x, _mm256_slli_si256(x, 4));
+  x = _mm256_add_epi16(x, _mm256_slli_si256(x, 8));
+
+  /* The shifts above work on the 128 bit halves individually.  Add the
+     last sum of the lower half to all values of the upper half. */
+  carry = _mm256_permute2x128_si256(x, x, 0x08);
+  carry = _mm256_shuffle_epi8(carry, _mm256_set1_epi16(0x0f0e));
+
+  return _mm256_add_epi16(x, carry);
+}
+
+/* AVX2 implementation of xdelta_kernel_t.skip. */
+static void __attribute__((target("avx2")))
+skip_avx2(apr_size_t *lo,
+          apr_uint32_t *rolling,
+          const struct blocks *blocks,
+          const char *b,
+          apr_size_t upper)
+{
+  const unsigned char *data = (const unsigned char *)b;
+  apr_size_t pos = *lo;
+  apr_uint32_t sum = *rolling;
+
+  while (!is_flagged(blocks, sum) && pos + 16 <= upper)
+    {
+      apr_uint16_t s1[16], s2[16];
+      __m256i out, in, v1, v2;
+      int i;
+
+      out = _mm256_cvtepu8_epi16(_mm_loadu_si128(
+                                   (const __m128i *)(data + pos)));
+      in = _mm256_cvtepu8_epi16(_mm_loadu_si128(
+                                  (const __m128i *)(data + pos
+                                                    + MATCH_BLOCKSIZE)));
+
+      v1 = _mm256_add_epi16(prefix_sum_avx2(_mm256_sub_epi16(in, out)),
+                            _mm256_set1_epi16((short)sum));
+      v2 = _mm256_sub_epi16(v1, _mm256_slli_epi16(out, 6));
+      v2 = _mm256_add_epi16(prefix_sum_avx2(v2),
+                            _mm256_set1_epi16((short)(sum >> 16)));
+      _mm256_storeu_si256((__m256i *)s1, v1);
+      _mm256_storeu_si256((__m256i *)s2, v2);
+
+      for (i = 0; i < 16; i++)
+        if (is_flagged(blocks, lane_checksum(s1, s2, i)))
+          {
+            *lo = pos + i + 1;
+            *rolling = lane_checksum(s1, s2, i);
+            return;
+          }
+
+      pos += 16;
+      sum = lane_checksum(s1, s2, 15);
+    }
+
+  *lo = pos;
+  *rolling = sum;
+  skip_scalar(lo, rolling, blocks, b, upper);
+}
+
+/* AVX2 implementation of xdelta_kernel_t.match_length. */
+static apr_size_t __attribute__((target("avx2")))
+match_length_avx2(const char *a, const char *b, apr_size_t max_len)
+{
+  apr_size_t pos = 0;
+
+  for (; max_len - pos >= 32; pos += 32)
+    {
+      __m256i va = _mm256_loadu_si256((const __m256i *)(a + pos));
+      __m256i vb = _mm256_loadu_si256((const __m256i *)(b + pos));
+      unsigned int mask
+        = ~(unsigned int)_mm256_movemask_epi8(_mm256_cmpeq_epi8(va, vb));
+
+      if (mask)
+        return pos + __builtin_ctz(mask);
+    }
+
+  return pos + match_length_sse41(a + pos, b + pos, max_len - pos);
+}
+
+static const xdelta_kernel_t avx2_kernel =
+  { init_adler32_avx2, skip_avx2, match_length_avx2 };
+
+#endif /* XDELTA_X86_KERNELS */
+
+/* The kernel selected by svn_txdelta__xdelta_set_impl(), if any. */
+static const xdelta_kernel_t *forced_kernel = NULL;
+
+/* Return the kernel for IMPL or NULL if this build or the CPU does not
+   support it. */
+static const xdelta_kernel_t *
+get_kernel(svn_txdelta__xdelta_impl_t impl)
+{
+#ifdef XDELTA_X86_KERNELS
+  __builtin_cpu_init();
+  if (   (impl == svn_txdelta__xdelta_impl_auto
+          || impl == svn_txdelta__xdelta_impl_avx2)
+      && __builtin_cpu_supports("avx2"))
+    return &avx2_kernel;
+  if (   (impl == svn_txdelta__xdelta_impl_auto
+          || impl == svn_txdelta__xdelta_impl_sse41)
+      && __builtin_cpu_supports("sse4.1"))
+    return &sse41_kernel;
+#endif
+
+  if (   impl == svn_txdelta__xdelta_impl_auto
+      || impl == svn_txdelta__xdelta_impl_scalar)
+    return &scalar_kernel;
+
+  return NULL;
+}
+
+/* The best kernel supported by this build and the CPU.  Only valid after
+   init_auto_kernel() has been run through auto_kernel_init_state. */
+static const xdelta_kernel_t *auto_kernel = NULL;
+static volatile svn_atomic_t auto_kernel_init_state = 0;
+
+/* Implements svn_atomic__str_init_func_t.  Detect the CPU features once
+   and select AUTO_KERNEL. */
+static const char *
+init_auto_kernel(void *baton)
+{
+  auto_kernel = get_kernel(svn_txdelta__xdelta_impl_auto);
+  return NULL;
+}
+
+svn_boolean_t
+svn_txdelta__xdelta_set_impl(svn_txdelta__xdelta_impl_t impl)
+{
+  const xdelta_kernel_t *kernel = get_kernel(impl);
+  if (!kernel)
+    return FALSE;
+
+  forced_kernel = impl == svn_txdelta__xdelta_impl_auto ? NULL : kernel;
+  return TRUE;
+}
+
 /* Initialize the matches table from DATA of size DATALEN.  This goes
    through every block of MATCH_BLOCKSIZE bytes in the source and
    checksums it, inserting the result into the BLOCKS table.  */
 static void
-init_blocks_table(const char *data,
+init_blocks_table(const xdelta_kernel_t *kernel,
+                  const char *data,
                   apr_size_t datalen,
                   struct blocks *blocks,
                   apr_pool_t *pool)
@@ -216,6 +622,7 @@ init_blocks_table(const char *data,
   apr_size_t nblocks;
   apr_size_t wnslots = 1;
   apr_uint32_t nslots;
+  apr_uint32_t nflags;
   apr_uint32_t i;
 
   /* Be pessimistic about the block count. */
@@ -247,14 +654,23 @@ init_blocks_table(const char *data,
       blocks->slots[i].pos = NO_POSITION;
     }
 
+  /* Keep the ratio of flags to blocks for large delta windows, i.e. one
+     byte per slot.  For standard-sized windows, this is FLAGS_COUNT. */
+  nflags = nslots * 8;
+  if (nflags < FLAGS_COUNT)
+    nflags = FLAGS_COUNT;
+  if (nflags > MAX_FLAGS_COUNT)
+    nflags = MAX_FLAGS_COUNT;
+
   /* No checksum entries in SLOTS, yet => reset all checksum flags. */
-  memset(blocks->flags, 0, sizeof(blocks->flags));
+  blocks->flags_mask = nflags / 8 - 1;
+  blocks->flags = apr_pcalloc(pool, nflags / 8);
 
   /* If there is an odd block at the end of the buffer, we will
      not use that shorter block for deltification (only indirectly
      as an extension of some previous block). */
   for (i = 0; i + MATCH_BLOCKSIZE <= datalen; i += MATCH_BLOCKSIZE)
-    add_block(blocks, init_adler32(data + i), i);
+    add_block(blocks, kernel->init_adler32(data + i), i);
 }
 
 /* Try to find a match for the target data B in BLOCKS, and then
@@ -262,12 +678,13 @@ init_blocks_table(const char *data,
    continues to match.  We set the position in A we ended up in (in
    case we extended it backwards) in APOSP and update the corresponding
    position within B given in BPOSP. PENDING_INSERT_START sets the
-   lower limit to BPOSP.
+   lower limit to BPOSP.  Use KERNEL to extend the match forward.
    Return number of matching bytes starting at ASOP.  Return 0 if
    no match has been found.
  */
 static apr_size_t
-find_match(const struct blocks *blocks,
+find_match(const xdelta_kernel_t *kernel,
+           const struct blocks *blocks,
            const apr_uint32_t rolling,
            const char *a,
            apr_size_t asize,
@@ -290,9 +707,9 @@ find_match(const struct blocks *blocks,
   max_delta = asize - apos - MATCH_BLOCKSIZE < bsize - bpos - MATCH_BLOCKSIZE
             ? asize - apos - MATCH_BLOCKSIZE
             : bsize - bpos - MATCH_BLOCKSIZE;
-  delta = svn_cstring__match_length(a + apos + MATCH_BLOCKSIZE,
-                                    b + bpos + MATCH_BLOCKSIZE,
-                                    max_delta);
+  delta = kernel->match_length(a + apos + MATCH_BLOCKSIZE,
+                               b + bpos + MATCH_BLOCKSIZE,
+                               max_delta);
 
   /* See if we can extend backwards (max MATCH_BLOCKSIZE-1 steps because A's
      content has been sampled only every MATCH_BLOCKSIZE positions).  */
@@ -366,6 +783,9 @@ store_delta_trailer(svn_txdelta__ops_baton_t *build_baton,
    2. So that we can extend a source match backwards into a pending
      insert operation, and possibly remove the need for the insert
      entirely.  This can happen due to stream alignment.
+
+   The checksum filter loop of step 2 and the forward extension of 2a
+   use vectorized kernels if the CPU supports them.
 */
 static void
 compute_delta(svn_txdelta__ops_baton_t *build_baton,
@@ -375,14 +795,22 @@ compute_delta(svn_txdelta__ops_baton_t *build_baton,
               apr_size_t bsize,
               apr_pool_t *pool)
 {
+  const xdelta_kernel_t *kernel = forced_kernel;
   struct blocks blocks;
   apr_uint32_t rolling;
   apr_size_t lo = 0, pending_insert_start = 0, upper;
 
+  if (!kernel)
+    {
+      svn_atomic__init_once_no_error(&auto_kernel_init_state,
+                                     init_auto_kernel, NULL);
+      kernel = auto_kernel;
+    }
+
   /* Optimization: directly compare window starts. If more than 4
    * bytes match, we can immediately create a matching windows.
    * Shorter sequences result in a net data increase. */
-  lo = svn_cstring__match_length(a, b, asize > bsize ? bsize : asize);
+  lo = kernel->match_length(a, b, asize > bsize ? bsize : asize);
   if ((lo > 4) || (lo == bsize))
     {
       svn_txdelta__insert_op(build_baton, svn_txdelta_source,
@@ -403,10 +831,10 @@ compute_delta(svn_txdelta__ops_baton_t *build_baton,
   upper = bsize - MATCH_BLOCKSIZE; /* this is now known to be >= LO */
 
   /* Initialize the matches table.  */
-  init_blocks_table(a, asize, &blocks, pool);
+  init_blocks_table(kernel, a, asize, &blocks, pool);
 
   /* Initialize our rolling checksum.  */
-  rolling = init_adler32(b + lo);
+  rolling = kernel->init_adler32(b + lo);
   while (lo < upper)
     {
       apr_size_t matchlen;
@@ -414,17 +842,12 @@ compute_delta(svn_txdelta__ops_baton_t *build_baton,
 
       /* Quickly skip positions whose respective ROLLING checksums
          definitely do not match any SLOT in BLOCKS. */
-      while (!(blocks.flags[hash_flags(rolling)] & (1 << (rolling & 7)))
-             && lo < upper)
-        {
-          rolling = adler32_replace(rolling, b[lo], b[lo+MATCH_BLOCKSIZE]);
-          lo++;
-        }
+      kernel->skip(&lo, &rolling, &blocks, b, upper);
 
       /* LO is still <= UPPER, i.e. the following lookup is legal:
          Closely check whether we've got a match for the current location.
          Due to the above pre-filter, chances are that we find one. */
-      matchlen = find_match(&blocks, rolling, a, asize, b, bsize,
+      matchlen = find_match(kernel, &blocks, rolling, a, asize, b, bsize,
                             &lo, &apos, pending_insert_start);
 
       /* If we didn't find a real match, insert the byte at the target
@@ -471,7 +894,7 @@ compute_delta(svn_txdelta__ops_baton_t *build_baton,
            * Ignore short buffers at the end of B.
            */
           if (lo + MATCH_BLOCKSIZE <= bsize)
-            rolling = init_adler32(b + lo);
+            rolling = kernel->init_adler32(b + lo);
         }
     }
 
@@ -58,6 +58,48 @@ svn_fs_hotcopy(const char *src_path, const char *dest_path,
                                          FALSE, NULL, NULL, pool));
 }
 
+/* Baton for pack_notify_wrapper(). */
+typedef struct pack_notify_wrapper_baton_t
+{
+  svn_fs_pack_notify_t notify_func;
+  void *notify_baton;
+} pack_notify_wrapper_baton_t;
+
+/* Implement svn_fs_pack_notify2_t by forwarding to the old-style
+   notification function in the pack_notify_wrapper_baton_t BATON. */
+static svn_error_t *
+pack_notify_wrapper(void *baton,
+                    apr_int64_t shard,
+                    svn_fs_pack_notify_action_t action,
+                    apr_interval_time_t duration,
+                    apr_pool_t *scratch_pool)
+{
+  pack_notify_wrapper_baton_t *pnwb = baton;
+
+  return svn_error_trace(pnwb->notify_func(pnwb->notify_baton, shard,
+                                           action, scratch_pool));
+}
+
+svn_error_t *
+svn_fs_pack(const char *path,
+            svn_fs_pack_notify_t notify_func,
+            void *notify_baton,
+            svn_cancel_func_t cancel_func,
+            void *cancel_baton,
+            apr_pool_t *pool)
+{
+  pack_notify_wrapper_baton_t pnwb;
+
+  pnwb.notify_func = notify_func;
+  pnwb.notify_baton = notify_baton;
+
+  return svn_error_trace(svn_fs_pack2(path, NULL,
+                                      notify_func ? pack_notify_wrapper
+                                                  : NULL,
+                                      notify_func ? &pnwb : NULL,
+                                      cancel_func, cancel_baton, pool));
+}
+
 svn_error_t *
 svn_fs_begin_txn(svn_fs_txn_t **txn_p, svn_fs_t *fs, svn_revnum_t rev,
                  apr_pool_t *pool)
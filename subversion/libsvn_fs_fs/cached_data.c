@@ -24,9 +24,12 @@
 
 #include <assert.h>
 
+#include <apr_thread_proc.h>
+
 #include "svn_hash.h"
 #include "svn_ctype.h"
 #include "svn_sorts.h"
+#include "private/svn_atomic.h"
 #include "private/svn_delta_private.h"
 #include "private/svn_io_private.h"
 #include "private/svn_sorts_private.h"
@@ -744,6 +747,9 @@ typedef struct rep_state_t
   int ver;          /* If a delta, what svndiff version?
                        -1 for unknown delta version. */
   int chunk_index;  /* number of the window to read */
+  const char *prefetched;
+                    /* If not NULL, the SIZE bytes of on-disk data
+                       starting at START, read ahead of time. */
 } rep_state_t;
 
 /* Simple wrapper around svn_io_file_get_offset to simplify callers. */
@@ -799,6 +805,23 @@ auto_set_start_offset(rep_state_t *rs, apr_pool_t *pool)
   return SVN_NO_ERROR;
 }
 
+/* Return an error if the svndiff version RS->VER is not valid for the
+   format of the repository containing RS.  This keeps the large
+   window limits of svndiff version 3 away from older repositories.
+ */
+static svn_error_t *
+check_diff_version(rep_state_t *rs)
+{
+  fs_fs_data_t *ffd = rs->sfile->fs->fsap_data;
+  if (rs->ver >= 3 && ffd->format < SVN_FS_FS__MIN_SVNDIFF3_FORMAT)
+    return svn_error_createf(SVN_ERR_FS_CORRUPT, NULL,
+                             _("Svndiff version %d is not supported by "
+                               "repository format %d"),
+                             rs->ver, ffd->format);
+
+  return SVN_NO_ERROR;
+}
+
 /* Set RS->VER depending on what is found in the already open RS->FILE->FILE
    if the diff version is still unknown.  Use POOL for temporary allocations.
  */
@@ -818,6 +841,7 @@ auto_read_diff_version(rep_state_t *rs, apr_pool_t *pool)
           (SVN_ERR_FS_CORRUPT, NULL,
            _("Malformed svndiff data in representation"));
       rs->ver = buf[3];
+      SVN_ERR(check_diff_version(rs));
 
       rs->chunk_index = 0;
       rs->current = 4;
@@ -1221,6 +1245,10 @@ struct rep_read_baton
      window stream before we continue normal operation. */
   svn_filesize_t fulltext_delivered;
 
+  /* If set, the reconstructed fulltext is expensive enough to be put
+     into the hot fulltext cache once we have read all of it. */
+  svn_boolean_t hot_fulltext;
+
   /* Used for temporary allocations during the read. */
   apr_pool_t *pool;
 
@@ -1533,6 +1561,7 @@ rep_read_get_baton(struct rep_read_baton **rb_p,
   b->filehandle_pool = svn_pool_create(pool);
   b->fulltext_cache = NULL;
   b->fulltext_delivered = 0;
+  b->hot_fulltext = FALSE;
   b->current_fulltext = NULL;
 
   /* Save our output baton. */
@@ -1541,6 +1570,328 @@ rep_read_get_baton(struct rep_read_baton **rb_p,
   return SVN_NO_ERROR;
 }
 
+/* Baton for streams that read from prefetched representation data. */
+typedef struct prefetched_baton_t
+{
+  /* The data and its length. */
+  const char *data;
+  apr_size_t len;
+
+  /* Number of bytes read so far. */
+  apr_size_t pos;
+} prefetched_baton_t;
+
+/* Implements svn_read_fn_t for prefetched_baton_t. */
+static svn_error_t *
+read_prefetched(void *baton,
+                char *buffer,
+                apr_size_t *len)
+{
+  prefetched_baton_t *b = baton;
+  apr_size_t to_copy = MIN(*len, b->len - b->pos);
+
+  memcpy(buffer, b->data + b->pos, to_copy);
+  b->pos += to_copy;
+  *len = to_copy;
+
+  return SVN_NO_ERROR;
+}
+
+/* Parse the svndiff window at the current position in the prefetched
+   data of RS into *NWIN and move RS past it.  Allocate the window in
+   RESULT_POOL and use SCRATCH_POOL for temporary allocations. */
+static svn_error_t *
+parse_prefetched_window(svn_txdelta_window_t **nwin,
+                        rep_state_t *rs,
+                        apr_pool_t *result_pool,
+                        apr_pool_t *scratch_pool)
+{
+  prefetched_baton_t baton;
+  svn_stream_t *stream;
+
+  baton.data = rs->prefetched + rs->current;
+  baton.len = (apr_size_t)(rs->size - rs->current);
+  baton.pos = 0;
+
+  stream = svn_stream_create(&baton, scratch_pool);
+  svn_stream_set_read2(stream, NULL /* only full read support */,
+                       read_prefetched);
+  SVN_ERR(svn_txdelta_read_svndiff_window(nwin, stream, rs->ver,
+                                          result_pool));
+  rs->current += baton.pos;
+
+  return SVN_NO_ERROR;
+}
+
+/* Like read_delta_window but take the data from RS->PREFETCHED. */
+static svn_error_t *
+read_prefetched_window(svn_txdelta_window_t **nwin,
+                       int this_chunk,
+                       rep_state_t *rs,
+                       apr_pool_t *result_pool,
+                       apr_pool_t *scratch_pool)
+{
+  apr_pool_t *iterpool;
+
+  /* Same as auto_read_diff_version. */
+  if (rs->ver == -1)
+    {
+      /* ### Layering violation */
+      if (rs->size < 4 || memcmp(rs->prefetched, "SVN", 3))
+        return svn_error_create
+          (SVN_ERR_FS_CORRUPT, NULL,
+           _("Malformed svndiff data in representation"));
+      rs->ver = rs->prefetched[3];
+      SVN_ERR(check_diff_version(rs));
+
+      rs->chunk_index = 0;
+      rs->current = 4;
+    }
+
+  /* Skip windows to reach the current chunk if we aren't there yet. */
+  iterpool = svn_pool_create(scratch_pool);
+  while (rs->chunk_index < this_chunk)
+    {
+      svn_txdelta_window_t *window;
+
+      svn_pool_clear(iterpool);
+      SVN_ERR(parse_prefetched_window(&window, rs, iterpool, iterpool));
+      rs->chunk_index++;
+      if (rs->current >= rs->size)
+        return svn_error_create(SVN_ERR_FS_CORRUPT, NULL,
+                                _("Reading one svndiff window read "
+                                  "beyond the end of the "
+                                  "representation"));
+    }
+  svn_pool_destroy(iterpool);
+
+  /* Actually read the next window. */
+  SVN_ERR(parse_prefetched_window(nwin, rs, result_pool, scratch_pool));
+
+  /* the window has not been cached before, thus cache it now
+   * (if caching is used for them at all) */
+  if (SVN_IS_VALID_REVNUM(rs->revision))
+    SVN_ERR(set_cached_window(*nwin, rs, scratch_pool));
+
+  return SVN_NO_ERROR;
+}
+
+#if APR_HAS_THREADS
+
+/* Concurrent reading of delta chains.
+ *
+ * Once build_rep_list() has found all representations of a delta chain,
+ * we know exactly which data we will need.  Reading them one after the
+ * other makes the latency add up, which hurts on network storage.  So,
+ * if configured, we read the on-disk data of all representations at once,
+ * using several threads with their own file handles, and attach it to the
+ * respective rep_state_t.  The window combiner then simply parses the
+ * windows from memory.
+ */
+
+/* Maximum amount of representation data we prefetch for a delta chain.
+   Representations that would exceed it are read the usual way. */
+#define PREFETCH_MAX_SIZE (64 * 1024 * 1024)
+
+/* A single representation to prefetch. */
+typedef struct prefetch_job_t
+{
+  /* The rep state that shall receive the data.  Only to be used by the
+     thread that started the prefetch. */
+  rep_state_t *rs;
+
+  /* Read SIZE bytes at OFFSET in the file at PATH into BUFFER. */
+  const char *path;
+  apr_off_t offset;
+  apr_size_t size;
+  char *buffer;
+
+  /* Read error or SVN_NO_ERROR. */
+  svn_error_t *err;
+} prefetch_job_t;
+
+/* All representations to prefetch for a delta chain. */
+typedef struct prefetch_jobs_t
+{
+  prefetch_job_t *jobs;
+  int count;
+
+  /* The next job to hand out. */
+  svn_atomic_t next;
+} prefetch_jobs_t;
+
+/* Execute JOB.  Use SCRATCH_POOL for temporary allocations. */
+static svn_error_t *
+prefetch_read(prefetch_job_t *job,
+              apr_pool_t *scratch_pool)
+{
+  apr_file_t *file;
+  apr_off_t offset = job->offset;
+
+  SVN_ERR(svn_io_file_open(&file, job->path, APR_READ, APR_OS_DEFAULT,
+                           scratch_pool));
+  SVN_ERR(svn_io_file_seek(file, APR_SET, &offset, scratch_pool));
+  SVN_ERR(svn_io_file_read_full2(file, job->buffer, job->size, NULL, NULL,
+                                 scratch_pool));
+
+  return svn_error_trace(svn_io_file_close(file, scratch_pool));
+}
+
+/* Execute jobs from JOBS until there are none left.
+   Use SCRATCH_POOL for temporary allocations. */
+static void
+prefetch_run(prefetch_jobs_t *jobs,
+             apr_pool_t *scratch_pool)
+{
+  apr_pool_t *iterpool = svn_pool_create(scratch_pool);
+
+  while (TRUE)
+    {
+      int n = (int)svn_atomic_inc(&jobs->next);
+      if (n >= jobs->count)
+        break;
+
+      svn_pool_clear(iterpool);
+      jobs->jobs[n].err = prefetch_read(&jobs->jobs[n], iterpool);
+    }
+
+  svn_pool_destroy(iterpool);
+}
+
+/* Worker thread function.  Execute jobs of the prefetch_jobs_t in DATA. */
+static void * APR_THREAD_FUNC
+prefetch_thread(apr_thread_t *thread, void *data)
+{
+  apr_pool_t *thread_root
+    = apr_allocator_owner_get(svn_pool_create_allocator(FALSE));
+
+  prefetch_run(data, thread_root);
+  svn_pool_destroy(thread_root);
+
+  /* End thread explicitly to prevent APR_INCOMPLETE return codes in
+     apr_thread_join(). */
+  apr_thread_exit(thread, APR_SUCCESS);
+  return NULL;
+}
+
+/* Read the on-disk data of all representations in the delta chain of RB,
+   including its plain base, concurrently and attach it to the respective
+   rep states.  Skip representations that are not in a revision file or
+   whose first window is already cached.  Allocate the data in
+   RB->FILEHANDLE_POOL and use SCRATCH_POOL for temporary allocations.
+
+   This is an optimization only and will be a no-op unless prefetching
+   has been enabled in fsfs.conf.  Representations that could not be read
+   will simply be read the usual way later on. */
+static svn_error_t *
+prefetch_rep_list(struct rep_read_baton *rb,
+                  apr_pool_t *scratch_pool)
+{
+  fs_fs_data_t *ffd = rb->fs->fsap_data;
+  apr_array_header_t *states;
+  prefetch_jobs_t jobs = { 0 };
+  apr_thread_t **threads;
+  apr_status_t status;
+  svn_error_t *err = SVN_NO_ERROR;
+  apr_off_t total = 0;
+  int thread_count;
+  int started;
+  int i;
+
+  /* Prefetching has not been enabled? */
+  if (ffd->prefetch_threads < 2)
+    return SVN_NO_ERROR;
+
+  states = apr_array_copy(scratch_pool, rb->rs_list);
+
+  if (rb->src_state && !rb->base_window)
+    APR_ARRAY_PUSH(states, rep_state_t *) = rb->src_state;
+
+  /* Determine what to read. */
+  jobs.jobs = apr_pcalloc(scratch_pool, states->nelts * sizeof(*jobs.jobs));
+  for (i = 0; i < states->nelts; ++i)
+    {
+      rep_state_t *rs = APR_ARRAY_IDX(states, i, rep_state_t *);
+      prefetch_job_t *job;
+
+      if (   !SVN_IS_VALID_REVNUM(rs->revision)
+          || rs->size <= 0
+          || rs->size > PREFETCH_MAX_SIZE - total)
+        continue;
+
+      if (rs->window_cache)
+        {
+          svn_boolean_t is_cached;
+          window_cache_key_t key = { 0 };
+
+          SVN_ERR(svn_cache__has_key(&is_cached, rs->window_cache,
+                                     get_window_key(&key, rs),
+                                     scratch_pool));
+          if (is_cached)
+            continue;
+        }
+
+      SVN_ERR(auto_open_shared_file(rs->sfile));
+      SVN_ERR(auto_set_start_offset(rs, scratch_pool));
+
+      job = &jobs.jobs[jobs.count++];
+      job->rs = rs;
+      job->offset = rs->start;
+      job->size = (apr_size_t)rs->size;
+      SVN_ERR(svn_io_file_name_get(&job->path, rs->sfile->rfile->file,
+                                   scratch_pool));
+
+      total += rs->size;
+    }
+
+  /* Concurrency only pays off for two or more reads. */
+  if (jobs.count < 2)
+    return SVN_NO_ERROR;
+
+  for (i = 0; i < jobs.count; ++i)
+    jobs.jobs[i].buffer = apr_palloc(rb->filehandle_pool,
+                                     jobs.jobs[i].size);
+
+  /* This thread will do its share of the work as well.  If we can't
+     start as many threads as we want, it simply does more of it. */
+  thread_count = MIN(ffd->prefetch_threads, jobs.count) - 1;
+  threads = apr_pcalloc(scratch_pool, thread_count * sizeof(*threads));
+  for (started = 0; started < thread_count; ++started)
+    if (apr_thread_create(&threads[started], NULL, prefetch_thread,
+                          &jobs, scratch_pool))
+      break;
+
+  prefetch_run(&jobs, scratch_pool);
+
+  for (i = 0; i < started; ++i)
+    {
+      apr_status_t thread_status;
+      status = apr_thread_join(&thread_status, threads[i]);
+      if (status)
+        err = svn_error_compose_create(err,
+                svn_error_wrap_apr(status, _("Can't join thread")));
+    }
+
+  /* Hand the data to the rep states.  Read errors will show up again
+     when the data gets read the usual way. */
+  for (i = 0; i < jobs.count; ++i)
+    if (jobs.jobs[i].err)
+      {
+        svn_error_clear(jobs.jobs[i].err);
+      }
+    else if (!err)
+      {
+        jobs.jobs[i].rs->prefetched = jobs.jobs[i].buffer;
+#ifdef SVN_DEBUG
+        svn_atomic_inc(&ffd->prefetched_reps);
+#endif
+      }
+
+  return svn_error_trace(err);
+}
+
+#endif /* APR_HAS_THREADS */
+
 /* Skip forwards to THIS_CHUNK in REP_STATE and then read the next delta
    window into *NWIN.  Note that RS->CHUNK_INDEX will be THIS_CHUNK rather
    than THIS_CHUNK + 1 when this function returns. */
@@ -1565,6 +1916,12 @@ read_delta_window(svn_txdelta_window_t **nwin, int this_chunk,
   if (is_cached)
     return SVN_NO_ERROR;
 
+  /* The data may have been read ahead of time. */
+  if (rs->prefetched)
+    return svn_error_trace(read_prefetched_window(nwin, this_chunk, rs,
+                                                  result_pool,
+                                                  scratch_pool));
+
   /* someone has to actually read the data from file.  Open it */
   SVN_ERR(auto_open_shared_file(rs->sfile));
 
@@ -1641,6 +1998,16 @@ read_plain_window(svn_stringbuf_t **nwin, rep_state_t *rs,
 {
   apr_off_t offset;
 
+  /* Use the data read ahead of time, if available. */
+  if (rs->prefetched && rs->current + (apr_off_t)size <= rs->size)
+    {
+      *nwin = svn_stringbuf_ncreate(rs->prefetched + rs->current, size,
+                                    result_pool);
+      rs->current += (apr_off_t)size;
+
+      return SVN_NO_ERROR;
+    }
+
   /* RS->FILE may be shared between RS instances -> make sure we point
    * to the right data. */
   SVN_ERR(auto_open_shared_file(rs->sfile));
@@ -1785,6 +2152,31 @@ fulltext_size_is_cachable(fs_fs_data_t *ffd, svn_filesize_t size)
       && svn_cache__is_cachable(ffd->fulltext_cache, (apr_size_t)size);
 }
 
+/* Fulltexts whose delta chain length multiplied by their size reaches
+ * this value are candidates for the hot fulltext cache.  E.g. a 256kB
+ * file with 16 deltas.
+ */
+#define HOT_FULLTEXT_MIN_COST (4 * 1024 * 1024)
+
+/* Set RB->HOT_FULLTEXT if the fulltext of the representation in RB
+ * should go into the hot fulltext cache, i.e. if there is such a cache
+ * and the fulltext is large and reconstructing it requires many deltas
+ * to be combined.  RB->RS_LIST must already have been built.
+ */
+static void
+select_hot_fulltext(struct rep_read_baton *rb)
+{
+  fs_fs_data_t *ffd = rb->fs->fsap_data;
+  apr_int64_t chain_length = rb->rs_list->nelts + 1;
+
+  rb->hot_fulltext
+    =    ffd->hot_fulltext_cache
+      && SVN_IS_VALID_REVNUM(rb->rep.revision)
+      && rb->len < APR_SIZE_MAX
+      && svn_cache__is_cachable(ffd->hot_fulltext_cache, (apr_size_t)rb->len)
+      && chain_length * rb->len >= HOT_FULLTEXT_MIN_COST;
+}
+
 /* Close method used on streams returned by read_representation().
  */
 static svn_error_t *
@@ -1829,6 +2221,13 @@ get_contents_from_windows(struct rep_read_baton *rb,
 
           memcpy (cur, rb->base_window->data + offset, copy_len);
         }
+      else if (rs->prefetched)
+        {
+          if (((apr_off_t) copy_len) > rs->size - rs->current)
+            copy_len = (apr_size_t) (rs->size - rs->current);
+
+          memcpy(cur, rs->prefetched + rs->current, copy_len);
+        }
       else
         {
           apr_off_t offset;
@@ -2032,7 +2431,8 @@ skip_contents(struct rep_read_baton *baton,
   svn_error_t *err = SVN_NO_ERROR;
 
   /* Do we want to cache the reconstructed fulltext? */
-  if (SVN_IS_VALID_REVNUM(baton->fulltext_cache_key.revision))
+  if (   SVN_IS_VALID_REVNUM(baton->fulltext_cache_key.revision)
+      || baton->hot_fulltext)
     {
       char *buffer;
       svn_filesize_t to_alloc = MAX(len, baton->len);
@@ -2134,6 +2534,14 @@ rep_read_contents(void *baton,
                              &rb->src_state, rb->fs, &rb->rep,
                              rb->filehandle_pool));
 
+#if APR_HAS_THREADS
+      /* Now that we know the whole chain, fetch its data concurrently. */
+      SVN_ERR(prefetch_rep_list(rb, rb->pool));
+#endif
+
+      /* Keep the result if it was expensive to get. */
+      select_hot_fulltext(rb);
+
       /* In case we did read from the fulltext cache before, make the
        * window stream catch up.  Also, initialize the fulltext buffer
        * if we want to cache the fulltext at the end. */
@@ -2202,8 +2610,20 @@ rep_read_contents(void *baton,
   if (rb->off == rb->len && rb->current_fulltext)
     {
       fs_fs_data_t *ffd = rb->fs->fsap_data;
-      SVN_ERR(svn_cache__set(ffd->fulltext_cache, &rb->fulltext_cache_key,
-                             rb->current_fulltext, rb->pool));
+      if (SVN_IS_VALID_REVNUM(rb->fulltext_cache_key.revision))
+        SVN_ERR(svn_cache__set(ffd->fulltext_cache, &rb->fulltext_cache_key,
+                               rb->current_fulltext, rb->pool));
+
+      if (rb->hot_fulltext)
+        {
+          pair_cache_key_t key;
+          key.revision = rb->rep.revision;
+          key.second = rb->rep.item_index;
+
+          SVN_ERR(svn_cache__set(ffd->hot_fulltext_cache, &key,
+                                 rb->current_fulltext, rb->pool));
+        }
+
       rb->current_fulltext = NULL;
     }
 
@@ -2230,6 +2650,22 @@ svn_fs_fs__get_contents(svn_stream_t **contents_p,
       fulltext_cache_key.revision = rep->revision;
       fulltext_cache_key.second = rep->item_index;
 
+      /* Expensive fulltexts may be available in compressed form. */
+      if (ffd->hot_fulltext_cache && SVN_IS_VALID_REVNUM(rep->revision))
+        {
+          svn_stringbuf_t *fulltext;
+          svn_boolean_t found;
+
+          SVN_ERR(svn_cache__get((void **)&fulltext, &found,
+                                 ffd->hot_fulltext_cache,
+                                 &fulltext_cache_key, pool));
+          if (found)
+            {
+              *contents_p = svn_stream_from_stringbuf(fulltext, pool);
+              return SVN_NO_ERROR;
+            }
+        }
+
       /* Initialize the reader baton.  Some members may added lazily
        * while reading from the stream */
       SVN_ERR(rep_read_get_baton(&rb, fs, rep, fulltext_cache_key, pool));
@@ -2472,6 +2908,33 @@ get_storaged_delta_stream(rep_state_t *rep_state,
                                    delta_read_md5_digest, pool);
 }
 
+/* Set *LARGE_WINDOWS to TRUE, if the representation read by RS uses
+   svndiff version 3 or higher, i.e. may contain delta windows that are
+   larger than what the older svndiff versions support.  Use FS to find
+   out whether the repository format allows for such reps at all.
+   Use POOL for temporary allocations. */
+static svn_error_t *
+uses_large_windows(svn_boolean_t *large_windows,
+                   svn_fs_t *fs,
+                   rep_state_t *rs,
+                   apr_pool_t *pool)
+{
+  fs_fs_data_t *ffd = fs->fsap_data;
+  if (ffd->format < SVN_FS_FS__MIN_SVNDIFF3_FORMAT)
+    {
+      *large_windows = FALSE;
+      return SVN_NO_ERROR;
+    }
+
+  SVN_ERR(auto_open_shared_file(rs->sfile));
+  SVN_ERR(auto_set_start_offset(rs, pool));
+  SVN_ERR(auto_read_diff_version(rs, pool));
+
+  *large_windows = rs->ver >= 3;
+
+  return SVN_NO_ERROR;
+}
+
 svn_error_t *
 svn_fs_fs__get_file_delta_stream(svn_txdelta_stream_t **stream_p,
                                  svn_fs_t *fs,
@@ -2489,11 +2952,26 @@ svn_fs_fs__get_file_delta_stream(svn_txdelta_stream_t **stream_p,
      whenever that is available. */
   if (target->data_rep && (source || ! ffd->fulltext_cache))
     {
+      svn_boolean_t large_windows;
+
       /* Read target's base rep if any. */
       SVN_ERR(create_rep_state(&rep_state, &rep_header, NULL,
                                 target->data_rep, fs, pool, pool));
 
-      if (source && source->data_rep && target->data_rep)
+      /* Our callers may forward the delta to clients using older svndiff
+         versions, which cannot represent large windows.  Don't pass them
+         on as they are but construct a new delta with standard windows
+         from the fulltexts. */
+      if (rep_header->type == svn_fs_fs__rep_plain)
+        large_windows = FALSE;
+      else
+        SVN_ERR(uses_large_windows(&large_windows, fs, rep_state, pool));
+
+      if (large_windows)
+        {
+          /* Fall through to the fulltext-based code below. */
+        }
+      else if (source && source->data_rep && target->data_rep)
         {
           /* If that matches source, then use this delta as is.
              Note that we want an actual delta here.  E.g. a self-delta would
@@ -3333,7 +3811,7 @@ cache_windows(svn_fs_t *fs,
           SVN_ERR(rs_aligned_seek(rs, NULL, start_offset, iterpool));
           SVN_ERR(svn_txdelta__read_raw_window_len(&window_len,
                                                    rs->sfile->rfile->stream,
-                                                   iterpool));
+                                                   rs->ver, iterpool));
 
           /* Read the raw window. */
           buf = apr_palloc(iterpool, window_len + 1);
@@ -31,6 +31,9 @@
 
 #include "svn_config.h"
 #include "svn_cache_config.h"
+#include "svn_dirent_uri.h"
+#include "svn_io.h"
+#include "svn_version.h"
 
 #include "svn_private_config.h"
 #include "svn_hash.h"
@@ -127,6 +130,20 @@ read_config(const char **cache_namespace,
   return SVN_NO_ERROR;
 }
 
+/* Return the key prefix to use for all caches in FS with the given
+   CACHE_NAMESPACE.  Allocate the result in POOL. */
+static const char *
+cache_prefix(svn_fs_t *fs,
+             const char *cache_namespace,
+             apr_pool_t *pool)
+{
+  return apr_pstrcat(pool,
+                     "ns:", cache_namespace, ":",
+                     "fsfs:", fs->uuid,
+                     "/", normalize_key_part(fs->path, pool),
+                     ":",
+                     SVN_VA_NULL);
+}
 
 /* Implements svn_cache__error_handler_t
  * This variant clears the error after logging it.
@@ -351,11 +368,7 @@ svn_fs_fs__initialize_caches(svn_fs_t *fs,
                              apr_pool_t *pool)
 {
   fs_fs_data_t *ffd = fs->fsap_data;
-  const char *prefix = apr_pstrcat(pool,
-                                   "fsfs:", fs->uuid,
-                                   "/", normalize_key_part(fs->path, pool),
-                                   ":",
-                                   SVN_VA_NULL);
+  const char *prefix;
   svn_membuffer_t *membuffer;
   svn_boolean_t no_handler = ffd->fail_stop;
   svn_boolean_t cache_txdeltas;
@@ -372,7 +385,7 @@ svn_fs_fs__initialize_caches(svn_fs_t *fs,
                       fs,
                       pool));
 
-  prefix = apr_pstrcat(pool, "ns:", cache_namespace, ":", prefix, SVN_VA_NULL);
+  prefix = cache_prefix(fs, cache_namespace, pool);
   has_namespace = strlen(cache_namespace) > 0;
 
   membuffer = svn_cache__get_global_membuffer_cache();
@@ -727,6 +740,54 @@ svn_fs_fs__initialize_caches(svn_fs_t *fs,
   return SVN_NO_ERROR;
 }
 
+svn_error_t *
+svn_fs_fs__initialize_shared_caches(svn_fs_t *fs,
+                                    apr_pool_t *scratch_pool)
+{
+  fs_fs_data_t *ffd = fs->fsap_data;
+  const char *cache_namespace;
+  svn_boolean_t cache_txdeltas;
+  svn_boolean_t cache_fulltexts;
+  svn_boolean_t cache_nodeprops;
+
+  SVN_ERR(read_config(&cache_namespace,
+                      &cache_txdeltas,
+                      &cache_fulltexts,
+                      &cache_nodeprops,
+                      fs,
+                      scratch_pool));
+
+  /* The compressed tier is an addition to the normal fulltext cache and
+   * follows the same configuration.  Since all users of the store access
+   * the same repository, our usual prefix is sufficient to tell them
+   * apart. */
+  if (cache_fulltexts && ffd->shared->hot_fulltext_store)
+    {
+      SVN_ERR(svn_cache__create_compressed(
+                &ffd->hot_fulltext_cache,
+                ffd->shared->hot_fulltext_store,
+                /* Values are svn_stringbuf_t */
+                NULL, NULL,
+                sizeof(pair_cache_key_t),
+                apr_pstrcat(scratch_pool,
+                            cache_prefix(fs, cache_namespace, scratch_pool),
+                            "HOT_TEXT", SVN_VA_NULL),
+                fs->pool));
+
+      SVN_ERR(init_callbacks(ffd->hot_fulltext_cache, fs,
+                             ffd->fail_stop
+                               ? NULL
+                               : warn_and_fail_on_cache_errors,
+                             fs->pool));
+    }
+  else
+    {
+      ffd->hot_fulltext_cache = NULL;
+    }
+
+  return SVN_NO_ERROR;
+}
+
 /* Baton to be used for the remove_txn_cache() pool cleanup function, */
 struct txn_cleanup_baton_t
 {
@@ -897,3 +958,307 @@ svn_fs_fs__reset_txn_caches(svn_fs_t *fs)
   fs_fs_data_t *ffd = fs->fsap_data;
   ffd->txn_dir_cache = NULL;
 }
+
+
+/* Cache snapshots. */
+
+/* First line of FSFS cache snapshot files.  The cached data uses native,
+ * version-specific serialization formats.  So, only accept snapshots from
+ * the very same Subversion version and pointer size.
+ */
+#define SNAPSHOT_HEADER "fsfs-cache-snapshot " SVN_VER_NUMBER " %d"
+
+/* The state of a repository as far as the cache snapshots are concerned.
+ */
+typedef struct snapshot_repos_t
+{
+  /* Repository UUID and instance ID.  NULL if there is no readable
+   * FSFS repository at the respective path. */
+  const char *uuid;
+  const char *instance_id;
+
+  /* Youngest revision in that repository. */
+  svn_revnum_t youngest;
+} snapshot_repos_t;
+
+/* Baton type used with snapshot_tag() and snapshot_accept().
+ */
+typedef struct snapshot_baton_t
+{
+  /* Map repository path (const char *) to snapshot_repos_t *. */
+  apr_hash_t *repos;
+
+  /* Pool to allocate REPOS and its contents in. */
+  apr_pool_t *pool;
+} snapshot_baton_t;
+
+/* Return the snapshot file header as expected by the current build.
+ * Allocate it in RESULT_POOL.
+ */
+static const char *
+snapshot_header(apr_pool_t *result_pool)
+{
+  return apr_psprintf(result_pool, SNAPSHOT_HEADER,
+                      (int)sizeof(void *));
+}
+
+/* Undo normalize_key_part() for the LEN bytes of the NORMALIZED key part.
+ * Allocate the result in RESULT_POOL.
+ */
+static const char *
+denormalize_key_part(const char *normalized,
+                     apr_size_t len,
+                     apr_pool_t *result_pool)
+{
+  apr_size_t i;
+  svn_stringbuf_t *original = svn_stringbuf_create_ensure(len,
+                                                           result_pool);
+
+  for (i = 0; i < len; ++i)
+    {
+      char c = normalized[i];
+      if (c == '%' && i + 1 < len)
+        c = normalized[++i] == '_' ? ':' : '%';
+
+      svn_stringbuf_appendbyte(original, c);
+    }
+
+  return original->data;
+}
+
+/* If PREFIX is a cache key prefix created by svn_fs_fs__initialize_caches
+ * without a namespace, return TRUE and set *UUID and *PATH to the values
+ * of the respective svn_fs_t members.  Return FALSE otherwise.  Allocate
+ * the results in RESULT_POOL.
+ *
+ * Caches with namespaces and transaction-specific caches are expected to
+ * be short-lived and thus never make it into a snapshot.
+ */
+static svn_boolean_t
+parse_cache_prefix(const char **uuid,
+                   const char **path,
+                   const char *prefix,
+                   apr_pool_t *result_pool)
+{
+  static const char expected_start[] = "ns::fsfs:";
+  const char *uuid_end;
+  const char *path_end;
+
+  if (strncmp(prefix, expected_start, sizeof(expected_start) - 1))
+    return FALSE;
+
+  prefix += sizeof(expected_start) - 1;
+  uuid_end = strchr(prefix, '/');
+  if (uuid_end == NULL)
+    return FALSE;
+
+  path_end = strchr(uuid_end + 1, ':');
+  if (path_end == NULL)
+    return FALSE;
+
+  *uuid = apr_pstrmemdup(result_pool, prefix, uuid_end - prefix);
+  *path = denormalize_key_part(uuid_end + 1, path_end - uuid_end - 1,
+                               result_pool);
+
+  return TRUE;
+}
+
+/* Read the current state of the repository at PATH into *REPOS.
+ * Allocate the data in RESULT_POOL.
+ */
+static svn_error_t *
+read_snapshot_repos(snapshot_repos_t *repos,
+                    const char *path,
+                    apr_pool_t *result_pool)
+{
+  svn_stringbuf_t *content;
+  apr_array_header_t *lines;
+
+  /* Instance IDs, if supported by the format, are on the second line. */
+  SVN_ERR(svn_stringbuf_from_file2(&content,
+                                   svn_dirent_join(path, PATH_UUID,
+                                                   result_pool),
+                                   result_pool));
+  lines = svn_cstring_split(content->data, "\n", TRUE, result_pool);
+  if (lines->nelts == 0)
+    return svn_error_createf(SVN_ERR_FS_CORRUPT, NULL,
+                             _("Can't read UUID of repository '%s'"),
+                             svn_dirent_local_style(path, result_pool));
+
+  repos->uuid = APR_ARRAY_IDX(lines, 0, const char *);
+  repos->instance_id = lines->nelts > 1
+                     ? APR_ARRAY_IDX(lines, 1, const char *)
+                     : repos->uuid;
+
+  SVN_ERR(svn_stringbuf_from_file2(&content,
+                                   svn_dirent_join(path, PATH_CURRENT,
+                                                   result_pool),
+                                   result_pool));
+  SVN_ERR(svn_revnum_parse(&repos->youngest, content->data, NULL));
+
+  return SVN_NO_ERROR;
+}
+
+/* Return the current state of the repository at PATH as cached in BATON.
+ */
+static snapshot_repos_t *
+get_snapshot_repos(snapshot_baton_t *baton,
+                   const char *path)
+{
+  snapshot_repos_t *repos = svn_hash_gets(baton->repos, path);
+  if (repos == NULL)
+    {
+      svn_error_t *err;
+
+      repos = apr_pcalloc(baton->pool, sizeof(*repos));
+      err = read_snapshot_repos(repos, path, baton->pool);
+
+      /* Repositories that went away or are otherwise inaccessible
+       * simply don't get their cached data saved or loaded. */
+      if (err)
+        {
+          svn_error_clear(err);
+          repos->uuid = NULL;
+        }
+
+      svn_hash_sets(baton->repos, apr_pstrdup(baton->pool, path), repos);
+    }
+
+  return repos;
+}
+
+/* Implements svn_cache__snapshot_tag_func_t.
+ * Tag all entries that belong to existing FSFS repositories with the
+ * repository's instance ID and current youngest revision.
+ */
+static svn_error_t *
+snapshot_tag(const char **tag,
+             void *baton,
+             const char *prefix,
+             apr_pool_t *result_pool)
+{
+  const char *uuid;
+  const char *path;
+  snapshot_repos_t *repos;
+
+  *tag = NULL;
+  if (!parse_cache_prefix(&uuid, &path, prefix, result_pool))
+    return SVN_NO_ERROR;
+
+  repos = get_snapshot_repos(baton, path);
+  if (repos->uuid && strcmp(repos->uuid, uuid) == 0)
+    *tag = apr_psprintf(result_pool, "%ld %s", repos->youngest,
+                        repos->instance_id);
+
+  return SVN_NO_ERROR;
+}
+
+/* Implements svn_cache__snapshot_accept_func_t.
+ * Accept the entries tagged by snapshot_tag() if the repository has
+ * not been replaced and not been rolled back since.
+ */
+static svn_error_t *
+snapshot_accept(svn_boolean_t *accept,
+                void *baton,
+                const char *prefix,
+                const char *tag,
+                apr_pool_t *scratch_pool)
+{
+  const char *uuid;
+  const char *path;
+  const char *instance_id;
+  svn_revnum_t youngest;
+  snapshot_repos_t *repos;
+  svn_error_t *err;
+
+  *accept = FALSE;
+  if (!parse_cache_prefix(&uuid, &path, prefix, scratch_pool))
+    return SVN_NO_ERROR;
+
+  err = svn_revnum_parse(&youngest, tag, &instance_id);
+  if (err || *instance_id != ' ')
+    {
+      svn_error_clear(err);
+      return SVN_NO_ERROR;
+    }
+
+  repos = get_snapshot_repos(baton, path);
+  *accept = repos->uuid
+         && strcmp(repos->uuid, uuid) == 0
+         && strcmp(repos->instance_id, instance_id + 1) == 0
+         && repos->youngest >= youngest;
+
+  return SVN_NO_ERROR;
+}
+
+svn_error_t *
+svn_fs_fs__save_cache_snapshot(const char *path,
+                               apr_pool_t *scratch_pool)
+{
+  svn_membuffer_t *membuffer = svn_cache__get_global_membuffer_cache();
+  snapshot_baton_t baton;
+  svn_stream_t *stream;
+  const char *tmp_path;
+  svn_error_t *err;
+
+  if (membuffer == NULL)
+    return SVN_NO_ERROR;
+
+  baton.repos = svn_hash__make(scratch_pool);
+  baton.pool = scratch_pool;
+
+  /* Write to a temporary file first such that neither concurrent nor
+   * interrupted writers leave a broken snapshot behind. */
+  SVN_ERR(svn_stream_open_unique(&stream, &tmp_path,
+                                 svn_dirent_dirname(path, scratch_pool),
+                                 svn_io_file_del_none,
+                                 scratch_pool, scratch_pool));
+
+  err = svn_stream_printf(stream, scratch_pool, "%s\n",
+                          snapshot_header(scratch_pool));
+  if (!err)
+    err = svn_cache__membuffer_save(membuffer, stream, snapshot_tag,
+                                    &baton, scratch_pool);
+
+  err = svn_error_compose_create(err, svn_stream_close(stream));
+  if (err)
+    return svn_error_compose_create(err,
+                                    svn_io_remove_file2(tmp_path, TRUE,
+                                                        scratch_pool));
+
+  return svn_error_trace(svn_io_file_rename2(tmp_path, path, FALSE,
+                                             scratch_pool));
+}
+
+svn_error_t *
+svn_fs_fs__load_cache_snapshot(const char *path,
+                               apr_pool_t *scratch_pool)
+{
+  svn_membuffer_t *membuffer = svn_cache__get_global_membuffer_cache();
+  snapshot_baton_t baton;
+  svn_stream_t *stream;
+  svn_stringbuf_t *header;
+  svn_boolean_t eof;
+  svn_error_t *err;
+
+  if (membuffer == NULL)
+    return SVN_NO_ERROR;
+
+  err = svn_stream_open_readonly(&stream, path, scratch_pool, scratch_pool);
+  if (err && APR_STATUS_IS_ENOENT(err->apr_err))
+    {
+      svn_error_clear(err);
+      return SVN_NO_ERROR;
+    }
+  SVN_ERR(err);
+
+  baton.repos = svn_hash__make(scratch_pool);
+  baton.pool = scratch_pool;
+
+  SVN_ERR(svn_stream_readline(stream, &header, "\n", &eof, scratch_pool));
+  if (!eof && strcmp(header->data, snapshot_header(scratch_pool)) == 0)
+    SVN_ERR(svn_cache__membuffer_load(membuffer, stream, snapshot_accept,
+                                      &baton, scratch_pool));
+
+  return svn_error_trace(svn_stream_close(stream));
+}
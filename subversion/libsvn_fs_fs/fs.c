@@ -130,8 +130,18 @@ fs_serialized_init(svn_fs_t *fs, apr_pool_t *common_pool, apr_pool_t *pool)
         return svn_error_wrap_apr(status, _("Can't store FSFS shared data"));
     }
 
+  /* The compressed fulltext store is optional and may be enabled by any
+     later open of the same repository. */
+  if (!ffsd->hot_fulltext_store && ffd->hot_fulltext_cache_size)
+    SVN_ERR(svn_cache__compressed_store_create(
+                  &ffsd->hot_fulltext_store,
+                  (apr_size_t)ffd->hot_fulltext_cache_size,
+                  TRUE, common_pool));
+
   ffd->shared = ffsd;
 
+  SVN_ERR(svn_fs_fs__initialize_shared_caches(fs, pool));
+
   return SVN_NO_ERROR;
 }
 
@@ -444,6 +454,35 @@ fs_open(svn_fs_t *fs,
   return SVN_NO_ERROR;
 }
 
+svn_error_t *
+svn_fs_fs__open_instance(svn_fs_t **instance,
+                         svn_fs_t *fs,
+                         apr_pool_t *result_pool,
+                         apr_pool_t *scratch_pool)
+{
+  fs_fs_data_t *ffd = fs->fsap_data;
+  fs_fs_data_t *instance_ffd;
+  svn_fs_t *result = apr_pmemdup(result_pool, fs, sizeof(*fs));
+
+  result->pool = result_pool;
+  result->access_ctx = NULL;
+  result->uuid = NULL;
+
+  SVN_ERR(initialize_fs_struct(result));
+  SVN_ERR(svn_fs_fs__open(result, fs->path, scratch_pool));
+  SVN_ERR(svn_fs_fs__initialize_caches(result, scratch_pool));
+
+  /* It is the same repository, so simply share the process-wide data. */
+  instance_ffd = result->fsap_data;
+  instance_ffd->shared = ffd->shared;
+  instance_ffd->svn_fs_open_ = ffd->svn_fs_open_;
+  SVN_ERR(svn_fs_fs__initialize_shared_caches(result, scratch_pool));
+
+  *instance = result;
+
+  return SVN_NO_ERROR;
+}
+
 
 
 /* This implements the fs_library_vtable_t.open_for_recovery() API. */
@@ -545,7 +584,7 @@ fs_verify(svn_fs_t *fs, const char *path,
 static svn_error_t *
 fs_pack(svn_fs_t *fs,
         const char *path,
-        svn_fs_pack_notify_t notify_func,
+        svn_fs_pack_notify2_t notify_func,
         void *notify_baton,
         svn_cancel_func_t cancel_func,
         void *cancel_baton,
@@ -663,6 +702,41 @@ fs_info_dup(const void *fsfs_info_void,
   return apr_pmemdup(result_pool, fsfs_info, sizeof(*fsfs_info));
 }
 
+/* This implements the fs_library_vtable_t.ioctl() API, i.e. ioctls
+   that don't require an open filesystem. */
+static svn_error_t *
+fs_library_ioctl(svn_fs_ioctl_code_t ctlcode,
+                 void *input_void, void **output_p,
+                 svn_cancel_func_t cancel_func,
+                 void *cancel_baton,
+                 apr_pool_t *result_pool,
+                 apr_pool_t *scratch_pool)
+{
+  if (strcmp(ctlcode.fs_type, SVN_FS_TYPE_FSFS) == 0)
+    {
+      if (ctlcode.code == SVN_FS_FS__IOCTL_SAVE_CACHE_SNAPSHOT.code)
+        {
+          svn_fs_fs__ioctl_cache_snapshot_input_t *input = input_void;
+
+          SVN_ERR(svn_fs_fs__save_cache_snapshot(input->path,
+                                                 scratch_pool));
+          *output_p = NULL;
+          return SVN_NO_ERROR;
+        }
+      else if (ctlcode.code == SVN_FS_FS__IOCTL_LOAD_CACHE_SNAPSHOT.code)
+        {
+          svn_fs_fs__ioctl_cache_snapshot_input_t *input = input_void;
+
+          SVN_ERR(svn_fs_fs__load_cache_snapshot(input->path,
+                                                 scratch_pool));
+          *output_p = NULL;
+          return SVN_NO_ERROR;
+        }
+    }
+
+  return svn_error_create(SVN_ERR_FS_UNRECOGNIZED_IOCTL_CODE, NULL, NULL);
+}
+
 
 /* Base FS library vtable, used by the FS loader library. */
 
@@ -682,7 +756,7 @@ static fs_library_vtable_t library_vtable = {
   NULL /* parse_id */,
   fs_set_svn_fs_open,
   fs_info_dup,
-  NULL /* ioctl */
+  fs_library_ioctl
 };
 
 svn_error_t *
@@ -100,6 +100,7 @@ extern "C" {
 /* Names of sections and options in fsfs.conf. */
 #define CONFIG_SECTION_CACHES            "caches"
 #define CONFIG_OPTION_FAIL_STOP          "fail-stop"
+#define CONFIG_OPTION_HOT_FULLTEXT_CACHE_SIZE "hot-fulltext-cache-size"
 #define CONFIG_SECTION_REP_SHARING       "rep-sharing"
 #define CONFIG_OPTION_ENABLE_REP_SHARING "enable-rep-sharing"
 #define CONFIG_SECTION_DELTIFICATION     "deltification"
@@ -115,10 +116,12 @@ extern "C" {
 #define CONFIG_OPTION_BLOCK_SIZE         "block-size"
 #define CONFIG_OPTION_L2P_PAGE_SIZE      "l2p-page-size"
 #define CONFIG_OPTION_P2L_PAGE_SIZE      "p2l-page-size"
+#define CONFIG_OPTION_PREFETCH_THREADS   "prefetch-threads"
 #define CONFIG_SECTION_DEBUG             "debug"
 #define CONFIG_OPTION_PACK_AFTER_COMMIT  "pack-after-commit"
 #define CONFIG_OPTION_VERIFY_BEFORE_COMMIT "verify-before-commit"
 #define CONFIG_OPTION_COMPRESSION        "compression"
+#define CONFIG_OPTION_LARGE_DELTA_WINDOWS "large-delta-windows"
 
 /* The format number of this filesystem.
    This is independent of the repository format number, and
@@ -127,7 +130,13 @@ extern "C" {
    Note: If you bump this, please update the switch statement in
          svn_fs_fs__create() as well.
  */
-#define SVN_FS_FS__FORMAT_NUMBER   8
+#define SVN_FS_FS__FORMAT_NUMBER   9
+
+/* The format number of new filesystems, unless a newer compatible version
+   or a feature that requires a newer format is asked for.  Format 9 only
+   adds the opt-in large delta windows, so creating it by default would
+   lock out older servers for no benefit. */
+#define SVN_FS_FS__DEFAULT_FORMAT_NUMBER 8
 
 /* The minimum format number that supports svndiff version 1.  */
 #define SVN_FS_FS__MIN_SVNDIFF1_FORMAT 2
@@ -200,6 +209,10 @@ extern "C" {
     database. */
 #define SVN_FS_FS__MIN_REP_CACHE_SCHEMA_V2_FORMAT 8
 
+/* The minimum format number that supports svndiff version 3, i.e. large
+   delta windows. */
+#define SVN_FS_FS__MIN_SVNDIFF3_FORMAT 9
+
 /* On most operating systems apr implements file locks per process, not
    per file.  On Windows apr implements the locking as per file handle
    locks, so we don't have to add our own mutex for just in-process
@@ -275,6 +288,11 @@ typedef struct fs_fs_shared_data_t
      txn-current file. */
   svn_mutex__t *txn_current_lock;
 
+  /* Compressed fulltexts of representations that are expensive to
+     reconstruct, or NULL if that cache has been disabled.  Shared by
+     all svn_fs_t instances for this repository. */
+  svn_cache__compressed_store_t *hot_fulltext_store;
+
   /* The common pool, under which this object is allocated, subpools
      of which are used to allocate the transaction objects. */
   apr_pool_t *common_pool;
@@ -347,6 +365,16 @@ typedef struct fs_fs_data_t
    * (not just the one bit that we need, atm). */
   svn_boolean_t use_block_read;
 
+  /* Maximum number of representations in a delta chain to read
+   * concurrently.  0 or 1 means that they get read one by one. */
+  int prefetch_threads;
+
+#ifdef SVN_DEBUG
+  /* Number of representations whose data got prefetched so far.  The
+   * test suite uses this to verify that prefetching actually happens. */
+  svn_atomic_t prefetched_reps;
+#endif
+
   /* The revision that was youngest, last time we checked. */
   svn_revnum_t youngest_rev_cache;
 
@@ -360,6 +388,10 @@ typedef struct fs_fs_data_t
      e.g. memcached may be ignored as caching is an optional feature. */
   svn_boolean_t fail_stop;
 
+  /* Size of the HOT_FULLTEXT_STORE in the shared data, in bytes.
+     0 disables that cache. */
+  apr_uint64_t hot_fulltext_cache_size;
+
   /* A cache of revision root IDs, mapping from (svn_revnum_t *) to
      (svn_fs_id_t *).  (Not threadsafe.) */
   svn_cache__t *rev_root_id_cache;
@@ -380,6 +412,11 @@ typedef struct fs_fs_data_t
      rep key (revision/offset) to svn_stringbuf_t. */
   svn_cache__t *fulltext_cache;
 
+  /* Compressed fulltext cache for representations with a high
+     reconstruction cost.  Maps from rep key (revision/offset) to
+     svn_stringbuf_t.  Backed by the HOT_FULLTEXT_STORE in SHARED. */
+  svn_cache__t *hot_fulltext_cache;
+
   /* The current prefix to be used for revprop cache entries.
      If this is 0, a new unique prefix must be chosen. */
   apr_uint64_t revprop_prefix;
@@ -499,6 +536,10 @@ typedef struct fs_fs_data_t
   /* Compression level (currently, only used with compression_type_zlib). */
   int delta_compression_level;
 
+  /* Whether to use large delta windows, i.e. svndiff version 3,
+     in new revs. */
+  svn_boolean_t large_delta_windows;
+
   /* Pack after every commit. */
   svn_boolean_t pack_after_commit;
 
@@ -514,6 +555,9 @@ typedef struct fs_fs_data_t
   /* Ensure that all filesystem changes are written to disk. */
   svn_boolean_t flush_to_disk;
 
+  /* Maximum number of shards to pack concurrently. */
+  int pack_jobs;
+
   /* Pointer to svn_fs_open. */
   svn_error_t *(*svn_fs_open_)(svn_fs_t **, const char *, apr_hash_t *,
                                apr_pool_t *, apr_pool_t *);
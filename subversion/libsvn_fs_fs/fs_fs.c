@@ -849,6 +849,25 @@ read_config(fs_fs_data_t *ffd,
       ffd->p2l_page_size = 0x100000;  /* Matches above default in bytes. */
     }
 
+  /* Reading delta chains concurrently works with any format. */
+  {
+    apr_int64_t prefetch_threads;
+    SVN_ERR(svn_config_get_int64(config, &prefetch_threads,
+                                 CONFIG_SECTION_IO,
+                                 CONFIG_OPTION_PREFETCH_THREADS,
+                                 0));
+    if (prefetch_threads < 0 || prefetch_threads > 64)
+      return svn_error_createf(SVN_ERR_BAD_CONFIG_VALUE, NULL,
+                               _("%s is out of range for fsfs.conf "
+                                 "setting '%s'."),
+                               apr_psprintf(scratch_pool,
+                                            "%" APR_INT64_T_FMT,
+                                            prefetch_threads),
+                               CONFIG_OPTION_PREFETCH_THREADS);
+
+    ffd->prefetch_threads = (int)prefetch_threads;
+  }
+
   if (ffd->format >= SVN_FS_FS__MIN_PACKED_FORMAT)
     {
       SVN_ERR(svn_config_get_bool(config, &ffd->pack_after_commit,
@@ -926,6 +945,37 @@ read_config(fs_fs_data_t *ffd,
       ffd->delta_compression_level = SVN_DELTA_COMPRESSION_LEVEL_NONE;
     }
 
+  /* Large delta windows use svndiff version 3, which only supports
+   * zlib compression. */
+  if (ffd->format >= SVN_FS_FS__MIN_SVNDIFF3_FORMAT)
+    {
+      const char *compression_val;
+
+      SVN_ERR(svn_config_get_bool(config, &ffd->large_delta_windows,
+                                  CONFIG_SECTION_DELTIFICATION,
+                                  CONFIG_OPTION_LARGE_DELTA_WINDOWS,
+                                  FALSE));
+
+      svn_config_get(config, &compression_val,
+                     CONFIG_SECTION_DELTIFICATION,
+                     CONFIG_OPTION_COMPRESSION, NULL);
+      if (ffd->large_delta_windows
+          && ffd->delta_compression_type == compression_type_lz4)
+        {
+          if (compression_val)
+            return svn_error_create(SVN_ERR_BAD_CONFIG_VALUE, NULL,
+                                    _("Compression type 'lz4' cannot be "
+                                      "used with large delta windows"));
+
+          ffd->delta_compression_type = compression_type_zlib;
+          ffd->delta_compression_level = SVN_DELTA_COMPRESSION_LEVEL_DEFAULT;
+        }
+    }
+  else
+    {
+      ffd->large_delta_windows = FALSE;
+    }
+
 #ifdef SVN_DEBUG
   SVN_ERR(svn_config_get_bool(config, &ffd->verify_before_commit,
                               CONFIG_SECTION_DEBUG,
@@ -946,6 +996,27 @@ read_config(fs_fs_data_t *ffd,
                               CONFIG_SECTION_CACHES, CONFIG_OPTION_FAIL_STOP,
                               FALSE));
 
+  /* The compressed fulltext cache tier is given in MB. */
+  {
+    apr_int64_t hot_fulltext_cache_size;
+    SVN_ERR(svn_config_get_int64(config, &hot_fulltext_cache_size,
+                                 CONFIG_SECTION_CACHES,
+                                 CONFIG_OPTION_HOT_FULLTEXT_CACHE_SIZE,
+                                 0));
+    if (hot_fulltext_cache_size < 0
+        || hot_fulltext_cache_size > APR_SIZE_MAX / 0x100000)
+      return svn_error_createf(SVN_ERR_BAD_CONFIG_VALUE, NULL,
+                               _("%s is out of range for fsfs.conf "
+                                 "setting '%s'."),
+                               apr_psprintf(scratch_pool,
+                                            "%" APR_INT64_T_FMT,
+                                            hot_fulltext_cache_size),
+                               CONFIG_OPTION_HOT_FULLTEXT_CACHE_SIZE);
+
+    ffd->hot_fulltext_cache_size
+      = (apr_uint64_t)hot_fulltext_cache_size * 0x100000;
+  }
+
   return SVN_NO_ERROR;
 }
 
@@ -978,6 +1049,16 @@ write_config(svn_fs_t *fs,
 "### configured (and ignoring it with file:// access).  To make"             NL
 "### Subversion never ignore cache errors, uncomment this line."             NL
 "# " CONFIG_OPTION_FAIL_STOP " = true"                                       NL
+"###"                                                                        NL
+"### Reconstructing files with long delta chains is expensive.  Set this"   NL
+"### to a non-zero value to keep LZ4-compressed copies of such files in a"  NL
+"### separate cache.  Once it is full,  only files requested more often"    NL
+"### than those already in the cache will be added to it.  This cache is"   NL
+"### shared by all connections to this repository within the same server"   NL
+"### process and is given in MBytes.  The first open of the repository"     NL
+"### determines its size."                                                   NL
+"### hot-fulltext-cache-size defaults to 0,  i.e. the cache is disabled."   NL
+"# " CONFIG_OPTION_HOT_FULLTEXT_CACHE_SIZE " = 0"                            NL
 ""                                                                           NL
 "[" CONFIG_SECTION_REP_SHARING "]"                                           NL
 "### To conserve space, the filesystem can optionally avoid storing"         NL
@@ -1080,6 +1161,18 @@ write_config(svn_fs_t *fs,
 "### still be used (and it will result in zlib compression with the"         NL
 "### corresponding compression level)."                                      NL
 "###   " CONFIG_OPTION_COMPRESSION_LEVEL " = 0 ... 9 (default is 5)"         NL
+"###"                                                                        NL
+"### This setting enables large delta windows of up to 4 MB (instead of"     NL
+"### 100 kB) in future revisions.  Larger windows allow Subversion to find"  NL
+"### matches that are further apart, e.g. when data has been moved within"   NL
+"### a large binary file.  This can make deltas considerably smaller at"     NL
+"### the expense of more memory being used when reading and writing them."   NL
+"### Large delta windows are only compatible with 'zlib' compression, so"    NL
+"### the default compression becomes 'zlib' when this option is enabled."   NL
+"### Large delta windows are supported, starting from format 9"              NL
+"### repositories, available in Subversion 1.15 and higher."                 NL
+"### The default is false."                                                  NL
+"# " CONFIG_OPTION_LARGE_DELTA_WINDOWS " = false"                            NL
 ""                                                                           NL
 "[" CONFIG_SECTION_PACKED_REVPROPS "]"                                       NL
 "### This parameter controls the size (in kBytes) of packed revprop files."  NL
@@ -1148,6 +1241,17 @@ write_config(svn_fs_t *fs,
 "### Must be a power of 2."                                                  NL
 "### p2l-page-size is given in kBytes and with a default of 1024 kBytes."    NL
 "# " CONFIG_OPTION_P2L_PAGE_SIZE " = 1024"                                   NL
+"###"                                                                        NL
+"### To reconstruct a file from a chain of deltas, all representations in"  NL
+"### that chain must be read.  On storage with a high access latency,  e.g."NL
+"### NFS,  these reads add up.  If this is set to a value larger than 1,"   NL
+"### up to that many representations of a chain will be read concurrently"  NL
+"### once the chain is known,  each one using its own file handle.  On"     NL
+"### local disks,  the overhead of doing so is likely to outweigh the"      NL
+"### benefits.  Unlike the other settings in this section,  this one"       NL
+"### applies to all repository formats.  Must be between 0 and 64."         NL
+"### prefetch-threads defaults to 0,  i.e. reads are strictly sequential."  NL
+"# " CONFIG_OPTION_PREFETCH_THREADS " = 0"                                   NL
 ""                                                                           NL
 "[" CONFIG_SECTION_DEBUG "]"                                                 NL
 "###"                                                                        NL
@@ -1157,8 +1261,18 @@ write_config(svn_fs_t *fs,
 "# " CONFIG_OPTION_VERIFY_BEFORE_COMMIT " = false"                           NL
 ;
 #undef NL
+  fs_fs_data_t *ffd = fs->fsap_data;
+  svn_stringbuf_t *contents = svn_stringbuf_create(fsfs_conf_contents, pool);
+
+  /* Large delta windows may be enabled when creating the repository. */
+  if (ffd->large_delta_windows)
+    svn_stringbuf_replace_all(contents,
+                              "# " CONFIG_OPTION_LARGE_DELTA_WINDOWS
+                              " = false",
+                              CONFIG_OPTION_LARGE_DELTA_WINDOWS " = true");
+
   return svn_io_file_create(svn_dirent_join(fs->path, PATH_CONFIG, pool),
-                            fsfs_conf_contents, pool);
+                            contents->data, pool);
 }
 
 /* Read / Evaluate the global configuration in FS->CONFIG to set up
@@ -1167,6 +1281,9 @@ static svn_error_t *
 read_global_config(svn_fs_t *fs)
 {
   fs_fs_data_t *ffd = fs->fsap_data;
+  const char *pack_jobs_str
+    = fs->config ? svn_hash_gets(fs->config, SVN_FS_CONFIG_FSFS_PACK_JOBS)
+                 : NULL;
 
   ffd->use_block_read = svn_hash__get_bool(fs->config,
                                            SVN_FS_CONFIG_FSFS_BLOCK_READ,
@@ -1175,6 +1292,15 @@ read_global_config(svn_fs_t *fs)
                                            SVN_FS_CONFIG_NO_FLUSH_TO_DISK,
                                            FALSE);
 
+  ffd->pack_jobs = 1;
+  if (pack_jobs_str)
+    {
+      apr_int64_t val;
+      SVN_ERR(svn_cstring_strtoi64(&val, pack_jobs_str, 1, APR_INT32_MAX,
+                                   10));
+      ffd->pack_jobs = (int)val;
+    }
+
   /* Ignore the user-specified larger block size if we don't use block-read.
      Defaulting to 4k gives us the same access granularity in format 7 as in
      older formats. */
@@ -1914,9 +2040,15 @@ svn_fs_fs__create(svn_fs_t *fs,
                   const char *path,
                   apr_pool_t *pool)
 {
-  int format = SVN_FS_FS__FORMAT_NUMBER;
+  int format = SVN_FS_FS__DEFAULT_FORMAT_NUMBER;
   int shard_size = SVN_FS_FS_DEFAULT_MAX_FILES_PER_DIR;
   svn_boolean_t log_addressing;
+  svn_boolean_t large_delta_windows;
+  fs_fs_data_t *ffd = fs->fsap_data;
+
+  large_delta_windows
+    = svn_hash__get_bool(fs->config, SVN_FS_CONFIG_FSFS_LARGE_DELTA_WINDOWS,
+                         FALSE);
 
   /* Process the given filesystem config. */
   if (fs->config)
@@ -1952,9 +2084,26 @@ svn_fs_fs__create(svn_fs_t *fs,
           case 9: format = 7;
                   break;
 
-          default:format = SVN_FS_FS__FORMAT_NUMBER;
+          case 10:
+          case 11:
+          case 12:
+          case 13:
+          case 14: format = 8;
+                  break;
+
+          /* Newer formats can't be read by older servers, so only use
+             them when explicitly asked to. */
+          default:
+            if (large_delta_windows
+                || svn_hash_gets(fs->config, SVN_FS_CONFIG_COMPATIBLE_VERSION))
+              format = SVN_FS_FS__FORMAT_NUMBER;
         }
 
+      if (large_delta_windows && format < SVN_FS_FS__MIN_SVNDIFF3_FORMAT)
+        return svn_error_create(SVN_ERR_FS_UNSUPPORTED_FORMAT, NULL,
+                 _("Large delta windows are not compatible with Subversion "
+                   "prior to 1.15"));
+
       shard_size_str = svn_hash_gets(fs->config, SVN_FS_CONFIG_FSFS_SHARD_SIZE);
       if (shard_size_str)
         {
@@ -1970,7 +2119,9 @@ svn_fs_fs__create(svn_fs_t *fs,
                                       SVN_FS_CONFIG_FSFS_LOG_ADDRESSING,
                                       TRUE);
 
-  /* Actual FS creation. */
+  /* Actual FS creation.  Enable large delta windows in the new fsfs.conf
+     if asked to. */
+  ffd->large_delta_windows = large_delta_windows;
   SVN_ERR(svn_fs_fs__create_file_tree(fs, path, format, shard_size,
                                       log_addressing, pool));
 
@@ -2323,8 +2474,11 @@ svn_fs_fs__info_format(int *fs_format,
     case 8:
       (*supports_version)->minor = 10;
       break;
+    case 9:
+      (*supports_version)->minor = 15;
+      break;
 #ifdef SVN_DEBUG
-# if SVN_FS_FS__FORMAT_NUMBER != 8
+# if SVN_FS_FS__FORMAT_NUMBER != 9
 #  error "Need to add a 'case' statement here"
 # endif
 #endif
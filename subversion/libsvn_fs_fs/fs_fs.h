@@ -48,6 +48,16 @@ svn_error_t *svn_fs_fs__initialize_shared_data(svn_fs_t *fs,
                                                apr_pool_t *pool,
                                                apr_pool_t *common_pool);
 
+/* Open another instance of the filesystem FS and return it in *INSTANCE.
+   The new instance uses the same configuration and shares the caches and
+   the process-wide data (e.g. locks) with FS but no other state.  Hence,
+   it may be used concurrently to FS from a different thread.  Allocate
+   *INSTANCE in RESULT_POOL and use SCRATCH_POOL for temporaries. */
+svn_error_t *svn_fs_fs__open_instance(svn_fs_t **instance,
+                                      svn_fs_t *fs,
+                                      apr_pool_t *result_pool,
+                                      apr_pool_t *scratch_pool);
+
 /* Upgrade the fsfs filesystem FS.  Indicate progress via the optional
  * NOTIFY_FUNC callback using NOTIFY_BATON.  The optional CANCEL_FUNC
  * will periodically be called with CANCEL_BATON to allow for preemption.
@@ -288,6 +298,30 @@ svn_fs_fs__get_node_origin(const svn_fs_id_t **origin_id,
 svn_error_t *
 svn_fs_fs__initialize_caches(svn_fs_t *fs, apr_pool_t *pool);
 
+/* Initialize the session-local caches in FS that are backed by storage
+   in the shared data of FS.  Call this after FS has been connected to its
+   shared data.  Use SCRATCH_POOL for temporary allocations. */
+svn_error_t *
+svn_fs_fs__initialize_shared_caches(svn_fs_t *fs, apr_pool_t *scratch_pool);
+
+/* Write the contents of the process-global membuffer cache that belong
+   to FSFS repositories to the snapshot file at PATH.  Together with the
+   data, record each repository's current state such that
+   svn_fs_fs__load_cache_snapshot() can tell whether the data is still
+   valid.  Use SCRATCH_POOL for temporary allocations. */
+svn_error_t *
+svn_fs_fs__save_cache_snapshot(const char *path,
+                               apr_pool_t *scratch_pool);
+
+/* Put the data from the cache snapshot file at PATH into the process-
+   global membuffer cache.  Skip the data of any repository that has been
+   replaced or rolled back since the snapshot was taken.  Silently ignore
+   missing snapshots and those taken by a different Subversion version.
+   Use SCRATCH_POOL for temporary allocations. */
+svn_error_t *
+svn_fs_fs__load_cache_snapshot(const char *path,
+                               apr_pool_t *scratch_pool);
+
 /* Initialize all transaction-local caches in FS according to the global
    cache settings and make TXN_ID part of their key space. Use POOL for
    allocations.
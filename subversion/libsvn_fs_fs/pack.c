@@ -22,9 +22,15 @@
 #include <assert.h>
 #include <string.h>
 
+#include <apr_thread_cond.h>
+#include <apr_thread_mutex.h>
+#include <apr_thread_proc.h>
+
+#include "svn_cache_config.h"
 #include "svn_pools.h"
 #include "svn_dirent_uri.h"
 #include "svn_sorts.h"
+#include "private/svn_atomic.h"
 #include "private/svn_temp_serializer.h"
 #include "private/svn_sorts_private.h"
 #include "private/svn_subr_private.h"
@@ -1860,11 +1866,12 @@ struct pack_baton
 {
   /* Valid when entering pack_body(). */
   svn_fs_t *fs;
-  svn_fs_pack_notify_t notify_func;
+  svn_fs_pack_notify2_t notify_func;
   void *notify_baton;
   svn_cancel_func_t cancel_func;
   void *cancel_baton;
   size_t max_mem;
+  int jobs;
 
   /* Additional entries valid when entering pack_shard(). */
   const char *revs_dir;
@@ -1957,6 +1964,52 @@ synced_pack_shard(void *baton,
   return SVN_NO_ERROR;
 }
 
+/* Set *REV_PACK_FILE_DIR and *REV_SHARD_PATH to the packed and the
+ * non-packed revision folder of SHARD within REVS_DIR, respectively.
+ * REV_PACK_FILE_DIR may be NULL.  Allocate the results in POOL.
+ */
+static void
+get_shard_paths(const char **rev_pack_file_dir,
+                const char **rev_shard_path,
+                const char *revs_dir,
+                apr_int64_t shard,
+                apr_pool_t *pool)
+{
+  if (rev_pack_file_dir)
+    *rev_pack_file_dir = svn_dirent_join(revs_dir,
+                    apr_psprintf(pool,
+                                 "%" APR_INT64_T_FMT PATH_EXT_PACKED_SHARD,
+                                 shard),
+                    pool);
+
+  *rev_shard_path = svn_dirent_join(revs_dir,
+                                    apr_psprintf(pool, "%" APR_INT64_T_FMT,
+                                                 shard),
+                                    pool);
+}
+
+/* Switch the repository over to the packed revision data of the shard
+ * described by BATON, which must already have been created, and pack
+ * the respective revprops.
+ */
+static svn_error_t *
+switch_to_packed_shard(struct pack_baton *baton,
+                       apr_pool_t *pool)
+{
+  fs_fs_data_t *ffd = baton->fs->fsap_data;
+
+  /* For newer repo formats, we only acquired the pack lock so far.
+     Before modifying the repo state by switching over to the packed
+     data, we need to acquire the global (write) lock. */
+  if (ffd->format >= SVN_FS_FS__MIN_PACK_LOCK_FORMAT)
+    SVN_ERR(svn_fs_fs__with_write_lock(baton->fs, synced_pack_shard, baton,
+                                       pool));
+  else
+    SVN_ERR(synced_pack_shard(baton, pool));
+
+  return SVN_NO_ERROR;
+}
+
 /* Pack the shard described by BATON.
  *
  * If for some reason we detect a partial packing already performed,
@@ -1968,23 +2021,16 @@ pack_shard(struct pack_baton *baton,
 {
   fs_fs_data_t *ffd = baton->fs->fsap_data;
   const char *rev_pack_file_dir;
+  apr_time_t start_time = apr_time_now();
 
   /* Notify caller we're starting to pack this shard. */
   if (baton->notify_func)
     SVN_ERR(baton->notify_func(baton->notify_baton, baton->shard,
-                               svn_fs_pack_notify_start, pool));
+                               svn_fs_pack_notify_start, 0, pool));
 
   /* Some useful paths. */
-  rev_pack_file_dir = svn_dirent_join(baton->revs_dir,
-                  apr_psprintf(pool,
-                               "%" APR_INT64_T_FMT PATH_EXT_PACKED_SHARD,
-                               baton->shard),
-                  pool);
-  baton->rev_shard_path = svn_dirent_join(baton->revs_dir,
-                                          apr_psprintf(pool,
-                                                       "%" APR_INT64_T_FMT,
-                                                       baton->shard),
-                                          pool);
+  get_shard_paths(&rev_pack_file_dir, &baton->rev_shard_path,
+                  baton->revs_dir, baton->shard, pool);
 
   /* pack the revision content */
   SVN_ERR(pack_rev_shard(baton->fs, rev_pack_file_dir, baton->rev_shard_path,
@@ -1992,23 +2038,325 @@ pack_shard(struct pack_baton *baton,
                          baton->max_mem, ffd->flush_to_disk,
                          baton->cancel_func, baton->cancel_baton, pool));
 
-  /* For newer repo formats, we only acquired the pack lock so far.
-     Before modifying the repo state by switching over to the packed
-     data, we need to acquire the global (write) lock. */
-  if (ffd->format >= SVN_FS_FS__MIN_PACK_LOCK_FORMAT)
-    SVN_ERR(svn_fs_fs__with_write_lock(baton->fs, synced_pack_shard, baton,
-                                       pool));
-  else
-    SVN_ERR(synced_pack_shard(baton, pool));
+  SVN_ERR(switch_to_packed_shard(baton, pool));
 
   /* Notify caller we're starting to pack this shard. */
   if (baton->notify_func)
     SVN_ERR(baton->notify_func(baton->notify_baton, baton->shard,
-                               svn_fs_pack_notify_end, pool));
+                               svn_fs_pack_notify_end,
+                               apr_time_now() - start_time, pool));
 
   return SVN_NO_ERROR;
 }
 
+#if APR_HAS_THREADS
+
+/* Concurrent packing.
+ *
+ * Packing the revision data of a shard only reads the non-packed shard and
+ * writes a new pack folder, which nobody else will look at until we bump
+ * the min-unpacked-rev.  Hence, several shards can be packed at the same
+ * time.  We let worker threads do that, each one using its own instance
+ * of the filesystem.
+ *
+ * The thread holding the pack lock then switches the repository over to
+ * the packed shards, packs the revprops and sends the notifications, all
+ * in shard order and just like the sequential code would.  Workers may
+ * only run a few shards ahead of that, limiting the amount of disk space
+ * occupied by pack files that are not in use, yet.
+ */
+
+/* Number of shards per job that may be packed ahead of the switch-over. */
+#define PACK_SHARDS_PER_JOB 2
+
+/* Interval in microseconds in which the thread holding the pack lock
+   checks for cancellation while waiting for the workers. */
+#define PACK_POLL_INTERVAL (100 * 1000)
+
+/* Result of packing the revision data of a single shard. */
+typedef struct pack_result_t
+{
+  /* The worker has finished the shard, i.e. ERR and DURATION are final.
+     Only accessed while holding the mutex. */
+  svn_boolean_t done;
+
+  /* Packing error or SVN_NO_ERROR. */
+  svn_error_t *err;
+
+  /* Time it took to pack the revision data. */
+  apr_interval_time_t duration;
+} pack_result_t;
+
+/* Work description and shared state of a concurrent pack run. */
+typedef struct pack_jobs_t
+{
+  /* The filesystem to pack.  Workers only use it to open their own
+     instances. */
+  svn_fs_t *fs;
+  const char *revs_dir;
+  apr_size_t max_mem;
+
+  /* Shard number N is FIRST_SHARD + N. */
+  apr_int64_t first_shard;
+  int shard_count;
+
+  /* Protects the following members and the DONE flags in RESULTS.
+     CHANGED gets signalled whenever any of them changes. */
+  apr_thread_mutex_t *mutex;
+  apr_thread_cond_t *changed;
+
+  /* The next shard to hand out to a worker. */
+  int next;
+
+  /* The repository has been switched over to all shards before this one. */
+  int switched;
+
+  /* Results, indexed by shard number modulo WINDOW.  A worker may only
+     start on a shard if it is less than WINDOW shards ahead of SWITCHED. */
+  pack_result_t *results;
+  int window;
+
+  /* Set to stop all workers as soon as possible. */
+  svn_atomic_t abort;
+} pack_jobs_t;
+
+/* Implement svn_cancel_func_t for the workers of the pack_jobs_t in
+   BATON. */
+static svn_error_t *
+check_pack_abort(void *baton)
+{
+  pack_jobs_t *jobs = baton;
+
+  if (svn_atomic_read(&jobs->abort))
+    return svn_error_create(SVN_ERR_CANCELLED, NULL, NULL);
+
+  return SVN_NO_ERROR;
+}
+
+/* Pack the revision data of shard number N of JOBS.  *FS is the worker's
+   filesystem instance, which gets opened in FS_POOL upon first use.
+   Use SCRATCH_POOL for temporary allocations. */
+static svn_error_t *
+pack_shard_revs(svn_fs_t **fs,
+                pack_jobs_t *jobs,
+                int n,
+                apr_pool_t *fs_pool,
+                apr_pool_t *scratch_pool)
+{
+  apr_int64_t shard = jobs->first_shard + n;
+  const char *rev_pack_file_dir, *rev_shard_path;
+  fs_fs_data_t *ffd;
+
+  if (*fs == NULL)
+    SVN_ERR(svn_fs_fs__open_instance(fs, jobs->fs, fs_pool, scratch_pool));
+
+  ffd = (*fs)->fsap_data;
+  get_shard_paths(&rev_pack_file_dir, &rev_shard_path, jobs->revs_dir,
+                  shard, scratch_pool);
+
+  return svn_error_trace(pack_rev_shard(*fs, rev_pack_file_dir,
+                                        rev_shard_path, shard,
+                                        ffd->max_files_per_dir,
+                                        jobs->max_mem, ffd->flush_to_disk,
+                                        check_pack_abort, jobs,
+                                        scratch_pool));
+}
+
+/* Worker thread function.  Pack shards of the pack_jobs_t in DATA until
+   there are none left or we are told to abort. */
+static void * APR_THREAD_FUNC
+pack_thread(apr_thread_t *thread, void *data)
+{
+  pack_jobs_t *jobs = data;
+  apr_pool_t *thread_root
+    = apr_allocator_owner_get(svn_pool_create_allocator(FALSE));
+  apr_pool_t *iterpool = svn_pool_create(thread_root);
+  svn_fs_t *fs = NULL;
+
+  while (TRUE)
+    {
+      pack_result_t *result;
+      apr_time_t start_time;
+      int n;
+
+      /* Claim the next shard, unless we are too far ahead of the
+         switch-over already. */
+      apr_thread_mutex_lock(jobs->mutex);
+      while (!svn_atomic_read(&jobs->abort)
+             && jobs->next < jobs->shard_count
+             && jobs->next >= jobs->switched + jobs->window)
+        apr_thread_cond_wait(jobs->changed, jobs->mutex);
+
+      if (svn_atomic_read(&jobs->abort) || jobs->next >= jobs->shard_count)
+        {
+          apr_thread_mutex_unlock(jobs->mutex);
+          break;
+        }
+
+      n = jobs->next++;
+      apr_thread_mutex_unlock(jobs->mutex);
+
+      /* The result slot is ours until we mark it as done. */
+      result = &jobs->results[n % jobs->window];
+
+      svn_pool_clear(iterpool);
+      start_time = apr_time_now();
+      result->err = pack_shard_revs(&fs, jobs, n, thread_root, iterpool);
+      result->duration = apr_time_now() - start_time;
+
+      apr_thread_mutex_lock(jobs->mutex);
+      result->done = TRUE;
+      apr_thread_cond_broadcast(jobs->changed);
+      apr_thread_mutex_unlock(jobs->mutex);
+    }
+
+  svn_pool_destroy(thread_root);
+
+  /* End thread explicitly to prevent APR_INCOMPLETE return codes in
+     apr_thread_join(). */
+  apr_thread_exit(thread, APR_SUCCESS);
+  return NULL;
+}
+
+/* Pack all shards of JOBS using THREAD_COUNT worker threads and switch
+   the repository described by PB over to them in shard order.  Use
+   SCRATCH_POOL for temporary allocations. */
+static svn_error_t *
+pack_concurrently(struct pack_baton *pb,
+                  pack_jobs_t *jobs,
+                  int thread_count,
+                  apr_pool_t *scratch_pool)
+{
+  apr_pool_t *iterpool = svn_pool_create(scratch_pool);
+  apr_thread_t **threads;
+  apr_status_t status;
+  svn_error_t *err = SVN_NO_ERROR;
+  int started = 0;
+  int n;
+  int i;
+
+  thread_count = MIN(thread_count, jobs->shard_count);
+
+  jobs->next = 0;
+  jobs->switched = 0;
+  jobs->window = thread_count * PACK_SHARDS_PER_JOB;
+  jobs->results = apr_pcalloc(scratch_pool,
+                              jobs->window * sizeof(*jobs->results));
+  svn_atomic_set(&jobs->abort, FALSE);
+
+  status = apr_thread_mutex_create(&jobs->mutex, APR_THREAD_MUTEX_DEFAULT,
+                                   scratch_pool);
+  if (status)
+    return svn_error_wrap_apr(status, _("Can't create mutex"));
+
+  status = apr_thread_cond_create(&jobs->changed, scratch_pool);
+  if (status)
+    return svn_error_wrap_apr(status, _("Can't create condition variable"));
+
+  threads = apr_pcalloc(scratch_pool, thread_count * sizeof(*threads));
+  for (started = 0; started < thread_count; ++started)
+    {
+      status = apr_thread_create(&threads[started], NULL, pack_thread,
+                                 jobs, scratch_pool);
+      if (status)
+        {
+          err = svn_error_wrap_apr(status, _("Can't create thread"));
+          break;
+        }
+    }
+
+  /* Switch over to the packed shards in order. */
+  for (n = 0; !err && n < jobs->shard_count; ++n)
+    {
+      pack_result_t *result = &jobs->results[n % jobs->window];
+      apr_time_t start_time;
+
+      svn_pool_clear(iterpool);
+      pb->shard = jobs->first_shard + n;
+
+      if (pb->notify_func)
+        err = pb->notify_func(pb->notify_baton, pb->shard,
+                              svn_fs_pack_notify_start, 0, iterpool);
+
+      /* Wait for the worker but keep checking for cancellation while
+         we do. */
+      apr_thread_mutex_lock(jobs->mutex);
+      while (!err && !result->done)
+        {
+          apr_thread_mutex_unlock(jobs->mutex);
+          if (pb->cancel_func)
+            err = pb->cancel_func(pb->cancel_baton);
+          apr_thread_mutex_lock(jobs->mutex);
+
+          if (!err && !result->done)
+            apr_thread_cond_timedwait(jobs->changed, jobs->mutex,
+                                      PACK_POLL_INTERVAL);
+        }
+      apr_thread_mutex_unlock(jobs->mutex);
+
+      if (!err)
+        {
+          err = result->err;
+          result->err = SVN_NO_ERROR;
+        }
+
+      if (!err)
+        {
+          get_shard_paths(NULL, &pb->rev_shard_path, pb->revs_dir,
+                          pb->shard, iterpool);
+
+          start_time = apr_time_now();
+          err = switch_to_packed_shard(pb, iterpool);
+        }
+
+      if (!err && pb->notify_func)
+        err = pb->notify_func(pb->notify_baton, pb->shard,
+                              svn_fs_pack_notify_end,
+                              result->duration
+                                + (apr_time_now() - start_time),
+                              iterpool);
+
+      /* Release the result slot. */
+      apr_thread_mutex_lock(jobs->mutex);
+      if (result->done)
+        {
+          svn_error_clear(result->err);
+          result->err = SVN_NO_ERROR;
+          result->done = FALSE;
+        }
+      jobs->switched = n + 1;
+      apr_thread_cond_broadcast(jobs->changed);
+      apr_thread_mutex_unlock(jobs->mutex);
+    }
+
+  /* Stop all workers, in case we bailed out early, and wait for them.
+     Pack folders left behind by them will be replaced by the next run. */
+  apr_thread_mutex_lock(jobs->mutex);
+  svn_atomic_set(&jobs->abort, TRUE);
+  apr_thread_cond_broadcast(jobs->changed);
+  apr_thread_mutex_unlock(jobs->mutex);
+
+  for (i = 0; i < started; ++i)
+    {
+      apr_status_t thread_status;
+      status = apr_thread_join(&thread_status, threads[i]);
+      if (status)
+        err = svn_error_compose_create(err,
+                svn_error_wrap_apr(status, _("Can't join thread")));
+    }
+
+  /* Discard the results that we did not use. */
+  for (i = 0; i < jobs->window; ++i)
+    if (jobs->results[i].done)
+      svn_error_clear(jobs->results[i].err);
+
+  svn_pool_destroy(iterpool);
+
+  return svn_error_trace(err);
+}
+
+#endif /* APR_HAS_THREADS */
+
 /* Read the youngest rev and the first non-packed rev info for FS from disk.
    Set *FULLY_PACKED when there is no completed unpacked shard.
    Use SCRATCH_POOL for temporary allocations.
@@ -2069,7 +2417,7 @@ pack_body(void *baton,
       if (pb->notify_func)
         SVN_ERR(pb->notify_func(pb->notify_baton,
                                 ffd->min_unpacked_rev / ffd->max_files_per_dir,
-                                svn_fs_pack_notify_noop, pool));
+                                svn_fs_pack_notify_noop, 0, pool));
 
       return SVN_NO_ERROR;
     }
@@ -2080,6 +2428,24 @@ pack_body(void *baton,
     pb->revsprops_dir = svn_dirent_join(pb->fs->path, PATH_REVPROPS_DIR,
                                         pool);
 
+#if APR_HAS_THREADS
+  /* The workers share the caches, which must support that. */
+  if (   pb->jobs > 1
+      && completed_shards - ffd->min_unpacked_rev / ffd->max_files_per_dir > 1
+      && !svn_cache_config_get()->single_threaded)
+    {
+      pack_jobs_t jobs = { 0 };
+
+      jobs.fs = pb->fs;
+      jobs.revs_dir = pb->revs_dir;
+      jobs.max_mem = pb->max_mem;
+      jobs.first_shard = ffd->min_unpacked_rev / ffd->max_files_per_dir;
+      jobs.shard_count = (int)(completed_shards - jobs.first_shard);
+
+      return svn_error_trace(pack_concurrently(pb, &jobs, pb->jobs, pool));
+    }
+#endif
+
   iterpool = svn_pool_create(pool);
   for (pb->shard = ffd->min_unpacked_rev / ffd->max_files_per_dir;
        pb->shard < completed_shards;
@@ -2100,7 +2466,7 @@ pack_body(void *baton,
 svn_error_t *
 svn_fs_fs__pack(svn_fs_t *fs,
                 apr_size_t max_mem,
-                svn_fs_pack_notify_t notify_func,
+                svn_fs_pack_notify2_t notify_func,
                 void *notify_baton,
                 svn_cancel_func_t cancel_func,
                 void *cancel_baton,
@@ -2122,7 +2488,8 @@ svn_fs_fs__pack(svn_fs_t *fs,
   if (!ffd->max_files_per_dir)
     {
       if (notify_func)
-        SVN_ERR(notify_func(notify_baton, -1, svn_fs_pack_notify_noop, pool));
+        SVN_ERR(notify_func(notify_baton, -1, svn_fs_pack_notify_noop, 0,
+                            pool));
 
       return SVN_NO_ERROR;
     }
@@ -2134,7 +2501,7 @@ svn_fs_fs__pack(svn_fs_t *fs,
       if (notify_func)
         SVN_ERR(notify_func(notify_baton,
                             ffd->min_unpacked_rev / ffd->max_files_per_dir,
-                            svn_fs_pack_notify_noop, pool));
+                            svn_fs_pack_notify_noop, 0, pool));
 
       return SVN_NO_ERROR;
     }
@@ -2146,6 +2513,7 @@ svn_fs_fs__pack(svn_fs_t *fs,
   pb.cancel_func = cancel_func;
   pb.cancel_baton = cancel_baton;
   pb.max_mem = max_mem ? max_mem : DEFAULT_MAX_MEM;
+  pb.jobs = ffd->pack_jobs;
 
   if (ffd->format >= SVN_FS_FS__MIN_PACK_LOCK_FORMAT)
     {
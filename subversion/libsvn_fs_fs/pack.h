@@ -35,11 +35,16 @@
    If given, NOTIFY_FUNC will be called with NOTIFY_BATON to report progress.
    Use optional CANCEL_FUNC/CANCEL_BATON for cancellation support.
 
+   Up to FS's pack_jobs shards will be packed concurrently, each one by its
+   own thread using a separate instance of FS.  The packed shards will
+   still be switched over in shard order and all notifications are being
+   sent from the calling thread.
+
    Existing filesystem references need not change.  */
 svn_error_t *
 svn_fs_fs__pack(svn_fs_t *fs,
                 apr_size_t max_mem,
-                svn_fs_pack_notify_t notify_func,
+                svn_fs_pack_notify2_t notify_func,
                 void *notify_baton,
                 svn_cancel_func_t cancel_func,
                 void *cancel_baton,
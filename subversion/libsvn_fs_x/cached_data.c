@@ -2364,6 +2364,24 @@ get_storaged_delta_stream(rep_state_t *rep_state,
                                    delta_read_md5_digest, result_pool);
 }
 
+/* Set *LARGE_WINDOWS to TRUE, if the representation read by RS uses
+   svndiff version 3 or higher, i.e. may contain delta windows that are
+   larger than what the older svndiff versions support.
+   Use SCRATCH_POOL for temporary allocations. */
+static svn_error_t *
+uses_large_windows(svn_boolean_t *large_windows,
+                   rep_state_t *rs,
+                   apr_pool_t *scratch_pool)
+{
+  SVN_ERR(auto_open_shared_file(rs->sfile));
+  SVN_ERR(auto_set_start_offset(rs, scratch_pool));
+  SVN_ERR(auto_read_diff_version(rs, scratch_pool));
+
+  *large_windows = rs->ver >= 3;
+
+  return SVN_NO_ERROR;
+}
+
 svn_error_t *
 svn_fs_x__get_file_delta_stream(svn_txdelta_stream_t **stream_p,
                                 svn_fs_t *fs,
@@ -2381,14 +2399,29 @@ svn_fs_x__get_file_delta_stream(svn_txdelta_stream_t **stream_p,
      whenever that is available. */
   if (target->data_rep && source)
     {
+      svn_boolean_t large_windows;
+
       /* Read target's base rep if any. */
       SVN_ERR(create_rep_state(&rep_state, &rep_header, NULL,
                                target->data_rep, fs, result_pool,
                                scratch_pool));
 
+      /* Our callers may forward the delta to clients using older svndiff
+         versions, which cannot represent large windows.  Don't pass them
+         on as they are but construct a new delta with standard windows
+         from the fulltexts. */
+      if (rep_header->type == svn_fs_x__rep_container)
+        large_windows = FALSE;
+      else
+        SVN_ERR(uses_large_windows(&large_windows, rep_state, scratch_pool));
+
       /* Try a shortcut: if the target is stored as a delta against the source,
          then just use that delta. */
-      if (source && source->data_rep && target->data_rep)
+      if (large_windows)
+        {
+          /* Fall through to the fulltext-based code below. */
+        }
+      else if (source && source->data_rep && target->data_rep)
         {
           /* If that matches source, then use this delta as is.
              Note that we want an actual delta here.  E.g. a self-delta would
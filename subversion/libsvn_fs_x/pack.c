@@ -80,7 +80,10 @@
  * - same for file representations
  *
  * Step 4 copies the items from the temporary buckets into the final
- * pack file and writes the temporary index files.
+ * pack file and writes the temporary index files.  Since the placement
+ * order has little to do with the order of the items in the buckets,
+ * noderevs and plain representations are read in batches sorted by
+ * bucket offset (see item_reader_t) rather than one by one.
  *
  * Finally, after the last range of revisions, create the final indexes.
  */
@@ -1002,6 +1005,216 @@ reps_fit_into_containers(apr_array_header_t *selected,
   return TRUE;
 }
 
+/* Planned read of a single item from a temp file.
+ */
+typedef struct read_plan_t
+{
+  /* Offset of the item within the temp file. */
+  apr_off_t offset;
+
+  /* Length of the item in bytes. */
+  apr_off_t size;
+
+  /* Position of the item within the current batch of ITEM_READER_T. */
+  int index;
+} read_plan_t;
+
+/* Hands out the contents of a sequence of items from a temp file in
+ * their target order while reading the file in (mostly) sequential runs.
+ *
+ * Items are read in batches.  For each batch, we collect as many items
+ * as fit into the read buffer, sort them by their offset in the temp file
+ * and then fetch neighbouring items with a single read each.  This turns
+ * the quasi-random access pattern of the placement order into a few large
+ * forward reads per batch.
+ */
+typedef struct item_reader_t
+{
+  /* Pack context providing the block size and cancellation callback. */
+  pack_context_t *context;
+
+  /* The temp file to read from. */
+  apr_file_t *file;
+
+  /* The svn_fs_x__p2l_entry_t * to read, in the order they get requested.
+   * Elements may be NULL.  We will consider the first COUNT items only. */
+  apr_array_header_t *items;
+  int count;
+
+  /* Range of ITEMS covered by the current batch: FIRST to END-1. */
+  int first;
+  int end;
+
+  /* Contents of the items in the current batch, indexed by their position
+   * relative to FIRST.  NULL for items that we did not buffer. */
+  const char **data;
+
+  /* Pool holding the current batch.  Gets cleared for every new batch. */
+  apr_pool_t *batch_pool;
+} item_reader_t;
+
+/* Return a new item reader for the first COUNT svn_fs_x__p2l_entry_t * in
+ * ITEMS, read from TEMP_FILE using CONTEXT.  Allocate it in RESULT_POOL.
+ */
+static item_reader_t *
+item_reader_create(pack_context_t *context,
+                   apr_file_t *temp_file,
+                   apr_array_header_t *items,
+                   int count,
+                   apr_pool_t *result_pool)
+{
+  item_reader_t *reader = apr_pcalloc(result_pool, sizeof(*reader));
+  reader->context = context;
+  reader->file = temp_file;
+  reader->items = items;
+  reader->count = count;
+  reader->batch_pool = svn_pool_create(result_pool);
+
+  return reader;
+}
+
+/* Return TRUE, if ENTRY describes data that may be read from a temp file.
+ */
+static svn_boolean_t
+is_readable_item(const svn_fs_x__p2l_entry_t *entry)
+{
+  return entry
+      && entry->type != SVN_FS_X__ITEM_TYPE_UNUSED
+      && entry->item_count > 0
+      && entry->size > 0;
+}
+
+/* implements compare_fn_t.  Sort ascending by OFFSET.
+ */
+static int
+compare_read_plans(const read_plan_t *lhs,
+                   const read_plan_t *rhs)
+{
+  return lhs->offset < rhs->offset ? -1 : (lhs->offset > rhs->offset);
+}
+
+/* Make READER's next batch start at item index START and read the data
+ * of all items in it.  Use SCRATCH_POOL for temporary allocations.
+ */
+static svn_error_t *
+item_reader_fill(item_reader_t *reader,
+                 int start,
+                 apr_pool_t *scratch_pool)
+{
+  /* Size of the read buffer in blocks.  Gaps of up to one block between
+   * two items get read rather than skipped. */
+  enum { READ_BUFFER_BLOCKS = 64 };
+
+  svn_fs_x__data_t *ffd = reader->context->fs->fsap_data;
+  apr_off_t buffer_size = READ_BUFFER_BLOCKS * ffd->block_size;
+  apr_off_t max_gap = ffd->block_size;
+  apr_off_t used = 0;
+  apr_array_header_t *plan;
+  int i;
+
+  svn_pool_clear(reader->batch_pool);
+  plan = apr_array_make(scratch_pool, 64, sizeof(read_plan_t));
+
+  /* Select the items of this batch, in target order.  Items that don't fit
+   * into the buffer at all will be left to our caller.  Always make
+   * progress, though. */
+  for (i = start; i < reader->count; ++i)
+    {
+      svn_fs_x__p2l_entry_t *entry
+        = APR_ARRAY_IDX(reader->items, i, svn_fs_x__p2l_entry_t *);
+      read_plan_t *item;
+
+      if (!is_readable_item(entry))
+        continue;
+
+      if (entry->size > buffer_size)
+        {
+          if (i == start)
+            ++i;
+          break;
+        }
+
+      if (used + entry->size > buffer_size)
+        break;
+
+      item = apr_array_push(plan);
+      item->offset = entry->offset;
+      item->size = entry->size;
+      item->index = i - start;
+      used += entry->size;
+    }
+
+  reader->first = start;
+  reader->end = MAX(i, start + 1);
+  reader->data = apr_pcalloc(reader->batch_pool,
+                             (reader->end - start) * sizeof(*reader->data));
+
+  /* Read the items in file order.  Coalesce items that are close to each
+   * other into a single run.  The gaps count against our buffer size. */
+  svn_sort__array(plan,
+                  (int (*)(const void *, const void *))compare_read_plans);
+
+  for (i = 0; i < plan->nelts; )
+    {
+      const read_plan_t *first = &APR_ARRAY_IDX(plan, i, read_plan_t);
+      apr_off_t run_start = first->offset;
+      apr_off_t run_end = first->offset + first->size;
+      apr_off_t offset = run_start;
+      apr_size_t run_size;
+      char *buffer;
+      int k;
+
+      for (k = i + 1; k < plan->nelts; ++k)
+        {
+          const read_plan_t *next = &APR_ARRAY_IDX(plan, k, read_plan_t);
+          apr_off_t gap = next->offset - run_end;
+
+          if (gap > max_gap || used + gap > 2 * buffer_size)
+            break;
+
+          used += MAX(gap, 0);
+          run_end = MAX(run_end, next->offset + next->size);
+        }
+
+      if (reader->context->cancel_func)
+        SVN_ERR(reader->context->cancel_func(reader->context->cancel_baton));
+
+      run_size = (apr_size_t)(run_end - run_start);
+      buffer = apr_palloc(reader->batch_pool, run_size);
+      SVN_ERR(svn_io_file_seek(reader->file, APR_SET, &offset, scratch_pool));
+      SVN_ERR(svn_io_file_read_full2(reader->file, buffer, run_size,
+                                     NULL, NULL, scratch_pool));
+
+      for (; i < k; ++i)
+        {
+          const read_plan_t *item = &APR_ARRAY_IDX(plan, i, read_plan_t);
+          reader->data[item->index] = buffer + (item->offset - run_start);
+        }
+    }
+
+  return SVN_NO_ERROR;
+}
+
+/* Set *DATA to the contents of item number INDEX in READER or to NULL if
+ * the item has not been buffered, e.g. because it is too large.  In the
+ * latter case, the caller has to read the item from the temp file itself.
+ * INDEX must not be less than in any previous call.  The contents remain
+ * valid until the next call.  Use SCRATCH_POOL for temporary allocations.
+ */
+static svn_error_t *
+item_reader_get(const char **data,
+                item_reader_t *reader,
+                int index,
+                apr_pool_t *scratch_pool)
+{
+  if (index >= reader->end)
+    SVN_ERR(item_reader_fill(reader, index, scratch_pool));
+
+  *data = reader->data[index - reader->first];
+
+  return SVN_NO_ERROR;
+}
+
 /* Write the *CONTAINER containing the noderevs described by the
  * svn_fs_x__p2l_entry_t * in ITEMS to the pack file on CONTEXT.
  * Append a P2L entry for the container to CONTAINER->REPS.
@@ -1087,6 +1300,9 @@ store_nodes(pack_context_t *context,
   apr_pool_t *iterpool = svn_pool_create(scratch_pool);
   svn_stream_t *stream
     = svn_stream_from_aprfile2(temp_file, TRUE, scratch_pool);
+  item_reader_t *reader
+    = item_reader_create(context, temp_file, node_parts, node_parts->nelts,
+                         scratch_pool);
 
   /* number of bytes in the current block not being spent on fixed-size
      items (i.e. those not put into the container). */
@@ -1100,6 +1316,7 @@ store_nodes(pack_context_t *context,
   for (i = 0; i < node_parts->nelts; ++i)
     {
       svn_fs_x__noderev_t *noderev;
+      const char *data;
       svn_fs_x__p2l_entry_t *entry
         = APR_ARRAY_IDX(node_parts, i, svn_fs_x__p2l_entry_t *);
 
@@ -1148,8 +1365,25 @@ store_nodes(pack_context_t *context,
         }
 
       /* item will fit into the block. */
-      SVN_ERR(svn_io_file_seek(temp_file, APR_SET, &entry->offset, iterpool));
-      SVN_ERR(svn_fs_x__read_noderev(&noderev, stream, iterpool, iterpool));
+      SVN_ERR(item_reader_get(&data, reader, i, iterpool));
+      if (data)
+        {
+          svn_string_t contents;
+          contents.data = data;
+          contents.len = (apr_size_t)entry->size;
+
+          SVN_ERR(svn_fs_x__read_noderev(&noderev,
+                                         svn_stream_from_string(&contents,
+                                                                iterpool),
+                                         iterpool, iterpool));
+        }
+      else
+        {
+          SVN_ERR(svn_io_file_seek(temp_file, APR_SET, &entry->offset,
+                                   iterpool));
+          SVN_ERR(svn_fs_x__read_noderev(&noderev, stream, iterpool,
+                                         iterpool));
+        }
       svn_fs_x__noderevs_add(*container, noderev);
 
       container_size += entry->size;
@@ -1335,7 +1569,9 @@ should_flush_nodes_container(pack_context_t *context,
 }
 
 /* Read the contents of the first COUNT non-NULL, non-empty items in ITEMS
- * from TEMP_FILE and write them to CONTEXT->PACK_FILE.
+ * from TEMP_FILE and write them to CONTEXT->PACK_FILE.  The reads are
+ * batched and sorted by offset in TEMP_FILE but the items get written
+ * strictly in the order given by ITEMS.
  * Use SCRATCH_POOL for temporary allocations.
  */
 static svn_error_t *
@@ -1347,10 +1583,13 @@ store_items(pack_context_t *context,
 {
   int i;
   apr_pool_t *iterpool = svn_pool_create(scratch_pool);
+  item_reader_t *reader
+    = item_reader_create(context, temp_file, items, count, scratch_pool);
 
   /* copy all items in strict order */
   for (i = 0; i < count; ++i)
     {
+      const char *data;
       svn_fs_x__p2l_entry_t *entry
         = APR_ARRAY_IDX(items, i, svn_fs_x__p2l_entry_t *);
       if (!entry
@@ -1358,12 +1597,22 @@ store_items(pack_context_t *context,
           || entry->item_count == 0)
         continue;
 
-      /* select the item in the source file and copy it into the target
-       * pack file */
-      SVN_ERR(svn_io_file_seek(temp_file, APR_SET, &entry->offset,
-                               iterpool));
-      SVN_ERR(copy_file_data(context, context->pack_file, temp_file,
-                             entry->size, iterpool));
+      /* fetch the item from the source file and copy it into the target
+       * pack file.  Items too large for the reader get streamed. */
+      SVN_ERR(item_reader_get(&data, reader, i, iterpool));
+      if (data)
+        {
+          SVN_ERR(svn_io_file_write_full(context->pack_file, data,
+                                         (apr_size_t)entry->size, NULL,
+                                         iterpool));
+        }
+      else
+        {
+          SVN_ERR(svn_io_file_seek(temp_file, APR_SET, &entry->offset,
+                                   iterpool));
+          SVN_ERR(copy_file_data(context, context->pack_file, temp_file,
+                                 entry->size, iterpool));
+        }
 
       /* write index entry and update current position */
       entry->offset = context->pack_offset;
@@ -2068,7 +2317,7 @@ pack_shard(const char *dir,
            apr_off_t max_pack_size,
            int compression_level,
            apr_size_t max_mem,
-           svn_fs_pack_notify_t notify_func,
+           svn_fs_pack_notify2_t notify_func,
            void *notify_baton,
            svn_cancel_func_t cancel_func,
            void *cancel_baton,
@@ -2077,10 +2326,11 @@ pack_shard(const char *dir,
   svn_fs_x__data_t *ffd = fs->fsap_data;
   const char *shard_path, *pack_file_dir;
   svn_fs_x__batch_fsync_t *batch;
+  apr_time_t start_time = apr_time_now();
 
   /* Notify caller we're starting to pack this shard. */
   if (notify_func)
-    SVN_ERR(notify_func(notify_baton, shard, svn_fs_pack_notify_start,
+    SVN_ERR(notify_func(notify_baton, shard, svn_fs_pack_notify_start, 0,
                         scratch_pool));
 
   /* Perform all fsyncs through this instance. */
@@ -2128,7 +2378,7 @@ pack_shard(const char *dir,
   /* Notify caller we're starting to pack this shard. */
   if (notify_func)
     SVN_ERR(notify_func(notify_baton, shard, svn_fs_pack_notify_end,
-                        scratch_pool));
+                        apr_time_now() - start_time, scratch_pool));
 
   return SVN_NO_ERROR;
 }
@@ -2165,7 +2415,7 @@ typedef struct pack_baton_t
 {
   svn_fs_t *fs;
   apr_size_t max_mem;
-  svn_fs_pack_notify_t notify_func;
+  svn_fs_pack_notify2_t notify_func;
   void *notify_baton;
   svn_cancel_func_t cancel_func;
   void *cancel_baton;
@@ -2206,7 +2456,7 @@ pack_body(void *baton,
       if (pb->notify_func)
         SVN_ERR(pb->notify_func(pb->notify_baton,
                                 ffd->min_unpacked_rev / ffd->max_files_per_dir,
-                                svn_fs_pack_notify_noop, scratch_pool));
+                                svn_fs_pack_notify_noop, 0, scratch_pool));
 
       return SVN_NO_ERROR;
     }
@@ -2242,7 +2492,7 @@ pack_body(void *baton,
 svn_error_t *
 svn_fs_x__pack(svn_fs_t *fs,
                apr_size_t max_mem,
-               svn_fs_pack_notify_t notify_func,
+               svn_fs_pack_notify2_t notify_func,
                void *notify_baton,
                svn_cancel_func_t cancel_func,
                void *cancel_baton,
@@ -2260,7 +2510,7 @@ svn_fs_x__pack(svn_fs_t *fs,
       if (notify_func)
         SVN_ERR(notify_func(notify_baton,
                             ffd->min_unpacked_rev / ffd->max_files_per_dir,
-                            svn_fs_pack_notify_noop, scratch_pool));
+                            svn_fs_pack_notify_noop, 0, scratch_pool));
 
       return SVN_NO_ERROR;
     }
@@ -39,7 +39,7 @@
 svn_error_t *
 svn_fs_x__pack(svn_fs_t *fs,
                apr_size_t max_mem,
-               svn_fs_pack_notify_t notify_func,
+               svn_fs_pack_notify2_t notify_func,
                void *notify_baton,
                svn_cancel_func_t cancel_func,
                void *cancel_baton,
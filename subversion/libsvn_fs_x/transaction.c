@@ -45,6 +45,7 @@
 #include "batch_fsync.h"
 #include "revprops.h"
 
+#include "private/svn_delta_private.h"
 #include "private/svn_fs_util.h"
 #include "private/svn_fspath.h"
 #include "private/svn_sorts_private.h"
@@ -2250,7 +2251,7 @@ rep_write_get_baton(rep_write_baton_t **wb_p,
   svn_stream_t *source;
   svn_txdelta_window_handler_t wh;
   void *whb;
-  int diff_version = 1;
+  int diff_version = 3;
   svn_fs_x__rep_header_t header = { 0 };
   svn_fs_x__txn_id_t txn_id
     = svn_fs_x__get_txn_id(noderev->noderev_id.change_set);
@@ -2316,8 +2317,11 @@ rep_write_get_baton(rep_write_baton_t **wb_p,
                           ffd->delta_compression_level,
                           result_pool);
 
-  b->delta_stream = svn_txdelta_target_push(wh, whb, source,
-                                            b->result_pool);
+  /* File contents may be large.  Use large windows to find matches that
+     are further apart. */
+  b->delta_stream = svn_txdelta__target_push(wh, whb, source,
+                                             SVN_DELTA__LARGE_WINDOW_SIZE,
+                                             b->result_pool);
 
   *wb_p = b;
 
@@ -2886,7 +2890,7 @@ write_container_delta_rep(svn_fs_x__representation_t *rep,
   apr_off_t offset = 0;
 
   write_container_baton_t *whb;
-  int diff_version = 1;
+  int diff_version = 3;
   svn_boolean_t is_props = (item_type == SVN_FS_X__ITEM_TYPE_FILE_PROPS)
                         || (item_type == SVN_FS_X__ITEM_TYPE_DIR_PROPS);
 
@@ -634,6 +634,88 @@ svn_error_t *svn_ra_get_file(svn_ra_session_t *session,
                                    fetched_rev, props, pool);
 }
 
+/* Implement svn_ra_get_files() in terms of svn_ra_get_file().
+ * The parameters are the same as for svn_ra_get_files(). */
+static svn_error_t *
+get_files_one_by_one(svn_ra_session_t *session,
+                     const apr_array_header_t *files,
+                     svn_boolean_t want_props,
+                     svn_ra_file_receiver_t receiver,
+                     void *receiver_baton,
+                     apr_pool_t *scratch_pool)
+{
+  apr_pool_t *iterpool = svn_pool_create(scratch_pool);
+  int i;
+
+  for (i = 0; i < files->nelts; ++i)
+    {
+      const svn_ra_file_request_t *file
+        = APR_ARRAY_IDX(files, i, const svn_ra_file_request_t *);
+      svn_revnum_t fetched_rev = file->revision;
+      apr_hash_t *props = NULL;
+      svn_stream_t *stream;
+
+      svn_pool_clear(iterpool);
+
+      /* The receiver wants the actual revision and the properties before
+       * the contents.  Ask for them separately, if necessary. */
+      if (want_props || !SVN_IS_VALID_REVNUM(fetched_rev))
+        SVN_ERR(session->vtable->get_file(session, file->path,
+                                          file->revision, NULL,
+                                          &fetched_rev,
+                                          want_props ? &props : NULL,
+                                          iterpool));
+
+      SVN_ERR(receiver(&stream, receiver_baton, file->path, fetched_rev,
+                       props, iterpool));
+      if (stream)
+        SVN_ERR(session->vtable->get_file(session, file->path, fetched_rev,
+                                          stream, NULL, NULL, iterpool));
+    }
+
+  svn_pool_destroy(iterpool);
+
+  return SVN_NO_ERROR;
+}
+
+svn_error_t *
+svn_ra_get_files(svn_ra_session_t *session,
+                 const apr_array_header_t *files,
+                 svn_boolean_t want_props,
+                 svn_ra_file_receiver_t receiver,
+                 void *receiver_baton,
+                 apr_pool_t *scratch_pool)
+{
+  svn_error_t *err;
+  int i;
+
+  /* Validate path format. */
+  for (i = 0; i < files->nelts; i++)
+    {
+      const svn_ra_file_request_t *file
+        = APR_ARRAY_IDX(files, i, const svn_ra_file_request_t *);
+      SVN_ERR_ASSERT(svn_relpath_is_canonical(file->path));
+    }
+
+  if (!session->vtable->get_files)
+    return svn_error_trace(get_files_one_by_one(session, files, want_props,
+                                                receiver, receiver_baton,
+                                                scratch_pool));
+
+  err = session->vtable->get_files(session, files, want_props,
+                                   receiver, receiver_baton, scratch_pool);
+  if (err && (err->apr_err == SVN_ERR_RA_NOT_IMPLEMENTED))
+    {
+      svn_error_clear(err);
+
+      /* Do it the slow way for older servers. */
+      err = get_files_one_by_one(session, files, want_props,
+                                 receiver, receiver_baton, scratch_pool);
+    }
+
+  return svn_error_trace(err);
+}
+
 svn_error_t *svn_ra_get_dir2(svn_ra_session_t *session,
                              apr_hash_t **dirents,
                              svn_revnum_t *fetched_rev,
@@ -345,6 +345,15 @@ typedef struct svn_ra__vtable_t {
                        void *receiver_baton,
                        apr_pool_t *scratch_pool);
 
+  /* See svn_ra_get_files().  If NULL or returning
+     SVN_ERR_RA_NOT_IMPLEMENTED, the loader uses get_file() instead. */
+  svn_error_t *(*get_files)(svn_ra_session_t *session,
+                            const apr_array_header_t *files,
+                            svn_boolean_t want_props,
+                            svn_ra_file_receiver_t receiver,
+                            void *receiver_baton,
+                            apr_pool_t *scratch_pool);
+
   /* Experimental support below here */
 
   /* See svn_ra__register_editor_shim_callbacks() */
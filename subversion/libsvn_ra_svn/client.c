@@ -31,6 +31,8 @@
 #include <apr_strings.h>
 #include <apr_network_io.h>
 #include <apr_uri.h>
+#include <apr_thread_proc.h>
+#include <apr_thread_cond.h>
 
 #include "svn_hash.h"
 #include "svn_types.h"
@@ -47,10 +49,12 @@
 #include "svn_mergeinfo.h"
 #include "svn_version.h"
 #include "svn_ctype.h"
+#include "svn_sorts.h"
 
 #include "svn_private_config.h"
 
 #include "private/svn_fspath.h"
+#include "private/svn_mutex.h"
 #include "private/svn_string_private.h"
 #include "private/svn_subr_private.h"
 
@@ -81,14 +85,26 @@ typedef struct ra_svn_commit_callback_baton_t {
   void *callback_baton;
 } ra_svn_commit_callback_baton_t;
 
+/* Auxiliary connections used to fetch deferred file contents during
+   an update.  Defined further down. */
+typedef struct aux_fetch_baton_t aux_fetch_baton_t;
+
 typedef struct ra_svn_reporter_baton_t {
   svn_ra_svn__session_baton_t *sess_baton;
   svn_ra_svn_conn_t *conn;
   apr_pool_t *pool;
   const svn_delta_editor_t *editor;
   void *edit_baton;
+
+  /* Fetches deferred file contents; NULL if the server sends all
+     contents inline. */
+  aux_fetch_baton_t *aux;
 } ra_svn_reporter_baton_t;
 
+/* Forward declaration.  Fetches deferred file contents over the
+   connections of an aux_fetch_baton_t. */
+static const svn_ra_svn__fetcher_t aux_fetcher;
+
 /* Parse an svn URL's tunnel portion into tunnel, if there is a tunnel
    portion. */
 static void parse_tunnel(const char *url, const char **tunnel,
@@ -299,8 +315,9 @@ static svn_error_t *ra_svn_finish_report(void *baton,
 
   SVN_ERR(svn_ra_svn__write_cmd_finish_report(b->conn, b->pool));
   SVN_ERR(handle_auth_request(b->sess_baton, b->pool));
-  SVN_ERR(svn_ra_svn_drive_editor2(b->conn, b->pool, b->editor, b->edit_baton,
-                                   NULL, FALSE));
+  SVN_ERR(svn_ra_svn__drive_editor(b->conn, b->pool, b->editor, b->edit_baton,
+                                   NULL, FALSE,
+                                   b->aux ? &aux_fetcher : NULL, b->aux));
   SVN_ERR(svn_ra_svn__read_cmd_response(b->conn, b->pool, ""));
   return SVN_NO_ERROR;
 }
@@ -323,7 +340,8 @@ static svn_ra_reporter3_t ra_svn_reporter = {
 };
 
 /* Set *REPORTER and *REPORT_BATON to a new reporter which will drive
- * EDITOR/EDIT_BATON when it gets the finish_report() call.
+ * EDITOR/EDIT_BATON when it gets the finish_report() call.  If AUX is
+ * not NULL, use it to fetch file contents deferred by the server.
  *
  * Allocate the new reporter in POOL.
  */
@@ -332,6 +350,7 @@ ra_svn_get_reporter(svn_ra_svn__session_baton_t *sess_baton,
                     apr_pool_t *pool,
                     const svn_delta_editor_t *editor,
                     void *edit_baton,
+                    aux_fetch_baton_t *aux,
                     const char *target,
                     svn_depth_t depth,
                     const svn_ra_reporter3_t **reporter,
@@ -362,6 +381,7 @@ ra_svn_get_reporter(svn_ra_svn__session_baton_t *sess_baton,
   b->pool = pool;
   b->editor = editor;
   b->edit_baton = edit_baton;
+  b->aux = aux;
 
   *reporter = &ra_svn_reporter;
   *report_baton = b;
@@ -631,6 +651,8 @@ static svn_error_t *open_session(svn_ra_svn__session_baton_t **sess_p,
   const char *client_string = NULL;
   apr_pool_t *pool = result_pool;
   svn_ra_svn__parent_t *parent;
+  svn_ra_svn__stream_compression_t stream_compression
+    = svn_ra_svn__stream_compression_none;
 
   parent = apr_pcalloc(pool, sizeof(*parent));
   parent->client_url = svn_stringbuf_create(url, pool);
@@ -743,11 +765,18 @@ static svn_error_t *open_session(svn_ra_svn__session_baton_t **sess_p,
     return svn_error_create(SVN_ERR_RA_SVN_BAD_VERSION, NULL,
                             _("Server does not support edit pipelining"));
 
+  /* If the server offers whole-stream compression, accept it by
+   * echoing the capability. */
+  if (svn_ra_svn_has_capability(conn, SVN_RA_SVN_CAP_STREAM_LZ4))
+    stream_compression = svn_ra_svn__stream_compression_lz4;
+  else if (svn_ra_svn_has_capability(conn, SVN_RA_SVN_CAP_STREAM_ZLIB))
+    stream_compression = svn_ra_svn__stream_compression_zlib;
+
   /* In protocol version 2, we send back our protocol version, our
    * capability list, and the URL, and subsequently there is an auth
    * request. */
   /* Client-side capabilities list: */
-  SVN_ERR(svn_ra_svn__write_tuple(conn, pool, "n(wwwwwww)cc(?c)",
+  SVN_ERR(svn_ra_svn__write_tuple(conn, pool, "n(wwwwwww?w)cc(?c)",
                                   (apr_uint64_t) 2,
                                   SVN_RA_SVN_CAP_EDIT_PIPELINE,
                                   SVN_RA_SVN_CAP_SVNDIFF1,
@@ -756,9 +785,15 @@ static svn_error_t *open_session(svn_ra_svn__session_baton_t **sess_p,
                                   SVN_RA_SVN_CAP_DEPTH,
                                   SVN_RA_SVN_CAP_MERGEINFO,
                                   SVN_RA_SVN_CAP_LOG_REVPROPS,
+                                  svn_ra_svn__stream_compression_cap(
+                                    stream_compression),
                                   url,
                                   SVN_RA_SVN__DEFAULT_USERAGENT,
                                   client_string));
+
+  /* Everything after our response is compressed, if agreed upon. */
+  SVN_ERR(svn_ra_svn__enable_stream_compression(conn, stream_compression,
+                                                pool));
   SVN_ERR(handle_auth_request(sess, pool));
 
   /* This is where the security layer would go into effect if we
@@ -1436,6 +1471,69 @@ parse_iproplist(apr_array_header_t **inherited_props,
   return SVN_NO_ERROR;
 }
 
+/* Read file contents from CONN and push them into STREAM.  The contents
+ * are sent as a series of strings, terminated by the empty string and a
+ * command response.  If EXPECTED_DIGEST is not NULL, verify that the
+ * contents match that MD5 digest and use PATH in the error message.
+ * Use SCRATCH_POOL for temporary allocations. */
+static svn_error_t *
+read_file_contents(svn_ra_svn_conn_t *conn,
+                   svn_stream_t *stream,
+                   const char *expected_digest,
+                   const char *path,
+                   apr_pool_t *scratch_pool)
+{
+  svn_checksum_t *expected_checksum = NULL;
+  svn_checksum_ctx_t *checksum_ctx;
+  apr_pool_t *iterpool;
+
+  if (expected_digest)
+    {
+      SVN_ERR(svn_checksum_parse_hex(&expected_checksum, svn_checksum_md5,
+                                     expected_digest, scratch_pool));
+      checksum_ctx = svn_checksum_ctx_create(svn_checksum_md5, scratch_pool);
+    }
+
+  /* Read the file's contents. */
+  iterpool = svn_pool_create(scratch_pool);
+  while (1)
+    {
+      svn_ra_svn__item_t *item;
+
+      svn_pool_clear(iterpool);
+      SVN_ERR(svn_ra_svn__read_item(conn, iterpool, &item));
+      if (item->kind != SVN_RA_SVN_STRING)
+        return svn_error_create(SVN_ERR_RA_SVN_MALFORMED_DATA, NULL,
+                                _("Non-string as part of file contents"));
+      if (item->u.string.len == 0)
+        break;
+
+      if (expected_checksum)
+        SVN_ERR(svn_checksum_update(checksum_ctx, item->u.string.data,
+                                    item->u.string.len));
+
+      SVN_ERR(svn_stream_write(stream, item->u.string.data,
+                               &item->u.string.len));
+    }
+  svn_pool_destroy(iterpool);
+
+  SVN_ERR(svn_ra_svn__read_cmd_response(conn, scratch_pool, ""));
+
+  if (expected_checksum)
+    {
+      svn_checksum_t *checksum;
+
+      SVN_ERR(svn_checksum_final(&checksum, checksum_ctx, scratch_pool));
+      if (!svn_checksum_match(checksum, expected_checksum))
+        return svn_checksum_mismatch_err(expected_checksum, checksum,
+                                         scratch_pool,
+                                         _("Checksum mismatch for '%s'"),
+                                         path);
+    }
+
+  return SVN_NO_ERROR;
+}
+
 static svn_error_t *ra_svn_get_file(svn_ra_session_t *session, const char *path,
                                     svn_revnum_t rev, svn_stream_t *stream,
                                     svn_revnum_t *fetched_rev,
@@ -1446,9 +1544,6 @@ static svn_error_t *ra_svn_get_file(svn_ra_session_t *session, const char *path,
   svn_ra_svn_conn_t *conn = sess_baton->conn;
   svn_ra_svn__list_t *proplist;
   const char *expected_digest;
-  svn_checksum_t *expected_checksum = NULL;
-  svn_checksum_ctx_t *checksum_ctx;
-  apr_pool_t *iterpool;
 
   path = reparent_path(session, path, pool);
   SVN_ERR(svn_ra_svn__write_cmd_get_file(conn, pool, path, rev,
@@ -1467,49 +1562,626 @@ static svn_error_t *ra_svn_get_file(svn_ra_session_t *session, const char *path,
   if (!stream)
     return SVN_NO_ERROR;
 
-  if (expected_digest)
+  return svn_error_trace(read_file_contents(conn, stream, expected_digest,
+                                            path, pool));
+}
+
+/* Implement svn_ra_get_files() for SESS_BATON, whose paths are relative
+ * to PARENT_PATH on the server.  Serialize the authentication exchange
+ * through AUTH_MUTEX, which may be NULL.
+ */
+static svn_error_t *
+fetch_files(svn_ra_svn__session_baton_t *sess_baton,
+            const char *parent_path,
+            const apr_array_header_t *files,
+            svn_boolean_t want_props,
+            svn_ra_file_receiver_t receiver,
+            void *receiver_baton,
+            svn_mutex__t *auth_mutex,
+            apr_pool_t *scratch_pool)
+{
+  svn_ra_svn_conn_t *conn = sess_baton->conn;
+  apr_pool_t *iterpool;
+  int i;
+
+  if (!svn_ra_svn_has_capability(conn, SVN_RA_SVN_CAP_GET_FILES))
+    return svn_error_create(SVN_ERR_RA_NOT_IMPLEMENTED, NULL,
+                            _("Server does not support the get-files "
+                              "command"));
+
+  /* Send the whole request at once. */
+  iterpool = svn_pool_create(scratch_pool);
+  SVN_ERR(svn_ra_svn__write_tuple(conn, scratch_pool, "w((!", "get-files"));
+  for (i = 0; i < files->nelts; ++i)
     {
-      SVN_ERR(svn_checksum_parse_hex(&expected_checksum, svn_checksum_md5,
-                                     expected_digest, pool));
-      checksum_ctx = svn_checksum_ctx_create(svn_checksum_md5, pool);
+      const svn_ra_file_request_t *file
+        = APR_ARRAY_IDX(files, i, const svn_ra_file_request_t *);
+
+      svn_pool_clear(iterpool);
+      SVN_ERR(svn_ra_svn__write_tuple(conn, iterpool, "c(?r)",
+                                      svn_relpath_join(parent_path,
+                                                       file->path,
+                                                       iterpool),
+                                      file->revision));
     }
+  SVN_ERR(svn_ra_svn__write_tuple(conn, scratch_pool, "!)b)", want_props));
 
-  /* Read the file's contents. */
-  iterpool = svn_pool_create(pool);
-  while (1)
+  SVN_MUTEX__WITH_LOCK(auth_mutex,
+                       handle_auth_request(sess_baton, scratch_pool));
+  SVN_ERR(svn_ra_svn__read_cmd_response(conn, scratch_pool, ""));
+
+  /* The server now sends the files in request order, each of them just
+   * like a get-file response. */
+  for (i = 0; i < files->nelts; ++i)
     {
-      svn_ra_svn__item_t *item;
+      const svn_ra_file_request_t *file
+        = APR_ARRAY_IDX(files, i, const svn_ra_file_request_t *);
+      svn_ra_svn__list_t *proplist;
+      const char *expected_digest;
+      svn_revnum_t fetched_rev;
+      apr_hash_t *props = NULL;
+      svn_stream_t *stream;
 
       svn_pool_clear(iterpool);
-      SVN_ERR(svn_ra_svn__read_item(conn, iterpool, &item));
-      if (item->kind != SVN_RA_SVN_STRING)
-        return svn_error_create(SVN_ERR_RA_SVN_MALFORMED_DATA, NULL,
-                                _("Non-string as part of file contents"));
-      if (item->u.string.len == 0)
-        break;
+      SVN_ERR(svn_ra_svn__read_cmd_response(conn, iterpool, "(?c)rl",
+                                            &expected_digest,
+                                            &fetched_rev, &proplist));
+      if (want_props)
+        SVN_ERR(svn_ra_svn__parse_proplist(proplist, iterpool, &props));
 
-      if (expected_checksum)
-        SVN_ERR(svn_checksum_update(checksum_ctx, item->u.string.data,
-                                    item->u.string.len));
+      SVN_ERR(receiver(&stream, receiver_baton, file->path, fetched_rev,
+                       props, iterpool));
 
-      SVN_ERR(svn_stream_write(stream, item->u.string.data,
-                               &item->u.string.len));
+      /* The contents will be sent anyway. */
+      if (!stream)
+        stream = svn_stream_empty(iterpool);
+
+      SVN_ERR(read_file_contents(conn, stream, expected_digest, file->path,
+                                 iterpool));
     }
   svn_pool_destroy(iterpool);
 
-  SVN_ERR(svn_ra_svn__read_cmd_response(conn, pool, ""));
+  return SVN_NO_ERROR;
+}
 
-  if (expected_checksum)
+static svn_error_t *
+ra_svn_get_files(svn_ra_session_t *session,
+                 const apr_array_header_t *files,
+                 svn_boolean_t want_props,
+                 svn_ra_file_receiver_t receiver,
+                 void *receiver_baton,
+                 apr_pool_t *scratch_pool)
+{
+  svn_ra_svn__session_baton_t *sess_baton = session->priv;
+
+  return svn_error_trace(fetch_files(sess_baton,
+                                     sess_baton->parent->path->data,
+                                     files, want_props,
+                                     receiver, receiver_baton,
+                                     NULL, scratch_pool));
+}
+
+/* --- FETCHING DEFERRED CONTENTS OVER AUXILIARY CONNECTIONS --- */
+
+/* Files of at least this size get fetched over auxiliary connections
+   during updates, if the user allows for more than one connection. */
+#define DEFER_CONTENTS_MIN_SIZE (256 * 1024)
+
+/* Upper limit for svn-max-connections. */
+#define MAX_CONNECTIONS 16
+
+/* Contents fetched in advance get buffered in memory up to this size
+   per file and spill to a temporary file beyond that. */
+#define FETCH_SPILL_MAXSIZE (256 * 1024)
+
+/* Maximum number of files to request with a single get-files command. */
+#define FETCH_BATCH_SIZE 8
+
+/* Maximum number of files being fetched or waiting to be applied.
+   Limits the amount of buffered contents. */
+#define FETCH_MAX_BUFFERED 64
+
+/* A file to fetch over an auxiliary connection. */
+typedef struct aux_fetch_t
+{
+  /* What to fetch. */
+  svn_ra_file_request_t request;
+
+  /* The baton given to aux_fetch_start(). */
+  void *file_baton;
+
+  /* The fetched contents and the pool holding them. */
+  svn_stream_t *contents;
+  apr_pool_t *pool;
+
+  /* Next file in the same list. */
+  struct aux_fetch_t *next;
+} aux_fetch_t;
+
+/* A simple FIFO list of aux_fetch_t. */
+typedef struct aux_fetch_list_t
+{
+  aux_fetch_t *first;
+  aux_fetch_t *last;
+} aux_fetch_list_t;
+
+struct aux_fetch_baton_t
+{
+  /* Sessions opened at the repository root, one per auxiliary
+     connection.  Each has its own allocator, so it can be used by a
+     different thread than the main session. */
+  svn_ra_svn__session_baton_t **sessions;
+  int count;
+
+  /* Root pool with a thread-safe allocator.  The list elements get
+     allocated directly in it while holding MUTEX; the fetched contents
+     live in subpools. */
+  apr_pool_t *pool;
+
+  /* Files waiting for a connection and fetched files waiting to be
+     returned by aux_fetch_next(), in the order they completed. */
+  aux_fetch_list_t queued;
+  aux_fetch_list_t done;
+
+  /* Number of files currently being fetched. */
+  int in_flight;
+
+  /* Number of files in DONE. */
+  int done_count;
+
+  /* Pool of the contents last returned by aux_fetch_next(). */
+  apr_pool_t *returned_pool;
+
+  /* Errors returned by the auxiliary connections.  Owned by AUX. */
+  svn_error_t *err;
+
+#if APR_HAS_THREADS
+  /* Protects all of the above, except SESSIONS and COUNT. */
+  apr_thread_mutex_t *mutex;
+
+  /* Signaled whenever a file gets queued, fetched or returned. */
+  apr_thread_cond_t *changed;
+
+  /* One worker thread per connection. */
+  apr_thread_t **threads;
+  int thread_count;
+
+  /* Set during cleanup to make the workers exit. */
+  svn_boolean_t shutdown;
+#endif
+
+  /* Authentication prompts and the auth baton are not thread-safe. */
+  svn_mutex__t *auth_mutex;
+};
+
+/* The files of one get-files command. */
+typedef struct aux_fetch_batch_t
+{
+  aux_fetch_baton_t *aux;
+
+  /* The files, as aux_fetch_t *, and the number of them received. */
+  apr_array_header_t *files;
+  int received;
+} aux_fetch_batch_t;
+
+/* Lock and unlock the mutex of AUX, if there is one. */
+static void
+aux_fetch_lock(aux_fetch_baton_t *aux)
+{
+#if APR_HAS_THREADS
+  apr_thread_mutex_lock(aux->mutex);
+#endif
+}
+
+static void
+aux_fetch_unlock(aux_fetch_baton_t *aux)
+{
+#if APR_HAS_THREADS
+  apr_thread_mutex_unlock(aux->mutex);
+#endif
+}
+
+/* Wake up everyone waiting for AUX to change.  Call this with the mutex
+   being held. */
+static void
+aux_fetch_signal(aux_fetch_baton_t *aux)
+{
+#if APR_HAS_THREADS
+  apr_thread_cond_broadcast(aux->changed);
+#endif
+}
+
+/* Append FETCH to LIST. */
+static void
+aux_fetch_list_push(aux_fetch_list_t *list,
+                    aux_fetch_t *fetch)
+{
+  fetch->next = NULL;
+  if (list->last)
+    list->last->next = fetch;
+  else
+    list->first = fetch;
+  list->last = fetch;
+}
+
+/* Remove the first element from the non-empty LIST and return it. */
+static aux_fetch_t *
+aux_fetch_list_pop(aux_fetch_list_t *list)
+{
+  aux_fetch_t *fetch = list->first;
+
+  list->first = fetch->next;
+  if (!list->first)
+    list->last = NULL;
+
+  return fetch;
+}
+
+/* Pool cleanup function destroying the pool given as DATA. */
+static apr_status_t
+destroy_pool(void *data)
+{
+  svn_pool_destroy(data);
+  return APR_SUCCESS;
+}
+
+/* Implements svn_ra_file_receiver_t.  Buffer the contents in a new spill
+   buffer stream in a new subpool of the aux_fetch_batch_t BATON's pool. */
+static svn_error_t *
+spill_contents(svn_stream_t **stream,
+               void *baton,
+               const char *path,
+               svn_revnum_t fetched_rev,
+               apr_hash_t *props,
+               apr_pool_t *scratch_pool)
+{
+  aux_fetch_batch_t *batch = baton;
+  aux_fetch_t *fetch = APR_ARRAY_IDX(batch->files, batch->received,
+                                     aux_fetch_t *);
+  svn_spillbuf_t *buffer;
+
+  fetch->pool = svn_pool_create(batch->aux->pool);
+  buffer = svn_spillbuf__create(SVN__STREAM_CHUNK_SIZE, FETCH_SPILL_MAXSIZE,
+                                fetch->pool);
+  fetch->contents = svn_stream__from_spillbuf(buffer, fetch->pool);
+  batch->received++;
+
+  *stream = fetch->contents;
+  return SVN_NO_ERROR;
+}
+
+/* Take up to FETCH_BATCH_SIZE files from the queue of AUX, as long as
+   that keeps the number of buffered files within FETCH_MAX_BUFFERED, and
+   fetch them over SESSION.  Move them to the list of completed files
+   afterwards.  Call this with the mutex being held; it will be released
+   while talking to the server.  Set *FETCHED to whether any files were
+   taken from the queue.  Use SCRATCH_POOL for temporary allocations. */
+static void
+aux_fetch_batch(svn_boolean_t *fetched,
+                aux_fetch_baton_t *aux,
+                svn_ra_svn__session_baton_t *session,
+                apr_pool_t *scratch_pool)
+{
+  aux_fetch_batch_t batch;
+  apr_array_header_t *requests;
+  svn_error_t *err;
+  int room = FETCH_MAX_BUFFERED - aux->in_flight - aux->done_count;
+  int i;
+
+  *fetched = FALSE;
+  if (!aux->queued.first || room <= 0)
+    return;
+
+  batch.aux = aux;
+  batch.files = apr_array_make(scratch_pool, FETCH_BATCH_SIZE,
+                               sizeof(aux_fetch_t *));
+  batch.received = 0;
+  requests = apr_array_make(scratch_pool, FETCH_BATCH_SIZE,
+                            sizeof(svn_ra_file_request_t *));
+  while (aux->queued.first
+         && batch.files->nelts < MIN(room, FETCH_BATCH_SIZE))
     {
-      svn_checksum_t *checksum;
+      aux_fetch_t *fetch = aux_fetch_list_pop(&aux->queued);
+      APR_ARRAY_PUSH(batch.files, aux_fetch_t *) = fetch;
+      APR_ARRAY_PUSH(requests, svn_ra_file_request_t *) = &fetch->request;
+    }
 
-      SVN_ERR(svn_checksum_final(&checksum, checksum_ctx, pool));
-      if (!svn_checksum_match(checksum, expected_checksum))
-        return svn_checksum_mismatch_err(expected_checksum, checksum, pool,
-                                         _("Checksum mismatch for '%s'"),
-                                         path);
+  aux->in_flight += batch.files->nelts;
+  aux_fetch_unlock(aux);
+
+  err = fetch_files(session, "", requests, FALSE, spill_contents, &batch,
+                    aux->auth_mutex, scratch_pool);
+
+  aux_fetch_lock(aux);
+  aux->in_flight -= batch.files->nelts;
+  if (err)
+    aux->err = svn_error_compose_create(aux->err, err);
+  else
+    for (i = 0; i < batch.files->nelts; ++i)
+      {
+        aux_fetch_list_push(&aux->done,
+                            APR_ARRAY_IDX(batch.files, i, aux_fetch_t *));
+        aux->done_count++;
+      }
+
+  aux_fetch_signal(aux);
+  *fetched = TRUE;
+}
+
+#if APR_HAS_THREADS
+/* Data passed to aux_fetch_thread(). */
+typedef struct aux_fetch_thread_baton_t
+{
+  aux_fetch_baton_t *aux;
+  svn_ra_svn__session_baton_t *session;
+} aux_fetch_thread_baton_t;
+
+/* Worker thread function.  Fetch queued files of the aux_fetch_baton_t
+   in the aux_fetch_thread_baton_t DATA over its session until cleanup
+   or until the connection fails. */
+static void * APR_THREAD_FUNC
+aux_fetch_thread(apr_thread_t *thread, void *data)
+{
+  aux_fetch_thread_baton_t *baton = data;
+  aux_fetch_baton_t *aux = baton->aux;
+  apr_pool_t *iterpool = svn_pool_create(baton->session->pool);
+
+  aux_fetch_lock(aux);
+  while (!aux->shutdown && !aux->err)
+    {
+      svn_boolean_t fetched;
+
+      svn_pool_clear(iterpool);
+      aux_fetch_batch(&fetched, aux, baton->session, iterpool);
+      if (!fetched)
+        apr_thread_cond_wait(aux->changed, aux->mutex);
+    }
+  aux_fetch_unlock(aux);
+
+  svn_pool_destroy(iterpool);
+
+  /* End thread explicitly to prevent APR_INCOMPLETE return codes in
+     apr_thread_join(). */
+  apr_thread_exit(thread, APR_SUCCESS);
+  return NULL;
+}
+#endif
+
+/* Pool cleanup function stopping the worker threads of the
+   aux_fetch_baton_t DATA. */
+static apr_status_t
+aux_fetch_cleanup(void *data)
+{
+  aux_fetch_baton_t *aux = data;
+#if APR_HAS_THREADS
+  int i;
+
+  aux_fetch_lock(aux);
+  aux->shutdown = TRUE;
+  aux_fetch_signal(aux);
+  aux_fetch_unlock(aux);
+
+  for (i = 0; i < aux->thread_count; ++i)
+    {
+      apr_status_t thread_status;
+      apr_thread_join(&thread_status, aux->threads[i]);
+    }
+#endif
+
+  svn_error_clear(aux->err);
+  return APR_SUCCESS;
+}
+
+/* Implements svn_ra_svn__fetcher_t.fetch_start for an aux_fetch_baton_t
+   BATON. */
+static svn_error_t *
+aux_fetch_start(void *baton,
+                const svn_ra_file_request_t *file,
+                void *file_baton,
+                apr_pool_t *scratch_pool)
+{
+  aux_fetch_baton_t *aux = baton;
+  aux_fetch_t *fetch;
+
+  aux_fetch_lock(aux);
+  fetch = apr_pcalloc(aux->pool, sizeof(*fetch));
+  fetch->request.path = apr_pstrdup(aux->pool, file->path);
+  fetch->request.revision = file->revision;
+  fetch->file_baton = file_baton;
+  aux_fetch_list_push(&aux->queued, fetch);
+  aux_fetch_signal(aux);
+  aux_fetch_unlock(aux);
+
+  return SVN_NO_ERROR;
+}
+
+/* Implements svn_ra_svn__fetcher_t.fetch_next for an aux_fetch_baton_t
+   BATON. */
+static svn_error_t *
+aux_fetch_next(void **file_baton,
+               svn_stream_t **contents,
+               void *baton,
+               apr_pool_t *scratch_pool)
+{
+  aux_fetch_baton_t *aux = baton;
+  aux_fetch_t *fetch = NULL;
+  svn_error_t *err;
+
+  aux_fetch_lock(aux);
+  if (aux->returned_pool)
+    {
+      svn_pool_destroy(aux->returned_pool);
+      aux->returned_pool = NULL;
     }
 
+  while (!aux->err && !aux->done.first
+         && (aux->queued.first || aux->in_flight))
+    {
+#if APR_HAS_THREADS
+      apr_thread_cond_wait(aux->changed, aux->mutex);
+#else
+      svn_boolean_t fetched;
+      aux_fetch_batch(&fetched, aux, aux->sessions[0], scratch_pool);
+#endif
+    }
+
+  /* Failed connections stop all workers, so keep reporting the error. */
+  err = aux->err ? svn_error_dup(aux->err) : SVN_NO_ERROR;
+  if (!err && aux->done.first)
+    {
+      fetch = aux_fetch_list_pop(&aux->done);
+      aux->done_count--;
+      aux->returned_pool = fetch->pool;
+      aux_fetch_signal(aux);
+    }
+  aux_fetch_unlock(aux);
+  SVN_ERR(err);
+
+  *file_baton = fetch ? fetch->file_baton : NULL;
+  *contents = fetch ? fetch->contents : NULL;
+
+  return SVN_NO_ERROR;
+}
+
+/* Fetches deferred file contents over an aux_fetch_baton_t. */
+static const svn_ra_svn__fetcher_t aux_fetcher =
+{
+  aux_fetch_start,
+  aux_fetch_next
+};
+
+/* If the user configured svn-max-connections > 1 for the server of SESS
+ * and the server is able to defer file contents, open the extra sessions,
+ * start a worker thread for each of them and return them in *AUX_P.
+ * Otherwise, set *AUX_P to NULL.  Failing to open extra connections is
+ * not an error; we simply use fewer of them.
+ *
+ * Allocate the result in RESULT_POOL and use SCRATCH_POOL for temporary
+ * allocations.
+ */
+static svn_error_t *
+open_aux_sessions(aux_fetch_baton_t **aux_p,
+                  svn_ra_svn__session_baton_t *sess,
+                  apr_pool_t *result_pool,
+                  apr_pool_t *scratch_pool)
+{
+  svn_ra_svn_conn_t *conn = sess->conn;
+  svn_config_t *cfg;
+  const char *server_group;
+  apr_int64_t max_connections;
+  svn_ra_callbacks2_t *callbacks;
+  aux_fetch_baton_t *aux;
+  apr_uri_t uri;
+  int i;
+#if APR_HAS_THREADS
+  apr_status_t status;
+#endif
+
+  *aux_p = NULL;
+  cfg = sess->config ? svn_hash_gets(sess->config,
+                                     SVN_CONFIG_CATEGORY_SERVERS)
+                     : NULL;
+  if (!cfg || !conn->repos_root
+      || !svn_ra_svn_has_capability(conn, SVN_RA_SVN_CAP_DEFER_CONTENTS)
+      || !svn_ra_svn_has_capability(conn, SVN_RA_SVN_CAP_GET_FILES))
+    return SVN_NO_ERROR;
+
+  SVN_ERR(svn_config_get_int64(cfg, &max_connections,
+                               SVN_CONFIG_SECTION_GLOBAL,
+                               SVN_CONFIG_OPTION_SVN_MAX_CONNECTIONS,
+                               SVN_CONFIG_DEFAULT_OPTION_SVN_MAX_CONNECTIONS));
+  server_group = svn_config_find_group(cfg, sess->hostname,
+                                       SVN_CONFIG_SECTION_GROUPS,
+                                       scratch_pool);
+  if (server_group)
+    SVN_ERR(svn_config_get_int64(cfg, &max_connections, server_group,
+                                 SVN_CONFIG_OPTION_SVN_MAX_CONNECTIONS,
+                                 max_connections));
+  if (max_connections <= 1)
+    return SVN_NO_ERROR;
+
+  max_connections = MIN(max_connections, MAX_CONNECTIONS);
+
+  /* Connect to the repository root as the same user. */
+  SVN_ERR(parse_url(conn->repos_root, &uri, result_pool));
+  uri.user = sess->user ? apr_pstrdup(result_pool, sess->user) : NULL;
+
+  /* Progress gets reported for the main connection only. */
+  callbacks = apr_pmemdup(result_pool, sess->callbacks, sizeof(*callbacks));
+  callbacks->progress_func = NULL;
+
+  aux = apr_pcalloc(result_pool, sizeof(*aux));
+  aux->sessions = apr_pcalloc(result_pool, (max_connections - 1)
+                                           * sizeof(*aux->sessions));
+  for (i = 0; i < max_connections - 1; ++i)
+    {
+      apr_pool_t *sess_pool
+        = apr_allocator_owner_get(svn_pool_create_allocator(FALSE));
+      svn_ra_svn__session_baton_t *aux_sess;
+      svn_error_t *err;
+
+      apr_pool_cleanup_register(result_pool, sess_pool, destroy_pool,
+                                apr_pool_cleanup_null);
+      err = open_session(&aux_sess, conn->repos_root, &uri,
+                         sess->tunnel_name, sess->tunnel_argv, sess->config,
+                         callbacks, sess->callbacks_baton, sess->auth_baton,
+                         sess_pool, scratch_pool);
+      if (err)
+        {
+          svn_error_clear(err);
+          break;
+        }
+
+      aux->sessions[aux->count++] = aux_sess;
+    }
+
+  if (aux->count == 0)
+    return SVN_NO_ERROR;
+
+  SVN_ERR(svn_mutex__init(&aux->auth_mutex, TRUE, result_pool));
+  aux->pool = apr_allocator_owner_get(svn_pool_create_allocator(TRUE));
+  apr_pool_cleanup_register(result_pool, aux->pool, destroy_pool,
+                            apr_pool_cleanup_null);
+
+#if APR_HAS_THREADS
+  status = apr_thread_mutex_create(&aux->mutex, APR_THREAD_MUTEX_DEFAULT,
+                                   result_pool);
+  if (status)
+    return svn_error_wrap_apr(status, _("Can't create mutex"));
+
+  status = apr_thread_cond_create(&aux->changed, result_pool);
+  if (status)
+    return svn_error_wrap_apr(status, _("Can't create condition variable"));
+#endif
+
+  /* Registered last, so the workers stop before their sessions and
+     buffers get destroyed. */
+  apr_pool_cleanup_register(result_pool, aux, aux_fetch_cleanup,
+                            apr_pool_cleanup_null);
+
+#if APR_HAS_THREADS
+  /* Start one worker per connection.  They pick up files as soon as
+     the update editor announces them. */
+  aux->threads = apr_pcalloc(result_pool,
+                             aux->count * sizeof(*aux->threads));
+  for (i = 0; i < aux->count; ++i)
+    {
+      aux_fetch_thread_baton_t *baton
+        = apr_pcalloc(result_pool, sizeof(*baton));
+
+      baton->aux = aux;
+      baton->session = aux->sessions[i];
+      status = apr_thread_create(&aux->threads[aux->thread_count], NULL,
+                                 aux_fetch_thread, baton, result_pool);
+      if (status)
+        return svn_error_wrap_apr(status, _("Can't create thread"));
+
+      aux->thread_count++;
+    }
+#endif
+
+  *aux_p = aux;
+
   return SVN_NO_ERROR;
 }
 
@@ -1720,20 +2392,25 @@ static svn_error_t *ra_svn_update(svn_ra_session_t *session,
   svn_ra_svn__session_baton_t *sess_baton = session->priv;
   svn_ra_svn_conn_t *conn = sess_baton->conn;
   svn_boolean_t recurse = DEPTH_TO_RECURSE(depth);
+  aux_fetch_baton_t *aux;
 
   /* Callbacks may assume that all data is relative the sessions's URL. */
   SVN_ERR(ensure_exact_server_parent(session, scratch_pool));
 
+  /* Large file contents may be fetched over extra connections. */
+  SVN_ERR(open_aux_sessions(&aux, sess_baton, pool, scratch_pool));
+
   /* Tell the server we want to start an update. */
   SVN_ERR(svn_ra_svn__write_cmd_update(conn, pool, rev, target, recurse,
                                        depth, send_copyfrom_args,
-                                       ignore_ancestry));
+                                       ignore_ancestry,
+                                       aux ? DEFER_CONTENTS_MIN_SIZE : 0));
   SVN_ERR(handle_auth_request(sess_baton, pool));
 
   /* Fetch a reporter for the caller to drive.  The reporter will drive
    * update_editor upon finish_report(). */
   SVN_ERR(ra_svn_get_reporter(sess_baton, pool, update_editor, update_baton,
-                              target, depth, reporter, report_baton));
+                              aux, target, depth, reporter, report_baton));
   return SVN_NO_ERROR;
 }
 
@@ -1767,7 +2444,7 @@ ra_svn_switch(svn_ra_session_t *session,
   /* Fetch a reporter for the caller to drive.  The reporter will drive
    * update_editor upon finish_report(). */
   SVN_ERR(ra_svn_get_reporter(sess_baton, pool, update_editor, update_baton,
-                              target, depth, reporter, report_baton));
+                              NULL, target, depth, reporter, report_baton));
   return SVN_NO_ERROR;
 }
 
@@ -1794,7 +2471,7 @@ static svn_error_t *ra_svn_status(svn_ra_session_t *session,
   /* Fetch a reporter for the caller to drive.  The reporter will drive
    * status_editor upon finish_report(). */
   SVN_ERR(ra_svn_get_reporter(sess_baton, pool, status_editor, status_baton,
-                              target, depth, reporter, report_baton));
+                              NULL, target, depth, reporter, report_baton));
   return SVN_NO_ERROR;
 }
 
@@ -1825,7 +2502,7 @@ static svn_error_t *ra_svn_diff(svn_ra_session_t *session,
   /* Fetch a reporter for the caller to drive.  The reporter will drive
    * diff_editor upon finish_report(). */
   SVN_ERR(ra_svn_get_reporter(sess_baton, pool, diff_editor, diff_baton,
-                              target, depth, reporter, report_baton));
+                              NULL, target, depth, reporter, report_baton));
   return SVN_NO_ERROR;
 }
 
@@ -3298,6 +3975,7 @@ static const svn_ra__vtable_t ra_svn_vtable = {
   ra_svn_get_inherited_props,
   NULL /* ra_set_svn_ra_open */,
   ra_svn_list,
+  ra_svn_get_files,
   ra_svn_register_editor_shim_callbacks,
   NULL /* commit_ev2 */,
   NULL /* replay_range_ev2 */
@@ -34,9 +34,11 @@
 #include "svn_error.h"
 #include "svn_delta.h"
 #include "svn_dirent_uri.h"
+#include "svn_ra.h"
 #include "svn_ra_svn.h"
 #include "svn_path.h"
 #include "svn_pools.h"
+#include "svn_sorts.h"
 #include "svn_private_config.h"
 
 #include "private/svn_atomic.h"
@@ -62,6 +64,11 @@ typedef struct ra_svn_edit_baton_t {
   void *callback_baton;
   apr_uint64_t next_token;
   svn_boolean_t got_status;
+
+  /* Decides which file contents to announce with "fetch-file".
+     May be NULL. */
+  svn_ra_svn__defer_contents_func_t defer_func;
+  void *defer_baton;
 } ra_svn_edit_baton_t;
 
 /* Works for both directories and files. */
@@ -70,8 +77,27 @@ typedef struct ra_svn_baton_t {
   apr_pool_t *pool;
   ra_svn_edit_baton_t *eb;
   svn_string_t *token;
+
+  /* Path of the file relative to the edit root.  Only set for files
+     and only if EB->DEFER_FUNC is not NULL. */
+  const char *path;
 } ra_svn_baton_t;
 
+/* A file whose contents the server told us to fetch separately. */
+typedef struct ra_svn_deferred_file_t {
+  /* The editor's file baton. */
+  void *baton;
+
+  /* What to fetch. */
+  svn_ra_file_request_t request;
+
+  /* Checksum received with close-file. */
+  const char *text_checksum;
+
+  /* Pool holding the file baton. */
+  apr_pool_t *pool;
+} ra_svn_deferred_file_t;
+
 /* Forward declaration. */
 typedef struct ra_svn_token_entry_t ra_svn_token_entry_t;
 
@@ -88,6 +114,10 @@ typedef struct ra_svn_driver_state_t {
   apr_pool_t *file_pool;
   int file_refs;
   svn_boolean_t for_replay;
+
+  /* Retrieves deferred file contents.  May be NULL. */
+  const svn_ra_svn__fetcher_t *fetcher;
+  void *fetch_baton;
 } ra_svn_driver_state_t;
 
 /* Works for both directories and files; however, the pool handling is
@@ -98,13 +128,20 @@ typedef struct ra_svn_driver_state_t {
    at close_file time when the reference count hits zero.  So the pool
    field in this structure is vestigial for files, and we use it for a
    different purpose instead: at apply-textdelta time, we set it to a
-   subpool of the file pool, which is destroyed in textdelta-end. */
+   subpool of the file pool, which is destroyed in textdelta-end.
+
+   If the driver accepts "fetch-file" commands, files whose contents
+   get deferred stay open until the end of the edit.  A shared pool
+   would then never be cleared.  Hence, every file gets its own pool
+   in that mode, stored in the OWN_POOL member. */
 struct ra_svn_token_entry_t {
   svn_string_t *token;
   void *baton;
   svn_boolean_t is_file;
   svn_stream_t *dstream;  /* svndiff stream for apply_textdelta */
   apr_pool_t *pool;
+  apr_pool_t *own_pool;
+  ra_svn_deferred_file_t *deferred;
 };
 
 /* --- CONSUMING AN EDITOR BY PASSING EDIT OPERATIONS OVER THE NET --- */
@@ -134,6 +171,7 @@ static ra_svn_baton_t *ra_svn_make_baton(svn_ra_svn_conn_t *conn,
   b->pool = pool;
   b->eb = eb;
   b->token = token;
+  b->path = NULL;
   return b;
 }
 
@@ -289,6 +327,8 @@ static svn_error_t *ra_svn_add_file(const char *path,
   SVN_ERR(svn_ra_svn__write_cmd_add_file(b->conn, pool,  path, b->token,
                                          token, copy_path, copy_rev));
   *file_baton = ra_svn_make_baton(b->conn, pool, b->eb, token);
+  if (b->eb->defer_func)
+    ((ra_svn_baton_t *)*file_baton)->path = apr_pstrdup(pool, path);
   return SVN_NO_ERROR;
 }
 
@@ -305,6 +345,8 @@ static svn_error_t *ra_svn_open_file(const char *path,
   SVN_ERR(svn_ra_svn__write_cmd_open_file(b->conn, pool, path, b->token,
                                           token, rev));
   *file_baton = ra_svn_make_baton(b->conn, pool, b->eb, token);
+  if (b->eb->defer_func)
+    ((ra_svn_baton_t *)*file_baton)->path = apr_pstrdup(pool, path);
   return SVN_NO_ERROR;
 }
 
@@ -339,6 +381,27 @@ static svn_error_t *ra_svn_apply_textdelta(void *file_baton,
   ra_svn_baton_t *b = file_baton;
   svn_stream_t *diff_stream;
 
+  /* Contents sent without a delta base may be fetched by the client
+   * through a separate connection instead.  The no-op handler tells
+   * our driver to not even bother producing the delta. */
+  if (b->path && !base_checksum)
+    {
+      const char *fetch_path;
+      svn_revnum_t fetch_rev;
+
+      SVN_ERR(b->eb->defer_func(&fetch_path, &fetch_rev, b->eb->defer_baton,
+                                b->path, pool));
+      if (fetch_path)
+        {
+          SVN_ERR(check_for_error(b->eb, pool));
+          SVN_ERR(svn_ra_svn__write_cmd_fetch_file(b->conn, pool, b->token,
+                                                   fetch_path, fetch_rev));
+          *wh = svn_delta_noop_window_handler;
+          *wh_baton = NULL;
+          return SVN_NO_ERROR;
+        }
+    }
+
   /* Tell the other side we're starting a text delta. */
   SVN_ERR(check_for_error(b->eb, pool));
   SVN_ERR(svn_ra_svn__write_cmd_apply_textdelta(b->conn, pool, b->token,
@@ -429,11 +492,15 @@ static svn_error_t *ra_svn_abort_edit(void *edit_baton, apr_pool_t *pool)
   return SVN_NO_ERROR;
 }
 
-void svn_ra_svn_get_editor(const svn_delta_editor_t **editor,
-                           void **edit_baton, svn_ra_svn_conn_t *conn,
-                           apr_pool_t *pool,
-                           svn_ra_svn_edit_callback callback,
-                           void *callback_baton)
+void
+svn_ra_svn__get_editor(const svn_delta_editor_t **editor,
+                       void **edit_baton,
+                       svn_ra_svn_conn_t *conn,
+                       apr_pool_t *pool,
+                       svn_ra_svn_edit_callback callback,
+                       void *callback_baton,
+                       svn_ra_svn__defer_contents_func_t defer_func,
+                       void *defer_baton)
 {
   svn_delta_editor_t *ra_svn_editor = svn_delta_default_editor(pool);
   ra_svn_edit_baton_t *eb;
@@ -444,6 +511,8 @@ void svn_ra_svn_get_editor(const svn_delta_editor_t **editor,
   eb->callback_baton = callback_baton;
   eb->next_token = 0;
   eb->got_status = FALSE;
+  eb->defer_func = defer_func;
+  eb->defer_baton = defer_baton;
 
   ra_svn_editor->set_target_revision = ra_svn_target_rev;
   ra_svn_editor->open_root = ra_svn_open_root;
@@ -471,6 +540,16 @@ void svn_ra_svn_get_editor(const svn_delta_editor_t **editor,
                                            pool, pool));
 }
 
+void svn_ra_svn_get_editor(const svn_delta_editor_t **editor,
+                           void **edit_baton, svn_ra_svn_conn_t *conn,
+                           apr_pool_t *pool,
+                           svn_ra_svn_edit_callback callback,
+                           void *callback_baton)
+{
+  svn_ra_svn__get_editor(editor, edit_baton, conn, pool, callback,
+                         callback_baton, NULL, NULL);
+}
+
 /* --- DRIVING AN EDITOR --- */
 
 /* Store a token entry.  The token string will be copied into pool. */
@@ -488,6 +567,8 @@ static ra_svn_token_entry_t *store_token(ra_svn_driver_state_t *ds,
   entry->is_file = is_file;
   entry->dstream = NULL;
   entry->pool = pool;
+  entry->own_pool = NULL;
+  entry->deferred = NULL;
 
   apr_hash_set(ds->tokens, entry->token->data, entry->token->len, entry);
   ds->last_token = entry;
@@ -516,6 +597,23 @@ static svn_error_t *lookup_token(ra_svn_driver_state_t *ds,
   return SVN_NO_ERROR;
 }
 
+/* Return the pool to allocate the baton of a newly opened file in.  If
+   the file gets its own pool, set *OWN_POOL to it, else set it to NULL. */
+static apr_pool_t *
+get_file_pool(ra_svn_driver_state_t *ds,
+              apr_pool_t **own_pool)
+{
+  if (ds->fetcher)
+    {
+      *own_pool = svn_pool_create(ds->pool);
+      return *own_pool;
+    }
+
+  *own_pool = NULL;
+  ds->file_refs++;
+  return ds->file_pool;
+}
+
 /* Remove a TOKEN entry from DS. */
 static void remove_token(ra_svn_driver_state_t *ds,
                          svn_string_t *token)
@@ -706,11 +804,12 @@ ra_svn_handle_add_file(svn_ra_svn_conn_t *conn,
   svn_string_t *token, *file_token;
   svn_revnum_t copy_rev;
   ra_svn_token_entry_t *entry, *file_entry;
+  apr_pool_t *file_pool, *own_pool;
 
   SVN_ERR(svn_ra_svn__parse_tuple(params, "css(?cr)", &path, &token,
                                   &file_token, &copy_path, &copy_rev));
   SVN_ERR(lookup_token(ds, token, FALSE, &entry));
-  ds->file_refs++;
+  file_pool = get_file_pool(ds, &own_pool);
 
   /* The PATH should be canonical .. but never trust incoming data. */
   if (!svn_relpath_is_canonical(path))
@@ -726,9 +825,10 @@ ra_svn_handle_add_file(svn_ra_svn_conn_t *conn,
         copy_path = svn_fspath__canonicalize(copy_path, pool);
     }
 
-  file_entry = store_token(ds, NULL, file_token, TRUE, ds->file_pool);
+  file_entry = store_token(ds, NULL, file_token, TRUE, file_pool);
+  file_entry->own_pool = own_pool;
   SVN_CMD_ERR(ds->editor->add_file(path, entry->baton, copy_path, copy_rev,
-                                   ds->file_pool, &file_entry->baton));
+                                   file_pool, &file_entry->baton));
   return SVN_NO_ERROR;
 }
 
@@ -742,18 +842,20 @@ ra_svn_handle_open_file(svn_ra_svn_conn_t *conn,
   svn_string_t *token, *file_token;
   svn_revnum_t rev;
   ra_svn_token_entry_t *entry, *file_entry;
+  apr_pool_t *file_pool, *own_pool;
 
   SVN_ERR(svn_ra_svn__parse_tuple(params, "css(?r)", &path, &token,
                                   &file_token, &rev));
   SVN_ERR(lookup_token(ds, token, FALSE, &entry));
-  ds->file_refs++;
+  file_pool = get_file_pool(ds, &own_pool);
 
   /* The PATH should be canonical .. but never trust incoming data. */
   if (!svn_relpath_is_canonical(path))
     path = svn_relpath_canonicalize(path, pool);
 
-  file_entry = store_token(ds, NULL, file_token, TRUE, ds->file_pool);
-  SVN_CMD_ERR(ds->editor->open_file(path, entry->baton, rev, ds->file_pool,
+  file_entry = store_token(ds, NULL, file_token, TRUE, file_pool);
+  file_entry->own_pool = own_pool;
+  SVN_CMD_ERR(ds->editor->open_file(path, entry->baton, rev, file_pool,
                                     &file_entry->baton));
   return SVN_NO_ERROR;
 }
@@ -774,7 +876,7 @@ ra_svn_handle_apply_textdelta(svn_ra_svn_conn_t *conn,
   SVN_ERR(svn_ra_svn__parse_tuple(params, "s(?c)",
                                   &token, &base_checksum));
   SVN_ERR(lookup_token(ds, token, TRUE, &entry));
-  if (entry->dstream)
+  if (entry->dstream || entry->deferred)
     return svn_error_create(SVN_ERR_RA_SVN_MALFORMED_DATA, NULL,
                             _("Apply-textdelta already active"));
   entry->pool = svn_pool_create(ds->file_pool);
@@ -825,6 +927,43 @@ ra_svn_handle_textdelta_end(svn_ra_svn_conn_t *conn,
   return SVN_NO_ERROR;
 }
 
+static svn_error_t *
+ra_svn_handle_fetch_file(svn_ra_svn_conn_t *conn,
+                         apr_pool_t *pool,
+                         const svn_ra_svn__list_t *params,
+                         ra_svn_driver_state_t *ds)
+{
+  svn_string_t *token;
+  const char *path;
+  svn_revnum_t rev;
+  ra_svn_token_entry_t *entry;
+  ra_svn_deferred_file_t *file;
+
+  /* Parse arguments and look up the token. */
+  SVN_ERR(svn_ra_svn__parse_tuple(params, "scr", &token, &path, &rev));
+  SVN_ERR(lookup_token(ds, token, TRUE, &entry));
+  if (!ds->fetcher)
+    return svn_error_create(SVN_ERR_RA_SVN_UNKNOWN_CMD, NULL,
+                            _("Command 'fetch-file' not requested"));
+  if (entry->dstream || entry->deferred)
+    return svn_error_create(SVN_ERR_RA_SVN_MALFORMED_DATA, NULL,
+                            _("Apply-textdelta already active"));
+
+  /* The file stays open until the end of the edit. */
+  file = apr_pcalloc(entry->own_pool, sizeof(*file));
+  file->baton = entry->baton;
+  file->request.path = svn_relpath_canonicalize(path, entry->own_pool);
+  file->request.revision = rev;
+  file->pool = entry->own_pool;
+
+  entry->deferred = file;
+
+  /* Start fetching right away, while the edit continues. */
+  SVN_CMD_ERR(ds->fetcher->fetch_start(ds->fetch_baton, &file->request,
+                                       file, pool));
+  return SVN_NO_ERROR;
+}
+
 static svn_error_t *
 ra_svn_handle_change_file_prop(svn_ra_svn_conn_t *conn,
                                apr_pool_t *pool,
@@ -857,10 +996,21 @@ ra_svn_handle_close_file(svn_ra_svn_conn_t *conn,
                                   &token, &text_checksum));
   SVN_ERR(lookup_token(ds, token, TRUE, &entry));
 
+  /* Files with deferred contents get closed at the end of the edit. */
+  if (entry->deferred)
+    {
+      entry->deferred->text_checksum
+        = apr_pstrdup(entry->deferred->pool, text_checksum);
+      remove_token(ds, token);
+      return SVN_NO_ERROR;
+    }
+
   /* Close the file and destroy the baton. */
   SVN_CMD_ERR(ds->editor->close_file(entry->baton, text_checksum, pool));
   remove_token(ds, token);
-  if (--ds->file_refs == 0)
+  if (entry->own_pool)
+    svn_pool_destroy(entry->own_pool);
+  else if (--ds->file_refs == 0)
     svn_pool_clear(ds->file_pool);
   return SVN_NO_ERROR;
 }
@@ -884,12 +1034,53 @@ ra_svn_handle_absent_file(svn_ra_svn_conn_t *conn,
   return SVN_NO_ERROR;
 }
 
+/* Apply the contents of all deferred files in DS to the respective file
+   batons as they arrive and close the files.  Use SCRATCH_POOL for
+   temporary allocations. */
+static svn_error_t *
+apply_deferred_files(ra_svn_driver_state_t *ds,
+                     apr_pool_t *scratch_pool)
+{
+  apr_pool_t *iterpool = svn_pool_create(scratch_pool);
+
+  while (TRUE)
+    {
+      void *file_baton;
+      ra_svn_deferred_file_t *file;
+      svn_stream_t *stream;
+      svn_txdelta_window_handler_t wh;
+      void *wh_baton;
+
+      svn_pool_clear(iterpool);
+      SVN_ERR(ds->fetcher->fetch_next(&file_baton, &stream, ds->fetch_baton,
+                                      iterpool));
+      if (!file_baton)
+        break;
+
+      file = file_baton;
+      SVN_ERR(ds->editor->apply_textdelta(file->baton, NULL, file->pool,
+                                          &wh, &wh_baton));
+      SVN_ERR(svn_txdelta_send_stream(stream, wh, wh_baton, NULL,
+                                      file->pool));
+      SVN_ERR(ds->editor->close_file(file->baton, file->text_checksum,
+                                     file->pool));
+      svn_pool_destroy(file->pool);
+    }
+
+  svn_pool_destroy(iterpool);
+
+  return SVN_NO_ERROR;
+}
+
 static svn_error_t *
 ra_svn_handle_close_edit(svn_ra_svn_conn_t *conn,
                          apr_pool_t *pool,
                          const svn_ra_svn__list_t *params,
                          ra_svn_driver_state_t *ds)
 {
+  if (ds->fetcher)
+    SVN_CMD_ERR(apply_deferred_files(ds, pool));
+
   SVN_CMD_ERR(ds->editor->close_edit(ds->edit_baton, pool));
   ds->done = TRUE;
 #ifdef SVN_DEBUG
@@ -963,6 +1154,7 @@ static const struct {
   { "target-rev",       ra_svn_handle_target_rev },
   { "open-root",        ra_svn_handle_open_root },
   { "close-edit",       ra_svn_handle_close_edit },
+  { "fetch-file",       ra_svn_handle_fetch_file },
   { NULL }
 };
 
@@ -1070,12 +1262,15 @@ static svn_error_t *blocked_write(svn_ra_svn_conn_t *conn, apr_pool_t *pool,
   return SVN_NO_ERROR;
 }
 
-svn_error_t *svn_ra_svn_drive_editor2(svn_ra_svn_conn_t *conn,
-                                      apr_pool_t *pool,
-                                      const svn_delta_editor_t *editor,
-                                      void *edit_baton,
-                                      svn_boolean_t *aborted,
-                                      svn_boolean_t for_replay)
+svn_error_t *
+svn_ra_svn__drive_editor(svn_ra_svn_conn_t *conn,
+                         apr_pool_t *pool,
+                         const svn_delta_editor_t *editor,
+                         void *edit_baton,
+                         svn_boolean_t *aborted,
+                         svn_boolean_t for_replay,
+                         const svn_ra_svn__fetcher_t *fetcher,
+                         void *fetch_baton)
 {
   ra_svn_driver_state_t state;
   apr_pool_t *subpool = svn_pool_create(pool);
@@ -1096,6 +1291,8 @@ svn_error_t *svn_ra_svn_drive_editor2(svn_ra_svn_conn_t *conn,
   state.file_pool = svn_pool_create(pool);
   state.file_refs = 0;
   state.for_replay = for_replay;
+  state.fetcher = fetcher;
+  state.fetch_baton = fetch_baton;
 
   while (!state.done)
     {
@@ -1211,6 +1408,17 @@ svn_error_t *svn_ra_svn_drive_editor2(svn_ra_svn_conn_t *conn,
   return SVN_NO_ERROR;
 }
 
+svn_error_t *svn_ra_svn_drive_editor2(svn_ra_svn_conn_t *conn,
+                                      apr_pool_t *pool,
+                                      const svn_delta_editor_t *editor,
+                                      void *edit_baton,
+                                      svn_boolean_t *aborted,
+                                      svn_boolean_t for_replay)
+{
+  return svn_ra_svn__drive_editor(conn, pool, editor, edit_baton, aborted,
+                                  for_replay, NULL, NULL);
+}
+
 svn_error_t *svn_ra_svn_drive_editor(svn_ra_svn_conn_t *conn, apr_pool_t *pool,
                                      const svn_delta_editor_t *editor,
                                      void *edit_baton,
@@ -210,6 +210,11 @@ svn_ra_svn_conn_t *svn_ra_svn_create_conn5(apr_socket_t *sock,
   conn->current_in = 0;
   conn->max_out = max_out;
   conn->current_out = 0;
+  conn->total_in = 0;
+  conn->total_out = 0;
+  conn->last_command = NULL;
+  conn->stream_compression = svn_ra_svn__stream_compression_none;
+  memset(&conn->compression_stats, 0, sizeof(conn->compression_stats));
   conn->block_handler = NULL;
   conn->block_baton = NULL;
   conn->capabilities = apr_hash_make(result_pool);
@@ -273,6 +278,10 @@ svn_ra_svn__svndiff_version(svn_ra_svn_conn_t *conn)
   if (svn_ra_svn_compression_level(conn) <= 0)
     return 0;
 
+  /* Don't compress data that the connection will compress again. */
+  if (conn->stream_compression != svn_ra_svn__stream_compression_none)
+    return 0;
+
   /* Prefer SVNDIFF2 over SVNDIFF1. */
   if (svn_ra_svn_has_capability(conn, SVN_RA_SVN_CAP_SVNDIFF2_ACCEPTED))
     return 2;
@@ -376,6 +385,7 @@ static svn_error_t *writebuf_output(svn_ra_svn_conn_t *conn, apr_pool_t *pool,
    * This is to limit the server load in case users e.g. accidentally ran
    * an export on the root folder. */
   conn->current_out += len;
+  conn->total_out += len;
   SVN_ERR(check_io_limits(conn));
 
   while (data < end)
@@ -509,6 +519,7 @@ static svn_error_t *readbuf_input(svn_ra_svn_conn_t *conn, char *data,
   if (*len == 0)
     return svn_error_create(SVN_ERR_RA_SVN_CONNECTION_CLOSED, NULL, NULL);
   conn->current_in += *len;
+  conn->total_in += *len;
 
   if (session)
     {
@@ -762,6 +773,76 @@ svn_ra_svn__write_string(svn_ra_svn_conn_t *conn,
   return SVN_NO_ERROR;
 }
 
+void
+svn_ra_svn__get_io_totals(apr_uint64_t *bytes_in,
+                          apr_uint64_t *bytes_out,
+                          svn_ra_svn_conn_t *conn)
+{
+  *bytes_in = conn->total_in;
+  *bytes_out = conn->total_out;
+}
+
+const char *
+svn_ra_svn__get_last_command(svn_ra_svn_conn_t *conn)
+{
+  return conn->last_command;
+}
+
+const char *
+svn_ra_svn__stream_compression_cap(svn_ra_svn__stream_compression_t method)
+{
+  switch (method)
+    {
+      case svn_ra_svn__stream_compression_lz4:
+        return SVN_RA_SVN_CAP_STREAM_LZ4;
+      case svn_ra_svn__stream_compression_zlib:
+        return SVN_RA_SVN_CAP_STREAM_ZLIB;
+      default:
+        return NULL;
+    }
+}
+
+svn_error_t *
+svn_ra_svn__enable_stream_compression(svn_ra_svn_conn_t *conn,
+                                      svn_ra_svn__stream_compression_t method,
+                                      apr_pool_t *scratch_pool)
+{
+  int level = conn->compression_level > 0
+            ? conn->compression_level
+            : SVN__COMPRESSION_ZLIB_DEFAULT;
+
+  if (method == svn_ra_svn__stream_compression_none
+      || conn->stream_compression != svn_ra_svn__stream_compression_none)
+    return SVN_NO_ERROR;
+
+  /* Flush the connection, as we're about to replace its stream. */
+  SVN_ERR(svn_ra_svn__flush(conn, scratch_pool));
+
+  /* Anything left in the read buffer already is compressed data. */
+  conn->stream = svn_ra_svn__stream_compressed(conn->stream, method, level,
+                                               conn->read_ptr,
+                                               conn->read_end
+                                                 - conn->read_ptr,
+                                               &conn->compression_stats,
+                                               conn->pool);
+  conn->read_end = conn->read_ptr;
+  conn->stream_compression = method;
+
+  return SVN_NO_ERROR;
+}
+
+svn_ra_svn__stream_compression_t
+svn_ra_svn__get_stream_compression(svn_ra_svn_conn_t *conn)
+{
+  return conn->stream_compression;
+}
+
+const svn_ra_svn__compression_stats_t *
+svn_ra_svn__get_compression_stats(svn_ra_svn_conn_t *conn)
+{
+  return &conn->compression_stats;
+}
+
 svn_error_t *
 svn_ra_svn__write_cstring(svn_ra_svn_conn_t *conn,
                           apr_pool_t *pool,
@@ -1917,6 +1998,7 @@ svn_ra_svn__handle_command(svn_boolean_t *terminate,
   const svn_ra_svn__cmd_entry_t *command;
 
   *terminate = FALSE;
+  conn->last_command = NULL;
 
   /* Limit I/O for every command separately. */
   svn_ra_svn__reset_command_io_counters(conn);
@@ -1937,6 +2019,9 @@ svn_ra_svn__handle_command(svn_boolean_t *terminate,
   command = svn_hash_gets(cmd_hash, cmdname);
   if (command)
     {
+      /* Remember the table's copy of the name; it outlives POOL. */
+      conn->last_command = command->cmdname;
+
       /* Call the standard command handler.
        * If that is not set, then this is a lecagy API call and we invoke
        * the legacy command handler. */
@@ -2250,6 +2335,22 @@ svn_ra_svn__write_cmd_apply_textdelta(svn_ra_svn_conn_t *conn,
   return SVN_NO_ERROR;
 }
 
+svn_error_t *
+svn_ra_svn__write_cmd_fetch_file(svn_ra_svn_conn_t *conn,
+                                 apr_pool_t *pool,
+                                 const svn_string_t *token,
+                                 const char *path,
+                                 svn_revnum_t rev)
+{
+  SVN_ERR(writebuf_write_literal(conn, pool, "( fetch-file ( "));
+  SVN_ERR(write_tuple_string(conn, pool, token));
+  SVN_ERR(write_tuple_cstring(conn, pool, path));
+  SVN_ERR(write_tuple_revision(conn, pool, rev));
+  SVN_ERR(writebuf_write_literal(conn, pool, ") ) "));
+
+  return SVN_NO_ERROR;
+}
+
 svn_error_t *
 svn_ra_svn__write_cmd_close_edit(svn_ra_svn_conn_t *conn,
                                  apr_pool_t *pool)
@@ -2463,7 +2564,8 @@ svn_ra_svn__write_cmd_update(svn_ra_svn_conn_t *conn,
                              svn_boolean_t recurse,
                              svn_depth_t depth,
                              svn_boolean_t send_copyfrom_args,
-                             svn_boolean_t ignore_ancestry)
+                             svn_boolean_t ignore_ancestry,
+                             apr_uint64_t defer_size)
 {
   SVN_ERR(writebuf_write_literal(conn, pool, "( update ( "));
   SVN_ERR(write_tuple_start_list(conn, pool));
@@ -2474,6 +2576,8 @@ svn_ra_svn__write_cmd_update(svn_ra_svn_conn_t *conn,
   SVN_ERR(write_tuple_depth(conn, pool, depth));
   SVN_ERR(write_tuple_boolean(conn, pool, send_copyfrom_args));
   SVN_ERR(write_tuple_boolean(conn, pool, ignore_ancestry));
+  if (defer_size)
+    SVN_ERR(svn_ra_svn__write_number(conn, pool, defer_size));
   SVN_ERR(writebuf_write_literal(conn, pool, ") ) "));
 
   return SVN_NO_ERROR;
@@ -102,6 +102,17 @@ struct svn_ra_svn_conn_st {
   apr_uint64_t max_out;
   apr_uint64_t current_out;
 
+  /* Bytes read / written over the lifetime of the connection */
+  apr_uint64_t total_in;
+  apr_uint64_t total_out;
+
+  /* Name of the command last dispatched by svn_ra_svn__handle_command */
+  const char *last_command;
+
+  /* Whole-stream compression, if enabled, and its counters */
+  svn_ra_svn__stream_compression_t stream_compression;
+  svn_ra_svn__compression_stats_t compression_stats;
+
   /* repository info */
   const char *uuid;
   const char *repos_root;
@@ -235,6 +246,22 @@ svn_error_t *svn_ra_svn__read_command_only(svn_ra_svn_conn_t *conn,
                                            apr_pool_t *pool,
                                            const char **command);
 
+/* Return a stream that compresses data written to it using METHOD,
+ * sends the result through INNER and decompresses data read from INNER.
+ * The buffered, still compressed input in INITIAL_INPUT of
+ * INITIAL_INPUT_LEN bytes will be processed before reading from INNER.
+ * Use LEVEL for zlib compression.  Update the counters in STATS.
+ * Allocate the result in RESULT_POOL.
+ */
+svn_ra_svn__stream_t *
+svn_ra_svn__stream_compressed(svn_ra_svn__stream_t *inner,
+                              svn_ra_svn__stream_compression_t method,
+                              int level,
+                              const char *initial_input,
+                              apr_size_t initial_input_len,
+                              svn_ra_svn__compression_stats_t *stats,
+                              apr_pool_t *result_pool);
+
 /* Set the timeout for operations on STREAM to INTERVAL. */
 void svn_ra_svn__stream_timeout(svn_ra_svn__stream_t *stream,
                                 apr_interval_time_t interval);
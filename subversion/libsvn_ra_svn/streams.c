@@ -31,9 +31,11 @@
 #include "svn_error.h"
 #include "svn_pools.h"
 #include "svn_io.h"
+#include "svn_sorts.h"
 #include "svn_private_config.h"
 
 #include "private/svn_io_private.h"
+#include "private/svn_subr_private.h"
 
 #include "ra_svn.h"
 
@@ -230,3 +232,269 @@ svn_ra_svn__stream_data_available(svn_ra_svn__stream_t *stream,
           svn_stream_data_available(stream->in_stream,
                                     data_available));
 }
+
+
+/* Functions to implement a compressing svn_ra_svn__stream_t.
+ *
+ * Data gets sent as a sequence of frames.  Each frame consists of the
+ * length of its payload, encoded by svn__encode_uint(), followed by the
+ * output of svn__compress_lz4() or svn__compress_zlib() for up to
+ * COMPRESSED_FRAME_SIZE bytes of protocol data.
+ */
+
+/* Maximum amount of protocol data per frame. */
+#define COMPRESSED_FRAME_SIZE 0x10000
+
+/* Upper limit for a frame's payload.  The compressors fall back to
+ * storing the data as-is if compression does not help. */
+#define COMPRESSED_FRAME_MAX_PAYLOAD \
+  (COMPRESSED_FRAME_SIZE + SVN__MAX_ENCODED_UINT_LEN)
+
+typedef struct compressed_baton_t {
+  /* The stream that carries the frames. */
+  svn_ra_svn__stream_t *inner;
+
+  svn_ra_svn__stream_compression_t method;
+  int level;
+  svn_ra_svn__compression_stats_t *stats;
+
+  /* Compressor output and the frame being sent.  FRAME_POS bytes of
+     FRAME have been written to INNER so far.  FRAME_SOURCE_LEN is the
+     number of caller bytes the frame represents. */
+  svn_stringbuf_t *payload;
+  svn_stringbuf_t *frame;
+  apr_size_t frame_pos;
+  apr_size_t frame_source_len;
+
+  /* Frame data received from INNER; WIRE_POS bytes have been consumed. */
+  svn_stringbuf_t *wire;
+  apr_size_t wire_pos;
+
+  /* Decompressed data; DECODED_POS bytes have been returned already. */
+  svn_stringbuf_t *decoded;
+  apr_size_t decoded_pos;
+} compressed_baton_t;
+
+/* If B->WIRE contains a complete frame, decompress it into B->DECODED
+ * and set *DECODED to TRUE.  Set it to FALSE otherwise. */
+static svn_error_t *
+decode_frame(compressed_baton_t *b, svn_boolean_t *decoded)
+{
+  const unsigned char *start
+    = (const unsigned char *)b->wire->data + b->wire_pos;
+  const unsigned char *end
+    = (const unsigned char *)b->wire->data + b->wire->len;
+  const unsigned char *p;
+  apr_uint64_t payload_len;
+  apr_time_t started;
+
+  *decoded = FALSE;
+  p = svn__decode_uint(&payload_len, start, end);
+  if (p == NULL)
+    {
+      if (end - start >= SVN__MAX_ENCODED_UINT_LEN)
+        return svn_error_create(SVN_ERR_RA_SVN_MALFORMED_DATA, NULL,
+                                _("Invalid compressed frame header"));
+      return SVN_NO_ERROR;
+    }
+
+  if (payload_len == 0 || payload_len > COMPRESSED_FRAME_MAX_PAYLOAD)
+    return svn_error_createf(SVN_ERR_RA_SVN_MALFORMED_DATA, NULL,
+                             _("Invalid compressed frame size %"
+                               APR_UINT64_T_FMT),
+                             payload_len);
+
+  if ((apr_uint64_t)(end - p) < payload_len)
+    return SVN_NO_ERROR;
+
+  started = apr_time_now();
+  if (b->method == svn_ra_svn__stream_compression_lz4)
+    SVN_ERR(svn__decompress_lz4(p, (apr_size_t)payload_len, b->decoded,
+                                COMPRESSED_FRAME_SIZE));
+  else
+    SVN_ERR(svn__decompress_zlib(p, (apr_size_t)payload_len, b->decoded,
+                                 COMPRESSED_FRAME_SIZE));
+  b->stats->decompress_time += apr_time_now() - started;
+  b->stats->raw_in += b->decoded->len;
+
+  b->decoded_pos = 0;
+  b->wire_pos = (p - (const unsigned char *)b->wire->data)
+              + (apr_size_t)payload_len;
+  *decoded = TRUE;
+
+  return SVN_NO_ERROR;
+}
+
+/* Implements svn_read_fn_t. */
+static svn_error_t *
+compressed_read_cb(void *baton, char *buffer, apr_size_t *len)
+{
+  compressed_baton_t *b = baton;
+  apr_size_t available;
+
+  while (b->decoded_pos == b->decoded->len)
+    {
+      svn_boolean_t decoded;
+      apr_size_t read_len;
+
+      SVN_ERR(decode_frame(b, &decoded));
+      if (decoded)
+        continue;
+
+      /* Drop consumed frames and fetch more data from the wire. */
+      if (b->wire_pos)
+        {
+          svn_stringbuf_remove(b->wire, 0, b->wire_pos);
+          b->wire_pos = 0;
+        }
+
+      svn_stringbuf_ensure(b->wire, b->wire->len + SVN_RA_SVN__READBUF_SIZE);
+      read_len = SVN_RA_SVN__READBUF_SIZE;
+      SVN_ERR(svn_ra_svn__stream_read(b->inner, b->wire->data + b->wire->len,
+                                      &read_len));
+      b->wire->len += read_len;
+      b->wire->data[b->wire->len] = '\0';
+      b->stats->wire_in += read_len;
+    }
+
+  available = b->decoded->len - b->decoded_pos;
+  if (*len > available)
+    *len = available;
+
+  memcpy(buffer, b->decoded->data + b->decoded_pos, *len);
+  b->decoded_pos += *len;
+
+  return SVN_NO_ERROR;
+}
+
+/* Implements svn_write_fn_t. */
+static svn_error_t *
+compressed_write_cb(void *baton, const char *buffer, apr_size_t *len)
+{
+  compressed_baton_t *b = baton;
+
+  /* A frame that did not go out in full during the last call has been
+     created from the same data.  Otherwise, start a new one. */
+  if (b->frame_pos == b->frame->len)
+    {
+      unsigned char header[SVN__MAX_ENCODED_UINT_LEN];
+      unsigned char *header_end;
+      apr_size_t source_len = MIN(*len, COMPRESSED_FRAME_SIZE);
+      apr_time_t started;
+
+      if (source_len == 0)
+        return SVN_NO_ERROR;
+
+      started = apr_time_now();
+      if (b->method == svn_ra_svn__stream_compression_lz4)
+        SVN_ERR(svn__compress_lz4(buffer, source_len, b->payload));
+      else
+        SVN_ERR(svn__compress_zlib(buffer, source_len, b->payload,
+                                   b->level));
+      b->stats->compress_time += apr_time_now() - started;
+
+      header_end = svn__encode_uint(header, b->payload->len);
+      svn_stringbuf_setempty(b->frame);
+      svn_stringbuf_appendbytes(b->frame, (const char *)header,
+                                header_end - header);
+      svn_stringbuf_appendbytes(b->frame, b->payload->data, b->payload->len);
+
+      b->frame_pos = 0;
+      b->frame_source_len = source_len;
+      b->stats->raw_out += source_len;
+    }
+
+  while (b->frame_pos < b->frame->len)
+    {
+      apr_size_t count = b->frame->len - b->frame_pos;
+      SVN_ERR(svn_ra_svn__stream_write(b->inner,
+                                       b->frame->data + b->frame_pos,
+                                       &count));
+      if (count == 0)
+        {
+          /* Blocked.  The caller will retry with the same data. */
+          *len = 0;
+          return SVN_NO_ERROR;
+        }
+
+      b->frame_pos += count;
+      b->stats->wire_out += count;
+    }
+
+  *len = b->frame_source_len;
+  return SVN_NO_ERROR;
+}
+
+/* Implements ra_svn_timeout_fn_t. */
+static void
+compressed_timeout_cb(void *baton, apr_interval_time_t interval)
+{
+  compressed_baton_t *b = baton;
+  svn_ra_svn__stream_timeout(b->inner, interval);
+}
+
+/* Implements svn_stream_data_available_fn_t. */
+static svn_error_t *
+compressed_data_available_cb(void *baton, svn_boolean_t *data_available)
+{
+  compressed_baton_t *b = baton;
+  const unsigned char *start
+    = (const unsigned char *)b->wire->data + b->wire_pos;
+  const unsigned char *end
+    = (const unsigned char *)b->wire->data + b->wire->len;
+  const unsigned char *p;
+  apr_uint64_t payload_len;
+
+  if (b->decoded_pos < b->decoded->len)
+    {
+      *data_available = TRUE;
+      return SVN_NO_ERROR;
+    }
+
+  /* A complete frame that we did not decode yet? */
+  p = svn__decode_uint(&payload_len, start, end);
+  if (p && (apr_uint64_t)(end - p) >= payload_len)
+    {
+      *data_available = TRUE;
+      return SVN_NO_ERROR;
+    }
+
+  return svn_error_trace(svn_ra_svn__stream_data_available(b->inner,
+                                                           data_available));
+}
+
+svn_ra_svn__stream_t *
+svn_ra_svn__stream_compressed(svn_ra_svn__stream_t *inner,
+                              svn_ra_svn__stream_compression_t method,
+                              int level,
+                              const char *initial_input,
+                              apr_size_t initial_input_len,
+                              svn_ra_svn__compression_stats_t *stats,
+                              apr_pool_t *result_pool)
+{
+  compressed_baton_t *b = apr_pcalloc(result_pool, sizeof(*b));
+  svn_stream_t *in = svn_stream_create(b, result_pool);
+  svn_stream_t *out = svn_stream_create(b, result_pool);
+
+  b->inner = inner;
+  b->method = method;
+  b->level = level;
+  b->stats = stats;
+  b->payload = svn_stringbuf_create_ensure(COMPRESSED_FRAME_MAX_PAYLOAD,
+                                           result_pool);
+  b->frame = svn_stringbuf_create_ensure(COMPRESSED_FRAME_MAX_PAYLOAD
+                                           + SVN__MAX_ENCODED_UINT_LEN,
+                                         result_pool);
+  b->wire = svn_stringbuf_ncreate(initial_input, initial_input_len,
+                                  result_pool);
+  b->decoded = svn_stringbuf_create_ensure(COMPRESSED_FRAME_SIZE,
+                                           result_pool);
+  stats->wire_in += initial_input_len;
+
+  svn_stream_set_read2(in, compressed_read_cb, NULL /* use default */);
+  svn_stream_set_data_available(in, compressed_data_available_cb);
+  svn_stream_set_write(out, compressed_write_cb);
+
+  return svn_ra_svn__stream_create(in, out, b, compressed_timeout_cb,
+                                   result_pool);
+}
@@ -1375,6 +1375,137 @@ lookup(lookup_state_t *state,
 
 
 
+/*** Lookup result cache. ***/
+
+/* Maximum number of paths in the lookup result cache of a filtered rule
+ * tree. */
+#define LOOKUP_CACHE_SIZE 4096
+
+/* Commands like "log -v" and "update" check the same paths over and over.
+ * So, we remember lookup results for up to LOOKUP_CACHE_SIZE recently used
+ * paths.  Once the cache is full, new paths replace the least recently
+ * used ones.
+ */
+typedef struct lookup_cache_entry_t
+{
+  /* The path as passed to svn_repos_authz_check_access(). */
+  svn_stringbuf_t *path;
+
+  /* Bit masks indexed by lookup_cache_bit(): results that we know and
+   * which of them granted access. */
+  apr_uint32_t known;
+  apr_uint32_t granted;
+
+  /* Neighbours in the lookup_cache_t's list of entries, ordered by
+   * their last use.  NULL at the respective end of the list. */
+  struct lookup_cache_entry_t *previous;
+  struct lookup_cache_entry_t *next;
+} lookup_cache_entry_t;
+
+/* The lookup result cache of a filtered rule tree. */
+typedef struct lookup_cache_t
+{
+  /* Maps the entries' PATHs to the lookup_cache_entry_t *. */
+  apr_hash_t *entries;
+
+  /* The most recently and the least recently used entries.
+   * NULL while the cache is empty. */
+  lookup_cache_entry_t *first;
+  lookup_cache_entry_t *last;
+
+  /* Pool that the cache and its entries got allocated in. */
+  apr_pool_t *pool;
+} lookup_cache_t;
+
+/* Return a new, empty lookup result cache allocated in POOL. */
+static lookup_cache_t *
+create_lookup_cache(apr_pool_t *pool)
+{
+  lookup_cache_t *cache = apr_pcalloc(pool, sizeof(*cache));
+  cache->entries = apr_hash_make(pool);
+  cache->pool = pool;
+
+  return cache;
+}
+
+/* Remove ENTRY from the use-ordered list in CACHE. */
+static void
+unlink_lookup_cache_entry(lookup_cache_t *cache,
+                          lookup_cache_entry_t *entry)
+{
+  if (entry->previous)
+    entry->previous->next = entry->next;
+  else
+    cache->first = entry->next;
+
+  if (entry->next)
+    entry->next->previous = entry->previous;
+  else
+    cache->last = entry->previous;
+
+  entry->previous = NULL;
+  entry->next = NULL;
+}
+
+/* Return the bit in lookup_cache_entry_t's masks that represents the
+ * result of a lookup for REQUIRED access, with RECURSIVE being set or not.
+ */
+static apr_uint32_t
+lookup_cache_bit(authz_access_t required,
+                 svn_boolean_t recursive)
+{
+  /* REQUIRED is a combination of the read and write flags. */
+  int index = (required & authz_access_write) / authz_access_read_flag;
+  return (apr_uint32_t)1 << (index + (recursive ? 4 : 0));
+}
+
+/* Return the entry in CACHE that holds the results for PATH and mark it
+ * as the most recently used one.  If there is none, add a new entry or
+ * recycle the least recently used one if CACHE is full.
+ */
+static lookup_cache_entry_t *
+get_lookup_cache_entry(lookup_cache_t *cache,
+                       const char *path)
+{
+  apr_size_t len = strlen(path);
+  lookup_cache_entry_t *entry = apr_hash_get(cache->entries, path, len);
+
+  if (entry)
+    {
+      unlink_lookup_cache_entry(cache, entry);
+    }
+  else if (apr_hash_count(cache->entries) < LOOKUP_CACHE_SIZE)
+    {
+      entry = apr_pcalloc(cache->pool, sizeof(*entry));
+      entry->path = svn_stringbuf_ncreate(path, len, cache->pool);
+      apr_hash_set(cache->entries, entry->path->data, len, entry);
+    }
+  else
+    {
+      entry = cache->last;
+      unlink_lookup_cache_entry(cache, entry);
+      apr_hash_set(cache->entries, entry->path->data, entry->path->len,
+                   NULL);
+
+      svn_stringbuf_setempty(entry->path);
+      svn_stringbuf_appendbytes(entry->path, path, len);
+      entry->known = 0;
+      entry->granted = 0;
+      apr_hash_set(cache->entries, entry->path->data, len, entry);
+    }
+
+  /* Put ENTRY at the head of the list. */
+  entry->next = cache->first;
+  if (cache->first)
+    cache->first->previous = entry;
+  else
+    cache->last = entry;
+  cache->first = entry;
+
+  return entry;
+}
+
+
 /*** The authz data structure. ***/
 
 /* An entry in svn_authz_t's USER_RULES cache.  All members must be
@@ -1401,6 +1532,10 @@ struct authz_user_rules_t
   /* Reusable lookup state instance. */
   lookup_state_t *lookup_state;
 
+  /* Recent lookup results.
+   * Will remain NULL until the first lookup in ROOT. */
+  lookup_cache_t *lookup_cache;
+
   /* Pool from which all data within this struct got allocated.
    * Can be destroyed or cleaned up with no further side-effects. */
   apr_pool_t *pool;
@@ -1459,6 +1594,7 @@ get_user_rules(svn_authz_t *authz,
   authz->filtered->repository = apr_pstrdup(pool, repos_name);
   authz->filtered->user = user ? apr_pstrdup(pool, user) : NULL;
   authz->filtered->lookup_state = create_lookup_state(pool);
+  authz->filtered->lookup_cache = NULL;
   authz->filtered->root = NULL;
 
   svn_authz__get_global_rights(&authz->filtered->global_rights,
@@ -1653,6 +1789,19 @@ svn_repos_authz_read4(svn_authz_t **authz_p,
 }
 
 
+void
+svn_repos__authz_share(svn_authz_t **copy,
+                       const svn_authz_t *authz,
+                       apr_pool_t *result_pool)
+{
+  svn_authz_t *result = apr_pcalloc(result_pool, sizeof(*result));
+  result->full = authz->full;
+  result->authz_id = authz->authz_id;
+  result->pool = result_pool;
+
+  *copy = result;
+}
+
 svn_error_t *
 svn_repos_authz_parse2(svn_authz_t **authz_p,
                        svn_stream_t *stream,
@@ -1691,6 +1840,10 @@ svn_repos_authz_check_access(svn_authz_t *authz, const char *repos_name,
       (repos_name ? repos_name : AUTHZ_ANY_REPOSITORY),
       user);
 
+  svn_boolean_t recursive;
+  apr_uint32_t cache_bit;
+  lookup_cache_entry_t *cache_entry;
+
   /* In many scenarios, users have uniform access to a repository
    * (blanket access or no access at all).
    *
@@ -1722,6 +1875,19 @@ svn_repos_authz_check_access(svn_authz_t *authz, const char *repos_name,
   if (!rules->root)
     SVN_ERR(filter_tree(authz, pool));
 
+  /* Did we answer the very same question recently? */
+  if (!rules->lookup_cache)
+    rules->lookup_cache = create_lookup_cache(rules->pool);
+
+  recursive = !!(required_access & svn_authz_recursive);
+  cache_bit = lookup_cache_bit(required, recursive);
+  cache_entry = get_lookup_cache_entry(rules->lookup_cache, path);
+  if (cache_entry->known & cache_bit)
+    {
+      *access_granted = (cache_entry->granted & cache_bit) != 0;
+      return SVN_NO_ERROR;
+    }
+
   /* Re-use previous lookup results, if possible. */
   path = init_lockup_state(authz->filtered->lookup_state,
                            authz->filtered->root, path);
@@ -1731,8 +1897,216 @@ svn_repos_authz_check_access(svn_authz_t *authz, const char *repos_name,
 
   /* Determine the granted access for the requested path.
    * PATH does not need to be normalized for lockup(). */
-  *access_granted = lookup(rules->lookup_state, path, required,
-                           !!(required_access & svn_authz_recursive), pool);
+  *access_granted = lookup(rules->lookup_state, path, required, recursive,
+                           pool);
+
+  cache_entry->known |= cache_bit;
+  if (*access_granted)
+    cache_entry->granted |= cache_bit;
+
+  return SVN_NO_ERROR;
+}
+
+/* A path to check in svn_repos__authz_check_paths() and its position in
+ * the caller's array. */
+typedef struct path_item_t
+{
+  const char *path;
+  int index;
+} path_item_t;
+
+/* Sort callback for path_item_t, ordering sub-paths directly behind their
+ * parent paths. */
+static int
+compare_path_items(const void *lhs,
+                   const void *rhs)
+{
+  const path_item_t *lhs_item = lhs;
+  const path_item_t *rhs_item = rhs;
+
+  return svn_path_compare_paths(lhs_item->path, rhs_item->path);
+}
+
+/* Return TRUE, if PATH is a sub-path of the fspath PARENT. */
+static svn_boolean_t
+is_sub_path(const svn_stringbuf_t *parent,
+            const char *path)
+{
+  return (   !strncmp(path, parent->data, parent->len)
+          && path[parent->len] == '/');
+}
+
+svn_error_t *
+svn_repos__authz_check_paths(svn_boolean_t *access_granted,
+                             svn_authz_t *authz,
+                             const char *repos_name,
+                             const apr_array_header_t *paths,
+                             const char *user,
+                             svn_repos_authz_access_t required_access,
+                             apr_pool_t *scratch_pool)
+{
+  const authz_access_t required =
+    ((required_access & svn_authz_read ? authz_access_read_flag : 0)
+     | (required_access & svn_authz_write ? authz_access_write_flag : 0));
+  const svn_boolean_t recursive = !!(required_access & svn_authz_recursive);
+
+  authz_user_rules_t *rules;
+  lookup_state_t *state;
+  apr_array_header_t *items;
+  apr_pool_t *iterpool;
+
+  /* The sub-tree in which all paths have the same access and that
+   * access.  An empty DECIDED_PATH means that nothing has been decided. */
+  svn_stringbuf_t *decided_path;
+  svn_boolean_t decided_access = FALSE;
+  int i;
+
+  if (paths->nelts == 0)
+    return SVN_NO_ERROR;
+
+  /* Apply the same shortcuts as svn_repos_authz_check_access(). */
+  rules = get_user_rules(authz,
+                         (repos_name ? repos_name : AUTHZ_ANY_REPOSITORY),
+                         user);
+  if (   (rules->global_rights.min_access & required) == required
+      || (rules->global_rights.max_access & required) != required)
+    {
+      svn_boolean_t granted
+        = (rules->global_rights.min_access & required) == required;
+      for (i = 0; i < paths->nelts; ++i)
+        access_granted[i] = granted;
+
+      return SVN_NO_ERROR;
+    }
+
+  if (!rules->root)
+    SVN_ERR(filter_tree(authz, scratch_pool));
+
+  /* Visit the paths in tree order, such that siblings follow each other
+   * and sub-trees are contiguous. */
+  items = apr_array_make(scratch_pool, paths->nelts, sizeof(path_item_t));
+  for (i = 0; i < paths->nelts; ++i)
+    {
+      path_item_t *item = apr_array_push(items);
+      item->path = APR_ARRAY_IDX(paths, i, const char *);
+      item->index = i;
+
+      if (item->path[0] != '/')
+        item->path = svn_fspath__canonicalize(item->path, scratch_pool);
+    }
+
+  svn_sort__array(items, compare_path_items);
+
+  /* Bypass the lookup result cache.  It would only thrash here. */
+  state = rules->lookup_state;
+  decided_path = svn_stringbuf_create_empty(scratch_pool);
+  iterpool = svn_pool_create(scratch_pool);
+  for (i = 0; i < items->nelts; ++i)
+    {
+      const path_item_t *item = &APR_ARRAY_IDX(items, i, path_item_t);
+      const char *path;
+
+      /* Inside a sub-tree that we already know the answer for? */
+      if (decided_path->len && is_sub_path(decided_path, item->path))
+        {
+          access_granted[item->index] = decided_access;
+          continue;
+        }
+
+      svn_pool_clear(iterpool);
+      path = init_lockup_state(state, rules->root, item->path);
+      access_granted[item->index] = lookup(state, path, required,
+                                           recursive, iterpool);
+
+      /* STATE->PARENT_RIGHTS now apply to the sub-tree at PARENT_PATH.
+       * If they are uniform there, the following paths in that sub-tree
+       * will have the same access. */
+      if (state->parent_path->len
+          && (   (state->parent_rights.min_rights & required) == required
+              || (state->parent_rights.max_rights & required) != required))
+        {
+          svn_stringbuf_set(decided_path, state->parent_path->data);
+          decided_access
+            = (state->parent_rights.min_rights & required) == required;
+        }
+      else
+        {
+          svn_stringbuf_setempty(decided_path);
+        }
+    }
+
+  svn_pool_destroy(iterpool);
+
+  return SVN_NO_ERROR;
+}
+
+svn_error_t *
+svn_repos__authz_read_func(svn_boolean_t *allowed,
+                           svn_fs_root_t *root,
+                           const char *path,
+                           void *baton,
+                           apr_pool_t *pool)
+{
+  svn_repos__authz_read_baton_t *b = baton;
+
+  if (path && *path != '/')
+    path = svn_fspath__canonicalize(path, pool);
+
+  SVN_ERR(svn_repos_authz_check_access(b->authz, b->repos_name, path,
+                                       b->user, svn_authz_read, allowed,
+                                       pool));
+  if (!*allowed && b->denied_func)
+    SVN_ERR(b->denied_func(path, b->denied_baton, pool));
+
+  return SVN_NO_ERROR;
+}
+
+svn_error_t *
+svn_repos__authz_read_paths(svn_boolean_t *readable,
+                            svn_fs_root_t *root,
+                            const apr_array_header_t *paths,
+                            svn_repos_authz_func_t authz_read_func,
+                            void *authz_read_baton,
+                            apr_pool_t *scratch_pool)
+{
+  apr_pool_t *iterpool;
+  int i;
+
+  if (authz_read_func == svn_repos__authz_read_func)
+    {
+      svn_repos__authz_read_baton_t *b = authz_read_baton;
+
+      SVN_ERR(svn_repos__authz_check_paths(readable, b->authz,
+                                           b->repos_name, paths, b->user,
+                                           svn_authz_read, scratch_pool));
+      if (b->denied_func)
+        {
+          iterpool = svn_pool_create(scratch_pool);
+          for (i = 0; i < paths->nelts; ++i)
+            if (!readable[i])
+              {
+                svn_pool_clear(iterpool);
+                SVN_ERR(b->denied_func(APR_ARRAY_IDX(paths, i, const char *),
+                                       b->denied_baton, iterpool));
+              }
+
+          svn_pool_destroy(iterpool);
+        }
+
+      return SVN_NO_ERROR;
+    }
+
+  /* Some other authz implementation.  Ask for each path individually. */
+  iterpool = svn_pool_create(scratch_pool);
+  for (i = 0; i < paths->nelts; ++i)
+    {
+      svn_pool_clear(iterpool);
+      SVN_ERR(authz_read_func(&readable[i], root,
+                              APR_ARRAY_IDX(paths, i, const char *),
+                              authz_read_baton, iterpool));
+    }
+
+  svn_pool_destroy(iterpool);
 
   return SVN_NO_ERROR;
 }
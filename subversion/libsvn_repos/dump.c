@@ -23,7 +23,12 @@
 
 #include <stdarg.h>
 
+#include <apr_thread_cond.h>
+#include <apr_thread_mutex.h>
+#include <apr_thread_proc.h>
+
 #include "svn_private_config.h"
+#include "svn_cache_config.h"
 #include "svn_pools.h"
 #include "svn_error.h"
 #include "svn_fs.h"
@@ -39,6 +44,7 @@
 #include "svn_sorts.h"
 
 #include "private/svn_repos_private.h"
+#include "private/svn_atomic.h"
 #include "private/svn_mergeinfo_private.h"
 #include "private/svn_fs_private.h"
 #include "private/svn_sorts_private.h"
@@ -2459,12 +2465,463 @@ report_error(svn_revnum_t revision,
     }
 }
 
+#if APR_HAS_THREADS
+
+/* Parallel verification.
+ *
+ * With more than one job, svn_repos_verify_fs4() splits the work into
+ * units - chunks of revisions for the backend-specific metadata checks and
+ * individual revisions for the content checks - and lets a number of
+ * worker threads process them.  Every worker uses its own svn_fs_t.
+ *
+ * Workers don't call any of the caller's callbacks.  They buffer all
+ * notifications and errors per unit instead and the calling thread passes
+ * them on in unit order, such that the caller sees the same sequence of
+ * events as with a sequential run.  To bound the memory used for those
+ * buffers, workers may only run a limited number of units ahead of the
+ * calling thread.
+ */
+
+/* Number of units per job that workers may complete before the calling
+   thread has to catch up with its reporting. */
+#define VERIFY_UNITS_PER_JOB 8
+
+/* Interval in microseconds in which the calling thread checks for
+   cancellation while waiting for results. */
+#define VERIFY_POLL_INTERVAL (100 * 1000)
+
+/* Verification result of a single unit. */
+typedef struct verify_result_t
+{
+  /* The worker has finished the unit, i.e. ERR and NOTIFICATIONS are
+     final.  Only accessed while holding the mutex. */
+  svn_boolean_t done;
+
+  /* Verification error or SVN_NO_ERROR. */
+  svn_error_t *err;
+
+  /* Buffered notifications, as svn_repos_notify_t *. */
+  apr_array_header_t *notifications;
+
+  /* Root pool containing NOTIFICATIONS. */
+  apr_pool_t *pool;
+} verify_result_t;
+
+/* Work description and shared state of a parallel verification run. */
+typedef struct verify_jobs_t
+{
+  /* Repository to verify. */
+  const char *fs_path;
+  apr_hash_t *fs_config;
+
+  /* The range of revisions to verify. */
+  svn_revnum_t start_rev;
+  svn_revnum_t end_rev;
+  svn_boolean_t check_normalization;
+
+  /* Verify metadata (TRUE) or revision contents (FALSE). */
+  svn_boolean_t metadata;
+
+  /* Unit N starts at revision FIRST + N * CHUNK_SIZE, clipped to the range
+     given above.  Content units are single revisions, i.e. CHUNK_SIZE is
+     1 for them. */
+  svn_revnum_t first;
+  svn_revnum_t chunk_size;
+  int unit_count;
+
+  /* Whether anybody is interested in the notifications. */
+  svn_boolean_t buffer_notifications;
+
+  /* Protects the following members and the DONE flags in RESULTS.
+     CHANGED gets signalled whenever any of them changes. */
+  apr_thread_mutex_t *mutex;
+  apr_thread_cond_t *changed;
+
+  /* The next unit to hand out to a worker. */
+  int next_unit;
+
+  /* All units before this one have been reported to the caller. */
+  int reported;
+
+  /* Results, indexed by unit number modulo WINDOW.  A worker may only
+     start on a unit if it is less than WINDOW units ahead of REPORTED. */
+  verify_result_t *results;
+  int window;
+
+  /* Set to stop all workers as soon as possible. */
+  svn_atomic_t abort;
+} verify_jobs_t;
+
+/* Implement svn_repos_notify_func_t.  Append a copy of NOTIFY to the
+   verify_result_t in BATON. */
+static void
+buffer_notification(void *baton,
+                    const svn_repos_notify_t *notify,
+                    apr_pool_t *scratch_pool)
+{
+  verify_result_t *result = baton;
+  svn_repos_notify_t *copy = apr_pmemdup(result->pool, notify,
+                                         sizeof(*notify));
+
+  copy->warning_str = apr_pstrdup(result->pool, notify->warning_str);
+  copy->path = apr_pstrdup(result->pool, notify->path);
+  APR_ARRAY_PUSH(result->notifications, svn_repos_notify_t *) = copy;
+}
+
+/* Implement svn_cancel_func_t for the workers of the verify_jobs_t in
+   BATON. */
+static svn_error_t *
+check_verify_abort(void *baton)
+{
+  verify_jobs_t *jobs = baton;
+
+  if (svn_atomic_read(&jobs->abort))
+    return svn_error_create(SVN_ERR_CANCELLED, NULL, NULL);
+
+  return SVN_NO_ERROR;
+}
+
+/* Implement svn_fs_warning_callback_t.  Worker filesystems have nobody
+   to report warnings to, so ignore them. */
+static void
+ignore_fs_warning(void *baton,
+                  svn_error_t *err)
+{
+}
+
+/* Verify UNIT of JOBS and store the results in RESULT.  *FS is the
+   worker's filesystem object, which gets opened in FS_POOL upon first use.
+   Use SCRATCH_POOL for temporary allocations. */
+static svn_error_t *
+verify_unit(svn_fs_t **fs,
+            verify_jobs_t *jobs,
+            int unit,
+            verify_result_t *result,
+            apr_pool_t *fs_pool,
+            apr_pool_t *scratch_pool)
+{
+  svn_repos_notify_func_t notify_func
+    = jobs->buffer_notifications ? buffer_notification : NULL;
+
+  if (jobs->metadata)
+    {
+      svn_revnum_t start = jobs->first + unit * jobs->chunk_size;
+      svn_revnum_t end = MIN(start + jobs->chunk_size - 1, jobs->end_rev);
+      svn_fs_progress_notify_func_t verify_notify = NULL;
+      struct verify_fs_notify_func_baton_t verify_notify_baton;
+
+      if (notify_func)
+        {
+          verify_notify = verify_fs_notify_func;
+          verify_notify_baton.notify_func = notify_func;
+          verify_notify_baton.notify_baton = result;
+          verify_notify_baton.notify
+            = svn_repos_notify_create(svn_repos_notify_verify_rev_structure,
+                                      scratch_pool);
+        }
+
+      return svn_error_trace(svn_fs_verify(jobs->fs_path, jobs->fs_config,
+                                           MAX(start, jobs->start_rev), end,
+                                           verify_notify,
+                                           &verify_notify_baton,
+                                           check_verify_abort, jobs,
+                                           scratch_pool));
+    }
+
+  if (*fs == NULL)
+    {
+      SVN_ERR(svn_fs_open2(fs, jobs->fs_path, jobs->fs_config, fs_pool,
+                           scratch_pool));
+      svn_fs_set_warning_func(*fs, ignore_fs_warning, NULL);
+    }
+
+  return svn_error_trace(verify_one_revision(*fs, jobs->first + unit,
+                                             notify_func, result,
+                                             jobs->start_rev,
+                                             jobs->check_normalization,
+                                             check_verify_abort, jobs,
+                                             scratch_pool));
+}
+
+/* Worker thread function.  Process units of the verify_jobs_t in DATA
+   until there are none left or we are told to abort. */
+static void * APR_THREAD_FUNC
+verify_thread(apr_thread_t *thread, void *data)
+{
+  verify_jobs_t *jobs = data;
+  apr_pool_t *thread_root
+    = apr_allocator_owner_get(svn_pool_create_allocator(FALSE));
+  apr_pool_t *iterpool = svn_pool_create(thread_root);
+  svn_fs_t *fs = NULL;
+
+  while (TRUE)
+    {
+      verify_result_t *result;
+      int unit;
+
+      /* Claim the next unit, unless we are too far ahead of the reporting
+         thread already. */
+      apr_thread_mutex_lock(jobs->mutex);
+      while (!svn_atomic_read(&jobs->abort)
+             && jobs->next_unit < jobs->unit_count
+             && jobs->next_unit >= jobs->reported + jobs->window)
+        apr_thread_cond_wait(jobs->changed, jobs->mutex);
+
+      if (svn_atomic_read(&jobs->abort)
+          || jobs->next_unit >= jobs->unit_count)
+        {
+          apr_thread_mutex_unlock(jobs->mutex);
+          break;
+        }
+
+      unit = jobs->next_unit++;
+      apr_thread_mutex_unlock(jobs->mutex);
+
+      /* The result slot is ours until we mark it as done. */
+      result = &jobs->results[unit % jobs->window];
+      result->pool = apr_allocator_owner_get(svn_pool_create_allocator(FALSE));
+      result->notifications = apr_array_make(result->pool, 0,
+                                             sizeof(svn_repos_notify_t *));
+
+      svn_pool_clear(iterpool);
+      result->err = verify_unit(&fs, jobs, unit, result, thread_root,
+                                iterpool);
+
+      apr_thread_mutex_lock(jobs->mutex);
+      result->done = TRUE;
+      apr_thread_cond_broadcast(jobs->changed);
+      apr_thread_mutex_unlock(jobs->mutex);
+    }
+
+  svn_pool_destroy(thread_root);
+
+  /* End thread explicitly to prevent APR_INCOMPLETE return codes in
+     apr_thread_join(). */
+  apr_thread_exit(thread, APR_SUCCESS);
+  return NULL;
+}
+
+/* Pass the notifications and the error in RESULT for UNIT of JOBS on to
+   NOTIFY_FUNC / NOTIFY_BATON and VERIFY_CALLBACK / VERIFY_BATON, the same
+   way the sequential code would.  *METADATA_NOTIFIED tracks whether we
+   already told the caller that we started checking the repository-wide
+   metadata.  Use SCRATCH_POOL for temporary allocations. */
+static svn_error_t *
+report_unit(verify_jobs_t *jobs,
+            int unit,
+            verify_result_t *result,
+            svn_boolean_t *metadata_notified,
+            svn_repos_notify_func_t notify_func,
+            void *notify_baton,
+            svn_repos_verify_callback_t verify_callback,
+            void *verify_baton,
+            apr_pool_t *scratch_pool)
+{
+  svn_error_t *err = result->err;
+  int i;
+
+  result->err = SVN_NO_ERROR;
+
+  if (notify_func)
+    for (i = 0; i < result->notifications->nelts; ++i)
+      {
+        const svn_repos_notify_t *notify
+          = APR_ARRAY_IDX(result->notifications, i, svn_repos_notify_t *);
+
+        /* Every metadata chunk announces the repository-wide checks.
+           Only pass that on once. */
+        if (   notify->action == svn_repos_notify_verify_rev_structure
+            && !SVN_IS_VALID_REVNUM(notify->revision))
+          {
+            if (*metadata_notified)
+              continue;
+
+            *metadata_notified = TRUE;
+          }
+
+        notify_func(notify_baton, notify, scratch_pool);
+      }
+
+  if (err && err->apr_err == SVN_ERR_CANCELLED)
+    {
+      return svn_error_trace(err);
+    }
+  else if (err)
+    {
+      svn_revnum_t revision = jobs->metadata ? SVN_INVALID_REVNUM
+                                             : jobs->first + unit;
+      SVN_ERR(report_error(revision, err, verify_callback, verify_baton,
+                           scratch_pool));
+    }
+  else if (notify_func && !jobs->metadata)
+    {
+      /* Tell the caller that we're done with this revision. */
+      svn_repos_notify_t *notify
+        = svn_repos_notify_create(svn_repos_notify_verify_rev_end,
+                                  scratch_pool);
+      notify->revision = jobs->first + unit;
+      notify_func(notify_baton, notify, scratch_pool);
+    }
+
+  return SVN_NO_ERROR;
+}
+
+/* Process all units of JOBS using THREAD_COUNT worker threads and report
+   the results in order to NOTIFY_FUNC / NOTIFY_BATON and VERIFY_CALLBACK /
+   VERIFY_BATON.  Check for cancellation using CANCEL_FUNC / CANCEL_BATON.
+   Use SCRATCH_POOL for temporary allocations. */
+static svn_error_t *
+verify_concurrently(verify_jobs_t *jobs,
+                    int thread_count,
+                    svn_repos_notify_func_t notify_func,
+                    void *notify_baton,
+                    svn_repos_verify_callback_t verify_callback,
+                    void *verify_baton,
+                    svn_cancel_func_t cancel_func,
+                    void *cancel_baton,
+                    apr_pool_t *scratch_pool)
+{
+  apr_pool_t *iterpool = svn_pool_create(scratch_pool);
+  svn_boolean_t metadata_notified = FALSE;
+  apr_thread_t **threads;
+  apr_status_t status;
+  svn_error_t *err = SVN_NO_ERROR;
+  int started = 0;
+  int unit;
+  int i;
+
+  thread_count = MIN(thread_count, jobs->unit_count);
+
+  jobs->buffer_notifications = notify_func != NULL;
+  jobs->next_unit = 0;
+  jobs->reported = 0;
+  jobs->window = thread_count * VERIFY_UNITS_PER_JOB;
+  jobs->results = apr_pcalloc(scratch_pool,
+                              jobs->window * sizeof(*jobs->results));
+  svn_atomic_set(&jobs->abort, FALSE);
+
+  status = apr_thread_mutex_create(&jobs->mutex, APR_THREAD_MUTEX_DEFAULT,
+                                   scratch_pool);
+  if (status)
+    return svn_error_wrap_apr(status, _("Can't create mutex"));
+
+  status = apr_thread_cond_create(&jobs->changed, scratch_pool);
+  if (status)
+    return svn_error_wrap_apr(status, _("Can't create condition variable"));
+
+  threads = apr_pcalloc(scratch_pool, thread_count * sizeof(*threads));
+  for (started = 0; started < thread_count; ++started)
+    {
+      status = apr_thread_create(&threads[started], NULL, verify_thread,
+                                 jobs, scratch_pool);
+      if (status)
+        {
+          err = svn_error_wrap_apr(status, _("Can't create thread"));
+          break;
+        }
+    }
+
+  /* Report the results in order. */
+  for (unit = 0; !err && unit < jobs->unit_count; ++unit)
+    {
+      verify_result_t *result = &jobs->results[unit % jobs->window];
+
+      svn_pool_clear(iterpool);
+
+      /* Wait for the unit to complete but keep checking for cancellation
+         while we do. */
+      apr_thread_mutex_lock(jobs->mutex);
+      while (!err && !result->done)
+        {
+          apr_thread_mutex_unlock(jobs->mutex);
+          if (cancel_func)
+            err = cancel_func(cancel_baton);
+          apr_thread_mutex_lock(jobs->mutex);
+
+          if (!err && !result->done)
+            apr_thread_cond_timedwait(jobs->changed, jobs->mutex,
+                                      VERIFY_POLL_INTERVAL);
+        }
+      apr_thread_mutex_unlock(jobs->mutex);
+
+      if (!err)
+        err = report_unit(jobs, unit, result, &metadata_notified,
+                          notify_func, notify_baton,
+                          verify_callback, verify_baton, iterpool);
+
+      /* Release the result slot. */
+      apr_thread_mutex_lock(jobs->mutex);
+      if (result->done)
+        {
+          svn_error_clear(result->err);
+          svn_pool_destroy(result->pool);
+          result->done = FALSE;
+        }
+      jobs->reported = unit + 1;
+      apr_thread_cond_broadcast(jobs->changed);
+      apr_thread_mutex_unlock(jobs->mutex);
+    }
+
+  /* Stop all workers, in case we bailed out early, and wait for them. */
+  apr_thread_mutex_lock(jobs->mutex);
+  svn_atomic_set(&jobs->abort, TRUE);
+  apr_thread_cond_broadcast(jobs->changed);
+  apr_thread_mutex_unlock(jobs->mutex);
+
+  for (i = 0; i < started; ++i)
+    {
+      apr_status_t thread_status;
+      status = apr_thread_join(&thread_status, threads[i]);
+      if (status)
+        err = svn_error_compose_create(err,
+                svn_error_wrap_apr(status, _("Can't join thread")));
+    }
+
+  /* Discard the results that we did not report. */
+  for (i = 0; i < jobs->window; ++i)
+    if (jobs->results[i].done)
+      {
+        svn_error_clear(jobs->results[i].err);
+        svn_pool_destroy(jobs->results[i].pool);
+      }
+
+  svn_pool_destroy(iterpool);
+
+  return svn_error_trace(err);
+}
+
+/* Set *CHUNK_SIZE to the number of revisions that the metadata checks
+   in FS should handle as a unit, or to 0 if they should not be split.
+   Use SCRATCH_POOL for temporary allocations. */
+static svn_error_t *
+get_metadata_chunk_size(svn_revnum_t *chunk_size,
+                        svn_fs_t *fs,
+                        apr_pool_t *scratch_pool)
+{
+  const svn_fs_info_placeholder_t *info;
+
+  /* The FSFS and FSX checks work on whole shards.  Chunks that don't
+     align with them would check the same data more than once. */
+  SVN_ERR(svn_fs_info(&info, fs, scratch_pool, scratch_pool));
+  if (strcmp(info->fs_type, SVN_FS_TYPE_FSFS) == 0)
+    *chunk_size = ((const svn_fs_fsfs_info_t *)info)->shard_size;
+  else if (strcmp(info->fs_type, SVN_FS_TYPE_FSX) == 0)
+    *chunk_size = ((const svn_fs_fsx_info_t *)info)->shard_size;
+  else
+    *chunk_size = 0;
+
+  return SVN_NO_ERROR;
+}
+
+#endif /* APR_HAS_THREADS */
+
 svn_error_t *
-svn_repos_verify_fs3(svn_repos_t *repos,
+svn_repos_verify_fs4(svn_repos_t *repos,
                      svn_revnum_t start_rev,
                      svn_revnum_t end_rev,
                      svn_boolean_t check_normalization,
                      svn_boolean_t metadata_only,
+                     int jobs,
                      svn_repos_notify_func_t notify_func,
                      void *notify_baton,
                      svn_repos_verify_callback_t verify_callback,
@@ -2481,6 +2938,10 @@ svn_repos_verify_fs3(svn_repos_t *repos,
   svn_fs_progress_notify_func_t verify_notify = NULL;
   struct verify_fs_notify_func_baton_t *verify_notify_baton = NULL;
   svn_error_t *err;
+#if APR_HAS_THREADS
+  verify_jobs_t verify_jobs = { 0 };
+  svn_revnum_t chunk_size = 0;
+#endif
 
   /* Make sure we catch up on the latest revprop changes.  This is the only
    * time we will refresh the revprop data in this query. */
@@ -2521,11 +2982,43 @@ svn_repos_verify_fs3(svn_repos_t *repos,
         = svn_repos_notify_create(svn_repos_notify_verify_rev_structure, pool);
     }
 
+#if APR_HAS_THREADS
+  /* Workers share the FSFS caches, which must support that. */
+  if (svn_cache_config_get()->single_threaded)
+    jobs = 1;
+
+  if (jobs > 1)
+    {
+      verify_jobs.fs_path = svn_fs_path(fs, pool);
+      verify_jobs.fs_config = svn_fs_config(fs, pool);
+      verify_jobs.start_rev = start_rev;
+      verify_jobs.end_rev = end_rev;
+      verify_jobs.check_normalization = check_normalization;
+
+      SVN_ERR(get_metadata_chunk_size(&chunk_size, fs, pool));
+    }
+
   /* Verify global metadata and backend-specific data first. */
-  err = svn_fs_verify(svn_fs_path(fs, pool), svn_fs_config(fs, pool),
-                      start_rev, end_rev,
-                      verify_notify, verify_notify_baton,
-                      cancel_func, cancel_baton, pool);
+  if (chunk_size > 0 && end_rev - start_rev >= chunk_size)
+    {
+      verify_jobs.metadata = TRUE;
+      verify_jobs.first = start_rev - start_rev % chunk_size;
+      verify_jobs.chunk_size = chunk_size;
+      verify_jobs.unit_count
+        = (int)((end_rev - verify_jobs.first) / chunk_size + 1);
+
+      SVN_ERR(verify_concurrently(&verify_jobs, jobs,
+                                  notify_func, notify_baton,
+                                  verify_callback, verify_baton,
+                                  cancel_func, cancel_baton, iterpool));
+      err = SVN_NO_ERROR;
+    }
+  else
+#endif
+    err = svn_fs_verify(svn_fs_path(fs, pool), svn_fs_config(fs, pool),
+                        start_rev, end_rev,
+                        verify_notify, verify_notify_baton,
+                        cancel_func, cancel_baton, pool);
 
   if (err && err->apr_err == SVN_ERR_CANCELLED)
     {
@@ -2537,6 +3030,22 @@ svn_repos_verify_fs3(svn_repos_t *repos,
                            verify_baton, iterpool));
     }
 
+#if APR_HAS_THREADS
+  /* Verify the revision contents. */
+  if (!metadata_only && jobs > 1 && end_rev > start_rev)
+    {
+      verify_jobs.metadata = FALSE;
+      verify_jobs.first = start_rev;
+      verify_jobs.chunk_size = 1;
+      verify_jobs.unit_count = (int)(end_rev - start_rev + 1);
+
+      SVN_ERR(verify_concurrently(&verify_jobs, jobs,
+                                  notify_func, notify_baton,
+                                  verify_callback, verify_baton,
+                                  cancel_func, cancel_baton, iterpool));
+    }
+  else
+#endif
   if (!metadata_only)
     for (rev = start_rev; rev <= end_rev; rev++)
       {
@@ -35,6 +35,7 @@
 #include "svn_sorts.h"
 #include "svn_subst.h"
 #include "repos.h"
+#include "log_index.h"
 #include "svn_private_config.h"
 #include "private/svn_repos_private.h"
 #include "private/svn_sorts_private.h"
@@ -44,6 +45,26 @@
 
 /*** Commit wrappers ***/
 
+/* Add the latest revisions of REPOS to its log index, if it has one.
+   Use SCRATCH_POOL for temporary allocations. */
+static svn_error_t *
+update_log_index(svn_repos_t *repos,
+                 apr_pool_t *scratch_pool)
+{
+  svn_repos__log_index_t *index;
+  apr_pool_t *subpool = svn_pool_create(scratch_pool);
+
+  SVN_ERR(svn_repos__log_index_open(&index, repos, FALSE, subpool, subpool));
+  if (index)
+    SVN_ERR(svn_repos__log_index_update(NULL, index, repos->fs, NULL, NULL,
+                                        subpool));
+
+  /* Close the index database. */
+  svn_pool_destroy(subpool);
+
+  return SVN_NO_ERROR;
+}
+
 svn_error_t *
 svn_repos_fs_commit_txn(const char **conflict_p,
                         svn_repos_t *repos,
@@ -111,6 +132,17 @@ svn_repos_fs_commit_txn(const char **conflict_p,
       return err;
     }
 
+  /* Bring the log index up to date, if the repository has one.  The
+     commit is done, so just report failures like those of the post-commit
+     hook.  The next commit will catch up on what we missed here. */
+  if ((err2 = update_log_index(repos, pool)))
+    {
+      err2 = svn_error_create
+               (SVN_ERR_REPOS_POST_COMMIT_HOOK_FAILED, err2,
+                _("Commit succeeded, but updating the log index failed"));
+      err = svn_error_compose_create(err, err2);
+    }
+
   /* Run post-commit hooks. */
   if ((err2 = svn_repos__hooks_post_commit(repos, hooks_env,
                                            *new_rev, txn_name, pool)))
@@ -1005,11 +1037,12 @@ struct pack_notify_baton
   void *notify_baton;
 };
 
-/* Implements svn_fs_pack_notify_t. */
+/* Implements svn_fs_pack_notify2_t. */
 static svn_error_t *
 pack_notify_func(void *baton,
                  apr_int64_t shard,
                  svn_fs_pack_notify_action_t pack_action,
+                 apr_interval_time_t duration,
                  apr_pool_t *pool)
 {
   struct pack_notify_baton *pnb = baton;
@@ -1027,6 +1060,7 @@ pack_notify_func(void *baton,
 
   notify = svn_repos_notify_create(repos_action, pool);
   notify->shard = shard;
+  notify->duration = duration;
   pnb->notify_func(pnb->notify_baton, notify, pool);
 
   return SVN_NO_ERROR;
@@ -1045,10 +1079,10 @@ svn_repos_fs_pack2(svn_repos_t *repos,
   pnb.notify_func = notify_func;
   pnb.notify_baton = notify_baton;
 
-  return svn_fs_pack(repos->db_path,
-                     notify_func ? pack_notify_func : NULL,
-                     notify_func ? &pnb : NULL,
-                     cancel_func, cancel_baton, pool);
+  return svn_fs_pack2(repos->db_path, svn_fs_config(repos->fs, pool),
+                      notify_func ? pack_notify_func : NULL,
+                      notify_func ? &pnb : NULL,
+                      cancel_func, cancel_baton, pool);
 }
 
 svn_error_t *
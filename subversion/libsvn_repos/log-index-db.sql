@@ -0,0 +1,72 @@
+/* log-index-db.sql -- schema of the optional repository log index
+ *   This is intended for use with SQLite 3
+ *
+ * ====================================================================
+ *    Licensed to the Apache Software Foundation (ASF) under one
+ *    or more contributor license agreements.  See the NOTICE file
+ *    distributed with this work for additional information
+ *    regarding copyright ownership.  The ASF licenses this file
+ *    to you under the Apache License, Version 2.0 (the
+ *    "License"); you may not use this file except in compliance
+ *    with the License.  You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *    Unless required by applicable law or agreed to in writing,
+ *    software distributed under the License is distributed on an
+ *    "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+ *    KIND, either express or implied.  See the License for the
+ *    specific language governing permissions and limitations
+ *    under the License.
+ * ====================================================================
+ */
+
+-- STMT_CREATE_SCHEMA
+/* For every revision, the changed paths and all their parent paths.
+   I.e. the revisions in which anything at or below PATH changed. */
+CREATE TABLE path_revision (
+  path TEXT NOT NULL,
+  revision INTEGER NOT NULL,
+  PRIMARY KEY (path, revision)
+  ) WITHOUT ROWID;
+
+/* Changed paths that got copied, deleted or replaced in REVISION.
+   Node history across these is not a simple function of PATH_REVISION. */
+CREATE TABLE node_event (
+  path TEXT NOT NULL,
+  revision INTEGER NOT NULL,
+  PRIMARY KEY (path, revision)
+  ) WITHOUT ROWID;
+
+/* Single row holding the youngest revision covered by the index. */
+CREATE TABLE indexed_revision (
+  id INTEGER NOT NULL PRIMARY KEY,
+  revision INTEGER NOT NULL
+  );
+
+INSERT INTO indexed_revision (id, revision) VALUES (0, 0);
+
+PRAGMA USER_VERSION = 1;
+
+-- STMT_GET_INDEXED_REVISION
+SELECT revision FROM indexed_revision WHERE id = 0
+
+-- STMT_SET_INDEXED_REVISION
+UPDATE indexed_revision SET revision = ?1 WHERE id = 0
+
+-- STMT_INSERT_PATH_REVISION
+INSERT OR IGNORE INTO path_revision (path, revision) VALUES (?1, ?2)
+
+-- STMT_INSERT_NODE_EVENT
+INSERT OR IGNORE INTO node_event (path, revision) VALUES (?1, ?2)
+
+-- STMT_SELECT_PATH_REVISIONS
+SELECT revision FROM path_revision
+WHERE path = ?1 AND revision >= ?2 AND revision <= ?3
+ORDER BY revision DESC
+
+-- STMT_HAS_NODE_EVENT
+SELECT 1 FROM node_event
+WHERE path = ?1 AND revision >= ?2 AND revision <= ?3
+LIMIT 1
+
@@ -38,9 +38,11 @@
 #include "svn_props.h"
 #include "svn_mergeinfo.h"
 #include "repos.h"
+#include "log_index.h"
 #include "private/svn_fspath.h"
 #include "private/svn_fs_private.h"
 #include "private/svn_mergeinfo_private.h"
+#include "private/svn_repos_private.h"
 #include "private/svn_subr_private.h"
 #include "private/svn_sorts_private.h"
 #include "private/svn_string_private.h"
@@ -56,6 +58,9 @@ typedef struct log_callbacks_t
   void *revision_receiver_baton;
   svn_repos_authz_func_t authz_read_func;
   void *authz_read_baton;
+
+  /* The repository's log index.  NULL if there is none. */
+  svn_repos__log_index_t *log_index;
 } log_callbacks_t;
 
 
@@ -110,6 +115,92 @@ svn_repos_log_entry_dup(const svn_repos_log_entry_t *log_entry,
   return new_entry;
 }
 
+/* Number of changed paths that we check for readability at once. */
+#define CHANGES_BLOCK_SIZE 1024
+
+/* Fetch the next up to CHANGES_BLOCK_SIZE changes from ITERATOR and
+   return copies of them (svn_fs_path_change3_t *) in *CHANGES.  An empty
+   array signals that ITERATOR has been exhausted.
+
+   If AUTHZ_READ_FUNC is svn_repos__authz_read_func(), set *READABLE to
+   an array of booleans telling for each element of *CHANGES whether its
+   path is readable in ROOT according to AUTHZ_READ_BATON.  All paths will
+   be checked in one go.  Otherwise, set *READABLE to NULL and leave the
+   checks to the caller.  Other authz callbacks may be expensive per path,
+   so the caller should only check the paths that it actually looks at.
+
+   Allocate the results in RESULT_POOL.  Use SCRATCH_POOL for temporary
+   allocations. */
+static svn_error_t *
+get_changes_block(apr_array_header_t **changes,
+                  svn_boolean_t **readable,
+                  svn_fs_path_change_iterator_t *iterator,
+                  svn_fs_root_t *root,
+                  svn_repos_authz_func_t authz_read_func,
+                  void *authz_read_baton,
+                  apr_pool_t *result_pool,
+                  apr_pool_t *scratch_pool)
+{
+  apr_array_header_t *paths = apr_array_make(scratch_pool,
+                                             CHANGES_BLOCK_SIZE,
+                                             sizeof(const char *));
+  svn_fs_path_change3_t *change;
+
+  *changes = apr_array_make(result_pool, CHANGES_BLOCK_SIZE,
+                            sizeof(svn_fs_path_change3_t *));
+  while ((*changes)->nelts < CHANGES_BLOCK_SIZE)
+    {
+      SVN_ERR(svn_fs_path_change_get(&change, iterator));
+      if (!change)
+        break;
+
+      change = svn_fs_path_change3_dup(change, result_pool);
+      APR_ARRAY_PUSH(*changes, svn_fs_path_change3_t *) = change;
+      APR_ARRAY_PUSH(paths, const char *) = change->path.data;
+    }
+
+  if (authz_read_func == svn_repos__authz_read_func)
+    {
+      *readable = apr_palloc(result_pool,
+                             (*changes)->nelts * sizeof(**readable));
+      SVN_ERR(svn_repos__authz_read_paths(*readable, root, paths,
+                                          authz_read_func, authz_read_baton,
+                                          scratch_pool));
+    }
+  else
+    {
+      *readable = NULL;
+    }
+
+  return SVN_NO_ERROR;
+}
+
+/* Set *PATH_READABLE to whether the path of CHANGE, the I-th element of
+   the current block of changes, is readable in ROOT.  READABLE is the
+   result of get_changes_block() for that block.  If it is NULL, ask the
+   optional AUTHZ_READ_FUNC with AUTHZ_READ_BATON.  Use SCRATCH_POOL for
+   temporary allocations. */
+static svn_error_t *
+is_change_readable(svn_boolean_t *path_readable,
+                   const svn_boolean_t *readable,
+                   int i,
+                   const svn_fs_path_change3_t *change,
+                   svn_fs_root_t *root,
+                   svn_repos_authz_func_t authz_read_func,
+                   void *authz_read_baton,
+                   apr_pool_t *scratch_pool)
+{
+  if (readable)
+    *path_readable = readable[i];
+  else if (authz_read_func)
+    SVN_ERR(authz_read_func(path_readable, root, change->path.data,
+                            authz_read_baton, scratch_pool));
+  else
+    *path_readable = TRUE;
+
+  return SVN_NO_ERROR;
+}
+
 svn_error_t *
 svn_repos_check_revision_access(svn_repos_revision_access_level_t *access_level,
                                 svn_repos_t *repos,
@@ -121,10 +212,13 @@ svn_repos_check_revision_access(svn_repos_revision_access_level_t *access_level,
   svn_fs_t *fs = svn_repos_fs(repos);
   svn_fs_root_t *rev_root;
   svn_fs_path_change_iterator_t *iterator;
-  svn_fs_path_change3_t *change;
+  apr_array_header_t *changes;
+  svn_boolean_t *readable;
   svn_boolean_t found_readable = FALSE;
   svn_boolean_t found_unreadable = FALSE;
   apr_pool_t *iterpool;
+  apr_pool_t *blockpool;
+  int i;
 
   /* By default, we'll grant full read access to REVISION. */
   *access_level = svn_repos_revision_access_full;
@@ -133,30 +227,55 @@ svn_repos_check_revision_access(svn_repos_revision_access_level_t *access_level,
   if (! authz_read_func)
     return SVN_NO_ERROR;
 
-  /* Fetch the changes associated with REVISION. */
+  /* Fetch the changes associated with REVISION.  If possible, check the
+     readability of the first block of them in one go. */
   SVN_ERR(svn_fs_revision_root(&rev_root, fs, revision, pool));
   SVN_ERR(svn_fs_paths_changed3(&iterator, rev_root, pool, pool));
-  SVN_ERR(svn_fs_path_change_get(&change, iterator));
+
+  blockpool = svn_pool_create(pool);
+  SVN_ERR(get_changes_block(&changes, &readable, iterator, rev_root,
+                            authz_read_func, authz_read_baton,
+                            blockpool, blockpool));
 
   /* No changed paths?  We're done.
 
      Note that the check at "decision:" assumes that at least one
      path has been processed.  So, this actually affects functionality. */
-  if (!change)
-    return SVN_NO_ERROR;
+  if (changes->nelts == 0)
+    {
+      svn_pool_destroy(blockpool);
+      return SVN_NO_ERROR;
+    }
 
   /* Otherwise, we have to check the readability of each changed
      path, or at least enough to answer the question asked. */
   iterpool = svn_pool_create(pool);
-  while (change)
+  i = 0;
+  while (TRUE)
     {
-      svn_boolean_t readable;
+      svn_fs_path_change3_t *change;
+      svn_boolean_t path_readable;
+
+      /* Continue with the next block of changes. */
+      if (i == changes->nelts)
+        {
+          svn_pool_clear(blockpool);
+          SVN_ERR(get_changes_block(&changes, &readable, iterator, rev_root,
+                                    authz_read_func, authz_read_baton,
+                                    blockpool, blockpool));
+          if (changes->nelts == 0)
+            break;
+
+          i = 0;
+        }
 
+      change = APR_ARRAY_IDX(changes, i, svn_fs_path_change3_t *);
       svn_pool_clear(iterpool);
 
-      SVN_ERR(authz_read_func(&readable, rev_root, change->path.data,
-                              authz_read_baton, iterpool));
-      if (! readable)
+      SVN_ERR(is_change_readable(&path_readable, readable, i++, change,
+                                 rev_root, authz_read_func,
+                                 authz_read_baton, iterpool));
+      if (! path_readable)
         found_unreadable = TRUE;
       else
         found_readable = TRUE;
@@ -180,12 +299,14 @@ svn_repos_check_revision_access(svn_repos_revision_access_level_t *access_level,
             if (copyfrom_path && SVN_IS_VALID_REVNUM(copyfrom_rev))
               {
                 svn_fs_root_t *copyfrom_root;
+                svn_boolean_t copyfrom_readable;
+
                 SVN_ERR(svn_fs_revision_root(&copyfrom_root, fs,
                                              copyfrom_rev, iterpool));
-                SVN_ERR(authz_read_func(&readable,
+                SVN_ERR(authz_read_func(&copyfrom_readable,
                                         copyfrom_root, copyfrom_path,
                                         authz_read_baton, iterpool));
-                if (! readable)
+                if (! copyfrom_readable)
                   found_unreadable = TRUE;
 
                 /* If we have at least one of each (readable/unreadable), we
@@ -201,12 +322,11 @@ svn_repos_check_revision_access(svn_repos_revision_access_level_t *access_level,
         default:
           break;
         }
-
-      SVN_ERR(svn_fs_path_change_get(&change, iterator));
     }
 
  decision:
   svn_pool_destroy(iterpool);
+  svn_pool_destroy(blockpool);
 
   /* Either every changed path was unreadable... */
   if (! found_readable)
@@ -252,45 +372,70 @@ detect_changed(svn_repos_revision_access_level_t *access_level,
                apr_pool_t *scratch_pool)
 {
   svn_fs_path_change_iterator_t *iterator;
-  svn_fs_path_change3_t *change;
+  apr_array_header_t *changes;
+  svn_boolean_t *readable;
   apr_pool_t *iterpool;
+  apr_pool_t *blockpool;
   svn_boolean_t found_readable = FALSE;
   svn_boolean_t found_unreadable = FALSE;
+  int i;
 
-  /* Retrieve the first change in the list. */
+  /* Retrieve the first block of changes in the list.  If possible, check
+     their readability in one go. */
   SVN_ERR(svn_fs_paths_changed3(&iterator, root, scratch_pool, scratch_pool));
-  SVN_ERR(svn_fs_path_change_get(&change, iterator));
 
-  if (!change)
+  blockpool = svn_pool_create(scratch_pool);
+  SVN_ERR(get_changes_block(&changes, &readable, iterator, root,
+                            callbacks->authz_read_func,
+                            callbacks->authz_read_baton,
+                            blockpool, blockpool));
+
+  if (changes->nelts == 0)
     {
       /* No paths changed in this revision?  Uh, sure, I guess the
          revision is readable, then.  */
+      svn_pool_destroy(blockpool);
       *access_level = svn_repos_revision_access_full;
       return SVN_NO_ERROR;
     }
 
   iterpool = svn_pool_create(scratch_pool);
-  while (change)
+  i = 0;
+  while (TRUE)
     {
       /* NOTE:  Much of this loop is going to look quite similar to
          svn_repos_check_revision_access(), but we have to do more things
          here, so we'll live with the duplication. */
-      const char *path = change->path.data;
+      svn_fs_path_change3_t *change;
+      const char *path;
+      svn_boolean_t path_readable;
+
+      /* Continue with the next block of changes. */
+      if (i == changes->nelts)
+        {
+          svn_pool_clear(blockpool);
+          SVN_ERR(get_changes_block(&changes, &readable, iterator, root,
+                                    callbacks->authz_read_func,
+                                    callbacks->authz_read_baton,
+                                    blockpool, blockpool));
+          if (changes->nelts == 0)
+            break;
+
+          i = 0;
+        }
+
+      change = APR_ARRAY_IDX(changes, i, svn_fs_path_change3_t *);
+      path = change->path.data;
       svn_pool_clear(iterpool);
 
       /* Skip path if unreadable. */
-      if (callbacks->authz_read_func)
+      SVN_ERR(is_change_readable(&path_readable, readable, i++, change,
+                                 root, callbacks->authz_read_func,
+                                 callbacks->authz_read_baton, iterpool));
+      if (! path_readable)
         {
-          svn_boolean_t readable;
-          SVN_ERR(callbacks->authz_read_func(&readable, root, path,
-                                             callbacks->authz_read_baton,
-                                             iterpool));
-          if (! readable)
-            {
-              found_unreadable = TRUE;
-              SVN_ERR(svn_fs_path_change_get(&change, iterator));
-              continue;
-            }
+          found_unreadable = TRUE;
+          continue;
         }
 
       /* At least one changed-path was readable. */
@@ -382,12 +527,10 @@ detect_changed(svn_repos_revision_access_level_t *access_level,
                                      callbacks->path_change_receiver_baton,
                                      change,
                                      iterpool));
-
-      /* Next changed path. */
-      SVN_ERR(svn_fs_path_change_get(&change, iterator));
     }
 
   svn_pool_destroy(iterpool);
+  svn_pool_destroy(blockpool);
 
   if (! found_readable)
     {
@@ -429,12 +572,49 @@ struct path_info
   svn_fs_history_t *hist;
   apr_pool_t *newpool;
   apr_pool_t *oldpool;
+
+  /* If the log index could tell us the history of this path, these are
+     the revisions (svn_revnum_t) in which it changed, youngest first,
+     and the position of the next one to report.  Otherwise NULL. */
+  apr_array_header_t *index_revs;
+  int index_pos;
 };
 
+/* Set INFO->DONE if INFO->PATH is not readable in INFO->HISTORY_REV
+ * according to AUTHZ_READ_FUNC with AUTHZ_READ_BATON.  The latter may
+ * be NULL.  Use SCRATCH_POOL for temporary allocations.
+ */
+static svn_error_t *
+check_history_readable(struct path_info *info,
+                       svn_fs_t *fs,
+                       svn_repos_authz_func_t authz_read_func,
+                       void *authz_read_baton,
+                       apr_pool_t *scratch_pool)
+{
+  if (authz_read_func)
+    {
+      svn_boolean_t readable;
+      svn_fs_root_t *history_root;
+
+      SVN_ERR(svn_fs_revision_root(&history_root, fs,
+                                   info->history_rev,
+                                   scratch_pool));
+      SVN_ERR(authz_read_func(&readable, history_root,
+                              info->path->data,
+                              authz_read_baton,
+                              scratch_pool));
+      if (! readable)
+        info->done = TRUE;
+    }
+
+  return SVN_NO_ERROR;
+}
+
 /* Advance to the next history for the path.
  *
- * If INFO->HIST is not NULL we do this using that existing history object,
- * otherwise we open a new one.
+ * If INFO->INDEX_REVS is not NULL, simply take the next revision from
+ * there.  Otherwise, if INFO->HIST is not NULL we do this using that
+ * existing history object, otherwise we open a new one.
  *
  * If no more history is available or the history revision is less
  * (earlier) than START, or the history is not available due
@@ -462,6 +642,25 @@ get_history(struct path_info *info,
   apr_pool_t *subpool;
   const char *path;
 
+  if (info->index_revs)
+    {
+      /* The path does not change within the indexed range. */
+      if (info->index_pos == info->index_revs->nelts)
+        {
+          info->done = TRUE;
+          return SVN_NO_ERROR;
+        }
+
+      info->history_rev = APR_ARRAY_IDX(info->index_revs, info->index_pos,
+                                        svn_revnum_t);
+      ++info->index_pos;
+
+      return svn_error_trace(check_history_readable(info, fs,
+                                                    authz_read_func,
+                                                    authz_read_baton,
+                                                    scratch_pool));
+    }
+
   if (info->hist)
     {
       subpool = info->newpool;
@@ -519,19 +718,8 @@ get_history(struct path_info *info,
     }
 
   /* Is the history item readable?  If not, done with path. */
-  if (authz_read_func)
-    {
-      svn_boolean_t readable;
-      SVN_ERR(svn_fs_revision_root(&history_root, fs,
-                                   info->history_rev,
-                                   scratch_pool));
-      SVN_ERR(authz_read_func(&readable, history_root,
-                              info->path->data,
-                              authz_read_baton,
-                              scratch_pool));
-      if (! readable)
-        info->done = TRUE;
-    }
+  SVN_ERR(check_history_readable(info, fs, authz_read_func,
+                                 authz_read_baton, scratch_pool));
 
   if (! info->hist)
     {
@@ -1390,7 +1578,10 @@ send_log(svn_revnum_t rev,
 /* Get the histories for PATHS, and store them in *HISTORIES.
 
    If IGNORE_MISSING_LOCATIONS is set, don't treat requests for bogus
-   repository locations as fatal -- just ignore them.  */
+   repository locations as fatal -- just ignore them.
+
+   If LOG_INDEX is not NULL, take the history from there for all paths
+   for which it is available.  */
 static svn_error_t *
 get_path_histories(apr_array_header_t **histories,
                    svn_fs_t *fs,
@@ -1401,12 +1592,14 @@ get_path_histories(apr_array_header_t **histories,
                    svn_boolean_t ignore_missing_locations,
                    svn_repos_authz_func_t authz_read_func,
                    void *authz_read_baton,
+                   svn_repos__log_index_t *log_index,
                    apr_pool_t *pool)
 {
   svn_fs_root_t *root;
   apr_pool_t *iterpool;
   svn_error_t *err;
   int i;
+  int open_histories = 0;
 
   /* Create a history object for each path so we can walk through
      them all at the same time until we have all changes or LIMIT
@@ -1442,8 +1635,32 @@ get_path_histories(apr_array_header_t **histories,
       info->done = FALSE;
       info->history_rev = hist_end;
       info->first_time = TRUE;
+      info->index_revs = NULL;
+      info->index_pos = 0;
 
-      if (i < MAX_OPEN_HISTORIES)
+      /* The index only knows about paths that exist in HIST_END.
+         Leave the error handling for other paths to the FS. */
+      if (log_index)
+        {
+          svn_node_kind_t kind;
+
+          SVN_ERR(svn_fs_check_path(&kind, root, this_path, iterpool));
+          if (kind != svn_node_none)
+            SVN_ERR(svn_repos__log_index_get_revisions(&info->index_revs,
+                                                       log_index,
+                                                       this_path,
+                                                       hist_start,
+                                                       hist_end,
+                                                       pool, iterpool));
+        }
+
+      if (info->index_revs)
+        {
+          info->hist = NULL;
+          info->oldpool = NULL;
+          info->newpool = NULL;
+        }
+      else if (open_histories++ < MAX_OPEN_HISTORIES)
         {
           err = svn_fs_node_history2(&info->hist, root, this_path, pool,
                                      iterpool);
@@ -2015,7 +2232,8 @@ do_logs(svn_fs_t *fs,
   SVN_ERR(get_path_histories(&histories, fs, paths, hist_start, hist_end,
                              strict_node_history, ignore_missing_locations,
                              callbacks->authz_read_func,
-                             callbacks->authz_read_baton, pool));
+                             callbacks->authz_read_baton,
+                             callbacks->log_index, pool));
 
   /* Loop through all the revisions in the range and add any
      where a path was changed to the array, or if they wanted
@@ -2332,6 +2550,7 @@ svn_repos_get_logs5(svn_repos_t *repos,
   callbacks.revision_receiver_baton = revision_receiver_baton;
   callbacks.authz_read_func = authz_read_func;
   callbacks.authz_read_baton = authz_read_baton;
+  callbacks.log_index = NULL;
 
   if (revprops)
     {
@@ -2460,6 +2679,10 @@ svn_repos_get_logs5(svn_repos_t *repos,
       svn_pool_destroy(subpool);
     }
 
+  /* Use the log index, if the repository has one. */
+  SVN_ERR(svn_repos__log_index_open(&callbacks.log_index, repos, TRUE,
+                                    scratch_pool, scratch_pool));
+
   return do_logs(repos->fs, paths, paths_history_mergeinfo, NULL, NULL,
                  start, end, limit, strict_node_history,
                  include_merged_revisions, FALSE, FALSE, FALSE,
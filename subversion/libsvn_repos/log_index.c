@@ -0,0 +1,387 @@
+/* log_index.c : maintain and query the optional log index
+ *
+ * ====================================================================
+ *    Licensed to the Apache Software Foundation (ASF) under one
+ *    or more contributor license agreements.  See the NOTICE file
+ *    distributed with this work for additional information
+ *    regarding copyright ownership.  The ASF licenses this file
+ *    to you under the Apache License, Version 2.0 (the
+ *    "License"); you may not use this file except in compliance
+ *    with the License.  You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *    Unless required by applicable law or agreed to in writing,
+ *    software distributed under the License is distributed on an
+ *    "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+ *    KIND, either express or implied.  See the License for the
+ *    specific language governing permissions and limitations
+ *    under the License.
+ * ====================================================================
+ */
+
+#include <apr_hash.h>
+
+#include "svn_dirent_uri.h"
+#include "svn_hash.h"
+#include "svn_io.h"
+#include "svn_pools.h"
+#include "svn_repos.h"
+#include "svn_sorts.h"
+
+#include "svn_private_config.h"
+
+#include "repos.h"
+#include "log_index.h"
+
+#include "private/svn_fspath.h"
+#include "private/svn_repos_private.h"
+#include "private/svn_sqlite.h"
+
+#include "log-index-db.h"
+
+LOG_INDEX_DB_SQL_DECLARE_STATEMENTS(statements);
+
+/* The schema version that we create and understand. */
+#define LOG_INDEX_SCHEMA_FORMAT 1
+
+/* Number of revisions that we add to the index within a single SQLite
+ * transaction.  Keeps the write lock short when catching up on a large
+ * number of revisions. */
+#define UPDATE_BATCH_SIZE 100
+
+struct svn_repos__log_index_t
+{
+  /* The index database. */
+  svn_sqlite__db_t *sdb;
+};
+
+
+/** Helper functions. **/
+
+/* Return the path of REPOS's log index database, allocated in
+ * RESULT_POOL. */
+static const char *
+path_log_index_db(svn_repos_t *repos,
+                  apr_pool_t *result_pool)
+{
+  return svn_dirent_join(repos->db_path, SVN_REPOS__LOG_INDEX_DB,
+                         result_pool);
+}
+
+/* Set *REV to the youngest revision covered by INDEX. */
+static svn_error_t *
+get_indexed_revision(svn_revnum_t *rev,
+                     svn_repos__log_index_t *index)
+{
+  svn_sqlite__stmt_t *stmt;
+  svn_boolean_t have_row;
+
+  SVN_ERR(svn_sqlite__get_statement(&stmt, index->sdb,
+                                    STMT_GET_INDEXED_REVISION));
+  SVN_ERR(svn_sqlite__step(&have_row, stmt));
+  *rev = have_row ? svn_sqlite__column_revnum(stmt, 0) : 0;
+
+  return svn_error_trace(svn_sqlite__reset(stmt));
+}
+
+/* Add the changes of revision REV in FS to INDEX.  Use SCRATCH_POOL for
+ * temporary allocations. */
+static svn_error_t *
+index_revision(svn_repos__log_index_t *index,
+               svn_fs_t *fs,
+               svn_revnum_t rev,
+               apr_pool_t *scratch_pool)
+{
+  apr_hash_t *indexed_paths = apr_hash_make(scratch_pool);
+  svn_sqlite__stmt_t *path_stmt, *event_stmt;
+  svn_fs_path_change_iterator_t *iterator;
+  svn_fs_path_change3_t *change;
+  svn_fs_root_t *root;
+
+  SVN_ERR(svn_sqlite__get_statement(&path_stmt, index->sdb,
+                                    STMT_INSERT_PATH_REVISION));
+  SVN_ERR(svn_sqlite__get_statement(&event_stmt, index->sdb,
+                                    STMT_INSERT_NODE_EVENT));
+
+  SVN_ERR(svn_fs_revision_root(&root, fs, rev, scratch_pool));
+  SVN_ERR(svn_fs_paths_changed3(&iterator, root, scratch_pool,
+                                scratch_pool));
+  SVN_ERR(svn_fs_path_change_get(&change, iterator));
+  while (change)
+    {
+      const char *path = apr_pstrmemdup(scratch_pool, change->path.data,
+                                        change->path.len);
+
+      /* Copies, deletions and replacements break the node history of
+         PATH and everything below it.  The history of a node that got
+         added without history simply starts with the addition. */
+      if (change->change_kind != svn_fs_path_change_modify
+          && (change->change_kind != svn_fs_path_change_add
+              || !change->copyfrom_known
+              || change->copyfrom_path))
+        {
+          SVN_ERR(svn_sqlite__bindf(event_stmt, "sr", path, rev));
+          SVN_ERR(svn_sqlite__insert(NULL, event_stmt));
+        }
+
+      /* The change shows up in the history of all parents as well.
+         Those of a path that we already added have been added, too.
+         The root changes in every revision and is not indexed. */
+      while (!svn_fspath__is_root(path, strlen(path))
+             && !svn_hash_gets(indexed_paths, path))
+        {
+          svn_hash_sets(indexed_paths, path, path);
+          SVN_ERR(svn_sqlite__bindf(path_stmt, "sr", path, rev));
+          SVN_ERR(svn_sqlite__insert(NULL, path_stmt));
+
+          path = svn_fspath__dirname(path, scratch_pool);
+        }
+
+      SVN_ERR(svn_fs_path_change_get(&change, iterator));
+    }
+
+  return SVN_NO_ERROR;
+}
+
+/* Add all revisions up to LAST_REV in FS to INDEX, if they have not been
+ * indexed already, and return the youngest revision covered by INDEX in
+ * *INDEXED_REV.  Call CANCEL_FUNC with CANCEL_BATON between revisions.
+ * Must be called within an SQLite transaction.  Use SCRATCH_POOL for
+ * temporary allocations. */
+static svn_error_t *
+index_revisions(svn_revnum_t *indexed_rev,
+                svn_repos__log_index_t *index,
+                svn_fs_t *fs,
+                svn_revnum_t last_rev,
+                svn_cancel_func_t cancel_func,
+                void *cancel_baton,
+                apr_pool_t *scratch_pool)
+{
+  apr_pool_t *iterpool;
+  svn_sqlite__stmt_t *stmt;
+  svn_revnum_t rev;
+
+  /* Another process may have been faster than us. */
+  SVN_ERR(get_indexed_revision(indexed_rev, index));
+  if (*indexed_rev >= last_rev)
+    return SVN_NO_ERROR;
+
+  iterpool = svn_pool_create(scratch_pool);
+  for (rev = *indexed_rev + 1; rev <= last_rev; ++rev)
+    {
+      svn_pool_clear(iterpool);
+      if (cancel_func)
+        SVN_ERR(cancel_func(cancel_baton));
+
+      SVN_ERR(index_revision(index, fs, rev, iterpool));
+    }
+  svn_pool_destroy(iterpool);
+
+  SVN_ERR(svn_sqlite__get_statement(&stmt, index->sdb,
+                                    STMT_SET_INDEXED_REVISION));
+  SVN_ERR(svn_sqlite__bindf(stmt, "r", last_rev));
+  SVN_ERR(svn_sqlite__update(NULL, stmt));
+  *indexed_rev = last_rev;
+
+  return SVN_NO_ERROR;
+}
+
+
+/** Library-private API's. **/
+
+svn_error_t *
+svn_repos__log_index_open(svn_repos__log_index_t **index,
+                          svn_repos_t *repos,
+                          svn_boolean_t read_only,
+                          apr_pool_t *result_pool,
+                          apr_pool_t *scratch_pool)
+{
+  const char *db_path = path_log_index_db(repos, scratch_pool);
+  svn_sqlite__db_t *sdb;
+  svn_node_kind_t kind;
+  int version;
+
+  *index = NULL;
+
+  /* The index is optional.  Don't create it implicitly. */
+  SVN_ERR(svn_io_check_path(db_path, &kind, scratch_pool));
+  if (kind != svn_node_file)
+    return SVN_NO_ERROR;
+
+  SVN_ERR(svn_sqlite__open(&sdb, db_path,
+                           read_only ? svn_sqlite__mode_readonly
+                                     : svn_sqlite__mode_readwrite,
+                           statements, 0, NULL, 0,
+                           result_pool, scratch_pool));
+
+  SVN_SQLITE__ERR_CLOSE(svn_sqlite__read_schema_version(&version, sdb,
+                                                        scratch_pool),
+                        sdb);
+
+  /* If we have an uninitialized database, go ahead and create the schema
+     unless we are just about to read it.  In that case, the index is
+     not ready for use, yet. */
+  if (version <= 0 && !read_only)
+    {
+      SVN_SQLITE__ERR_CLOSE(svn_sqlite__exec_statements(sdb,
+                                                        STMT_CREATE_SCHEMA),
+                            sdb);
+      version = LOG_INDEX_SCHEMA_FORMAT;
+    }
+
+  if (version <= 0)
+    return svn_error_trace(svn_sqlite__close(sdb));
+
+  if (version != LOG_INDEX_SCHEMA_FORMAT)
+    return svn_error_compose_create(
+             svn_error_createf(SVN_ERR_SQLITE_UNSUPPORTED_SCHEMA, NULL,
+                               _("Log index '%s' has unsupported schema "
+                                 "version %d"),
+                               svn_dirent_local_style(db_path,
+                                                      scratch_pool),
+                               version),
+             svn_sqlite__close(sdb));
+
+  *index = apr_pcalloc(result_pool, sizeof(**index));
+  (*index)->sdb = sdb;
+
+  return SVN_NO_ERROR;
+}
+
+svn_error_t *
+svn_repos__log_index_update(svn_revnum_t *indexed_rev,
+                            svn_repos__log_index_t *index,
+                            svn_fs_t *fs,
+                            svn_cancel_func_t cancel_func,
+                            void *cancel_baton,
+                            apr_pool_t *scratch_pool)
+{
+  apr_pool_t *iterpool = svn_pool_create(scratch_pool);
+  svn_revnum_t youngest, rev;
+
+  SVN_ERR(svn_fs_youngest_rev(&youngest, fs, scratch_pool));
+  SVN_ERR(get_indexed_revision(&rev, index));
+
+  /* Add the missing revisions in batches such that concurrent readers
+     and writers don't get blocked for long. */
+  while (rev < youngest)
+    {
+      svn_revnum_t last_rev = MIN(rev + UPDATE_BATCH_SIZE, youngest);
+
+      svn_pool_clear(iterpool);
+      SVN_SQLITE__WITH_IMMEDIATE_TXN(index_revisions(&rev, index, fs,
+                                                     last_rev,
+                                                     cancel_func,
+                                                     cancel_baton,
+                                                     iterpool),
+                                     index->sdb);
+    }
+  svn_pool_destroy(iterpool);
+
+  if (indexed_rev)
+    *indexed_rev = rev;
+
+  return SVN_NO_ERROR;
+}
+
+svn_error_t *
+svn_repos__log_index_get_revisions(apr_array_header_t **revisions,
+                                   svn_repos__log_index_t *index,
+                                   const char *fs_path,
+                                   svn_revnum_t start,
+                                   svn_revnum_t end,
+                                   apr_pool_t *result_pool,
+                                   apr_pool_t *scratch_pool)
+{
+  svn_sqlite__stmt_t *stmt;
+  svn_boolean_t have_row;
+  svn_revnum_t indexed_rev;
+  const char *path;
+
+  *revisions = NULL;
+
+  fs_path = svn_fspath__canonicalize(fs_path, scratch_pool);
+  if (svn_fspath__is_root(fs_path, strlen(fs_path)))
+    return SVN_NO_ERROR;
+
+  SVN_ERR(get_indexed_revision(&indexed_rev, index));
+  if (end > indexed_rev)
+    return SVN_NO_ERROR;
+
+  /* Copies, additions, deletions and replacements of FS_PATH or of any
+     of its parents make the node history differ from the plain list of
+     changes at that path. */
+  SVN_ERR(svn_sqlite__get_statement(&stmt, index->sdb,
+                                    STMT_HAS_NODE_EVENT));
+  for (path = fs_path;
+       !svn_fspath__is_root(path, strlen(path));
+       path = svn_fspath__dirname(path, scratch_pool))
+    {
+      SVN_ERR(svn_sqlite__bindf(stmt, "srr", path, start, end));
+      SVN_ERR(svn_sqlite__step(&have_row, stmt));
+      SVN_ERR(svn_sqlite__reset(stmt));
+
+      if (have_row)
+        return SVN_NO_ERROR;
+    }
+
+  *revisions = apr_array_make(result_pool, 16, sizeof(svn_revnum_t));
+
+  SVN_ERR(svn_sqlite__get_statement(&stmt, index->sdb,
+                                    STMT_SELECT_PATH_REVISIONS));
+  SVN_ERR(svn_sqlite__bindf(stmt, "srr", fs_path, start, end));
+  SVN_ERR(svn_sqlite__step(&have_row, stmt));
+  while (have_row)
+    {
+      APR_ARRAY_PUSH(*revisions, svn_revnum_t)
+        = svn_sqlite__column_revnum(stmt, 0);
+      SVN_ERR(svn_sqlite__step(&have_row, stmt));
+    }
+
+  return svn_error_trace(svn_sqlite__reset(stmt));
+}
+
+
+/** Private API's. **/
+
+svn_error_t *
+svn_repos__log_index_build(svn_revnum_t *indexed_rev,
+                           svn_repos_t *repos,
+                           svn_cancel_func_t cancel_func,
+                           void *cancel_baton,
+                           apr_pool_t *scratch_pool)
+{
+  const char *db_path = path_log_index_db(repos, scratch_pool);
+  svn_repos__log_index_t *index;
+  svn_error_t *err;
+
+  err = svn_io_file_create_empty(db_path, scratch_pool);
+  if (err && APR_STATUS_IS_EEXIST(err->apr_err))
+    {
+      /* Just bring the existing index up to date. */
+      svn_error_clear(err);
+    }
+  else
+    {
+      SVN_ERR(err);
+#ifndef WIN32
+      /* We want to extend the permissions that apply to the repository
+         as a whole when creating a new index and not simply default
+         to umask.  Every filesystem back-end has an "fs-type" file. */
+      SVN_ERR(svn_io_copy_perms(svn_dirent_join(repos->db_path, "fs-type",
+                                                scratch_pool),
+                                db_path, scratch_pool));
+#endif
+    }
+
+  SVN_ERR(svn_repos__log_index_open(&index, repos, FALSE, scratch_pool,
+                                    scratch_pool));
+  SVN_ERR_ASSERT(index != NULL);
+
+  SVN_ERR(svn_repos__log_index_update(indexed_rev, index, repos->fs,
+                                      cancel_func, cancel_baton,
+                                      scratch_pool));
+
+  return svn_error_trace(svn_sqlite__close(index->sdb));
+}
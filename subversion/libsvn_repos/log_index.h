@@ -0,0 +1,99 @@
+/* log_index.h : the optional log index, private to libsvn_repos
+ *
+ * ====================================================================
+ *    Licensed to the Apache Software Foundation (ASF) under one
+ *    or more contributor license agreements.  See the NOTICE file
+ *    distributed with this work for additional information
+ *    regarding copyright ownership.  The ASF licenses this file
+ *    to you under the Apache License, Version 2.0 (the
+ *    "License"); you may not use this file except in compliance
+ *    with the License.  You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *    Unless required by applicable law or agreed to in writing,
+ *    software distributed under the License is distributed on an
+ *    "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+ *    KIND, either express or implied.  See the License for the
+ *    specific language governing permissions and limitations
+ *    under the License.
+ * ====================================================================
+ */
+
+#ifndef SVN_REPOS_LOG_INDEX_H
+#define SVN_REPOS_LOG_INDEX_H
+
+#include <apr_pools.h>
+#include <apr_tables.h>
+
+#include "svn_error.h"
+#include "svn_fs.h"
+#include "svn_repos.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif /* __cplusplus */
+
+
+/* The log index is an SQLite database in the repository's "db" directory
+ * that lists, for every path, the revisions in which that path or any
+ * path below it got changed.  It exists only if the administrator created
+ * it with "svnadmin build-log-index" and is kept up to date by
+ * svn_repos_fs_commit_txn().  svn_repos_get_logs5() uses it instead of
+ * walking the node history wherever the result is known to be the same.
+ */
+#define SVN_REPOS__LOG_INDEX_DB "log-index.db"
+
+/* An open log index. */
+typedef struct svn_repos__log_index_t svn_repos__log_index_t;
+
+/* Open the log index of REPOS and return it in *INDEX.  Set *INDEX to
+ * NULL if REPOS does not have a log index.  Open it for reading only if
+ * READ_ONLY is set.  The database will be closed when RESULT_POOL gets
+ * cleaned up.  Use SCRATCH_POOL for temporary allocations.
+ */
+svn_error_t *
+svn_repos__log_index_open(svn_repos__log_index_t **index,
+                          svn_repos_t *repos,
+                          svn_boolean_t read_only,
+                          apr_pool_t *result_pool,
+                          apr_pool_t *scratch_pool);
+
+/* Add all revisions of FS that are younger than the youngest revision
+ * covered by INDEX to INDEX.  INDEX must have been opened for writing.
+ * Set *INDEXED_REV to the youngest revision covered afterwards; may be
+ * NULL.  Call CANCEL_FUNC with CANCEL_BATON between revisions.  Use
+ * SCRATCH_POOL for temporary allocations.
+ */
+svn_error_t *
+svn_repos__log_index_update(svn_revnum_t *indexed_rev,
+                            svn_repos__log_index_t *index,
+                            svn_fs_t *fs,
+                            svn_cancel_func_t cancel_func,
+                            void *cancel_baton,
+                            apr_pool_t *scratch_pool);
+
+/* Set *REVISIONS to the revisions (svn_revnum_t) within START to END,
+ * in descending order, that changed FS_PATH or anything below it,
+ * according to INDEX.  This is the sequence of revisions that the node
+ * history of FS_PATH@END would return for that range, but only if the
+ * node did not get copied, deleted or replaced in that range, neither
+ * directly nor through any of its parents.  If this condition is
+ * violated, if INDEX does not cover END or if FS_PATH is the root, set
+ * *REVISIONS to NULL.  Allocate the result in RESULT_POOL and use
+ * SCRATCH_POOL for temporary allocations.
+ */
+svn_error_t *
+svn_repos__log_index_get_revisions(apr_array_header_t **revisions,
+                                   svn_repos__log_index_t *index,
+                                   const char *fs_path,
+                                   svn_revnum_t start,
+                                   svn_revnum_t end,
+                                   apr_pool_t *result_pool,
+                                   apr_pool_t *scratch_pool);
+
+#ifdef __cplusplus
+}
+#endif /* __cplusplus */
+
+#endif /* SVN_REPOS_LOG_INDEX_H */
@@ -40,6 +40,7 @@
 #include "private/svn_repos_private.h"
 #include "private/svn_delta_private.h"
 #include "private/svn_sorts_private.h"
+#include "repos.h"
 
 
 /*** Backstory ***/
@@ -861,56 +862,78 @@ get_relevant_changes(apr_hash_t **changed_paths,
 {
   svn_fs_path_change_iterator_t *iterator;
   svn_fs_path_change3_t *change;
-  apr_pool_t *iterpool = svn_pool_create(scratch_pool);
+  apr_array_header_t *relevant_changes;
+  apr_array_header_t *relevant_paths;
+  svn_boolean_t *allowed;
+  int i;
 
   /* Fetch the paths changed under ROOT. */
   SVN_ERR(svn_fs_paths_changed3(&iterator, root, scratch_pool, scratch_pool));
   SVN_ERR(svn_fs_path_change_get(&change, iterator));
 
+  /* Collect the changes that intersect with BASE_RELPATH, such that we
+     can check their readability in one go. */
+  relevant_changes = apr_array_make(scratch_pool, 16,
+                                    sizeof(svn_fs_path_change3_t *));
+  relevant_paths = apr_array_make(scratch_pool, 16, sizeof(const char *));
+  while (change)
+    {
+      const char *path = change->path.data;
+      if (path[0] == '/')
+        path++;
+
+      /* If the base_path doesn't match the top directory of this path
+         we don't want anything to do with it...
+         ...unless this was a change to one of the parent directories of
+         base_path. */
+      if (   svn_relpath_skip_ancestor(base_relpath, path)
+          || svn_relpath_skip_ancestor(path, base_relpath))
+        {
+          change = svn_fs_path_change3_dup(change, scratch_pool);
+          APR_ARRAY_PUSH(relevant_changes, svn_fs_path_change3_t *) = change;
+          APR_ARRAY_PUSH(relevant_paths, const char *) = change->path.data;
+        }
+
+      SVN_ERR(svn_fs_path_change_get(&change, iterator));
+    }
+
+  allowed = apr_palloc(scratch_pool,
+                       relevant_paths->nelts * sizeof(*allowed));
+  if (authz_read_func)
+    SVN_ERR(svn_repos__authz_read_paths(allowed, root, relevant_paths,
+                                        authz_read_func, authz_read_baton,
+                                        scratch_pool));
+  else
+    for (i = 0; i < relevant_paths->nelts; ++i)
+      allowed[i] = TRUE;
+
   /* Make an array from the keys of our CHANGED_PATHS hash, and copy
      the values into a new hash whose keys have no leading slashes. */
   *paths = apr_array_make(result_pool, 16, sizeof(const char *));
   *changed_paths = apr_hash_make(result_pool);
-  while (change)
+  for (i = 0; i < relevant_changes->nelts; ++i)
     {
-      const char *path = change->path.data;
-      apr_ssize_t keylen = change->path.len;
-      svn_boolean_t allowed = TRUE;
+      const char *path;
+      apr_ssize_t keylen;
 
-      svn_pool_clear(iterpool);
-      if (authz_read_func)
-        SVN_ERR(authz_read_func(&allowed, root, path, authz_read_baton,
-                                iterpool));
+      if (! allowed[i])
+        continue;
 
-      if (allowed)
+      change = svn_fs_path_change3_dup(
+                 APR_ARRAY_IDX(relevant_changes, i, svn_fs_path_change3_t *),
+                 result_pool);
+      path = change->path.data;
+      keylen = change->path.len;
+      if (path[0] == '/')
         {
-          if (path[0] == '/')
-            {
-              path++;
-              keylen--;
-            }
-
-          /* If the base_path doesn't match the top directory of this path
-             we don't want anything to do with it...
-             ...unless this was a change to one of the parent directories of
-             base_path. */
-          if (   svn_relpath_skip_ancestor(base_relpath, path)
-              || svn_relpath_skip_ancestor(path, base_relpath))
-            {
-              change = svn_fs_path_change3_dup(change, result_pool);
-              path = change->path.data;
-              if (path[0] == '/')
-                path++;
-
-              APR_ARRAY_PUSH(*paths, const char *) = path;
-              apr_hash_set(*changed_paths, path, keylen, change);
-            }
+          path++;
+          keylen--;
         }
 
-      SVN_ERR(svn_fs_path_change_get(&change, iterator));
+      APR_ARRAY_PUSH(*paths, const char *) = path;
+      apr_hash_set(*changed_paths, path, keylen, change);
     }
 
-  svn_pool_destroy(iterpool);
   return SVN_NO_ERROR;
 }
 
@@ -387,6 +387,19 @@ svn_repos__prev_location(svn_revnum_t *appeared_rev,
                          const char *path,
                          apr_pool_t *pool);
 
+/* Set READABLE[i] to TRUE if the i-th fspath (const char *) in PATHS is
+   readable in ROOT according to AUTHZ_READ_FUNC with AUTHZ_READ_BATON,
+   and to FALSE otherwise.  READABLE must provide space for PATHS->NELTS
+   elements.  If AUTHZ_READ_FUNC is svn_repos__authz_read_func(), check
+   all PATHS in one go.  Use SCRATCH_POOL for temporary allocations.  */
+svn_error_t *
+svn_repos__authz_read_paths(svn_boolean_t *readable,
+                            svn_fs_root_t *root,
+                            const apr_array_header_t *paths,
+                            svn_repos_authz_func_t authz_read_func,
+                            void *authz_read_baton,
+                            apr_pool_t *scratch_pool);
+
 #ifdef __cplusplus
 }
 #endif /* __cplusplus */
@@ -0,0 +1,746 @@
+/*
+ * cache-compressed.c: size-bounded cache of LZ4-compressed objects
+ *
+ * ====================================================================
+ *    Licensed to the Apache Software Foundation (ASF) under one
+ *    or more contributor license agreements.  See the NOTICE file
+ *    distributed with this work for additional information
+ *    regarding copyright ownership.  The ASF licenses this file
+ *    to you under the Apache License, Version 2.0 (the
+ *    "License"); you may not use this file except in compliance
+ *    with the License.  You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *    Unless required by applicable law or agreed to in writing,
+ *    software distributed under the License is distributed on an
+ *    "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+ *    KIND, either express or implied.  See the License for the
+ *    specific language governing permissions and limitations
+ *    under the License.
+ * ====================================================================
+ */
+
+#include <assert.h>
+#include <stdlib.h>
+
+#include "svn_pools.h"
+
+#include "svn_private_config.h"
+
+#include "cache.h"
+#include "private/svn_mutex.h"
+#include "private/svn_subr_private.h"
+
+/* This cache is meant for few, large objects that are expensive to
+ * re-create, e.g. FSFS fulltexts with long delta chains.  It stores them
+ * LZ4-compressed in a hash plus an LRU list.  Unlike a plain LRU cache,
+ * however, the store will not evict entries in favour of new ones that
+ * have been requested less often than the ones they would replace
+ * (TinyLFU admission, see Einziger et al., "TinyLFU: A Highly Efficient
+ * Cache Admission Policy").  That keeps large one-off reads from flushing
+ * the cache.
+ *
+ * The access frequencies are approximated by a count-min sketch with
+ * 4 bit saturating counters.  To give more weight to recent accesses,
+ * all counters get halved periodically.
+ *
+ * The store itself is independent from the cache objects accessing it,
+ * i.e. several svn_cache__t may share the same store.  Each of them
+ * prefixes its keys with a cache-specific string.
+ */
+
+/* Number of rows in the frequency sketch.  Each row uses a different
+ * hash function and the frequency estimate is the minimum of all rows.
+ */
+#define SKETCH_DEPTH 4
+
+/* Counters in the frequency sketch saturate at this value. */
+#define SKETCH_MAX_COUNT 15
+
+/* After this many increments per column, all sketch counters get halved.
+ */
+#define SKETCH_SAMPLE_FACTOR 10
+
+/* Minimum and maximum number of counters per sketch row. */
+#define SKETCH_MIN_WIDTH 0x400
+#define SKETCH_MAX_WIDTH 0x100000
+
+/* We assume that a typical entry is at least this large.  Together with
+ * the store size, this determines the width of the sketch.
+ */
+#define SKETCH_BYTES_PER_COLUMN 0x400
+
+/* No single entry may use more than this fraction of the store. */
+#define MAX_ENTRY_FRACTION 8
+
+/* Upper limit of uncompressed data that we can pass to LZ4 in one go.
+ * Same as LZ4_MAX_INPUT_SIZE. */
+#define MAX_LZ4_INPUT_SIZE 0x7E000000
+
+/* A single cache entry.  KEY and DATA are allocated in the same block of
+ * memory as the entry struct itself. */
+typedef struct entry_t
+{
+  /* The full key (including the cache prefix) and its length. */
+  const char *key;
+  apr_size_t klen;
+
+  /* The LZ4-compressed serialized object and its length. */
+  const char *data;
+  apr_size_t size;
+
+  /* Length of the serialized object before compression. */
+  apr_size_t original_size;
+
+  /* Neighbours in the store's LRU list. */
+  struct entry_t *previous;
+  struct entry_t *next;
+} entry_t;
+
+/* The (internal) store object. */
+struct svn_cache__compressed_store_t
+{
+  /* Maps full keys to entry_t *. */
+  apr_hash_t *hash;
+
+  /* Most and least recently used entry or NULL if the store is empty. */
+  entry_t *first;
+  entry_t *last;
+
+  /* Total memory in bytes we may use for entries and the memory
+   * currently used. */
+  apr_size_t total_size;
+  apr_size_t used_size;
+
+  /* Number of sets that we did not admit into the store. */
+  apr_uint64_t rejections;
+
+  /* SKETCH_DEPTH rows of SKETCH_WIDTH frequency counters each.
+   * SKETCH_WIDTH is a power of two. */
+  unsigned char *sketch;
+  apr_size_t sketch_width;
+
+  /* Number of counter increments since the last aging of the sketch and
+   * the number of increments that triggers the next aging. */
+  apr_size_t sketch_additions;
+  apr_size_t sketch_sample_size;
+
+  /* Protects all of the above. */
+  svn_mutex__t *mutex;
+};
+
+/* The (internal) cache object. */
+typedef struct compressed_cache_t
+{
+  /* Where the data actually lives. */
+  svn_cache__compressed_store_t *store;
+
+  /* Prepended to all keys in this cache. */
+  const char *prefix;
+  apr_size_t prefix_len;
+
+  /* Length of the keys passed in by the user or APR_HASH_KEY_STRING. */
+  apr_ssize_t klen;
+
+  /* Used to copy values into the cache. */
+  svn_cache__serialize_func_t serialize_func;
+
+  /* Used to copy values out of the cache. */
+  svn_cache__deserialize_func_t deserialize_func;
+} compressed_cache_t;
+
+/* Return the number of bytes that an entry with a key of length KLEN and
+ * a compressed data length of SIZE will take up in the store. */
+static apr_size_t
+entry_cost(apr_size_t klen,
+           apr_size_t size)
+{
+  return sizeof(entry_t) + klen + size;
+}
+
+/* Return the counter in ROW of the sketch in STORE for a key with the
+ * given HASH value. */
+static unsigned char *
+sketch_counter(svn_cache__compressed_store_t *store,
+               apr_uint32_t hash,
+               int row)
+{
+  /* Double hashing.  Make the step odd, so it is co-prime to the
+   * power-of-two width. */
+  apr_uint32_t step = ((hash >> 16) | (hash << 16)) | 1;
+  apr_size_t column = (hash + row * step) & (store->sketch_width - 1);
+
+  return store->sketch + row * store->sketch_width + column;
+}
+
+/* Return the estimated access frequency of the key with HASH in STORE. */
+static int
+sketch_estimate(svn_cache__compressed_store_t *store,
+                apr_uint32_t hash)
+{
+  int result = SKETCH_MAX_COUNT;
+  int row;
+
+  for (row = 0; row < SKETCH_DEPTH; ++row)
+    {
+      unsigned char count = *sketch_counter(store, hash, row);
+      if (count < result)
+        result = count;
+    }
+
+  return result;
+}
+
+/* Record another access to the key with HASH in STORE.  Age all counters
+ * when enough accesses have been recorded since the last time. */
+static void
+sketch_increment(svn_cache__compressed_store_t *store,
+                 apr_uint32_t hash)
+{
+  int row;
+  for (row = 0; row < SKETCH_DEPTH; ++row)
+    {
+      unsigned char *counter = sketch_counter(store, hash, row);
+      if (*counter < SKETCH_MAX_COUNT)
+        ++*counter;
+    }
+
+  if (++store->sketch_additions >= store->sketch_sample_size)
+    {
+      apr_size_t i;
+      for (i = 0; i < SKETCH_DEPTH * store->sketch_width; ++i)
+        store->sketch[i] >>= 1;
+
+      store->sketch_additions /= 2;
+    }
+}
+
+/* Remove ENTRY from the LRU list in STORE. */
+static void
+unchain_entry(svn_cache__compressed_store_t *store,
+              entry_t *entry)
+{
+  if (entry->previous)
+    entry->previous->next = entry->next;
+  else
+    store->first = entry->next;
+
+  if (entry->next)
+    entry->next->previous = entry->previous;
+  else
+    store->last = entry->previous;
+
+  entry->previous = NULL;
+  entry->next = NULL;
+}
+
+/* Insert ENTRY at the head of the LRU list in STORE. */
+static void
+chain_entry(svn_cache__compressed_store_t *store,
+            entry_t *entry)
+{
+  entry->previous = NULL;
+  entry->next = store->first;
+
+  if (store->first)
+    store->first->previous = entry;
+  else
+    store->last = entry;
+
+  store->first = entry;
+}
+
+/* Remove ENTRY from STORE and release its memory. */
+static void
+drop_entry(svn_cache__compressed_store_t *store,
+           entry_t *entry)
+{
+  unchain_entry(store, entry);
+  apr_hash_set(store->hash, entry->key, entry->klen, NULL);
+
+  store->used_size -= entry_cost(entry->klen, entry->size);
+
+  free(entry);
+}
+
+/* Pool cleanup function releasing all entries in the store BATON. */
+static apr_status_t
+release_entries(void *baton)
+{
+  svn_cache__compressed_store_t *store = baton;
+  entry_t *entry = store->first;
+
+  while (entry)
+    {
+      entry_t *next = entry->next;
+      free(entry);
+      entry = next;
+    }
+
+  store->first = NULL;
+  store->last = NULL;
+
+  return APR_SUCCESS;
+}
+
+/* Return the full KEY of the element addressed by the user-provided
+ * key USER_KEY in CACHE.  Set *KLEN to its length.  Allocate the result
+ * in RESULT_POOL. */
+static const char *
+full_key(apr_size_t *klen,
+         compressed_cache_t *cache,
+         const void *user_key,
+         apr_pool_t *result_pool)
+{
+  apr_size_t user_klen = cache->klen == APR_HASH_KEY_STRING
+                       ? strlen(user_key)
+                       : (apr_size_t)cache->klen;
+  char *key = apr_palloc(result_pool, cache->prefix_len + user_klen);
+
+  memcpy(key, cache->prefix, cache->prefix_len);
+  memcpy(key + cache->prefix_len, user_key, user_klen);
+  *klen = cache->prefix_len + user_klen;
+
+  return key;
+}
+
+/* Look up KEY of length KLEN in STORE and record the access.  If found,
+ * return a copy of the compressed data in *DATA, its length in *SIZE and
+ * the uncompressed length in *ORIGINAL_SIZE.  Otherwise, set *DATA to
+ * NULL.  Allocate the copy in RESULT_POOL. */
+static svn_error_t *
+store_get_internal(char **data,
+                   apr_size_t *size,
+                   apr_size_t *original_size,
+                   svn_cache__compressed_store_t *store,
+                   const char *key,
+                   apr_size_t klen,
+                   apr_pool_t *result_pool)
+{
+  entry_t *entry = apr_hash_get(store->hash, key, klen);
+
+  sketch_increment(store, svn__fnv1a_32(key, klen));
+
+  if (entry)
+    {
+      unchain_entry(store, entry);
+      chain_entry(store, entry);
+
+      *data = apr_pmemdup(result_pool, entry->data, entry->size);
+      *size = entry->size;
+      *original_size = entry->original_size;
+    }
+  else
+    {
+      *data = NULL;
+    }
+
+  return SVN_NO_ERROR;
+}
+
+/* Store a copy of the compressed DATA of length SIZE, with the
+ * uncompressed length ORIGINAL_SIZE, under KEY of length KLEN in STORE.
+ * Replace any previous entry with the same key.  If the store is full
+ * and the least recently used entries have been accessed at least as
+ * frequently as KEY, reject the new data. */
+static svn_error_t *
+store_set_internal(svn_cache__compressed_store_t *store,
+                   const char *key,
+                   apr_size_t klen,
+                   const char *data,
+                   apr_size_t size,
+                   apr_size_t original_size)
+{
+  apr_size_t cost = entry_cost(klen, size);
+  entry_t *entry = apr_hash_get(store->hash, key, klen);
+  char *buffer;
+
+  /* Replacing existing contents does not need to pass admission. */
+  if (entry)
+    drop_entry(store, entry);
+
+  /* Tiny stores may not even fit a single small entry. */
+  if (cost > store->total_size)
+    return SVN_NO_ERROR;
+
+  if (store->used_size + cost > store->total_size)
+    {
+      /* Find the victims and compare their frequencies with ours. */
+      int frequency = sketch_estimate(store, svn__fnv1a_32(key, klen));
+      apr_size_t freed = 0;
+
+      for (entry = store->last;
+           store->used_size - freed + cost > store->total_size;
+           entry = entry->previous)
+        {
+          if (sketch_estimate(store, svn__fnv1a_32(entry->key, entry->klen))
+              >= frequency)
+            {
+              ++store->rejections;
+              return SVN_NO_ERROR;
+            }
+
+          freed += entry_cost(entry->klen, entry->size);
+        }
+
+      /* Admitted.  Make room. */
+      while (store->used_size + cost > store->total_size)
+        drop_entry(store, store->last);
+    }
+
+  buffer = malloc(cost);
+  if (buffer == NULL)
+    return SVN_NO_ERROR;
+
+  entry = (entry_t *)buffer;
+  memcpy(buffer + sizeof(*entry), key, klen);
+  memcpy(buffer + sizeof(*entry) + klen, data, size);
+
+  entry->key = buffer + sizeof(*entry);
+  entry->klen = klen;
+  entry->data = buffer + sizeof(*entry) + klen;
+  entry->size = size;
+  entry->original_size = original_size;
+
+  apr_hash_set(store->hash, entry->key, entry->klen, entry);
+  chain_entry(store, entry);
+
+  store->used_size += cost;
+
+  return SVN_NO_ERROR;
+}
+
+/* Return TRUE if serialized objects of SIZE bytes may be stored in
+ * STORE. */
+static svn_boolean_t
+store_is_cachable(svn_cache__compressed_store_t *store,
+                  apr_size_t size)
+{
+  return size <= MAX_LZ4_INPUT_SIZE
+      && size <= store->total_size / MAX_ENTRY_FRACTION;
+}
+
+/* Get the serialized object for USER_KEY from CACHE and return it in
+ * *SERIALIZED, or NULL if not found.  Allocate the result in
+ * RESULT_POOL. */
+static svn_error_t *
+compressed_cache_get_serialized(svn_stringbuf_t **serialized,
+                                compressed_cache_t *cache,
+                                const void *user_key,
+                                apr_pool_t *result_pool)
+{
+  apr_size_t klen;
+  const char *key = full_key(&klen, cache, user_key, result_pool);
+  char *data;
+  apr_size_t size;
+  apr_size_t original_size;
+
+  SVN_MUTEX__WITH_LOCK(cache->store->mutex,
+                       store_get_internal(&data, &size, &original_size,
+                                          cache->store, key, klen,
+                                          result_pool));
+
+  if (data)
+    {
+      *serialized = svn_stringbuf_create_empty(result_pool);
+      SVN_ERR(svn__decompress_lz4(data, size, *serialized, original_size));
+    }
+  else
+    {
+      *serialized = NULL;
+    }
+
+  return SVN_NO_ERROR;
+}
+
+/* Compress SERIALIZED and store it under USER_KEY in CACHE.
+ * Use SCRATCH_POOL for temporary allocations. */
+static svn_error_t *
+compressed_cache_set_serialized(compressed_cache_t *cache,
+                                const void *user_key,
+                                const char *serialized,
+                                apr_size_t len,
+                                apr_pool_t *scratch_pool)
+{
+  apr_size_t klen;
+  const char *key;
+  svn_stringbuf_t *compressed;
+
+  if (!store_is_cachable(cache->store, len))
+    return SVN_NO_ERROR;
+
+  key = full_key(&klen, cache, user_key, scratch_pool);
+  compressed = svn_stringbuf_create_empty(scratch_pool);
+  SVN_ERR(svn__compress_lz4(serialized, len, compressed));
+
+  SVN_MUTEX__WITH_LOCK(cache->store->mutex,
+                       store_set_internal(cache->store, key, klen,
+                                          compressed->data, compressed->len,
+                                          len));
+
+  return SVN_NO_ERROR;
+}
+
+static svn_error_t *
+compressed_cache_get(void **value_p,
+                     svn_boolean_t *found,
+                     void *cache_void,
+                     const void *key,
+                     apr_pool_t *result_pool)
+{
+  compressed_cache_t *cache = cache_void;
+  svn_stringbuf_t *serialized;
+
+  SVN_ERR(compressed_cache_get_serialized(&serialized, cache, key,
+                                          result_pool));
+
+  *found = serialized != NULL;
+  if (!serialized)
+    *value_p = NULL;
+  else if (cache->deserialize_func)
+    return cache->deserialize_func(value_p, serialized->data,
+                                   serialized->len, result_pool);
+  else
+    *value_p = serialized;
+
+  return SVN_NO_ERROR;
+}
+
+static svn_error_t *
+compressed_cache_has_key_internal(svn_boolean_t *found,
+                                  svn_cache__compressed_store_t *store,
+                                  const char *key,
+                                  apr_size_t klen)
+{
+  *found = apr_hash_get(store->hash, key, klen) != NULL;
+
+  return SVN_NO_ERROR;
+}
+
+static svn_error_t *
+compressed_cache_has_key(svn_boolean_t *found,
+                         void *cache_void,
+                         const void *user_key,
+                         apr_pool_t *scratch_pool)
+{
+  compressed_cache_t *cache = cache_void;
+  apr_size_t klen;
+  const char *key = full_key(&klen, cache, user_key, scratch_pool);
+
+  SVN_MUTEX__WITH_LOCK(cache->store->mutex,
+                       compressed_cache_has_key_internal(found,
+                                                         cache->store,
+                                                         key, klen));
+
+  return SVN_NO_ERROR;
+}
+
+static svn_error_t *
+compressed_cache_set(void *cache_void,
+                     const void *key,
+                     void *value,
+                     apr_pool_t *scratch_pool)
+{
+  compressed_cache_t *cache = cache_void;
+  void *data;
+  apr_size_t len;
+
+  /* Like all other cache implementations, we don't store NULL values. */
+  if (value == NULL)
+    return SVN_NO_ERROR;
+
+  if (cache->serialize_func)
+    {
+      SVN_ERR(cache->serialize_func(&data, &len, value, scratch_pool));
+    }
+  else
+    {
+      svn_stringbuf_t *value_str = value;
+      data = value_str->data;
+      len = value_str->len;
+    }
+
+  return svn_error_trace(compressed_cache_set_serialized(cache, key, data,
+                                                         len,
+                                                         scratch_pool));
+}
+
+static svn_error_t *
+compressed_cache_iter(svn_boolean_t *completed,
+                      void *cache_void,
+                      svn_iter_apr_hash_cb_t user_cb,
+                      void *user_baton,
+                      apr_pool_t *scratch_pool)
+{
+  return svn_error_create(SVN_ERR_UNSUPPORTED_FEATURE, NULL,
+                          _("Can't iterate a compressed cache"));
+}
+
+static svn_boolean_t
+compressed_cache_is_cachable(void *cache_void, apr_size_t size)
+{
+  compressed_cache_t *cache = cache_void;
+  return store_is_cachable(cache->store, size);
+}
+
+static svn_error_t *
+compressed_cache_get_partial(void **value_p,
+                             svn_boolean_t *found,
+                             void *cache_void,
+                             const void *key,
+                             svn_cache__partial_getter_func_t func,
+                             void *baton,
+                             apr_pool_t *result_pool)
+{
+  compressed_cache_t *cache = cache_void;
+  svn_stringbuf_t *serialized;
+
+  SVN_ERR(compressed_cache_get_serialized(&serialized, cache, key,
+                                          result_pool));
+
+  *found = serialized != NULL;
+  if (!serialized)
+    *value_p = NULL;
+  else
+    return func(value_p, serialized->data, serialized->len, baton,
+                result_pool);
+
+  return SVN_NO_ERROR;
+}
+
+static svn_error_t *
+compressed_cache_set_partial(void *cache_void,
+                             const void *key,
+                             svn_cache__partial_setter_func_t func,
+                             void *baton,
+                             apr_pool_t *scratch_pool)
+{
+  compressed_cache_t *cache = cache_void;
+  svn_stringbuf_t *serialized;
+
+  SVN_ERR(compressed_cache_get_serialized(&serialized, cache, key,
+                                          scratch_pool));
+
+  if (serialized)
+    {
+      void *data = serialized->data;
+      apr_size_t len = serialized->len;
+
+      SVN_ERR(func(&data, &len, baton, scratch_pool));
+      SVN_ERR(compressed_cache_set_serialized(cache, key, data, len,
+                                              scratch_pool));
+    }
+
+  return SVN_NO_ERROR;
+}
+
+static svn_error_t *
+compressed_cache_get_info_internal(svn_cache__compressed_store_t *store,
+                                   svn_cache__info_t *info,
+                                   svn_boolean_t reset)
+{
+  info->used_entries = apr_hash_count(store->hash);
+  info->total_entries = 0;
+
+  info->used_size = store->used_size;
+  info->data_size = store->total_size;
+  info->total_size = store->total_size
+                   + SKETCH_DEPTH * store->sketch_width
+                   + sizeof(*store);
+
+  info->rejections = store->rejections;
+  if (reset)
+    store->rejections = 0;
+
+  return SVN_NO_ERROR;
+}
+
+static svn_error_t *
+compressed_cache_get_info(void *cache_void,
+                          svn_cache__info_t *info,
+                          svn_boolean_t reset,
+                          apr_pool_t *result_pool)
+{
+  compressed_cache_t *cache = cache_void;
+
+  info->id = apr_pstrdup(result_pool, cache->prefix);
+
+  SVN_MUTEX__WITH_LOCK(cache->store->mutex,
+                       compressed_cache_get_info_internal(cache->store,
+                                                          info, reset));
+
+  return SVN_NO_ERROR;
+}
+
+static svn_cache__vtable_t compressed_cache_vtable = {
+  compressed_cache_get,
+  compressed_cache_has_key,
+  compressed_cache_set,
+  compressed_cache_iter,
+  compressed_cache_is_cachable,
+  compressed_cache_get_partial,
+  compressed_cache_set_partial,
+  compressed_cache_get_info
+};
+
+svn_error_t *
+svn_cache__compressed_store_create(svn_cache__compressed_store_t **store_p,
+                                   apr_size_t total_size,
+                                   svn_boolean_t thread_safe,
+                                   apr_pool_t *result_pool)
+{
+  svn_cache__compressed_store_t *store
+    = apr_pcalloc(result_pool, sizeof(*store));
+
+  store->hash = apr_hash_make(result_pool);
+  store->total_size = total_size;
+
+  /* Size the sketch according to the number of entries that we expect
+   * to hold.  The width must be a power of two. */
+  store->sketch_width = SKETCH_MIN_WIDTH;
+  while (   store->sketch_width < SKETCH_MAX_WIDTH
+         && store->sketch_width * SKETCH_BYTES_PER_COLUMN < total_size)
+    store->sketch_width *= 2;
+
+  store->sketch = apr_pcalloc(result_pool,
+                              SKETCH_DEPTH * store->sketch_width);
+  store->sketch_sample_size = SKETCH_SAMPLE_FACTOR * store->sketch_width;
+
+  SVN_ERR(svn_mutex__init(&store->mutex, thread_safe, result_pool));
+
+  apr_pool_cleanup_register(result_pool, store, release_entries,
+                            apr_pool_cleanup_null);
+
+  *store_p = store;
+  return SVN_NO_ERROR;
+}
+
+svn_error_t *
+svn_cache__create_compressed(svn_cache__t **cache_p,
+                             svn_cache__compressed_store_t *store,
+                             svn_cache__serialize_func_t serialize,
+                             svn_cache__deserialize_func_t deserialize,
+                             apr_ssize_t klen,
+                             const char *prefix,
+                             apr_pool_t *result_pool)
+{
+  svn_cache__t *wrapper = apr_pcalloc(result_pool, sizeof(*wrapper));
+  compressed_cache_t *cache = apr_pcalloc(result_pool, sizeof(*cache));
+
+  SVN_ERR_ASSERT(klen == APR_HASH_KEY_STRING || klen >= 1);
+
+  cache->store = store;
+  cache->prefix = apr_pstrdup(result_pool, prefix);
+  cache->prefix_len = strlen(prefix);
+  cache->klen = klen;
+  cache->serialize_func = serialize;
+  cache->deserialize_func = deserialize;
+
+  wrapper->vtable = &compressed_cache_vtable;
+  wrapper->cache_internal = cache;
+  wrapper->pretend_empty = !!getenv("SVN_X_DOES_NOT_MARK_THE_SPOT");
+
+  *cache_p = wrapper;
+  return SVN_NO_ERROR;
+}
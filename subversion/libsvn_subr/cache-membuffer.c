@@ -24,6 +24,8 @@
 #include <assert.h>
 #include <apr_md5.h>
 #include <apr_thread_rwlock.h>
+#include <apr_global_mutex.h>
+#include <apr_shm.h>
 
 #include "svn_pools.h"
 #include "svn_checksum.h"
@@ -63,8 +65,11 @@
  * Only the start address of these two data parts are given as a native
  * pointer. All other references are expressed as offsets to these pointers.
  * With that design, it is relatively easy to share the same data structure
- * between different processes and / or to persist them on disk. These
- * out-of-process features have not been implemented, yet.
+ * between different processes and / or to persist them on disk.  A cache
+ * may be created in shared memory such that all processes forked from the
+ * creating process use the same cache.  Since these processes inherit the
+ * mapping, native pointers remain valid.  Persistence has not been
+ * implemented, yet.
  *
  * Superficially, cache levels are being used as usual: insertion happens
  * into L1 and evictions will promote items to L2.  But their whole point
@@ -125,10 +130,20 @@
  * is then unique, too, and can never conflict.  No full key construction,
  * storage and comparison is needed in that case.
  *
- * All access to the cached data needs to be serialized. Because we want
- * to scale well despite that bottleneck, we simply segment the cache into
- * a number of independent caches (segments). Items will be multiplexed based
- * on their hash key.
+ * All modifications to the cached data need to be serialized. Because we
+ * want to scale well despite that bottleneck, we simply segment the cache
+ * into a number of independent caches (segments). Items will be multiplexed
+ * based on their hash key.
+ *
+ * Readers don't need to take the segment lock, though.  Every segment
+ * has a sequence counter that writers increment when they acquire and
+ * again when they release the write lock, i.e. it is odd while the
+ * segment is being modified.  Readers first try an optimistic lookup:
+ * they copy the item without any locking and then check that the
+ * sequence counter did not change in the meantime.  Only if that check
+ * fails, they repeat the lookup under the read lock.  Hit counters are
+ * not updated directly by optimistic readers but recorded in a small
+ * per-segment buffer and applied by the next writer.
  */
 
 /* APR's read-write lock implementation on Windows is horribly inefficient.
@@ -146,6 +161,35 @@
 #  define USE_SIMPLE_MUTEX 0
 #endif
 
+/* Optimistic (lock-free) reads require a memory barrier that prevents
+ * loads from being reordered across it.  Where we don't know how to
+ * get one or where there is no concurrency, always use the read lock.
+ * The debug code needs to inspect entries under the lock as well.
+ */
+#if !APR_HAS_THREADS || defined(SVN_DEBUG_CACHE_MEMBUFFER)
+#  define USE_OPTIMISTIC_READS 0
+#elif defined(__ATOMIC_ACQUIRE)
+#  define USE_OPTIMISTIC_READS 1
+#  define READ_BARRIER() __atomic_thread_fence(__ATOMIC_ACQUIRE)
+#elif defined(_MSC_VER)
+#  define USE_OPTIMISTIC_READS 1
+#  define READ_BARRIER() MemoryBarrier()
+#else
+#  define USE_OPTIMISTIC_READS 0
+#endif
+
+/* Lock mechanism to use for caches shared between processes.  It must
+ * work with anonymous locks that get inherited by forked processes, i.e.
+ * not require a call to apr_global_mutex_child_init().
+ */
+#if APR_HAS_PROC_PTHREAD_SERIALIZE
+#  define SHARED_LOCK_MECH APR_LOCK_PROC_PTHREAD
+#elif APR_HAS_FCNTL_SERIALIZE
+#  define SHARED_LOCK_MECH APR_LOCK_FCNTL
+#else
+#  define SHARED_LOCK_MECH APR_LOCK_DEFAULT
+#endif
+
 /* For more efficient copy operations, let's align all data items properly.
  * Since we can't portably align pointers, this is rather the item size
  * granularity which ensures *relative* alignment within the cache - still
@@ -197,6 +241,18 @@
  */
 #define MAX_ITEM_SIZE ((apr_uint32_t)(0 - ITEM_ALIGNMENT))
 
+/* Number of hits that optimistic readers may record per cache segment
+ * before a writer applies them to the entries' hit counters.  Must be a
+ * power of 2.
+ */
+#define DEFERRED_HITS_SIZE 64
+
+/* Optimistic readers call partial getters on a copy of the cached item
+ * that is kept on the stack.  Larger items will always be processed
+ * under the read lock.
+ */
+#define MAX_OPTIMISTIC_PARTIAL_SIZE 0x2000
+
 /* We use this structure to identify cache entries. There cannot be two
  * entries with the same entry key. However unlikely, though, two different
  * full keys (see full_key_t) may have the same entry key.  That is a
@@ -796,6 +852,27 @@ struct svn_membuffer_t
    */
   apr_uint64_t total_hits;
 
+  /* Total number of times that a reader or writer had to wait for or
+   * had to retry because of a concurrent writer.
+   * Purely statistical information that may be used for profiling only.
+   * Updates are not synchronized and values may be nonsensicle on some
+   * platforms.
+   */
+  apr_uint64_t total_contentions;
+
+  /* Incremented by writers upon acquiring and releasing the write lock,
+   * i.e. odd while the segment gets modified.  Optimistic readers use
+   * it to detect concurrent modifications.
+   */
+  volatile svn_atomic_t write_sequence;
+
+  /* Indexes of entries that have been hit by optimistic readers.  Unused
+   * slots are NO_INDEX.  Readers only ever overwrite slots, so concurrent
+   * hits may get lost, which is fine for the purpose of the eviction
+   * heuristics.  Writers apply them to the respective HIT_COUNT.
+   */
+  apr_uint32_t deferred_hits[DEFERRED_HITS_SIZE];
+
 #if (APR_HAS_THREADS && USE_SIMPLE_MUTEX)
   /* A lock for intra-process synchronization to the cache, or NULL if
    * the cache's creator doesn't feel the cache needs to be
@@ -805,13 +882,18 @@ struct svn_membuffer_t
 #elif (APR_HAS_THREADS && !USE_SIMPLE_MUTEX)
   /* Same for read-write lock. */
   apr_thread_rwlock_t *lock;
+#endif
 
   /* If set, write access will wait until they get exclusive access.
    * Otherwise, they will become no-ops if the segment is currently
-   * read-locked.  Only used when LOCK is an r/w lock.
+   * locked.  Only used when LOCK is an r/w lock or with SHARED_LOCK.
    */
   svn_boolean_t allow_blocking_writes;
-#endif
+
+  /* A lock for inter-process synchronization of caches in shared memory.
+   * If not NULL, it will be used instead of LOCK.
+   */
+  apr_global_mutex_t *shared_lock;
 
   /* A write lock counter, must be either 0 or 1.
    * This one is only used in debug assertions to verify that you used
@@ -828,6 +910,15 @@ struct svn_membuffer_t
 static svn_error_t *
 read_lock_cache(svn_membuffer_t *cache)
 {
+  if (cache->shared_lock)
+    {
+      apr_status_t status = apr_global_mutex_lock(cache->shared_lock);
+      if (status)
+        return svn_error_wrap_apr(status, _("Can't lock cache mutex"));
+
+      return SVN_NO_ERROR;
+    }
+
 #if (APR_HAS_THREADS && USE_SIMPLE_MUTEX)
   return svn_mutex__lock(cache->lock);
 #elif (APR_HAS_THREADS && !USE_SIMPLE_MUTEX)
@@ -851,6 +942,31 @@ read_lock_cache(svn_membuffer_t *cache)
 static svn_error_t *
 write_lock_cache(svn_membuffer_t *cache, svn_boolean_t *success)
 {
+  if (cache->shared_lock)
+    {
+      apr_status_t status;
+      if (cache->allow_blocking_writes)
+        {
+          status = apr_global_mutex_lock(cache->shared_lock);
+        }
+      else
+        {
+          status = apr_global_mutex_trylock(cache->shared_lock);
+          if (SVN_LOCK_IS_BUSY(status))
+            {
+              cache->total_contentions++;
+              *success = FALSE;
+              status = APR_SUCCESS;
+            }
+        }
+
+      if (status)
+        return svn_error_wrap_apr(status,
+                                  _("Can't write-lock cache mutex"));
+
+      return SVN_NO_ERROR;
+    }
+
 #if (APR_HAS_THREADS && USE_SIMPLE_MUTEX)
   return svn_mutex__lock(cache->lock);
 #elif (APR_HAS_THREADS && !USE_SIMPLE_MUTEX)
@@ -866,6 +982,7 @@ write_lock_cache(svn_membuffer_t *cache, svn_boolean_t *success)
           status = apr_thread_rwlock_trywrlock(cache->lock);
           if (SVN_LOCK_IS_BUSY(status))
             {
+              cache->total_contentions++;
               *success = FALSE;
               status = APR_SUCCESS;
             }
@@ -888,13 +1005,25 @@ write_lock_cache(svn_membuffer_t *cache, svn_boolean_t *success)
 static svn_error_t *
 force_write_lock_cache(svn_membuffer_t *cache)
 {
+  if (cache->shared_lock)
+    {
+      apr_status_t status = apr_global_mutex_lock(cache->shared_lock);
+      if (status)
+        return svn_error_wrap_apr(status,
+                                  _("Can't write-lock cache mutex"));
+
+      return SVN_NO_ERROR;
+    }
+
 #if (APR_HAS_THREADS && USE_SIMPLE_MUTEX)
   return svn_mutex__lock(cache->lock);
 #elif (APR_HAS_THREADS && !USE_SIMPLE_MUTEX)
-  apr_status_t status = apr_thread_rwlock_wrlock(cache->lock);
-  if (status)
-    return svn_error_wrap_apr(status,
-                              _("Can't write-lock cache mutex"));
+  {
+    apr_status_t status = apr_thread_rwlock_wrlock(cache->lock);
+    if (status)
+      return svn_error_wrap_apr(status,
+                                _("Can't write-lock cache mutex"));
+  }
 
   return SVN_NO_ERROR;
 #else
@@ -908,6 +1037,18 @@ force_write_lock_cache(svn_membuffer_t *cache)
 static svn_error_t *
 unlock_cache(svn_membuffer_t *cache, svn_error_t *err)
 {
+  if (cache->shared_lock)
+    {
+      apr_status_t status = apr_global_mutex_unlock(cache->shared_lock);
+      if (err)
+        return err;
+
+      if (status)
+        return svn_error_wrap_apr(status, _("Can't unlock cache mutex"));
+
+      return SVN_NO_ERROR;
+    }
+
 #if (APR_HAS_THREADS && USE_SIMPLE_MUTEX)
   return svn_mutex__unlock(cache->lock, err);
 #elif (APR_HAS_THREADS && !USE_SIMPLE_MUTEX)
@@ -927,6 +1068,29 @@ unlock_cache(svn_membuffer_t *cache, svn_error_t *err)
 #endif
 }
 
+/* Forward declaration. */
+static void
+apply_deferred_hits(svn_membuffer_t *cache);
+
+/* Mark CACHE as being modified.  The caller must hold the write lock.
+ */
+static void
+begin_write(svn_membuffer_t *cache)
+{
+  svn_atomic_inc(&cache->write_sequence);
+  apply_deferred_hits(cache);
+}
+
+/* Mark the modification of CACHE as completed.  The caller must still
+ * hold the write lock.  Return ERR.
+ */
+static svn_error_t *
+end_write(svn_membuffer_t *cache, svn_error_t *err)
+{
+  svn_atomic_inc(&cache->write_sequence);
+  return err;
+}
+
 /* If supported, guard the execution of EXPR with a read lock to CACHE.
  * The macro has been modeled after SVN_MUTEX__WITH_LOCK.
  */
@@ -959,7 +1123,8 @@ do {                                                            \
       else                                                      \
         break;                                                  \
     }                                                           \
-  SVN_ERR(unlock_cache(cache, (expr)));                         \
+  begin_write(cache);                                           \
+  SVN_ERR(unlock_cache(cache, end_write(cache, (expr))));       \
 } while (0)
 
 /* Returns 0 if the entry group identified by GROUP_INDEX in CACHE has not
@@ -1550,6 +1715,72 @@ find_entry(svn_membuffer_t *cache,
   return entry;
 }
 
+#if USE_OPTIMISTIC_READS
+
+/* Lock-free variant of find_entry() with FIND_EMPTY being FALSE.  Look
+ * for the entry identified by TO_FIND in group GROUP_INDEX of CACHE and
+ * return TRUE if it could be found.  In that case, copy the entry to
+ * *RESULT and its index in CACHE to *IDX.
+ *
+ * Because concurrent writers may modify the directory while we read it,
+ * the caller must validate the result using CACHE->WRITE_SEQUENCE.  All
+ * references that we read get checked against the directory and data
+ * buffer sizes, though, such that we never access memory outside CACHE.
+ */
+static svn_boolean_t
+find_entry_optimistic(entry_t *result,
+                      apr_uint32_t *idx,
+                      svn_membuffer_t *cache,
+                      apr_uint32_t group_index,
+                      const full_key_t *to_find)
+{
+  apr_uint32_t total_groups = cache->group_count + cache->spare_group_count;
+  apr_uint64_t data_size = cache->l1.size + cache->l2.size;
+  apr_uint32_t chain_length;
+
+  if (! is_group_initialized(cache, group_index))
+    return FALSE;
+
+  for (chain_length = 0;
+       chain_length < MAX_GROUP_CHAIN_LENGTH;
+       ++chain_length)
+    {
+      entry_group_t *group = &cache->directory[group_index];
+      apr_size_t used = MIN(group->header.used, GROUP_SIZE);
+      apr_size_t i;
+
+      for (i = 0; i < used; ++i)
+        if (entry_keys_match(&group->entries[i].key, &to_find->entry_key))
+          {
+            /* Work on a local copy.  The barrier prevents the compiler
+             * from re-reading the fields after we checked them. */
+            *result = group->entries[i];
+            *idx = group_index * GROUP_SIZE + (apr_uint32_t)i;
+            READ_BARRIER();
+
+            if (   result->key.key_len > result->size
+                || result->offset > data_size
+                || ALIGN_VALUE(result->size) > data_size - result->offset)
+              return FALSE;
+
+            /* Compare the full key, if there is one. */
+            return result->key.key_len == 0
+                || memcmp(to_find->full_key.data,
+                          cache->data + result->offset,
+                          result->key.key_len) == 0;
+          }
+
+      /* end of chain?  This also catches NO_INDEX. */
+      group_index = group->header.next;
+      if (group_index >= total_groups)
+        break;
+    }
+
+  return FALSE;
+}
+
+#endif /* USE_OPTIMISTIC_READS */
+
 /* Move a surviving ENTRY from just behind the insertion window to
  * its beginning and move the insertion window up accordingly.
  */
@@ -1832,17 +2063,42 @@ ensure_data_insertable_l1(svn_membuffer_t *cache, apr_size_t size)
    * right answer. */
 }
 
-svn_error_t *
-svn_cache__membuffer_cache_create(svn_membuffer_t **cache,
-                                  apr_size_t total_size,
-                                  apr_size_t directory_size,
-                                  apr_size_t segment_count,
-                                  svn_boolean_t thread_safe,
-                                  svn_boolean_t allow_blocking_writes,
-                                  apr_pool_t *pool)
+/* Return SIZE bytes of memory for a new cache.  If *SHARED_MEMORY is
+ * NULL, allocate it from POOL.  Otherwise, take it from the shared memory
+ * that *SHARED_MEMORY points to and advance that pointer accordingly.
+ */
+static void *
+cache_alloc(char **shared_memory,
+            apr_size_t size,
+            apr_pool_t *pool)
+{
+  void *result;
+  if (*shared_memory == NULL)
+    return apr_palloc(pool, size);
+
+  result = *shared_memory;
+  *shared_memory += ALIGN_VALUE(size);
+
+  return result;
+}
+
+/* Implement svn_cache__membuffer_cache_create and
+ * svn_cache__membuffer_cache_create_shared.  If SHARED is set, allocate
+ * the cache in shared memory and ignore THREAD_SAFE.
+ */
+static svn_error_t *
+membuffer_cache_create(svn_membuffer_t **cache,
+                       apr_size_t total_size,
+                       apr_size_t directory_size,
+                       apr_size_t segment_count,
+                       svn_boolean_t thread_safe,
+                       svn_boolean_t allow_blocking_writes,
+                       svn_boolean_t shared,
+                       apr_pool_t *pool)
 {
   svn_membuffer_t *c;
   prefix_pool_t *prefix_pool;
+  char *shared_memory = NULL;
 
   apr_uint32_t seg;
   apr_uint32_t group_count;
@@ -1853,10 +2109,18 @@ svn_cache__membuffer_cache_create(svn_membuffer_t **cache,
   apr_uint64_t max_entry_size;
 
   /* Allocate 1% of the cache capacity to the prefix string pool.
+   * Prefix indexes are process-specific, so shared caches can't use them.
    */
-  SVN_ERR(prefix_pool_create(&prefix_pool, total_size / 100, thread_safe,
-                             pool));
-  total_size -= total_size / 100;
+  if (shared)
+    {
+      SVN_ERR(prefix_pool_create(&prefix_pool, 0, TRUE, pool));
+    }
+  else
+    {
+      SVN_ERR(prefix_pool_create(&prefix_pool, total_size / 100,
+                                 thread_safe, pool));
+      total_size -= total_size / 100;
+    }
 
   /* Limit the total size (only relevant if we can address > 4GB)
    */
@@ -1910,9 +2174,6 @@ svn_cache__membuffer_cache_create(svn_membuffer_t **cache,
          && segment_count < MAX_SEGMENT_COUNT)
     segment_count *= 2;
 
-  /* allocate cache as an array of segments / cache objects */
-  c = apr_palloc(pool, segment_count * sizeof(*c));
-
   /* Split total cache size into segments of equal size
    */
   total_size /= segment_count;
@@ -1963,6 +2224,30 @@ svn_cache__membuffer_cache_create(svn_membuffer_t **cache,
   assert(spare_group_count > 0 && main_group_count > 0);
 
   group_init_size = 1 + group_count / (8 * GROUP_INIT_GRANULARITY);
+
+  /* Get all the shared memory that we will need in one go.  Memory that
+   * we never touch won't be committed by the OS.
+   */
+  if (shared)
+    {
+      apr_shm_t *shm;
+      apr_size_t shm_size
+        = ALIGN_VALUE(segment_count * sizeof(*c))
+        + segment_count * (  ALIGN_VALUE(group_count * sizeof(entry_group_t))
+                           + ALIGN_VALUE(group_init_size)
+                           + (apr_size_t)ALIGN_VALUE(data_size));
+
+      apr_status_t status = apr_shm_create(&shm, shm_size, NULL, pool);
+      if (status)
+        return svn_error_wrap_apr(status,
+                                  _("Can't create shared memory for cache"));
+
+      shared_memory = apr_shm_baseaddr_get(shm);
+    }
+
+  /* allocate cache as an array of segments / cache objects */
+  c = cache_alloc(&shared_memory, segment_count * sizeof(*c), pool);
+
   for (seg = 0; seg < segment_count; ++seg)
     {
       /* allocate buffers and initialize cache members
@@ -1978,12 +2263,15 @@ svn_cache__membuffer_cache_create(svn_membuffer_t **cache,
       /* Allocate but don't clear / zero the directory because it would add
          significantly to the server start-up time if the caches are large.
          Group initialization will take care of that in stead. */
-      c[seg].directory = apr_palloc(pool,
-                                    group_count * sizeof(entry_group_t));
+      c[seg].directory = cache_alloc(&shared_memory,
+                                     group_count * sizeof(entry_group_t),
+                                     pool);
 
       /* Allocate and initialize directory entries as "not initialized",
          hence "unused" */
-      c[seg].group_initialized = apr_pcalloc(pool, group_init_size);
+      c[seg].group_initialized = cache_alloc(&shared_memory,
+                                             group_init_size, pool);
+      memset(c[seg].group_initialized, 0, group_init_size);
 
       /* Allocate 1/4th of the data buffer to L1
        */
@@ -2004,7 +2292,8 @@ svn_cache__membuffer_cache_create(svn_membuffer_t **cache,
       c[seg].l2.current_data = c[seg].l2.start_offset;
 
       /* This cast is safe because DATA_SIZE <= MAX_SEGMENT_SIZE. */
-      c[seg].data = apr_palloc(pool, (apr_size_t)ALIGN_VALUE(data_size));
+      c[seg].data = cache_alloc(&shared_memory,
+                                (apr_size_t)ALIGN_VALUE(data_size), pool);
       c[seg].data_used = 0;
       c[seg].max_entry_size = max_entry_size;
 
@@ -2012,6 +2301,11 @@ svn_cache__membuffer_cache_create(svn_membuffer_t **cache,
       c[seg].total_reads = 0;
       c[seg].total_writes = 0;
       c[seg].total_hits = 0;
+      c[seg].total_contentions = 0;
+
+      /* No writes so far and no hits to apply. */
+      c[seg].write_sequence = 0;
+      memset(c[seg].deferred_hits, 0xff, sizeof(c[seg].deferred_hits));
 
       /* were allocations successful?
        * If not, initialize a minimal cache structure.
@@ -2023,26 +2317,39 @@ svn_cache__membuffer_cache_create(svn_membuffer_t **cache,
           return svn_error_wrap_apr(APR_ENOMEM, "OOM");
         }
 
+      /* Select the behavior of write operations.
+       */
+      c[seg].allow_blocking_writes = allow_blocking_writes;
+
+      /* Shared caches always need to be synchronized across processes
+       * and threads.  The intra-process lock remains unused.
+       */
+      c[seg].shared_lock = NULL;
+      if (shared)
+        {
+          apr_status_t status
+            = apr_global_mutex_create(&c[seg].shared_lock, NULL,
+                                      SHARED_LOCK_MECH, pool);
+          if (status)
+            return svn_error_wrap_apr(status, _("Can't create cache mutex"));
+        }
+
 #if (APR_HAS_THREADS && USE_SIMPLE_MUTEX)
       /* A lock for intra-process synchronization to the cache, or NULL if
        * the cache's creator doesn't feel the cache needs to be
        * thread-safe.
        */
-      SVN_ERR(svn_mutex__init(&c[seg].lock, thread_safe, pool));
+      SVN_ERR(svn_mutex__init(&c[seg].lock, thread_safe && !shared, pool));
 #elif (APR_HAS_THREADS && !USE_SIMPLE_MUTEX)
       /* Same for read-write lock. */
       c[seg].lock = NULL;
-      if (thread_safe)
+      if (thread_safe && !shared)
         {
           apr_status_t status =
               apr_thread_rwlock_create(&(c[seg].lock), pool);
           if (status)
             return svn_error_wrap_apr(status, _("Can't create cache mutex"));
         }
-
-      /* Select the behavior of write operations.
-       */
-      c[seg].allow_blocking_writes = allow_blocking_writes;
 #endif
       /* No writers at the moment. */
       c[seg].write_lock_count = 0;
@@ -2054,6 +2361,43 @@ svn_cache__membuffer_cache_create(svn_membuffer_t **cache,
   return SVN_NO_ERROR;
 }
 
+svn_error_t *
+svn_cache__membuffer_cache_create(svn_membuffer_t **cache,
+                                  apr_size_t total_size,
+                                  apr_size_t directory_size,
+                                  apr_size_t segment_count,
+                                  svn_boolean_t thread_safe,
+                                  svn_boolean_t allow_blocking_writes,
+                                  apr_pool_t *pool)
+{
+  return svn_error_trace(membuffer_cache_create(cache, total_size,
+                                                directory_size,
+                                                segment_count, thread_safe,
+                                                allow_blocking_writes,
+                                                FALSE, pool));
+}
+
+svn_error_t *
+svn_cache__membuffer_cache_create_shared(svn_membuffer_t **cache,
+                                         apr_size_t total_size,
+                                         apr_size_t directory_size,
+                                         apr_size_t segment_count,
+                                         svn_boolean_t allow_blocking_writes,
+                                         apr_pool_t *pool)
+{
+#if APR_HAS_SHARED_MEMORY && APR_HAS_FORK
+  return svn_error_trace(membuffer_cache_create(cache, total_size,
+                                                directory_size,
+                                                segment_count, TRUE,
+                                                allow_blocking_writes,
+                                                TRUE, pool));
+#else
+  return svn_error_create(SVN_ERR_UNSUPPORTED_FEATURE, NULL,
+                          _("Shared memory caches are not supported "
+                            "on this platform"));
+#endif
+}
+
 svn_error_t *
 svn_cache__membuffer_clear(svn_membuffer_t *cache)
 {
@@ -2078,6 +2422,7 @@ svn_cache__membuffer_clear(svn_membuffer_t *cache)
     {
       /* Unconditionally acquire the write lock. */
       SVN_ERR(force_write_lock_cache(&cache[seg]));
+      begin_write(&cache[seg]);
 
       /* Mark all groups as "not initialized", which implies "empty". */
       cache[seg].first_spare_group = NO_INDEX;
@@ -2102,7 +2447,8 @@ svn_cache__membuffer_clear(svn_membuffer_t *cache)
       cache[seg].used_entries = 0;
 
       /* Segment may be used again. */
-      SVN_ERR(unlock_cache(&cache[seg], SVN_NO_ERROR));
+      SVN_ERR(unlock_cache(&cache[seg], end_write(&cache[seg],
+                                                  SVN_NO_ERROR)));
     }
 
   /* done here */
@@ -2370,6 +2716,141 @@ increment_hit_counters(svn_membuffer_t *cache, entry_t *entry)
   cache->total_hits++;
 }
 
+/* Apply the hits recorded by optimistic readers in CACHE to the respective
+ * entries and reset the record.  The caller must hold the write lock.
+ */
+static void
+apply_deferred_hits(svn_membuffer_t *cache)
+{
+  apr_uint32_t total_groups = cache->group_count + cache->spare_group_count;
+  apr_size_t i;
+
+  for (i = 0; i < DEFERRED_HITS_SIZE; ++i)
+    {
+      apr_uint32_t idx = cache->deferred_hits[i];
+      apr_uint32_t group_index = idx / GROUP_SIZE;
+
+      if (idx == NO_INDEX)
+        continue;
+
+      /* The entry may have been dropped or replaced since it got hit.
+       * As long as it is still a used entry, we don't care. */
+      cache->deferred_hits[i] = NO_INDEX;
+      if (   group_index < total_groups
+          && is_group_initialized(cache, group_index)
+          && idx % GROUP_SIZE < cache->directory[group_index].header.used)
+        svn_atomic_inc(&get_entry(cache, idx)->hit_count);
+    }
+}
+
+#if USE_OPTIMISTIC_READS
+
+/* Record a hit in the entry with index IDX in CACHE, to be applied by the
+ * next writer.  Does not require any lock.
+ */
+static void
+record_deferred_hit(svn_membuffer_t *cache, apr_uint32_t idx)
+{
+  /* Frequently hit entries will only be written once per writer run,
+   * keeping the number of cache line invalidations low. */
+  apr_uint32_t *slot = &cache->deferred_hits[idx % DEFERRED_HITS_SIZE];
+  if (*slot != idx)
+    *slot = idx;
+
+  /* That one is for stats only. */
+  cache->total_hits++;
+}
+
+/* Begin an optimistic read of CACHE and return the sequence number that
+ * must be passed to end_optimistic_read().  Set *SUCCESS to FALSE if
+ * CACHE is currently being modified; leave it untouched otherwise.
+ */
+static svn_atomic_t
+begin_optimistic_read(svn_membuffer_t *cache, svn_boolean_t *success)
+{
+  svn_atomic_t sequence = svn_atomic_read(&cache->write_sequence);
+  READ_BARRIER();
+
+  if (sequence & 1)
+    {
+      cache->total_contentions++;
+      *success = FALSE;
+    }
+
+  return sequence;
+}
+
+/* Return whether no writer modified CACHE since begin_optimistic_read()
+ * returned SEQUENCE, i.e. whether the data read in between is valid.
+ */
+static svn_boolean_t
+end_optimistic_read(svn_membuffer_t *cache, svn_atomic_t sequence)
+{
+  READ_BARRIER();
+  if (svn_atomic_read(&cache->write_sequence) == sequence)
+    return TRUE;
+
+  cache->total_contentions++;
+  return FALSE;
+}
+
+/* Lock-free variant of membuffer_cache_get_internal() with the same
+ * parameters.  Return FALSE, if a concurrent modification may have
+ * interfered with the lookup.  In that case, the caller must repeat the
+ * lookup under the read lock.
+ */
+static svn_boolean_t
+membuffer_cache_get_optimistic(svn_membuffer_t *cache,
+                               apr_uint32_t group_index,
+                               const full_key_t *to_find,
+                               char **buffer,
+                               apr_size_t *item_size,
+                               apr_pool_t *result_pool)
+{
+  entry_t entry;
+  apr_uint32_t idx;
+  apr_size_t size;
+  svn_boolean_t success = TRUE;
+  svn_atomic_t sequence = begin_optimistic_read(cache, &success);
+
+  if (!success)
+    return FALSE;
+
+  if (!find_entry_optimistic(&entry, &idx, cache, group_index, to_find))
+    {
+      if (!end_optimistic_read(cache, sequence))
+        return FALSE;
+
+      /* no such entry found.
+       */
+      cache->total_reads++;
+      *buffer = NULL;
+      *item_size = 0;
+
+      return TRUE;
+    }
+
+  /* If the validation fails, BUFFER will be wasted.  That should be rare
+   * enough to not matter.
+   */
+  size = ALIGN_VALUE(entry.size) - entry.key.key_len;
+  *buffer = apr_palloc(result_pool, size);
+  memcpy(*buffer, cache->data + entry.offset + entry.key.key_len, size);
+
+  if (!end_optimistic_read(cache, sequence))
+    return FALSE;
+
+  /* update hit statistics
+   */
+  cache->total_reads++;
+  record_deferred_hit(cache, idx);
+  *item_size = entry.size - entry.key.key_len;
+
+  return TRUE;
+}
+
+#endif /* USE_OPTIMISTIC_READS */
+
 /* Look for the cache entry in group GROUP_INDEX of CACHE, identified
  * by the hash value TO_FIND. If no item has been stored for KEY,
  * *BUFFER will be NULL. Otherwise, return a copy of the serialized
@@ -2453,14 +2934,18 @@ membuffer_cache_get(svn_membuffer_t *cache,
   /* find the entry group that will hold the key.
    */
   group_index = get_group_index(&cache, &key->entry_key);
-  WITH_READ_LOCK(cache,
-                 membuffer_cache_get_internal(cache,
-                                              group_index,
-                                              key,
-                                              &buffer,
-                                              &size,
-                                              DEBUG_CACHE_MEMBUFFER_TAG
-                                              result_pool));
+#if USE_OPTIMISTIC_READS
+  if (!membuffer_cache_get_optimistic(cache, group_index, key,
+                                      &buffer, &size, result_pool))
+#endif
+    WITH_READ_LOCK(cache,
+                   membuffer_cache_get_internal(cache,
+                                                group_index,
+                                                key,
+                                                &buffer,
+                                                &size,
+                                                DEBUG_CACHE_MEMBUFFER_TAG
+                                                result_pool));
 
   /* re-construct the original data object from its serialized form.
    */
@@ -2583,6 +3068,76 @@ membuffer_cache_get_partial_internal(svn_membuffer_t *cache,
     }
 }
 
+#if USE_OPTIMISTIC_READS
+
+/* Lock-free variant of membuffer_cache_get_partial_internal() with the
+ * same parameters.  Return FALSE, if a concurrent modification may have
+ * interfered with the lookup or if the item is too large to be processed
+ * this way.  In that case, the caller must repeat the lookup under the
+ * read lock.  Otherwise, return the DESERIALIZER's result in *ERR.
+ */
+static svn_boolean_t
+membuffer_cache_get_partial_optimistic(svn_error_t **err,
+                                       svn_membuffer_t *cache,
+                                       apr_uint32_t group_index,
+                                       const full_key_t *to_find,
+                                       void **item,
+                                       svn_boolean_t *found,
+                                       svn_cache__partial_getter_func_t deserializer,
+                                       void *baton,
+                                       apr_pool_t *result_pool)
+{
+  /* Properly aligned copy of the serialized item. */
+  union
+    {
+      apr_uint64_t align_int;
+      void *align_ptr;
+      double align_float;
+      char data[MAX_OPTIMISTIC_PARTIAL_SIZE];
+    } copy;
+
+  entry_t entry;
+  apr_uint32_t idx;
+  apr_size_t item_size;
+  svn_boolean_t success = TRUE;
+  svn_atomic_t sequence = begin_optimistic_read(cache, &success);
+
+  if (!success)
+    return FALSE;
+
+  if (!find_entry_optimistic(&entry, &idx, cache, group_index, to_find))
+    {
+      if (!end_optimistic_read(cache, sequence))
+        return FALSE;
+
+      cache->total_reads++;
+      *item = NULL;
+      *found = FALSE;
+      *err = SVN_NO_ERROR;
+
+      return TRUE;
+    }
+
+  /* Large items are not worth copying.  Not a contention. */
+  item_size = entry.size - entry.key.key_len;
+  if (item_size > sizeof(copy.data))
+    return FALSE;
+
+  memcpy(copy.data, cache->data + entry.offset + entry.key.key_len,
+         item_size);
+  if (!end_optimistic_read(cache, sequence))
+    return FALSE;
+
+  cache->total_reads++;
+  record_deferred_hit(cache, idx);
+  *found = TRUE;
+  *err = deserializer(item, copy.data, item_size, baton, result_pool);
+
+  return TRUE;
+}
+
+#endif /* USE_OPTIMISTIC_READS */
+
 /* Look for the cache entry identified by KEY. FOUND indicates
  * whether that entry exists. If not found, *ITEM will be NULL. Otherwise,
  * the DESERIALIZER is called with that entry and the BATON provided
@@ -2601,6 +3156,14 @@ membuffer_cache_get_partial(svn_membuffer_t *cache,
 {
   apr_uint32_t group_index = get_group_index(&cache, &key->entry_key);
 
+#if USE_OPTIMISTIC_READS
+  svn_error_t *err;
+  if (membuffer_cache_get_partial_optimistic(&err, cache, group_index, key,
+                                             item, found, deserializer,
+                                             baton, result_pool))
+    return svn_error_trace(err);
+#endif
+
   WITH_READ_LOCK(cache,
                  membuffer_cache_get_partial_internal
                      (cache, group_index, key, item, found,
@@ -2753,6 +3316,499 @@ membuffer_cache_set_partial(svn_membuffer_t *cache,
   return SVN_NO_ERROR;
 }
 
+/* Snapshots written by svn_cache__membuffer_save() start with these two
+ * apr_uint32_t values.  Because the whole snapshot uses the native data
+ * layout, the magic number will also detect byte order mismatches.
+ */
+#define SNAPSHOT_MAGIC 0x53564e43
+#define SNAPSHOT_VERSION 1
+
+/* Upper limit to the length of key prefixes and tags in a snapshot.
+ * Anything longer indicates a corrupted snapshot.
+ */
+#define SNAPSHOT_MAX_STRING_LEN 0x10000
+
+/* After the snapshot header, a sequence of records follows.  Each one
+ * starts with an apr_uint32_t containing one of these values.
+ */
+enum snapshot_record_kind_t
+{
+  /* Last record in a snapshot. */
+  snapshot_end = 0,
+
+  /* Key prefix.  Contains two apr_uint32_t for the prefix and tag
+   * lengths, followed by the two respective strings without terminating
+   * NULs.  Prefix records get implicitly numbered in the order in which
+   * they appear in the snapshot, starting at 0. */
+  snapshot_prefix,
+
+  /* Cache entry.  Contains a snapshot_entry_t followed by its data. */
+  snapshot_entry
+};
+
+/* Header of a snapshot_entry record.  It is followed by SIZE bytes of
+ * entry data, i.e. the full key (if any) followed by the serialized item.
+ */
+typedef struct snapshot_entry_t
+{
+  /* Fingerprint of the full key, see entry_key_t. */
+  apr_uint64_t fingerprint[2];
+
+  /* Number of bytes at the start of the entry data that contain the
+   * full key.  0, if the key prefix is shared via the prefix pool. */
+  apr_uint64_t key_len;
+
+  /* Total size of the entry data. */
+  apr_uint64_t size;
+
+  /* Number of the snapshot_prefix record for this entry's key prefix.
+   * Within the cache, this will temporarily be the prefix pool index. */
+  apr_uint32_t prefix_id;
+
+  /* Priority of the entry within the cache. */
+  apr_uint32_t priority;
+} snapshot_entry_t;
+
+/* Context used by svn_cache__membuffer_save().
+ */
+typedef struct snapshot_writer_t
+{
+  /* Write the snapshot to this stream. */
+  svn_stream_t *stream;
+
+  /* Callback and baton that decide which prefixes to write. */
+  svn_cache__snapshot_tag_func_t tag_func;
+  void *tag_baton;
+
+  /* Map prefix string to apr_uint32_t, the number of the respective
+   * prefix record or NO_INDEX, if the prefix shall be skipped. */
+  apr_hash_t *prefixes;
+
+  /* Number of prefix records written so far. */
+  apr_uint32_t prefix_count;
+
+  /* Pool to allocate PREFIXES and its contents in. */
+  apr_pool_t *pool;
+} snapshot_writer_t;
+
+/* Write LEN bytes from DATA to STREAM.
+ */
+static svn_error_t *
+write_snapshot_data(svn_stream_t *stream,
+                    const void *data,
+                    apr_size_t len)
+{
+  return svn_error_trace(svn_stream_write(stream, data, &len));
+}
+
+/* Write VALUE to STREAM.
+ */
+static svn_error_t *
+write_snapshot_uint32(svn_stream_t *stream,
+                      apr_uint32_t value)
+{
+  return svn_error_trace(write_snapshot_data(stream, &value,
+                                             sizeof(value)));
+}
+
+/* Read exactly LEN bytes from STREAM into DATA.
+ */
+static svn_error_t *
+read_snapshot_data(svn_stream_t *stream,
+                   void *data,
+                   apr_size_t len)
+{
+  apr_size_t read = len;
+  SVN_ERR(svn_stream_read_full(stream, data, &read));
+  if (read != len)
+    return svn_error_create(SVN_ERR_STREAM_MALFORMED_DATA, NULL,
+                            _("Unexpected end of cache snapshot"));
+
+  return SVN_NO_ERROR;
+}
+
+/* Read an apr_uint32_t from STREAM and return it in *VALUE.
+ */
+static svn_error_t *
+read_snapshot_uint32(apr_uint32_t *value,
+                     svn_stream_t *stream)
+{
+  return svn_error_trace(read_snapshot_data(stream, value, sizeof(*value)));
+}
+
+/* Read a string of LEN bytes from STREAM and return it in *STR,
+ * allocated in RESULT_POOL.
+ */
+static svn_error_t *
+read_snapshot_string(const char **str,
+                     svn_stream_t *stream,
+                     apr_uint32_t len,
+                     apr_pool_t *result_pool)
+{
+  char *buffer;
+  if (len > SNAPSHOT_MAX_STRING_LEN)
+    return svn_error_create(SVN_ERR_STREAM_MALFORMED_DATA, NULL,
+                            _("Corrupt cache snapshot"));
+
+  buffer = apr_palloc(result_pool, len + 1);
+  SVN_ERR(read_snapshot_data(stream, buffer, len));
+  buffer[len] = '\0';
+
+  *str = buffer;
+  return SVN_NO_ERROR;
+}
+
+/* Append a snapshot_entry_t header plus the data of all entries in the
+ * group chain starting at GROUP_INDEX in CACHE to BUFFER.  The PREFIX_ID
+ * in those headers will be the respective prefix pool index.
+ *
+ * Note: This function requires the caller to serialize access.
+ */
+static svn_error_t *
+copy_group_chain(svn_stringbuf_t *buffer,
+                 svn_membuffer_t *cache,
+                 apr_uint32_t group_index)
+{
+  entry_group_t *group = &cache->directory[group_index];
+  apr_uint32_t i;
+
+  svn_stringbuf_setempty(buffer);
+  if (!is_group_initialized(cache, group_index))
+    return SVN_NO_ERROR;
+
+  while (TRUE)
+    {
+      for (i = 0; i < group->header.used; ++i)
+        {
+          entry_t *entry = &group->entries[i];
+          snapshot_entry_t header;
+
+          header.fingerprint[0] = entry->key.fingerprint[0];
+          header.fingerprint[1] = entry->key.fingerprint[1];
+          header.key_len = entry->key.key_len;
+          header.size = entry->size;
+          header.prefix_id = entry->key.prefix_idx;
+          header.priority = entry->priority;
+
+          svn_stringbuf_appendbytes(buffer, (const char *)&header,
+                                    sizeof(header));
+          svn_stringbuf_appendbytes(buffer,
+                                    (const char *)cache->data
+                                      + entry->offset,
+                                    entry->size);
+        }
+
+      if (group->header.next == NO_INDEX)
+        break;
+
+      group = &cache->directory[group->header.next];
+    }
+
+  return SVN_NO_ERROR;
+}
+
+/* Set *PREFIX_ID to the number of the prefix record for PREFIX in the
+ * snapshot being written by WRITER.  If there is no such record, yet,
+ * ask the tag callback and write one.  Set *PREFIX_ID to NO_INDEX if
+ * the entries for PREFIX shall not be written.
+ */
+static svn_error_t *
+get_snapshot_prefix_id(apr_uint32_t *prefix_id,
+                       snapshot_writer_t *writer,
+                       const char *prefix)
+{
+  const char *tag;
+  apr_uint32_t *id = svn_hash_gets(writer->prefixes, prefix);
+  if (id)
+    {
+      *prefix_id = *id;
+      return SVN_NO_ERROR;
+    }
+
+  SVN_ERR(writer->tag_func(&tag, writer->tag_baton, prefix, writer->pool));
+
+  id = apr_palloc(writer->pool, sizeof(*id));
+  *id = tag ? writer->prefix_count++ : NO_INDEX;
+  svn_hash_sets(writer->prefixes, apr_pstrdup(writer->pool, prefix), id);
+
+  if (tag)
+    {
+      apr_size_t prefix_len = strlen(prefix);
+      apr_size_t tag_len = strlen(tag);
+
+      if (   prefix_len > SNAPSHOT_MAX_STRING_LEN
+          || tag_len > SNAPSHOT_MAX_STRING_LEN)
+        return svn_error_create(SVN_ERR_INCORRECT_PARAMS, NULL,
+                                _("Cache prefix or tag too long"));
+
+      SVN_ERR(write_snapshot_uint32(writer->stream, snapshot_prefix));
+      SVN_ERR(write_snapshot_uint32(writer->stream,
+                                    (apr_uint32_t)prefix_len));
+      SVN_ERR(write_snapshot_uint32(writer->stream, (apr_uint32_t)tag_len));
+      SVN_ERR(write_snapshot_data(writer->stream, prefix, prefix_len));
+      SVN_ERR(write_snapshot_data(writer->stream, tag, tag_len));
+    }
+
+  *prefix_id = *id;
+  return SVN_NO_ERROR;
+}
+
+/* Write the entries copied from CACHE into BUFFER by copy_group_chain()
+ * to the snapshot of WRITER.  Skip all entries whose prefix the tag
+ * callback rejects.
+ */
+static svn_error_t *
+write_snapshot_entries(snapshot_writer_t *writer,
+                       svn_membuffer_t *cache,
+                       const svn_stringbuf_t *buffer)
+{
+  apr_size_t pos = 0;
+  while (pos < buffer->len)
+    {
+      snapshot_entry_t header;
+      const char *data;
+      const char *prefix;
+
+      memcpy(&header, buffer->data + pos, sizeof(header));
+      data = buffer->data + pos + sizeof(header);
+      pos += sizeof(header) + (apr_size_t)header.size;
+
+      /* Full keys start with the NUL-terminated prefix.  Otherwise,
+       * the prefix pool contains it.  Prefixes never get removed from
+       * the pool, so we don't need to lock the cache here. */
+      if (header.key_len)
+        {
+          if (!memchr(data, '\0', (apr_size_t)header.key_len))
+            continue;
+
+          prefix = data;
+        }
+      else
+        {
+          if (header.prefix_id >= cache->prefix_pool->values_used)
+            continue;
+
+          prefix = cache->prefix_pool->values[header.prefix_id];
+        }
+
+      SVN_ERR(get_snapshot_prefix_id(&header.prefix_id, writer, prefix));
+      if (header.prefix_id == NO_INDEX)
+        continue;
+
+      SVN_ERR(write_snapshot_uint32(writer->stream, snapshot_entry));
+      SVN_ERR(write_snapshot_data(writer->stream, &header, sizeof(header)));
+      SVN_ERR(write_snapshot_data(writer->stream, data,
+                                  (apr_size_t)header.size));
+    }
+
+  return SVN_NO_ERROR;
+}
+
+svn_error_t *
+svn_cache__membuffer_save(svn_membuffer_t *cache,
+                          svn_stream_t *stream,
+                          svn_cache__snapshot_tag_func_t tag_func,
+                          void *tag_baton,
+                          apr_pool_t *scratch_pool)
+{
+  snapshot_writer_t writer;
+  svn_stringbuf_t *buffer = svn_stringbuf_create_empty(scratch_pool);
+  apr_uint32_t seg;
+  apr_uint32_t i;
+
+  writer.stream = stream;
+  writer.tag_func = tag_func;
+  writer.tag_baton = tag_baton;
+  writer.prefixes = apr_hash_make(scratch_pool);
+  writer.prefix_count = 0;
+  writer.pool = scratch_pool;
+
+  SVN_ERR(write_snapshot_uint32(stream, SNAPSHOT_MAGIC));
+  SVN_ERR(write_snapshot_uint32(stream, SNAPSHOT_VERSION));
+
+  /* Copy the contents one group chain at a time.  That keeps the memory
+   * usage low and does not block concurrent cache users for long.  We
+   * may miss or duplicate entries that get moved while we iterate but
+   * that is harmless. */
+  for (seg = 0; seg < cache->segment_count; ++seg)
+    {
+      svn_membuffer_t *segment = &cache[seg];
+      for (i = 0; i < segment->group_count; ++i)
+        {
+          WITH_READ_LOCK(segment, copy_group_chain(buffer, segment, i));
+          SVN_ERR(write_snapshot_entries(&writer, segment, buffer));
+        }
+    }
+
+  return svn_error_trace(write_snapshot_uint32(stream, snapshot_end));
+}
+
+#ifndef SVN_DEBUG_CACHE_MEMBUFFER
+
+/* Per-prefix information used by svn_cache__membuffer_load().
+ */
+typedef struct snapshot_prefix_t
+{
+  /* The key prefix. */
+  const char *prefix;
+
+  /* Index of PREFIX within the cache's prefix pool.  NO_INDEX, if it has
+   * not been looked up, yet, or if the pool did not accept it. */
+  apr_uint32_t prefix_idx;
+
+  /* Whether entries with this prefix shall be put into the cache. */
+  svn_boolean_t accepted;
+} snapshot_prefix_t;
+
+/* Put the entry described by HEADER with contents DATA into CACHE.
+ * PREFIX_IDX is the index of the entry's key prefix within the cache's
+ * prefix pool.  Use SCRATCH_POOL for temporary allocations.
+ */
+static svn_error_t *
+load_snapshot_entry(svn_membuffer_t *cache,
+                    const snapshot_entry_t *header,
+                    apr_uint32_t prefix_idx,
+                    char *data,
+                    apr_pool_t *scratch_pool)
+{
+  full_key_t key;
+  apr_uint32_t group_index;
+  apr_size_t key_len = (apr_size_t)header->key_len;
+
+  key.entry_key.fingerprint[0] = header->fingerprint[0];
+  key.entry_key.fingerprint[1] = header->fingerprint[1];
+  key.entry_key.key_len = key_len;
+  key.entry_key.prefix_idx = prefix_idx;
+  key.full_key.data = data;
+  key.full_key.size = key_len;
+  key.full_key.pool = NULL;
+
+  group_index = get_group_index(&cache, &key.entry_key);
+
+  /* Unlike regular writers, we are not in a hurry and always wait for
+   * the write lock. */
+  SVN_ERR(force_write_lock_cache(cache));
+  begin_write(cache);
+  SVN_ERR(unlock_cache(cache,
+                       end_write(cache,
+                                 membuffer_cache_set_internal(
+                                   cache, &key, group_index,
+                                   data + key_len,
+                                   (apr_size_t)header->size - key_len,
+                                   header->priority,
+                                   scratch_pool))));
+
+  return SVN_NO_ERROR;
+}
+
+#endif /* SVN_DEBUG_CACHE_MEMBUFFER */
+
+svn_error_t *
+svn_cache__membuffer_load(svn_membuffer_t *cache,
+                          svn_stream_t *stream,
+                          svn_cache__snapshot_accept_func_t accept_func,
+                          void *accept_baton,
+                          apr_pool_t *scratch_pool)
+{
+#ifdef SVN_DEBUG_CACHE_MEMBUFFER
+  /* We could not reconstruct the entry tags. */
+  return svn_error_create(SVN_ERR_UNSUPPORTED_FEATURE, NULL,
+                          _("Can't load cache snapshots into debug caches"));
+#else
+  apr_array_header_t *prefixes
+    = apr_array_make(scratch_pool, 16, sizeof(snapshot_prefix_t));
+  svn_stringbuf_t *buffer = svn_stringbuf_create_empty(scratch_pool);
+  apr_pool_t *iterpool = svn_pool_create(scratch_pool);
+  apr_uint32_t value;
+
+  SVN_ERR(read_snapshot_uint32(&value, stream));
+  if (value != SNAPSHOT_MAGIC)
+    return svn_error_create(SVN_ERR_STREAM_MALFORMED_DATA, NULL,
+                            _("Not a cache snapshot"));
+
+  SVN_ERR(read_snapshot_uint32(&value, stream));
+  if (value != SNAPSHOT_VERSION)
+    return svn_error_createf(SVN_ERR_STREAM_MALFORMED_DATA, NULL,
+                             _("Unsupported cache snapshot version %u"),
+                             value);
+
+  while (TRUE)
+    {
+      svn_pool_clear(iterpool);
+      SVN_ERR(read_snapshot_uint32(&value, stream));
+
+      if (value == snapshot_end)
+        {
+          break;
+        }
+      else if (value == snapshot_prefix)
+        {
+          apr_uint32_t prefix_len, tag_len;
+          const char *tag;
+          snapshot_prefix_t *prefix = apr_array_push(prefixes);
+
+          SVN_ERR(read_snapshot_uint32(&prefix_len, stream));
+          SVN_ERR(read_snapshot_uint32(&tag_len, stream));
+          SVN_ERR(read_snapshot_string(&prefix->prefix, stream, prefix_len,
+                                       scratch_pool));
+          SVN_ERR(read_snapshot_string(&tag, stream, tag_len, iterpool));
+
+          prefix->prefix_idx = NO_INDEX;
+          SVN_ERR(accept_func(&prefix->accepted, accept_baton,
+                              prefix->prefix, tag, iterpool));
+        }
+      else if (value == snapshot_entry)
+        {
+          snapshot_entry_t header;
+          snapshot_prefix_t *prefix;
+
+          SVN_ERR(read_snapshot_data(stream, &header, sizeof(header)));
+          if (   header.prefix_id >= (apr_uint32_t)prefixes->nelts
+              || header.key_len > header.size
+              || header.size > MAX_ITEM_SIZE)
+            return svn_error_create(SVN_ERR_STREAM_MALFORMED_DATA, NULL,
+                                    _("Corrupt cache snapshot"));
+
+          /* Shared prefixes must be known to this cache's prefix pool
+           * as well.  If it is full, we can't store such entries. */
+          prefix = &APR_ARRAY_IDX(prefixes, header.prefix_id,
+                                  snapshot_prefix_t);
+          if (prefix->accepted && !header.key_len
+              && prefix->prefix_idx == NO_INDEX)
+            {
+              SVN_ERR(prefix_pool_get(&prefix->prefix_idx,
+                                      cache->prefix_pool,
+                                      prefix->prefix));
+              prefix->accepted = prefix->prefix_idx != NO_INDEX;
+            }
+
+          if (!prefix->accepted || header.size > cache->max_entry_size)
+            {
+              apr_size_t size = (apr_size_t)header.size;
+              SVN_ERR(svn_stream_skip(stream, size));
+              continue;
+            }
+
+          svn_stringbuf_ensure(buffer, (apr_size_t)header.size);
+          SVN_ERR(read_snapshot_data(stream, buffer->data,
+                                     (apr_size_t)header.size));
+          SVN_ERR(load_snapshot_entry(cache, &header,
+                                      header.key_len ? NO_INDEX
+                                                     : prefix->prefix_idx,
+                                      buffer->data, iterpool));
+        }
+      else
+        {
+          return svn_error_create(SVN_ERR_STREAM_MALFORMED_DATA, NULL,
+                                  _("Corrupt cache snapshot"));
+        }
+    }
+
+  svn_pool_destroy(iterpool);
+  return SVN_NO_ERROR;
+#endif
+}
+
 /* Implement the svn_cache__t interface on top of a shared membuffer cache.
  *
  * Because membuffer caches tend to be very large, there will be rather few
@@ -3451,6 +4507,7 @@ svn_membuffer_get_global_segment_info(svn_membuffer_t *segment,
   info->gets += segment->total_reads;
   info->sets += segment->total_writes;
   info->hits += segment->total_hits;
+  info->contentions += segment->total_contentions;
 
   WITH_READ_LOCK(segment,
                   svn_membuffer_get_segment_info(segment, info, TRUE));
@@ -3478,3 +4535,22 @@ svn_cache__membuffer_get_global_info(apr_pool_t *pool)
 
   return info;
 }
+
+void
+svn_cache__membuffer_get_global_counters(apr_uint64_t *gets,
+                                         apr_uint64_t *hits)
+{
+  apr_uint32_t i;
+  svn_membuffer_t *membuffer = svn_cache__get_global_membuffer_cache();
+
+  *gets = 0;
+  *hits = 0;
+  if (membuffer == NULL)
+    return;
+
+  for (i = 0; i < membuffer->segment_count; ++i)
+    {
+      *gets += membuffer[i].total_reads;
+      *hits += membuffer[i].total_hits;
+    }
+}
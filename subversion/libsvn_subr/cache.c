@@ -257,7 +257,17 @@ svn_cache__format_info(const svn_cache__info_t *info,
   double data_entry_rate = (100.0 * (double)info->used_entries)
                  / (double)(info->total_entries ? info->total_entries : 1);
 
+  const char *rejected = "";
   const char *histogram = "";
+
+  if (info->rejections)
+    rejected = apr_psprintf(result_pool,
+                            "rejected: %" APR_UINT64_T_FMT
+                            " (%5.2f%% of sets)\n",
+                            info->rejections,
+                            (100.0 * (double)info->rejections)
+                            / (double)(info->sets ? info->sets : 1));
+
   if (!access_only)
     {
       svn_stringbuf_t *text = svn_stringbuf_create_empty(result_pool);
@@ -283,19 +293,21 @@ svn_cache__format_info(const svn_cache__info_t *info,
                             "gets    : %" APR_UINT64_T_FMT
                             ", %" APR_UINT64_T_FMT " hits (%5.2f%%)\n"
                             "sets    : %" APR_UINT64_T_FMT
-                            " (%5.2f%% of misses)\n",
+                            " (%5.2f%% of misses)\n%s",
                             info->id,
                             info->gets,
                             info->hits, hit_rate,
-                            info->sets, write_rate)
+                            info->sets, write_rate,
+                            rejected)
        : svn_string_createf(result_pool,
 
                             "%s\n"
                             "gets    : %" APR_UINT64_T_FMT
                             ", %" APR_UINT64_T_FMT " hits (%5.2f%%)\n"
                             "sets    : %" APR_UINT64_T_FMT
-                            " (%5.2f%% of misses)\n"
+                            " (%5.2f%% of misses)\n%s"
                             "failures: %" APR_UINT64_T_FMT "\n"
+                            "contentions: %" APR_UINT64_T_FMT "\n"
                             "used    : %" APR_UINT64_T_FMT " MB (%5.2f%%)"
                             " of %" APR_UINT64_T_FMT " MB data cache"
                             " / %" APR_UINT64_T_FMT " MB total cache memory\n"
@@ -307,7 +319,9 @@ svn_cache__format_info(const svn_cache__info_t *info,
                             info->gets,
                             info->hits, hit_rate,
                             info->sets, write_rate,
+                            rejected,
                             info->failures,
+                            info->contentions,
 
                             info->used_size / _1MB, data_usage_rate,
                             info->data_size / _1MB,
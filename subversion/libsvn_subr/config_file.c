@@ -1169,6 +1169,10 @@ svn_config_ensure(const char *config_dir, apr_pool_t *pool)
         "###   http-bulk-updates          Whether to request bulk update"    NL
         "###                              responses or to fetch each file"   NL
         "###                              in an individual request. "        NL
+        "###   svn-max-connections        Maximum number of parallel server" NL
+        "###                              connections to use when updating"  NL
+        "###                              over svn:// (1 disables extra"     NL
+        "###                              connections)."                     NL
         "###   store-passwords            Specifies whether passwords used"  NL
         "###                              to authenticate against a"         NL
         "###                              Subversion server may be cached"   NL
@@ -1552,6 +1556,25 @@ svn_config_ensure(const char *config_dir, apr_pool_t *pool)
         "### returning an error.  The default is 10000, i.e. 10 seconds."    NL
         "### Longer values may be useful when exclusive locking is enabled." NL
         "# busy-timeout = 10000"                                             NL
+        "### Set the number of threads that scan the working copy for local" NL
+        "### changes during 'svn status' and similar operations.  More"      NL
+        "### threads may help on large working copies and on slow or network"NL
+        "### file systems.  The default is 1, i.e. no additional threads."   NL
+        "### This has no effect when exclusive locking is enabled."          NL
+        "# status-threads = 1"                                               NL
+        "### Set the number of threads that install files into the working" NL
+        "### copy and remove them from it during checkouts, updates and"     NL
+        "### similar operations.  More threads may help when checking out"  NL
+        "### many files to fast disks.  The default is 1, i.e. no additional"NL
+        "### threads."                                                       NL
+        "# install-threads = 1"                                              NL
+        "### Set this to 'lz4' or 'zlib' to store the pristine copies of"    NL
+        "### files that new working copies keep in .svn/pristine compressed,"NL
+        "### or to 'no' to store them uncompressed.  LZ4 is fast, zlib saves"NL
+        "### more space.  Compressed working copies can't be used by clients"NL
+        "### older than 1.15.  Run 'svn upgrade' to convert the pristine"    NL
+        "### store of an existing working copy after changing this option."  NL
+        "# compress-pristines = no"                                          NL
         ;
 
       err = svn_io_file_open(&f, path,
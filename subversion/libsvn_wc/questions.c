@@ -29,6 +29,9 @@
 #include <apr_file_io.h>
 #include <apr_file_info.h>
 #include <apr_time.h>
+#if APR_HAS_THREADS
+#include <apr_thread_proc.h>
+#endif
 
 #include "svn_pools.h"
 #include "svn_types.h"
@@ -38,6 +41,8 @@
 #include "svn_time.h"
 #include "svn_io.h"
 #include "svn_props.h"
+#include "svn_hash.h"
+#include "svn_sorts.h"
 
 #include "wc.h"
 #include "conflicts.h"
@@ -45,6 +50,7 @@
 #include "wc_db.h"
 
 #include "svn_private_config.h"
+#include "private/svn_atomic.h"
 #include "private/svn_wc_private.h"
 
 
@@ -78,16 +84,36 @@
 */
 
 
-/* Set *MODIFIED_P to TRUE if (after translation) VERSIONED_FILE_ABSPATH
- * (of VERSIONED_FILE_SIZE bytes) differs from PRISTINE_STREAM (of
- * PRISTINE_SIZE bytes), else to FALSE if not.
- *
- * If EXACT_COMPARISON is FALSE, translate VERSIONED_FILE_ABSPATH's EOL
- * style and keywords to repository-normal form according to its properties,
- * and compare the result with PRISTINE_STREAM.  If EXACT_COMPARISON is
- * TRUE, translate PRISTINE_STREAM's EOL style and keywords to working-copy
- * form according to VERSIONED_FILE_ABSPATH's properties, and compare the
- * result with VERSIONED_FILE_ABSPATH.
+/* What compare_and_verify() needs to know to compare a working file with
+   its pristine.  Everything in here is read from the DB up front, so that
+   the comparison itself doesn't need the DB and may run on any thread. */
+typedef struct text_compare_t
+{
+  const char *local_abspath;
+
+  /* The size of the working file. */
+  svn_filesize_t file_size;
+
+  /* The pristine.  PRISTINE_ABSPATH is NULL if the sizes alone show that
+     the file is modified.  PRISTINE_COMPRESSED tells how to open it. */
+  const svn_checksum_t *checksum;
+  const char *pristine_abspath;
+  svn_boolean_t pristine_compressed;
+  svn_filesize_t pristine_size;
+
+  /* How to translate the working file, if NEED_TRANSLATION is set. */
+  svn_boolean_t need_translation;
+  svn_subst_eol_style_t eol_style;
+  const char *eol_str;
+  apr_hash_t *keywords;
+  svn_boolean_t special;
+
+  svn_boolean_t exact_comparison;
+} text_compare_t;
+
+/* Set *COMPARE to the information needed to compare the working file
+ * VERSIONED_FILE_ABSPATH (of VERSIONED_FILE_SIZE bytes) with the pristine
+ * identified by CHECKSUM.
  *
  * HAS_PROPS should be TRUE if the file had properties when it was not
  * modified, otherwise FALSE.
@@ -95,66 +121,121 @@
  * PROPS_MOD should be TRUE if the file's properties have been changed,
  * otherwise FALSE.
  *
- * PRISTINE_STREAM will be closed before a successful return.
+ * EXACT_COMPARISON is as for compare_and_verify().
  *
- * DB is a wc_db; use SCRATCH_POOL for temporary allocation.
+ * DB is a wc_db; allocate *COMPARE in RESULT_POOL and use SCRATCH_POOL for
+ * temporary allocations.
  */
 static svn_error_t *
-compare_and_verify(svn_boolean_t *modified_p,
-                   svn_wc__db_t *db,
-                   const char *versioned_file_abspath,
-                   svn_filesize_t versioned_file_size,
-                   svn_stream_t *pristine_stream,
-                   svn_filesize_t pristine_size,
-                   svn_boolean_t has_props,
-                   svn_boolean_t props_mod,
-                   svn_boolean_t exact_comparison,
-                   apr_pool_t *scratch_pool)
+prepare_compare(text_compare_t **compare,
+                svn_wc__db_t *db,
+                const char *versioned_file_abspath,
+                svn_filesize_t versioned_file_size,
+                const svn_checksum_t *checksum,
+                svn_boolean_t has_props,
+                svn_boolean_t props_mod,
+                svn_boolean_t exact_comparison,
+                apr_pool_t *result_pool,
+                apr_pool_t *scratch_pool)
 {
-  svn_boolean_t same;
-  svn_subst_eol_style_t eol_style;
-  const char *eol_str;
-  apr_hash_t *keywords;
-  svn_boolean_t special = FALSE;
-  svn_boolean_t need_translation;
-  svn_stream_t *v_stream; /* versioned_file */
+  text_compare_t *tc = apr_pcalloc(result_pool, sizeof(*tc));
 
   SVN_ERR_ASSERT(svn_dirent_is_absolute(versioned_file_abspath));
 
+  tc->local_abspath = apr_pstrdup(result_pool, versioned_file_abspath);
+  tc->file_size = versioned_file_size;
+  tc->checksum = svn_checksum_dup(checksum, result_pool);
+  tc->exact_comparison = exact_comparison;
+
   if (props_mod)
     has_props = TRUE; /* Maybe it didn't have properties; but it has now */
 
   if (has_props)
     {
-      SVN_ERR(svn_wc__get_translate_info(&eol_style, &eol_str,
-                                         &keywords,
-                                         &special,
+      SVN_ERR(svn_wc__get_translate_info(&tc->eol_style, &tc->eol_str,
+                                         &tc->keywords,
+                                         &tc->special,
                                          db, versioned_file_abspath, NULL,
                                          !exact_comparison,
-                                         scratch_pool, scratch_pool));
+                                         result_pool, scratch_pool));
 
-      need_translation = svn_subst_translation_required(eol_style, eol_str,
-                                                        keywords, special,
-                                                        TRUE);
+      tc->need_translation = svn_subst_translation_required(tc->eol_style,
+                                                            tc->eol_str,
+                                                            tc->keywords,
+                                                            tc->special,
+                                                            TRUE);
     }
   else
-    need_translation = FALSE;
+    tc->need_translation = FALSE;
+
+  SVN_ERR(svn_wc__db_pristine_read(NULL, &tc->pristine_size, db,
+                                   versioned_file_abspath, checksum,
+                                   scratch_pool, scratch_pool));
 
-  if (! need_translation
-      && (versioned_file_size != pristine_size))
+  if (tc->need_translation || tc->file_size == tc->pristine_size)
+    SVN_ERR(svn_wc__db_pristine_get_file(&tc->pristine_abspath,
+                                         &tc->pristine_compressed, db,
+                                         versioned_file_abspath, checksum,
+                                         result_pool, scratch_pool));
+
+  *compare = tc;
+
+  return SVN_NO_ERROR;
+}
+
+/* Set *MODIFIED_P to TRUE if (after translation) the working file
+ * described by TC differs from its pristine, else to FALSE if not.
+ *
+ * If TC->EXACT_COMPARISON is FALSE, translate the working file's EOL
+ * style and keywords to repository-normal form according to its
+ * properties, and compare the result with the pristine.  If
+ * TC->EXACT_COMPARISON is TRUE, translate the pristine's EOL style and
+ * keywords to working-copy form according to the working file's
+ * properties, and compare the result with the working file.
+ *
+ * This doesn't access the DB.  Use SCRATCH_POOL for temporary allocation.
+ */
+static svn_error_t *
+compare_and_verify(svn_boolean_t *modified_p,
+                   const text_compare_t *tc,
+                   apr_pool_t *scratch_pool)
+{
+  svn_boolean_t same;
+  const char *eol_str = tc->eol_str;
+  svn_stream_t *pristine_stream;
+  svn_stream_t *v_stream; /* versioned_file */
+
+  if (! tc->need_translation
+      && (tc->file_size != tc->pristine_size))
     {
       *modified_p = TRUE;
+      return SVN_NO_ERROR;
+    }
 
-      /* ### Why did we open the pristine? */
-      return svn_error_trace(svn_stream_close(pristine_stream));
+  /* Without translation, the working file is unmodified iff it has the
+     checksum that identifies the pristine, so there is no need to read
+     the pristine as well. */
+  if (! tc->need_translation && ! tc->exact_comparison)
+    {
+      svn_checksum_t *checksum;
+
+      SVN_ERR(svn_io_file_checksum2(&checksum, tc->local_abspath,
+                                    svn_checksum_sha1, scratch_pool));
+      *modified_p = ! svn_checksum_match(checksum, tc->checksum);
+      return SVN_NO_ERROR;
     }
 
   /* ### Other checks possible? */
 
-  /* Reading files is necessary. */
-  if (special && need_translation)
+  /* Reading files is necessary.  Open the pristine first, so that any
+     access denied error from here on applies to the working file. */
+  SVN_ERR(svn_wc__db_pristine_open_file(&pristine_stream, tc->pristine_abspath,
+                                        tc->pristine_compressed,
+                                        scratch_pool, scratch_pool));
+
+  if (tc->special && tc->need_translation)
     {
-      SVN_ERR(svn_subst_read_specialfile(&v_stream, versioned_file_abspath,
+      SVN_ERR(svn_subst_read_specialfile(&v_stream, tc->local_abspath,
                                           scratch_pool, scratch_pool));
     }
   else
@@ -162,18 +243,18 @@ compare_and_verify(svn_boolean_t *modified_p,
       /* We don't use APR-level buffering because the comparison function
        * will do its own buffering. */
       apr_file_t *file;
-      SVN_ERR(svn_io_file_open(&file, versioned_file_abspath, APR_READ,
+      SVN_ERR(svn_io_file_open(&file, tc->local_abspath, APR_READ,
                                APR_OS_DEFAULT, scratch_pool));
       v_stream = svn_stream_from_aprfile2(file, FALSE, scratch_pool);
 
-      if (need_translation)
+      if (tc->need_translation)
         {
-          if (!exact_comparison)
+          if (!tc->exact_comparison)
             {
-              if (eol_style == svn_subst_eol_style_native)
+              if (tc->eol_style == svn_subst_eol_style_native)
                 eol_str = SVN_SUBST_NATIVE_EOL_STR;
-              else if (eol_style != svn_subst_eol_style_fixed
-                       && eol_style != svn_subst_eol_style_none)
+              else if (tc->eol_style != svn_subst_eol_style_fixed
+                       && tc->eol_style != svn_subst_eol_style_none)
                 return svn_error_create(SVN_ERR_IO_UNKNOWN_EOL,
                                         svn_stream_close(v_stream), NULL);
 
@@ -182,7 +263,7 @@ compare_and_verify(svn_boolean_t *modified_p,
               v_stream = svn_subst_stream_translated(v_stream,
                                                      eol_str,
                                                      TRUE /* repair */,
-                                                     keywords,
+                                                     tc->keywords,
                                                      FALSE /* expand */,
                                                      scratch_pool);
             }
@@ -192,7 +273,8 @@ compare_and_verify(svn_boolean_t *modified_p,
                * arrange to throw an error if its EOL style is inconsistent. */
               pristine_stream = svn_subst_stream_translated(pristine_stream,
                                                             eol_str, FALSE,
-                                                            keywords, TRUE,
+                                                            tc->keywords,
+                                                            TRUE,
                                                             scratch_pool);
             }
         }
@@ -206,15 +288,38 @@ compare_and_verify(svn_boolean_t *modified_p,
   return SVN_NO_ERROR;
 }
 
-svn_error_t *
-svn_wc__internal_file_modified_p(svn_boolean_t *modified_p,
-                                 svn_wc__db_t *db,
-                                 const char *local_abspath,
-                                 svn_boolean_t exact_comparison,
-                                 apr_pool_t *scratch_pool)
+/* Like compare_and_verify(), but report an access denied error on the
+   working file as SVN_ERR_WC_PATH_ACCESS_DENIED. */
+static svn_error_t *
+compare_file(svn_boolean_t *modified_p,
+             const text_compare_t *tc,
+             apr_pool_t *scratch_pool)
+{
+  svn_error_t *err = compare_and_verify(modified_p, tc, scratch_pool);
+
+  /* At this point we already opened the pristine file, so we know that
+     the access denied applies to the working copy path */
+  if (err && APR_STATUS_IS_EACCES(err->apr_err))
+    return svn_error_create(SVN_ERR_WC_PATH_ACCESS_DENIED, err, NULL);
+
+  return svn_error_trace(err);
+}
+
+/* Implement the part of svn_wc__internal_file_modified_p() that needs the
+   DB.  Either set *MODIFIED_P and *COMPARE to NULL, or set *COMPARE to
+   what compare_file() needs to determine *MODIFIED_P and *DIRENT to the
+   working file's dirent.  Allocate *COMPARE and *DIRENT in RESULT_POOL and
+   use SCRATCH_POOL for temporary allocations. */
+static svn_error_t *
+check_file_modified(svn_boolean_t *modified_p,
+                    text_compare_t **compare,
+                    const svn_io_dirent2_t **dirent,
+                    svn_wc__db_t *db,
+                    const char *local_abspath,
+                    svn_boolean_t exact_comparison,
+                    apr_pool_t *result_pool,
+                    apr_pool_t *scratch_pool)
 {
-  svn_stream_t *pristine_stream;
-  svn_filesize_t pristine_size;
   svn_wc__db_status_t status;
   svn_node_kind_t kind;
   const svn_checksum_t *checksum;
@@ -222,7 +327,8 @@ svn_wc__internal_file_modified_p(svn_boolean_t *modified_p,
   apr_time_t recorded_mod_time;
   svn_boolean_t has_props;
   svn_boolean_t props_mod;
-  const svn_io_dirent2_t *dirent;
+
+  *compare = NULL;
 
   /* Read the relevant info */
   SVN_ERR(svn_wc__db_read_info(&status, &kind, NULL, NULL, NULL, NULL, NULL,
@@ -245,10 +351,10 @@ svn_wc__internal_file_modified_p(svn_boolean_t *modified_p,
       return SVN_NO_ERROR;
     }
 
-  SVN_ERR(svn_io_stat_dirent2(&dirent, local_abspath, FALSE, TRUE,
-                              scratch_pool, scratch_pool));
+  SVN_ERR(svn_io_stat_dirent2(dirent, local_abspath, FALSE, TRUE,
+                              result_pool, scratch_pool));
 
-  if (dirent->kind != svn_node_file)
+  if ((*dirent)->kind != svn_node_file)
     {
       /* There is no file on disk, so the text is missing, not modified. */
       *modified_p = FALSE;
@@ -286,7 +392,7 @@ svn_wc__internal_file_modified_p(svn_boolean_t *modified_p,
 
       /* Compare the sizes, if applicable */
       if (recorded_size != SVN_INVALID_FILESIZE
-          && dirent->filesize != recorded_size)
+          && (*dirent)->filesize != recorded_size)
         goto compare_them;
 
       /* Compare the timestamps
@@ -294,7 +400,7 @@ svn_wc__internal_file_modified_p(svn_boolean_t *modified_p,
          Note: recorded_mod_time == 0 means not available,
                which also means the timestamps won't be equal,
                so there's no need to explicitly check the 'absent' value. */
-      if (recorded_mod_time != dirent->mtime)
+      if (recorded_mod_time != (*dirent)->mtime)
         goto compare_them;
 
       *modified_p = FALSE;
@@ -302,27 +408,31 @@ svn_wc__internal_file_modified_p(svn_boolean_t *modified_p,
     }
 
  compare_them:
-  SVN_ERR(svn_wc__db_pristine_read(&pristine_stream, &pristine_size,
-                                   db, local_abspath, checksum,
-                                   scratch_pool, scratch_pool));
+  return svn_error_trace(prepare_compare(compare, db, local_abspath,
+                                         (*dirent)->filesize, checksum,
+                                         has_props, props_mod,
+                                         exact_comparison,
+                                         result_pool, scratch_pool));
+}
+
+svn_error_t *
+svn_wc__internal_file_modified_p(svn_boolean_t *modified_p,
+                                 svn_wc__db_t *db,
+                                 const char *local_abspath,
+                                 svn_boolean_t exact_comparison,
+                                 apr_pool_t *scratch_pool)
+{
+  text_compare_t *compare;
+  const svn_io_dirent2_t *dirent;
+
+  SVN_ERR(check_file_modified(modified_p, &compare, &dirent, db,
+                              local_abspath, exact_comparison,
+                              scratch_pool, scratch_pool));
+  if (!compare)
+    return SVN_NO_ERROR;
 
   /* Check all bytes, and verify checksum if requested. */
-  {
-    svn_error_t *err;
-    err = compare_and_verify(modified_p, db,
-                             local_abspath, dirent->filesize,
-                             pristine_stream, pristine_size,
-                             has_props, props_mod,
-                             exact_comparison,
-                             scratch_pool);
-
-    /* At this point we already opened the pristine file, so we know that
-       the access denied applies to the working copy path */
-    if (err && APR_STATUS_IS_EACCES(err->apr_err))
-      return svn_error_create(SVN_ERR_WC_PATH_ACCESS_DENIED, err, NULL);
-    else
-      SVN_ERR(err);
-  }
+  SVN_ERR(compare_file(modified_p, compare, scratch_pool));
 
   if (!*modified_p)
     {
@@ -341,6 +451,285 @@ svn_wc__internal_file_modified_p(svn_boolean_t *modified_p,
   return SVN_NO_ERROR;
 }
 
+/* The files that svn_wc__internal_files_modified_p() compares with their
+   pristines, shared by all threads. */
+typedef struct compare_batch_t
+{
+  /* The text_compare_t * to process. */
+  apr_array_header_t *compares;
+
+  /* The results and errors, by index in COMPARES. */
+  svn_boolean_t *modified;
+  svn_error_t **errors;
+
+  /* The index of the next file to compare. */
+  svn_atomic_t next;
+
+  /* Set to stop all threads as soon as possible. */
+  svn_atomic_t abort;
+} compare_batch_t;
+
+/* Compare files from BATCH until there are no more or until BATCH gets
+   aborted.  Check for cancellation using CANCEL_FUNC / CANCEL_BATON
+   between files and abort BATCH if cancelled.  Use SCRATCH_POOL for
+   temporary allocations. */
+static svn_error_t *
+run_compares(compare_batch_t *batch,
+             svn_cancel_func_t cancel_func,
+             void *cancel_baton,
+             apr_pool_t *scratch_pool)
+{
+  apr_pool_t *iterpool = svn_pool_create(scratch_pool);
+
+  while (!svn_atomic_read(&batch->abort))
+    {
+      apr_uint32_t i = svn_atomic_inc(&batch->next);
+
+      if (i >= (apr_uint32_t)batch->compares->nelts)
+        break;
+
+      svn_pool_clear(iterpool);
+      batch->errors[i]
+        = compare_file(&batch->modified[i],
+                       APR_ARRAY_IDX(batch->compares, i, text_compare_t *),
+                       iterpool);
+
+      if (cancel_func)
+        {
+          svn_error_t *err = cancel_func(cancel_baton);
+          if (err)
+            {
+              svn_atomic_set(&batch->abort, TRUE);
+              svn_pool_destroy(iterpool);
+              return svn_error_trace(err);
+            }
+        }
+    }
+  svn_pool_destroy(iterpool);
+
+  return SVN_NO_ERROR;
+}
+
+#if APR_HAS_THREADS
+
+/* Thread function running run_compares() for the compare_batch_t
+   in BATON. */
+static void * APR_THREAD_FUNC
+compare_thread(apr_thread_t *thread,
+               void *baton)
+{
+  /* This thread must not use the pools of the calling thread. */
+  apr_pool_t *pool = apr_allocator_owner_get(svn_pool_create_allocator(FALSE));
+
+  svn_error_clear(run_compares(baton, NULL, NULL, pool));
+  svn_pool_destroy(pool);
+
+  /* End thread explicitly to prevent APR_INCOMPLETE return codes in
+     apr_thread_join(). */
+  apr_thread_exit(thread, APR_SUCCESS);
+  return NULL;
+}
+
+#endif /* APR_HAS_THREADS */
+
+/* Compare all files in BATCH, using up to THREAD_COUNT threads including
+   the calling one.  The other parameters are as for run_compares(). */
+static svn_error_t *
+compare_files(compare_batch_t *batch,
+              int thread_count,
+              svn_cancel_func_t cancel_func,
+              void *cancel_baton,
+              apr_pool_t *scratch_pool)
+{
+  svn_error_t *err = SVN_NO_ERROR;
+#if APR_HAS_THREADS
+  apr_thread_t **threads;
+  int started = 0;
+  int i;
+
+  thread_count = MIN(thread_count, batch->compares->nelts);
+  threads = apr_palloc(scratch_pool, thread_count * sizeof(*threads));
+  while (started < thread_count - 1)
+    {
+      apr_status_t status = apr_thread_create(&threads[started], NULL,
+                                              compare_thread, batch,
+                                              scratch_pool);
+      if (status)
+        {
+          /* Do without.  The threads we have will do all the work. */
+          break;
+        }
+
+      ++started;
+    }
+#endif
+
+  err = run_compares(batch, cancel_func, cancel_baton, scratch_pool);
+
+#if APR_HAS_THREADS
+  for (i = 0; i < started; ++i)
+    {
+      apr_status_t thread_status;
+      apr_status_t status = apr_thread_join(&thread_status, threads[i]);
+
+      if (status)
+        err = svn_error_compose_create(err,
+                svn_error_wrap_apr(status, _("Can't join thread")));
+    }
+#endif
+
+  return svn_error_trace(err);
+}
+
+/* Clear all errors that are still stored in BATCH. */
+static void
+clear_batch_errors(compare_batch_t *batch)
+{
+  int i;
+
+  for (i = 0; i < batch->compares->nelts; i++)
+    {
+      svn_error_clear(batch->errors[i]);
+      batch->errors[i] = SVN_NO_ERROR;
+    }
+}
+
+svn_error_t *
+svn_wc__internal_files_modified_p(apr_hash_t **modified,
+                                  svn_wc__db_t *db,
+                                  const apr_array_header_t *local_abspaths,
+                                  svn_cancel_func_t cancel_func,
+                                  void *cancel_baton,
+                                  apr_pool_t *result_pool,
+                                  apr_pool_t *scratch_pool)
+{
+  compare_batch_t batch;
+  apr_array_header_t *dirents;
+  apr_array_header_t *fileinfos;
+  apr_pool_t *iterpool;
+  svn_error_t *err;
+  int i;
+
+  *modified = apr_hash_make(result_pool);
+
+  batch.compares = apr_array_make(scratch_pool, local_abspaths->nelts,
+                                  sizeof(text_compare_t *));
+  dirents = apr_array_make(scratch_pool, local_abspaths->nelts,
+                           sizeof(const svn_io_dirent2_t *));
+
+  /* Read everything we need from the DB first.  Leave out the files for
+     which this fails; the caller will find out why when it checks them
+     with svn_wc__internal_file_modified_p(). */
+  iterpool = svn_pool_create(scratch_pool);
+  for (i = 0; i < local_abspaths->nelts; i++)
+    {
+      const char *local_abspath = APR_ARRAY_IDX(local_abspaths, i,
+                                                const char *);
+      text_compare_t *compare;
+      const svn_io_dirent2_t *dirent;
+      svn_boolean_t file_modified;
+
+      svn_pool_clear(iterpool);
+
+      if (cancel_func)
+        SVN_ERR(cancel_func(cancel_baton));
+
+      err = check_file_modified(&file_modified, &compare, &dirent, db,
+                                local_abspath, FALSE /* exact_comparison */,
+                                scratch_pool, iterpool);
+      if (err)
+        {
+          svn_error_clear(err);
+          continue;
+        }
+
+      if (compare)
+        {
+          APR_ARRAY_PUSH(batch.compares, text_compare_t *) = compare;
+          APR_ARRAY_PUSH(dirents, const svn_io_dirent2_t *) = dirent;
+        }
+      else
+        svn_hash_sets(*modified, apr_pstrdup(result_pool, local_abspath),
+                      apr_pmemdup(result_pool, &file_modified,
+                                  sizeof(file_modified)));
+    }
+  svn_pool_destroy(iterpool);
+
+  if (!batch.compares->nelts)
+    return SVN_NO_ERROR;
+
+  /* Compare the files without touching the DB. */
+  batch.modified = apr_pcalloc(scratch_pool,
+                               batch.compares->nelts
+                                 * sizeof(*batch.modified));
+  batch.errors = apr_pcalloc(scratch_pool,
+                             batch.compares->nelts * sizeof(*batch.errors));
+  svn_atomic_set(&batch.next, 0);
+  svn_atomic_set(&batch.abort, FALSE);
+
+  /* Files compared before a cancellation or error have their errors
+     stored in BATCH.  Don't leak them. */
+  err = compare_files(&batch, svn_wc__db_get_compare_threads(db),
+                      cancel_func, cancel_baton, scratch_pool);
+  if (err)
+    {
+      clear_batch_errors(&batch);
+      return svn_error_trace(err);
+    }
+
+  /* Collect the results and "repair" all timestamps in one go. */
+  fileinfos = apr_array_make(scratch_pool, batch.compares->nelts,
+                             sizeof(svn_wc__db_fileinfo_t));
+  for (i = 0; i < batch.compares->nelts; i++)
+    {
+      const text_compare_t *compare = APR_ARRAY_IDX(batch.compares, i,
+                                                    text_compare_t *);
+      const svn_io_dirent2_t *dirent = APR_ARRAY_IDX(dirents, i,
+                                                     const svn_io_dirent2_t *);
+      svn_boolean_t own_lock;
+
+      if (batch.errors[i])
+        {
+          svn_error_clear(batch.errors[i]);
+          batch.errors[i] = SVN_NO_ERROR;
+          continue;
+        }
+
+      svn_hash_sets(*modified,
+                    apr_pstrdup(result_pool, compare->local_abspath),
+                    apr_pmemdup(result_pool, &batch.modified[i],
+                                sizeof(batch.modified[i])));
+
+      if (batch.modified[i])
+        continue;
+
+      err = svn_wc__db_wclock_owns_lock(&own_lock, db,
+                                        compare->local_abspath, FALSE,
+                                        scratch_pool);
+      if (err)
+        {
+          clear_batch_errors(&batch);
+          return svn_error_trace(err);
+        }
+
+      if (own_lock)
+        {
+          svn_wc__db_fileinfo_t *fileinfo
+            = apr_array_push(fileinfos);
+
+          fileinfo->local_abspath = compare->local_abspath;
+          fileinfo->recorded_size = dirent->filesize;
+          fileinfo->recorded_time = dirent->mtime;
+        }
+    }
+
+  if (fileinfos->nelts)
+    SVN_ERR(svn_wc__db_global_record_fileinfos(db, fileinfos,
+                                               scratch_pool));
+
+  return SVN_NO_ERROR;
+}
+
 
 svn_error_t *
 svn_wc_text_modified_p2(svn_boolean_t *modified_p,
@@ -29,6 +29,11 @@
 #include <apr_pools.h>
 #include <apr_file_io.h>
 #include <apr_hash.h>
+#if APR_HAS_THREADS
+#include <apr_thread_cond.h>
+#include <apr_thread_mutex.h>
+#include <apr_thread_proc.h>
+#endif
 
 #include "svn_pools.h"
 #include "svn_types.h"
@@ -41,12 +46,15 @@
 #include "svn_time.h"
 #include "svn_hash.h"
 #include "svn_sorts.h"
+#include "svn_path.h"
 
 #include "svn_private_config.h"
 
 #include "wc.h"
 #include "props.h"
+#include "watcher.h"
 
+#include "private/svn_atomic.h"
 #include "private/svn_sorts_private.h"
 #include "private/svn_wc_private.h"
 #include "private/svn_fspath.h"
@@ -100,6 +108,10 @@ struct walk_status_baton
 
   /* Repository locks, if set. */
   apr_hash_t *repos_locks;
+
+  /* Directories being read ahead by other threads, or NULL if the walk
+     runs on a single thread. */
+  struct status_prefetch_t *prefetch;
 };
 
 /*** Editor batons ***/
@@ -333,6 +345,10 @@ internal_status(svn_wc__internal_status_t **status,
    returned to reflect that assumption. If CHECK_WORKING_COPY is FALSE,
    do not adjust the result for missing working copy files.
 
+   If KNOWN_TEXT_MOD is not NULL, it is the result of an earlier
+   svn_wc__internal_file_modified_p() call for LOCAL_ABSPATH that will be
+   used instead of comparing the file again.
+
    The status struct's repos_lock field will be set to REPOS_LOCK.
 */
 static svn_error_t *
@@ -347,6 +363,7 @@ assemble_status(svn_wc__internal_status_t **status,
                 svn_boolean_t get_all,
                 svn_boolean_t ignore_text_mods,
                 svn_boolean_t check_working_copy,
+                const svn_boolean_t *known_text_mod,
                 const svn_lock_t *repos_lock,
                 apr_pool_t *result_pool,
                 apr_pool_t *scratch_pool)
@@ -468,6 +485,27 @@ assemble_status(svn_wc__internal_status_t **status,
                      && info->recorded_size == dirent->filesize
                      && info->recorded_time == dirent->mtime))
             text_modified_p = FALSE;
+          else if (known_text_mod)
+            {
+              text_modified_p = *known_text_mod;
+
+              /* Repair the timestamp like svn_wc__internal_file_modified_p()
+                 would have, had it been called with DB. */
+              if (!text_modified_p && dirent)
+                {
+                  svn_boolean_t own_lock;
+
+                  SVN_ERR(svn_wc__db_wclock_owns_lock(&own_lock, db,
+                                                      local_abspath, FALSE,
+                                                      scratch_pool));
+                  if (own_lock)
+                    SVN_ERR(svn_wc__db_global_record_fileinfo(
+                                                      db, local_abspath,
+                                                      dirent->filesize,
+                                                      dirent->mtime,
+                                                      scratch_pool));
+                }
+            }
           else
             {
               svn_error_t *err;
@@ -796,6 +834,7 @@ send_status_structure(const struct walk_status_baton *wb,
                       const char *parent_repos_uuid,
                       const struct svn_wc__db_info_t *info,
                       const svn_io_dirent2_t *dirent,
+                      const svn_boolean_t *known_text_mod,
                       svn_boolean_t get_all,
                       svn_wc_status_func4_t status_func,
                       void *status_baton,
@@ -831,7 +870,8 @@ send_status_structure(const struct walk_status_baton *wb,
                           parent_repos_uuid,
                           info, dirent, get_all,
                           wb->ignore_text_mods, wb->check_working_copy,
-                          repos_lock, scratch_pool, scratch_pool));
+                          known_text_mod, repos_lock,
+                          scratch_pool, scratch_pool));
 
   if (statstruct && status_func)
     return svn_error_trace((*status_func)(status_baton, local_abspath,
@@ -1023,6 +1063,550 @@ send_unversioned_item(const struct walk_status_baton *wb,
   return SVN_NO_ERROR;
 }
 
+/* Parallel status walks.
+ *
+ * When the working copy is configured to use more than one status thread,
+ * svn_wc__internal_walk_status() starts worker threads that read ahead of
+ * the walk.  For every versioned directory that the walk is going to
+ * descend into, a worker reads the on-disk directory entries and the
+ * child node information from its own DB context, i.e. its own SQLite
+ * connection, and compares the working files whose recorded size or time
+ * doesn't match with their pristines.
+ *
+ * The calling thread still walks the tree in the usual order and invokes
+ * all callbacks.  get_dir_status() merely picks up the results that a
+ * worker prepared for the directory at hand and falls back to reading the
+ * directory itself if there are none.  Workers prefer directories that
+ * come first in walk order and may only run a limited number of
+ * directories ahead of the walk.
+ */
+
+/* State of a directory that the walk wants to read ahead. */
+typedef enum prefetch_state_t
+{
+  /* Waiting for a worker. */
+  prefetch_pending,
+
+  /* A worker is reading the directory. */
+  prefetch_running,
+
+  /* The worker is done.  The results are valid if NODES is not NULL. */
+  prefetch_done,
+
+  /* The walk has claimed the directory; no worker may touch it. */
+  prefetch_taken
+} prefetch_state_t;
+
+/* A directory that the walk wants to read ahead. */
+typedef struct prefetch_dir_t
+{
+  /* The directory.  Allocated in the shared pool, so that it remains
+     valid while the directory is in the queue. */
+  const char *local_abspath;
+
+  /* Only accessed while holding the mutex. */
+  prefetch_state_t state;
+
+  /* Root pool containing the results. */
+  apr_pool_t *pool;
+
+  /* The results, as get_dir_status() would have read them. */
+  apr_hash_t *dirents;
+  apr_hash_t *nodes;
+  apr_hash_t *conflicts;
+
+  /* Results of svn_wc__internal_file_modified_p() for child files,
+     mapping names to svn_boolean_t *. */
+  apr_hash_t *text_mods;
+} prefetch_dir_t;
+
+/* Return TRUE if get_dir_status() will descend into the node described
+   by INFO, which must be a child of a directory that is walked with depth
+   infinity.  This matches the conditions in one_child_status(). */
+static svn_boolean_t
+walk_descends_into(const struct svn_wc__db_info_t *info)
+{
+  return info->has_descendants
+         && info->status != svn_wc__db_status_not_present
+         && info->status != svn_wc__db_status_excluded
+         && info->status != svn_wc__db_status_server_excluded
+         && !(info->kind == svn_node_unknown
+              && info->status == svn_wc__db_status_normal);
+}
+
+/* Return TRUE if assemble_status() would call
+   svn_wc__internal_file_modified_p() for the versioned node INFO with the
+   on-disk DIRENT. */
+static svn_boolean_t
+needs_text_compare(const struct svn_wc__db_info_t *info,
+                   const svn_io_dirent2_t *dirent)
+{
+  if (info->kind != svn_node_file
+      || !info->has_checksum
+      || info->incomplete
+      || (info->status != svn_wc__db_status_normal
+          && info->status != svn_wc__db_status_added))
+    return FALSE;
+
+  if (!dirent || dirent->kind != svn_node_file)
+    return FALSE;
+
+#ifdef HAVE_SYMLINK
+  if (info->special != dirent->special)
+    return FALSE;
+#endif /* HAVE_SYMLINK */
+
+  return info->recorded_size == SVN_INVALID_FILESIZE
+         || info->recorded_time == 0
+         || info->recorded_size != dirent->filesize
+         || info->recorded_time != dirent->mtime;
+}
+
+/* Set *TEXT_MODS to a hash mapping the names of those children of the
+   directory DIR_ABSPATH in NODES that need a text comparison according to
+   needs_text_compare() and DIRENTS to whether they are modified, using
+   svn_wc__internal_files_modified_p().  Children for which that fails are
+   left out.  Allocate the result in RESULT_POOL. */
+static svn_error_t *
+compare_child_files(apr_hash_t **text_mods,
+                    svn_wc__db_t *db,
+                    const char *dir_abspath,
+                    apr_hash_t *nodes,
+                    apr_hash_t *dirents,
+                    svn_cancel_func_t cancel_func,
+                    void *cancel_baton,
+                    apr_pool_t *result_pool,
+                    apr_pool_t *scratch_pool)
+{
+  apr_array_header_t *local_abspaths;
+  apr_hash_t *modified;
+  apr_hash_index_t *hi;
+
+  *text_mods = apr_hash_make(result_pool);
+
+  local_abspaths = apr_array_make(scratch_pool, 0, sizeof(const char *));
+  for (hi = apr_hash_first(scratch_pool, nodes); hi; hi = apr_hash_next(hi))
+    {
+      const char *name = apr_hash_this_key(hi);
+
+      if (needs_text_compare(apr_hash_this_val(hi),
+                             svn_hash_gets(dirents, name)))
+        APR_ARRAY_PUSH(local_abspaths, const char *)
+          = svn_dirent_join(dir_abspath, name, scratch_pool);
+    }
+
+  if (!local_abspaths->nelts)
+    return SVN_NO_ERROR;
+
+  SVN_ERR(svn_wc__internal_files_modified_p(&modified, db, local_abspaths,
+                                            cancel_func, cancel_baton,
+                                            scratch_pool, scratch_pool));
+
+  for (hi = apr_hash_first(scratch_pool, modified); hi;
+       hi = apr_hash_next(hi))
+    svn_hash_sets(*text_mods,
+                  apr_pstrdup(result_pool,
+                              svn_dirent_basename(apr_hash_this_key(hi),
+                                                  NULL)),
+                  apr_pmemdup(result_pool, apr_hash_this_val(hi),
+                              sizeof(svn_boolean_t)));
+
+  return SVN_NO_ERROR;
+}
+
+#if APR_HAS_THREADS
+
+/* Maximum number of directories per thread that may be queued or read
+   ahead of the walk at any time. */
+#define PREFETCH_DIRS_PER_THREAD 16
+
+/* Interval in microseconds in which the calling thread checks for
+   cancellation while waiting for a worker. */
+#define PREFETCH_POLL_INTERVAL (100 * 1000)
+
+/* A worker thread. */
+typedef struct prefetch_thread_t
+{
+  /* The shared state. */
+  struct status_prefetch_t *prefetch;
+
+  /* Our own DB context, allocated in POOL. */
+  svn_wc__db_t *db;
+
+  /* Root pool used exclusively by this thread once it got started. */
+  apr_pool_t *pool;
+
+  apr_thread_t *thread;
+} prefetch_thread_t;
+
+/* Shared state of the read-ahead threads of a status walk. */
+typedef struct status_prefetch_t
+{
+  /* Copied from the walk_status_baton. */
+  svn_boolean_t ignore_text_mods;
+
+  /* Protects all of the following members.  CHANGED gets signalled
+     whenever any of them or the state of any directory changes. */
+  apr_thread_mutex_t *mutex;
+  apr_thread_cond_t *changed;
+
+  /* Root pool for the directory queue. */
+  apr_pool_t *pool;
+
+  /* All directories that the walk has not finished yet, mapping their
+     paths to prefetch_dir_t *. */
+  apr_hash_t *dirs;
+
+  /* The pending directories in DIRS, first in walk order first.  May also
+     contain directories that the walk has already taken. */
+  svn_priority_queue__t *queue;
+
+  /* Don't queue new directories while DIRS contains this many entries. */
+  unsigned int max_dirs;
+
+  /* Set to stop all workers as soon as possible. */
+  svn_atomic_t abort;
+
+  prefetch_thread_t *threads;
+  int thread_count;
+} status_prefetch_t;
+
+/* Compare the prefetch_dir_t * at LHS and RHS for the priority queue,
+   such that the directory that comes first in walk order comes first. */
+static int
+compare_prefetch_dirs(const void *lhs,
+                      const void *rhs)
+{
+  const prefetch_dir_t *lhs_dir = *(const prefetch_dir_t * const *)lhs;
+  const prefetch_dir_t *rhs_dir = *(const prefetch_dir_t * const *)rhs;
+
+  return svn_path_compare_paths(lhs_dir->local_abspath,
+                                rhs_dir->local_abspath);
+}
+
+/* Queue those children of DIR_ABSPATH in NODES that the walk will descend
+   into and that are not queued yet.  The caller must hold the mutex of
+   PREFETCH.  Use SCRATCH_POOL for temporary allocations. */
+static void
+prefetch_queue_children(status_prefetch_t *prefetch,
+                        const char *dir_abspath,
+                        apr_hash_t *nodes,
+                        apr_pool_t *scratch_pool)
+{
+  apr_hash_index_t *hi;
+  svn_boolean_t queued = FALSE;
+
+  for (hi = apr_hash_first(scratch_pool, nodes); hi; hi = apr_hash_next(hi))
+    {
+      const struct svn_wc__db_info_t *info = apr_hash_this_val(hi);
+      const char *local_abspath;
+      prefetch_dir_t *dir;
+
+      if (apr_hash_count(prefetch->dirs) >= prefetch->max_dirs)
+        break;
+
+      if (!walk_descends_into(info))
+        continue;
+
+      local_abspath = svn_dirent_join(dir_abspath, apr_hash_this_key(hi),
+                                      scratch_pool);
+      if (svn_hash_gets(prefetch->dirs, local_abspath))
+        continue;
+
+      dir = apr_pcalloc(prefetch->pool, sizeof(*dir));
+      dir->local_abspath = apr_pstrdup(prefetch->pool, local_abspath);
+      dir->state = prefetch_pending;
+      dir->pool = apr_allocator_owner_get(svn_pool_create_allocator(FALSE));
+
+      svn_hash_sets(prefetch->dirs, dir->local_abspath, dir);
+      svn_priority_queue__push(prefetch->queue, &dir);
+      queued = TRUE;
+    }
+
+  if (queued)
+    apr_thread_cond_broadcast(prefetch->changed);
+}
+
+/* Implements svn_cancel_func_t.  Stop once the status_prefetch_t in
+   BATON gets aborted. */
+static svn_error_t *
+prefetch_cancel(void *baton)
+{
+  status_prefetch_t *prefetch = baton;
+
+  if (svn_atomic_read(&prefetch->abort))
+    return svn_error_create(SVN_ERR_CANCELLED, NULL, NULL);
+
+  return SVN_NO_ERROR;
+}
+
+/* Read DIR like get_dir_status() would, using DB, and store the results
+   in DIR.  Compare all working files whose text status can't be derived
+   from their recorded size and time with their pristines.  Leave
+   DIR->NODES at NULL in case of an error.  Use SCRATCH_POOL for temporary
+   allocations. */
+static svn_error_t *
+prefetch_read_dir(prefetch_dir_t *dir,
+                  status_prefetch_t *prefetch,
+                  svn_wc__db_t *db,
+                  apr_pool_t *scratch_pool)
+{
+  apr_hash_t *dirents, *nodes, *conflicts, *text_mods;
+  svn_error_t *err;
+
+  err = svn_io_get_dirents3(&dirents, dir->local_abspath,
+                            prefetch->ignore_text_mods /* only_check_type */,
+                            dir->pool, scratch_pool);
+  if (err
+      && (APR_STATUS_IS_ENOENT(err->apr_err)
+          || SVN__APR_STATUS_IS_ENOTDIR(err->apr_err)))
+    {
+      svn_error_clear(err);
+      dirents = apr_hash_make(dir->pool);
+    }
+  else
+    SVN_ERR(err);
+
+  SVN_ERR(svn_wc__db_read_children_info(&nodes, &conflicts,
+                                        db, dir->local_abspath,
+                                        FALSE /* base_tree_only */,
+                                        dir->pool, scratch_pool));
+
+  if (!prefetch->ignore_text_mods)
+    SVN_ERR(compare_child_files(&text_mods, db, dir->local_abspath,
+                                nodes, dirents, prefetch_cancel, prefetch,
+                                dir->pool, scratch_pool));
+  else
+    text_mods = apr_hash_make(dir->pool);
+
+  dir->dirents = dirents;
+  dir->conflicts = conflicts;
+  dir->text_mods = text_mods;
+  dir->nodes = nodes;
+
+  return SVN_NO_ERROR;
+}
+
+/* Thread function reading directories from the queue of the
+   status_prefetch_t in the prefetch_thread_t BATON. */
+static void * APR_THREAD_FUNC
+prefetch_thread(apr_thread_t *thread,
+                void *baton)
+{
+  prefetch_thread_t *worker = baton;
+  status_prefetch_t *prefetch = worker->prefetch;
+  apr_pool_t *iterpool = svn_pool_create(worker->pool);
+
+  apr_thread_mutex_lock(prefetch->mutex);
+  while (!svn_atomic_read(&prefetch->abort))
+    {
+      prefetch_dir_t *dir;
+
+      if (svn_priority_queue__size(prefetch->queue) == 0)
+        {
+          apr_thread_cond_wait(prefetch->changed, prefetch->mutex);
+          continue;
+        }
+
+      dir = *(prefetch_dir_t **)svn_priority_queue__peek(prefetch->queue);
+      svn_priority_queue__pop(prefetch->queue);
+      if (dir->state != prefetch_pending)
+        continue;
+
+      dir->state = prefetch_running;
+      apr_thread_mutex_unlock(prefetch->mutex);
+
+      svn_pool_clear(iterpool);
+      svn_error_clear(prefetch_read_dir(dir, prefetch, worker->db,
+                                        iterpool));
+
+      apr_thread_mutex_lock(prefetch->mutex);
+      dir->state = prefetch_done;
+      if (dir->nodes)
+        prefetch_queue_children(prefetch, dir->local_abspath, dir->nodes,
+                                iterpool);
+      apr_thread_cond_broadcast(prefetch->changed);
+    }
+  apr_thread_mutex_unlock(prefetch->mutex);
+
+  svn_pool_destroy(iterpool);
+
+  /* End thread explicitly to prevent APR_INCOMPLETE return codes in
+     apr_thread_join(). */
+  apr_thread_exit(thread, APR_SUCCESS);
+  return NULL;
+}
+
+/* Claim LOCAL_ABSPATH for the walk and return its read-ahead state in
+   *DIR, or NULL if it has not been queued.  If a worker is still reading
+   it, wait for the results while checking for cancellation using
+   CANCEL_FUNC / CANCEL_BATON. */
+static svn_error_t *
+prefetch_claim(prefetch_dir_t **dir,
+               status_prefetch_t *prefetch,
+               const char *local_abspath,
+               svn_cancel_func_t cancel_func,
+               void *cancel_baton)
+{
+  svn_error_t *err = SVN_NO_ERROR;
+
+  apr_thread_mutex_lock(prefetch->mutex);
+  *dir = svn_hash_gets(prefetch->dirs, local_abspath);
+  while (!err && *dir && (*dir)->state == prefetch_running)
+    {
+      apr_thread_mutex_unlock(prefetch->mutex);
+      if (cancel_func)
+        err = cancel_func(cancel_baton);
+      apr_thread_mutex_lock(prefetch->mutex);
+
+      if (!err && (*dir)->state == prefetch_running)
+        apr_thread_cond_timedwait(prefetch->changed, prefetch->mutex,
+                                  PREFETCH_POLL_INTERVAL);
+    }
+
+  /* A pending directory simply won't have any results. */
+  if (!err && *dir)
+    (*dir)->state = prefetch_taken;
+  apr_thread_mutex_unlock(prefetch->mutex);
+
+  return svn_error_trace(err);
+}
+
+/* Queue the children of LOCAL_ABSPATH in NODES for reading ahead.  Use
+   SCRATCH_POOL for temporary allocations. */
+static void
+prefetch_queue(status_prefetch_t *prefetch,
+               const char *local_abspath,
+               apr_hash_t *nodes,
+               apr_pool_t *scratch_pool)
+{
+  apr_thread_mutex_lock(prefetch->mutex);
+  prefetch_queue_children(prefetch, local_abspath, nodes, scratch_pool);
+  apr_thread_mutex_unlock(prefetch->mutex);
+}
+
+/* Forget about DIR, which the walk has claimed and is done with. */
+static void
+prefetch_release(status_prefetch_t *prefetch,
+                 prefetch_dir_t *dir)
+{
+  apr_thread_mutex_lock(prefetch->mutex);
+  svn_hash_sets(prefetch->dirs, dir->local_abspath, NULL);
+  apr_thread_mutex_unlock(prefetch->mutex);
+
+  svn_pool_destroy(dir->pool);
+  dir->pool = NULL;
+}
+
+/* Start THREAD_COUNT threads reading ahead of the status walk described
+   by WB and return their shared state in *PREFETCH.  Allocate the result
+   in RESULT_POOL.  The threads must be stopped with prefetch_stop() before
+   RESULT_POOL gets cleaned up. */
+static svn_error_t *
+prefetch_start(status_prefetch_t **prefetch,
+               const struct walk_status_baton *wb,
+               int thread_count,
+               apr_pool_t *result_pool)
+{
+  status_prefetch_t *new_prefetch = apr_pcalloc(result_pool,
+                                                sizeof(*new_prefetch));
+  apr_status_t status;
+  svn_error_t *err = SVN_NO_ERROR;
+
+  new_prefetch->ignore_text_mods = wb->ignore_text_mods;
+  new_prefetch->max_dirs = thread_count * PREFETCH_DIRS_PER_THREAD;
+  svn_atomic_set(&new_prefetch->abort, FALSE);
+
+  status = apr_thread_mutex_create(&new_prefetch->mutex,
+                                   APR_THREAD_MUTEX_DEFAULT, result_pool);
+  if (status)
+    return svn_error_wrap_apr(status, _("Can't create mutex"));
+
+  status = apr_thread_cond_create(&new_prefetch->changed, result_pool);
+  if (status)
+    return svn_error_wrap_apr(status, _("Can't create condition variable"));
+
+  /* Workers allocate from this pool as well, so it needs its own
+     allocator.  It is only used while holding the mutex. */
+  new_prefetch->pool
+    = apr_allocator_owner_get(svn_pool_create_allocator(FALSE));
+  new_prefetch->dirs = apr_hash_make(new_prefetch->pool);
+  new_prefetch->queue
+    = svn_priority_queue__create(
+        apr_array_make(new_prefetch->pool, new_prefetch->max_dirs,
+                       sizeof(prefetch_dir_t *)),
+        compare_prefetch_dirs);
+
+  new_prefetch->threads
+    = apr_pcalloc(result_pool, thread_count * sizeof(prefetch_thread_t));
+  while (!err && new_prefetch->thread_count < thread_count)
+    {
+      prefetch_thread_t *worker
+        = &new_prefetch->threads[new_prefetch->thread_count];
+
+      worker->prefetch = new_prefetch;
+      worker->pool = apr_allocator_owner_get(svn_pool_create_allocator(FALSE));
+      err = svn_wc__db_open_reader(&worker->db, wb->db, worker->pool,
+                                   worker->pool);
+      if (!err)
+        {
+          status = apr_thread_create(&worker->thread, NULL, prefetch_thread,
+                                     worker, result_pool);
+          if (status)
+            err = svn_error_wrap_apr(status, _("Can't create thread"));
+        }
+
+      if (err)
+        svn_pool_destroy(worker->pool);
+      else
+        ++new_prefetch->thread_count;
+    }
+
+  *prefetch = new_prefetch;
+
+  return svn_error_trace(err);
+}
+
+/* Stop and join all threads of PREFETCH and release all resources. */
+static svn_error_t *
+prefetch_stop(status_prefetch_t *prefetch)
+{
+  svn_error_t *err = SVN_NO_ERROR;
+  apr_hash_index_t *hi;
+  int i;
+
+  apr_thread_mutex_lock(prefetch->mutex);
+  svn_atomic_set(&prefetch->abort, TRUE);
+  apr_thread_cond_broadcast(prefetch->changed);
+  apr_thread_mutex_unlock(prefetch->mutex);
+
+  for (i = 0; i < prefetch->thread_count; ++i)
+    {
+      apr_status_t thread_status;
+      apr_status_t status = apr_thread_join(&thread_status,
+                                            prefetch->threads[i].thread);
+      if (status)
+        err = svn_error_compose_create(err,
+                svn_error_wrap_apr(status, _("Can't join thread")));
+      else
+        svn_pool_destroy(prefetch->threads[i].pool);
+    }
+
+  /* Discard whatever the walk did not get to, e.g. due to an error. */
+  for (hi = apr_hash_first(NULL, prefetch->dirs); hi; hi = apr_hash_next(hi))
+    {
+      prefetch_dir_t *dir = apr_hash_this_val(hi);
+      if (dir->pool)
+        svn_pool_destroy(dir->pool);
+    }
+
+  svn_pool_destroy(prefetch->pool);
+
+  return svn_error_trace(err);
+}
+
+#endif /* APR_HAS_THREADS */
+
 static svn_error_t *
 get_dir_status(const struct walk_status_baton *wb,
                const char *local_abspath,
@@ -1059,6 +1643,8 @@ get_dir_status(const struct walk_status_baton *wb,
  *
  * DIRENT should reflect LOCAL_ABSPATH's dirent information.
  *
+ * KNOWN_TEXT_MOD is passed on to assemble_status().
+ *
  * DIR_REPOS_* should reflect LOCAL_ABSPATH's parent URL, i.e. LOCAL_ABSPATH's
  * URL treated with svn_uri_dirname(). ### TODO verify this (externals)
  *
@@ -1079,6 +1665,7 @@ one_child_status(const struct walk_status_baton *wb,
                  const char *parent_abspath,
                  const struct svn_wc__db_info_t *info,
                  const svn_io_dirent2_t *dirent,
+                 const svn_boolean_t *known_text_mod,
                  const char *dir_repos_root_url,
                  const char *dir_repos_relpath,
                  const char *dir_repos_uuid,
@@ -1115,7 +1702,7 @@ one_child_status(const struct walk_status_baton *wb,
                                     dir_repos_root_url,
                                     dir_repos_relpath,
                                     dir_repos_uuid,
-                                    info, dirent, get_all,
+                                    info, dirent, known_text_mod, get_all,
                                     status_func, status_baton,
                                     scratch_pool));
 
@@ -1231,8 +1818,10 @@ get_dir_status(const struct walk_status_baton *wb,
   const char *dir_repos_relpath;
   const char *dir_repos_uuid;
   apr_hash_t *dirents, *nodes, *conflicts, *all_children;
+  apr_hash_t *text_mods = NULL;
   apr_array_header_t *sorted_children;
   apr_array_header_t *collected_ignore_patterns = NULL;
+  prefetch_dir_t *prefetched = NULL;
   apr_pool_t *iterpool;
   svn_error_t *err;
   int i;
@@ -1243,9 +1832,19 @@ get_dir_status(const struct walk_status_baton *wb,
   if (depth == svn_depth_unknown)
     depth = svn_depth_infinity;
 
+#if APR_HAS_THREADS
+  if (wb->prefetch)
+    SVN_ERR(prefetch_claim(&prefetched, wb->prefetch, local_abspath,
+                           cancel_func, cancel_baton));
+#endif
+
   iterpool = svn_pool_create(scratch_pool);
 
-  if (wb->check_working_copy)
+  if (prefetched && prefetched->nodes)
+    {
+      dirents = prefetched->dirents;
+    }
+  else if (wb->check_working_copy)
     {
       err = svn_io_get_dirents3(&dirents, local_abspath,
                                 wb->ignore_text_mods /* only_check_type*/,
@@ -1278,10 +1877,22 @@ get_dir_status(const struct walk_status_baton *wb,
   /* Create a hash containing all children.  The source hashes
      don't all map the same types, but only the keys of the result
      hash are subsequently used. */
-  SVN_ERR(svn_wc__db_read_children_info(&nodes, &conflicts,
-                                        wb->db, local_abspath,
-                                        !wb->check_working_copy,
-                                        scratch_pool, iterpool));
+  if (prefetched && prefetched->nodes)
+    {
+      nodes = prefetched->nodes;
+      conflicts = prefetched->conflicts;
+    }
+  else
+    SVN_ERR(svn_wc__db_read_children_info(&nodes, &conflicts,
+                                          wb->db, local_abspath,
+                                          !wb->check_working_copy,
+                                          scratch_pool, iterpool));
+
+#if APR_HAS_THREADS
+  /* Let the workers read ahead in the subdirectories. */
+  if (wb->prefetch && depth == svn_depth_infinity)
+    prefetch_queue(wb->prefetch, local_abspath, nodes, iterpool);
+#endif
 
   all_children = apr_hash_overlay(scratch_pool, nodes, dirents);
   if (apr_hash_count(conflicts) > 0)
@@ -1318,7 +1929,8 @@ get_dir_status(const struct walk_status_baton *wb,
                                         parent_repos_root_url,
                                         parent_repos_relpath,
                                         parent_repos_uuid,
-                                        dir_info, this_dirent, get_all,
+                                        dir_info, this_dirent, NULL,
+                                        get_all,
                                         status_func, status_baton,
                                         iterpool));
         }
@@ -1327,14 +1939,29 @@ get_dir_status(const struct walk_status_baton *wb,
                                       parent_repos_root_url,
                                       parent_repos_relpath,
                                       parent_repos_uuid,
-                                      dir_info, dirent, get_all,
+                                      dir_info, dirent, NULL, get_all,
                                       status_func, status_baton,
                                       iterpool));
     }
 
   /* If the requested depth is empty, we only need status on this-dir. */
   if (depth == svn_depth_empty)
-    return SVN_NO_ERROR;
+    {
+#if APR_HAS_THREADS
+      if (prefetched)
+        prefetch_release(wb->prefetch, prefetched);
+#endif
+      return SVN_NO_ERROR;
+    }
+
+  /* Compare the files that may be modified in one go, unless a worker
+     already did. */
+  if (prefetched && prefetched->nodes)
+    text_mods = prefetched->text_mods;
+  else if (wb->check_working_copy && !wb->ignore_text_mods)
+    SVN_ERR(compare_child_files(&text_mods, wb->db, local_abspath,
+                                nodes, dirents, cancel_func, cancel_baton,
+                                scratch_pool, iterpool));
 
   /* Walk all the children of this directory. */
   sorted_children = svn_sort__hash(all_children,
@@ -1348,6 +1975,7 @@ get_dir_status(const struct walk_status_baton *wb,
       const char *child_abspath;
       svn_io_dirent2_t *child_dirent;
       const struct svn_wc__db_info_t *child_info;
+      const svn_boolean_t *known_text_mod = NULL;
 
       svn_pool_clear(iterpool);
 
@@ -1358,12 +1986,15 @@ get_dir_status(const struct walk_status_baton *wb,
       child_abspath = svn_dirent_join(local_abspath, key, iterpool);
       child_dirent = apr_hash_get(dirents, key, klen);
       child_info = apr_hash_get(nodes, key, klen);
+      if (text_mods)
+        known_text_mod = apr_hash_get(text_mods, key, klen);
 
       SVN_ERR(one_child_status(wb,
                                child_abspath,
                                local_abspath,
                                child_info,
                                child_dirent,
+                               known_text_mod,
                                dir_repos_root_url,
                                dir_repos_relpath,
                                dir_repos_uuid,
@@ -1383,6 +2014,10 @@ get_dir_status(const struct walk_status_baton *wb,
 
   /* Destroy our subpools. */
   svn_pool_destroy(iterpool);
+#if APR_HAS_THREADS
+  if (prefetched)
+    prefetch_release(wb->prefetch, prefetched);
+#endif
 
   return SVN_NO_ERROR;
 }
@@ -1448,6 +2083,7 @@ get_child_status(const struct walk_status_baton *wb,
                            parent_abspath,
                            info,
                            dirent,
+                           NULL /* known_text_mod */,
                            dir_repos_root_url,
                            dir_repos_relpath,
                            dir_repos_uuid,
@@ -2513,6 +3149,7 @@ svn_wc__get_status_editor(const svn_delta_editor_t **editor,
   eb->wb.check_working_copy = check_working_copy;
   eb->wb.repos_locks      = NULL;
   eb->wb.repos_root       = NULL;
+  eb->wb.prefetch         = NULL;
 
   SVN_ERR(svn_wc__db_externals_defined_below(&eb->wb.externals,
                                              wc_ctx->db, eb->target_abspath,
@@ -2592,6 +3229,330 @@ svn_wc__get_status_editor(const svn_delta_editor_t **editor,
   return SVN_NO_ERROR;
 }
 
+/* Status walks driven by the change journal of svn-wc-watcher.
+ *
+ * While svn-wc-watcher runs for a working copy, it records every path
+ * below the working copy root that changed on disk since its session
+ * started.  The first status walk in a session walks the whole working
+ * copy once and stores the paths whose status wasn't 'normal' then in a
+ * baseline file.  A node that is neither in the baseline nor in the
+ * journal and whose status doesn't depend on the DB alone (see
+ * svn_wc__db_read_status_candidates) still has the 'normal' status, so
+ * further walks only look at the remaining candidates.  This only applies
+ * to walks that don't report unmodified nodes.
+ */
+
+/* A directory that contains candidates of walk_changed_status(). */
+typedef struct changed_dir_t
+{
+  /* Whether the complete walk would descend into this directory.  If
+     not, none of the other fields is set. */
+  svn_boolean_t walked;
+
+  const char *repos_root_url;
+  const char *repos_relpath;
+  const char *repos_uuid;
+
+  /* The children, as returned by svn_wc__db_read_children_info(). */
+  apr_hash_t *nodes;
+  apr_hash_t *conflicts;
+
+  /* Passed to one_child_status(). */
+  apr_array_header_t *collected_ignore_patterns;
+} changed_dir_t;
+
+/* Set *DIR to the information on the directory DIR_ABSPATH, which must
+   be the target of WB or one of its descendants, from the cache DIRS,
+   reading it first if necessary.  TARGET_INFO is the information on the
+   target of WB.  Allocate the results in RESULT_POOL. */
+static svn_error_t *
+get_changed_dir(changed_dir_t **dir,
+                apr_hash_t *dirs,
+                const struct walk_status_baton *wb,
+                const char *dir_abspath,
+                const struct svn_wc__db_info_t *target_info,
+                apr_pool_t *result_pool,
+                apr_pool_t *scratch_pool)
+{
+  const struct svn_wc__db_info_t *info;
+  changed_dir_t *parent = NULL;
+  changed_dir_t *result;
+
+  result = svn_hash_gets(dirs, dir_abspath);
+  if (result)
+    {
+      *dir = result;
+      return SVN_NO_ERROR;
+    }
+
+  if (strcmp(dir_abspath, wb->target_abspath) == 0)
+    {
+      info = target_info;
+    }
+  else
+    {
+      SVN_ERR(get_changed_dir(&parent, dirs, wb,
+                              svn_dirent_dirname(dir_abspath, scratch_pool),
+                              target_info, result_pool, scratch_pool));
+      info = parent->walked
+               ? svn_hash_gets(parent->nodes,
+                               svn_dirent_basename(dir_abspath, NULL))
+               : NULL;
+      if (info && !walk_descends_into(info))
+        info = NULL;
+    }
+
+  result = apr_pcalloc(result_pool, sizeof(*result));
+  if (info)
+    {
+      result->walked = TRUE;
+      SVN_ERR(get_repos_root_url_relpath(&result->repos_relpath,
+                                         &result->repos_root_url,
+                                         &result->repos_uuid, info,
+                                         parent ? parent->repos_relpath
+                                                : NULL,
+                                         parent ? parent->repos_root_url
+                                                : NULL,
+                                         parent ? parent->repos_uuid
+                                                : NULL,
+                                         wb->db, dir_abspath,
+                                         result_pool, scratch_pool));
+      SVN_ERR(svn_wc__db_read_children_info(&result->nodes,
+                                            &result->conflicts,
+                                            wb->db, dir_abspath,
+                                            FALSE /* base_tree_only */,
+                                            result_pool, scratch_pool));
+    }
+
+  svn_hash_sets(dirs, apr_pstrdup(result_pool, dir_abspath), result);
+  *dir = result;
+
+  return SVN_NO_ERROR;
+}
+
+/* Baton for record_baseline_status(). */
+typedef struct baseline_baton_t
+{
+  const char *wcroot_abspath;
+
+  /* The recorded relpaths, allocated in the pool of this array. */
+  apr_array_header_t *relpaths;
+} baseline_baton_t;
+
+/* Implements svn_wc_status_func4_t.  Record every path below the working
+   copy root in the baseline_baton_t BATON. */
+static svn_error_t *
+record_baseline_status(void *baton,
+                       const char *local_abspath,
+                       const svn_wc_status3_t *status,
+                       apr_pool_t *scratch_pool)
+{
+  baseline_baton_t *bb = baton;
+  const char *relpath = svn_dirent_skip_ancestor(bb->wcroot_abspath,
+                                                 local_abspath);
+
+  if (relpath && *relpath)
+    APR_ARRAY_PUSH(bb->relpaths, const char *)
+      = apr_pstrdup(bb->relpaths->pool, relpath);
+
+  return SVN_NO_ERROR;
+}
+
+/* Walk the versioned directory WB->TARGET_ABSPATH, described by DIR_INFO
+   and DIRENT, with depth infinity like get_dir_status() would do when not
+   reporting unmodified nodes, but only look at the nodes that may have
+   changed according to the journal of the svn-wc-watcher of its working
+   copy.  Set *HANDLED to FALSE without reporting anything if there is no
+   usable journal.
+
+   The other parameters correspond to get_dir_status(). */
+static svn_error_t *
+walk_changed_status(svn_boolean_t *handled,
+                    const struct walk_status_baton *wb,
+                    const struct svn_wc__db_info_t *dir_info,
+                    const svn_io_dirent2_t *dirent,
+                    const apr_array_header_t *ignore_patterns,
+                    svn_boolean_t no_ignore,
+                    svn_wc_status_func4_t status_func,
+                    void *status_baton,
+                    svn_cancel_func_t cancel_func,
+                    void *cancel_baton,
+                    apr_pool_t *scratch_pool)
+{
+  const char *local_abspath = wb->target_abspath;
+  const char *wcroot_abspath;
+  svn_wc__watcher_journal_t *journal;
+  apr_array_header_t *baseline;
+  apr_hash_t *candidates;
+  apr_hash_t *journaled;
+  apr_hash_t *dirs;
+  apr_array_header_t *sorted_candidates;
+  const char *recursed_abspath = NULL;
+  apr_pool_t *iterpool;
+  int i;
+
+  *handled = FALSE;
+
+  SVN_ERR(svn_wc__db_get_wcroot(&wcroot_abspath, wb->db, local_abspath,
+                                scratch_pool, scratch_pool));
+  SVN_ERR(svn_wc__watcher_read_journal(&journal, wcroot_abspath,
+                                       scratch_pool, scratch_pool));
+  if (!journal)
+    return SVN_NO_ERROR;
+
+  SVN_ERR(svn_wc__watcher_read_baseline(&baseline, wcroot_abspath,
+                                        journal->session,
+                                        scratch_pool, scratch_pool));
+  if (!baseline)
+    {
+      struct walk_status_baton baseline_wb = *wb;
+      baseline_baton_t bb;
+      svn_wc__watcher_journal_t *new_journal;
+      svn_error_t *err;
+
+      /* Only a walk of the whole working copy can create the baseline. */
+      if (strcmp(local_abspath, wcroot_abspath) != 0)
+        return SVN_NO_ERROR;
+
+      bb.wcroot_abspath = wcroot_abspath;
+      bb.relpaths = apr_array_make(scratch_pool, 16, sizeof(const char *));
+      baseline_wb.ignore_text_mods = FALSE;
+
+      SVN_ERR(get_dir_status(&baseline_wb, local_abspath, TRUE,
+                             NULL, NULL, NULL, dir_info, NULL,
+                             ignore_patterns, svn_depth_infinity,
+                             FALSE /* get_all */, TRUE /* no_ignore */,
+                             record_baseline_status, &bb,
+                             cancel_func, cancel_baton, scratch_pool));
+
+      /* The baseline is only valid if the session covers the whole walk. */
+      SVN_ERR(svn_wc__watcher_read_journal(&new_journal, wcroot_abspath,
+                                           scratch_pool, scratch_pool));
+      if (!new_journal || strcmp(new_journal->session, journal->session))
+        return SVN_NO_ERROR;
+
+      /* Not being able to store the baseline only costs performance. */
+      err = svn_wc__watcher_write_baseline(wcroot_abspath, journal->session,
+                                           bb.relpaths, scratch_pool);
+      svn_error_clear(err);
+
+      journal = new_journal;
+      baseline = bb.relpaths;
+    }
+
+  /* Anything that changed at or above the target may have replaced the
+     whole tree. */
+  journaled = apr_hash_make(scratch_pool);
+  for (i = 0; i < journal->changed->nelts; i++)
+    {
+      const char *changed_abspath
+        = svn_dirent_join(wcroot_abspath,
+                          APR_ARRAY_IDX(journal->changed, i, const char *),
+                          scratch_pool);
+
+      if (svn_dirent_is_ancestor(changed_abspath, local_abspath))
+        return SVN_NO_ERROR;
+
+      if (svn_dirent_is_child(local_abspath, changed_abspath, NULL))
+        svn_hash_sets(journaled, changed_abspath, changed_abspath);
+    }
+
+  SVN_ERR(svn_wc__db_read_status_candidates(&candidates, wb->db,
+                                            local_abspath,
+                                            scratch_pool, scratch_pool));
+  candidates = apr_hash_overlay(scratch_pool, journaled, candidates);
+  for (i = 0; i < baseline->nelts; i++)
+    {
+      const char *baseline_abspath
+        = svn_dirent_join(wcroot_abspath,
+                          APR_ARRAY_IDX(baseline, i, const char *),
+                          scratch_pool);
+
+      if (svn_dirent_is_child(local_abspath, baseline_abspath, NULL))
+        svn_hash_sets(candidates, baseline_abspath, baseline_abspath);
+    }
+
+  *handled = TRUE;
+
+  /* Handle "this-dir" first. */
+  SVN_ERR(get_dir_status(wb, local_abspath, FALSE, NULL, NULL, NULL,
+                         dir_info, dirent, ignore_patterns, svn_depth_empty,
+                         FALSE /* get_all */, no_ignore,
+                         status_func, status_baton,
+                         cancel_func, cancel_baton, scratch_pool));
+
+  /* Report the candidates in walk order. */
+  dirs = apr_hash_make(scratch_pool);
+  sorted_candidates = svn_sort__hash(candidates,
+                                     svn_sort_compare_items_as_paths,
+                                     scratch_pool);
+  iterpool = svn_pool_create(scratch_pool);
+  for (i = 0; i < sorted_candidates->nelts; i++)
+    {
+      const char *child_abspath = APR_ARRAY_IDX(sorted_candidates, i,
+                                                svn_sort__item_t).key;
+      const char *name = svn_dirent_basename(child_abspath, NULL);
+      const struct svn_wc__db_info_t *child_info;
+      const svn_io_dirent2_t *child_dirent;
+      changed_dir_t *parent;
+      svn_depth_t depth = svn_depth_immediates;
+
+      svn_pool_clear(iterpool);
+
+      if (cancel_func)
+        SVN_ERR(cancel_func(cancel_baton));
+
+      /* Already reported by a complete walk of an ancestor? */
+      if (recursed_abspath
+          && svn_dirent_is_ancestor(recursed_abspath, child_abspath))
+        continue;
+
+      SVN_ERR(get_changed_dir(&parent, dirs, wb,
+                              svn_dirent_dirname(child_abspath, iterpool),
+                              dir_info, scratch_pool, iterpool));
+      if (!parent->walked)
+        continue;
+
+      SVN_ERR(svn_io_stat_dirent2(&child_dirent, child_abspath,
+                                  TRUE /* verify_truename */,
+                                  TRUE /* ignore_enoent */,
+                                  iterpool, iterpool));
+      if (child_dirent->kind == svn_node_none)
+        child_dirent = NULL;
+
+      /* The journal doesn't list the contents of directories that were
+         moved into place or away, so walk them completely. */
+      child_info = svn_hash_gets(parent->nodes, name);
+      if (child_info
+          && walk_descends_into(child_info)
+          && (svn_hash_gets(journaled, child_abspath)
+              || !child_dirent
+              || child_dirent->kind != svn_node_dir))
+        {
+          depth = svn_depth_infinity;
+          recursed_abspath = child_abspath;
+        }
+
+      SVN_ERR(one_child_status(wb, child_abspath,
+                               svn_dirent_dirname(child_abspath, iterpool),
+                               child_info, child_dirent,
+                               NULL /* known_text_mod */,
+                               parent->repos_root_url,
+                               parent->repos_relpath,
+                               parent->repos_uuid,
+                               svn_hash_gets(parent->conflicts, name) != NULL,
+                               &parent->collected_ignore_patterns,
+                               ignore_patterns, depth,
+                               FALSE /* get_all */, no_ignore,
+                               status_func, status_baton,
+                               cancel_func, cancel_baton,
+                               scratch_pool, iterpool));
+    }
+  svn_pool_destroy(iterpool);
+
+  return SVN_NO_ERROR;
+}
+
 /* Like svn_io_stat_dirent, but works case sensitive inside working
    copies. Before 1.8 we handled this with a selection filter inside
    a directory */
@@ -2644,6 +3605,7 @@ svn_wc__internal_walk_status(svn_wc__db_t *db,
   wb.check_working_copy = TRUE;
   wb.repos_root = NULL;
   wb.repos_locks = NULL;
+  wb.prefetch = NULL;
 
   /* Use the caller-provided ignore patterns if provided; the build-time
      configured defaults otherwise. */
@@ -2690,19 +3652,56 @@ svn_wc__internal_walk_status(svn_wc__db_t *db,
       && info->status != svn_wc__db_status_excluded
       && info->status != svn_wc__db_status_server_excluded)
     {
-      SVN_ERR(get_dir_status(&wb,
-                             local_abspath,
-                             FALSE /* skip_root */,
-                             NULL, NULL, NULL,
-                             info,
-                             dirent,
-                             ignore_patterns,
-                             depth,
-                             get_all,
-                             no_ignore,
-                             status_func, status_baton,
-                             cancel_func, cancel_baton,
-                             scratch_pool));
+      svn_boolean_t handled = FALSE;
+#if APR_HAS_THREADS
+      int thread_count;
+#endif
+
+      /* Let svn-wc-watcher tell us where to look, if it runs. */
+      if (!get_all
+          && (depth == svn_depth_infinity || depth == svn_depth_unknown))
+        SVN_ERR(walk_changed_status(&handled, &wb, info, dirent,
+                                    ignore_patterns, no_ignore,
+                                    status_func, status_baton,
+                                    cancel_func, cancel_baton,
+                                    scratch_pool));
+      if (handled)
+        return SVN_NO_ERROR;
+
+#if APR_HAS_THREADS
+      thread_count = svn_wc__db_get_status_threads(db);
+
+      /* Reading ahead only pays off if there are subdirectories. */
+      if (thread_count > 1
+          && (depth == svn_depth_infinity || depth == svn_depth_unknown))
+        {
+          err = prefetch_start(&wb.prefetch, &wb, thread_count,
+                               scratch_pool);
+          if (err && wb.prefetch)
+            err = svn_error_compose_create(err, prefetch_stop(wb.prefetch));
+          SVN_ERR(err);
+        }
+#endif
+
+      err = get_dir_status(&wb,
+                           local_abspath,
+                           FALSE /* skip_root */,
+                           NULL, NULL, NULL,
+                           info,
+                           dirent,
+                           ignore_patterns,
+                           depth,
+                           get_all,
+                           no_ignore,
+                           status_func, status_baton,
+                           cancel_func, cancel_baton,
+                           scratch_pool);
+
+#if APR_HAS_THREADS
+      if (wb.prefetch)
+        err = svn_error_compose_create(err, prefetch_stop(wb.prefetch));
+#endif
+      SVN_ERR(err);
     }
   else
     {
@@ -2900,6 +3899,7 @@ internal_status(svn_wc__internal_status_t **status,
                                          dirent,
                                          TRUE /* get_all */,
                                          FALSE, check_working_copy,
+                                         NULL /* known_text_mod */,
                                          NULL /* repos_lock */,
                                          result_pool, scratch_pool));
 }
@@ -3876,14 +3876,16 @@ svn_wc__perform_file_merge(svn_skel_t **work_items,
   svn_boolean_t delete_left = FALSE;
   const char *path_ext = "";
   const char *new_pristine_abspath;
+  svn_boolean_t delete_right;
   enum svn_wc_merge_outcome_t merge_outcome = svn_wc_merge_unchanged;
   svn_skel_t *work_item;
 
   *work_items = NULL;
 
-  SVN_ERR(svn_wc__db_pristine_get_path(&new_pristine_abspath,
-                                       db, wri_abspath, new_checksum,
-                                       scratch_pool, scratch_pool));
+  SVN_ERR(svn_wc__db_pristine_get_wq_path(&new_pristine_abspath,
+                                          &delete_right,
+                                          db, wri_abspath, new_checksum,
+                                          scratch_pool, scratch_pool));
 
   /* If we have any file extensions we're supposed to
      preserve in generated conflict file names, then find
@@ -3922,9 +3924,10 @@ svn_wc__perform_file_merge(svn_skel_t **work_items,
       delete_left = TRUE;
     }
   else
-    SVN_ERR(svn_wc__db_pristine_get_path(&merge_left, db, wri_abspath,
-                                         original_checksum,
-                                         result_pool, scratch_pool));
+    SVN_ERR(svn_wc__db_pristine_get_wq_path(&merge_left, &delete_left,
+                                            db, wri_abspath,
+                                            original_checksum,
+                                            result_pool, scratch_pool));
 
   /* Merge the changes from the old textbase to the new
      textbase into the file we're updating.
@@ -3947,7 +3950,7 @@ svn_wc__perform_file_merge(svn_skel_t **work_items,
   *work_items = svn_wc__wq_merge(*work_items, work_item, result_pool);
   *found_conflict = (merge_outcome == svn_wc_merge_conflict);
 
-  /* If we created a temporary left merge file, get rid of it. */
+  /* If we created temporary merge files, get rid of them. */
   if (delete_left)
     {
       SVN_ERR(svn_wc__wq_build_file_remove(&work_item, db, wri_abspath,
@@ -3955,6 +3958,13 @@ svn_wc__perform_file_merge(svn_skel_t **work_items,
                                            result_pool, scratch_pool));
       *work_items = svn_wc__wq_merge(*work_items, work_item, result_pool);
     }
+  if (delete_right)
+    {
+      SVN_ERR(svn_wc__wq_build_file_remove(&work_item, db, wri_abspath,
+                                           new_pristine_abspath,
+                                           result_pool, scratch_pool));
+      *work_items = svn_wc__wq_merge(*work_items, work_item, result_pool);
+    }
 
   return SVN_NO_ERROR;
 }
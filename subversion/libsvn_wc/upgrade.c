@@ -1672,8 +1672,8 @@ svn_wc__upgrade_sdb(int *result_format,
   /* ### need lock-out. only one upgrade at a time. note that other code
      ### cannot use this un-upgraded database until we finish the upgrade.  */
 
-  /* Note: none of these have "break" statements; the fall-through is
-     intentional. */
+  /* Note: none of these have "break" statements up to SVN_WC__VERSION;
+     the fall-through is intentional. */
   switch (start_format)
     {
       case 29:
@@ -1699,6 +1699,16 @@ svn_wc__upgrade_sdb(int *result_format,
         /* already upgraded */
         *result_format = SVN_WC__VERSION;
 
+        SVN_SQLITE__WITH_LOCK(
+            svn_wc__db_install_schema_statistics(sdb, scratch_pool),
+            sdb);
+        break;
+
+      case SVN_WC__COMPRESSED_PRISTINES:
+        /* already upgraded; svn_wc__db_pristine_convert_store() takes
+           care of the pristine store */
+        *result_format = SVN_WC__COMPRESSED_PRISTINES;
+
         SVN_SQLITE__WITH_LOCK(
             svn_wc__db_install_schema_statistics(sdb, scratch_pool),
             sdb);
@@ -1906,6 +1916,7 @@ svn_wc_upgrade(svn_wc_context_t *wc_ctx,
   svn_error_t *err;
   int result_format;
   svn_boolean_t bumped_format;
+  svn_boolean_t converted;
 
   /* Try upgrading a wc-ng-style working copy. */
   SVN_ERR(svn_wc__db_open(&db, NULL /* ### config */, TRUE, FALSE,
@@ -1933,9 +1944,15 @@ svn_wc_upgrade(svn_wc_context_t *wc_ctx,
       /* Auto-upgrade worked! */
       SVN_ERR(svn_wc__db_close(db));
 
-      SVN_ERR_ASSERT(result_format == SVN_WC__VERSION);
+      SVN_ERR_ASSERT(SVN_WC__IS_CURRENT_FORMAT(result_format));
 
-      if (bumped_format && notify_func)
+      /* Compress or decompress the pristine store as configured. */
+      SVN_ERR(svn_wc__db_pristine_convert_store(&converted, wc_ctx->db,
+                                                local_abspath,
+                                                cancel_func, cancel_baton,
+                                                scratch_pool));
+
+      if ((bumped_format || converted) && notify_func)
         {
           svn_wc_notify_t *notify;
 
@@ -2044,6 +2061,10 @@ svn_wc_upgrade(svn_wc_context_t *wc_ctx,
   SVN_ERR(svn_io_remove_dir2(data.root_abspath, FALSE, NULL, NULL,
                              scratch_pool));
 
+  SVN_ERR(svn_wc__db_pristine_convert_store(NULL, wc_ctx->db, local_abspath,
+                                            cancel_func, cancel_baton,
+                                            scratch_pool));
+
   return SVN_NO_ERROR;
 }
 
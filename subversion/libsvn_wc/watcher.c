@@ -0,0 +1,345 @@
+/*
+ * watcher.c :  reading the change journal of svn-wc-watcher
+ *
+ * ====================================================================
+ *    Licensed to the Apache Software Foundation (ASF) under one
+ *    or more contributor license agreements.  See the NOTICE file
+ *    distributed with this work for additional information
+ *    regarding copyright ownership.  The ASF licenses this file
+ *    to you under the Apache License, Version 2.0 (the
+ *    "License"); you may not use this file except in compliance
+ *    with the License.  You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *    Unless required by applicable law or agreed to in writing,
+ *    software distributed under the License is distributed on an
+ *    "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+ *    KIND, either express or implied.  See the License for the
+ *    specific language governing permissions and limitations
+ *    under the License.
+ * ====================================================================
+ */
+
+
+
+#include <string.h>
+
+#include <apr_pools.h>
+#include <apr_strings.h>
+
+#ifndef WIN32
+#include <errno.h>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <sys/time.h>
+#include <sys/un.h>
+#include <unistd.h>
+#endif
+
+#include "svn_dirent_uri.h"
+#include "svn_error.h"
+#include "svn_io.h"
+#include "svn_path.h"
+#include "svn_string.h"
+#include "svn_utf.h"
+
+#include "wc.h"
+#include "adm_files.h"
+#include "watcher.h"
+
+#include "private/svn_wc_private.h"
+
+#include "svn_private_config.h"
+
+
+/* Seconds to wait for the watcher before giving up on it. */
+#define WATCHER_TIMEOUT 2
+
+/* Prefixes of the lines in the journal and in the baseline file. */
+#define SESSION_PREFIX "session "
+#define PATH_PREFIX    "path "
+#define END_LINE       "end"
+
+#ifndef WIN32
+
+/* Return TRUE if SOCKET_PATH is a socket, not a link to one, that belongs
+   to the owner of the administrative directory ADM_PATH.  Anybody else
+   could use it to hide local modifications.  Both paths are given in the
+   local encoding. */
+static svn_boolean_t
+is_trusted_socket(const char *socket_path,
+                  const char *adm_path)
+{
+  struct stat socket_info;
+  struct stat adm_info;
+
+  if (lstat(socket_path, &socket_info) || stat(adm_path, &adm_info))
+    return FALSE;
+
+  return S_ISSOCK(socket_info.st_mode)
+         && socket_info.st_uid == adm_info.st_uid;
+}
+
+/* Connect to the watcher socket SOCKET_PATH, given in the local encoding,
+   send the journal command and read the whole response into *RESPONSE.
+   Set *RESPONSE to NULL if that fails for any reason.  Allocate the
+   result in RESULT_POOL. */
+static void
+request_journal(svn_stringbuf_t **response,
+                const char *socket_path,
+                apr_pool_t *result_pool)
+{
+  static const char command[] = SVN_WC__WATCHER_CMD_JOURNAL "\n";
+  struct sockaddr_un addr;
+  struct timeval timeout;
+  svn_stringbuf_t *buffer;
+  int fd;
+
+  *response = NULL;
+
+  if (strlen(socket_path) >= sizeof(addr.sun_path))
+    return;
+
+  memset(&addr, 0, sizeof(addr));
+  addr.sun_family = AF_UNIX;
+  strcpy(addr.sun_path, socket_path);
+
+  fd = socket(AF_UNIX, SOCK_STREAM, 0);
+  if (fd < 0)
+    return;
+
+  timeout.tv_sec = WATCHER_TIMEOUT;
+  timeout.tv_usec = 0;
+  if (setsockopt(fd, SOL_SOCKET, SO_RCVTIMEO, &timeout, sizeof(timeout))
+      || setsockopt(fd, SOL_SOCKET, SO_SNDTIMEO, &timeout, sizeof(timeout))
+      || connect(fd, (struct sockaddr *)&addr, sizeof(addr))
+      || write(fd, command, sizeof(command) - 1) != sizeof(command) - 1)
+    {
+      close(fd);
+      return;
+    }
+
+  buffer = svn_stringbuf_create_ensure(SVN__STREAM_CHUNK_SIZE, result_pool);
+  while (TRUE)
+    {
+      ssize_t count;
+
+      svn_stringbuf_ensure(buffer, buffer->len + SVN__STREAM_CHUNK_SIZE);
+      count = read(fd, buffer->data + buffer->len, SVN__STREAM_CHUNK_SIZE);
+      if (count < 0 && errno == EINTR)
+        continue;
+
+      if (count < 0)
+        {
+          close(fd);
+          return;
+        }
+
+      if (count == 0)
+        break;
+
+      buffer->len += count;
+      buffer->data[buffer->len] = '\0';
+    }
+
+  close(fd);
+  *response = buffer;
+}
+
+#endif /* !WIN32 */
+
+/* Parse the line LINE of a journal or baseline, starting with PREFIX, as
+   a relpath in the local encoding and return it in *RELPATH, or NULL if
+   it is not valid.  Allocate the result in RESULT_POOL. */
+static svn_error_t *
+parse_relpath(const char **relpath,
+              const char *line,
+              const char *prefix,
+              apr_pool_t *result_pool)
+{
+  svn_error_t *err;
+
+  *relpath = NULL;
+  if (strncmp(line, prefix, strlen(prefix)) != 0)
+    return SVN_NO_ERROR;
+
+  err = svn_path_cstring_to_utf8(relpath, line + strlen(prefix),
+                                 result_pool);
+  if (err || !svn_relpath_is_canonical(*relpath) || !**relpath)
+    {
+      svn_error_clear(err);
+      *relpath = NULL;
+    }
+
+  return SVN_NO_ERROR;
+}
+
+svn_error_t *
+svn_wc__watcher_read_journal(svn_wc__watcher_journal_t **journal,
+                             const char *wcroot_abspath,
+                             apr_pool_t *result_pool,
+                             apr_pool_t *scratch_pool)
+{
+#ifndef WIN32
+  svn_wc__watcher_journal_t *result;
+  const char *adm_path;
+  const char *socket_path;
+  svn_stringbuf_t *response;
+  apr_array_header_t *lines;
+  int i;
+
+  *journal = NULL;
+
+  SVN_ERR(svn_utf_cstring_from_utf8(
+            &adm_path,
+            svn_dirent_local_style(svn_wc__adm_child(wcroot_abspath, NULL,
+                                                     scratch_pool),
+                                   scratch_pool),
+            scratch_pool));
+  SVN_ERR(svn_utf_cstring_from_utf8(
+            &socket_path,
+            svn_dirent_local_style(svn_wc__adm_child(wcroot_abspath,
+                                                     SVN_WC__WATCHER_SOCKET,
+                                                     scratch_pool),
+                                   scratch_pool),
+            scratch_pool));
+
+  if (!is_trusted_socket(socket_path, adm_path))
+    return SVN_NO_ERROR;
+
+  request_journal(&response, socket_path, scratch_pool);
+  if (!response)
+    return SVN_NO_ERROR;
+
+  lines = svn_cstring_split(response->data, "\n", FALSE, scratch_pool);
+  if (lines->nelts < 3
+      || strcmp(APR_ARRAY_IDX(lines, 0, const char *),
+                SVN_WC__WATCHER_GREETING) != 0
+      || strncmp(APR_ARRAY_IDX(lines, 1, const char *), SESSION_PREFIX,
+                 strlen(SESSION_PREFIX)) != 0
+      || strcmp(APR_ARRAY_IDX(lines, lines->nelts - 1, const char *),
+                END_LINE) != 0)
+    return SVN_NO_ERROR;
+
+  result = apr_pcalloc(result_pool, sizeof(*result));
+  result->session = apr_pstrdup(result_pool,
+                                APR_ARRAY_IDX(lines, 1, const char *)
+                                  + strlen(SESSION_PREFIX));
+  result->changed = apr_array_make(result_pool, lines->nelts - 3,
+                                   sizeof(const char *));
+
+  for (i = 2; i < lines->nelts - 1; i++)
+    {
+      const char *relpath;
+
+      SVN_ERR(parse_relpath(&relpath, APR_ARRAY_IDX(lines, i, const char *),
+                            PATH_PREFIX, result_pool));
+
+      /* Don't trust a journal that we can't fully understand. */
+      if (!relpath)
+        return SVN_NO_ERROR;
+
+      APR_ARRAY_PUSH(result->changed, const char *) = relpath;
+    }
+
+  *journal = result;
+#else
+  *journal = NULL;
+#endif
+
+  return SVN_NO_ERROR;
+}
+
+svn_error_t *
+svn_wc__watcher_read_baseline(apr_array_header_t **relpaths,
+                              const char *wcroot_abspath,
+                              const char *session,
+                              apr_pool_t *result_pool,
+                              apr_pool_t *scratch_pool)
+{
+  const char *baseline_abspath;
+  svn_stringbuf_t *contents;
+  apr_array_header_t *lines;
+  apr_array_header_t *result;
+  svn_error_t *err;
+  int i;
+
+  *relpaths = NULL;
+
+  baseline_abspath = svn_wc__adm_child(wcroot_abspath,
+                                       SVN_WC__ADM_WATCHER_BASELINE,
+                                       scratch_pool);
+  err = svn_stringbuf_from_file2(&contents, baseline_abspath, scratch_pool);
+  if (err && APR_STATUS_IS_ENOENT(err->apr_err))
+    {
+      svn_error_clear(err);
+      return SVN_NO_ERROR;
+    }
+  SVN_ERR(err);
+
+  lines = svn_cstring_split(contents->data, "\n", FALSE, scratch_pool);
+  if (lines->nelts < 2
+      || strcmp(APR_ARRAY_IDX(lines, 0, const char *),
+                apr_pstrcat(scratch_pool, SESSION_PREFIX, session,
+                            SVN_VA_NULL)) != 0
+      || strcmp(APR_ARRAY_IDX(lines, lines->nelts - 1, const char *),
+                END_LINE) != 0)
+    return SVN_NO_ERROR;
+
+  result = apr_array_make(result_pool, lines->nelts - 2,
+                          sizeof(const char *));
+  for (i = 1; i < lines->nelts - 1; i++)
+    {
+      const char *relpath;
+
+      SVN_ERR(parse_relpath(&relpath, APR_ARRAY_IDX(lines, i, const char *),
+                            PATH_PREFIX, result_pool));
+      if (!relpath)
+        return SVN_NO_ERROR;
+
+      APR_ARRAY_PUSH(result, const char *) = relpath;
+    }
+
+  *relpaths = result;
+
+  return SVN_NO_ERROR;
+}
+
+svn_error_t *
+svn_wc__watcher_write_baseline(const char *wcroot_abspath,
+                               const char *session,
+                               const apr_array_header_t *relpaths,
+                               apr_pool_t *scratch_pool)
+{
+  svn_stringbuf_t *contents;
+  int i;
+
+  contents = svn_stringbuf_createf(scratch_pool, SESSION_PREFIX "%s\n",
+                                   session);
+  for (i = 0; i < relpaths->nelts; i++)
+    {
+      const char *relpath = APR_ARRAY_IDX(relpaths, i, const char *);
+      const char *native_relpath;
+
+      /* The format can't represent such names. */
+      if (strchr(relpath, '\n'))
+        return SVN_NO_ERROR;
+
+      SVN_ERR(svn_path_cstring_from_utf8(&native_relpath, relpath,
+                                         scratch_pool));
+      svn_stringbuf_appendcstr(contents, PATH_PREFIX);
+      svn_stringbuf_appendcstr(contents, native_relpath);
+      svn_stringbuf_appendbyte(contents, '\n');
+    }
+  svn_stringbuf_appendcstr(contents, END_LINE "\n");
+
+  return svn_error_trace(
+            svn_io_write_atomic2(svn_wc__adm_child(wcroot_abspath,
+                                                   SVN_WC__ADM_WATCHER_BASELINE,
+                                                   scratch_pool),
+                                 contents->data, contents->len,
+                                 NULL /* copy_perms_path */,
+                                 FALSE /* flush_to_disk */,
+                                 scratch_pool));
+}
@@ -0,0 +1,86 @@
+/*
+ * watcher.h :  reading the change journal of svn-wc-watcher
+ *
+ * ====================================================================
+ *    Licensed to the Apache Software Foundation (ASF) under one
+ *    or more contributor license agreements.  See the NOTICE file
+ *    distributed with this work for additional information
+ *    regarding copyright ownership.  The ASF licenses this file
+ *    to you under the Apache License, Version 2.0 (the
+ *    "License"); you may not use this file except in compliance
+ *    with the License.  You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *    Unless required by applicable law or agreed to in writing,
+ *    software distributed under the License is distributed on an
+ *    "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+ *    KIND, either express or implied.  See the License for the
+ *    specific language governing permissions and limitations
+ *    under the License.
+ * ====================================================================
+ */
+
+
+#ifndef SVN_LIBSVN_WC_WATCHER_H
+#define SVN_LIBSVN_WC_WATCHER_H
+
+#include <apr_pools.h>
+#include <apr_tables.h>
+#include "svn_types.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif /* __cplusplus */
+
+
+/* The paths that changed below a working copy root since an
+   svn-wc-watcher session started.  See svn_wc_private.h for the
+   protocol. */
+typedef struct svn_wc__watcher_journal_t
+{
+  /* Identifies the session. */
+  const char *session;
+
+  /* The changed paths, as const char * relpaths. */
+  apr_array_header_t *changed;
+} svn_wc__watcher_journal_t;
+
+/* Ask the svn-wc-watcher of the working copy root WCROOT_ABSPATH for its
+   journal and return it in *JOURNAL.  Set *JOURNAL to NULL if there is no
+   watcher, if its socket is not owned by the owner of the working copy,
+   if it doesn't answer in time or if this platform doesn't support it.
+   Allocate the result in RESULT_POOL and use SCRATCH_POOL for temporary
+   allocations. */
+svn_error_t *
+svn_wc__watcher_read_journal(svn_wc__watcher_journal_t **journal,
+                             const char *wcroot_abspath,
+                             apr_pool_t *result_pool,
+                             apr_pool_t *scratch_pool);
+
+/* Set *RELPATHS to the const char * relpaths that were stored for SESSION
+   in the working copy root WCROOT_ABSPATH by svn_wc__watcher_write_baseline,
+   or to NULL if there is no baseline for SESSION.  Allocate the result in
+   RESULT_POOL and use SCRATCH_POOL for temporary allocations. */
+svn_error_t *
+svn_wc__watcher_read_baseline(apr_array_header_t **relpaths,
+                              const char *wcroot_abspath,
+                              const char *session,
+                              apr_pool_t *result_pool,
+                              apr_pool_t *scratch_pool);
+
+/* Store RELPATHS, an array of const char * relpaths, as the baseline of
+   the working copy root WCROOT_ABSPATH for the watcher session SESSION,
+   replacing any previous baseline.  Use SCRATCH_POOL for temporary
+   allocations. */
+svn_error_t *
+svn_wc__watcher_write_baseline(const char *wcroot_abspath,
+                               const char *session,
+                               const apr_array_header_t *relpaths,
+                               apr_pool_t *scratch_pool);
+
+#ifdef __cplusplus
+}
+#endif /* __cplusplus */
+
+#endif /* SVN_LIBSVN_WC_WATCHER_H */
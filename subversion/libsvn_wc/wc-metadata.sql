@@ -704,6 +704,17 @@ WHERE l.op_depth = 0
 PRAGMA user_version = 32; */
 
 
+/* ------------------------------------------------------------------------- */
+/* Format 1031 is format 31 with a compressed pristine store (see
+   SVN_WC__COMPRESSED_PRISTINES).  The schema is the same, so converting
+   between the two only rewrites the pristine files and the version.  */
+-- STMT_SET_COMPRESSED_PRISTINES_FORMAT
+PRAGMA user_version = 1031;
+
+-- STMT_SET_PLAIN_PRISTINES_FORMAT
+PRAGMA user_version = 31;
+
+
 /* ------------------------------------------------------------------------- */
 
 /* Format 99 drops all columns not needed due to previous format upgrades.
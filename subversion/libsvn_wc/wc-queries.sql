@@ -883,6 +883,12 @@ SELECT id, work FROM work_queue ORDER BY id LIMIT 1
 -- STMT_DELETE_WORK_ITEM
 DELETE FROM work_queue WHERE id = ?1
 
+-- STMT_SELECT_WORK_ITEMS
+SELECT id, work FROM work_queue ORDER BY id LIMIT ?1
+
+-- STMT_DELETE_WORK_ITEMS_THROUGH
+DELETE FROM work_queue WHERE id <= ?1
+
 -- STMT_INSERT_OR_IGNORE_PRISTINE
 INSERT OR IGNORE INTO pristine (checksum, md5_checksum, size, refcount)
 VALUES (?1, ?2, ?3, 0)
@@ -906,6 +912,10 @@ SELECT checksum
 FROM pristine
 WHERE md5_checksum = ?1
 
+-- STMT_SELECT_ALL_PRISTINES
+SELECT checksum
+FROM pristine
+
 -- STMT_SELECT_UNREFERENCED_PRISTINES
 SELECT checksum
 FROM pristine
@@ -1598,6 +1608,39 @@ WHERE wc_id = ?1
   AND properties IS NOT NULL
 LIMIT 1
 
+/* Nodes below ?2 whose status can differ from 'normal' without any
+   change on disk: working nodes, moves, incomplete nodes, nodes with a
+   lock token and switched nodes. */
+-- STMT_SELECT_STATUS_CANDIDATE_NODES
+SELECT n.local_relpath FROM nodes n
+WHERE n.wc_id = ?1
+  AND IS_STRICT_DESCENDANT_OF(n.local_relpath, ?2)
+  AND (n.op_depth > 0
+       OR n.presence = MAP_INCOMPLETE
+       OR n.moved_to IS NOT NULL
+       OR EXISTS (SELECT 1 FROM lock l
+                  WHERE l.repos_id = n.repos_id
+                    AND l.repos_relpath = n.repos_path)
+       OR (n.presence IN (MAP_NORMAL, MAP_INCOMPLETE)
+           AND EXISTS (SELECT 1 FROM nodes p
+                       WHERE p.wc_id = ?1
+                         AND p.local_relpath = n.parent_relpath
+                         AND p.op_depth = 0
+                         AND (p.repos_id IS NOT n.repos_id
+                              OR n.repos_path IS NOT
+          RELPATH_SKIP_JOIN(p.local_relpath, p.repos_path, n.local_relpath)))))
+
+/* Property changes, conflicts and changelists below ?2 */
+-- STMT_SELECT_STATUS_CANDIDATE_ACTUAL
+SELECT local_relpath FROM actual_node
+WHERE wc_id = ?1
+  AND IS_STRICT_DESCENDANT_OF(local_relpath, ?2)
+
+-- STMT_SELECT_STATUS_CANDIDATE_WC_LOCKS
+SELECT local_dir_relpath FROM wc_lock
+WHERE wc_id = ?1
+  AND IS_STRICT_DESCENDANT_OF(local_dir_relpath, ?2)
+
 -- STMT_HAS_SWITCHED
 SELECT 1
 FROM nodes
@@ -161,11 +161,33 @@ extern "C" {
  * == 1.9.x shipped with format 31
  * == 1.10.x shipped with format 31
  *
+ * Format 1031 is format 31 with a compressed pristine store.  It is not a
+ * bump: new working copies only use it if the "compress-pristines" option
+ * asks for it and 'svn upgrade' converts between 31 and 1031 either way.
+ * See SVN_WC__COMPRESSED_PRISTINES for why it is not format 32.
+ *
  * Please document any further format changes here.
  */
 
 #define SVN_WC__VERSION 31
 
+/* The format of working copies that store their pristine texts compressed.
+   Apart from the pristine store, such a working copy is the same as one in
+   format SVN_WC__VERSION.
+
+   This deliberately lies far outside the sequence of regular formats.
+   Format 32 is reserved for the next regular format bump (see
+   wc-metadata.sql), and a client that supports that format but not
+   compressed pristines must not take such a working copy for one of its
+   own and look for pristine files that are not there.  Every client that
+   doesn't know this number rejects it as too new instead.  */
+#define SVN_WC__COMPRESSED_PRISTINES 1031
+
+/* Evaluate to TRUE if a working copy in FORMAT can be used without an
+   upgrade.  NOTE: the expression is multiply-evaluated!!  */
+#define SVN_WC__IS_CURRENT_FORMAT(format) \
+  ((format) == SVN_WC__VERSION || (format) == SVN_WC__COMPRESSED_PRISTINES)
+
 
 /* Formats <= this have no concept of "revert text-base/props".  */
 #define SVN_WC__NO_REVERT_FILES 4
@@ -290,6 +312,7 @@ struct svn_wc_traversal_info_t
 #define SVN_WC__ADM_PRISTINE            "pristine"
 #define SVN_WC__ADM_NONEXISTENT_PATH    "nonexistent-path"
 #define SVN_WC__ADM_EXPERIMENTAL        "experimental"
+#define SVN_WC__ADM_WATCHER_BASELINE    "watcher-baseline"
 
 /* The basename of the ".prej" file, if a directory ever has property
    conflicts.  This .prej file will appear *within* the conflicted
@@ -350,6 +373,29 @@ svn_wc__internal_file_modified_p(svn_boolean_t *modified_p,
                                  svn_boolean_t exact_comparison,
                                  apr_pool_t *scratch_pool);
 
+/* Like svn_wc__internal_file_modified_p() with EXACT_COMPARISON FALSE, but
+ * for all files in LOCAL_ABSPATHS, an array of const char * absolute paths.
+ * Set *MODIFIED to a hash mapping these paths to svn_boolean_t *.
+ *
+ * The files whose recorded size or time doesn't match are compared with
+ * their pristines by up to svn_wc__db_get_compare_threads() threads, and
+ * if a write-lock is held, the timestamps of all unmodified files are
+ * repaired in a single transaction.
+ *
+ * Files for which the check fails are left out of *MODIFIED; check them
+ * with svn_wc__internal_file_modified_p() to get the error.  Check for
+ * cancellation using CANCEL_FUNC / CANCEL_BATON.  Allocate *MODIFIED in
+ * RESULT_POOL and use SCRATCH_POOL for temporary allocations.
+ */
+svn_error_t *
+svn_wc__internal_files_modified_p(apr_hash_t **modified,
+                                  svn_wc__db_t *db,
+                                  const apr_array_header_t *local_abspaths,
+                                  svn_cancel_func_t cancel_func,
+                                  void *cancel_baton,
+                                  apr_pool_t *result_pool,
+                                  apr_pool_t *scratch_pool);
+
 
 /* Prepare to merge a file content change into the working copy.
 
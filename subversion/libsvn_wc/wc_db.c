@@ -1490,6 +1490,12 @@ svn_wc__db_init(svn_wc__db_t *db,
                     sqlite_timeout,
                     db->state_pool, scratch_pool));
 
+  /* Start out with a compressed pristine store if asked to. */
+  if (db->pristine_compression == svn_wc__db_compression_lz4
+      || db->pristine_compression == svn_wc__db_compression_zlib)
+    SVN_ERR(svn_sqlite__exec_statements(
+              sdb, STMT_SET_COMPRESSED_PRISTINES_FORMAT));
+
   /* Create the WCROOT for this directory.  */
   SVN_ERR(svn_wc__db_pdh_create_wcroot(&wcroot,
                         apr_pstrdup(db->state_pool, local_abspath),
@@ -6095,6 +6101,83 @@ svn_wc__db_global_record_fileinfo(svn_wc__db_t *db,
 }
 
 
+/* Record the svn_wc__db_fileinfo_t in FILEINFOS from index START up to
+   but not including END, whose paths are LOCAL_RELPATHS within WCROOT. */
+static svn_error_t *
+db_record_fileinfos(svn_wc__db_wcroot_t *wcroot,
+                    const apr_array_header_t *fileinfos,
+                    const char **local_relpaths,
+                    int start,
+                    int end,
+                    apr_pool_t *scratch_pool)
+{
+  int i;
+
+  for (i = start; i < end; i++)
+    {
+      const svn_wc__db_fileinfo_t *fileinfo
+        = &APR_ARRAY_IDX(fileinfos, i, svn_wc__db_fileinfo_t);
+
+      SVN_ERR(db_record_fileinfo(wcroot, local_relpaths[i],
+                                 fileinfo->recorded_size,
+                                 fileinfo->recorded_time, scratch_pool));
+    }
+
+  return SVN_NO_ERROR;
+}
+
+
+svn_error_t *
+svn_wc__db_global_record_fileinfos(svn_wc__db_t *db,
+                                   const apr_array_header_t *fileinfos,
+                                   apr_pool_t *scratch_pool)
+{
+  svn_wc__db_wcroot_t **wcroots;
+  const char **local_relpaths;
+  int start, i;
+
+  wcroots = apr_palloc(scratch_pool, fileinfos->nelts * sizeof(*wcroots));
+  local_relpaths = apr_palloc(scratch_pool,
+                              fileinfos->nelts * sizeof(*local_relpaths));
+  for (i = 0; i < fileinfos->nelts; i++)
+    {
+      const char *local_abspath
+        = APR_ARRAY_IDX(fileinfos, i, svn_wc__db_fileinfo_t).local_abspath;
+
+      SVN_ERR_ASSERT(svn_dirent_is_absolute(local_abspath));
+
+      SVN_ERR(svn_wc__db_wcroot_parse_local_abspath(&wcroots[i],
+                                                    &local_relpaths[i], db,
+                                                    local_abspath,
+                                                    scratch_pool,
+                                                    scratch_pool));
+      VERIFY_USABLE_WCROOT(wcroots[i]);
+    }
+
+  /* One transaction for every run of files in the same working copy. */
+  for (start = 0; start < fileinfos->nelts; start = i)
+    {
+      for (i = start + 1; i < fileinfos->nelts; i++)
+        if (wcroots[i] != wcroots[start])
+          break;
+
+      SVN_WC__DB_WITH_TXN(
+        db_record_fileinfos(wcroots[start], fileinfos, local_relpaths,
+                            start, i, scratch_pool),
+        wcroots[start]);
+    }
+
+  /* We *totally* monkeyed the entries. Toss 'em.  */
+  for (i = 0; i < fileinfos->nelts; i++)
+    SVN_ERR(flush_entries(wcroots[i],
+                          APR_ARRAY_IDX(fileinfos, i,
+                                        svn_wc__db_fileinfo_t).local_abspath,
+                          svn_depth_empty, scratch_pool));
+
+  return SVN_NO_ERROR;
+}
+
+
 /* Set the ACTUAL_NODE properties column for (WC_ID, LOCAL_RELPATH) to
  * PROPS.
  *
@@ -13564,21 +13647,70 @@ wq_record(svn_wc__db_wcroot_t *wcroot,
   return SVN_NO_ERROR;
 }
 
+/* The body of svn_wc__db_wq_record_and_fetch_batch().
+ */
+static svn_error_t *
+wq_fetch_batch(apr_array_header_t **work_items,
+               svn_wc__db_wcroot_t *wcroot,
+               apr_uint64_t completed_id,
+               int max_items,
+               apr_pool_t *result_pool,
+               apr_pool_t *scratch_pool)
+{
+  svn_sqlite__stmt_t *stmt;
+  svn_boolean_t have_row;
+
+  if (completed_id != 0)
+    {
+      SVN_ERR(svn_sqlite__get_statement(&stmt, wcroot->sdb,
+                                        STMT_DELETE_WORK_ITEMS_THROUGH));
+      SVN_ERR(svn_sqlite__bind_int64(stmt, 1, completed_id));
+
+      SVN_ERR(svn_sqlite__step_done(stmt));
+    }
+
+  *work_items = apr_array_make(result_pool, max_items,
+                               sizeof(svn_wc__db_work_item_t *));
+
+  SVN_ERR(svn_sqlite__get_statement(&stmt, wcroot->sdb,
+                                    STMT_SELECT_WORK_ITEMS));
+  SVN_ERR(svn_sqlite__bind_int(stmt, 1, max_items));
+  SVN_ERR(svn_sqlite__step(&have_row, stmt));
+
+  while (have_row)
+    {
+      svn_wc__db_work_item_t *item = apr_palloc(result_pool, sizeof(*item));
+      apr_size_t len;
+      const void *val;
+
+      item->id = svn_sqlite__column_int64(stmt, 0);
+
+      val = svn_sqlite__column_blob(stmt, 1, &len, result_pool);
+      item->work = svn_skel__parse(val, len, result_pool);
+
+      APR_ARRAY_PUSH(*work_items, svn_wc__db_work_item_t *) = item;
+
+      SVN_ERR(svn_sqlite__step(&have_row, stmt));
+    }
+
+  return svn_error_trace(svn_sqlite__reset(stmt));
+}
+
 svn_error_t *
-svn_wc__db_wq_record_and_fetch_next(apr_uint64_t *id,
-                                    svn_skel_t **work_item,
-                                    svn_wc__db_t *db,
-                                    const char *wri_abspath,
-                                    apr_uint64_t completed_id,
-                                    apr_hash_t *record_map,
-                                    apr_pool_t *result_pool,
-                                    apr_pool_t *scratch_pool)
+svn_wc__db_wq_record_and_fetch_batch(apr_array_header_t **work_items,
+                                     svn_wc__db_t *db,
+                                     const char *wri_abspath,
+                                     apr_uint64_t completed_id,
+                                     apr_hash_t *record_map,
+                                     int max_items,
+                                     apr_pool_t *result_pool,
+                                     apr_pool_t *scratch_pool)
 {
   svn_wc__db_wcroot_t *wcroot;
   const char *local_relpath;
 
-  SVN_ERR_ASSERT(id != NULL);
-  SVN_ERR_ASSERT(work_item != NULL);
+  SVN_ERR_ASSERT(work_items != NULL);
+  SVN_ERR_ASSERT(max_items > 0);
   SVN_ERR_ASSERT(svn_dirent_is_absolute(wri_abspath));
 
   SVN_ERR(svn_wc__db_wcroot_parse_local_abspath(&wcroot, &local_relpath, db,
@@ -13587,17 +13719,16 @@ svn_wc__db_wq_record_and_fetch_next(apr_uint64_t *id,
 
   SVN_WC__DB_WITH_TXN(
     svn_error_compose_create(
-            wq_fetch_next(id, work_item,
-                          wcroot, local_relpath, completed_id,
-                          result_pool, scratch_pool),
-            wq_record(wcroot, record_map, scratch_pool)),
+            wq_fetch_batch(work_items, wcroot, completed_id, max_items,
+                           result_pool, scratch_pool),
+            record_map ? wq_record(wcroot, record_map, scratch_pool)
+                       : SVN_NO_ERROR),
     wcroot);
 
   return SVN_NO_ERROR;
 }
 
 
-
 /* ### temporary API. remove before release.  */
 svn_error_t *
 svn_wc__db_temp_get_format(int *format,
@@ -15679,6 +15810,76 @@ svn_wc__db_has_db_mods(svn_boolean_t *is_modified,
 }
 
 
+/* The body of svn_wc__db_read_status_candidates(). */
+static svn_error_t *
+read_status_candidates(apr_hash_t *candidates,
+                       svn_wc__db_wcroot_t *wcroot,
+                       const char *local_relpath,
+                       apr_pool_t *result_pool,
+                       apr_pool_t *scratch_pool)
+{
+  static const int statements[] = {
+    STMT_SELECT_STATUS_CANDIDATE_NODES,
+    STMT_SELECT_STATUS_CANDIDATE_ACTUAL,
+    STMT_SELECT_STATUS_CANDIDATE_WC_LOCKS
+  };
+  apr_size_t i;
+
+  for (i = 0; i < sizeof(statements) / sizeof(statements[0]); i++)
+    {
+      svn_sqlite__stmt_t *stmt;
+      svn_boolean_t have_row;
+
+      SVN_ERR(svn_sqlite__get_statement(&stmt, wcroot->sdb, statements[i]));
+      SVN_ERR(svn_sqlite__bindf(stmt, "is", wcroot->wc_id, local_relpath));
+      SVN_ERR(svn_sqlite__step(&have_row, stmt));
+
+      while (have_row)
+        {
+          const char *candidate_abspath
+            = svn_dirent_join(wcroot->abspath,
+                              svn_sqlite__column_text(stmt, 0, NULL),
+                              result_pool);
+
+          svn_hash_sets(candidates, candidate_abspath, candidate_abspath);
+          SVN_ERR(svn_sqlite__step(&have_row, stmt));
+        }
+
+      SVN_ERR(svn_sqlite__reset(stmt));
+    }
+
+  return SVN_NO_ERROR;
+}
+
+
+svn_error_t *
+svn_wc__db_read_status_candidates(apr_hash_t **candidates,
+                                  svn_wc__db_t *db,
+                                  const char *local_abspath,
+                                  apr_pool_t *result_pool,
+                                  apr_pool_t *scratch_pool)
+{
+  svn_wc__db_wcroot_t *wcroot;
+  const char *local_relpath;
+
+  SVN_ERR_ASSERT(svn_dirent_is_absolute(local_abspath));
+
+  SVN_ERR(svn_wc__db_wcroot_parse_local_abspath(&wcroot, &local_relpath,
+                                                db, local_abspath,
+                                                scratch_pool, scratch_pool));
+  VERIFY_USABLE_WCROOT(wcroot);
+
+  *candidates = apr_hash_make(result_pool);
+
+  SVN_WC__DB_WITH_TXN(
+    read_status_candidates(*candidates, wcroot, local_relpath,
+                           result_pool, scratch_pool),
+    wcroot);
+
+  return SVN_NO_ERROR;
+}
+
+
 /* The body of svn_wc__db_revision_status().
  */
 static svn_error_t *
@@ -269,6 +269,43 @@ svn_error_t *
 svn_wc__db_close(svn_wc__db_t *db);
 
 
+/* Open a new DB context in *READER that reads the same working copies as
+   DB but uses its own SQLite connections, so that another thread may use
+   it while DB remains in use.  The new context is opened with the same
+   upgrade behavior and busy timeout as DB; it does not enforce an empty
+   work queue and should only be used for reading.
+
+   The context is allocated in RESULT_POOL and will be closed when that
+   pool is cleared.  Temporary allocations will be made in SCRATCH_POOL.
+*/
+svn_error_t *
+svn_wc__db_open_reader(svn_wc__db_t **reader,
+                       svn_wc__db_t *db,
+                       apr_pool_t *result_pool,
+                       apr_pool_t *scratch_pool);
+
+
+/* Return the number of threads that status walks over working copies in
+   DB may use, as configured by the "status-threads" option.  This is 1
+   unless APR supports threads and DB does not use exclusive locking.  */
+int
+svn_wc__db_get_status_threads(svn_wc__db_t *db);
+
+
+/* Return the number of threads that may compare working files in DB with
+   their pristines at the same time, as configured by the "status-threads"
+   option.  This is 1 unless APR supports threads.  */
+int
+svn_wc__db_get_compare_threads(svn_wc__db_t *db);
+
+
+/* Return the number of threads that may install and remove working files
+   in DB at the same time when running the work queue, as configured by
+   the "install-threads" option.  This is 1 unless APR supports threads. */
+int
+svn_wc__db_get_install_threads(svn_wc__db_t *db);
+
+
 /* Initialize the SDB for LOCAL_ABSPATH, which should be a working copy path.
 
    A REPOSITORY row will be constructed for the repository identified by
@@ -905,6 +942,11 @@ svn_wc__db_base_get_lock_tokens_recursive(apr_hash_t **lock_tokens,
    ### This is temporary - callers should not be looking at the file
    directly.
 
+   If the working copy stores its pristine texts compressed, the path is
+   that of a decompressed copy in the working copy's temporary area that
+   gets removed when RESULT_POOL is cleaned up.  Don't hand such a path
+   to work items; use svn_wc__db_pristine_get_wq_path() for that.
+
    Allocate the path in RESULT_POOL. */
 svn_error_t *
 svn_wc__db_pristine_get_path(const char **pristine_abspath,
@@ -914,9 +956,26 @@ svn_wc__db_pristine_get_path(const char **pristine_abspath,
                              apr_pool_t *result_pool,
                              apr_pool_t *scratch_pool);
 
+/* Like svn_wc__db_pristine_get_path(), but for paths that are passed to
+   work items, which may run long after RESULT_POOL is gone.
+
+   If the working copy stores its pristine texts compressed, the
+   decompressed copy is not removed automatically and *IS_TEMPORARY is set
+   to TRUE; the caller must then queue its removal with
+   svn_wc__wq_build_file_remove() after the work items that read it.
+   Otherwise, set *IS_TEMPORARY to FALSE. */
+svn_error_t *
+svn_wc__db_pristine_get_wq_path(const char **pristine_abspath,
+                                svn_boolean_t *is_temporary,
+                                svn_wc__db_t *db,
+                                const char *wri_abspath,
+                                const svn_checksum_t *checksum,
+                                apr_pool_t *result_pool,
+                                apr_pool_t *scratch_pool);
+
 /* Set *PRISTINE_ABSPATH to the path under WCROOT_ABSPATH that will be
-   used by the pristine text identified by SHA1_CHECKSUM.  The file
-   need not exist.
+   used by the pristine text identified by SHA1_CHECKSUM in an uncompressed
+   pristine store.  The file need not exist.
  */
 svn_error_t *
 svn_wc__db_pristine_get_future_path(const char **pristine_abspath,
@@ -925,6 +984,36 @@ svn_wc__db_pristine_get_future_path(const char **pristine_abspath,
                                     apr_pool_t *result_pool,
                                     apr_pool_t *scratch_pool);
 
+/* Set *PRISTINE_ABSPATH to the path of the file that holds, or will hold,
+   the pristine text identified by SHA1_CHECKSUM in the pristine store of
+   the working copy containing WRI_ABSPATH in DB, and set *COMPRESSED to
+   whether that store keeps its texts compressed.  The file need not exist.
+
+   Together with svn_wc__db_pristine_open_file() this allows reading
+   pristine texts without further access to DB, e.g. from other threads.
+
+   Allocate the path in RESULT_POOL. */
+svn_error_t *
+svn_wc__db_pristine_get_file(const char **pristine_abspath,
+                             svn_boolean_t *compressed,
+                             svn_wc__db_t *db,
+                             const char *wri_abspath,
+                             const svn_checksum_t *sha1_checksum,
+                             apr_pool_t *result_pool,
+                             apr_pool_t *scratch_pool);
+
+/* Set *CONTENTS to a readable stream that yields the pristine text stored
+   in the file PRISTINE_ABSPATH, as returned by svn_wc__db_pristine_get_file()
+   together with COMPRESSED.  This does not access the DB.
+
+   Allocate the stream in RESULT_POOL. */
+svn_error_t *
+svn_wc__db_pristine_open_file(svn_stream_t **contents,
+                              const char *pristine_abspath,
+                              svn_boolean_t compressed,
+                              apr_pool_t *result_pool,
+                              apr_pool_t *scratch_pool);
+
 
 /* If requested set *CONTENTS to a readable stream that will yield the pristine
    text identified by SHA1_CHECKSUM (must be a SHA-1 checksum) within the WC
@@ -1030,6 +1119,26 @@ svn_wc__db_pristine_transfer(svn_wc__db_t *db,
                              void *cancel_baton,
                              apr_pool_t *scratch_pool);
 
+/* Compress or decompress all texts in the pristine store of the working
+   copy at WCROOT_ABSPATH, as the "compress-pristines" option that DB was
+   opened with asks for, and switch the working copy between the formats
+   SVN_WC__VERSION and SVN_WC__COMPRESSED_PRISTINES accordingly.  If it
+   did anything, set *CONVERTED to TRUE, else to FALSE; CONVERTED may be
+   NULL.  If the option is not set, leave the working copy as it is.
+
+   Texts that are already compressed keep their compression method.  An
+   interrupted conversion leaves the working copy usable in either its old
+   or its new format.
+
+   Use CANCEL_FUNC with CANCEL_BATON for cancellation. */
+svn_error_t *
+svn_wc__db_pristine_convert_store(svn_boolean_t *converted,
+                                  svn_wc__db_t *db,
+                                  const char *wcroot_abspath,
+                                  svn_cancel_func_t cancel_func,
+                                  void *cancel_baton,
+                                  apr_pool_t *scratch_pool);
+
 /* Remove the pristine text with SHA-1 checksum SHA1_CHECKSUM from the
  * pristine store, iff it is not referenced by any of the (other) WC DB
  * tables. */
@@ -2662,6 +2771,21 @@ svn_wc__db_global_record_fileinfo(svn_wc__db_t *db,
                                   apr_time_t recorded_time,
                                   apr_pool_t *scratch_pool);
 
+/* The arguments of one svn_wc__db_global_record_fileinfo() call. */
+typedef struct svn_wc__db_fileinfo_t
+{
+  const char *local_abspath;
+  svn_filesize_t recorded_size;
+  apr_time_t recorded_time;
+} svn_wc__db_fileinfo_t;
+
+/* Like svn_wc__db_global_record_fileinfo() for all svn_wc__db_fileinfo_t
+   in FILEINFOS, using a single transaction per working copy.  */
+svn_error_t *
+svn_wc__db_global_record_fileinfos(svn_wc__db_t *db,
+                                   const apr_array_header_t *fileinfos,
+                                   apr_pool_t *scratch_pool);
+
 
 /* ### post-commit handling.
    ### maybe multiple phases?
@@ -3016,17 +3140,39 @@ svn_wc__db_wq_fetch_next(apr_uint64_t *id,
                          apr_pool_t *result_pool,
                          apr_pool_t *scratch_pool);
 
-/* Special variant of svn_wc__db_wq_fetch_next(), which in the same transaction
-   also records timestamps and sizes for one or more nodes */
+/* A work item fetched by svn_wc__db_wq_record_and_fetch_batch(). */
+typedef struct svn_wc__db_work_item_t
+{
+  /* The identifier of the work item in the queue. */
+  apr_uint64_t id;
+
+  /* The work item itself. */
+  svn_skel_t *work;
+} svn_wc__db_work_item_t;
+
+/* Batch variant of svn_wc__db_wq_fetch_next().  In a single transaction,
+   mark all work items up to and including COMPLETED_ID as completed,
+   record the timestamps and sizes in RECORD_MAP (const char *local_abspath
+   -> const svn_io_dirent2_t *), which may be NULL, and fetch up to
+   MAX_ITEMS of the work items that still need to be completed.  Set
+   *WORK_ITEMS to these items, as svn_wc__db_work_item_t *, in the order
+   in which they were queued.  Set *WORK_ITEMS to an empty array if there
+   is nothing left to do.
+
+   Because the items are always completed in queue order, COMPLETED_ID
+   identifies all items that were completed since the last fetch.
+
+   RESULT_POOL will be used to allocate *WORK_ITEMS, and SCRATCH_POOL
+   will be used for all temporary allocations.  */
 svn_error_t *
-svn_wc__db_wq_record_and_fetch_next(apr_uint64_t *id,
-                                    svn_skel_t **work_item,
-                                    svn_wc__db_t *db,
-                                    const char *wri_abspath,
-                                    apr_uint64_t completed_id,
-                                    apr_hash_t *record_map,
-                                    apr_pool_t *result_pool,
-                                    apr_pool_t *scratch_pool);
+svn_wc__db_wq_record_and_fetch_batch(apr_array_header_t **work_items,
+                                     svn_wc__db_t *db,
+                                     const char *wri_abspath,
+                                     apr_uint64_t completed_id,
+                                     apr_hash_t *record_map,
+                                     int max_items,
+                                     apr_pool_t *result_pool,
+                                     apr_pool_t *scratch_pool);
 
 
 /* @} */
@@ -3352,6 +3498,21 @@ svn_wc__db_get_excluded_subtrees(apr_hash_t **server_excluded_subtrees,
                                  apr_pool_t *result_pool,
                                  apr_pool_t *scratch_pool);
 
+/* Set *CANDIDATES to a hash whose keys are the absolute paths of all nodes
+ * below LOCAL_ABSPATH in DB whose status may differ from 'normal' even if
+ * their working files did not change since the last status walk, e.g.
+ * because they are added, deleted, locked, switched, conflicted or have
+ * property modifications.  The hash may contain additional paths.
+ *
+ * Allocate the result in RESULT_POOL and use SCRATCH_POOL for temporary
+ * allocations. */
+svn_error_t *
+svn_wc__db_read_status_candidates(apr_hash_t **candidates,
+                                  svn_wc__db_t *db,
+                                  const char *local_abspath,
+                                  apr_pool_t *result_pool,
+                                  apr_pool_t *scratch_pool);
+
 /* Indicate in *IS_MODIFIED whether the working copy has local modifications,
  * using DB. Use SCRATCH_POOL for temporary allocations.
  *
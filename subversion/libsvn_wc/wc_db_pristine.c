@@ -28,8 +28,10 @@
 #include "svn_pools.h"
 #include "svn_io.h"
 #include "svn_dirent_uri.h"
+#include "svn_sorts.h"
 
 #include "private/svn_io_private.h"
+#include "private/svn_subr_private.h"
 
 #include "wc.h"
 #include "wc_db.h"
@@ -37,21 +39,42 @@
 #include "wc_db_private.h"
 
 #define PRISTINE_STORAGE_EXT ".svn-base"
+#define PRISTINE_COMPRESSED_EXT ".svn-zbase"
 #define PRISTINE_STORAGE_RELPATH "pristine"
 #define PRISTINE_TEMPDIR_RELPATH "tmp"
 
+/* Evaluate to TRUE if the pristine store of WCROOT is compressed. */
+#define STORE_IS_COMPRESSED(wcroot) \
+  ((wcroot)->format == SVN_WC__COMPRESSED_PRISTINES)
+
+/* A compressed pristine file starts with one of these bytes, telling the
+   method used for all of its blocks. */
+#define PRISTINE_METHOD_LZ4 'L'
+#define PRISTINE_METHOD_ZLIB 'Z'
+
+/* Compressed pristine files split their text into blocks of this many
+   bytes, which get compressed independently.  Each block is stored as
+   its 7b/8b encoded length followed by the output of svn__compress_lz4()
+   or svn__compress_zlib(). */
+#define PRISTINE_BLOCK_SIZE 0x10000
+
+/* No valid compressed block is longer than this. */
+#define PRISTINE_MAX_PACKED_SIZE (2 * PRISTINE_BLOCK_SIZE)
+
 
 
 /* Returns in PRISTINE_ABSPATH a new string allocated from RESULT_POOL,
    holding the local absolute path to the file location that is dedicated
    to hold CHECKSUM's pristine file, relating to the pristine store
-   configured for the working copy indicated by PDH. The returned path
-   does not necessarily currently exist.
+   configured for the working copy indicated by PDH.  COMPRESSED tells
+   whether that store is compressed.  The returned path does not
+   necessarily currently exist.
 
    Any other allocations are made in SCRATCH_POOL. */
 static svn_error_t *
 get_pristine_fname(const char **pristine_abspath,
                    const char *wcroot_abspath,
+                   svn_boolean_t compressed,
                    const svn_checksum_t *sha1_checksum,
                    apr_pool_t *result_pool,
                    apr_pool_t *scratch_pool)
@@ -80,7 +103,9 @@ get_pristine_fname(const char **pristine_abspath,
   subdir[1] = hexdigest[1];
   subdir[2] = '\0';
 
-  hexdigest = apr_pstrcat(scratch_pool, hexdigest, PRISTINE_STORAGE_EXT,
+  hexdigest = apr_pstrcat(scratch_pool, hexdigest,
+                          compressed ? PRISTINE_COMPRESSED_EXT
+                                     : PRISTINE_STORAGE_EXT,
                           SVN_VA_NULL);
 
   /* The file is located at DIR/.svn/pristine/XX/XXYYZZ...svn-base */
@@ -93,19 +118,289 @@ get_pristine_fname(const char **pristine_abspath,
 }
 
 
-svn_error_t *
-svn_wc__db_pristine_get_path(const char **pristine_abspath,
-                             svn_wc__db_t *db,
-                             const char *wri_abspath,
-                             const svn_checksum_t *sha1_checksum,
-                             apr_pool_t *result_pool,
-                             apr_pool_t *scratch_pool)
+/* Baton for the streams that write and read compressed pristine files. */
+typedef struct compressed_baton_t
+{
+  /* The stream of the compressed file. */
+  svn_stream_t *inner;
+
+  /* The PRISTINE_METHOD_* of the file. */
+  char method;
+
+  /* On write, the text not yet compressed.  On read, the text of the
+     current block, of which the first READ_POS bytes have been returned. */
+  svn_stringbuf_t *text;
+  apr_size_t read_pos;
+
+  /* The compressed data of the current block. */
+  svn_stringbuf_t *packed;
+
+  /* On write, the number of bytes written so far. */
+  svn_filesize_t size;
+} compressed_baton_t;
+
+/* Return an error for the corrupt compressed pristine file. */
+static svn_error_t *
+corrupt_compressed_error(void)
+{
+  return svn_error_create(SVN_ERR_WC_CORRUPT_TEXT_BASE, NULL,
+                          _("Corrupt compressed pristine text"));
+}
+
+/* Compress CB->TEXT as one block and write it to CB->INNER. */
+static svn_error_t *
+write_block(compressed_baton_t *cb)
+{
+  unsigned char buf[SVN__MAX_ENCODED_UINT_LEN];
+  apr_size_t len;
+
+  if (cb->method == PRISTINE_METHOD_ZLIB)
+    SVN_ERR(svn__compress_zlib(cb->text->data, cb->text->len, cb->packed,
+                               SVN__COMPRESSION_ZLIB_DEFAULT));
+  else
+    SVN_ERR(svn__compress_lz4(cb->text->data, cb->text->len, cb->packed));
+
+  len = svn__encode_uint(buf, cb->packed->len) - buf;
+  SVN_ERR(svn_stream_write(cb->inner, (const char *)buf, &len));
+  len = cb->packed->len;
+  SVN_ERR(svn_stream_write(cb->inner, cb->packed->data, &len));
+
+  svn_stringbuf_setempty(cb->text);
+
+  return SVN_NO_ERROR;
+}
+
+/* Implements svn_write_fn_t for compressed pristine files. */
+static svn_error_t *
+write_compressed(void *baton,
+                 const char *data,
+                 apr_size_t *len)
+{
+  compressed_baton_t *cb = baton;
+  apr_size_t remaining = *len;
+
+  cb->size += *len;
+  while (remaining > 0)
+    {
+      apr_size_t chunk = MIN(remaining, PRISTINE_BLOCK_SIZE - cb->text->len);
+
+      svn_stringbuf_appendbytes(cb->text, data, chunk);
+      data += chunk;
+      remaining -= chunk;
+
+      if (cb->text->len == PRISTINE_BLOCK_SIZE)
+        SVN_ERR(write_block(cb));
+    }
+
+  return SVN_NO_ERROR;
+}
+
+/* Implements svn_close_fn_t for writing compressed pristine files. */
+static svn_error_t *
+close_compressed_write(void *baton)
+{
+  compressed_baton_t *cb = baton;
+
+  if (cb->text->len > 0)
+    SVN_ERR(write_block(cb));
+
+  return svn_error_trace(svn_stream_close(cb->inner));
+}
+
+/* Set *STREAM to a writable stream that compresses the text written to it
+   with METHOD into the compressed pristine file format and writes the
+   result to INNER.  Closing *STREAM closes INNER.  Set *BATON to the
+   stream's baton, unless BATON is NULL.  Allocate everything in
+   RESULT_POOL. */
+static svn_error_t *
+create_compressed_writer(svn_stream_t **stream,
+                         compressed_baton_t **baton,
+                         svn_stream_t *inner,
+                         char method,
+                         apr_pool_t *result_pool)
+{
+  compressed_baton_t *cb = apr_pcalloc(result_pool, sizeof(*cb));
+  apr_size_t len = 1;
+
+  cb->inner = inner;
+  cb->method = method;
+  cb->text = svn_stringbuf_create_ensure(PRISTINE_BLOCK_SIZE, result_pool);
+  cb->packed = svn_stringbuf_create_empty(result_pool);
+
+  SVN_ERR(svn_stream_write(inner, &cb->method, &len));
+
+  *stream = svn_stream_create(cb, result_pool);
+  svn_stream_set_write(*stream, write_compressed);
+  svn_stream_set_close(*stream, close_compressed_write);
+
+  if (baton)
+    *baton = cb;
+
+  return SVN_NO_ERROR;
+}
+
+/* Read the next block from CB->INNER and decompress it into CB->TEXT.
+   Leave CB->TEXT empty at the end of the file. */
+static svn_error_t *
+read_block(compressed_baton_t *cb)
+{
+  unsigned char buf[SVN__MAX_ENCODED_UINT_LEN];
+  apr_uint64_t packed_len;
+  apr_size_t len;
+  int i;
+
+  svn_stringbuf_setempty(cb->text);
+  cb->read_pos = 0;
+
+  /* The last byte of the block length has its high bit cleared. */
+  for (i = 0; i < SVN__MAX_ENCODED_UINT_LEN; i++)
+    {
+      len = 1;
+      SVN_ERR(svn_stream_read_full(cb->inner, (char *)&buf[i], &len));
+      if (len == 0 && i == 0)
+        return SVN_NO_ERROR;
+      else if (len == 0)
+        return svn_error_trace(corrupt_compressed_error());
+
+      if ((buf[i] & 0x80) == 0)
+        break;
+    }
+
+  if (i == SVN__MAX_ENCODED_UINT_LEN
+      || svn__decode_uint(&packed_len, buf, buf + i + 1) == NULL
+      || packed_len > PRISTINE_MAX_PACKED_SIZE)
+    return svn_error_trace(corrupt_compressed_error());
+
+  svn_stringbuf_ensure(cb->packed, (apr_size_t)packed_len);
+  len = (apr_size_t)packed_len;
+  SVN_ERR(svn_stream_read_full(cb->inner, cb->packed->data, &len));
+  if (len != packed_len)
+    return svn_error_trace(corrupt_compressed_error());
+  cb->packed->len = len;
+
+  if (cb->method == PRISTINE_METHOD_ZLIB)
+    SVN_ERR(svn__decompress_zlib(cb->packed->data, cb->packed->len,
+                                 cb->text, PRISTINE_BLOCK_SIZE));
+  else
+    SVN_ERR(svn__decompress_lz4(cb->packed->data, cb->packed->len,
+                                cb->text, PRISTINE_BLOCK_SIZE));
+
+  return SVN_NO_ERROR;
+}
+
+/* Implements svn_read_fn_t for compressed pristine files. */
+static svn_error_t *
+read_compressed(void *baton,
+                char *buffer,
+                apr_size_t *len)
+{
+  compressed_baton_t *cb = baton;
+  apr_size_t done = 0;
+
+  while (done < *len)
+    {
+      apr_size_t chunk;
+
+      if (cb->read_pos == cb->text->len)
+        {
+          SVN_ERR(read_block(cb));
+          if (cb->text->len == 0)
+            break;
+        }
+
+      chunk = MIN(*len - done, cb->text->len - cb->read_pos);
+      memcpy(buffer + done, cb->text->data + cb->read_pos, chunk);
+      cb->read_pos += chunk;
+      done += chunk;
+    }
+
+  *len = done;
+
+  return SVN_NO_ERROR;
+}
+
+/* Implements svn_close_fn_t for reading compressed pristine files. */
+static svn_error_t *
+close_compressed_read(void *baton)
+{
+  compressed_baton_t *cb = baton;
+
+  return svn_error_trace(svn_stream_close(cb->inner));
+}
+
+/* Set *STREAM to a readable stream that yields the text of the compressed
+   pristine file that can be read from INNER.  Closing *STREAM closes INNER.
+   Allocate everything in RESULT_POOL. */
+static svn_error_t *
+create_compressed_reader(svn_stream_t **stream,
+                         svn_stream_t *inner,
+                         apr_pool_t *result_pool)
+{
+  compressed_baton_t *cb = apr_pcalloc(result_pool, sizeof(*cb));
+  apr_size_t len = 1;
+
+  cb->inner = inner;
+  cb->text = svn_stringbuf_create_ensure(PRISTINE_BLOCK_SIZE, result_pool);
+  cb->packed = svn_stringbuf_create_empty(result_pool);
+
+  SVN_ERR(svn_stream_read_full(inner, &cb->method, &len));
+  if (len != 1 || (cb->method != PRISTINE_METHOD_LZ4
+                   && cb->method != PRISTINE_METHOD_ZLIB))
+    return svn_error_trace(corrupt_compressed_error());
+
+  *stream = svn_stream_create(cb, result_pool);
+  svn_stream_set_read2(*stream, NULL /* only full read support */,
+                       read_compressed);
+  svn_stream_set_close(*stream, close_compressed_read);
+
+  return SVN_NO_ERROR;
+}
+
+/* Return the PRISTINE_METHOD_* for texts that DB writes to a compressed
+   pristine store. */
+static char
+get_compression_method(svn_wc__db_t *db)
+{
+  return (db->pristine_compression == svn_wc__db_compression_zlib)
+           ? PRISTINE_METHOD_ZLIB
+           : PRISTINE_METHOD_LZ4;
+}
+
+
+/* Return the absolute path to the temporary directory for pristine text
+   files within WCROOT. */
+static char *
+pristine_get_tempdir(svn_wc__db_wcroot_t *wcroot,
+                     apr_pool_t *result_pool,
+                     apr_pool_t *scratch_pool)
+{
+  return svn_dirent_join_many(result_pool, wcroot->abspath,
+                              svn_wc_get_adm_dir(scratch_pool),
+                              PRISTINE_TEMPDIR_RELPATH, SVN_VA_NULL);
+}
+
+
+/* Set *PRISTINE_ABSPATH to the path of a plain file with the pristine text
+   identified by SHA1_CHECKSUM in the working copy of WRI_ABSPATH in DB.
+   If the store is compressed, that is a decompressed copy that is removed
+   as DELETE_WHEN says, and *IS_TEMPORARY is set to TRUE; otherwise it is
+   the pristine file itself and *IS_TEMPORARY is set to FALSE.
+
+   Allocate the path in RESULT_POOL. */
+static svn_error_t *
+get_path(const char **pristine_abspath,
+         svn_boolean_t *is_temporary,
+         svn_wc__db_t *db,
+         const char *wri_abspath,
+         const svn_checksum_t *sha1_checksum,
+         svn_io_file_del_t delete_when,
+         apr_pool_t *result_pool,
+         apr_pool_t *scratch_pool)
 {
   svn_wc__db_wcroot_t *wcroot;
   const char *local_relpath;
   svn_boolean_t present;
 
-  SVN_ERR_ASSERT(pristine_abspath != NULL);
   SVN_ERR_ASSERT(svn_dirent_is_absolute(wri_abspath));
   SVN_ERR_ASSERT(sha1_checksum != NULL);
   /* ### Transitional: accept MD-5 and look up the SHA-1.  Return an error
@@ -130,13 +425,78 @@ svn_wc__db_pristine_get_path(const char **pristine_abspath,
                              svn_checksum_to_cstring_display(sha1_checksum,
                                                              scratch_pool));
 
-  SVN_ERR(get_pristine_fname(pristine_abspath, wcroot->abspath,
+  if (STORE_IS_COMPRESSED(wcroot))
+    {
+      const char *compressed_abspath;
+      svn_stream_t *src_stream;
+      svn_stream_t *dst_stream;
+
+      /* The callers want to read a plain file, so give them a decompressed
+         copy. */
+      SVN_ERR(get_pristine_fname(&compressed_abspath, wcroot->abspath, TRUE,
+                                 sha1_checksum,
+                                 scratch_pool, scratch_pool));
+      SVN_ERR(svn_wc__db_pristine_open_file(&src_stream, compressed_abspath,
+                                            TRUE, scratch_pool,
+                                            scratch_pool));
+      SVN_ERR(svn_stream_open_unique(&dst_stream, pristine_abspath,
+                                     pristine_get_tempdir(wcroot,
+                                                          scratch_pool,
+                                                          scratch_pool),
+                                     delete_when,
+                                     result_pool, scratch_pool));
+      SVN_ERR(svn_stream_copy3(src_stream, dst_stream, NULL, NULL,
+                               scratch_pool));
+
+      *is_temporary = TRUE;
+      return SVN_NO_ERROR;
+    }
+
+  SVN_ERR(get_pristine_fname(pristine_abspath, wcroot->abspath, FALSE,
                              sha1_checksum,
                              result_pool, scratch_pool));
 
+  *is_temporary = FALSE;
   return SVN_NO_ERROR;
 }
 
+svn_error_t *
+svn_wc__db_pristine_get_path(const char **pristine_abspath,
+                             svn_wc__db_t *db,
+                             const char *wri_abspath,
+                             const svn_checksum_t *sha1_checksum,
+                             apr_pool_t *result_pool,
+                             apr_pool_t *scratch_pool)
+{
+  svn_boolean_t is_temporary;
+
+  SVN_ERR_ASSERT(pristine_abspath != NULL);
+
+  return svn_error_trace(get_path(pristine_abspath, &is_temporary,
+                                  db, wri_abspath, sha1_checksum,
+                                  svn_io_file_del_on_pool_cleanup,
+                                  result_pool, scratch_pool));
+}
+
+svn_error_t *
+svn_wc__db_pristine_get_wq_path(const char **pristine_abspath,
+                                svn_boolean_t *is_temporary,
+                                svn_wc__db_t *db,
+                                const char *wri_abspath,
+                                const svn_checksum_t *sha1_checksum,
+                                apr_pool_t *result_pool,
+                                apr_pool_t *scratch_pool)
+{
+  SVN_ERR_ASSERT(pristine_abspath != NULL);
+
+  /* Work items outlive our pools, so leave the removal of a decompressed
+     copy to the caller's work queue. */
+  return svn_error_trace(get_path(pristine_abspath, is_temporary,
+                                  db, wri_abspath, sha1_checksum,
+                                  svn_io_file_del_none,
+                                  result_pool, scratch_pool));
+}
+
 svn_error_t *
 svn_wc__db_pristine_get_future_path(const char **pristine_abspath,
                                     const char *wcroot_abspath,
@@ -144,12 +504,67 @@ svn_wc__db_pristine_get_future_path(const char **pristine_abspath,
                                     apr_pool_t *result_pool,
                                     apr_pool_t *scratch_pool)
 {
-  SVN_ERR(get_pristine_fname(pristine_abspath, wcroot_abspath,
+  SVN_ERR(get_pristine_fname(pristine_abspath, wcroot_abspath, FALSE,
                              sha1_checksum,
                              result_pool, scratch_pool));
   return SVN_NO_ERROR;
 }
 
+svn_error_t *
+svn_wc__db_pristine_get_file(const char **pristine_abspath,
+                             svn_boolean_t *compressed,
+                             svn_wc__db_t *db,
+                             const char *wri_abspath,
+                             const svn_checksum_t *sha1_checksum,
+                             apr_pool_t *result_pool,
+                             apr_pool_t *scratch_pool)
+{
+  svn_wc__db_wcroot_t *wcroot;
+  const char *local_relpath;
+
+  SVN_ERR_ASSERT(svn_dirent_is_absolute(wri_abspath));
+
+  SVN_ERR(svn_wc__db_wcroot_parse_local_abspath(&wcroot, &local_relpath,
+                                             db, wri_abspath,
+                                             scratch_pool, scratch_pool));
+  VERIFY_USABLE_WCROOT(wcroot);
+
+  *compressed = STORE_IS_COMPRESSED(wcroot);
+  SVN_ERR(get_pristine_fname(pristine_abspath, wcroot->abspath, *compressed,
+                             sha1_checksum,
+                             result_pool, scratch_pool));
+
+  return SVN_NO_ERROR;
+}
+
+svn_error_t *
+svn_wc__db_pristine_open_file(svn_stream_t **contents,
+                              const char *pristine_abspath,
+                              svn_boolean_t compressed,
+                              apr_pool_t *result_pool,
+                              apr_pool_t *scratch_pool)
+{
+  apr_file_t *file;
+
+  /* The file will remain readable even when deleted from disk; APR
+   * guarantees that on Windows as well as Unix.
+   *
+   * We also don't enable APR_BUFFERED on plain files to maximize
+   * throughput e.g. for fulltext comparison.  As we use
+   * SVN__STREAM_CHUNK_SIZE buffers where needed in streams, there is no
+   * point in having another layer of buffers.  Compressed files are read
+   * a few bytes at a time for the block headers, so buffer those. */
+  SVN_ERR(svn_io_file_open(&file, pristine_abspath,
+                           compressed ? APR_READ | APR_BUFFERED : APR_READ,
+                           APR_OS_DEFAULT, result_pool));
+  *contents = svn_stream_from_aprfile2(file, FALSE, result_pool);
+
+  if (compressed)
+    SVN_ERR(create_compressed_reader(contents, *contents, result_pool));
+
+  return SVN_NO_ERROR;
+}
+
 /* Set *CONTENTS to a readable stream from which the pristine text
  * identified by SHA1_CHECKSUM and PRISTINE_ABSPATH can be read from the
  * pristine store of WCROOT.  If SIZE is not null, set *SIZE to the size
@@ -196,20 +611,11 @@ pristine_read_txn(svn_stream_t **contents,
                                  sha1_checksum, scratch_pool));
     }
 
-  /* Open the file as a readable stream.  It will remain readable even when
-   * deleted from disk; APR guarantees that on Windows as well as Unix.
-   *
-   * We also don't enable APR_BUFFERED on this file to maximize throughput
-   * e.g. for fulltext comparison.  As we use SVN__STREAM_CHUNK_SIZE buffers
-   * where needed in streams, there is no point in having another layer of
-   * buffers. */
+  /* Open the file as a readable stream. */
   if (contents)
-    {
-      apr_file_t *file;
-      SVN_ERR(svn_io_file_open(&file, pristine_abspath, APR_READ,
-                               APR_OS_DEFAULT, result_pool));
-      *contents = svn_stream_from_aprfile2(file, FALSE, result_pool);
-    }
+    SVN_ERR(svn_wc__db_pristine_open_file(contents, pristine_abspath,
+                                          STORE_IS_COMPRESSED(wcroot),
+                                          result_pool, scratch_pool));
 
   return SVN_NO_ERROR;
 }
@@ -244,7 +650,7 @@ svn_wc__db_pristine_read(svn_stream_t **contents,
   VERIFY_USABLE_WCROOT(wcroot);
 
   SVN_ERR(get_pristine_fname(&pristine_abspath, wcroot->abspath,
-                             sha1_checksum,
+                             STORE_IS_COMPRESSED(wcroot), sha1_checksum,
                              scratch_pool, scratch_pool));
   SVN_WC__DB_WITH_TXN(
     pristine_read_txn(contents, size,
@@ -255,22 +661,10 @@ svn_wc__db_pristine_read(svn_stream_t **contents,
   return SVN_NO_ERROR;
 }
 
-
-/* Return the absolute path to the temporary directory for pristine text
-   files within WCROOT. */
-static char *
-pristine_get_tempdir(svn_wc__db_wcroot_t *wcroot,
-                     apr_pool_t *result_pool,
-                     apr_pool_t *scratch_pool)
-{
-  return svn_dirent_join_many(result_pool, wcroot->abspath,
-                              svn_wc_get_adm_dir(scratch_pool),
-                              PRISTINE_TEMPDIR_RELPATH, SVN_VA_NULL);
-}
-
 /* Install the pristine text described by BATON into the pristine store of
  * SDB.  If it is already stored then just delete the new file
- * BATON->tempfile_abspath.
+ * BATON->tempfile_abspath.  COMPRESSED tells whether the store is
+ * compressed.
  *
  * This function expects to be executed inside a SQLite txn that has already
  * acquired a 'RESERVED' lock.
@@ -287,6 +681,9 @@ pristine_install_txn(svn_sqlite__db_t *sdb,
                      const svn_checksum_t *sha1_checksum,
                      /* The pristine text's MD-5 checksum. */
                      const svn_checksum_t *md5_checksum,
+                     /* The pristine text's size, before compression. */
+                     svn_filesize_t size,
+                     svn_boolean_t compressed,
                      apr_pool_t *scratch_pool)
 {
   svn_sqlite__stmt_t *stmt;
@@ -302,7 +699,8 @@ pristine_install_txn(svn_sqlite__db_t *sdb,
   if (have_row)
     {
 #ifdef SVN_DEBUG
-      /* Consistency checks.  Verify both files exist and match.
+      /* Consistency checks.  Verify both files exist and match.  Compressed
+       * files may use different compression methods.
        * ### We could check much more. */
       {
         apr_finfo_t finfo1, finfo2;
@@ -312,7 +710,7 @@ pristine_install_txn(svn_sqlite__db_t *sdb,
 
         SVN_ERR(svn_io_stat(&finfo2, pristine_abspath, APR_FINFO_SIZE,
                             scratch_pool));
-        if (finfo1.size != finfo2.size)
+        if (! compressed && finfo1.size != finfo2.size)
           {
             return svn_error_createf(
               SVN_ERR_WC_CORRUPT_TEXT_BASE, NULL,
@@ -331,21 +729,16 @@ pristine_install_txn(svn_sqlite__db_t *sdb,
 
   /* Move the file to its target location.  (If it is already there, it is
    * an orphan file and it doesn't matter if we overwrite it.) */
-  {
-    apr_finfo_t finfo;
-    SVN_ERR(svn_stream__install_get_info(&finfo, install_stream,
-                                         APR_FINFO_SIZE, scratch_pool));
-    SVN_ERR(svn_stream__install_stream(install_stream, pristine_abspath,
-                                       TRUE, scratch_pool));
-
-    SVN_ERR(svn_sqlite__get_statement(&stmt, sdb, STMT_INSERT_PRISTINE));
-    SVN_ERR(svn_sqlite__bind_checksum(stmt, 1, sha1_checksum, scratch_pool));
-    SVN_ERR(svn_sqlite__bind_checksum(stmt, 2, md5_checksum, scratch_pool));
-    SVN_ERR(svn_sqlite__bind_int64(stmt, 3, finfo.size));
-    SVN_ERR(svn_sqlite__insert(NULL, stmt));
-
-    SVN_ERR(svn_io_set_file_read_only(pristine_abspath, FALSE, scratch_pool));
-  }
+  SVN_ERR(svn_stream__install_stream(install_stream, pristine_abspath,
+                                     TRUE, scratch_pool));
+
+  SVN_ERR(svn_sqlite__get_statement(&stmt, sdb, STMT_INSERT_PRISTINE));
+  SVN_ERR(svn_sqlite__bind_checksum(stmt, 1, sha1_checksum, scratch_pool));
+  SVN_ERR(svn_sqlite__bind_checksum(stmt, 2, md5_checksum, scratch_pool));
+  SVN_ERR(svn_sqlite__bind_int64(stmt, 3, size));
+  SVN_ERR(svn_sqlite__insert(NULL, stmt));
+
+  SVN_ERR(svn_io_set_file_read_only(pristine_abspath, FALSE, scratch_pool));
 
   return SVN_NO_ERROR;
 }
@@ -354,6 +747,10 @@ struct svn_wc__db_install_data_t
 {
   svn_wc__db_wcroot_t *wcroot;
   svn_stream_t *inner_stream;
+
+  /* The baton of the compressing stream in front of INNER_STREAM if the
+     pristine store is compressed, else NULL. */
+  compressed_baton_t *compressor;
 };
 
 svn_error_t *
@@ -388,6 +785,11 @@ svn_wc__db_pristine_prepare_install(svn_stream_t **stream,
 
   (*install_data)->inner_stream = *stream;
 
+  if (STORE_IS_COMPRESSED(wcroot))
+    SVN_ERR(create_compressed_writer(stream, &(*install_data)->compressor,
+                                     *stream, get_compression_method(db),
+                                     result_pool));
+
   if (md5_checksum)
     *stream = svn_stream_checksummed2(*stream, NULL, md5_checksum,
                                       svn_checksum_md5, FALSE, result_pool);
@@ -406,6 +808,7 @@ svn_wc__db_pristine_install(svn_wc__db_install_data_t *install_data,
 {
   svn_wc__db_wcroot_t *wcroot = install_data->wcroot;
   const char *pristine_abspath;
+  svn_filesize_t size;
 
   SVN_ERR_ASSERT(sha1_checksum != NULL);
   SVN_ERR_ASSERT(sha1_checksum->kind == svn_checksum_sha1);
@@ -413,16 +816,29 @@ svn_wc__db_pristine_install(svn_wc__db_install_data_t *install_data,
   SVN_ERR_ASSERT(md5_checksum->kind == svn_checksum_md5);
 
   SVN_ERR(get_pristine_fname(&pristine_abspath, wcroot->abspath,
-                             sha1_checksum,
+                             STORE_IS_COMPRESSED(wcroot), sha1_checksum,
                              scratch_pool, scratch_pool));
 
+  /* The file size of compressed texts is not their size. */
+  if (install_data->compressor)
+    size = install_data->compressor->size;
+  else
+    {
+      apr_finfo_t finfo;
+
+      SVN_ERR(svn_stream__install_get_info(&finfo,
+                                           install_data->inner_stream,
+                                           APR_FINFO_SIZE, scratch_pool));
+      size = finfo.size;
+    }
+
   /* Ensure the SQL txn has at least a 'RESERVED' lock before we start looking
    * at the disk, to ensure no concurrent pristine install/delete txn. */
   SVN_SQLITE__WITH_IMMEDIATE_TXN(
     pristine_install_txn(wcroot->sdb,
                          install_data->inner_stream, pristine_abspath,
-                         sha1_checksum, md5_checksum,
-                         scratch_pool),
+                         sha1_checksum, md5_checksum, size,
+                         STORE_IS_COMPRESSED(wcroot), scratch_pool),
     wcroot->sdb);
 
   return SVN_NO_ERROR;
@@ -514,9 +930,11 @@ svn_wc__db_pristine_get_sha1(const svn_checksum_t **sha1_checksum,
 }
 
 /* Handle the moving of a pristine from SRC_WCROOT to DST_WCROOT. The existing
-   pristine in SRC_WCROOT is described by CHECKSUM, MD5_CHECKSUM and SIZE */
+   pristine in SRC_WCROOT is described by CHECKSUM, MD5_CHECKSUM and SIZE.
+   Compress it as DB asks for if only DST_WCROOT has a compressed store. */
 static svn_error_t *
-maybe_transfer_one_pristine(svn_wc__db_wcroot_t *src_wcroot,
+maybe_transfer_one_pristine(svn_wc__db_t *db,
+                            svn_wc__db_wcroot_t *src_wcroot,
                             svn_wc__db_wcroot_t *dst_wcroot,
                             const svn_checksum_t *checksum,
                             const svn_checksum_t *md5_checksum,
@@ -552,18 +970,32 @@ maybe_transfer_one_pristine(svn_wc__db_wcroot_t *src_wcroot,
                                  svn_io_file_del_on_pool_cleanup,
                                  scratch_pool, scratch_pool));
 
-  SVN_ERR(get_pristine_fname(&src_abspath, src_wcroot->abspath, checksum,
+  SVN_ERR(get_pristine_fname(&src_abspath, src_wcroot->abspath,
+                             STORE_IS_COMPRESSED(src_wcroot), checksum,
                              scratch_pool, scratch_pool));
 
-  SVN_ERR(svn_stream_open_readonly(&src_stream, src_abspath,
-                                   scratch_pool, scratch_pool));
+  if (STORE_IS_COMPRESSED(src_wcroot) == STORE_IS_COMPRESSED(dst_wcroot))
+    SVN_ERR(svn_stream_open_readonly(&src_stream, src_abspath,
+                                     scratch_pool, scratch_pool));
+  else
+    {
+      /* Convert the text to the format of the destination store. */
+      SVN_ERR(svn_wc__db_pristine_open_file(&src_stream, src_abspath,
+                                            STORE_IS_COMPRESSED(src_wcroot),
+                                            scratch_pool, scratch_pool));
+      if (STORE_IS_COMPRESSED(dst_wcroot))
+        SVN_ERR(create_compressed_writer(&dst_stream, NULL, dst_stream,
+                                         get_compression_method(db),
+                                         scratch_pool));
+    }
 
   /* ### Should we verify the SHA1 or MD5 here, or is that too expensive? */
   SVN_ERR(svn_stream_copy3(src_stream, dst_stream,
                            cancel_func, cancel_baton,
                            scratch_pool));
 
-  SVN_ERR(get_pristine_fname(&pristine_abspath, dst_wcroot->abspath, checksum,
+  SVN_ERR(get_pristine_fname(&pristine_abspath, dst_wcroot->abspath,
+                             STORE_IS_COMPRESSED(dst_wcroot), checksum,
                              scratch_pool, scratch_pool));
 
   /* Move the file to its target location.  (If it is already there, it is
@@ -600,7 +1032,8 @@ maybe_transfer_one_pristine(svn_wc__db_wcroot_t *src_wcroot,
    We have a lock on DST_WCROOT.
  */
 static svn_error_t *
-pristine_transfer_txn(svn_wc__db_wcroot_t *src_wcroot,
+pristine_transfer_txn(svn_wc__db_t *db,
+                       svn_wc__db_wcroot_t *src_wcroot,
                        svn_wc__db_wcroot_t *dst_wcroot,
                        const char *src_relpath,
                        svn_cancel_func_t cancel_func,
@@ -631,7 +1064,7 @@ pristine_transfer_txn(svn_wc__db_wcroot_t *src_wcroot,
       SVN_ERR(svn_sqlite__column_checksum(&md5_checksum, stmt, 1, iterpool));
       size = svn_sqlite__column_int64(stmt, 2);
 
-      err = maybe_transfer_one_pristine(src_wcroot, dst_wcroot,
+      err = maybe_transfer_one_pristine(db, src_wcroot, dst_wcroot,
                                         checksum, md5_checksum, size,
                                         cancel_func, cancel_baton,
                                         iterpool);
@@ -677,7 +1110,7 @@ svn_wc__db_pristine_transfer(svn_wc__db_t *db,
     }
 
   SVN_WC__DB_WITH_TXN(
-    pristine_transfer_txn(src_wcroot, dst_wcroot, src_relpath,
+    pristine_transfer_txn(db, src_wcroot, dst_wcroot, src_relpath,
                           cancel_func, cancel_baton, scratch_pool),
     dst_wcroot);
 
@@ -685,6 +1118,214 @@ svn_wc__db_pristine_transfer(svn_wc__db_t *db,
 }
 
 
+/* Write the pristine text identified by SHA1_CHECKSUM in the pristine store
+ * of WCROOT to a new file in the other store format: compressed with METHOD
+ * if COMPRESS, else uncompressed.  Leave the existing file alone and do
+ * nothing if it is missing.
+ */
+static svn_error_t *
+convert_one_pristine(svn_wc__db_wcroot_t *wcroot,
+                     const svn_checksum_t *sha1_checksum,
+                     svn_boolean_t compress,
+                     char method,
+                     svn_cancel_func_t cancel_func,
+                     void *cancel_baton,
+                     apr_pool_t *scratch_pool)
+{
+  const char *src_abspath;
+  const char *dst_abspath;
+  const char *tmp_abspath;
+  svn_stream_t *src_stream;
+  svn_stream_t *dst_stream;
+  svn_error_t *err;
+
+  SVN_ERR(get_pristine_fname(&src_abspath, wcroot->abspath, !compress,
+                             sha1_checksum, scratch_pool, scratch_pool));
+  SVN_ERR(get_pristine_fname(&dst_abspath, wcroot->abspath, compress,
+                             sha1_checksum, scratch_pool, scratch_pool));
+
+  err = svn_wc__db_pristine_open_file(&src_stream, src_abspath, !compress,
+                                      scratch_pool, scratch_pool);
+  if (err && APR_STATUS_IS_ENOENT(err->apr_err))
+    {
+      /* Converting the store doesn't make this any worse. */
+      svn_error_clear(err);
+      return SVN_NO_ERROR;
+    }
+  SVN_ERR(err);
+
+  SVN_ERR(svn_stream_open_unique(&dst_stream, &tmp_abspath,
+                                 pristine_get_tempdir(wcroot,
+                                                      scratch_pool,
+                                                      scratch_pool),
+                                 svn_io_file_del_on_pool_cleanup,
+                                 scratch_pool, scratch_pool));
+  if (compress)
+    SVN_ERR(create_compressed_writer(&dst_stream, NULL, dst_stream, method,
+                                     scratch_pool));
+
+  SVN_ERR(svn_stream_copy3(src_stream, dst_stream,
+                           cancel_func, cancel_baton,
+                           scratch_pool));
+
+  /* The new file goes next to the old one, so its directory exists. */
+  SVN_ERR(svn_io_file_rename2(tmp_abspath, dst_abspath, FALSE,
+                              scratch_pool));
+
+  return svn_error_trace(svn_io_set_file_read_only(dst_abspath, FALSE,
+                                                   scratch_pool));
+}
+
+/* Transaction implementation of svn_wc__db_pristine_convert_store().
+ * Write all texts in the pristine store of WCROOT in the other store
+ * format, as described for convert_one_pristine(), and switch WCROOT's
+ * database to the format of that store.
+ *
+ * This function expects to be executed inside a SQLite txn that has already
+ * acquired a 'RESERVED' lock.
+ */
+static svn_error_t *
+convert_store_txn(svn_wc__db_wcroot_t *wcroot,
+                  svn_boolean_t compress,
+                  char method,
+                  svn_cancel_func_t cancel_func,
+                  void *cancel_baton,
+                  apr_pool_t *scratch_pool)
+{
+  svn_sqlite__stmt_t *stmt;
+  svn_boolean_t have_row;
+  apr_pool_t *iterpool = svn_pool_create(scratch_pool);
+
+  SVN_ERR(svn_sqlite__get_statement(&stmt, wcroot->sdb,
+                                    STMT_SELECT_ALL_PRISTINES));
+  SVN_ERR(svn_sqlite__step(&have_row, stmt));
+
+  while (have_row)
+    {
+      const svn_checksum_t *sha1_checksum;
+      svn_error_t *err;
+
+      svn_pool_clear(iterpool);
+
+      SVN_ERR(svn_sqlite__column_checksum(&sha1_checksum, stmt, 0,
+                                          iterpool));
+      err = convert_one_pristine(wcroot, sha1_checksum, compress, method,
+                                 cancel_func, cancel_baton, iterpool);
+      if (err)
+        return svn_error_trace(svn_error_compose_create(
+                                    err,
+                                    svn_sqlite__reset(stmt)));
+
+      SVN_ERR(svn_sqlite__step(&have_row, stmt));
+    }
+  SVN_ERR(svn_sqlite__reset(stmt));
+
+  svn_pool_destroy(iterpool);
+
+  return svn_error_trace(svn_sqlite__exec_statements(
+                            wcroot->sdb,
+                            compress
+                              ? STMT_SET_COMPRESSED_PRISTINES_FORMAT
+                              : STMT_SET_PLAIN_PRISTINES_FORMAT));
+}
+
+/* Remove the files that hold the texts in the pristine store of WCROOT in
+ * the compressed store format if COMPRESSED, else in the uncompressed one.
+ * Ignore missing files.
+ */
+static svn_error_t *
+remove_pristine_files(svn_wc__db_wcroot_t *wcroot,
+                      svn_boolean_t compressed,
+                      svn_cancel_func_t cancel_func,
+                      void *cancel_baton,
+                      apr_pool_t *scratch_pool)
+{
+  svn_sqlite__stmt_t *stmt;
+  svn_boolean_t have_row;
+  svn_error_t *err = SVN_NO_ERROR;
+  apr_pool_t *iterpool = svn_pool_create(scratch_pool);
+
+  SVN_ERR(svn_sqlite__get_statement(&stmt, wcroot->sdb,
+                                    STMT_SELECT_ALL_PRISTINES));
+  SVN_ERR(svn_sqlite__step(&have_row, stmt));
+
+  while (have_row && !err)
+    {
+      const svn_checksum_t *sha1_checksum;
+      const char *pristine_abspath;
+
+      svn_pool_clear(iterpool);
+
+      if (cancel_func)
+        err = cancel_func(cancel_baton);
+
+      if (!err)
+        err = svn_sqlite__column_checksum(&sha1_checksum, stmt, 0, iterpool);
+      if (!err)
+        err = get_pristine_fname(&pristine_abspath, wcroot->abspath,
+                                 compressed, sha1_checksum,
+                                 iterpool, iterpool);
+      if (!err)
+        err = svn_io_remove_file2(pristine_abspath, TRUE, iterpool);
+      if (!err)
+        err = svn_sqlite__step(&have_row, stmt);
+    }
+
+  svn_pool_destroy(iterpool);
+
+  return svn_error_trace(
+      svn_error_compose_create(err, svn_sqlite__reset(stmt)));
+}
+
+svn_error_t *
+svn_wc__db_pristine_convert_store(svn_boolean_t *converted,
+                                  svn_wc__db_t *db,
+                                  const char *wcroot_abspath,
+                                  svn_cancel_func_t cancel_func,
+                                  void *cancel_baton,
+                                  apr_pool_t *scratch_pool)
+{
+  svn_wc__db_wcroot_t *wcroot;
+  const char *local_relpath;
+  svn_boolean_t compress;
+
+  SVN_ERR_ASSERT(svn_dirent_is_absolute(wcroot_abspath));
+
+  if (converted)
+    *converted = FALSE;
+
+  if (db->pristine_compression == svn_wc__db_compression_unset)
+    return SVN_NO_ERROR;
+
+  SVN_ERR(svn_wc__db_wcroot_parse_local_abspath(&wcroot, &local_relpath, db,
+                              wcroot_abspath, scratch_pool, scratch_pool));
+  VERIFY_USABLE_WCROOT(wcroot);
+
+  compress = (db->pristine_compression != svn_wc__db_compression_none);
+  if (compress == STORE_IS_COMPRESSED(wcroot))
+    return SVN_NO_ERROR;
+
+  /* Write all texts in the new format before switching to it and remove
+   * the old files only afterwards, so that the working copy stays usable
+   * if we get interrupted.  Ensure the SQL txn has at least a 'RESERVED'
+   * lock before we start, to keep out concurrent pristine installs. */
+  SVN_SQLITE__WITH_IMMEDIATE_TXN(
+    convert_store_txn(wcroot, compress, get_compression_method(db),
+                      cancel_func, cancel_baton, scratch_pool),
+    wcroot->sdb);
+
+  wcroot->format = compress ? SVN_WC__COMPRESSED_PRISTINES : SVN_WC__VERSION;
+
+  SVN_ERR(remove_pristine_files(wcroot, !compress, cancel_func, cancel_baton,
+                                scratch_pool));
+
+  if (converted)
+    *converted = TRUE;
+
+  return SVN_NO_ERROR;
+}
+
+
 
 
 /* If the pristine text referenced by SHA1_CHECKSUM in WCROOT/SDB, whose path
@@ -742,7 +1383,8 @@ pristine_remove_if_unreferenced(svn_wc__db_wcroot_t *wcroot,
   const char *pristine_abspath;
 
   SVN_ERR(get_pristine_fname(&pristine_abspath, wcroot->abspath,
-                             sha1_checksum, scratch_pool, scratch_pool));
+                             STORE_IS_COMPRESSED(wcroot), sha1_checksum,
+                             scratch_pool, scratch_pool));
 
   /* Ensure the SQL txn has at least a 'RESERVED' lock before we start looking
    * at the disk, to ensure no concurrent pristine install/delete txn. */
@@ -917,7 +1559,8 @@ svn_wc__db_pristine_check(svn_boolean_t *present,
     svn_error_t *err;
 
     SVN_ERR(get_pristine_fname(&pristine_abspath, wcroot->abspath,
-                               sha1_checksum, scratch_pool, scratch_pool));
+                               STORE_IS_COMPRESSED(wcroot), sha1_checksum,
+                               scratch_pool, scratch_pool));
     err = svn_io_check_path(pristine_abspath, &kind_on_disk, scratch_pool);
 #ifdef WIN32
     if (err && err->apr_err == APR_FROM_OS_ERROR(ERROR_ACCESS_DENIED))
@@ -33,6 +33,16 @@
 #include "wc_db.h"
 
 
+/* How the "compress-pristines" option asks to store pristine texts. */
+typedef enum svn_wc__db_compression_t
+{
+  /* Not configured; keep the pristine store as it is. */
+  svn_wc__db_compression_unset = 0,
+  svn_wc__db_compression_none,
+  svn_wc__db_compression_lz4,
+  svn_wc__db_compression_zlib
+} svn_wc__db_compression_t;
+
 struct svn_wc__db_t {
   /* We need the config whenever we run into a new WC directory, in order
      to figure out where we should look for the corresponding datastore. */
@@ -52,6 +62,17 @@ struct svn_wc__db_t {
   /* Busy timeout in ms., 0 for the libsvn_subr default. */
   apr_int32_t timeout;
 
+  /* Number of threads that the status walk may use, at least 1. */
+  int status_threads;
+
+  /* Number of threads that may run file install and remove work items,
+     at least 1. */
+  int install_threads;
+
+  /* How new working copies should store their pristine texts and how
+     'svn upgrade' should convert the pristine store. */
+  svn_wc__db_compression_t pristine_compression;
+
   /* Map a given working copy directory to its relevant data.
      const char *local_abspath -> svn_wc__db_wcroot_t *wcroot  */
   apr_hash_t *dir_data;
@@ -155,7 +176,7 @@ svn_wc__db_verify_no_work(svn_sqlite__db_t *sdb);
 /* Assert that the given WCROOT is usable.
    NOTE: the expression is multiply-evaluated!!  */
 #define VERIFY_USABLE_WCROOT(wcroot)  SVN_ERR_ASSERT(               \
-    (wcroot) != NULL && (wcroot)->format == SVN_WC__VERSION)
+    (wcroot) != NULL && SVN_WC__IS_CURRENT_FORMAT((wcroot)->format))
 
 /* Check if the WCROOT is usable for light db operations such as path
    calculations */
@@ -1286,6 +1286,32 @@ tc_editor_alter_directory(node_move_baton_t *nmb,
   return SVN_NO_ERROR;
 }
 
+/* If IS_TEMPORARY, append a work item that removes TEMP_ABSPATH, a
+ * decompressed pristine copy from svn_wc__db_pristine_get_wq_path() in
+ * the working copy of WRI_ABSPATH in DB, to *WORK_ITEMS.
+ * Allocate the work item in SCRATCH_POOL, like the other work items of
+ * the update move editor. */
+static svn_error_t *
+queue_temp_file_removal(svn_skel_t **work_items,
+                        svn_wc__db_t *db,
+                        const char *wri_abspath,
+                        const char *temp_abspath,
+                        svn_boolean_t is_temporary,
+                        apr_pool_t *scratch_pool)
+{
+  svn_skel_t *work_item;
+
+  if (! is_temporary)
+    return SVN_NO_ERROR;
+
+  SVN_ERR(svn_wc__wq_build_file_remove(&work_item, db, wri_abspath,
+                                       temp_abspath,
+                                       scratch_pool, scratch_pool));
+  *work_items = svn_wc__wq_merge(*work_items, work_item, scratch_pool);
+
+  return SVN_NO_ERROR;
+}
+
 /* Edit the file found at the move destination, which is initially at
  * the old state.  Merge the changes into the "working"/"actual" file.
  *
@@ -1319,6 +1345,7 @@ tc_editor_alter_file(node_move_baton_t *nmb,
                                               scratch_pool);
   const char *old_pristine_abspath;
   const char *new_pristine_abspath;
+  svn_boolean_t delete_old, delete_new;
   svn_skel_t *conflict_skel = NULL;
   apr_hash_t *actual_props;
   apr_array_header_t *propchanges;
@@ -1388,14 +1415,18 @@ tc_editor_alter_file(node_move_baton_t *nmb,
            * text as the merge-left version, and the current content of the
            * moved-here working file as the merge-right version.
            */
-          SVN_ERR(svn_wc__db_pristine_get_path(&old_pristine_abspath,
-                                               b->db, b->wcroot->abspath,
-                                               old_version.checksum,
-                                               scratch_pool, scratch_pool));
-          SVN_ERR(svn_wc__db_pristine_get_path(&new_pristine_abspath,
-                                               b->db, b->wcroot->abspath,
-                                               new_version.checksum,
-                                               scratch_pool, scratch_pool));
+          SVN_ERR(svn_wc__db_pristine_get_wq_path(&old_pristine_abspath,
+                                                  &delete_old,
+                                                  b->db, b->wcroot->abspath,
+                                                  old_version.checksum,
+                                                  scratch_pool,
+                                                  scratch_pool));
+          SVN_ERR(svn_wc__db_pristine_get_wq_path(&new_pristine_abspath,
+                                                  &delete_new,
+                                                  b->db, b->wcroot->abspath,
+                                                  new_version.checksum,
+                                                  scratch_pool,
+                                                  scratch_pool));
           SVN_ERR(svn_wc__internal_merge(&work_item, &conflict_skel,
                                          &merge_outcome, b->db,
                                          old_pristine_abspath,
@@ -1412,6 +1443,14 @@ tc_editor_alter_file(node_move_baton_t *nmb,
                                          scratch_pool, scratch_pool));
 
           work_items = svn_wc__wq_merge(work_items, work_item, scratch_pool);
+          SVN_ERR(queue_temp_file_removal(&work_items, b->db,
+                                          b->wcroot->abspath,
+                                          old_pristine_abspath, delete_old,
+                                          scratch_pool));
+          SVN_ERR(queue_temp_file_removal(&work_items, b->db,
+                                          b->wcroot->abspath,
+                                          new_pristine_abspath, delete_new,
+                                          scratch_pool));
 
           if (merge_outcome == svn_wc_merge_conflict)
             content_state = svn_wc_notify_state_conflicted;
@@ -1596,6 +1635,7 @@ tc_editor_update_incoming_moved_file(node_move_baton_t *nmb,
       if (do_text_merge)
         {
           const char *old_pristine_abspath;
+          svn_boolean_t delete_old;
           const char *src_abspath;
           const char *label_left;
           const char *label_target;
@@ -1607,10 +1647,12 @@ tc_editor_update_incoming_moved_file(node_move_baton_t *nmb,
            * content of the working file at the pre-move location as the
            * merge-left version.
            */
-          SVN_ERR(svn_wc__db_pristine_get_path(&old_pristine_abspath,
-                                               b->db, b->wcroot->abspath,
-                                               src_checksum,
-                                               scratch_pool, scratch_pool));
+          SVN_ERR(svn_wc__db_pristine_get_wq_path(&old_pristine_abspath,
+                                                  &delete_old,
+                                                  b->db, b->wcroot->abspath,
+                                                  src_checksum,
+                                                  scratch_pool,
+                                                  scratch_pool));
           src_abspath = svn_dirent_join(b->wcroot->abspath, src_relpath,
                                         scratch_pool);
           label_left = apr_psprintf(scratch_pool, ".r%ld",
@@ -1635,6 +1677,10 @@ tc_editor_update_incoming_moved_file(node_move_baton_t *nmb,
                                          scratch_pool, scratch_pool));
 
           work_items = svn_wc__wq_merge(work_items, work_item, scratch_pool);
+          SVN_ERR(queue_temp_file_removal(&work_items, b->db,
+                                          b->wcroot->abspath,
+                                          old_pristine_abspath, delete_old,
+                                          scratch_pool));
 
           if (merge_outcome == svn_wc_merge_conflict)
             content_state = svn_wc_notify_state_conflicted;
@@ -3161,6 +3207,7 @@ tc_editor_update_add_merge_files(added_node_baton_t *nb,
     {
       const char *empty_file_abspath;
       const char *pristine_abspath;
+      svn_boolean_t delete_pristine;
       svn_skel_t *work_item = NULL;
 
       /*
@@ -3172,9 +3219,11 @@ tc_editor_update_add_merge_files(added_node_baton_t *nb,
       SVN_ERR(svn_io_open_unique_file3(NULL, &empty_file_abspath, NULL,
                                        svn_io_file_del_on_pool_cleanup,
                                        scratch_pool, scratch_pool));
-      SVN_ERR(svn_wc__db_pristine_get_path(&pristine_abspath, b->db,
-                                           b->wcroot->abspath, base_checksum,
-                                           scratch_pool, scratch_pool));
+      SVN_ERR(svn_wc__db_pristine_get_wq_path(&pristine_abspath,
+                                              &delete_pristine, b->db,
+                                              b->wcroot->abspath,
+                                              base_checksum,
+                                              scratch_pool, scratch_pool));
 
       /* Create a property diff which shows all props as added. */
       SVN_ERR(svn_prop_diffs(&propchanges, working_props,
@@ -3196,6 +3245,10 @@ tc_editor_update_add_merge_files(added_node_baton_t *nb,
                                      scratch_pool, scratch_pool));
 
       work_items = svn_wc__wq_merge(work_items, work_item, scratch_pool);
+      SVN_ERR(queue_temp_file_removal(&work_items, b->db,
+                                      b->wcroot->abspath,
+                                      pristine_abspath, delete_pristine,
+                                      scratch_pool));
 
       if (merge_outcome == svn_wc_merge_conflict)
         content_state = svn_wc_notify_state_conflicted;
@@ -29,6 +29,8 @@
 #include "svn_hash.h"
 #include "svn_path.h"
 #include "svn_pools.h"
+#include "svn_sorts.h"
+#include "svn_string.h"
 #include "svn_version.h"
 
 #include "wc.h"
@@ -43,6 +45,12 @@
 #define UNKNOWN_WC_ID ((apr_int64_t) -1)
 #define FORMAT_FROM_SDB (-1)
 
+/* Upper limit for the status-threads configuration option. */
+#define MAX_STATUS_THREADS 64
+
+/* Upper limit for the install-threads configuration option. */
+#define MAX_INSTALL_THREADS 64
+
 /* #define VERIFY_ON_CLOSE */
 
 /* Get the format version from a wc-1 directory. If it is not a working copy
@@ -232,6 +240,8 @@ svn_wc__db_open(svn_wc__db_t **db,
   (*db)->verify_format = !open_without_upgrade;
   (*db)->enforce_empty_wq = enforce_empty_wq;
   (*db)->dir_data = apr_hash_make(result_pool);
+  (*db)->status_threads = 1;
+  (*db)->install_threads = 1;
 
   (*db)->state_pool = result_pool;
 
@@ -241,6 +251,8 @@ svn_wc__db_open(svn_wc__db_t **db,
       svn_error_t *err;
       svn_boolean_t sqlite_exclusive = FALSE;
       apr_int64_t timeout;
+      apr_int64_t threads;
+      const char *compression;
 
       err = svn_config_get_bool(config, &sqlite_exclusive,
                                 SVN_CONFIG_SECTION_WORKING_COPY,
@@ -261,12 +273,109 @@ svn_wc__db_open(svn_wc__db_t **db,
         svn_error_clear(err);
       else
         (*db)->timeout = (apr_int32_t)timeout;
+
+      err = svn_config_get_int64(config, &threads,
+                                 SVN_CONFIG_SECTION_WORKING_COPY,
+                                 SVN_CONFIG_OPTION_STATUS_THREADS,
+                                 1);
+      if (err || threads < 1)
+        svn_error_clear(err);
+      else
+        (*db)->status_threads = (int)MIN(threads, MAX_STATUS_THREADS);
+
+      err = svn_config_get_int64(config, &threads,
+                                 SVN_CONFIG_SECTION_WORKING_COPY,
+                                 SVN_CONFIG_OPTION_INSTALL_THREADS,
+                                 1);
+      if (err || threads < 1)
+        svn_error_clear(err);
+      else
+        (*db)->install_threads = (int)MIN(threads, MAX_INSTALL_THREADS);
+
+      svn_config_get(config, &compression,
+                     SVN_CONFIG_SECTION_WORKING_COPY,
+                     SVN_CONFIG_OPTION_COMPRESS_PRISTINES, NULL);
+      if (compression == NULL)
+        ; /* Leave the pristine store as it is. */
+      else if (svn_cstring_casecmp(compression, "lz4") == 0)
+        (*db)->pristine_compression = svn_wc__db_compression_lz4;
+      else if (svn_cstring_casecmp(compression, "zlib") == 0)
+        (*db)->pristine_compression = svn_wc__db_compression_zlib;
+      else
+        {
+          svn_boolean_t compress;
+
+          /* "yes" picks the fast method. */
+          err = svn_config_get_bool(config, &compress,
+                                    SVN_CONFIG_SECTION_WORKING_COPY,
+                                    SVN_CONFIG_OPTION_COMPRESS_PRISTINES,
+                                    FALSE);
+          if (err)
+            svn_error_clear(err);
+          else
+            (*db)->pristine_compression = compress
+                                          ? svn_wc__db_compression_lz4
+                                          : svn_wc__db_compression_none;
+        }
     }
 
   return SVN_NO_ERROR;
 }
 
 
+svn_error_t *
+svn_wc__db_open_reader(svn_wc__db_t **reader,
+                       svn_wc__db_t *db,
+                       apr_pool_t *result_pool,
+                       apr_pool_t *scratch_pool)
+{
+  /* Don't share the config with another thread; we already have all we
+     need from it. */
+  SVN_ERR(svn_wc__db_open(reader, NULL, !db->verify_format, FALSE,
+                          result_pool, scratch_pool));
+  (*reader)->timeout = db->timeout;
+
+  return SVN_NO_ERROR;
+}
+
+
+int
+svn_wc__db_get_status_threads(svn_wc__db_t *db)
+{
+#if APR_HAS_THREADS
+  /* Other connections can't read exclusively locked databases. */
+  if (!db->exclusive)
+    return db->status_threads;
+#endif
+
+  return 1;
+}
+
+
+int
+svn_wc__db_get_compare_threads(svn_wc__db_t *db)
+{
+#if APR_HAS_THREADS
+  /* Comparing files doesn't need the database. */
+  return db->status_threads;
+#else
+  return 1;
+#endif
+}
+
+
+int
+svn_wc__db_get_install_threads(svn_wc__db_t *db)
+{
+#if APR_HAS_THREADS
+  /* The threads don't use the database. */
+  return db->install_threads;
+#else
+  return 1;
+#endif
+}
+
+
 svn_error_t *
 svn_wc__db_close(svn_wc__db_t *db)
 {
@@ -321,7 +430,7 @@ svn_wc__db_pdh_create_wcroot(svn_wc__db_wcroot_t **wcroot,
     }
 
   /* If this working copy is from a future version, then bail out.  */
-  if (format > SVN_WC__VERSION)
+  if (format > SVN_WC__VERSION && format != SVN_WC__COMPRESSED_PRISTINES)
     {
       return svn_error_createf(
         SVN_ERR_WC_UNSUPPORTED_FORMAT, NULL,
@@ -22,6 +22,9 @@
  */
 
 #include <apr_pools.h>
+#if APR_HAS_THREADS
+#include <apr_thread_proc.h>
+#endif
 
 #include "svn_private_config.h"
 #include "svn_types.h"
@@ -30,6 +33,7 @@
 #include "svn_subst.h"
 #include "svn_hash.h"
 #include "svn_io.h"
+#include "svn_sorts.h"
 
 #include "wc.h"
 #include "wc_db.h"
@@ -38,8 +42,11 @@
 #include "conflicts.h"
 #include "translate.h"
 
+#include "private/svn_atomic.h"
 #include "private/svn_io_private.h"
 #include "private/svn_skel.h"
+#include "private/svn_string_private.h"
+#include "private/svn_utf_private.h"
 
 
 /* Workqueue operation names.  */
@@ -65,6 +72,7 @@
 /* #define SVN_DEBUG_WORK_QUEUE */
 
 typedef struct work_item_baton_t work_item_baton_t;
+typedef struct file_work_t file_work_t;
 
 struct work_item_dispatch {
   const char *name;
@@ -77,13 +85,17 @@ struct work_item_dispatch {
                        apr_pool_t *scratch_pool);
 };
 
-/* Forward definition */
+/* Forward definitions */
 static svn_error_t *
 get_and_record_fileinfo(work_item_baton_t *wqb,
                         const char *local_abspath,
                         svn_boolean_t ignore_enoent,
                         apr_pool_t *scratch_pool);
 
+static void
+record_file_work(work_item_baton_t *wqb,
+                 const file_work_t *work);
+
 /* ------------------------------------------------------------------------ */
 /* OP_REMOVE_BASE  */
 
@@ -445,60 +457,91 @@ svn_wc__wq_build_postupgrade(svn_skel_t **work_item,
 
 /* OP_FILE_INSTALL */
 
-/* Process the OP_FILE_INSTALL work item WORK_ITEM.
- * See svn_wc__wq_build_file_install() which generates this work item.
- * Implements (struct work_item_dispatch).func. */
-static svn_error_t *
-run_file_install(work_item_baton_t *wqb,
-                 svn_wc__db_t *db,
-                 const svn_skel_t *work_item,
-                 const char *wri_abspath,
-                 svn_cancel_func_t cancel_func,
-                 void *cancel_baton,
-                 apr_pool_t *scratch_pool)
+/* A file install or file remove work item, with everything read from the
+   DB that is needed to run it.  Running it then only touches the file
+   system, so that svn_wc__wq_run() can run many of them in parallel. */
+struct file_work_t
 {
-  const svn_skel_t *arg1 = work_item->children->next;
-  const svn_skel_t *arg4 = arg1->next->next->next;
-  const char *local_relpath;
+  /* The file to install or remove. */
   const char *local_abspath;
-  svn_boolean_t use_commit_times;
-  svn_boolean_t record_fileinfo;
-  svn_boolean_t special;
-  svn_stream_t *src_stream;
+
+  /* TRUE for OP_FILE_REMOVE items, FALSE for OP_FILE_INSTALL items.
+     All other members are only used for the latter. */
+  svn_boolean_t remove;
+
+  /* The file to install from, whether it is a compressed pristine file
+     and how to translate it. */
+  const char *source_abspath;
+  svn_boolean_t source_compressed;
   svn_subst_eol_style_t style;
   const char *eol;
   apr_hash_t *keywords;
+  svn_boolean_t special;
+
+  /* Where to create the temporary file. */
   const char *temp_dir_abspath;
-  svn_stream_t *dst_stream;
+
+  /* How to tweak the installed file. */
+  svn_boolean_t set_executable;
+  svn_boolean_t set_read_only;
+  apr_time_t affected_time;
+
+  /* Whether to stat the installed file so that its timestamp and size
+     can be recorded in the DB. */
+  svn_boolean_t record_fileinfo;
+
+  /* Set by install_file() if the timestamp and size of the installed
+     file should be recorded. */
+  svn_boolean_t recorded;
+  svn_filesize_t recorded_size;
+  apr_time_t recorded_time;
+};
+
+/* Read everything needed to run the OP_FILE_INSTALL work item WORK_ITEM
+   from DB and return it in *WORK, allocated in RESULT_POOL.  Use
+   SCRATCH_POOL for temporary allocations. */
+static svn_error_t *
+prepare_file_install(file_work_t **work,
+                     svn_wc__db_t *db,
+                     const svn_skel_t *work_item,
+                     const char *wri_abspath,
+                     apr_pool_t *result_pool,
+                     apr_pool_t *scratch_pool)
+{
+  const svn_skel_t *arg1 = work_item->children->next;
+  const svn_skel_t *arg4 = arg1->next->next->next;
+  file_work_t *fw = apr_pcalloc(result_pool, sizeof(*fw));
+  const char *local_relpath;
+  svn_boolean_t use_commit_times;
   apr_int64_t val;
   const char *wcroot_abspath;
-  const char *source_abspath;
   const svn_checksum_t *checksum;
   apr_hash_t *props;
   apr_time_t changed_date;
 
   local_relpath = apr_pstrmemdup(scratch_pool, arg1->data, arg1->len);
-  SVN_ERR(svn_wc__db_from_relpath(&local_abspath, db, wri_abspath,
-                                  local_relpath, scratch_pool, scratch_pool));
+  SVN_ERR(svn_wc__db_from_relpath(&fw->local_abspath, db, wri_abspath,
+                                  local_relpath, result_pool, scratch_pool));
 
   SVN_ERR(svn_skel__parse_int(&val, arg1->next, scratch_pool));
   use_commit_times = (val != 0);
   SVN_ERR(svn_skel__parse_int(&val, arg1->next->next, scratch_pool));
-  record_fileinfo = (val != 0);
+  fw->record_fileinfo = (val != 0);
 
   SVN_ERR(svn_wc__db_read_node_install_info(&wcroot_abspath,
                                             &checksum, &props,
                                             &changed_date,
-                                            db, local_abspath, wri_abspath,
+                                            db, fw->local_abspath,
+                                            wri_abspath,
                                             scratch_pool, scratch_pool));
 
   if (arg4 != NULL)
     {
       /* Use the provided path for the source.  */
       local_relpath = apr_pstrmemdup(scratch_pool, arg4->data, arg4->len);
-      SVN_ERR(svn_wc__db_from_relpath(&source_abspath, db, wri_abspath,
+      SVN_ERR(svn_wc__db_from_relpath(&fw->source_abspath, db, wri_abspath,
                                       local_relpath,
-                                      scratch_pool, scratch_pool));
+                                      result_pool, scratch_pool));
     }
   else if (! checksum)
     {
@@ -513,66 +556,116 @@ run_file_install(work_item_baton_t *wqb,
                                _("Can't install '%s' from pristine store, "
                                  "because no checksum is recorded for this "
                                  "file"),
-                               svn_dirent_local_style(local_abspath,
+                               svn_dirent_local_style(fw->local_abspath,
                                                       scratch_pool));
     }
   else
     {
-      SVN_ERR(svn_wc__db_pristine_get_future_path(&source_abspath,
-                                                  wcroot_abspath,
-                                                  checksum,
-                                                  scratch_pool, scratch_pool));
+      SVN_ERR(svn_wc__db_pristine_get_file(&fw->source_abspath,
+                                           &fw->source_compressed,
+                                           db, wcroot_abspath, checksum,
+                                           result_pool, scratch_pool));
     }
 
-  SVN_ERR(svn_stream_open_readonly(&src_stream, source_abspath,
-                                   scratch_pool, scratch_pool));
-
   /* Fetch all the translation bits.  */
-  SVN_ERR(svn_wc__get_translate_info(&style, &eol,
-                                     &keywords,
-                                     &special, db, local_abspath,
+  SVN_ERR(svn_wc__get_translate_info(&fw->style, &fw->eol,
+                                     &fw->keywords,
+                                     &fw->special, db, fw->local_abspath,
                                      props, FALSE,
+                                     result_pool, scratch_pool));
+  if (fw->special)
+    {
+      /* No need to set exec or read-only flags on special files.  */
+
+      /* ### Shouldn't this record a timestamp and size, etc.? */
+      fw->record_fileinfo = FALSE;
+      *work = fw;
+      return SVN_NO_ERROR;
+    }
+
+  /* Where is the Right Place to put a temp file in this working copy?  */
+  SVN_ERR(svn_wc__db_temp_wcroot_tempdir(&fw->temp_dir_abspath,
+                                         db, wcroot_abspath,
+                                         result_pool, scratch_pool));
+
+#ifndef WIN32
+  fw->set_executable = (props
+                        && svn_hash_gets(props, SVN_PROP_EXECUTABLE));
+#endif
+
+  /* Note that this explicitly checks the pristine properties, to make sure
+     that when the lock is locally set (=modification) it is not read only */
+  if (props && svn_hash_gets(props, SVN_PROP_NEEDS_LOCK))
+    {
+      svn_wc__db_status_t status;
+      svn_wc__db_lock_t *lock;
+      SVN_ERR(svn_wc__db_read_info(&status, NULL, NULL, NULL, NULL, NULL, NULL,
+                                   NULL, NULL, NULL, NULL, NULL, NULL, NULL,
+                                   NULL, NULL, &lock, NULL, NULL, NULL, NULL,
+                                   NULL, NULL, NULL, NULL, NULL, NULL,
+                                   db, fw->local_abspath,
+                                   scratch_pool, scratch_pool));
+
+      fw->set_read_only = (!lock && status != svn_wc__db_status_added);
+    }
+
+  if (use_commit_times)
+    fw->affected_time = changed_date;
+
+  *work = fw;
+  return SVN_NO_ERROR;
+}
+
+/* Install the file described by WORK, as prepared by prepare_file_install().
+   If WORK asks for it, set WORK->RECORDED and the recorded size and time.
+   Use SCRATCH_POOL for temporary allocations.  This does not access the
+   DB. */
+static svn_error_t *
+install_file(file_work_t *work,
+             svn_cancel_func_t cancel_func,
+             void *cancel_baton,
+             apr_pool_t *scratch_pool)
+{
+  svn_stream_t *src_stream;
+  svn_stream_t *dst_stream;
+
+  if (work->source_compressed)
+    SVN_ERR(svn_wc__db_pristine_open_file(&src_stream, work->source_abspath,
+                                          TRUE, scratch_pool, scratch_pool));
+  else
+    SVN_ERR(svn_stream_open_readonly(&src_stream, work->source_abspath,
                                      scratch_pool, scratch_pool));
-  if (special)
+
+  if (work->special)
     {
       /* When this stream is closed, the resulting special file will
          atomically be created/moved into place at LOCAL_ABSPATH.  */
-      SVN_ERR(svn_subst_create_specialfile(&dst_stream, local_abspath,
+      SVN_ERR(svn_subst_create_specialfile(&dst_stream, work->local_abspath,
                                            scratch_pool, scratch_pool));
 
       /* Copy the "repository normal" form of the special file into the
          special stream.  */
-      SVN_ERR(svn_stream_copy3(src_stream, dst_stream,
-                               cancel_func, cancel_baton,
-                               scratch_pool));
-
-      /* No need to set exec or read-only flags on special files.  */
-
-      /* ### Shouldn't this record a timestamp and size, etc.? */
-      return SVN_NO_ERROR;
+      return svn_error_trace(svn_stream_copy3(src_stream, dst_stream,
+                                              cancel_func, cancel_baton,
+                                              scratch_pool));
     }
 
-  if (svn_subst_translation_required(style, eol, keywords,
+  if (svn_subst_translation_required(work->style, work->eol, work->keywords,
                                      FALSE /* special */,
                                      TRUE /* force_eol_check */))
     {
       /* Wrap it in a translating (expanding) stream.  */
-      src_stream = svn_subst_stream_translated(src_stream, eol,
+      src_stream = svn_subst_stream_translated(src_stream, work->eol,
                                                TRUE /* repair */,
-                                               keywords,
+                                               work->keywords,
                                                TRUE /* expand */,
                                                scratch_pool);
     }
 
-  /* Where is the Right Place to put a temp file in this working copy?  */
-  SVN_ERR(svn_wc__db_temp_wcroot_tempdir(&temp_dir_abspath,
-                                         db, wcroot_abspath,
-                                         scratch_pool, scratch_pool));
-
   /* Translate to a temporary file. We don't want the user seeing a partial
      file, nor let them muck with it while we translate. We may also need to
      get its TRANSLATED_SIZE before the user can monkey it.  */
-  SVN_ERR(svn_stream__create_for_install(&dst_stream, temp_dir_abspath,
+  SVN_ERR(svn_stream__create_for_install(&dst_stream, work->temp_dir_abspath,
                                          scratch_pool, scratch_pool));
 
   /* Copy from the source to the dest, translating as we go. This will also
@@ -585,52 +678,65 @@ run_file_install(work_item_baton_t *wqb,
   /* With a single db we might want to install files in a missing directory.
      Simply trying this scenario on error won't do any harm and at least
      one user reported this problem on IRC. */
-  SVN_ERR(svn_stream__install_stream(dst_stream, local_abspath,
+  SVN_ERR(svn_stream__install_stream(dst_stream, work->local_abspath,
                                      TRUE /* make_parents*/, scratch_pool));
 
   /* Tweak the on-disk file according to its properties.  */
-#ifndef WIN32
-  if (props && svn_hash_gets(props, SVN_PROP_EXECUTABLE))
-    SVN_ERR(svn_io_set_file_executable(local_abspath, TRUE, FALSE,
+  if (work->set_executable)
+    SVN_ERR(svn_io_set_file_executable(work->local_abspath, TRUE, FALSE,
                                        scratch_pool));
-#endif
 
-  /* Note that this explicitly checks the pristine properties, to make sure
-     that when the lock is locally set (=modification) it is not read only */
-  if (props && svn_hash_gets(props, SVN_PROP_NEEDS_LOCK))
-    {
-      svn_wc__db_status_t status;
-      svn_wc__db_lock_t *lock;
-      SVN_ERR(svn_wc__db_read_info(&status, NULL, NULL, NULL, NULL, NULL, NULL,
-                                   NULL, NULL, NULL, NULL, NULL, NULL, NULL,
-                                   NULL, NULL, &lock, NULL, NULL, NULL, NULL,
-                                   NULL, NULL, NULL, NULL, NULL, NULL,
-                                   db, local_abspath,
-                                   scratch_pool, scratch_pool));
+  if (work->set_read_only)
+    SVN_ERR(svn_io_set_file_read_only(work->local_abspath, FALSE,
+                                      scratch_pool));
 
-      if (!lock && status != svn_wc__db_status_added)
-        SVN_ERR(svn_io_set_file_read_only(local_abspath, FALSE, scratch_pool));
-    }
-
-  if (use_commit_times)
-    {
-      if (changed_date)
-        SVN_ERR(svn_io_set_file_affected_time(changed_date,
-                                              local_abspath,
-                                              scratch_pool));
-    }
+  if (work->affected_time)
+    SVN_ERR(svn_io_set_file_affected_time(work->affected_time,
+                                          work->local_abspath,
+                                          scratch_pool));
 
   /* ### this should happen before we rename the file into place.  */
-  if (record_fileinfo)
+  if (work->record_fileinfo)
     {
-      SVN_ERR(get_and_record_fileinfo(wqb, local_abspath,
-                                      FALSE /* ignore_enoent */,
-                                      scratch_pool));
+      const svn_io_dirent2_t *dirent;
+
+      SVN_ERR(svn_io_stat_dirent2(&dirent, work->local_abspath, FALSE, FALSE,
+                                  scratch_pool, scratch_pool));
+
+      if (dirent->kind == svn_node_file)
+        {
+          work->recorded = TRUE;
+          work->recorded_size = dirent->filesize;
+          work->recorded_time = dirent->mtime;
+        }
     }
 
   return SVN_NO_ERROR;
 }
 
+/* Process the OP_FILE_INSTALL work item WORK_ITEM.
+ * See svn_wc__wq_build_file_install() which generates this work item.
+ * Implements (struct work_item_dispatch).func. */
+static svn_error_t *
+run_file_install(work_item_baton_t *wqb,
+                 svn_wc__db_t *db,
+                 const svn_skel_t *work_item,
+                 const char *wri_abspath,
+                 svn_cancel_func_t cancel_func,
+                 void *cancel_baton,
+                 apr_pool_t *scratch_pool)
+{
+  file_work_t *work;
+
+  SVN_ERR(prepare_file_install(&work, db, work_item, wri_abspath,
+                               scratch_pool, scratch_pool));
+  SVN_ERR(install_file(work, cancel_func, cancel_baton, scratch_pool));
+
+  if (work->recorded)
+    record_file_work(wqb, work);
+
+  return SVN_NO_ERROR;
+}
 
 svn_error_t *
 svn_wc__wq_build_file_install(svn_skel_t **work_item,
@@ -677,6 +783,30 @@ svn_wc__wq_build_file_install(svn_skel_t **work_item,
 
 /* OP_FILE_REMOVE  */
 
+/* Read everything needed to run the OP_FILE_REMOVE work item WORK_ITEM
+   from DB and return it in *WORK, allocated in RESULT_POOL.  Use
+   SCRATCH_POOL for temporary allocations. */
+static svn_error_t *
+prepare_file_remove(file_work_t **work,
+                    svn_wc__db_t *db,
+                    const svn_skel_t *work_item,
+                    const char *wri_abspath,
+                    apr_pool_t *result_pool,
+                    apr_pool_t *scratch_pool)
+{
+  const svn_skel_t *arg1 = work_item->children->next;
+  file_work_t *fw = apr_pcalloc(result_pool, sizeof(*fw));
+  const char *local_relpath;
+
+  local_relpath = apr_pstrmemdup(scratch_pool, arg1->data, arg1->len);
+  SVN_ERR(svn_wc__db_from_relpath(&fw->local_abspath, db, wri_abspath,
+                                  local_relpath, result_pool, scratch_pool));
+  fw->remove = TRUE;
+
+  *work = fw;
+  return SVN_NO_ERROR;
+}
+
 /* Process the OP_FILE_REMOVE work item WORK_ITEM.
  * See svn_wc__wq_build_file_remove() which generates this work item.
  * Implements (struct work_item_dispatch).func. */
@@ -689,20 +819,16 @@ run_file_remove(work_item_baton_t *wqb,
                 void *cancel_baton,
                 apr_pool_t *scratch_pool)
 {
-  const svn_skel_t *arg1 = work_item->children->next;
-  const char *local_relpath;
-  const char *local_abspath;
+  file_work_t *work;
 
-  local_relpath = apr_pstrmemdup(scratch_pool, arg1->data, arg1->len);
-  SVN_ERR(svn_wc__db_from_relpath(&local_abspath, db, wri_abspath,
-                                  local_relpath, scratch_pool, scratch_pool));
+  SVN_ERR(prepare_file_remove(&work, db, work_item, wri_abspath,
+                              scratch_pool, scratch_pool));
 
   /* Remove the path, no worrying if it isn't there.  */
-  return svn_error_trace(svn_io_remove_file2(local_abspath, TRUE,
+  return svn_error_trace(svn_io_remove_file2(work->local_abspath, TRUE,
                                              scratch_pool));
 }
 
-
 svn_error_t *
 svn_wc__wq_build_file_remove(svn_skel_t **work_item,
                              svn_wc__db_t *db,
@@ -1474,6 +1600,341 @@ dispatch_work_item(work_item_baton_t *wqb,
 }
 
 
+/* Wrap ERR, which running WORK_ITEM with identifier ID from the work queue
+   of WRI_ABSPATH returned, in an error that identifies the work item.
+   Use SCRATCH_POOL for temporary allocations. */
+static svn_error_t *
+work_item_error(svn_error_t *err,
+                const char *wri_abspath,
+                apr_uint64_t id,
+                const svn_skel_t *work_item,
+                apr_pool_t *scratch_pool)
+{
+  const char *skel = svn_skel__unparse(work_item, scratch_pool)->data;
+
+  return svn_error_createf(SVN_ERR_WC_BAD_ADM_LOG, err,
+                           _("Failed to run the WC DB work queue "
+                             "associated with '%s', work item %d %s"),
+                           svn_dirent_local_style(wri_abspath,
+                                                  scratch_pool),
+                           (int)id, skel);
+}
+
+/* ------------------------------------------------------------------------ */
+
+/* Parallel file installs and removes */
+
+/* The maximum number of work items that svn_wc__wq_run() fetches at once
+   when it may run file installs and removes in parallel. */
+#define FILE_BATCH_SIZE 256
+
+/* Add the relpath in ATOM to PATHS and all of its parent directories to
+   PARENTS, unless ATOM is already in either hash or one of its parents
+   is in PATHS.  Compare the paths case-insensitively and independent of
+   their Unicode normalization, the way some file systems do.  Return
+   TRUE if ATOM got added.  Use BUF for the case-folding and allocate
+   the keys in POOL. */
+static svn_boolean_t
+add_file_work_path(apr_hash_t *paths,
+                   apr_hash_t *parents,
+                   const svn_skel_t *atom,
+                   svn_membuf_t *buf,
+                   apr_pool_t *pool)
+{
+  const char *key;
+  const char *parent;
+  svn_error_t *err;
+
+  err = svn_utf__xfrm(&key, atom->data, atom->len, TRUE, FALSE, buf);
+  if (err)
+    {
+      /* Don't try to be clever with invalid paths. */
+      svn_error_clear(err);
+      return FALSE;
+    }
+
+  key = apr_pstrdup(pool, key);
+  if (svn_hash_gets(paths, key) || svn_hash_gets(parents, key))
+    return FALSE;
+
+  for (parent = svn_relpath_dirname(key, pool);
+       *parent;
+       parent = svn_relpath_dirname(parent, pool))
+    if (svn_hash_gets(paths, parent))
+      return FALSE;
+
+  svn_hash_sets(paths, key, key);
+  for (parent = svn_relpath_dirname(key, pool);
+       *parent && !svn_hash_gets(parents, parent);
+       parent = svn_relpath_dirname(parent, pool))
+    svn_hash_sets(parents, parent, parent);
+
+  return TRUE;
+}
+
+/* Return the number of work items at the start of WORK_ITEMS, an array of
+   svn_wc__db_work_item_t *, that are file installs and removes which may
+   run in any order.  None of them may touch a file that another one
+   touches, nor may any of these files be a parent directory of another.
+   Use SCRATCH_POOL for temporary allocations. */
+static int
+count_file_batch(const apr_array_header_t *work_items,
+                 apr_pool_t *scratch_pool)
+{
+  apr_hash_t *paths = apr_hash_make(scratch_pool);
+  apr_hash_t *parents = apr_hash_make(scratch_pool);
+  svn_membuf_t buf;
+  int i;
+
+  svn_membuf__create(&buf, 0, scratch_pool);
+  for (i = 0; i < work_items->nelts; i++)
+    {
+      const svn_skel_t *work_item
+        = APR_ARRAY_IDX(work_items, i, svn_wc__db_work_item_t *)->work;
+      const svn_skel_t *arg1 = work_item->children->next;
+      const svn_skel_t *source = NULL;
+
+      if (svn_skel__matches_atom(work_item->children, OP_FILE_INSTALL))
+        {
+          /* The optional fourth argument is the file to install from. */
+          if (arg1 && arg1->next && arg1->next->next)
+            source = arg1->next->next->next;
+        }
+      else if (! svn_skel__matches_atom(work_item->children, OP_FILE_REMOVE))
+        break;
+
+      if (! arg1 || ! arg1->is_atom || (source && ! source->is_atom))
+        break;
+
+      if (! add_file_work_path(paths, parents, arg1, &buf, scratch_pool))
+        break;
+
+      if (source
+          && ! add_file_work_path(paths, parents, source, &buf, scratch_pool))
+        break;
+    }
+
+  return i;
+}
+
+/* The prepared file installs and removes that run_file_batch() runs,
+   shared by all threads. */
+typedef struct file_batch_t
+{
+  /* The file_work_t * to run. */
+  apr_array_header_t *works;
+
+  /* The errors, by index in WORKS. */
+  svn_error_t **errors;
+
+  /* The index of the next item to run. */
+  svn_atomic_t next;
+
+  /* Set to stop all threads as soon as possible. */
+  svn_atomic_t abort;
+} file_batch_t;
+
+/* Run file installs and removes from BATCH until there are no more or
+   until BATCH gets aborted.  Abort BATCH when an item fails.  Check for
+   cancellation using CANCEL_FUNC / CANCEL_BATON between items and abort
+   BATCH if cancelled.  Use SCRATCH_POOL for temporary allocations. */
+static svn_error_t *
+run_file_works(file_batch_t *batch,
+               svn_cancel_func_t cancel_func,
+               void *cancel_baton,
+               apr_pool_t *scratch_pool)
+{
+  apr_pool_t *iterpool = svn_pool_create(scratch_pool);
+
+  while (!svn_atomic_read(&batch->abort))
+    {
+      apr_uint32_t i = svn_atomic_inc(&batch->next);
+      file_work_t *work;
+
+      if (i >= (apr_uint32_t)batch->works->nelts)
+        break;
+
+      svn_pool_clear(iterpool);
+      work = APR_ARRAY_IDX(batch->works, i, file_work_t *);
+      if (work->remove)
+        batch->errors[i] = svn_io_remove_file2(work->local_abspath, TRUE,
+                                               iterpool);
+      else
+        batch->errors[i] = install_file(work, NULL, NULL, iterpool);
+
+      /* The whole batch will be reported as failed, so don't bother
+         with the rest. */
+      if (batch->errors[i])
+        svn_atomic_set(&batch->abort, TRUE);
+
+      if (cancel_func)
+        {
+          svn_error_t *err = cancel_func(cancel_baton);
+          if (err)
+            {
+              svn_atomic_set(&batch->abort, TRUE);
+              svn_pool_destroy(iterpool);
+              return svn_error_trace(err);
+            }
+        }
+    }
+  svn_pool_destroy(iterpool);
+
+  return SVN_NO_ERROR;
+}
+
+#if APR_HAS_THREADS
+
+/* Thread function running run_file_works() for the file_batch_t
+   in BATON. */
+static void * APR_THREAD_FUNC
+file_work_thread(apr_thread_t *thread,
+                 void *baton)
+{
+  /* This thread must not use the pools of the calling thread. */
+  apr_pool_t *pool = apr_allocator_owner_get(svn_pool_create_allocator(FALSE));
+
+  svn_error_clear(run_file_works(baton, NULL, NULL, pool));
+  svn_pool_destroy(pool);
+
+  /* End thread explicitly to prevent APR_INCOMPLETE return codes in
+     apr_thread_join(). */
+  apr_thread_exit(thread, APR_SUCCESS);
+  return NULL;
+}
+
+#endif /* APR_HAS_THREADS */
+
+/* Run all items in BATCH, using up to THREAD_COUNT threads including
+   the calling one.  The other parameters are as for run_file_works(). */
+static svn_error_t *
+run_file_batch(file_batch_t *batch,
+               int thread_count,
+               svn_cancel_func_t cancel_func,
+               void *cancel_baton,
+               apr_pool_t *scratch_pool)
+{
+  svn_error_t *err = SVN_NO_ERROR;
+#if APR_HAS_THREADS
+  apr_thread_t **threads;
+  int started = 0;
+  int i;
+
+  thread_count = MIN(thread_count, batch->works->nelts);
+  threads = apr_palloc(scratch_pool, thread_count * sizeof(*threads));
+  while (started < thread_count - 1)
+    {
+      apr_status_t status = apr_thread_create(&threads[started], NULL,
+                                              file_work_thread, batch,
+                                              scratch_pool);
+      if (status)
+        {
+          /* Do without.  The threads we have will do all the work. */
+          break;
+        }
+
+      ++started;
+    }
+#endif
+
+  err = run_file_works(batch, cancel_func, cancel_baton, scratch_pool);
+
+#if APR_HAS_THREADS
+  for (i = 0; i < started; ++i)
+    {
+      apr_status_t thread_status;
+      apr_status_t status = apr_thread_join(&thread_status, threads[i]);
+
+      if (status)
+        err = svn_error_compose_create(err,
+                svn_error_wrap_apr(status, _("Can't join thread")));
+    }
+#endif
+
+  return svn_error_trace(err);
+}
+
+/* Run the first COUNT items of WORK_ITEMS, which count_file_batch() found
+   to be independent file installs and removes in the work queue of
+   WRI_ABSPATH, using up to THREAD_COUNT threads.  Read all that the items
+   need from DB first, then do the file system work in parallel and
+   finally remember the timestamps and sizes to record in WQB.  Use
+   SCRATCH_POOL for temporary allocations. */
+static svn_error_t *
+run_file_work_items(work_item_baton_t *wqb,
+                    svn_wc__db_t *db,
+                    const char *wri_abspath,
+                    const apr_array_header_t *work_items,
+                    int count,
+                    int thread_count,
+                    svn_cancel_func_t cancel_func,
+                    void *cancel_baton,
+                    apr_pool_t *scratch_pool)
+{
+  apr_pool_t *iterpool = svn_pool_create(scratch_pool);
+  file_batch_t batch;
+  svn_error_t *err = SVN_NO_ERROR;
+  int i;
+
+  batch.works = apr_array_make(scratch_pool, count, sizeof(file_work_t *));
+  for (i = 0; i < count; i++)
+    {
+      const svn_wc__db_work_item_t *item
+        = APR_ARRAY_IDX(work_items, i, svn_wc__db_work_item_t *);
+      file_work_t *work;
+
+      svn_pool_clear(iterpool);
+
+      if (svn_skel__matches_atom(item->work->children, OP_FILE_INSTALL))
+        err = prepare_file_install(&work, db, item->work, wri_abspath,
+                                   scratch_pool, iterpool);
+      else
+        err = prepare_file_remove(&work, db, item->work, wri_abspath,
+                                  scratch_pool, iterpool);
+
+      if (err)
+        return work_item_error(err, wri_abspath, item->id, item->work,
+                               scratch_pool);
+
+      APR_ARRAY_PUSH(batch.works, file_work_t *) = work;
+    }
+  svn_pool_destroy(iterpool);
+
+  batch.errors = apr_pcalloc(scratch_pool, count * sizeof(*batch.errors));
+  batch.next = 0;
+  batch.abort = FALSE;
+
+  err = run_file_batch(&batch, thread_count, cancel_func, cancel_baton,
+                       scratch_pool);
+
+  /* Report the first item that failed, in queue order.  Items are
+     restartable, so any that completed will simply run again. */
+  for (i = 0; i < count; i++)
+    if (batch.errors[i])
+      {
+        const svn_wc__db_work_item_t *item
+          = APR_ARRAY_IDX(work_items, i, svn_wc__db_work_item_t *);
+
+        if (err)
+          svn_error_clear(batch.errors[i]);
+        else
+          err = work_item_error(batch.errors[i], wri_abspath, item->id,
+                                item->work, scratch_pool);
+      }
+  SVN_ERR(err);
+
+  for (i = 0; i < count; i++)
+    {
+      const file_work_t *work = APR_ARRAY_IDX(batch.works, i, file_work_t *);
+
+      if (work->recorded)
+        record_file_work(wqb, work);
+    }
+
+  return SVN_NO_ERROR;
+}
+
+
 svn_error_t *
 svn_wc__wq_run(svn_wc__db_t *db,
                const char *wri_abspath,
@@ -1484,6 +1945,8 @@ svn_wc__wq_run(svn_wc__db_t *db,
   apr_pool_t *iterpool = svn_pool_create(scratch_pool);
   apr_uint64_t last_id = 0;
   work_item_baton_t wib = { 0 };
+  int thread_count = svn_wc__db_get_install_threads(db);
+  int fetch_count = (thread_count > 1) ? FILE_BATCH_SIZE : 1;
   wib.result_pool = svn_pool_create(scratch_pool);
 
 #ifdef SVN_DEBUG_WORK_QUEUE
@@ -1502,31 +1965,24 @@ svn_wc__wq_run(svn_wc__db_t *db,
 
   while (TRUE)
     {
-      apr_uint64_t id;
-      svn_skel_t *work_item;
-      svn_error_t *err;
+      apr_array_header_t *work_items;
+      const svn_wc__db_work_item_t *item;
+      int batch_count;
 
       svn_pool_clear(iterpool);
 
-      if (! wib.used)
+      /* Make sure to do this *early* in the loop iteration. There may
+         be a LAST_ID that needs to be marked as completed, *before* we
+         start worrying about anything else.  */
+      SVN_ERR(svn_wc__db_wq_record_and_fetch_batch(&work_items,
+                                                   db, wri_abspath,
+                                                   last_id, wib.record_map,
+                                                   fetch_count,
+                                                   iterpool,
+                                                   wib.result_pool));
+
+      if (wib.used)
         {
-          /* Make sure to do this *early* in the loop iteration. There may
-             be a LAST_ID that needs to be marked as completed, *before* we
-             start worrying about anything else.  */
-          SVN_ERR(svn_wc__db_wq_fetch_next(&id, &work_item, db, wri_abspath,
-                                           last_id, iterpool, iterpool));
-        }
-      else
-        {
-          /* Make sure to do this *early* in the loop iteration. There may
-             be a LAST_ID that needs to be marked as completed, *before* we
-             start worrying about anything else.  */
-          SVN_ERR(svn_wc__db_wq_record_and_fetch_next(&id, &work_item,
-                                                      db, wri_abspath,
-                                                      last_id, wib.record_map,
-                                                      iterpool,
-                                                      wib.result_pool));
-
           svn_pool_clear(wib.result_pool);
           wib.record_map = NULL;
           wib.used = FALSE;
@@ -1534,32 +1990,51 @@ svn_wc__wq_run(svn_wc__db_t *db,
 
       /* Stop work queue processing, if requested. A future 'svn cleanup'
          should be able to continue the processing. Note that we may
-         have WORK_ITEM, but we'll just skip its processing for now.  */
+         have WORK_ITEMS, but we'll just skip their processing for now.  */
       if (cancel_func)
         SVN_ERR(cancel_func(cancel_baton));
 
-      /* If we have a WORK_ITEM, then process the sucker. Otherwise,
+      /* If we have work items, then process the suckers. Otherwise,
          we're done.  */
-      if (work_item == NULL)
+      if (work_items->nelts == 0)
         break;
 
-      err = dispatch_work_item(&wib, db, wri_abspath, work_item,
-                               cancel_func, cancel_baton, iterpool);
-      if (err)
+      /* Run a leading sequence of independent file installs and removes
+         in parallel if we may.  Everything else runs one item at a time,
+         in queue order. */
+      batch_count = (thread_count > 1)
+                    ? count_file_batch(work_items, iterpool)
+                    : 0;
+
+      if (batch_count > 1)
+        {
+          SVN_ERR(run_file_work_items(&wib, db, wri_abspath, work_items,
+                                      batch_count, thread_count,
+                                      cancel_func, cancel_baton,
+                                      iterpool));
+          item = APR_ARRAY_IDX(work_items, batch_count - 1,
+                               svn_wc__db_work_item_t *);
+        }
+      else
         {
-          const char *skel = svn_skel__unparse(work_item, scratch_pool)->data;
-
-          return svn_error_createf(SVN_ERR_WC_BAD_ADM_LOG, err,
-                                   _("Failed to run the WC DB work queue "
-                                     "associated with '%s', work item %d %s"),
-                                   svn_dirent_local_style(wri_abspath,
-                                                          scratch_pool),
-                                   (int)id, skel);
+          svn_error_t *err;
+
+          item = APR_ARRAY_IDX(work_items, 0, svn_wc__db_work_item_t *);
+          err = dispatch_work_item(&wib, db, wri_abspath, item->work,
+                                   cancel_func, cancel_baton, iterpool);
+          if (err)
+            return work_item_error(err, wri_abspath, item->id, item->work,
+                                   scratch_pool);
         }
 
-      /* The work item finished without error. Mark it completed
+      /* The work items finished without error. Mark them completed
          in the next loop.  */
-      last_id = id;
+      last_id = item->id;
+
+      /* Fetching many items only pays off while the queue starts with
+         file installs and removes. */
+      if (thread_count > 1)
+        fetch_count = (batch_count > 0) ? FILE_BATCH_SIZE : 1;
     }
 
   svn_pool_destroy(iterpool);
@@ -1639,3 +2114,25 @@ get_and_record_fileinfo(work_item_baton_t *wqb,
 
   return SVN_NO_ERROR;
 }
+
+/* Remember the timestamp and size that running WORK found for recording
+   them in the DB with the next work queue fetch. */
+static void
+record_file_work(work_item_baton_t *wqb,
+                 const file_work_t *work)
+{
+  svn_io_dirent2_t *dirent = svn_io_dirent2_create(wqb->result_pool);
+
+  dirent->kind = svn_node_file;
+  dirent->filesize = work->recorded_size;
+  dirent->mtime = work->recorded_time;
+
+  wqb->used = TRUE;
+
+  if (! wqb->record_map)
+    wqb->record_map = apr_hash_make(wqb->result_pool);
+
+  svn_hash_sets(wqb->record_map,
+                apr_pstrdup(wqb->result_pool, work->local_abspath),
+                dirent);
+}
@@ -44,6 +44,7 @@
 
 #include "private/svn_fspath.h"
 #include "private/svn_subr_private.h"
+#include "private/svn_fs_fs_private.h"
 
 #include "dav_svn.h"
 #include "mod_authz_svn.h"
@@ -120,6 +121,52 @@ extern module AP_MODULE_DECLARE_DATA dav_svn_module;
 /* The authz_svn provider for bypassing path authz. */
 static authz_svn__subreq_bypass_func_t pathauthz_bypass_func = NULL;
 
+/* Whether all child processes shall share a single in-memory cache
+ * (see SVNInMemoryCacheShared). */
+static svn_boolean_t share_cache = FALSE;
+
+/* Path of the file to load the FS cache contents from at startup and to
+ * write them to at shutdown (see SVNCacheSnapshot).  NULL if not set. */
+static const char *cache_snapshot = NULL;
+
+/* Load the FS cache contents from CACHE_SNAPSHOT if SAVE is FALSE,
+ * otherwise write them to that file.  Errors are logged to POOL only
+ * because the caches are merely an optimization.
+ */
+static void
+process_cache_snapshot(svn_boolean_t save,
+                       apr_pool_t *pool)
+{
+  svn_fs_fs__ioctl_cache_snapshot_input_t input;
+  apr_pool_t *scratch_pool = svn_pool_create(pool);
+  svn_error_t *serr;
+
+  input.path = cache_snapshot;
+  serr = svn_fs_ioctl(NULL,
+                      save ? SVN_FS_FS__IOCTL_SAVE_CACHE_SNAPSHOT
+                           : SVN_FS_FS__IOCTL_LOAD_CACHE_SNAPSHOT,
+                      &input, NULL, NULL, NULL, scratch_pool, scratch_pool);
+  if (serr)
+    {
+      ap_log_perror(APLOG_MARK, APLOG_WARNING, serr->apr_err, pool,
+                    "mod_dav_svn: error processing cache snapshot '%s': "
+                    "'%s'", cache_snapshot,
+                    serr->message ? serr->message : "(no more info)");
+      svn_error_clear(serr);
+    }
+
+  svn_pool_destroy(scratch_pool);
+}
+
+/* Pool cleanup function writing the cache snapshot.  DATA is the pool
+ * being cleaned up. */
+static apr_status_t
+save_cache_snapshot(void *data)
+{
+  process_cache_snapshot(TRUE, data);
+  return APR_SUCCESS;
+}
+
 static int
 init(apr_pool_t *p, apr_pool_t *plog, apr_pool_t *ptemp, server_rec *s)
 {
@@ -146,6 +193,51 @@ init(apr_pool_t *p, apr_pool_t *plog, apr_pool_t *ptemp, server_rec *s)
       return HTTP_INTERNAL_SERVER_ERROR;
     }
 
+  /* The shared cache must exist before the MPM forks its children. */
+  if (share_cache)
+    {
+      serr = svn_cache_config_create_shared();
+      if (serr)
+        {
+          ap_log_perror(APLOG_MARK, APLOG_ERR, serr->apr_err, p,
+                   "mod_dav_svn: error creating the shared in-memory cache: "
+                   "'%s'",
+                        serr->message ? serr->message : "(no more info)");
+          return HTTP_INTERNAL_SERVER_ERROR;
+        }
+    }
+
+  /* httpd runs the post-config hooks once just to check the configuration
+   * before running them for real.  Don't touch the cache snapshot during
+   * that first pass. */
+  if (cache_snapshot)
+    {
+      static const char *userdata_key = "mod_dav_svn:cache_snapshot";
+      static svn_boolean_t snapshot_loaded = FALSE;
+      void *data = NULL;
+
+      apr_pool_userdata_get(&data, userdata_key, s->process->pool);
+      if (data == NULL)
+        {
+          apr_pool_userdata_set((const void *)1, userdata_key,
+                                apr_pool_cleanup_null, s->process->pool);
+        }
+      else
+        {
+          /* Restarts must not replace the cache contents with older
+           * data. */
+          if (!snapshot_loaded)
+            {
+              process_cache_snapshot(FALSE, p);
+              snapshot_loaded = TRUE;
+            }
+
+          /* P gets cleaned up upon shutdown and restart. */
+          apr_pool_cleanup_register(p, p, save_cache_snapshot,
+                                    apr_pool_cleanup_null);
+        }
+    }
+
   /* This returns void, so we can't check for error. */
   conf = ap_get_module_config(s->module_config, &dav_svn_module);
   svn_utf_initialize2(conf->use_utf8, p);
@@ -631,6 +723,26 @@ SVNInMemoryCacheSize_cmd(cmd_parms *cmd, void *config, const char *arg1)
   return NULL;
 }
 
+static const char *
+SVNInMemoryCacheShared_cmd(cmd_parms *cmd, void *config, int arg)
+{
+  share_cache = arg ? TRUE : FALSE;
+
+  return NULL;
+}
+
+static const char *
+SVNCacheSnapshot_cmd(cmd_parms *cmd, void *config, const char *arg1)
+{
+  cache_snapshot = ap_server_root_relative(cmd->pool, arg1);
+  if (cache_snapshot == NULL)
+    return "Invalid path for SVNCacheSnapshot.";
+
+  cache_snapshot = svn_dirent_internal_style(cache_snapshot, cmd->pool);
+
+  return NULL;
+}
+
 static const char *
 SVNCompressionLevel_cmd(cmd_parms *cmd, void *config, const char *arg1)
 {
@@ -1396,6 +1508,19 @@ static const command_rec cmds[] =
                 "in-memory object cache (default value is 16384; 0 switches "
                 "to dynamically sized caches)."),
   /* per server */
+  AP_INIT_FLAG("SVNInMemoryCacheShared", SVNInMemoryCacheShared_cmd, NULL,
+               RSRC_CONF,
+               "enables a single in-memory cache shared by all child "
+               "processes instead of one cache per process; requires "
+               "a forking MPM (default is Off)."),
+  /* per server */
+  AP_INIT_TAKE1("SVNCacheSnapshot", SVNCacheSnapshot_cmd, NULL,
+                RSRC_CONF,
+                "specifies a file to fill the in-memory cache of FSFS "
+                "repositories from at startup and to save the cache contents "
+                "to at shutdown; mainly useful together with "
+                "SVNInMemoryCacheShared (default is no snapshot)."),
+  /* per server */
   AP_INIT_TAKE1("SVNCompressionLevel", SVNCompressionLevel_cmd, NULL,
                 RSRC_CONF,
                 "specifies the compression level used before sending file "
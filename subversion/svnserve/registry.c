@@ -0,0 +1,563 @@
+/*
+ * registry.c : Repository handles and configuration objects shared
+ *              between svnserve connections
+ *
+ * ====================================================================
+ *    Licensed to the Apache Software Foundation (ASF) under one
+ *    or more contributor license agreements.  See the NOTICE file
+ *    distributed with this work for additional information
+ *    regarding copyright ownership.  The ASF licenses this file
+ *    to you under the Apache License, Version 2.0 (the
+ *    "License"); you may not use this file except in compliance
+ *    with the License.  You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *    Unless required by applicable law or agreed to in writing,
+ *    software distributed under the License is distributed on an
+ *    "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+ *    KIND, either express or implied.  See the License for the
+ *    specific language governing permissions and limitations
+ *    under the License.
+ * ====================================================================
+ */
+
+
+
+#include "svn_dirent_uri.h"
+#include "svn_error.h"
+#include "svn_fs.h"
+#include "svn_hash.h"
+#include "svn_io.h"
+#include "svn_path.h"
+#include "svn_pools.h"
+#include "svn_repos.h"
+
+#include "private/svn_atomic.h"
+#include "private/svn_mutex.h"
+
+#include "svn_private_config.h"
+#include "registry.h"
+
+/* Number of idle handles to keep per repository. */
+#define MAX_IDLE_HANDLES 8
+
+/* Some settings get re-applied to the repository handle by every user,
+ * allocating a few bytes each time.  Start over with a fresh handle after
+ * this many connections. */
+#define MAX_HANDLE_USES 1000
+
+/* Files modified less than this long before we read them may be modified
+ * again without any change to their timestamps.  Don't cache what we read
+ * from them. */
+#define RACY_INTERVAL apr_time_from_sec(2)
+
+/* Files in a repository that, when changed, require it to be reopened.
+ * Paths are relative to the repository root. */
+static const char *const repos_files[] =
+  {
+    "format",
+    "db/format",
+    "db/uuid",
+    "db/fsfs.conf",
+    "db/fsx.conf",
+    NULL
+  };
+
+/* What we know about the state of a file. */
+typedef struct fingerprint_t
+{
+  /* Absolute path of the file. */
+  const char *path;
+
+  /* FALSE, if the file did not exist.  All other members will be 0 then. */
+  svn_boolean_t exists;
+
+  apr_off_t size;
+  apr_time_t mtime;
+  apr_time_t ctime;
+} fingerprint_t;
+
+/* An object shared among connections. */
+typedef struct shared_object_t
+{
+  /* The object returned by the load function. */
+  void *object;
+
+  /* Fingerprints (fingerprint_t) of the files OBJECT depends upon. */
+  apr_array_header_t *dependencies;
+
+  /* Users of this object, including the registry.  The last one to
+   * release it will destroy POOL. */
+  svn_atomic_t ref_count;
+
+  /* Root pool containing this structure and OBJECT. */
+  apr_pool_t *pool;
+} shared_object_t;
+
+/* A repository handle that belongs either to a connection or to the list
+ * of idle handles in REGISTRY. */
+typedef struct repos_handle_t
+{
+  svn_repos_t *repos;
+
+  /* Key for the idle list, allocated in POOL. */
+  const char *repos_root;
+
+  /* Fingerprints (fingerprint_t) of the REPOS_FILES. */
+  apr_array_header_t *dependencies;
+
+  /* Number of connections that used this handle so far. */
+  int uses;
+
+  /* Where to return the handle to. */
+  registry_t *registry;
+
+  /* Root pool containing this structure and REPOS. */
+  apr_pool_t *pool;
+} repos_handle_t;
+
+struct registry_t
+{
+  /* const char * key -> shared_object_t **.  The slots never get removed
+   * and may contain NULL. */
+  apr_hash_t *shared;
+
+  /* const char * repos_root -> apr_array_header_t * of repos_handle_t * */
+  apr_hash_t *idle;
+
+  /* mutex used to serialize access to this structure */
+  svn_mutex__t *mutex;
+
+  /* private pool for the hashes, used under MUTEX only */
+  apr_pool_t *pool;
+};
+
+/* Return a new root pool.  Its contents may live longer than the pool
+ * that they have been requested for. */
+static apr_pool_t *
+create_root_pool(void)
+{
+  return apr_allocator_owner_get(svn_pool_create_allocator(TRUE));
+}
+
+/* Set *FINGERPRINT to the current state of the file at PATH.  Use
+ * SCRATCH_POOL for temporaries. */
+static svn_error_t *
+get_fingerprint(fingerprint_t *fingerprint,
+                const char *path,
+                apr_pool_t *scratch_pool)
+{
+  apr_finfo_t finfo;
+  svn_error_t *err;
+
+  memset(fingerprint, 0, sizeof(*fingerprint));
+  fingerprint->path = path;
+
+  err = svn_io_stat(&finfo, path, APR_FINFO_MIN, scratch_pool);
+  if (err && (APR_STATUS_IS_ENOENT(err->apr_err)
+              || SVN__APR_STATUS_IS_ENOTDIR(err->apr_err)))
+    {
+      svn_error_clear(err);
+      return SVN_NO_ERROR;
+    }
+  SVN_ERR(err);
+
+  fingerprint->exists = TRUE;
+  fingerprint->size = finfo.size;
+  fingerprint->mtime = finfo.mtime;
+  fingerprint->ctime = finfo.ctime;
+
+  return SVN_NO_ERROR;
+}
+
+/* Return an array of fingerprint_t, allocated in RESULT_POOL, for the
+ * files at PATHS.  Set *STABLE to FALSE if we can't tell changes to any
+ * of them later on, i.e. if it is a URL or has been modified after
+ * START - RACY_INTERVAL.  Use SCRATCH_POOL for temporaries. */
+static svn_error_t *
+get_fingerprints(apr_array_header_t **fingerprints,
+                 svn_boolean_t *stable,
+                 const apr_array_header_t *paths,
+                 apr_time_t start,
+                 apr_pool_t *result_pool,
+                 apr_pool_t *scratch_pool)
+{
+  int i;
+
+  *fingerprints = apr_array_make(result_pool, paths->nelts,
+                                 sizeof(fingerprint_t));
+  *stable = TRUE;
+
+  for (i = 0; i < paths->nelts; ++i)
+    {
+      const char *path = APR_ARRAY_IDX(paths, i, const char *);
+      fingerprint_t *fingerprint;
+
+      if (svn_path_is_url(path))
+        {
+          *stable = FALSE;
+          continue;
+        }
+
+      fingerprint = apr_array_push(*fingerprints);
+      SVN_ERR(get_fingerprint(fingerprint, apr_pstrdup(result_pool, path),
+                              scratch_pool));
+      if (   fingerprint->mtime > start - RACY_INTERVAL
+          || fingerprint->ctime > start - RACY_INTERVAL)
+        *stable = FALSE;
+    }
+
+  return SVN_NO_ERROR;
+}
+
+/* Return TRUE if none of the files in FINGERPRINTS changed.  Use
+ * SCRATCH_POOL for temporaries. */
+static svn_boolean_t
+unchanged(const apr_array_header_t *fingerprints,
+          apr_pool_t *scratch_pool)
+{
+  int i;
+
+  for (i = 0; i < fingerprints->nelts; ++i)
+    {
+      const fingerprint_t *old = &APR_ARRAY_IDX(fingerprints, i,
+                                                fingerprint_t);
+      fingerprint_t current;
+      svn_error_t *err = get_fingerprint(&current, old->path, scratch_pool);
+
+      if (err)
+        {
+          svn_error_clear(err);
+          return FALSE;
+        }
+
+      if (   current.exists != old->exists
+          || current.size != old->size
+          || current.mtime != old->mtime
+          || current.ctime != old->ctime)
+        return FALSE;
+    }
+
+  return TRUE;
+}
+
+/* Drop one reference to the shared_object_t DATA.
+ * Implements apr_pool_cleanup_t. */
+static apr_status_t
+release_shared(void *data)
+{
+  shared_object_t *shared = data;
+  if (svn_atomic_dec(&shared->ref_count) == 0)
+    svn_pool_destroy(shared->pool);
+
+  return APR_SUCCESS;
+}
+
+/* Set *SHARED to the object stored under KEY in REGISTRY and add a
+ * reference to it.  Set it to NULL if there is none.
+ * To be called with REGISTRY->MUTEX held. */
+static svn_error_t *
+acquire_shared(shared_object_t **shared,
+               registry_t *registry,
+               const char *key)
+{
+  shared_object_t **slot = svn_hash_gets(registry->shared, key);
+
+  *shared = slot ? *slot : NULL;
+  if (*shared)
+    svn_atomic_inc(&(*shared)->ref_count);
+
+  return SVN_NO_ERROR;
+}
+
+/* Store SHARED, which may be NULL, under KEY in REGISTRY and release the
+ * object previously stored there.  SHARED must already account for the
+ * registry's reference.  To be called with REGISTRY->MUTEX held. */
+static svn_error_t *
+store_shared(registry_t *registry,
+             const char *key,
+             shared_object_t *shared)
+{
+  shared_object_t **slot = svn_hash_gets(registry->shared, key);
+
+  if (slot == NULL)
+    {
+      if (shared == NULL)
+        return SVN_NO_ERROR;
+
+      slot = apr_pcalloc(registry->pool, sizeof(*slot));
+      svn_hash_sets(registry->shared, apr_pstrdup(registry->pool, key),
+                    slot);
+    }
+
+  if (*slot)
+    release_shared(*slot);
+  *slot = shared;
+
+  return SVN_NO_ERROR;
+}
+
+svn_error_t *
+registry__get_shared(void **object,
+                     registry_t *registry,
+                     const char *key,
+                     registry__load_func_t load_func,
+                     void *load_baton,
+                     apr_pool_t *result_pool,
+                     apr_pool_t *scratch_pool)
+{
+  shared_object_t *shared;
+
+  SVN_MUTEX__WITH_LOCK(registry->mutex,
+                       acquire_shared(&shared, registry, key));
+
+  /* Check outside the lock - this does I/O. */
+  if (shared && !unchanged(shared->dependencies, scratch_pool))
+    {
+      release_shared(shared);
+      shared = NULL;
+    }
+
+  if (shared == NULL)
+    {
+      apr_pool_t *pool = create_root_pool();
+      apr_array_header_t *paths = apr_array_make(scratch_pool, 4,
+                                                 sizeof(const char *));
+      apr_time_t start = apr_time_now();
+      svn_boolean_t stable;
+      svn_error_t *err;
+
+      shared = apr_pcalloc(pool, sizeof(*shared));
+      shared->pool = pool;
+      shared->ref_count = 1;
+
+      err = load_func(&shared->object, paths, load_baton, pool,
+                      scratch_pool);
+      if (!err)
+        err = get_fingerprints(&shared->dependencies, &stable, paths, start,
+                               pool, scratch_pool);
+      if (err)
+        {
+          svn_pool_destroy(pool);
+          return svn_error_trace(err);
+        }
+
+      /* Replace any outdated object.  If we could not fingerprint the
+       * new one, the next caller will have to load it again. */
+      if (stable)
+        shared->ref_count++;
+      SVN_MUTEX__WITH_LOCK(registry->mutex,
+                           store_shared(registry, key,
+                                        stable ? shared : NULL));
+    }
+
+  apr_pool_cleanup_register(result_pool, shared, release_shared,
+                            apr_pool_cleanup_null);
+  *object = shared->object;
+
+  return SVN_NO_ERROR;
+}
+
+/* Set *HANDLE to the most recently used idle handle for REPOS_ROOT in
+ * REGISTRY and remove it from the idle list.  Set it to NULL if there is
+ * none.  To be called with REGISTRY->MUTEX held. */
+static svn_error_t *
+pop_idle_handle(repos_handle_t **handle,
+                registry_t *registry,
+                const char *repos_root)
+{
+  apr_array_header_t *idle = svn_hash_gets(registry->idle, repos_root);
+
+  *handle = NULL;
+  if (idle && idle->nelts)
+    *handle = *(repos_handle_t **)apr_array_pop(idle);
+
+  return SVN_NO_ERROR;
+}
+
+/* Add HANDLE to the idle list of its registry, if there is room for it.
+ * Set *KEPT accordingly.  To be called with the registry's mutex held. */
+static svn_error_t *
+push_idle_handle(svn_boolean_t *kept,
+                 repos_handle_t *handle)
+{
+  registry_t *registry = handle->registry;
+  apr_array_header_t *idle = svn_hash_gets(registry->idle,
+                                           handle->repos_root);
+
+  if (idle == NULL)
+    {
+      idle = apr_array_make(registry->pool, MAX_IDLE_HANDLES,
+                            sizeof(repos_handle_t *));
+      svn_hash_sets(registry->idle,
+                    apr_pstrdup(registry->pool, handle->repos_root), idle);
+    }
+
+  *kept = idle->nelts < MAX_IDLE_HANDLES;
+  if (*kept)
+    APR_ARRAY_PUSH(idle, repos_handle_t *) = handle;
+
+  return SVN_NO_ERROR;
+}
+
+/* Like push_idle_handle() but acquires the mutex itself. */
+static svn_error_t *
+return_handle(svn_boolean_t *kept,
+              repos_handle_t *handle)
+{
+  SVN_MUTEX__WITH_LOCK(handle->registry->mutex,
+                       push_idle_handle(kept, handle));
+
+  return SVN_NO_ERROR;
+}
+
+/* Implements svn_fs_warning_callback_t.  Idle handles have no one to
+ * report to. */
+static void
+ignore_warning(void *baton,
+               svn_error_t *err)
+{
+}
+
+/* Detach the repos_handle_t DATA from its connection and put it back
+ * into the registry.  Implements apr_pool_cleanup_t. */
+static apr_status_t
+release_repos(void *data)
+{
+  repos_handle_t *handle = data;
+  svn_fs_t *fs = svn_repos_fs(handle->repos);
+  svn_boolean_t kept = FALSE;
+
+  /* These point into the connection's pool. */
+  svn_error_clear(svn_fs_set_access(fs, NULL));
+  svn_fs_set_warning_func(fs, ignore_warning, NULL);
+  svn_error_clear(svn_repos_remember_client_capabilities(handle->repos,
+                                                         NULL));
+
+  if (handle->uses < MAX_HANDLE_USES)
+    svn_error_clear(return_handle(&kept, handle));
+
+  if (!kept)
+    svn_pool_destroy(handle->pool);
+
+  return APR_SUCCESS;
+}
+
+svn_error_t *
+registry__open_repos(svn_repos_t **repos,
+                     registry_t *registry,
+                     const char *repos_root,
+                     apr_hash_t *fs_config,
+                     apr_pool_t *result_pool,
+                     apr_pool_t *scratch_pool)
+{
+  repos_handle_t *handle;
+
+  SVN_MUTEX__WITH_LOCK(registry->mutex,
+                       pop_idle_handle(&handle, registry, repos_root));
+
+  /* Drop handles to repositories that got replaced, upgraded or
+   * reconfigured in the meantime. */
+  while (handle && !unchanged(handle->dependencies, scratch_pool))
+    {
+      svn_pool_destroy(handle->pool);
+      SVN_MUTEX__WITH_LOCK(registry->mutex,
+                           pop_idle_handle(&handle, registry, repos_root));
+    }
+
+  if (handle == NULL)
+    {
+      apr_pool_t *pool = create_root_pool();
+      apr_array_header_t *paths = apr_array_make(scratch_pool, 8,
+                                                 sizeof(const char *));
+      svn_boolean_t stable;
+      svn_error_t *err;
+      int i;
+
+      handle = apr_pcalloc(pool, sizeof(*handle));
+      handle->pool = pool;
+      handle->registry = registry;
+      handle->repos_root = apr_pstrdup(pool, repos_root);
+
+      for (i = 0; repos_files[i]; ++i)
+        APR_ARRAY_PUSH(paths, const char *)
+          = svn_dirent_join(repos_root, repos_files[i], scratch_pool);
+
+      /* Take the fingerprints first, so we notice any change made while
+       * we are opening the repository. */
+      err = get_fingerprints(&handle->dependencies, &stable, paths,
+                             apr_time_now(), pool, scratch_pool);
+      if (!err)
+        err = svn_repos_open3(&handle->repos, repos_root, fs_config, pool,
+                              scratch_pool);
+      if (err)
+        {
+          svn_pool_destroy(pool);
+          return svn_error_trace(err);
+        }
+
+      /* Don't reuse handles that we can't validate. */
+      if (!stable)
+        handle->uses = MAX_HANDLE_USES;
+    }
+
+  handle->uses++;
+  apr_pool_cleanup_register(result_pool, handle, release_repos,
+                            apr_pool_cleanup_null);
+  *repos = handle->repos;
+
+  return SVN_NO_ERROR;
+}
+
+/* Release everything that REGISTRY still holds.  Objects in use by
+ * connections will be destroyed once those let go of them.
+ * Implements apr_pool_cleanup_t. */
+static apr_status_t
+destroy_registry(void *data)
+{
+  registry_t *registry = data;
+  apr_hash_index_t *hi;
+
+  for (hi = apr_hash_first(registry->pool, registry->shared);
+       hi;
+       hi = apr_hash_next(hi))
+    {
+      shared_object_t **slot = apr_hash_this_val(hi);
+      if (*slot)
+        release_shared(*slot);
+    }
+
+  for (hi = apr_hash_first(registry->pool, registry->idle);
+       hi;
+       hi = apr_hash_next(hi))
+    {
+      apr_array_header_t *idle = apr_hash_this_val(hi);
+      int i;
+
+      for (i = 0; i < idle->nelts; ++i)
+        svn_pool_destroy(APR_ARRAY_IDX(idle, i, repos_handle_t *)->pool);
+    }
+
+  svn_pool_destroy(registry->pool);
+
+  return APR_SUCCESS;
+}
+
+svn_error_t *
+registry__create(registry_t **registry,
+                 apr_pool_t *pool)
+{
+  registry_t *result = apr_pcalloc(pool, sizeof(*result));
+
+  result->pool = create_root_pool();
+  result->shared = apr_hash_make(result->pool);
+  result->idle = apr_hash_make(result->pool);
+  SVN_ERR(svn_mutex__init(&result->mutex, TRUE, pool));
+
+  apr_pool_cleanup_register(pool, result, destroy_registry,
+                            apr_pool_cleanup_null);
+  *registry = result;
+
+  return SVN_NO_ERROR;
+}
@@ -0,0 +1,97 @@
+/*
+ * registry.h : Declarations for the svnserve repository registry
+ *
+ * ====================================================================
+ *    Licensed to the Apache Software Foundation (ASF) under one
+ *    or more contributor license agreements.  See the NOTICE file
+ *    distributed with this work for additional information
+ *    regarding copyright ownership.  The ASF licenses this file
+ *    to you under the Apache License, Version 2.0 (the
+ *    "License"); you may not use this file except in compliance
+ *    with the License.  You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *    Unless required by applicable law or agreed to in writing,
+ *    software distributed under the License is distributed on an
+ *    "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+ *    KIND, either express or implied.  See the License for the
+ *    specific language governing permissions and limitations
+ *    under the License.
+ * ====================================================================
+ */
+
+#ifndef REGISTRY_H
+#define REGISTRY_H
+
+#ifdef __cplusplus
+extern "C" {
+#endif /* __cplusplus */
+
+#include "server.h"
+
+
+
+/* Opaque per-process registry of repository handles and of objects
+ * derived from configuration files, to be reused across connections.
+ * Everything in it gets invalidated as soon as the files it has been
+ * read from change on disk, as told by their size, mtime and ctime.
+ * Access will be serialized among threads within the same process.
+ */
+typedef struct registry_t registry_t;
+
+/* In POOL, create an empty registry and return it in *REGISTRY.
+ */
+svn_error_t *
+registry__create(registry_t **registry,
+                 apr_pool_t *pool);
+
+/* Set *REPOS to a handle for the repository at REPOS_ROOT, opened with
+ * FS_CONFIG.  If REGISTRY has an idle handle for that repository whose
+ * format, UUID and FS configuration files did not change, reuse it;
+ * otherwise open a new one.  The handle belongs to the caller until
+ * RESULT_POOL gets cleaned up, which returns it to REGISTRY.  Any FS
+ * access context, warning function and client capabilities set on it
+ * will be reset at that point.  Use SCRATCH_POOL for temporaries.
+ */
+svn_error_t *
+registry__open_repos(svn_repos_t **repos,
+                     registry_t *registry,
+                     const char *repos_root,
+                     apr_hash_t *fs_config,
+                     apr_pool_t *result_pool,
+                     apr_pool_t *scratch_pool);
+
+/* Construct an object in *OBJECT, allocated in RESULT_POOL, from the data
+ * given by BATON.  Add the paths (const char *) of all files read to
+ * DEPENDENCIES.  URLs in there will prevent the object from being cached.
+ * Use SCRATCH_POOL for temporaries.
+ */
+typedef svn_error_t *
+(*registry__load_func_t)(void **object,
+                         apr_array_header_t *dependencies,
+                         void *baton,
+                         apr_pool_t *result_pool,
+                         apr_pool_t *scratch_pool);
+
+/* Set *OBJECT to the object stored under KEY in REGISTRY, unless any of
+ * the files it depends upon changed.  Otherwise, construct it by calling
+ * LOAD_FUNC with LOAD_BATON and store it under KEY.  The object may be
+ * used by other threads at the same time and must be treated as
+ * read-only.  It remains valid until RESULT_POOL gets cleaned up.  Use
+ * SCRATCH_POOL for temporaries.
+ */
+svn_error_t *
+registry__get_shared(void **object,
+                     registry_t *registry,
+                     const char *key,
+                     registry__load_func_t load_func,
+                     void *load_baton,
+                     apr_pool_t *result_pool,
+                     apr_pool_t *scratch_pool);
+
+#ifdef __cplusplus
+}
+#endif /* __cplusplus */
+
+#endif /* REGISTRY_H */
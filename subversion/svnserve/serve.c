@@ -51,9 +51,11 @@
 #include "svn_mergeinfo.h"
 #include "svn_user.h"
 
+#include "private/svn_cache.h"
 #include "private/svn_log.h"
 #include "private/svn_mergeinfo_private.h"
 #include "private/svn_ra_svn_private.h"
+#include "private/svn_repos_private.h"
 #include "private/svn_fspath.h"
 
 #ifdef HAVE_UNISTD_H
@@ -62,6 +64,8 @@
 
 #include "server.h"
 #include "logger.h"
+#include "registry.h"
+#include "stats.h"
 
 typedef struct commit_callback_baton_t {
   apr_pool_t *pool;
@@ -212,12 +216,14 @@ log_authz_denied(const char *path,
 }
 
 /* If CFG specifies a path to the password DB, read that DB through
- * CONFIG_POOL and store it in REPOSITORY->PWDB.
+ * CONFIG_POOL and store it in REPOSITORY->PWDB.  Add its path to
+ * DEPENDENCIES.
  */
 static svn_error_t *
 load_pwdb_config(repository_t *repository,
                  svn_config_t *cfg,
                  svn_repos__config_pool_t *config_pool,
+                 apr_array_header_t *dependencies,
                  apr_pool_t *pool)
 {
   const char *pwdb_path;
@@ -232,6 +238,7 @@ load_pwdb_config(repository_t *repository,
     {
       pwdb_path = svn_dirent_internal_style(pwdb_path, pool);
       pwdb_path = svn_dirent_join(repository->base, pwdb_path, pool);
+      APR_ARRAY_PUSH(dependencies, const char *) = pwdb_path;
 
       err = svn_repos__config_pool_get(&repository->pwdb, config_pool,
                                        pwdb_path, TRUE,
@@ -299,7 +306,7 @@ canonicalize_access_file(const char **access_file, repository_t *repository,
 }
 
 /* Load the authz database for the listening server based on the entries
-   in the SERVER struct.
+   in the SERVER struct.  Add the paths of the files read to DEPENDENCIES.
 
    SERVER and CONN must not be NULL. The real errors will be logged with
    SERVER and CONN but return generic errors to the client. */
@@ -307,6 +314,7 @@ static svn_error_t *
 load_authz_config(repository_t *repository,
                   const char *repos_root,
                   svn_config_t *cfg,
+                  apr_array_header_t *dependencies,
                   svn_repos_authz_warning_func_t warning_func,
                   void *warning_baton,
                   apr_pool_t *result_pool,
@@ -337,10 +345,16 @@ load_authz_config(repository_t *repository,
                                        repos_root, scratch_pool);
 
       if (!err)
-        err = svn_repos_authz_read4(&repository->authzdb, authzdb_path,
-                                    groupsdb_path, TRUE, repository->repos,
-                                    warning_func, warning_baton,
-                                    result_pool, scratch_pool);
+        {
+          APR_ARRAY_PUSH(dependencies, const char *) = authzdb_path;
+          if (groupsdb_path)
+            APR_ARRAY_PUSH(dependencies, const char *) = groupsdb_path;
+
+          err = svn_repos_authz_read4(&repository->authzdb, authzdb_path,
+                                      groupsdb_path, TRUE, repository->repos,
+                                      warning_func, warning_baton,
+                                      result_pool, scratch_pool);
+        }
 
       if (err)
         return svn_error_create(SVN_ERR_AUTHZ_INVALID_CONFIG, err, NULL);
@@ -433,6 +447,31 @@ static void convert_case(char *text, svn_boolean_t to_uppercase)
     }
 }
 
+/* Return the user name to use for authz purposes for the user described
+   in B, i.e. with any username case normalization applied.  Return NULL
+   for anonymous access. */
+static const char *get_authz_user(server_baton_t *b)
+{
+  repository_t *repository = b->repository;
+  client_info_t *client_info = b->client_info;
+
+  /* If we have a username, and we've not yet used it + any username
+     case normalization that might be requested to determine "the
+     username we used for authz purposes", do so now. */
+  if (client_info->user && (! client_info->authz_user))
+    {
+      char *authz_user = apr_pstrdup(b->pool, client_info->user);
+      if (repository->username_case == CASE_FORCE_UPPER)
+        convert_case(authz_user, TRUE);
+      else if (repository->username_case == CASE_FORCE_LOWER)
+        convert_case(authz_user, FALSE);
+
+      client_info->authz_user = authz_user;
+    }
+
+  return client_info->authz_user;
+}
+
 /* Set *ALLOWED to TRUE if PATH is accessible in the REQUIRED mode to
    the user described in BATON according to the authz rules in BATON.
    Use POOL for temporary allocations only.  If no authz rules are
@@ -444,7 +483,6 @@ static svn_error_t *authz_check_access(svn_boolean_t *allowed,
                                        apr_pool_t *pool)
 {
   repository_t *repository = b->repository;
-  client_info_t *client_info = b->client_info;
 
   /* If authz cannot be performed, grant access.  This is NOT the same
      as the default policy when authz is performed on a path with no
@@ -465,23 +503,9 @@ static svn_error_t *authz_check_access(svn_boolean_t *allowed,
   if (path && *path != '/')
     path = svn_fspath__canonicalize(path, pool);
 
-  /* If we have a username, and we've not yet used it + any username
-     case normalization that might be requested to determine "the
-     username we used for authz purposes", do so now. */
-  if (client_info->user && (! client_info->authz_user))
-    {
-      char *authz_user = apr_pstrdup(b->pool, client_info->user);
-      if (repository->username_case == CASE_FORCE_UPPER)
-        convert_case(authz_user, TRUE);
-      else if (repository->username_case == CASE_FORCE_LOWER)
-        convert_case(authz_user, FALSE);
-
-      client_info->authz_user = authz_user;
-    }
-
   SVN_ERR(svn_repos_authz_check_access(repository->authzdb,
                                        repository->authz_repos_name,
-                                       path, client_info->authz_user,
+                                       path, get_authz_user(b),
                                        required, allowed, pool));
   if (!*allowed)
     SVN_ERR(log_authz_denied(path, required, b, pool));
@@ -514,6 +538,43 @@ static svn_repos_authz_func_t authz_check_access_cb_func(server_baton_t *baton)
   return NULL;
 }
 
+/* Log the denied read access to PATH for the user described in BATON.
+ * Implements svn_repos__authz_denied_func_t.
+ */
+static svn_error_t *authz_denied_cb(const char *path,
+                                    void *baton,
+                                    apr_pool_t *pool)
+{
+  return log_authz_denied(path, svn_authz_read, baton, pool);
+}
+
+/* Like authz_check_access_cb_func() but return a read authorization
+ * function that lets libsvn_repos check many paths at once, as done by
+ * log and replay, and set *AUTHZ_BATON to a matching baton allocated in
+ * POOL.
+ */
+static svn_repos_authz_func_t
+authz_read_paths_func(void **authz_baton,
+                      server_baton_t *b,
+                      apr_pool_t *pool)
+{
+  svn_repos__authz_read_baton_t *ab;
+
+  *authz_baton = NULL;
+  if (!b->repository->authzdb)
+    return NULL;
+
+  ab = apr_pcalloc(pool, sizeof(*ab));
+  ab->authz = b->repository->authzdb;
+  ab->repos_name = b->repository->authz_repos_name;
+  ab->user = get_authz_user(b);
+  ab->denied_func = authz_denied_cb;
+  ab->denied_baton = b;
+  *authz_baton = ab;
+
+  return svn_repos__authz_read_func;
+}
+
 /* Set *ALLOWED to TRUE if the REQUIRED access to PATH is granted,
  * according to the state in BATON.  Use POOL for temporary
  * allocations only.  ROOT is not used.  Implements the
@@ -970,6 +1031,52 @@ static const svn_ra_svn__cmd_entry_t report_commands[] = {
   { NULL }
 };
 
+/* Baton type for defer_contents(). */
+typedef struct defer_baton_t
+{
+  server_baton_t *server;
+
+  /* Revision being reported and its root, opened on demand in POOL. */
+  svn_revnum_t rev;
+  svn_fs_root_t *root;
+  apr_pool_t *pool;
+
+  /* Files at least this large get deferred. */
+  apr_uint64_t min_size;
+} defer_baton_t;
+
+/* Implements svn_ra_svn__defer_contents_func_t for a defer_baton_t. */
+static svn_error_t *
+defer_contents(const char **fetch_path,
+               svn_revnum_t *fetch_rev,
+               void *baton,
+               const char *path,
+               apr_pool_t *pool)
+{
+  defer_baton_t *db = baton;
+  const char *fs_path
+    = svn_fspath__join(db->server->repository->fs_path->data, path, pool);
+  svn_filesize_t length;
+
+  if (!db->root)
+    SVN_ERR(svn_fs_revision_root(&db->root, db->server->repository->fs,
+                                 db->rev, db->pool));
+
+  SVN_ERR(svn_fs_file_length(&length, db->root, fs_path, pool));
+  if ((apr_uint64_t)length >= db->min_size)
+    {
+      /* Skip the leading '/'. */
+      *fetch_path = fs_path + 1;
+      *fetch_rev = db->rev;
+    }
+  else
+    {
+      *fetch_path = NULL;
+    }
+
+  return SVN_NO_ERROR;
+}
+
 /* Accept a report from the client, drive the network editor with the
  * result, and then write an empty command response.  If there is a
  * non-protocol failure, accept_report will abort the edit and return
@@ -982,6 +1089,9 @@ static const svn_ra_svn__cmd_entry_t report_commands[] = {
  * If from_rev is not NULL, set *from_rev to the revision number from
  * the set-path on ""; if somehow set-path "" never happens, set
  * *from_rev to SVN_INVALID_REVNUM.
+ *
+ * If defer_size is not 0, announce the contents of added files of at
+ * least that size with "fetch-file" instead of sending them.
  */
 static svn_error_t *accept_report(svn_boolean_t *only_empty_entry,
                                   svn_revnum_t *from_rev,
@@ -991,20 +1101,29 @@ static svn_error_t *accept_report(svn_boolean_t *only_empty_entry,
                                   svn_boolean_t text_deltas,
                                   svn_depth_t depth,
                                   svn_boolean_t send_copyfrom_args,
-                                  svn_boolean_t ignore_ancestry)
+                                  svn_boolean_t ignore_ancestry,
+                                  apr_uint64_t defer_size)
 {
   const svn_delta_editor_t *editor;
   void *edit_baton, *report_baton;
   report_driver_baton_t rb;
   svn_error_t *err;
   authz_baton_t ab;
+  defer_baton_t db;
 
   ab.server = b;
   ab.conn = conn;
 
+  db.server = b;
+  db.rev = rev;
+  db.min_size = defer_size;
+  db.root = NULL;
+  db.pool = pool;
+
   /* Make an svn_repos report baton.  Tell it to drive the network editor
    * when the report is complete. */
-  svn_ra_svn_get_editor(&editor, &edit_baton, conn, pool, NULL, NULL);
+  svn_ra_svn__get_editor(&editor, &edit_baton, conn, pool, NULL, NULL,
+                         defer_size ? defer_contents : NULL, &db);
   SVN_CMD_ERR(svn_repos_begin_report3(&report_baton, rev,
                                       b->repository->repos,
                                       b->repository->fs_path->data, target,
@@ -1289,19 +1408,17 @@ rev_proplist(svn_ra_svn_conn_t *conn,
   server_baton_t *b = baton;
   svn_revnum_t rev;
   apr_hash_t *props;
-  authz_baton_t ab;
-
-  ab.server = b;
-  ab.conn = conn;
+  svn_repos_authz_func_t authz_func;
+  void *authz_baton;
 
   SVN_ERR(svn_ra_svn__parse_tuple(params, "r", &rev));
   SVN_ERR(log_command(b, conn, pool, "%s", svn_log__rev_proplist(rev, pool)));
 
   SVN_ERR(trivial_auth_request(conn, pool, b));
+  authz_func = authz_read_paths_func(&authz_baton, b, pool);
   SVN_CMD_ERR(svn_repos_fs_revision_proplist(&props, b->repository->repos,
-                                             rev,
-                                             authz_check_access_cb_func(b),
-                                             &ab, pool));
+                                             rev, authz_func, authz_baton,
+                                             pool));
   SVN_ERR(svn_ra_svn__write_tuple(conn, pool, "w((!", "success"));
   SVN_ERR(svn_ra_svn__write_proplist(conn, pool, props));
   SVN_ERR(svn_ra_svn__write_tuple(conn, pool, "!))"));
@@ -1318,19 +1435,18 @@ rev_prop(svn_ra_svn_conn_t *conn,
   svn_revnum_t rev;
   const char *name;
   svn_string_t *value;
-  authz_baton_t ab;
-
-  ab.server = b;
-  ab.conn = conn;
+  svn_repos_authz_func_t authz_func;
+  void *authz_baton;
 
   SVN_ERR(svn_ra_svn__parse_tuple(params, "rc", &rev, &name));
   SVN_ERR(log_command(b, conn, pool, "%s",
                       svn_log__rev_prop(rev, name, pool)));
 
   SVN_ERR(trivial_auth_request(conn, pool, b));
+  authz_func = authz_read_paths_func(&authz_baton, b, pool);
   SVN_CMD_ERR(svn_repos_fs_revision_prop(&value, b->repository->repos, rev,
-                                         name, authz_check_access_cb_func(b),
-                                         &ab, pool));
+                                         name, authz_func, authz_baton,
+                                         pool));
   SVN_ERR(svn_ra_svn__write_cmd_response(conn, pool, "(?s)", value));
   return SVN_NO_ERROR;
 }
@@ -1582,15 +1698,21 @@ commit(svn_ra_svn_conn_t *conn,
   return SVN_NO_ERROR;
 }
 
+/* Send the get-file response for FULL_PATH in REV, as seen by the user
+ * in server baton B, over CONN.  WANT_PROPS, WANT_CONTENTS and
+ * WANTS_INHERITED_PROPS are the respective get-file parameters.  Authz
+ * must have been checked by the caller.  Use POOL for allocations. */
 static svn_error_t *
-get_file(svn_ra_svn_conn_t *conn,
-         apr_pool_t *pool,
-         svn_ra_svn__list_t *params,
-         void *baton)
+send_file(svn_ra_svn_conn_t *conn,
+          apr_pool_t *pool,
+          server_baton_t *b,
+          const char *full_path,
+          svn_revnum_t rev,
+          svn_boolean_t want_props,
+          svn_boolean_t want_contents,
+          svn_boolean_t wants_inherited_props)
 {
-  server_baton_t *b = baton;
-  const char *path, *full_path, *hex_digest, *canonical_path;
-  svn_revnum_t rev;
+  const char *hex_digest;
   svn_fs_root_t *root;
   svn_stream_t *contents;
   apr_hash_t *props = NULL;
@@ -1598,8 +1720,6 @@ get_file(svn_ra_svn_conn_t *conn,
   svn_string_t write_str;
   char buf[4096];
   apr_size_t len;
-  svn_boolean_t want_props, want_contents;
-  apr_uint64_t wants_inherited_props;
   svn_checksum_t *checksum;
   svn_error_t *err, *write_err;
   int i;
@@ -1608,30 +1728,6 @@ get_file(svn_ra_svn_conn_t *conn,
   ab.server = b;
   ab.conn = conn;
 
-  /* Parse arguments. */
-  SVN_ERR(svn_ra_svn__parse_tuple(params, "c(?r)bb?B", &path, &rev,
-                                  &want_props, &want_contents,
-                                  &wants_inherited_props));
-
-  if (wants_inherited_props == SVN_RA_SVN_UNSPECIFIED_NUMBER)
-    wants_inherited_props = FALSE;
-
-  SVN_ERR(svn_relpath_canonicalize_safe(&canonical_path, NULL, path, pool,
-                                        pool));
-  full_path = svn_fspath__join(b->repository->fs_path->data, canonical_path,
-                               pool);
-
-  /* Check authorizations */
-  SVN_ERR(must_have_access(conn, pool, b, svn_authz_read,
-                           full_path, FALSE));
-
-  if (!SVN_IS_VALID_REVNUM(rev))
-    SVN_CMD_ERR(svn_fs_youngest_rev(&rev, b->repository->fs, pool));
-
-  SVN_ERR(log_command(b, conn, pool, "%s",
-                      svn_log__get_file(full_path, rev,
-                                        want_contents, want_props, pool)));
-
   /* Fetch the properties and a stream for the contents. */
   SVN_CMD_ERR(svn_fs_revision_root(&root, b->repository->fs, rev, pool));
   SVN_CMD_ERR(svn_fs_file_checksum(&checksum, svn_checksum_md5, root,
@@ -1711,6 +1807,121 @@ get_file(svn_ra_svn_conn_t *conn,
   return SVN_NO_ERROR;
 }
 
+static svn_error_t *
+get_file(svn_ra_svn_conn_t *conn,
+         apr_pool_t *pool,
+         svn_ra_svn__list_t *params,
+         void *baton)
+{
+  server_baton_t *b = baton;
+  const char *path, *full_path, *canonical_path;
+  svn_revnum_t rev;
+  svn_boolean_t want_props, want_contents;
+  apr_uint64_t wants_inherited_props;
+
+  /* Parse arguments. */
+  SVN_ERR(svn_ra_svn__parse_tuple(params, "c(?r)bb?B", &path, &rev,
+                                  &want_props, &want_contents,
+                                  &wants_inherited_props));
+
+  if (wants_inherited_props == SVN_RA_SVN_UNSPECIFIED_NUMBER)
+    wants_inherited_props = FALSE;
+
+  SVN_ERR(svn_relpath_canonicalize_safe(&canonical_path, NULL, path, pool,
+                                        pool));
+  full_path = svn_fspath__join(b->repository->fs_path->data, canonical_path,
+                               pool);
+
+  /* Check authorizations */
+  SVN_ERR(must_have_access(conn, pool, b, svn_authz_read,
+                           full_path, FALSE));
+
+  if (!SVN_IS_VALID_REVNUM(rev))
+    SVN_CMD_ERR(svn_fs_youngest_rev(&rev, b->repository->fs, pool));
+
+  SVN_ERR(log_command(b, conn, pool, "%s",
+                      svn_log__get_file(full_path, rev,
+                                        want_contents, want_props, pool)));
+
+  return svn_error_trace(send_file(conn, pool, b, full_path, rev,
+                                   want_props, want_contents,
+                                   (svn_boolean_t)wants_inherited_props));
+}
+
+static svn_error_t *
+get_files(svn_ra_svn_conn_t *conn,
+          apr_pool_t *pool,
+          svn_ra_svn__list_t *params,
+          void *baton)
+{
+  server_baton_t *b = baton;
+  svn_ra_svn__list_t *file_list;
+  svn_boolean_t want_props;
+  apr_array_header_t *full_paths;
+  apr_array_header_t *revs;
+  svn_revnum_t youngest = SVN_INVALID_REVNUM;
+  apr_pool_t *iterpool;
+  int i;
+
+  /* Parse arguments. */
+  SVN_ERR(svn_ra_svn__parse_tuple(params, "lb", &file_list, &want_props));
+
+  full_paths = apr_array_make(pool, file_list->nelts, sizeof(const char *));
+  revs = apr_array_make(pool, file_list->nelts, sizeof(svn_revnum_t));
+
+  /* Check all authorizations before sending anything, so we can still
+   * ask for authentication. */
+  for (i = 0; i < file_list->nelts; ++i)
+    {
+      svn_ra_svn__item_t *item = &SVN_RA_SVN__LIST_ITEM(file_list, i);
+      const char *path, *canonical_path, *full_path;
+      svn_revnum_t rev;
+
+      if (item->kind != SVN_RA_SVN_LIST)
+        return svn_error_create(SVN_ERR_RA_SVN_MALFORMED_DATA, NULL,
+                                "File entry not a list");
+      SVN_ERR(svn_ra_svn__parse_tuple(&item->u.list, "c(?r)", &path, &rev));
+
+      SVN_ERR(svn_relpath_canonicalize_safe(&canonical_path, NULL, path,
+                                            pool, pool));
+      full_path = svn_fspath__join(b->repository->fs_path->data,
+                                   canonical_path, pool);
+      SVN_ERR(must_have_access(conn, pool, b, svn_authz_read,
+                               full_path, FALSE));
+
+      if (!SVN_IS_VALID_REVNUM(rev))
+        {
+          if (!SVN_IS_VALID_REVNUM(youngest))
+            SVN_CMD_ERR(svn_fs_youngest_rev(&youngest, b->repository->fs,
+                                            pool));
+          rev = youngest;
+        }
+
+      APR_ARRAY_PUSH(full_paths, const char *) = full_path;
+      APR_ARRAY_PUSH(revs, svn_revnum_t) = rev;
+    }
+
+  SVN_ERR(svn_ra_svn__write_cmd_response(conn, pool, ""));
+
+  /* Send the files one after another.  Any failure ends the command. */
+  iterpool = svn_pool_create(pool);
+  for (i = 0; i < full_paths->nelts; ++i)
+    {
+      const char *full_path = APR_ARRAY_IDX(full_paths, i, const char *);
+      svn_revnum_t rev = APR_ARRAY_IDX(revs, i, svn_revnum_t);
+
+      svn_pool_clear(iterpool);
+      SVN_ERR(log_command(b, conn, iterpool, "%s",
+                          svn_log__get_file(full_path, rev, TRUE,
+                                            want_props, iterpool)));
+      SVN_ERR(send_file(conn, iterpool, b, full_path, rev, want_props,
+                        TRUE, FALSE));
+    }
+  svn_pool_destroy(iterpool);
+
+  return SVN_NO_ERROR;
+}
+
 /* Translate all the words in DIRENT_FIELDS_LIST into the flags in
  * DIRENT_FIELDS_P.  If DIRENT_FIELDS_LIST is NULL, set all flags. */
 static svn_error_t *
@@ -1960,11 +2171,15 @@ update(svn_ra_svn_conn_t *conn,
      handle that by converting recurse if necessary. */
   svn_depth_t depth = svn_depth_unknown;
   svn_boolean_t is_checkout;
+  apr_uint64_t defer_size; /* Optional; default 0 */
 
   /* Parse the arguments. */
-  SVN_ERR(svn_ra_svn__parse_tuple(params, "(?r)cb?w3?3", &rev, &target,
+  SVN_ERR(svn_ra_svn__parse_tuple(params, "(?r)cb?w3?3?n", &rev, &target,
                                   &recurse, &depth_word,
-                                  &send_copyfrom_args, &ignore_ancestry));
+                                  &send_copyfrom_args, &ignore_ancestry,
+                                  &defer_size));
+  if (defer_size == SVN_RA_SVN_UNSPECIFIED_NUMBER)
+    defer_size = 0;
   SVN_ERR(svn_relpath_canonicalize_safe(&canonical_target, NULL, target,
                                         pool, pool));
   target = canonical_target;
@@ -1985,7 +2200,8 @@ update(svn_ra_svn_conn_t *conn,
                         conn, pool, b, rev, target, NULL, TRUE,
                         depth,
                         (send_copyfrom_args == svn_tristate_true),
-                        (ignore_ancestry == svn_tristate_true)));
+                        (ignore_ancestry == svn_tristate_true),
+                        defer_size));
   if (is_checkout)
     {
       SVN_ERR(log_command(b, conn, pool, "%s",
@@ -2057,7 +2273,7 @@ switch_cmd(svn_ra_svn_conn_t *conn,
                        conn, pool, b, rev, target, switch_path, TRUE,
                        depth,
                        (send_copyfrom_args == svn_tristate_true),
-                       (ignore_ancestry != svn_tristate_false));
+                       (ignore_ancestry != svn_tristate_false), 0);
 }
 
 static svn_error_t *
@@ -2098,7 +2314,7 @@ status(svn_ra_svn_conn_t *conn,
   }
 
   return accept_report(NULL, NULL, conn, pool, b, rev, target, NULL, FALSE,
-                       depth, FALSE, FALSE);
+                       depth, FALSE, FALSE, 0);
 }
 
 static svn_error_t *
@@ -2160,7 +2376,7 @@ diff(svn_ra_svn_conn_t *conn,
     svn_revnum_t from_rev;
     SVN_ERR(accept_report(NULL, &from_rev,
                           conn, pool, b, rev, target, versus_path,
-                          text_deltas, depth, FALSE, ignore_ancestry));
+                          text_deltas, depth, FALSE, ignore_ancestry, 0));
     SVN_ERR(log_command(b, conn, pool, "%s",
                         svn_log__diff(full_path, from_rev, versus_path,
                                       rev, depth, ignore_ancestry,
@@ -2442,10 +2658,8 @@ log_cmd(svn_ra_svn_conn_t *conn,
   int i;
   apr_uint64_t limit, include_merged_revs_param;
   log_baton_t lb;
-  authz_baton_t ab;
-
-  ab.server = b;
-  ab.conn = conn;
+  svn_repos_authz_func_t authz_func;
+  void *authz_baton;
 
   SVN_ERR(svn_ra_svn__parse_tuple(params, "l(?r)(?r)bb?n?Bwl", &paths,
                                   &start_rev, &end_rev, &send_changed_paths,
@@ -2516,10 +2730,11 @@ log_cmd(svn_ra_svn_conn_t *conn,
   lb.conn = conn;
   lb.stack_depth = 0;
   lb.started = FALSE;
+  authz_func = authz_read_paths_func(&authz_baton, b, pool);
   err = svn_repos_get_logs5(b->repository->repos, full_paths, start_rev,
                             end_rev, (int) limit,
                             strict_node, include_merged_revisions,
-                            revprops, authz_check_access_cb_func(b), &ab,
+                            revprops, authz_func, authz_baton,
                             send_changed_paths ? path_change_receiver : NULL,
                             send_changed_paths ? &lb : NULL,
                             revision_receiver, &lb, pool);
@@ -3467,10 +3682,8 @@ static svn_error_t *replay_one_revision(svn_ra_svn_conn_t *conn,
   void *edit_baton;
   svn_fs_root_t *root;
   svn_error_t *err;
-  authz_baton_t ab;
-
-  ab.server = b;
-  ab.conn = conn;
+  svn_repos_authz_func_t authz_func;
+  void *authz_baton;
 
   SVN_ERR(log_command(b, conn, pool,
                       svn_log__replay(b->repository->fs_path->data, rev,
@@ -3480,10 +3693,11 @@ static svn_error_t *replay_one_revision(svn_ra_svn_conn_t *conn,
 
   err = svn_fs_revision_root(&root, b->repository->fs, rev, pool);
 
+  authz_func = authz_read_paths_func(&authz_baton, b, pool);
   if (! err)
     err = svn_repos_replay2(root, b->repository->fs_path->data,
                             low_water_mark, send_deltas, editor, edit_baton,
-                            authz_check_access_cb_func(b), &ab, pool);
+                            authz_func, authz_baton, pool);
 
   if (err)
     svn_error_clear(editor->abort_edit(edit_baton, pool));
@@ -3525,16 +3739,15 @@ replay_range(svn_ra_svn_conn_t *conn,
   svn_boolean_t send_deltas;
   server_baton_t *b = baton;
   apr_pool_t *iterpool;
-  authz_baton_t ab;
-
-  ab.server = b;
-  ab.conn = conn;
+  svn_repos_authz_func_t authz_func;
+  void *authz_baton;
 
   SVN_ERR(svn_ra_svn__parse_tuple(params, "rrrb", &start_rev,
                                  &end_rev, &low_water_mark,
                                  &send_deltas));
 
   SVN_ERR(trivial_auth_request(conn, pool, b));
+  authz_func = authz_read_paths_func(&authz_baton, b, pool);
 
   iterpool = svn_pool_create(pool);
   for (rev = start_rev; rev <= end_rev; rev++)
@@ -3545,8 +3758,7 @@ replay_range(svn_ra_svn_conn_t *conn,
 
       SVN_CMD_ERR(svn_repos_fs_revision_proplist(&props,
                                                  b->repository->repos, rev,
-                                                 authz_check_access_cb_func(b),
-                                                 &ab,
+                                                 authz_func, authz_baton,
                                                  iterpool));
       SVN_ERR(svn_ra_svn__write_tuple(conn, iterpool, "w(!", "revprops"));
       SVN_ERR(svn_ra_svn__write_proplist(conn, iterpool, props));
@@ -3790,6 +4002,7 @@ static const svn_ra_svn__cmd_entry_t main_commands[] = {
   { "rev-prop",        rev_prop },
   { "commit",          commit },
   { "get-file",        get_file },
+  { "get-files",       get_files },
   { "get-dir",         get_dir },
   { "update",          update },
   { "switch",          switch_cmd },
@@ -3868,12 +4081,134 @@ repos_path_valid(const char *path)
   return TRUE;
 }
 
+/* The parts of a repository's configuration that we read from files.
+ * Instances may be shared by concurrent connections. */
+typedef struct repos_settings_t
+{
+  svn_config_t *cfg;
+  svn_config_t *pwdb;
+  svn_authz_t *authzdb;
+  enum username_case_type username_case;
+} repos_settings_t;
+
+/* Baton for load_repos_settings(). */
+typedef struct settings_baton_t
+{
+  repository_t *repository;
+  svn_config_t *cfg;
+  svn_repos__config_pool_t *config_pool;
+  svn_repos_authz_warning_func_t authz_warning_func;
+  void *authz_warning_baton;
+} settings_baton_t;
+
+/* Implements registry__load_func_t for a settings_baton_t BATON.
+ * Unless BATON has a configuration already, read the svnserve.conf of
+ * its repository.  Read the password and authz files referenced by the
+ * configuration, too. */
+static svn_error_t *
+load_repos_settings(void **object,
+                    apr_array_header_t *dependencies,
+                    void *baton,
+                    apr_pool_t *result_pool,
+                    apr_pool_t *scratch_pool)
+{
+  settings_baton_t *sb = baton;
+  repository_t *repository = sb->repository;
+  repos_settings_t *settings = apr_pcalloc(result_pool, sizeof(*settings));
+
+  settings->cfg = sb->cfg;
+  if (settings->cfg == NULL)
+    {
+      const char *path = svn_repos_svnserve_conf(repository->repos,
+                                                 scratch_pool);
+
+      APR_ARRAY_PUSH(dependencies, const char *) = path;
+      SVN_ERR(svn_repos__config_pool_get(&settings->cfg, sb->config_pool,
+                                         path, FALSE, repository->repos,
+                                         result_pool));
+    }
+
+  SVN_ERR(load_pwdb_config(repository, settings->cfg, sb->config_pool,
+                           dependencies, result_pool));
+  SVN_ERR(load_authz_config(repository, repository->repos_root,
+                            settings->cfg, dependencies,
+                            sb->authz_warning_func, sb->authz_warning_baton,
+                            result_pool, scratch_pool));
+
+  settings->pwdb = repository->pwdb;
+  settings->authzdb = repository->authzdb;
+  settings->username_case = repository->username_case;
+  *object = settings;
+
+  return SVN_NO_ERROR;
+}
+
+/* Set the password DB, authz rules and username case of REPOSITORY,
+ * whose REPOS and BASE must already be set, and return the svnserve
+ * configuration in *CFG_P.  The latter is CFG, if not NULL.  Take them
+ * from REGISTRY if that is not NULL and the files are unchanged.
+ *
+ * CONFIG_POOL, AUTHZ_WARNING_FUNC, AUTHZ_WARNING_BATON, RESULT_POOL and
+ * SCRATCH_POOL are the same as for find_repos().
+ */
+static svn_error_t *
+get_repos_settings(svn_config_t **cfg_p,
+                   repository_t *repository,
+                   svn_config_t *cfg,
+                   registry_t *registry,
+                   svn_repos__config_pool_t *config_pool,
+                   svn_repos_authz_warning_func_t authz_warning_func,
+                   void *authz_warning_baton,
+                   apr_pool_t *result_pool,
+                   apr_pool_t *scratch_pool)
+{
+  settings_baton_t baton;
+  repos_settings_t *settings;
+  void *object;
+
+  baton.repository = repository;
+  baton.cfg = cfg;
+  baton.config_pool = config_pool;
+  baton.authz_warning_func = authz_warning_func;
+  baton.authz_warning_baton = authz_warning_baton;
+
+  if (registry == NULL)
+    {
+      apr_array_header_t *dependencies
+        = apr_array_make(scratch_pool, 4, sizeof(const char *));
+
+      SVN_ERR(load_repos_settings(&object, dependencies, &baton,
+                                  result_pool, scratch_pool));
+      *cfg_p = ((repos_settings_t *)object)->cfg;
+      return SVN_NO_ERROR;
+    }
+
+  SVN_ERR(registry__get_shared(&object, registry, repository->repos_root,
+                               load_repos_settings, &baton,
+                               result_pool, scratch_pool));
+  settings = object;
+
+  *cfg_p = settings->cfg;
+  repository->pwdb = settings->pwdb;
+  repository->username_case = settings->username_case;
+
+  /* The authz object caches per-user data and must not be shared. */
+  if (settings->authzdb)
+    svn_repos__authz_share(&repository->authzdb, settings->authzdb,
+                           result_pool);
+  else
+    repository->authzdb = NULL;
+
+  return SVN_NO_ERROR;
+}
+
 /* Look for the repository given by URL, using ROOT as the virtual
  * repository root.  If we find one, fill in the repos, fs, repos_url,
  * and fs_path fields of REPOSITORY.  VHOST and READ_ONLY flags are the
  * same as in the server baton.
  *
- * CONFIG_POOL shall be used to load config objects.
+ * CONFIG_POOL shall be used to load config objects.  If REGISTRY is not
+ * NULL, get the repository handle and config objects from there.
  *
  * Use SCRATCH_POOL for temporary allocations.
  *
@@ -3886,6 +4221,7 @@ find_repos(const char *url,
            svn_config_t *cfg,
            repository_t *repository,
            svn_repos__config_pool_t *config_pool,
+           registry_t *registry,
            apr_hash_t *fs_config,
            svn_repos_authz_warning_func_t authz_warning_func,
            void *authz_warning_baton,
@@ -3931,8 +4267,13 @@ find_repos(const char *url,
                              "No repository found in '%s'", url);
 
   /* Open the repository and fill in b with the resulting information. */
-  SVN_ERR(svn_repos_open3(&repository->repos, repository->repos_root,
-                          fs_config, result_pool, scratch_pool));
+  if (registry)
+    SVN_ERR(registry__open_repos(&repository->repos, registry,
+                                 repository->repos_root, fs_config,
+                                 result_pool, scratch_pool));
+  else
+    SVN_ERR(svn_repos_open3(&repository->repos, repository->repos_root,
+                            fs_config, result_pool, scratch_pool));
   SVN_ERR(svn_repos_remember_client_capabilities(repository->repos,
                                                  repository->capabilities));
   repository->fs = svn_repos_fs(repository->repos);
@@ -3957,20 +4298,11 @@ find_repos(const char *url,
   /* If the svnserve configuration has not been loaded then load it from the
    * repository. */
   if (NULL == cfg)
-    {
-      repository->base = svn_repos_conf_dir(repository->repos, result_pool);
+    repository->base = svn_repos_conf_dir(repository->repos, result_pool);
 
-      SVN_ERR(svn_repos__config_pool_get(&cfg, config_pool,
-                                         svn_repos_svnserve_conf
-                                            (repository->repos, result_pool),
-                                         FALSE, repository->repos,
-                                         result_pool));
-    }
-
-  SVN_ERR(load_pwdb_config(repository, cfg, config_pool, result_pool));
-  SVN_ERR(load_authz_config(repository, repository->repos_root, cfg,
-                            authz_warning_func, authz_warning_baton,
-                            result_pool, scratch_pool));
+  SVN_ERR(get_repos_settings(&cfg, repository, cfg, registry, config_pool,
+                             authz_warning_func, authz_warning_baton,
+                             result_pool, scratch_pool));
 
   /* Should we use Cyrus SASL? */
   SVN_ERR(svn_config_get_bool(cfg, &sasl_requested,
@@ -4239,7 +4571,7 @@ construct_server_baton(server_baton_t **baton,
    * send an empty mechlist. */
   if (params->compression_level > 0)
     SVN_ERR(svn_ra_svn__write_cmd_response(conn, scratch_pool,
-                                           "nn()(wwwwwwwwwwwww)",
+                                           "nn()(wwwwwwwwwwwwwww?w)",
                                            (apr_uint64_t) 2, (apr_uint64_t) 2,
                                            SVN_RA_SVN_CAP_EDIT_PIPELINE,
                                            SVN_RA_SVN_CAP_SVNDIFF1,
@@ -4253,11 +4585,15 @@ construct_server_baton(server_baton_t **baton,
                                            SVN_RA_SVN_CAP_INHERITED_PROPS,
                                            SVN_RA_SVN_CAP_EPHEMERAL_TXNPROPS,
                                            SVN_RA_SVN_CAP_GET_FILE_REVS_REVERSE,
-                                           SVN_RA_SVN_CAP_LIST
+                                           SVN_RA_SVN_CAP_LIST,
+                                           SVN_RA_SVN_CAP_GET_FILES,
+                                           SVN_RA_SVN_CAP_DEFER_CONTENTS,
+                                           svn_ra_svn__stream_compression_cap(
+                                             params->stream_compression)
                                            ));
   else
     SVN_ERR(svn_ra_svn__write_cmd_response(conn, scratch_pool,
-                                           "nn()(wwwwwwwwwww)",
+                                           "nn()(wwwwwwwwwwwww?w)",
                                            (apr_uint64_t) 2, (apr_uint64_t) 2,
                                            SVN_RA_SVN_CAP_EDIT_PIPELINE,
                                            SVN_RA_SVN_CAP_ABSENT_ENTRIES,
@@ -4269,7 +4605,11 @@ construct_server_baton(server_baton_t **baton,
                                            SVN_RA_SVN_CAP_INHERITED_PROPS,
                                            SVN_RA_SVN_CAP_EPHEMERAL_TXNPROPS,
                                            SVN_RA_SVN_CAP_GET_FILE_REVS_REVERSE,
-                                           SVN_RA_SVN_CAP_LIST
+                                           SVN_RA_SVN_CAP_LIST,
+                                           SVN_RA_SVN_CAP_GET_FILES,
+                                           SVN_RA_SVN_CAP_DEFER_CONTENTS,
+                                           svn_ra_svn__stream_compression_cap(
+                                             params->stream_compression)
                                            ));
 
   /* Read client response, which we assume to be in version 2 format:
@@ -4296,6 +4636,17 @@ construct_server_baton(server_baton_t **baton,
     return svn_error_create(SVN_ERR_RA_SVN_BAD_VERSION, NULL,
                             "Missing edit-pipeline capability");
 
+  /* Switch to whole-stream compression if the client accepted our offer.
+   * Everything after the client's response, starting with the auth
+   * request, is compressed. */
+  if (params->stream_compression != svn_ra_svn__stream_compression_none
+      && svn_ra_svn_has_capability(conn,
+                                   svn_ra_svn__stream_compression_cap(
+                                     params->stream_compression)))
+    SVN_ERR(svn_ra_svn__enable_stream_compression(conn,
+                                                  params->stream_compression,
+                                                  scratch_pool));
+
   /* find_repos needs the capabilities as a list of words (eventually
      they get handed to the start-commit hook).  While we could add a
      new interface to re-retrieve them from conn and convert the
@@ -4336,7 +4687,7 @@ construct_server_baton(server_baton_t **baton,
   err = handle_config_error(find_repos(client_url, params->root, b->vhost,
                                        b->read_only, params->cfg,
                                        b->repository, params->config_pool,
-                                       params->fs_config,
+                                       params->registry, params->fs_config,
                                        handle_authz_warning, b,
                                        conn_pool, scratch_pool),
                             b);
@@ -4432,6 +4783,70 @@ construct_server_baton(server_baton_t **baton,
   return SVN_NO_ERROR;
 }
 
+/* Call svn_ra_svn__handle_command() for TERMINATE, CMD_HASH, BATON, CONN
+ * and POOL.  If PARAMS asks for it, measure the resources the command
+ * used, add them to the statistics and log the command if it was slow.
+ */
+static svn_error_t *
+handle_command(svn_boolean_t *terminate,
+               apr_hash_t *cmd_hash,
+               server_baton_t *baton,
+               svn_ra_svn_conn_t *conn,
+               serve_params_t *params,
+               apr_pool_t *pool)
+{
+  stats__sample_t sample = { 0 };
+  apr_uint64_t bytes_in, bytes_out, cache_gets, cache_hits;
+  apr_time_t start;
+  svn_error_t *err;
+
+  if (params->stats == NULL && params->slow_request_threshold == 0)
+    return svn_error_trace(svn_ra_svn__handle_command(terminate, cmd_hash,
+                                                      baton, conn, FALSE,
+                                                      pool));
+
+  svn_ra_svn__get_io_totals(&bytes_in, &bytes_out, conn);
+  svn_cache__membuffer_get_global_counters(&cache_gets, &cache_hits);
+  start = apr_time_now();
+
+  err = svn_ra_svn__handle_command(terminate, cmd_hash, baton, conn, FALSE,
+                                   pool);
+
+  sample.duration = apr_time_now() - start;
+  sample.command = svn_ra_svn__get_last_command(conn);
+  sample.failed = err != SVN_NO_ERROR;
+  svn_ra_svn__get_io_totals(&sample.bytes_in, &sample.bytes_out, conn);
+  sample.bytes_in -= bytes_in;
+  sample.bytes_out -= bytes_out;
+  svn_cache__membuffer_get_global_counters(&sample.cache_gets,
+                                           &sample.cache_hits);
+  sample.cache_gets -= cache_gets;
+  sample.cache_hits -= cache_hits;
+
+  /* A closed connection is not a command. */
+  if (sample.command == NULL && *terminate && !err)
+    return SVN_NO_ERROR;
+
+  if (params->stats)
+    stats__record(params->stats, &sample);
+
+  if (   params->slow_request_threshold
+      && sample.duration >= params->slow_request_threshold)
+    svn_error_clear(log_command(baton, conn, pool,
+                                "slow-request %s usec %" APR_INT64_T_FMT
+                                " in %" APR_UINT64_T_FMT
+                                " out %" APR_UINT64_T_FMT
+                                " cache-gets %" APR_UINT64_T_FMT
+                                " cache-hits %" APR_UINT64_T_FMT "%s",
+                                sample.command ? sample.command : "-",
+                                (apr_int64_t)sample.duration,
+                                sample.bytes_in, sample.bytes_out,
+                                sample.cache_gets, sample.cache_hits,
+                                sample.failed ? " failed" : ""));
+
+  return svn_error_trace(err);
+}
+
 svn_error_t *
 serve_interruptable(svn_boolean_t *terminate_p,
                     connection_t *connection,
@@ -4500,10 +4915,9 @@ serve_interruptable(svn_boolean_t *terminate_p,
           err = svn_ra_svn__has_command(&has_command, &terminate,
                                         connection->conn, iterpool);
           if (!err && has_command)
-            err = svn_ra_svn__handle_command(&terminate, cmd_hash,
-                                             connection->baton,
-                                             connection->conn,
-                                             FALSE, iterpool);
+            err = handle_command(&terminate, cmd_hash, connection->baton,
+                                 connection->conn, connection->params,
+                                 iterpool);
 
           break;
         }
@@ -4514,15 +4928,39 @@ serve_interruptable(svn_boolean_t *terminate_p,
            * busy() callback test to return TRUE while there are still some
            * resources left.
            */
-          err = svn_ra_svn__handle_command(&terminate, cmd_hash,
-                                           connection->baton,
-                                           connection->conn,
-                                           FALSE, iterpool);
+          err = handle_command(&terminate, cmd_hash, connection->baton,
+                               connection->conn, connection->params,
+                               iterpool);
         }
     }
 
   /* error or normal end of session. Close the connection */
   svn_pool_destroy(iterpool);
+
+  if (terminate && connection->baton
+      && svn_ra_svn__get_stream_compression(connection->conn)
+           != svn_ra_svn__stream_compression_none)
+    {
+      const svn_ra_svn__compression_stats_t *stats
+        = svn_ra_svn__get_compression_stats(connection->conn);
+
+      svn_error_clear(log_command(connection->baton, connection->conn, pool,
+                                  "stream-compression %s"
+                                  " out %" APR_UINT64_T_FMT
+                                  "/%" APR_UINT64_T_FMT
+                                  " in %" APR_UINT64_T_FMT
+                                  "/%" APR_UINT64_T_FMT
+                                  " compress-usec %" APR_INT64_T_FMT
+                                  " decompress-usec %" APR_INT64_T_FMT,
+                                  svn_ra_svn__stream_compression_cap(
+                                    svn_ra_svn__get_stream_compression(
+                                      connection->conn)),
+                                  stats->raw_out, stats->wire_out,
+                                  stats->raw_in, stats->wire_in,
+                                  (apr_int64_t)stats->compress_time,
+                                  (apr_int64_t)stats->decompress_time));
+    }
+
   if (terminate_p)
     *terminate_p = terminate;
 
@@ -4534,7 +4972,23 @@ svn_error_t *serve(svn_ra_svn_conn_t *conn,
                    apr_pool_t *pool)
 {
   server_baton_t *baton = NULL;
+  svn_boolean_t terminate = FALSE;
+  const svn_ra_svn__cmd_entry_t *command;
+  apr_hash_t *cmd_hash = apr_hash_make(pool);
+  apr_pool_t *iterpool = svn_pool_create(pool);
 
   SVN_ERR(construct_server_baton(&baton, conn, params, pool));
-  return svn_ra_svn__handle_commands2(conn, pool, main_commands, baton, FALSE);
+
+  for (command = main_commands; command->cmdname; command++)
+    svn_hash_sets(cmd_hash, command->cmdname, command);
+
+  while (!terminate)
+    {
+      svn_pool_clear(iterpool);
+      SVN_ERR(handle_command(&terminate, cmd_hash, baton, conn, params,
+                             iterpool));
+    }
+
+  svn_pool_destroy(iterpool);
+  return SVN_NO_ERROR;
 }
@@ -38,6 +38,7 @@ extern "C" {
 
 #include "private/svn_atomic.h"
 #include "private/svn_mutex.h"
+#include "private/svn_ra_svn_private.h"
 #include "private/svn_repos_private.h"
 #include "private/svn_subr_private.h"
 
@@ -124,9 +125,20 @@ typedef struct serve_params_t {
   /* logging data structure; possibly NULL. */
   struct logger_t *logger;
 
+  /* per-command statistics; possibly NULL. */
+  struct stats_t *stats;
+
+  /* Commands taking at least this long get logged as slow requests.
+     0 disables the slow-request log. */
+  apr_interval_time_t slow_request_threshold;
+
   /* all configurations should be opened through this factory */
   svn_repos__config_pool_t *config_pool;
 
+  /* Repository handles and config objects reused across connections;
+     possibly NULL. */
+  struct registry_t *registry;
+
   /* The FS configuration to be applied to all repositories.
      It mainly contains things like cache settings. */
   apr_hash_t *fs_config;
@@ -147,6 +159,11 @@ typedef struct serve_params_t {
      them over the network.  0 disables that code path. */
   apr_size_t zero_copy_limit;
 
+  /* Whole-stream compression to offer to clients.  Clients that accept
+     it get all data after the capability exchange compressed by that
+     method and the svndiff data itself uncompressed. */
+  svn_ra_svn__stream_compression_t stream_compression;
+
   /* Amount of data to send between checks for cancellation requests
      coming in from the client. */
   apr_size_t error_check_interval;
@@ -0,0 +1,229 @@
+/*
+ * stats.c : Per-command request statistics for svnserve
+ *
+ * ====================================================================
+ *    Licensed to the Apache Software Foundation (ASF) under one
+ *    or more contributor license agreements.  See the NOTICE file
+ *    distributed with this work for additional information
+ *    regarding copyright ownership.  The ASF licenses this file
+ *    to you under the Apache License, Version 2.0 (the
+ *    "License"); you may not use this file except in compliance
+ *    with the License.  You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *    Unless required by applicable law or agreed to in writing,
+ *    software distributed under the License is distributed on an
+ *    "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+ *    KIND, either express or implied.  See the License for the
+ *    specific language governing permissions and limitations
+ *    under the License.
+ * ====================================================================
+ */
+
+
+
+#include "svn_error.h"
+#include "svn_hash.h"
+#include "svn_io.h"
+#include "svn_pools.h"
+#include "svn_sorts.h"
+#include "svn_string.h"
+#include "svn_time.h"
+
+#include "private/svn_mutex.h"
+#include "private/svn_sorts_private.h"
+
+#include "svn_private_config.h"
+#include "stats.h"
+
+#ifdef HAVE_UNISTD_H
+#include <unistd.h>   /* For getpid() */
+#endif
+
+/* Number of latency histogram buckets.  Bucket I counts durations of
+ * I significant bits, i.e. from 2^(I-1) to 2^I - 1 microseconds.  The
+ * last one collects everything from about 4.5 minutes upwards. */
+#define HISTOGRAM_SIZE 29
+
+/* Totals for one command. */
+typedef struct command_stats_t
+{
+  apr_uint64_t count;
+  apr_uint64_t errors;
+  apr_uint64_t histogram[HISTOGRAM_SIZE];
+  apr_interval_time_t total_time;
+  apr_interval_time_t max_time;
+  apr_uint64_t bytes_in;
+  apr_uint64_t bytes_out;
+  apr_uint64_t cache_gets;
+  apr_uint64_t cache_hits;
+} command_stats_t;
+
+struct stats_t
+{
+  /* File to write the statistics to. */
+  const char *filename;
+
+  /* const char * command name -> command_stats_t * */
+  apr_hash_t *commands;
+
+  /* When we started collecting the statistics. */
+  apr_time_t start_time;
+
+  /* mutex used to serialize access to this structure */
+  svn_mutex__t *mutex;
+
+  /* pool for the hash and its entries */
+  apr_pool_t *pool;
+};
+
+svn_error_t *
+stats__create(stats_t **stats,
+              const char *filename,
+              apr_pool_t *pool)
+{
+  stats_t *result = apr_pcalloc(pool, sizeof(*result));
+
+  SVN_ERR(svn_mutex__init(&result->mutex, TRUE, pool));
+  result->filename = apr_pstrdup(pool, filename);
+  result->pool = svn_pool_create(pool);
+  result->commands = apr_hash_make(result->pool);
+  result->start_time = apr_time_now();
+
+  *stats = result;
+
+  return SVN_NO_ERROR;
+}
+
+/* Return the histogram bucket for DURATION. */
+static int
+histogram_bucket(apr_interval_time_t duration)
+{
+  int bucket = 0;
+  while (duration > 0 && bucket < HISTOGRAM_SIZE - 1)
+    {
+      duration >>= 1;
+      ++bucket;
+    }
+
+  return bucket;
+}
+
+/* Core of stats__record().  To be called with STATS->MUTEX held. */
+static svn_error_t *
+record(stats_t *stats,
+       const stats__sample_t *sample)
+{
+  const char *name = sample->command ? sample->command : "-";
+  command_stats_t *entry = svn_hash_gets(stats->commands, name);
+
+  if (entry == NULL)
+    {
+      /* Only a few dozen commands exist, so this is bounded. */
+      entry = apr_pcalloc(stats->pool, sizeof(*entry));
+      svn_hash_sets(stats->commands, apr_pstrdup(stats->pool, name), entry);
+    }
+
+  entry->count++;
+  if (sample->failed)
+    entry->errors++;
+
+  entry->histogram[histogram_bucket(sample->duration)]++;
+  entry->total_time += sample->duration;
+  entry->max_time = MAX(entry->max_time, sample->duration);
+
+  entry->bytes_in += sample->bytes_in;
+  entry->bytes_out += sample->bytes_out;
+  entry->cache_gets += sample->cache_gets;
+  entry->cache_hits += sample->cache_hits;
+
+  return SVN_NO_ERROR;
+}
+
+void
+stats__record(stats_t *stats,
+              const stats__sample_t *sample)
+{
+  svn_error_clear(svn_mutex__lock(stats->mutex));
+  svn_error_clear(svn_mutex__unlock(stats->mutex, record(stats, sample)));
+}
+
+/* Return an upper bound for the PERCENTILE'th percentile of the durations
+ * in ENTRY, based on its histogram. */
+static apr_interval_time_t
+percentile(const command_stats_t *entry,
+           int percentile)
+{
+  apr_uint64_t threshold = (entry->count * percentile + 99) / 100;
+  apr_uint64_t seen = 0;
+  int i;
+
+  for (i = 0; i < HISTOGRAM_SIZE - 1; ++i)
+    {
+      seen += entry->histogram[i];
+      if (seen >= threshold)
+        return MIN(((apr_interval_time_t)1 << i) - 1, entry->max_time);
+    }
+
+  return entry->max_time;
+}
+
+/* Append the current contents of STATS to BUFFER.  Use SCRATCH_POOL for
+ * temporary allocations. */
+static svn_error_t *
+format_stats(svn_stringbuf_t *buffer,
+             stats_t *stats,
+             apr_pool_t *scratch_pool)
+{
+  apr_array_header_t *sorted;
+  int i;
+
+  svn_stringbuf_appendcstr(buffer,
+     apr_psprintf(scratch_pool, "# pid %" APR_PID_T_FMT " since %s\n",
+                  getpid(), svn_time_to_cstring(stats->start_time,
+                                                scratch_pool)));
+  svn_stringbuf_appendcstr(buffer,
+     "# command count errors p50-usec p99-usec max-usec total-usec"
+     " bytes-in bytes-out cache-gets cache-hits\n");
+
+  sorted = svn_sort__hash(stats->commands, svn_sort_compare_items_lexically,
+                          scratch_pool);
+  for (i = 0; i < sorted->nelts; ++i)
+    {
+      svn_sort__item_t *item = &APR_ARRAY_IDX(sorted, i, svn_sort__item_t);
+      const command_stats_t *entry = item->value;
+
+      svn_stringbuf_appendcstr(buffer,
+         apr_psprintf(scratch_pool,
+                      "%s %" APR_UINT64_T_FMT " %" APR_UINT64_T_FMT
+                      " %" APR_INT64_T_FMT " %" APR_INT64_T_FMT
+                      " %" APR_INT64_T_FMT " %" APR_INT64_T_FMT
+                      " %" APR_UINT64_T_FMT " %" APR_UINT64_T_FMT
+                      " %" APR_UINT64_T_FMT " %" APR_UINT64_T_FMT "\n",
+                      (const char *)item->key, entry->count, entry->errors,
+                      (apr_int64_t)percentile(entry, 50),
+                      (apr_int64_t)percentile(entry, 99),
+                      (apr_int64_t)entry->max_time,
+                      (apr_int64_t)entry->total_time,
+                      entry->bytes_in, entry->bytes_out,
+                      entry->cache_gets, entry->cache_hits));
+    }
+
+  return SVN_NO_ERROR;
+}
+
+svn_error_t *
+stats__write(stats_t *stats,
+             apr_pool_t *scratch_pool)
+{
+  svn_stringbuf_t *buffer = svn_stringbuf_create_empty(scratch_pool);
+
+  /* Don't hold the lock while doing I/O. */
+  SVN_MUTEX__WITH_LOCK(stats->mutex,
+                       format_stats(buffer, stats, scratch_pool));
+
+  return svn_error_trace(svn_io_write_atomic2(stats->filename,
+                                              buffer->data, buffer->len,
+                                              NULL, FALSE, scratch_pool));
+}
@@ -0,0 +1,89 @@
+/*
+ * stats.h : Declarations for the svnserve request statistics
+ *
+ * ====================================================================
+ *    Licensed to the Apache Software Foundation (ASF) under one
+ *    or more contributor license agreements.  See the NOTICE file
+ *    distributed with this work for additional information
+ *    regarding copyright ownership.  The ASF licenses this file
+ *    to you under the Apache License, Version 2.0 (the
+ *    "License"); you may not use this file except in compliance
+ *    with the License.  You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *    Unless required by applicable law or agreed to in writing,
+ *    software distributed under the License is distributed on an
+ *    "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+ *    KIND, either express or implied.  See the License for the
+ *    specific language governing permissions and limitations
+ *    under the License.
+ * ====================================================================
+ */
+
+#ifndef STATS_H
+#define STATS_H
+
+#ifdef __cplusplus
+extern "C" {
+#endif /* __cplusplus */
+
+#include "server.h"
+
+
+
+/* Resources used by a single ra_svn command.
+ */
+typedef struct stats__sample_t
+{
+  /* Name of the command or NULL, if it was not a known command. */
+  const char *command;
+
+  /* Wall clock time spent in the command handler. */
+  apr_interval_time_t duration;
+
+  /* Protocol bytes received and sent while handling the command. */
+  apr_uint64_t bytes_in;
+  apr_uint64_t bytes_out;
+
+  /* Lookups in and hits of the global membuffer cache.  Since the cache
+   * is shared, these include concurrent requests by other threads. */
+  apr_uint64_t cache_gets;
+  apr_uint64_t cache_hits;
+
+  /* TRUE if the command returned an error. */
+  svn_boolean_t failed;
+} stats__sample_t;
+
+/* Opaque per-command statistics.  Access will be serialized among
+ * threads within the same process.
+ */
+typedef struct stats_t stats_t;
+
+/* In POOL, create an empty statistics object that will be written to
+ * FILENAME by stats__write() and return it in *STATS.
+ */
+svn_error_t *
+stats__create(stats_t **stats,
+              const char *filename,
+              apr_pool_t *pool);
+
+/* Add SAMPLE to the totals and latency histogram of its command in
+ * STATS.
+ */
+void
+stats__record(stats_t *stats,
+              const stats__sample_t *sample);
+
+/* Replace the statistics file of STATS with the current totals, one line
+ * per command.  Use SCRATCH_POOL for temporary allocations.
+ */
+svn_error_t *
+stats__write(stats_t *stats,
+             apr_pool_t *scratch_pool);
+
+#ifdef __cplusplus
+}
+#endif /* __cplusplus */
+
+#endif /* STATS_H */
@@ -57,9 +57,12 @@
 #include "private/svn_atomic.h"
 #include "private/svn_mutex.h"
 #include "private/svn_subr_private.h"
+#include "private/svn_fs_fs_private.h"
+#include "private/svn_ra_svn_private.h"
 
 #if APR_HAS_THREADS
 #    include <apr_thread_pool.h>
+#    include <apr_poll.h>
 #endif
 
 #include "winservice.h"
@@ -70,12 +73,16 @@
 
 #include "server.h"
 #include "logger.h"
+#include "registry.h"
+#include "stats.h"
 
 /* The strategy for handling incoming connections.  Some of these may be
    unavailable due to platform limitations. */
 enum connection_handling_mode {
   connection_mode_fork,   /* Create a process per connection */
   connection_mode_thread, /* Create a thread per connection */
+  connection_mode_event,  /* Threads serve commands, idle connections wait
+                             in a pollset */
   connection_mode_single  /* One connection at a time in this process */
 };
 
@@ -110,6 +117,10 @@ enum run_mode {
 
 #endif
 
+#if APR_HAS_THREADS
+#define CONNECTION_HAVE_EVENT_OPTION
+#endif
+
 /* Parameters for the worker thread pool used in threaded mode. */
 
 /* Have at least this many worker threads (even if there are no requests
@@ -145,6 +156,17 @@ enum run_mode {
  */
 #define THREADPOOL_THREAD_IDLE_LIMIT 1000000
 
+/* Maximum number of ready connections that the event loop picks up from
+ * the pollset at once.  This does not limit the number of connections
+ * that may wait in it.
+ */
+#define EVENT_BATCH_SIZE 256
+
+/* Number of microseconds that the event loop waits for client activity
+ * before checking whether the server shall terminate.
+ */
+#define EVENT_LOOP_TIMEOUT 1000000
+
 /* Number of client to server connections that may concurrently in the
  * TCP 3-way handshake state, i.e. are in the process of being created.
  *
@@ -222,14 +244,25 @@ void winservice_notify_stop(void)
 #define SVNSERVE_OPT_MAX_REQUEST     274
 #define SVNSERVE_OPT_MAX_RESPONSE    275
 #define SVNSERVE_OPT_CACHE_NODEPROPS 276
+#define SVNSERVE_OPT_CACHE_SHARED    277
+#define SVNSERVE_OPT_CACHE_SNAPSHOT  278
+#define SVNSERVE_OPT_EVENT_LOOP      279
+#define SVNSERVE_OPT_STREAM_COMPRESSION 280
+#define SVNSERVE_OPT_STATS_FILE      281
+#define SVNSERVE_OPT_SLOW_REQUEST    282
 
 /* Text macro because we can't use #ifdef sections inside a N_("...")
    macro expansion. */
-#ifdef CONNECTION_HAVE_THREAD_OPTION
+#if defined(CONNECTION_HAVE_THREAD_OPTION)
+#define ONLY_AVAILABLE_WITH_THEADS \
+        "\n" \
+        "                             "\
+        "[used only with --threads or --event-loop]"
+#elif defined(CONNECTION_HAVE_EVENT_OPTION)
 #define ONLY_AVAILABLE_WITH_THEADS \
         "\n" \
         "                             "\
-        "[used only with --threads]"
+        "[used only with --event-loop]"
 #else
 #define ONLY_AVAILABLE_WITH_THEADS ""
 #endif
@@ -287,6 +320,18 @@ static const apr_getopt_option_t svnserve__options[] =
         "[0 .. no compression, 5 .. default, \n"
         "                             "
         " 9 .. maximum compression]")},
+    {"stream-compression", SVNSERVE_OPT_STREAM_COMPRESSION, 1,
+     N_("compress the whole network stream of clients that\n"
+        "                             "
+        "support it, using method ARG:\n"
+        "                             "
+        "  none .. no stream compression (default)\n"
+        "                             "
+        "  lz4  .. fast, for high-bandwidth networks\n"
+        "                             "
+        "  zlib .. compact, for slow links; uses the level\n"
+        "                             "
+        "          given by --compression")},
     {"memory-cache-size", 'M', 1,
      N_("size of the extra in-memory cache in MB used to\n"
         "                             "
@@ -325,6 +370,26 @@ static const apr_getopt_option_t svnserve__options[] =
         "Default is yes.\n"
         "                             "
         "[used for FSFS repositories only]")},
+#if APR_HAS_FORK
+    {"memory-cache-shared", SVNSERVE_OPT_CACHE_SHARED, 0,
+     N_("share one in-memory cache among all forked\n"
+        "                             "
+        "connection processes instead of giving each\n"
+        "                             "
+        "process its own copy.\n"
+        "                             "
+        "[mode: daemon; not used with --threads]")},
+#endif
+    {"cache-snapshot", SVNSERVE_OPT_CACHE_SNAPSHOT, 1,
+     N_("fill the in-memory cache from file ARG at\n"
+        "                             "
+        "startup and write the cache contents back to it\n"
+        "                             "
+        "when terminated by SIGTERM.\n"
+        "                             "
+        "[used for FSFS repositories only]\n"
+        "                             "
+        "[mode: daemon]")},
     {"client-speed", SVNSERVE_OPT_CLIENT_SPEED, 1,
      N_("Optimize network handling based on the assumption\n"
         "                             "
@@ -347,6 +412,18 @@ static const apr_getopt_option_t svnserve__options[] =
     {"threads",          'T', 0, N_("use threads instead of fork "
                                     "[mode: daemon]")},
 #endif
+#ifdef CONNECTION_HAVE_EVENT_OPTION
+    {"event-loop",       SVNSERVE_OPT_EVENT_LOOP, 0,
+     N_("serve all connections from a pool of threads but\n"
+        "                             "
+        "let idle connections wait without occupying a\n"
+        "                             "
+        "thread.  Use this to serve many concurrent\n"
+        "                             "
+        "connections.\n"
+        "                             "
+        "[mode: daemon]")},
+#endif
 #if APR_HAS_THREADS
     {"min-threads",      SVNSERVE_OPT_MIN_THREADS, 1,
      N_("Minimum number of server threads, even if idle.\n"
@@ -396,6 +473,22 @@ static const apr_getopt_option_t svnserve__options[] =
         "process (useful for debugging)")},
     {"log-file",         SVNSERVE_OPT_LOG_FILE, 1,
      N_("svnserve log file")},
+    {"slow-request-threshold", SVNSERVE_OPT_SLOW_REQUEST, 1,
+     N_("log every command that takes ARG milliseconds\n"
+        "                             "
+        "or longer, along with its traffic and cache usage\n"
+        "                             "
+        "[0 .. disabled (default)]")},
+#ifdef SIGUSR2
+    {"stats-file",       SVNSERVE_OPT_STATS_FILE, 1,
+     N_("collect per-command latency and traffic totals\n"
+        "                             "
+        "and write them to file ARG upon SIGUSR2 and at\n"
+        "                             "
+        "shutdown\n"
+        "                             "
+        "[mode: daemon, listen-once; not with forking]")},
+#endif
     {"pid-file",         SVNSERVE_OPT_PID_FILE, 1,
 #ifdef WIN32
      N_("write server process ID to file ARG\n"
@@ -492,6 +585,78 @@ static void sigchld_handler(int signo)
 }
 #endif
 
+/* Set by sigterm_handler() to make the main loop stop accepting new
+ * connections. */
+static volatile sig_atomic_t shutdown_requested = FALSE;
+
+#ifdef SIGTERM
+static void sigterm_handler(int signo)
+{
+  /* Interrupt the accept() and let the main loop terminate gracefully. */
+  shutdown_requested = TRUE;
+}
+#endif
+
+#if APR_HAS_THREADS
+/* Block the signals that the main loop waits for in the calling thread.
+ * Threads inherit the signal mask of the thread that creates them.  So if
+ * the main thread creates all threads between block_signals() and
+ * unblock_signals(), these signals can only be delivered to the main
+ * thread, where they interrupt the accept().  Signals that arrive in
+ * between stay pending until unblock_signals(). */
+static void
+block_signals(void)
+{
+#ifdef SIGTERM
+  apr_signal_block(SIGTERM);
+#endif
+#ifdef SIGUSR2
+  apr_signal_block(SIGUSR2);
+#endif
+}
+
+/* Undo block_signals() for the calling thread. */
+static void
+unblock_signals(void)
+{
+#ifdef SIGTERM
+  apr_signal_unblock(SIGTERM);
+#endif
+#ifdef SIGUSR2
+  apr_signal_unblock(SIGUSR2);
+#endif
+}
+#endif
+
+/* Set by sigusr2_handler() to make the main loop write the statistics
+ * file. */
+static volatile sig_atomic_t stats_requested = FALSE;
+
+#ifdef SIGUSR2
+static void sigusr2_handler(int signo)
+{
+  /* Interrupt the accept(); writing the file is not async-signal-safe. */
+  stats_requested = TRUE;
+}
+#endif
+
+/* If requested, write the statistics in PARAMS to their file and log any
+ * error.  Use SCRATCH_POOL for temporaries. */
+static void
+write_stats(serve_params_t *params,
+            apr_pool_t *scratch_pool)
+{
+  if (params->stats && stats_requested)
+    {
+      svn_error_t *err;
+
+      stats_requested = FALSE;
+      err = stats__write(params->stats, scratch_pool);
+      logger__log_error(params->logger, err, NULL, NULL);
+      svn_error_clear(err);
+    }
+}
+
 /* Redirect stdout to stderr.  ARG is the pool.
  *
  * In tunnel or inetd mode, we don't want hook scripts corrupting the
@@ -545,6 +710,14 @@ accept_connection(connection_t **connection,
         exit(0);
       #endif
 
+      /* Handle signals that arrived while we were not waiting. */
+      write_stats(params, connection_pool);
+      if (shutdown_requested)
+        {
+          status = APR_EINTR;
+          break;
+        }
+
       status = apr_socket_accept(&(*connection)->usock, sock,
                                  connection_pool);
       if (handling_mode == connection_mode_fork)
@@ -557,7 +730,7 @@ accept_connection(connection_t **connection,
             ;
         }
     }
-  while (APR_STATUS_IS_EINTR(status)
+  while ((APR_STATUS_IS_EINTR(status) && !shutdown_requested)
     || APR_STATUS_IS_ECONNABORTED(status)
     || APR_STATUS_IS_ECONNRESET(status));
 
@@ -656,8 +829,180 @@ static void * APR_THREAD_FUNC serve_thread(apr_thread_t *tid, void *data)
   return NULL;
 }
 
+/* In event mode, idle connections wait here until the client sends the
+   next command.  Only the event loop thread polls this. */
+static apr_pollset_t *idle_connections = NULL;
+
+/* serve_interruptable() callback for event mode: Never wait for data
+   that has not arrived yet. */
+static svn_boolean_t
+is_always_busy(connection_t *connection)
+{
+  return TRUE;
+}
+
+/* Add CONNECTION to IDLE_CONNECTIONS.  If that fails, log the error and
+   close the connection. */
+static void
+park_connection(connection_t *connection)
+{
+  apr_pollfd_t pfd = { 0 };
+  apr_status_t status;
+
+  pfd.p = connection->pool;
+  pfd.desc_type = APR_POLL_SOCKET;
+  pfd.reqevents = APR_POLLIN;
+  pfd.desc.s = connection->usock;
+  pfd.client_data = connection;
+
+  status = apr_pollset_add(idle_connections, &pfd);
+  if (status)
+    {
+      svn_error_t *err = svn_error_wrap_apr(status,
+                                            _("Can't add connection to "
+                                              "pollset"));
+      logger__log_error(connection->params->logger, err, NULL, NULL);
+      svn_error_clear(err);
+      close_connection(connection);
+    }
+}
+
+static void * APR_THREAD_FUNC serve_event_thread(apr_thread_t *tid,
+                                                 void *data);
+
+/* Let a worker thread serve CONNECTION in event mode.  If that fails,
+   log the error and close the connection. */
+static void
+schedule_connection(connection_t *connection)
+{
+  apr_status_t status = apr_thread_pool_push(threads, serve_event_thread,
+                                             connection, 0, NULL);
+  if (status)
+    {
+      svn_error_t *err = svn_error_wrap_apr(status, _("Can't push task"));
+      logger__log_error(connection->params->logger, err, NULL, NULL);
+      svn_error_clear(err);
+      close_connection(connection);
+    }
+}
+
+/* Serve the connection given by DATA in event mode.  Process only the
+   commands that have already arrived, then park the connection in
+   IDLE_CONNECTIONS again. */
+static void * APR_THREAD_FUNC serve_event_thread(apr_thread_t *tid,
+                                                 void *data)
+{
+  svn_boolean_t done;
+  svn_boolean_t has_command = FALSE;
+  connection_t *connection = data;
+  svn_error_t *err;
+
+  apr_pool_t *pool = svn_root_pools__acquire_pool(connection_pools);
+
+  /* Process the pending request, if any, and log errors.  For new
+     connections, this includes the handshake. */
+  err = serve_interruptable(&done, connection, is_always_busy, pool);
+
+  /* Pipelined commands may already sit in our receive buffer, where the
+     pollset would not see them. */
+  if (!err && !done)
+    err = svn_ra_svn__has_command(&has_command, &done, connection->conn,
+                                  pool);
+
+  if (err)
+    {
+      logger__log_error(connection->params->logger, err, NULL,
+                        get_client_info(connection->conn, connection->params,
+                                        pool));
+      svn_error_clear(err);
+      done = TRUE;
+    }
+  svn_root_pools__release_pool(pool, connection_pools);
+
+  /* Close, continue or park connection. */
+  if (done)
+    close_connection(connection);
+  else if (has_command)
+    schedule_connection(connection);
+  else
+    park_connection(connection);
+
+  return NULL;
+}
+
+/* The event loop.  Wait for client activity on IDLE_CONNECTIONS and hand
+   the respective connections over to the worker THREADS.  Terminate
+   when shutdown has been requested.  DATA is the logger_t to use. */
+static void * APR_THREAD_FUNC event_loop_thread(apr_thread_t *tid,
+                                                void *data)
+{
+  logger_t *logger = data;
+
+  while (!shutdown_requested)
+    {
+      const apr_pollfd_t *ready;
+      apr_int32_t count;
+      apr_int32_t i;
+
+      apr_status_t status = apr_pollset_poll(idle_connections,
+                                             EVENT_LOOP_TIMEOUT,
+                                             &count, &ready);
+      if (APR_STATUS_IS_TIMEUP(status) || APR_STATUS_IS_EINTR(status))
+        continue;
+
+      if (status)
+        {
+          svn_error_t *err = svn_error_wrap_apr(status,
+                                                _("Can't poll connections"));
+          logger__log_error(logger, err, NULL, NULL);
+          svn_error_clear(err);
+          continue;
+        }
+
+      /* Connections are only ever served by one thread at a time.
+         They will be parked again once their commands have been
+         processed. */
+      for (i = 0; i < count; ++i)
+        {
+          connection_t *connection = ready[i].client_data;
+
+          apr_pollset_remove(idle_connections, &ready[i]);
+          schedule_connection(connection);
+        }
+    }
+
+  apr_thread_exit(tid, APR_SUCCESS);
+  return NULL;
+}
+
 #endif
 
+/* Load the FS cache contents from the snapshot file at PATH if SAVE is
+ * FALSE, otherwise write them to that file.  Errors are logged to LOGGER
+ * but never returned because the caches are merely an optimization.
+ * Use SCRATCH_POOL for temporary allocations.
+ */
+static void
+process_cache_snapshot(const char *path,
+                       svn_boolean_t save,
+                       logger_t *logger,
+                       apr_pool_t *scratch_pool)
+{
+  svn_fs_fs__ioctl_cache_snapshot_input_t input;
+  svn_error_t *err;
+
+  input.path = path;
+  err = svn_fs_ioctl(NULL,
+                     save ? SVN_FS_FS__IOCTL_SAVE_CACHE_SNAPSHOT
+                          : SVN_FS_FS__IOCTL_LOAD_CACHE_SNAPSHOT,
+                     &input, NULL, NULL, NULL, scratch_pool, scratch_pool);
+  if (err)
+    {
+      logger__log_error(logger, err, NULL, NULL);
+      svn_error_clear(err);
+    }
+}
+
 /* Write the PID of the current process as a decimal number, followed by a
    newline to the file FILENAME, using POOL for temporary allocations. */
 static svn_error_t *write_pid_file(const char *filename, apr_pool_t *pool)
@@ -725,6 +1070,7 @@ sub_main(int *exit_code, int argc, const char *argv[], apr_pool_t *pool)
   svn_boolean_t cache_txdeltas = TRUE;
   svn_boolean_t cache_revprops = FALSE;
   svn_boolean_t use_block_read = FALSE;
+  svn_boolean_t share_cache = FALSE;
   apr_uint16_t port = SVN_RA_SVN_PORT;
   const char *host = NULL;
   int family = APR_INET;
@@ -738,10 +1084,15 @@ sub_main(int *exit_code, int argc, const char *argv[], apr_pool_t *pool)
   int handling_opt_count = 0;
   const char *config_filename = NULL;
   const char *pid_filename = NULL;
+  const char *cache_snapshot = NULL;
   const char *log_filename = NULL;
+  const char *stats_filename = NULL;
   svn_node_kind_t kind;
   apr_size_t min_thread_count = THREADPOOL_MIN_SIZE;
   apr_size_t max_thread_count = THREADPOOL_MAX_SIZE;
+#if APR_HAS_THREADS
+  apr_thread_t *event_loop = NULL;
+#endif
 #ifdef SVN_HAVE_SASL
   SVN_ERR(cyrus_init(pool));
 #endif
@@ -766,14 +1117,18 @@ sub_main(int *exit_code, int argc, const char *argv[], apr_pool_t *pool)
   params.compression_level = SVN_DELTA_COMPRESSION_LEVEL_DEFAULT;
   params.logger = NULL;
   params.config_pool = NULL;
+  params.registry = NULL;
   params.fs_config = NULL;
   params.vhost = FALSE;
   params.username_case = CASE_ASIS;
   params.memory_cache_size = (apr_uint64_t)-1;
   params.zero_copy_limit = 0;
+  params.stream_compression = svn_ra_svn__stream_compression_none;
   params.error_check_interval = 4096;
   params.max_request_size = MAX_REQUEST_SIZE * 0x100000;
   params.max_response_size = 0;
+  params.stats = NULL;
+  params.slow_request_threshold = 0;
 
   while (1)
     {
@@ -824,6 +1179,11 @@ sub_main(int *exit_code, int argc, const char *argv[], apr_pool_t *pool)
           handling_opt_count++;
           break;
 
+        case SVNSERVE_OPT_EVENT_LOOP:
+          handling_mode = connection_mode_event;
+          handling_opt_count++;
+          break;
+
         case 'i':
           if (run_mode != run_mode_inetd)
             {
@@ -900,6 +1260,19 @@ sub_main(int *exit_code, int argc, const char *argv[], apr_pool_t *pool)
             params.compression_level = SVN_DELTA_COMPRESSION_LEVEL_MAX;
           break;
 
+        case SVNSERVE_OPT_STREAM_COMPRESSION:
+          if (strcmp(arg, "none") == 0)
+            params.stream_compression = svn_ra_svn__stream_compression_none;
+          else if (strcmp(arg, "lz4") == 0)
+            params.stream_compression = svn_ra_svn__stream_compression_lz4;
+          else if (strcmp(arg, "zlib") == 0)
+            params.stream_compression = svn_ra_svn__stream_compression_zlib;
+          else
+            return svn_error_createf(SVN_ERR_CL_ARG_PARSING_ERROR, NULL,
+                                     _("Invalid stream compression '%s'"),
+                                     arg);
+          break;
+
         case 'M':
           {
             apr_uint64_t sz_val;
@@ -925,6 +1298,10 @@ sub_main(int *exit_code, int argc, const char *argv[], apr_pool_t *pool)
           cache_nodeprops = svn_tristate__from_word(arg) == svn_tristate_true;
           break;
 
+        case SVNSERVE_OPT_CACHE_SHARED:
+          share_cache = TRUE;
+          break;
+
         case SVNSERVE_OPT_BLOCK_READ:
           use_block_read = svn_tristate__from_word(arg) == svn_tristate_true;
           break;
@@ -985,6 +1362,13 @@ sub_main(int *exit_code, int argc, const char *argv[], apr_pool_t *pool)
           SVN_ERR(svn_dirent_get_absolute(&pid_filename, pid_filename, pool));
           break;
 
+        case SVNSERVE_OPT_CACHE_SNAPSHOT:
+          SVN_ERR(svn_utf_cstring_to_utf8(&cache_snapshot, arg, pool));
+          cache_snapshot = svn_dirent_internal_style(cache_snapshot, pool);
+          SVN_ERR(svn_dirent_get_absolute(&cache_snapshot, cache_snapshot,
+                                          pool));
+          break;
+
          case SVNSERVE_OPT_VIRTUAL_HOST:
            params.vhost = TRUE;
            break;
@@ -995,6 +1379,22 @@ sub_main(int *exit_code, int argc, const char *argv[], apr_pool_t *pool)
           SVN_ERR(svn_dirent_get_absolute(&log_filename, log_filename, pool));
           break;
 
+        case SVNSERVE_OPT_STATS_FILE:
+          SVN_ERR(svn_utf_cstring_to_utf8(&stats_filename, arg, pool));
+          stats_filename = svn_dirent_internal_style(stats_filename, pool);
+          SVN_ERR(svn_dirent_get_absolute(&stats_filename, stats_filename,
+                                          pool));
+          break;
+
+        case SVNSERVE_OPT_SLOW_REQUEST:
+          {
+            apr_uint64_t msec;
+            SVN_ERR(svn_cstring_atoui64(&msec, arg));
+
+            params.slow_request_threshold = apr_time_from_msec(msec);
+          }
+          break;
+
         }
     }
 
@@ -1029,7 +1429,8 @@ sub_main(int *exit_code, int argc, const char *argv[], apr_pool_t *pool)
   if (handling_opt_count > 1)
     {
       svn_error_clear(svn_cmdline_fputs(
-                      _("You may only specify one of -T or --single-thread\n"),
+                      _("You may only specify one of -T, --event-loop "
+                        "or --single-thread\n"),
                       stderr, pool));
       usage(argv[0], pool);
       *exit_code = EXIT_FAILURE;
@@ -1037,7 +1438,8 @@ sub_main(int *exit_code, int argc, const char *argv[], apr_pool_t *pool)
     }
 
   /* construct object pools */
-  is_multi_threaded = handling_mode == connection_mode_thread;
+  is_multi_threaded = handling_mode == connection_mode_thread
+                   || handling_mode == connection_mode_event;
   params.fs_config = apr_hash_make(pool);
   svn_hash_sets(params.fs_config, SVN_FS_CONFIG_FSFS_CACHE_DELTAS,
                 cache_txdeltas ? "1" :"0");
@@ -1054,6 +1456,13 @@ sub_main(int *exit_code, int argc, const char *argv[], apr_pool_t *pool)
                                         is_multi_threaded,
                                         pool));
 
+  /* Processes that serve many connections keep repositories open and
+   * their configuration parsed in between. */
+  if (   run_mode != run_mode_inetd && run_mode != run_mode_tunnel
+      && run_mode != run_mode_listen_once
+      && handling_mode != connection_mode_fork)
+    SVN_ERR(registry__create(&params.registry, pool));
+
   /* If a configuration file is specified, load it and any referenced
    * password and authorization files. */
   if (config_filename)
@@ -1079,6 +1488,20 @@ sub_main(int *exit_code, int argc, const char *argv[], apr_pool_t *pool)
                _("Option --tunnel-user is only valid in tunnel mode"));
     }
 
+  /* Totals are kept in memory.  A process per connection would collect
+   * and write only that connection's share. */
+  if (stats_filename)
+    {
+      if (   run_mode == run_mode_inetd || run_mode == run_mode_tunnel
+          || (   run_mode != run_mode_listen_once
+              && handling_mode == connection_mode_fork))
+        return svn_error_create(SVN_ERR_CL_ARG_PARSING_ERROR, NULL,
+                 _("Option --stats-file requires daemon or listen-once "
+                   "mode and must not be combined with forking"));
+
+      SVN_ERR(stats__create(&params.stats, stats_filename, pool));
+    }
+
   if (run_mode == run_mode_inetd || run_mode == run_mode_tunnel)
     {
       apr_pool_t *connection_pool;
@@ -1256,6 +1679,18 @@ sub_main(int *exit_code, int argc, const char *argv[], apr_pool_t *pool)
   apr_signal(SIGXFSZ, SIG_IGN);
 #endif
 
+#ifdef SIGTERM
+  /* Without a snapshot or statistics to write, there is nothing to clean
+   * up and we may simply be killed. */
+  if (cache_snapshot || params.stats)
+    apr_signal(SIGTERM, sigterm_handler);
+#endif
+
+#ifdef SIGUSR2
+  if (params.stats)
+    apr_signal(SIGUSR2, sigusr2_handler);
+#endif
+
   if (pid_filename)
     SVN_ERR(write_pid_file(pid_filename, pool));
 
@@ -1280,7 +1715,7 @@ sub_main(int *exit_code, int argc, const char *argv[], apr_pool_t *pool)
       settings.cache_size = params.memory_cache_size;
 
     settings.single_threaded = TRUE;
-    if (handling_mode == connection_mode_thread)
+    if (is_multi_threaded)
       {
 #if APR_HAS_THREADS
         settings.single_threaded = FALSE;
@@ -1295,12 +1730,22 @@ sub_main(int *exit_code, int argc, const char *argv[], apr_pool_t *pool)
       }
 
     svn_cache_config_set(&settings);
+
+    /* Let all forked connection processes use the same cache.  It must
+     * be created before the first fork. */
+    if (share_cache && handling_mode == connection_mode_fork)
+      SVN_ERR(svn_cache_config_create_shared());
+
+    /* Fill the caches before serving the first request, and before
+     * forking in particular. */
+    if (cache_snapshot)
+      process_cache_snapshot(cache_snapshot, FALSE, params.logger, pool);
   }
 
 #if APR_HAS_THREADS
   SVN_ERR(svn_root_pools__create(&connection_pools));
 
-  if (handling_mode == connection_mode_thread)
+  if (is_multi_threaded)
     {
       /* create the thread pool with a valid range of threads */
       if (max_thread_count < 1)
@@ -1308,10 +1753,12 @@ sub_main(int *exit_code, int argc, const char *argv[], apr_pool_t *pool)
       if (min_thread_count > max_thread_count)
         min_thread_count = max_thread_count;
 
+      block_signals();
       status = apr_thread_pool_create(&threads,
                                       min_thread_count,
                                       max_thread_count,
                                       pool);
+      unblock_signals();
       if (status)
         {
           return svn_error_wrap_apr(status, _("Can't create thread pool"));
@@ -1328,13 +1775,40 @@ sub_main(int *exit_code, int argc, const char *argv[], apr_pool_t *pool)
     {
       threads = NULL;
     }
+
+  if (handling_mode == connection_mode_event)
+    {
+      /* Worker threads add connections while the event loop polls. */
+      status = apr_pollset_create(&idle_connections, EVENT_BATCH_SIZE,
+                                  pool, APR_POLLSET_THREADSAFE);
+      if (status)
+        return svn_error_wrap_apr(status,
+                                  _("Can't create pollset for the event "
+                                    "loop"));
+
+      block_signals();
+      status = apr_thread_create(&event_loop, NULL, event_loop_thread,
+                                 params.logger, pool);
+      unblock_signals();
+      if (status)
+        return svn_error_wrap_apr(status, _("Can't create thread"));
+    }
 #endif
 
   while (1)
     {
       connection_t *connection = NULL;
-      SVN_ERR(accept_connection(&connection, sock, &params, handling_mode,
-                                pool));
+      err = accept_connection(&connection, sock, &params, handling_mode,
+                              pool);
+      if (shutdown_requested)
+        {
+          svn_error_clear(err);
+          if (connection)
+            close_connection(connection);
+          break;
+        }
+      SVN_ERR(err);
+
       if (run_mode == run_mode_listen_once)
         {
           err = serve_socket(connection, connection->pool);
@@ -1352,6 +1826,12 @@ sub_main(int *exit_code, int argc, const char *argv[], apr_pool_t *pool)
               /* the child wouldn't listen to the main server's socket */
               apr_socket_close(sock);
 
+              /* nor should it write the cache snapshot */
+#ifdef SIGTERM
+              if (cache_snapshot)
+                apr_signal(SIGTERM, SIG_DFL);
+#endif
+
               /* serve_socket() logs any error it returns, so ignore it. */
               svn_error_clear(serve_socket(connection, connection->pool));
               close_connection(connection);
@@ -1373,8 +1853,28 @@ sub_main(int *exit_code, int argc, const char *argv[], apr_pool_t *pool)
 #if APR_HAS_THREADS
           attach_connection(connection);
 
+          block_signals();
           status = apr_thread_pool_push(threads, serve_thread, connection,
                                         0, NULL);
+          unblock_signals();
+          if (status)
+            {
+              return svn_error_wrap_apr(status, _("Can't push task"));
+            }
+#endif
+          break;
+
+        case connection_mode_event:
+          /* Let a worker thread do the handshake and process the first
+             command.  After that, the connection waits in the event
+             loop's pollset whenever it is idle. */
+#if APR_HAS_THREADS
+          attach_connection(connection);
+
+          block_signals();
+          status = apr_thread_pool_push(threads, serve_event_thread,
+                                        connection, 0, NULL);
+          unblock_signals();
           if (status)
             {
               return svn_error_wrap_apr(status, _("Can't push task"));
@@ -1391,7 +1891,25 @@ sub_main(int *exit_code, int argc, const char *argv[], apr_pool_t *pool)
       close_connection(connection);
     }
 
-  /* NOTREACHED */
+  /* We only get here upon SIGTERM.  Connections being served by other
+   * threads or processes will continue until they are done. */
+#if APR_HAS_THREADS
+  if (event_loop)
+    {
+      /* Parked connections will simply be dropped. */
+      apr_status_t retval;
+      status = apr_thread_join(&retval, event_loop);
+      if (status)
+        return svn_error_wrap_apr(status, _("Can't join thread"));
+    }
+#endif
+
+  process_cache_snapshot(cache_snapshot, TRUE, params.logger, pool);
+
+  stats_requested = TRUE;
+  write_stats(&params, pool);
+
+  return SVN_NO_ERROR;
 }
 
 int
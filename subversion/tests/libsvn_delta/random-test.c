@@ -37,6 +37,7 @@
 #include "svn_pools.h"
 #include "svn_error.h"
 
+#include "private/svn_delta_private.h"
 #include "../../libsvn_delta/delta.h"
 #include "delta-window-test.h"
 
@@ -605,6 +606,116 @@ random_txdelta_to_svndiff_stream_test(apr_pool_t *pool)
   return err;
 }
 
+/* Deltify TARGET against SOURCE using the xdelta implementation IMPL and
+   return the resulting svndiff data in *DIFF.  Rewind both files first.
+   Allocate the result in POOL. */
+static svn_error_t *
+make_svndiff(svn_stringbuf_t **diff,
+             svn_txdelta__xdelta_impl_t impl,
+             apr_file_t *source,
+             apr_file_t *target,
+             apr_pool_t *pool)
+{
+  svn_txdelta_stream_t *txdelta_stream;
+  svn_txdelta_window_handler_t handler;
+  void *handler_baton;
+
+  rewind_file(source);
+  rewind_file(target);
+  *diff = svn_stringbuf_create_empty(pool);
+
+  SVN_TEST_ASSERT(svn_txdelta__xdelta_set_impl(impl));
+  svn_txdelta_to_svndiff3(&handler, &handler_baton,
+                          svn_stream_from_stringbuf(*diff, pool), 0,
+                          SVN_DELTA_COMPRESSION_LEVEL_NONE, pool);
+  svn_txdelta2(&txdelta_stream,
+               svn_stream_from_aprfile2(source, TRUE, pool),
+               svn_stream_from_aprfile2(target, TRUE, pool),
+               FALSE, pool);
+
+  return svn_error_trace(svn_txdelta_send_txstream(txdelta_stream, handler,
+                                                   handler_baton, pool));
+}
+
+/* (Note: *LAST_SEED is an output parameter.) */
+static svn_error_t *
+do_random_xdelta_impl_test(apr_pool_t *pool,
+                           apr_uint32_t *last_seed)
+{
+  static const svn_txdelta__xdelta_impl_t impls[]
+    = { svn_txdelta__xdelta_impl_sse41, svn_txdelta__xdelta_impl_avx2 };
+  apr_uint32_t seed, maxlen;
+  apr_size_t bytes_range;
+  int i, j, iterations, dump_files, print_windows;
+  const char *random_bytes;
+  apr_pool_t *iterpool = svn_pool_create(pool);
+  svn_error_t *err = SVN_NO_ERROR;
+
+  for (j = 0; j < sizeof(impls) / sizeof(impls[0]); j++)
+    if (svn_txdelta__xdelta_set_impl(impls[j]))
+      break;
+
+  if (j == sizeof(impls) / sizeof(impls[0]))
+    return svn_error_create(SVN_ERR_TEST_SKIPPED, NULL,
+                            "no vectorized xdelta implementation");
+
+  /* Initialize parameters and print out the seed in case we dump core
+     or something. */
+  init_params(&seed, &maxlen, &iterations, &dump_files, &print_windows,
+              &random_bytes, &bytes_range, pool);
+
+  for (i = 0; i < iterations && !err; i++)
+    {
+      /* Generate source and target for the delta. */
+      apr_uint32_t subseed_base = svn_test_rand((*last_seed = seed, &seed));
+      apr_file_t *source = generate_random_file(maxlen, subseed_base, &seed,
+                                                random_bytes, bytes_range,
+                                                dump_files, pool);
+      apr_file_t *target = generate_random_file(maxlen, subseed_base, &seed,
+                                                random_bytes, bytes_range,
+                                                dump_files, pool);
+      svn_stringbuf_t *expected;
+
+      svn_pool_clear(iterpool);
+      err = make_svndiff(&expected, svn_txdelta__xdelta_impl_scalar,
+                         source, target, iterpool);
+
+      /* All supported implementations must produce the very same delta. */
+      for (j = 0; j < sizeof(impls) / sizeof(impls[0]) && !err; j++)
+        {
+          svn_stringbuf_t *actual;
+
+          if (!svn_txdelta__xdelta_set_impl(impls[j]))
+            continue;
+
+          err = make_svndiff(&actual, impls[j], source, target, iterpool);
+          if (!err && !svn_stringbuf_compare(expected, actual))
+            err = svn_error_createf(SVN_ERR_TEST_FAILED, NULL,
+                                    "xdelta implementation %d differs "
+                                    "from the scalar one", (int)impls[j]);
+        }
+
+      apr_file_close(source);
+      apr_file_close(target);
+    }
+
+  svn_txdelta__xdelta_set_impl(svn_txdelta__xdelta_impl_auto);
+  svn_pool_destroy(iterpool);
+
+  return svn_error_trace(err);
+}
+
+/* Implements svn_test_driver_t. */
+static svn_error_t *
+random_xdelta_impl_test(apr_pool_t *pool)
+{
+  apr_uint32_t seed;
+  svn_error_t *err = do_random_xdelta_impl_test(pool, &seed);
+  if (err)
+    fprintf(stderr, "SEED: %lu\n", (unsigned long)seed);
+  return err;
+}
+
 /* Change to 1 to enable the unit test for the delta combiner's range index: */
 #if 0
 #include "range-index-test.h"
@@ -625,6 +736,8 @@ static struct svn_test_descriptor_t test_funcs[] =
                    "random combine delta test"),
     SVN_TEST_PASS2(random_txdelta_to_svndiff_stream_test,
                    "random txdelta to svndiff stream test"),
+    SVN_TEST_PASS2(random_xdelta_impl_test,
+                   "random vectorized xdelta test"),
 #ifdef SVN_RANGE_INDEX_TEST_H
     SVN_TEST_PASS2(random_range_index_test,
                    "random range index test"),
@@ -22,8 +22,11 @@
  */
 
 #include "svn_delta.h"
+#include "private/svn_delta_private.h"
 #include "../svn_test.h"
 
+#include "../../libsvn_delta/delta.h"
+
 static svn_error_t *
 null_window(svn_txdelta_window_t **window,
             void *baton, apr_pool_t *pool)
@@ -66,6 +69,118 @@ test_txdelta_to_svndiff_stream_small_reads(apr_pool_t *pool)
   return SVN_NO_ERROR;
 }
 
+/* Return LEN bytes of pseudo-random data allocated in POOL. */
+static svn_stringbuf_t *
+random_data(apr_size_t len,
+            apr_pool_t *pool)
+{
+  svn_stringbuf_t *result = svn_stringbuf_create_ensure(len, pool);
+  apr_uint32_t seed = 0x5eed;
+
+  while (result->len < len)
+    {
+      seed = seed * 1103515245 + 12345;
+      svn_stringbuf_appendbyte(result, (char)(seed >> 16));
+    }
+
+  return result;
+}
+
+/* Deltify TARGET against SOURCE using delta windows of WINDOW_SIZE bytes,
+   encode the result in svndiff version SVNDIFF_VERSION and return it in
+   *SVNDIFF.  Allocate the result in POOL. */
+static svn_error_t *
+encode_delta(svn_stringbuf_t **svndiff,
+             svn_stringbuf_t *source,
+             svn_stringbuf_t *target,
+             apr_size_t window_size,
+             int svndiff_version,
+             apr_pool_t *pool)
+{
+  svn_txdelta_window_handler_t handler;
+  void *handler_baton;
+  svn_stream_t *push_stream;
+  apr_size_t len = target->len;
+
+  *svndiff = svn_stringbuf_create_empty(pool);
+  svn_txdelta_to_svndiff3(&handler, &handler_baton,
+                          svn_stream_from_stringbuf(*svndiff, pool),
+                          svndiff_version,
+                          SVN_DELTA_COMPRESSION_LEVEL_DEFAULT, pool);
+  push_stream = svn_txdelta__target_push(handler, handler_baton,
+                                         svn_stream_from_stringbuf(source,
+                                                                   pool),
+                                         window_size, pool);
+  SVN_ERR(svn_stream_write(push_stream, target->data, &len));
+  SVN_ERR(svn_stream_close(push_stream));
+
+  return SVN_NO_ERROR;
+}
+
+static svn_error_t *
+test_svndiff3_large_windows(apr_pool_t *pool)
+{
+  svn_stringbuf_t *source = random_data(3 * 1024 * 1024, pool);
+  svn_stringbuf_t *target;
+  svn_stringbuf_t *svndiff1, *svndiff3;
+  svn_stringbuf_t *result = svn_stringbuf_create_empty(pool);
+  svn_txdelta_window_handler_t handler;
+  void *handler_baton;
+  svn_stream_t *parse_stream;
+  apr_size_t len;
+
+  /* Rotate SOURCE by 1MB such that matching data is far apart. */
+  target = svn_stringbuf_ncreate(source->data + 1024 * 1024,
+                                 source->len - 1024 * 1024, pool);
+  svn_stringbuf_appendbytes(target, source->data, 1024 * 1024);
+
+  SVN_ERR(encode_delta(&svndiff1, source, target, SVN_DELTA_WINDOW_SIZE, 1,
+                       pool));
+  SVN_ERR(encode_delta(&svndiff3, source, target,
+                       SVN_DELTA__LARGE_WINDOW_SIZE, 3, pool));
+
+  /* Standard windows can't see the moved data, large windows can. */
+  SVN_TEST_ASSERT(svndiff1->len > target->len / 2);
+  SVN_TEST_ASSERT(svndiff3->len < target->len / 100);
+
+  /* Check that the large windows can be applied again. */
+  svn_txdelta_apply(svn_stream_from_stringbuf(source, pool),
+                    svn_stream_from_stringbuf(result, pool),
+                    NULL, NULL, pool, &handler, &handler_baton);
+  parse_stream = svn_txdelta__parse_svndiff(handler, handler_baton, TRUE,
+                                            TRUE, pool);
+  len = svndiff3->len;
+  SVN_ERR(svn_stream_write(parse_stream, svndiff3->data, &len));
+  SVN_ERR(svn_stream_close(parse_stream));
+
+  SVN_TEST_ASSERT(svn_stringbuf_compare(result, target));
+
+  /* The public parser must not accept version 3 from arbitrary peers. */
+  svn_txdelta_apply(svn_stream_from_stringbuf(source, pool),
+                    svn_stream_empty(pool),
+                    NULL, NULL, pool, &handler, &handler_baton);
+  parse_stream = svn_txdelta_parse_svndiff(handler, handler_baton, TRUE,
+                                           pool);
+  len = svndiff3->len;
+  SVN_TEST_ASSERT_ERROR(svn_stream_write(parse_stream, svndiff3->data, &len),
+                        SVN_ERR_SVNDIFF_INVALID_HEADER);
+
+  return SVN_NO_ERROR;
+}
+
+static svn_error_t *
+test_svndiff1_rejects_large_windows(apr_pool_t *pool)
+{
+  svn_stringbuf_t *source = random_data(1024 * 1024, pool);
+  svn_stringbuf_t *svndiff;
+
+  SVN_TEST_ASSERT_ERROR(encode_delta(&svndiff, source, source,
+                                     SVN_DELTA__LARGE_WINDOW_SIZE, 1, pool),
+                        SVN_ERR_SVNDIFF_CORRUPT_WINDOW);
+
+  return SVN_NO_ERROR;
+}
+
 static int max_threads = -1;
 
 static struct svn_test_descriptor_t test_funcs[] =
@@ -73,6 +188,10 @@ static struct svn_test_descriptor_t test_funcs[] =
   SVN_TEST_NULL,
   SVN_TEST_PASS2(test_txdelta_to_svndiff_stream_small_reads,
                  "test svn_txdelta_to_svndiff_stream() small reads"),
+  SVN_TEST_PASS2(test_svndiff3_large_windows,
+                 "test svndiff3 with large delta windows"),
+  SVN_TEST_PASS2(test_svndiff1_rejects_large_windows,
+                 "test svndiff1 rejecting large delta windows"),
   SVN_TEST_NULL
 };
 
@@ -0,0 +1,340 @@
+/* xdelta-bench.c -- measure the throughput of the xdelta generator
+ *
+ * ====================================================================
+ *    Licensed to the Apache Software Foundation (ASF) under one
+ *    or more contributor license agreements.  See the NOTICE file
+ *    distributed with this work for additional information
+ *    regarding copyright ownership.  The ASF licenses this file
+ *    to you under the Apache License, Version 2.0 (the
+ *    "License"); you may not use this file except in compliance
+ *    with the License.  You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *    Unless required by applicable law or agreed to in writing,
+ *    software distributed under the License is distributed on an
+ *    "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+ *    KIND, either express or implied.  See the License for the
+ *    specific language governing permissions and limitations
+ *    under the License.
+ * ====================================================================
+ */
+
+/* This is not a unit test.  It generates pairs of source and target
+ * texts of various kinds, runs them through svn_txdelta2() and reports
+ * how many MB of target data got deltified per second by each of the
+ * xdelta implementations that the CPU supports.  All data is generated
+ * from a fixed seed, so the numbers are comparable between runs and
+ * between builds.
+ */
+
+#define APR_WANT_STDIO
+#include <apr_want.h>
+
+#include <apr_general.h>
+#include <apr_time.h>
+
+#include "svn_ctype.h"
+#include "svn_delta.h"
+#include "svn_error.h"
+#include "svn_pools.h"
+#include "svn_string.h"
+
+#include "private/svn_delta_private.h"
+
+/* Default size of each generated source and target text. */
+#define DEFAULT_TEXT_SIZE (16 * 1024 * 1024)
+
+/* Number of times we run the delta for each kind of text.  We report
+ * the best run to filter out noise. */
+#define DEFAULT_REPEAT 5
+
+/* The kinds of data we generate. */
+typedef enum text_kind_t
+{
+  /* Uniformly distributed random bytes, i.e. incompressible binary data. */
+  text_random,
+
+  /* Lines of words taken from a small vocabulary, i.e. source code
+   * or plain text. */
+  text_words,
+
+  /* Binary data with long runs and repeating structure, e.g. an
+   * uncompressed image or a database page dump. */
+  text_compressible
+} text_kind_t;
+
+/* Human-readable names of the TEXT_KIND_T values. */
+static const char *const kind_names[] =
+  { "random", "text", "compressible" };
+
+/* The xdelta implementations to compare and their names. */
+static const svn_txdelta__xdelta_impl_t impls[] =
+  { svn_txdelta__xdelta_impl_scalar,
+    svn_txdelta__xdelta_impl_sse41,
+    svn_txdelta__xdelta_impl_avx2 };
+static const char *const impl_names[] =
+  { "scalar", "sse4.1", "avx2" };
+
+/* Simple linear congruential pseudo-random number generator.
+ * Update *SEED and return the next pseudo-random number. */
+static apr_uint32_t
+next_rand(apr_uint32_t *seed)
+{
+  *seed = *seed * 1103515245 + 12345;
+  return *seed >> 8;
+}
+
+/* Append LEN bytes of data of the given KIND to BUFFER.
+ * Use and update the random number generator state in *SEED. */
+static void
+append_data(svn_stringbuf_t *buffer,
+            text_kind_t kind,
+            apr_size_t len,
+            apr_uint32_t *seed)
+{
+  static const char *const words[] =
+    { "the ", "delta ", "window ", "svn_error_t ", "commit", "(pool);\n",
+      "if ", "return ", "  ", "= ", "source ", "target\n", "{\n", "}\n" };
+
+  apr_size_t target_len = buffer->len + len;
+  while (buffer->len < target_len)
+    switch (kind)
+      {
+        case text_random:
+          svn_stringbuf_appendbyte(buffer, (char)next_rand(seed));
+          break;
+
+        case text_words:
+          svn_stringbuf_appendcstr(buffer,
+                words[next_rand(seed) % (sizeof(words) / sizeof(words[0]))]);
+          break;
+
+        case text_compressible:
+          {
+            /* A short run of a single value, followed by a small
+             * structured record. */
+            apr_size_t run = next_rand(seed) % 64;
+            char value = (char)(next_rand(seed) % 4);
+            char record[2];
+
+            record[0] = (char)(buffer->len >> 8);
+            record[1] = value;
+
+            svn_stringbuf_appendfill(buffer, value, run);
+            svn_stringbuf_appendbytes(buffer, record, sizeof(record));
+          }
+          break;
+      }
+
+  svn_stringbuf_chop(buffer, buffer->len - target_len);
+}
+
+/* Return a text of TEXT_SIZE bytes of the given KIND.
+ * Use and update the random number generator state in *SEED.
+ * Allocate the result in POOL. */
+static svn_stringbuf_t *
+make_source(text_kind_t kind,
+            apr_size_t text_size,
+            apr_uint32_t *seed,
+            apr_pool_t *pool)
+{
+  svn_stringbuf_t *result = svn_stringbuf_create_ensure(text_size, pool);
+  append_data(result, kind, text_size, seed);
+
+  return result;
+}
+
+/* Return a modified copy of SOURCE, i.e. the result of a typical edit.
+ * Use data of the given KIND for insertions.  Use and update the random
+ * number generator state in *SEED.  Allocate the result in POOL. */
+static svn_stringbuf_t *
+make_target(const svn_stringbuf_t *source,
+            text_kind_t kind,
+            apr_uint32_t *seed,
+            apr_pool_t *pool)
+{
+  svn_stringbuf_t *result = svn_stringbuf_create_ensure(source->len, pool);
+  apr_size_t pos = 0;
+
+  /* Alternate between copying unchanged sections from SOURCE and
+   * replacing, inserting or deleting shorter sections. */
+  while (pos < source->len)
+    {
+      apr_size_t copy = next_rand(seed) % 0x10000;
+      apr_size_t change = next_rand(seed) % 0x400;
+
+      if (copy > source->len - pos)
+        copy = source->len - pos;
+
+      svn_stringbuf_appendbytes(result, source->data + pos, copy);
+      pos += copy;
+
+      switch (next_rand(seed) % 3)
+        {
+          case 0: /* replace */
+            append_data(result, kind, change, seed);
+            pos += change;
+            break;
+
+          case 1: /* insert */
+            append_data(result, kind, change, seed);
+            break;
+
+          default: /* delete */
+            pos += change;
+            break;
+        }
+    }
+
+  return result;
+}
+
+/* Deltify TARGET against SOURCE and return the time it took in *DURATION.
+ * Return the total size of the new data in the delta windows in
+ * *NEW_DATA_LEN.  Use POOL for temporary allocations. */
+static svn_error_t *
+run_delta(apr_interval_time_t *duration,
+          apr_size_t *new_data_len,
+          const svn_stringbuf_t *source,
+          const svn_stringbuf_t *target,
+          apr_pool_t *pool)
+{
+  apr_pool_t *iterpool = svn_pool_create(pool);
+  svn_txdelta_stream_t *delta_stream;
+  svn_txdelta_window_t *window;
+  apr_time_t start;
+
+  svn_txdelta2(&delta_stream,
+               svn_stream_from_stringbuf(svn_stringbuf_dup(source, pool),
+                                         pool),
+               svn_stream_from_stringbuf(svn_stringbuf_dup(target, pool),
+                                         pool),
+               FALSE, pool);
+
+  *new_data_len = 0;
+  start = apr_time_now();
+  do
+    {
+      svn_pool_clear(iterpool);
+      SVN_ERR(svn_txdelta_next_window(&window, delta_stream, iterpool));
+      if (window)
+        *new_data_len += window->new_data->len;
+    }
+  while (window);
+
+  *duration = apr_time_now() - start;
+  svn_pool_destroy(iterpool);
+
+  return SVN_NO_ERROR;
+}
+
+/* Deltify TARGET against SOURCE REPEAT times with each supported xdelta
+ * implementation.  Print the results for the text KIND to stdout.
+ * Use POOL for temporary allocations. */
+static svn_error_t *
+bench_impls(text_kind_t kind,
+            const svn_stringbuf_t *source,
+            const svn_stringbuf_t *target,
+            int repeat,
+            apr_pool_t *pool)
+{
+  apr_pool_t *iterpool = svn_pool_create(pool);
+  int i, k;
+
+  for (k = 0; k < sizeof(impls) / sizeof(impls[0]); ++k)
+    {
+      apr_interval_time_t best = 0;
+      apr_size_t new_data_len = 0;
+
+      if (!svn_txdelta__xdelta_set_impl(impls[k]))
+        continue;
+
+      for (i = 0; i < repeat; ++i)
+        {
+          apr_interval_time_t duration;
+
+          svn_pool_clear(iterpool);
+          SVN_ERR(run_delta(&duration, &new_data_len, source, target,
+                            iterpool));
+          if (i == 0 || duration < best)
+            best = duration;
+        }
+
+      /* Avoid division by zero for tiny inputs. */
+      if (best == 0)
+        best = 1;
+
+      printf("%-14s %-8s %10" APR_SIZE_T_FMT " bytes %10.1f MB/s"
+             "  new data %5.1f%%\n",
+             kind_names[kind], impl_names[k], target->len,
+             (double)target->len / (double)best * APR_USEC_PER_SEC / 0x100000,
+             100.0 * new_data_len / target->len);
+    }
+
+  svn_txdelta__xdelta_set_impl(svn_txdelta__xdelta_impl_auto);
+  svn_pool_destroy(iterpool);
+
+  return SVN_NO_ERROR;
+}
+
+/* Generate source and target texts of TEXT_SIZE bytes of the given KIND
+ * and deltify them REPEAT times per xdelta implementation.  Print the
+ * results to stdout.  Use POOL for temporary allocations. */
+static svn_error_t *
+bench_kind(text_kind_t kind,
+           apr_size_t text_size,
+           int repeat,
+           apr_pool_t *pool)
+{
+  apr_uint32_t seed = 0x5eed + kind;
+  svn_stringbuf_t *source = make_source(kind, text_size, &seed, pool);
+  svn_stringbuf_t *target = make_target(source, kind, &seed, pool);
+
+  return svn_error_trace(bench_impls(kind, source, target, repeat, pool));
+}
+
+int
+main(int argc, char **argv)
+{
+  apr_pool_t *pool;
+  apr_size_t text_size = DEFAULT_TEXT_SIZE;
+  int repeat = DEFAULT_REPEAT;
+  text_kind_t kind;
+
+  while (argc > 1)
+    {
+      const char *const arg = argv[1];
+      if (arg[0] != '-')
+        break;
+
+      if (arg[1] == 's' && svn_ctype_isdigit(arg[2]))
+        text_size = (apr_size_t)atol(arg + 2) * 1024;
+      else if (svn_ctype_isdigit(arg[1]))
+        repeat = atoi(arg + 1);
+      else
+        break;
+      --argc; ++argv;
+    }
+
+  if (argc != 1 || text_size == 0 || repeat <= 0)
+    {
+      fprintf(stderr,
+              "Usage: xdelta-bench [-s<size in kB>] [-<repeat>]\n");
+      exit(1);
+    }
+
+  apr_initialize();
+  pool = svn_pool_create(NULL);
+
+  for (kind = text_random; kind <= text_compressible; ++kind)
+    {
+      svn_error_t *err = bench_kind(kind, text_size, repeat, pool);
+      if (err)
+        svn_handle_error2(err, stderr, TRUE, "xdelta-bench: ");
+    }
+
+  svn_pool_destroy(pool);
+  apr_terminate();
+  exit(0);
+}
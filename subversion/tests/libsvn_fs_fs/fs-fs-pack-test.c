@@ -74,12 +74,15 @@ static svn_error_t *
 pack_notify(void *baton,
             apr_int64_t shard,
             svn_fs_pack_notify_action_t action,
+            apr_interval_time_t duration,
             apr_pool_t *pool)
 {
   struct pack_notify_baton *pnb = baton;
 
   SVN_TEST_ASSERT(shard == pnb->expected_shard);
   SVN_TEST_ASSERT(action == pnb->expected_action);
+  SVN_TEST_ASSERT(duration >= 0);
+  SVN_TEST_ASSERT(duration == 0 || action == svn_fs_pack_notify_end);
 
   /* Update expectations. */
   switch (action)
@@ -191,7 +194,7 @@ create_packed_filesystem(const char *dir,
   /* Now pack the FS */
   pnb.expected_shard = 0;
   pnb.expected_action = svn_fs_pack_notify_start;
-  return svn_fs_pack(dir, pack_notify, &pnb, NULL, NULL, pool);
+  return svn_fs_pack2(dir, NULL, pack_notify, &pnb, NULL, NULL, pool);
 }
 
 /* Create a packed FSFS filesystem for revprop tests at REPO_NAME with
@@ -226,7 +229,7 @@ prepare_revprop_repo(svn_fs_t **fs,
   svn_pool_destroy(subpool);
 
   /* Pack the repository. */
-  SVN_ERR(svn_fs_pack(repo_name, NULL, NULL, NULL, NULL, pool));
+  SVN_ERR(svn_fs_pack2(repo_name, NULL, NULL, NULL, NULL, NULL, pool));
 
   return SVN_NO_ERROR;
 }
@@ -663,7 +666,7 @@ recover_fully_packed(const svn_test_opts_t *opts,
   SVN_ERR(svn_fs_commit_txn(&conflict, &after_rev, txn, subpool));
   SVN_TEST_ASSERT(SVN_IS_VALID_REVNUM(after_rev));
   svn_pool_destroy(subpool);
-  SVN_ERR(svn_fs_pack(REPO_NAME, NULL, NULL, NULL, NULL, pool));
+  SVN_ERR(svn_fs_pack2(REPO_NAME, NULL, NULL, NULL, NULL, NULL, pool));
   SVN_ERR(svn_fs_recover(REPO_NAME, NULL, NULL, pool));
 
   /* Now, delete the youngest revprop file, and recover again.  This
@@ -1002,7 +1005,7 @@ upgrade_txns_to_log_addressing(const svn_test_opts_t *opts,
   /* Pack repo to verify that old and new shard get packed according to
      their respective addressing mode */
 
-  SVN_ERR(svn_fs_pack(repo_name, NULL, NULL, NULL, NULL, pool));
+  SVN_ERR(svn_fs_pack2(repo_name, NULL, NULL, NULL, NULL, NULL, pool));
 
   /* verify that our changes got in */
 
@@ -1888,6 +1891,259 @@ large_delta_against_plain(const svn_test_opts_t *opts,
 
 #undef REPO_NAME
 
+/* ------------------------------------------------------------------------ */
+
+#define REPO_NAME "test-repo-large_delta_windows"
+
+/* Return LEN bytes of pseudo-random data allocated in POOL. */
+static svn_stringbuf_t *
+random_contents(apr_size_t len,
+                apr_pool_t *pool)
+{
+  svn_stringbuf_t *result = svn_stringbuf_create_ensure(len, pool);
+  apr_uint32_t seed = 0x5eed;
+
+  while (result->len < len)
+    {
+      seed = seed * 1103515245 + 12345;
+      svn_stringbuf_appendbyte(result, (char)(seed >> 16));
+    }
+
+  return result;
+}
+
+static svn_error_t *
+large_delta_windows(const svn_test_opts_t *opts,
+                    apr_pool_t *pool)
+{
+  svn_fs_t *fs;
+  fs_fs_data_t *ffd;
+  svn_fs_txn_t *txn;
+  svn_fs_root_t *root, *base_root;
+  svn_revnum_t rev;
+  svn_stringbuf_t *contents, *contents2, *contents_read;
+  svn_stream_t *stream;
+  svn_txdelta_stream_t *delta_stream;
+  svn_txdelta_window_t *window;
+  const char *rev_path;
+  apr_finfo_t finfo;
+  apr_hash_t *fs_config;
+
+  /* Bail (with success) on known-untestable scenarios */
+  if ((strcmp(opts->fs_type, "fsfs") != 0)
+      || (opts->server_minor_version && (opts->server_minor_version < 15)))
+    return svn_error_create(SVN_ERR_TEST_SKIPPED, NULL,
+                            "pre-1.15 SVN doesn't support large delta windows");
+
+  /* New repositories only use format 9 when asked to. */
+  if (! opts->server_minor_version)
+    {
+      SVN_ERR(svn_test__create_fs(&fs, REPO_NAME "-default", opts, pool));
+      ffd = fs->fsap_data;
+      SVN_TEST_INT_ASSERT(ffd->format, SVN_FS_FS__DEFAULT_FORMAT_NUMBER);
+      SVN_TEST_ASSERT(! ffd->large_delta_windows);
+    }
+
+  fs_config = apr_hash_make(pool);
+  svn_hash_sets(fs_config, SVN_FS_CONFIG_FSFS_LARGE_DELTA_WINDOWS, "true");
+  SVN_ERR(svn_test__create_fs2(&fs, REPO_NAME, opts, fs_config, pool));
+  ffd = fs->fsap_data;
+  SVN_TEST_INT_ASSERT(ffd->format, SVN_FS_FS__MIN_SVNDIFF3_FORMAT);
+  SVN_TEST_ASSERT(ffd->large_delta_windows);
+  SVN_TEST_ASSERT(ffd->delta_compression_type == compression_type_zlib);
+
+  /* Revision 1: a file that spans several standard delta windows. */
+  contents = random_contents(3 * 1024 * 1024, pool);
+  SVN_ERR(svn_fs_begin_txn(&txn, fs, 0, pool));
+  SVN_ERR(svn_fs_txn_root(&root, txn, pool));
+  SVN_ERR(svn_fs_make_file(root, "f", pool));
+  SVN_ERR(svn_test__set_file_contents(root, "f", contents->data, pool));
+  SVN_ERR(svn_fs_commit_txn(NULL, &rev, txn, pool));
+
+  /* Revision 2: move the first MB to the end of the file. */
+  contents2 = svn_stringbuf_ncreate(contents->data + 1024 * 1024,
+                                    contents->len - 1024 * 1024, pool);
+  svn_stringbuf_appendbytes(contents2, contents->data, 1024 * 1024);
+  SVN_ERR(svn_fs_begin_txn(&txn, fs, 1, pool));
+  SVN_ERR(svn_fs_txn_root(&root, txn, pool));
+  SVN_ERR(svn_test__set_file_contents(root, "f", contents2->data, pool));
+  SVN_ERR(svn_fs_commit_txn(NULL, &rev, txn, pool));
+
+  /* Large windows find the moved data, so r2 must be small. */
+  rev_path = svn_fs_fs__path_rev_absolute(fs, rev, pool);
+  SVN_ERR(svn_io_stat(&finfo, rev_path, APR_FINFO_SIZE, pool));
+  SVN_TEST_ASSERT(finfo.size < (apr_off_t)contents2->len / 10);
+
+  /* Reading the contents must work.  To make sure we actually read from
+   * disk, use a new FS instance with disjoint caches. */
+  fs_config = apr_hash_make(pool);
+  svn_hash_sets(fs_config, SVN_FS_CONFIG_FSFS_CACHE_NS,
+                           svn_uuid_generate(pool));
+  SVN_ERR(svn_fs_open2(&fs, REPO_NAME, fs_config, pool, pool));
+
+  SVN_ERR(svn_fs_revision_root(&root, fs, rev, pool));
+  SVN_ERR(svn_fs_file_contents(&stream, root, "f", pool));
+  SVN_ERR(svn_stringbuf_from_stream(&contents_read, stream, contents2->len,
+                                    pool));
+  SVN_TEST_ASSERT(svn_stringbuf_compare(contents_read, contents2));
+
+  /* Deltas handed out to our users must still use standard windows. */
+  SVN_ERR(svn_fs_revision_root(&base_root, fs, rev - 1, pool));
+  SVN_ERR(svn_fs_get_file_delta_stream(&delta_stream, base_root, "f",
+                                       root, "f", pool));
+  do
+    {
+      SVN_ERR(svn_txdelta_next_window(&window, delta_stream, pool));
+      if (window)
+        SVN_TEST_ASSERT(window->tview_len <= 102400);
+    }
+  while (window);
+
+  return SVN_NO_ERROR;
+}
+
+#undef REPO_NAME
+
+/* ------------------------------------------------------------------------ */
+
+#define REPO_NAME "test-repo-pack_concurrently"
+#define SHARD_SIZE 3
+#define MAX_REV 40
+static svn_error_t *
+pack_concurrently(const svn_test_opts_t *opts,
+                  apr_pool_t *pool)
+{
+  struct pack_notify_baton pnb;
+  apr_hash_t *fs_config;
+  svn_fs_t *fs;
+  svn_revnum_t rev;
+
+  /* Bail (with success) on known-untestable scenarios */
+  if (strcmp(opts->fs_type, "fsfs") != 0)
+    return svn_error_create(SVN_ERR_TEST_SKIPPED, NULL,
+                            "this will test FSFS repositories only");
+
+  SVN_ERR(create_non_packed_filesystem(REPO_NAME, opts, MAX_REV, SHARD_SIZE,
+                                       pool));
+
+  /* Pack with multiple jobs.  Notifications must still arrive in order. */
+  fs_config = apr_hash_make(pool);
+  svn_hash_sets(fs_config, SVN_FS_CONFIG_FSFS_PACK_JOBS, "4");
+
+  pnb.expected_shard = 0;
+  pnb.expected_action = svn_fs_pack_notify_start;
+  SVN_ERR(svn_fs_pack2(REPO_NAME, fs_config, pack_notify, &pnb, NULL, NULL,
+                       pool));
+  SVN_TEST_ASSERT(pnb.expected_shard == (MAX_REV + 1) / SHARD_SIZE);
+
+  /* The result must be a valid repository with all complete shards
+   * packed. */
+  SVN_ERR(svn_fs_open2(&fs, REPO_NAME, NULL, pool, pool));
+  SVN_ERR(svn_fs_verify(REPO_NAME, NULL, 0, MAX_REV, NULL, NULL, NULL, NULL,
+                        pool));
+  for (rev = 0; rev <= MAX_REV; ++rev)
+    SVN_TEST_ASSERT(svn_fs_fs__is_packed_rev(fs, rev)
+                    == (rev < (MAX_REV + 1) / SHARD_SIZE * SHARD_SIZE));
+
+  return SVN_NO_ERROR;
+}
+
+#undef REPO_NAME
+#undef SHARD_SIZE
+#undef MAX_REV
+
+/* ------------------------------------------------------------------------ */
+
+#define REPO_NAME "test-repo-prefetch_delta_chain"
+#define MAX_REV 20
+
+static svn_error_t *
+prefetch_delta_chain(const svn_test_opts_t *opts,
+                     apr_pool_t *pool)
+{
+  svn_fs_t *fs;
+  fs_fs_data_t *ffd;
+  svn_fs_txn_t *txn;
+  svn_fs_root_t *root;
+  svn_revnum_t rev;
+  svn_stringbuf_t *contents[MAX_REV + 1];
+  apr_hash_t *fs_config;
+  apr_pool_t *iterpool = svn_pool_create(pool);
+
+  /* Bail (with success) on known-untestable scenarios */
+  if ((strcmp(opts->fs_type, "fsfs") != 0)
+      || (opts->server_minor_version && (opts->server_minor_version < 15)))
+    return svn_error_create(SVN_ERR_TEST_SKIPPED, NULL,
+                            "pre-1.15 SVN doesn't support prefetching");
+
+#if !APR_HAS_THREADS
+  return svn_error_create(SVN_ERR_TEST_SKIPPED, NULL,
+                          "prefetching requires threads");
+#endif
+
+  SVN_ERR(svn_test__create_fs(&fs, REPO_NAME, opts, pool));
+
+  /* Revision 1: a file that spans several delta windows. */
+  contents[1] = random_contents(300 * 1024, pool);
+  SVN_ERR(svn_fs_begin_txn(&txn, fs, 0, pool));
+  SVN_ERR(svn_fs_txn_root(&root, txn, pool));
+  SVN_ERR(svn_fs_make_file(root, "f", pool));
+  SVN_ERR(svn_test__set_file_contents(root, "f", contents[1]->data, pool));
+  SVN_ERR(svn_fs_commit_txn(NULL, &rev, txn, pool));
+
+  /* Each following revision modifies and extends the file a bit, creating
+   * delta chains of various lengths. */
+  for (rev = 2; rev <= MAX_REV; ++rev)
+    {
+      svn_pool_clear(iterpool);
+
+      contents[rev] = svn_stringbuf_dup(contents[rev - 1], pool);
+      memset(contents[rev]->data + rev * 7919, 'x', 100);
+      svn_stringbuf_appendcstr(contents[rev], "more text\n");
+
+      SVN_ERR(svn_fs_begin_txn(&txn, fs, rev - 1, iterpool));
+      SVN_ERR(svn_fs_txn_root(&root, txn, iterpool));
+      SVN_ERR(svn_test__set_file_contents(root, "f", contents[rev]->data,
+                                          iterpool));
+      SVN_ERR(svn_fs_commit_txn(NULL, &rev, txn, iterpool));
+    }
+
+  /* Read all revisions with prefetching enabled.  To make sure we actually
+   * read from disk, use a new FS instance with disjoint caches. */
+  fs_config = apr_hash_make(pool);
+  svn_hash_sets(fs_config, SVN_FS_CONFIG_FSFS_CACHE_NS,
+                           svn_uuid_generate(pool));
+  SVN_ERR(svn_fs_open2(&fs, REPO_NAME, fs_config, pool, pool));
+
+  ffd = fs->fsap_data;
+  ffd->prefetch_threads = 4;
+
+  for (rev = MAX_REV; rev > 0; --rev)
+    {
+      svn_stringbuf_t *contents_read;
+
+      svn_pool_clear(iterpool);
+      SVN_ERR(svn_fs_revision_root(&root, fs, rev, iterpool));
+      SVN_ERR(svn_test__get_file_contents(root, "f", &contents_read,
+                                          iterpool));
+      SVN_TEST_ASSERT(svn_stringbuf_compare(contents_read, contents[rev]));
+
+#ifdef SVN_DEBUG
+      /* The first, uncached read must have prefetched the whole chain,
+       * which always has at least two reps. */
+      if (rev == MAX_REV)
+        SVN_TEST_ASSERT(ffd->prefetched_reps >= 2);
+#endif
+    }
+
+  svn_pool_destroy(iterpool);
+
+  return SVN_NO_ERROR;
+}
+
+#undef REPO_NAME
+#undef MAX_REV
+
 
 
 /* The test table.  */
@@ -1943,6 +2199,12 @@ static struct svn_test_descriptor_t test_funcs[] =
                        "pack with limited memory for metadata"),
     SVN_TEST_OPTS_PASS(large_delta_against_plain,
                        "large deltas against PLAIN, issue #4658"),
+    SVN_TEST_OPTS_PASS(large_delta_windows,
+                       "large delta windows in format 9 repositories"),
+    SVN_TEST_OPTS_PASS(pack_concurrently,
+                       "pack multiple shards concurrently"),
+    SVN_TEST_OPTS_PASS(prefetch_delta_chain,
+                       "read delta chains concurrently"),
     SVN_TEST_NULL
   };
 
@@ -26,6 +26,7 @@
 #include <apr_general.h>
 #include <apr_pools.h>
 #include <apr_file_io.h>
+#include <apr_network_io.h>
 #include <assert.h>
 
 #include "svn_error.h"
@@ -36,6 +37,8 @@
 #include "svn_cmdline.h"
 #include "svn_dirent_uri.h"
 #include "svn_hash.h"
+#include "svn_props.h"
+#include "svn_repos.h"
 
 #include "../svn_test.h"
 #include "../svn_test_fs.h"
@@ -179,6 +182,7 @@ typedef struct tunnel_baton_t
   int magic; /* TUNNEL_MAGIC */
   int open_count;
   svn_boolean_t last_check;
+  const char *stream_compression; /* svnserve --stream-compression or NULL */
 } tunnel_baton_t;
 
 #define TUNNEL_MAGIC 0xF00DF00F
@@ -205,6 +209,28 @@ check_tunnel(void *tunnel_baton, const char *tunnel_name)
   return b->last_check;
 }
 
+/* Set *SVNSERVE to the absolute path of the svnserve binary in our
+   build tree.  Allocate the result in POOL. */
+static svn_error_t *
+find_svnserve(const char **svnserve,
+              apr_pool_t *pool)
+{
+  svn_node_kind_t kind;
+
+  SVN_ERR(svn_dirent_get_absolute(svnserve, "../../svnserve/svnserve",
+                                  pool));
+#ifdef WIN32
+  *svnserve = apr_pstrcat(pool, *svnserve, ".exe", SVN_VA_NULL);
+#endif
+  SVN_ERR(svn_io_check_path(*svnserve, &kind, pool));
+  if (kind != svn_node_file)
+    return svn_error_createf(SVN_ERR_TEST_FAILED, NULL,
+                             "Could not find svnserve at %s",
+                             svn_dirent_local_style(*svnserve, pool));
+
+  return SVN_NO_ERROR;
+}
+
 static void
 close_tunnel(void *tunnel_context, void *tunnel_baton);
 
@@ -217,26 +243,21 @@ open_tunnel(svn_stream_t **request, svn_stream_t **response,
             svn_cancel_func_t cancel_func, void *cancel_baton,
             apr_pool_t *pool)
 {
-  svn_node_kind_t kind;
   apr_proc_t *proc;
   apr_procattr_t *attr;
   apr_status_t status;
-  const char *args[] = { "svnserve", "-t", "-r", ".", NULL };
+  const char *args[] = { "svnserve", "-t", "-r", ".", NULL, NULL };
   const char *svnserve;
   tunnel_baton_t *b = tunnel_baton;
   close_baton_t *cb;
 
   SVN_TEST_ASSERT(b->magic == TUNNEL_MAGIC);
 
-  SVN_ERR(svn_dirent_get_absolute(&svnserve, "../../svnserve/svnserve", pool));
-#ifdef WIN32
-  svnserve = apr_pstrcat(pool, svnserve, ".exe", SVN_VA_NULL);
-#endif
-  SVN_ERR(svn_io_check_path(svnserve, &kind, pool));
-  if (kind != svn_node_file)
-    return svn_error_createf(SVN_ERR_TEST_FAILED, NULL,
-                             "Could not find svnserve at %s",
-                             svn_dirent_local_style(svnserve, pool));
+  if (b->stream_compression)
+    args[4] = apr_pstrcat(pool, "--stream-compression=",
+                          b->stream_compression, SVN_VA_NULL);
+
+  SVN_ERR(find_svnserve(&svnserve, pool));
 
   status = apr_procattr_create(&attr, pool);
   if (status == APR_SUCCESS)
@@ -1820,6 +1841,402 @@ commit_locked_file(const svn_test_opts_t *opts, apr_pool_t *pool)
   return SVN_NO_ERROR;
 }
 
+/* Baton for get_files_receiver(). */
+typedef struct get_files_baton_t
+{
+  /* Contents received so far, one stringbuf per file. */
+  apr_array_header_t *contents;
+
+  /* Revisions and properties as reported for each file. */
+  apr_array_header_t *revs;
+  apr_array_header_t *props;
+
+  apr_pool_t *pool;
+} get_files_baton_t;
+
+/* Implements svn_ra_file_receiver_t. */
+static svn_error_t *
+get_files_receiver(svn_stream_t **stream,
+                   void *baton,
+                   const char *path,
+                   svn_revnum_t fetched_rev,
+                   apr_hash_t *props,
+                   apr_pool_t *scratch_pool)
+{
+  get_files_baton_t *b = baton;
+  svn_stringbuf_t *contents = svn_stringbuf_create_empty(b->pool);
+
+  APR_ARRAY_PUSH(b->contents, svn_stringbuf_t *) = contents;
+  APR_ARRAY_PUSH(b->revs, svn_revnum_t) = fetched_rev;
+  APR_ARRAY_PUSH(b->props, apr_hash_t *)
+    = props ? svn_prop_hash_dup(props, b->pool) : NULL;
+
+  *stream = svn_stream_from_stringbuf(contents, b->pool);
+
+  return SVN_NO_ERROR;
+}
+
+/* Add a new file PATH with CONTENTS to the HEAD of SESSION. */
+static svn_error_t *
+add_file_with_contents(svn_ra_session_t *session,
+                       const char *path,
+                       const char *contents,
+                       apr_pool_t *pool)
+{
+  const svn_delta_editor_t *editor;
+  void *edit_baton;
+  void *root_baton;
+  void *file_baton;
+  svn_txdelta_window_handler_t handler;
+  void *handler_baton;
+
+  SVN_ERR(svn_ra_get_commit_editor3(session, &editor, &edit_baton,
+                                    apr_hash_make(pool),
+                                    NULL, NULL, NULL, FALSE, pool));
+  SVN_ERR(editor->open_root(edit_baton, SVN_INVALID_REVNUM,
+                            pool, &root_baton));
+  SVN_ERR(editor->add_file(path, root_baton, NULL, SVN_INVALID_REVNUM,
+                           pool, &file_baton));
+  SVN_ERR(editor->change_file_prop(file_baton, "propname",
+                                   svn_string_create(path, pool), pool));
+  SVN_ERR(editor->apply_textdelta(file_baton, NULL, pool, &handler,
+                                  &handler_baton));
+  SVN_ERR(svn_txdelta_send_string(svn_string_create(contents, pool),
+                                  handler, handler_baton, pool));
+  SVN_ERR(editor->close_file(file_baton, NULL, pool));
+  SVN_ERR(editor->close_directory(root_baton, pool));
+  SVN_ERR(editor->close_edit(edit_baton, pool));
+
+  return SVN_NO_ERROR;
+}
+
+static svn_error_t *
+get_files_test(const svn_test_opts_t *opts,
+               apr_pool_t *pool)
+{
+  svn_ra_session_t *session;
+  apr_array_header_t *files = apr_array_make(pool, 3, sizeof(void *));
+  svn_ra_file_request_t request[3];
+  get_files_baton_t baton;
+  const svn_string_t *propval;
+
+  SVN_ERR(make_and_open_repos(&session, "test-get-files", opts, pool));
+  SVN_ERR(add_file_with_contents(session, "alpha", "alpha contents", pool));
+  SVN_ERR(add_file_with_contents(session, "beta", "beta contents", pool));
+
+  /* Request the same file twice, in different revisions. */
+  request[0].path = "beta";
+  request[0].revision = SVN_INVALID_REVNUM;
+  request[1].path = "alpha";
+  request[1].revision = 1;
+  request[2].path = "alpha";
+  request[2].revision = SVN_INVALID_REVNUM;
+  APR_ARRAY_PUSH(files, svn_ra_file_request_t *) = &request[0];
+  APR_ARRAY_PUSH(files, svn_ra_file_request_t *) = &request[1];
+  APR_ARRAY_PUSH(files, svn_ra_file_request_t *) = &request[2];
+
+  baton.contents = apr_array_make(pool, 3, sizeof(svn_stringbuf_t *));
+  baton.revs = apr_array_make(pool, 3, sizeof(svn_revnum_t));
+  baton.props = apr_array_make(pool, 3, sizeof(apr_hash_t *));
+  baton.pool = pool;
+
+  SVN_ERR(svn_ra_get_files(session, files, TRUE, get_files_receiver,
+                           &baton, pool));
+
+  SVN_TEST_INT_ASSERT(baton.contents->nelts, 3);
+  SVN_TEST_STRING_ASSERT(APR_ARRAY_IDX(baton.contents, 0,
+                                       svn_stringbuf_t *)->data,
+                         "beta contents");
+  SVN_TEST_STRING_ASSERT(APR_ARRAY_IDX(baton.contents, 1,
+                                       svn_stringbuf_t *)->data,
+                         "alpha contents");
+  SVN_TEST_STRING_ASSERT(APR_ARRAY_IDX(baton.contents, 2,
+                                       svn_stringbuf_t *)->data,
+                         "alpha contents");
+  SVN_TEST_INT_ASSERT(APR_ARRAY_IDX(baton.revs, 0, svn_revnum_t), 2);
+  SVN_TEST_INT_ASSERT(APR_ARRAY_IDX(baton.revs, 1, svn_revnum_t), 1);
+  SVN_TEST_INT_ASSERT(APR_ARRAY_IDX(baton.revs, 2, svn_revnum_t), 2);
+
+  propval = svn_hash_gets(APR_ARRAY_IDX(baton.props, 0, apr_hash_t *),
+                          "propname");
+  SVN_TEST_ASSERT(propval);
+  SVN_TEST_STRING_ASSERT(propval->data, "beta");
+
+  /* A missing file fails the whole request. */
+  request[1].revision = SVN_INVALID_REVNUM;
+  request[1].path = "gamma";
+  apr_array_clear(baton.contents);
+  apr_array_clear(baton.revs);
+  apr_array_clear(baton.props);
+  SVN_TEST_ASSERT_ANY_ERROR(svn_ra_get_files(session, files, FALSE,
+                                             get_files_receiver, &baton,
+                                             pool));
+
+  return SVN_NO_ERROR;
+}
+
+/* Commit and read back a file through svnserve with each of the
+   whole-stream compression methods. */
+static svn_error_t *
+tunnel_stream_compression_test(const svn_test_opts_t *opts,
+                               apr_pool_t *pool)
+{
+  static const char *const methods[] = { "lz4", "zlib", NULL };
+  tunnel_baton_t *b = apr_pcalloc(pool, sizeof(*b));
+  apr_pool_t *iterpool = svn_pool_create(pool);
+  const char tunnel_repos_name[] = "test-stream-compression";
+  svn_stringbuf_t *contents = svn_stringbuf_create_empty(pool);
+  const char *url;
+  svn_ra_callbacks2_t *cbtable;
+  int i;
+
+  b->magic = TUNNEL_MAGIC;
+
+  SVN_ERR(svn_test__create_repos(NULL, tunnel_repos_name, opts, iterpool));
+  svn_pool_clear(iterpool);
+
+  /* Large enough to span several compressed frames. */
+  for (i = 0; i < 20000; i++)
+    svn_stringbuf_appendcstr(contents,
+                             apr_psprintf(pool, "line %d\n", i % 1000));
+
+  url = apr_pstrcat(pool, "svn+test://localhost/", tunnel_repos_name,
+                    SVN_VA_NULL);
+  SVN_ERR(svn_ra_create_callbacks(&cbtable, pool));
+  cbtable->check_tunnel_func = check_tunnel;
+  cbtable->open_tunnel_func = open_tunnel;
+  cbtable->tunnel_baton = b;
+  SVN_ERR(svn_cmdline_create_auth_baton2(&cbtable->auth_baton,
+                                         TRUE  /* non_interactive */,
+                                         "jrandom", "rayjandom",
+                                         NULL,
+                                         TRUE  /* no_auth_cache */,
+                                         FALSE /* trust_server_cert */,
+                                         FALSE, FALSE, FALSE, FALSE,
+                                         NULL, NULL, NULL, pool));
+
+  for (i = 0; methods[i]; i++)
+    {
+      svn_ra_session_t *session;
+      svn_stringbuf_t *fetched;
+      const char *path;
+
+      svn_pool_clear(iterpool);
+      path = apr_pstrcat(iterpool, "file-", methods[i], SVN_VA_NULL);
+      b->stream_compression = methods[i];
+
+      SVN_ERR(svn_ra_open5(&session, NULL, NULL, url, NULL, cbtable,
+                           NULL, NULL, iterpool));
+      SVN_ERR(add_file_with_contents(session, path, contents->data,
+                                     iterpool));
+
+      fetched = svn_stringbuf_create_empty(iterpool);
+      SVN_ERR(svn_ra_get_file(session, path, SVN_INVALID_REVNUM,
+                              svn_stream_from_stringbuf(fetched, iterpool),
+                              NULL, NULL, iterpool));
+      SVN_TEST_ASSERT(svn_stringbuf_compare(fetched, contents));
+    }
+
+  svn_pool_destroy(iterpool);
+  SVN_TEST_ASSERT(b->open_count == 0);
+
+  return SVN_NO_ERROR;
+}
+
+/* File baton of the collecting editor below. */
+typedef struct collect_file_baton_t
+{
+  apr_hash_t *files;
+  const char *path;
+  svn_stringbuf_t *contents;
+} collect_file_baton_t;
+
+/* Editor callbacks that store the contents of all added files in the
+   apr_hash_t edit baton, mapping paths to svn_stringbuf_t *. */
+static svn_error_t *
+collect_open_root(void *edit_baton,
+                  svn_revnum_t base_revision,
+                  apr_pool_t *result_pool,
+                  void **root_baton)
+{
+  *root_baton = edit_baton;
+  return SVN_NO_ERROR;
+}
+
+static svn_error_t *
+collect_add_file(const char *path,
+                 void *parent_baton,
+                 const char *copyfrom_path,
+                 svn_revnum_t copyfrom_revision,
+                 apr_pool_t *result_pool,
+                 void **file_baton)
+{
+  collect_file_baton_t *fb = apr_pcalloc(result_pool, sizeof(*fb));
+  apr_pool_t *hash_pool = apr_hash_pool_get(parent_baton);
+
+  fb->files = parent_baton;
+  fb->path = apr_pstrdup(hash_pool, path);
+  fb->contents = svn_stringbuf_create_empty(hash_pool);
+  *file_baton = fb;
+
+  return SVN_NO_ERROR;
+}
+
+static svn_error_t *
+collect_apply_textdelta(void *file_baton,
+                        const char *base_checksum,
+                        apr_pool_t *result_pool,
+                        svn_txdelta_window_handler_t *handler,
+                        void **handler_baton)
+{
+  collect_file_baton_t *fb = file_baton;
+
+  svn_txdelta_apply(svn_stream_empty(result_pool),
+                    svn_stream_from_stringbuf(fb->contents, result_pool),
+                    NULL, fb->path, result_pool, handler, handler_baton);
+
+  return SVN_NO_ERROR;
+}
+
+static svn_error_t *
+collect_close_file(void *file_baton,
+                   const char *text_checksum,
+                   apr_pool_t *scratch_pool)
+{
+  collect_file_baton_t *fb = file_baton;
+
+  svn_hash_sets(fb->files, fb->path, fb->contents);
+  return SVN_NO_ERROR;
+}
+
+/* Create the repository TUNNEL_REPOS_NAME with a file for each of the
+   NULL-terminated PATHS, all of them large except for "small".  Check it
+   out over svn+test with svn-max-connections > 1, i.e. with the contents
+   of the large files being fetched over auxiliary connections, and
+   verify the result. */
+static svn_error_t *
+check_parallel_checkout(const svn_test_opts_t *opts,
+                        const char *tunnel_repos_name,
+                        const char *const *paths,
+                        apr_pool_t *pool)
+{
+  tunnel_baton_t *b = apr_pcalloc(pool, sizeof(*b));
+  apr_pool_t *subpool = svn_pool_create(pool);
+  apr_hash_t *config = apr_hash_make(pool);
+  apr_hash_t *files = apr_hash_make(pool);
+  svn_stringbuf_t *big = svn_stringbuf_create_empty(pool);
+  svn_config_t *servers;
+  svn_delta_editor_t *editor;
+  const svn_ra_reporter3_t *reporter;
+  void *report_baton;
+  svn_ra_session_t *session;
+  const char *url;
+  svn_ra_callbacks2_t *cbtable;
+  int i;
+
+  b->magic = TUNNEL_MAGIC;
+
+  SVN_ERR(svn_test__create_repos(NULL, tunnel_repos_name, opts, subpool));
+  svn_pool_clear(subpool);
+
+  /* Well above the size at which the client asks for deferral. */
+  for (i = 0; i < 60000; i++)
+    svn_stringbuf_appendcstr(big, apr_psprintf(pool, "line %d\n", i));
+
+  url = apr_pstrcat(pool, "svn+test://localhost/", tunnel_repos_name,
+                    SVN_VA_NULL);
+  SVN_ERR(svn_ra_create_callbacks(&cbtable, pool));
+  cbtable->check_tunnel_func = check_tunnel;
+  cbtable->open_tunnel_func = open_tunnel;
+  cbtable->tunnel_baton = b;
+  SVN_ERR(svn_cmdline_create_auth_baton2(&cbtable->auth_baton,
+                                         TRUE  /* non_interactive */,
+                                         "jrandom", "rayjandom",
+                                         NULL,
+                                         TRUE  /* no_auth_cache */,
+                                         FALSE /* trust_server_cert */,
+                                         FALSE, FALSE, FALSE, FALSE,
+                                         NULL, NULL, NULL, pool));
+
+  SVN_ERR(svn_config_create2(&servers, FALSE, FALSE, pool));
+  svn_config_set(servers, SVN_CONFIG_SECTION_GLOBAL,
+                 SVN_CONFIG_OPTION_SVN_MAX_CONNECTIONS, "3");
+  svn_hash_sets(config, SVN_CONFIG_CATEGORY_SERVERS, servers);
+
+  SVN_ERR(svn_ra_open5(&session, NULL, NULL, url, NULL, cbtable,
+                       NULL, config, subpool));
+  for (i = 0; paths[i]; i++)
+    SVN_ERR(add_file_with_contents(session, paths[i],
+                                   strcmp(paths[i], "small") ? big->data
+                                                             : "small\n",
+                                   subpool));
+
+  editor = svn_delta_default_editor(pool);
+  editor->open_root = collect_open_root;
+  editor->add_file = collect_add_file;
+  editor->apply_textdelta = collect_apply_textdelta;
+  editor->close_file = collect_close_file;
+
+  SVN_ERR(svn_ra_do_update3(session, &reporter, &report_baton,
+                            SVN_INVALID_REVNUM, "", svn_depth_infinity,
+                            FALSE, FALSE, editor, files, subpool, subpool));
+  SVN_ERR(reporter->set_path(report_baton, "", 0, svn_depth_infinity, TRUE,
+                             NULL, subpool));
+  SVN_ERR(reporter->finish_report(report_baton, subpool));
+
+  /* The main connection and two auxiliary ones. */
+  SVN_TEST_INT_ASSERT(b->open_count, 3);
+
+  for (i = 0; paths[i]; i++)
+    {
+      svn_stringbuf_t *contents = svn_hash_gets(files, paths[i]);
+
+      SVN_TEST_ASSERT(contents);
+      if (strcmp(paths[i], "small"))
+        SVN_TEST_ASSERT(svn_stringbuf_compare(contents, big));
+      else
+        SVN_TEST_STRING_ASSERT(contents->data, "small\n");
+    }
+  SVN_TEST_INT_ASSERT(apr_hash_count(files), i);
+
+  svn_pool_destroy(subpool);
+  SVN_TEST_ASSERT(b->open_count == 0);
+
+  return SVN_NO_ERROR;
+}
+
+/* Check out a repository with several large files over several
+   connections. */
+static svn_error_t *
+tunnel_parallel_checkout_test(const svn_test_opts_t *opts,
+                              apr_pool_t *pool)
+{
+  static const char *const paths[] = { "big1", "small", "big2", "big3",
+                                       NULL };
+
+  return svn_error_trace(check_parallel_checkout(opts,
+                                                 "test-parallel-checkout",
+                                                 paths, pool));
+}
+
+/* Like tunnel_parallel_checkout_test but with more large files than the
+   client buffers at once, so that fetching has to wait for the editor to
+   consume the contents. */
+static svn_error_t *
+tunnel_parallel_checkout_many_test(const svn_test_opts_t *opts,
+                                   apr_pool_t *pool)
+{
+  const char **paths = apr_pcalloc(pool, 81 * sizeof(*paths));
+  int i;
+
+  for (i = 0; i < 80; i++)
+    paths[i] = apr_psprintf(pool, "big%d", i);
+
+  return svn_error_trace(check_parallel_checkout(opts,
+                                                 "test-parallel-checkout-many",
+                                                 paths, pool));
+}
+
 /* Cases of 'get-deleted-rev' that should return SVN_INVALID_REVNUM. */
 static svn_error_t *
 test_get_deleted_rev_no_delete(const svn_test_opts_t *opts,
@@ -1877,6 +2294,181 @@ test_get_deleted_rev_errors(const svn_test_opts_t *opts,
   return SVN_NO_ERROR;
 }
 
+/* Number of concurrent sessions in event_loop_svnserve_test(). */
+#define EVENT_LOOP_SESSIONS 6
+
+/* Set *PORT to a TCP port on the loopback interface that is currently
+   not in use.  Use POOL for temporary allocations. */
+static svn_error_t *
+find_free_port(apr_port_t *port,
+               apr_pool_t *pool)
+{
+  apr_sockaddr_t *sa;
+  apr_socket_t *sock;
+  apr_status_t status;
+
+  status = apr_sockaddr_info_get(&sa, "127.0.0.1", APR_INET, 0, 0, pool);
+  if (status == APR_SUCCESS)
+    status = apr_socket_create(&sock, APR_INET, SOCK_STREAM, APR_PROTO_TCP,
+                               pool);
+  if (status == APR_SUCCESS)
+    status = apr_socket_bind(sock, sa);
+  if (status == APR_SUCCESS)
+    status = apr_socket_addr_get(&sa, APR_LOCAL, sock);
+  if (status != APR_SUCCESS)
+    return svn_error_wrap_apr(status, "Could not find a free port");
+
+  *port = sa->port;
+  apr_socket_close(sock);
+
+  return SVN_NO_ERROR;
+}
+
+/* Run svnserve in event mode with fewer worker threads than there are
+   concurrently open sessions and use all of these sessions in turn.
+   In threaded mode, this would block because idle sessions occupy their
+   threads. */
+static svn_error_t *
+event_loop_svnserve_test(const svn_test_opts_t *opts,
+                         apr_pool_t *pool)
+{
+  const char repos_name[] = "test-repo-event-loop";
+  const char *args[] = { "svnserve", "-d", "--foreground", "--event-loop",
+                         "--min-threads", "1", "--max-threads", "2",
+                         "-r", ".", "--listen-host", "127.0.0.1",
+                         "--listen-port", NULL, NULL };
+  apr_pool_t *scratch_pool = svn_pool_create(pool);
+  apr_pool_t *session_pool = svn_pool_create(pool);
+  svn_ra_session_t *sessions[EVENT_LOOP_SESSIONS];
+  svn_ra_callbacks2_t *cbtable;
+  svn_repos_t *repos;
+  const char *conf_path;
+  const char *stderr_path;
+  const char *svnserve;
+  const char *url;
+  apr_file_t *stderr_file;
+  apr_procattr_t *attr;
+  apr_proc_t *proc;
+  apr_status_t status;
+  apr_port_t port;
+  int i, pass;
+
+  /* Allow anonymous commits. */
+  SVN_ERR(svn_test__create_repos(&repos, repos_name, opts, scratch_pool));
+  conf_path = svn_dirent_join(svn_repos_conf_dir(repos, scratch_pool),
+                              "svnserve.conf", scratch_pool);
+  SVN_ERR(svn_io_remove_file2(conf_path, TRUE, scratch_pool));
+  SVN_ERR(svn_io_file_create(conf_path, "[general]\nanon-access = write\n",
+                             scratch_pool));
+
+  /* Immediately close the repository to avoid race condition with svnserve
+     (and then the cleanup code) with BDB when our pool is cleared. */
+  svn_pool_clear(scratch_pool);
+
+  SVN_ERR(find_svnserve(&svnserve, pool));
+  SVN_ERR(find_free_port(&port, pool));
+  args[13] = apr_itoa(pool, port);
+  url = apr_psprintf(pool, "svn://127.0.0.1:%d/%s", port, repos_name);
+
+  /* Keep svnserve's error output, so we can tell why it exited. */
+  stderr_path = svn_dirent_join(repos_name, "svnserve.stderr", pool);
+  SVN_ERR(svn_io_file_open(&stderr_file, stderr_path,
+                           APR_WRITE | APR_CREATE | APR_TRUNCATE,
+                           APR_OS_DEFAULT, pool));
+
+  status = apr_procattr_create(&attr, pool);
+  if (status == APR_SUCCESS)
+    status = apr_procattr_io_set(attr, APR_NO_PIPE, APR_NO_PIPE,
+                                 APR_NO_PIPE);
+  if (status == APR_SUCCESS)
+    status = apr_procattr_child_err_set(attr, stderr_file, NULL);
+  if (status == APR_SUCCESS)
+    status = apr_procattr_cmdtype_set(attr, APR_PROGRAM);
+  proc = apr_palloc(pool, sizeof(*proc));
+  if (status == APR_SUCCESS)
+    status = apr_proc_create(proc,
+                             svn_dirent_local_style(svnserve, pool),
+                             args, NULL, attr, pool);
+  if (status != APR_SUCCESS)
+    return svn_error_wrap_apr(status, "Could not run svnserve");
+  apr_pool_note_subprocess(pool, proc, APR_KILL_ALWAYS);
+
+  SVN_ERR(svn_ra_create_callbacks(&cbtable, pool));
+  SVN_ERR(svn_test__init_auth_baton(&cbtable->auth_baton, pool));
+  SVN_ERR(svn_ra_initialize(pool));
+
+  /* Wait up to 10 seconds for svnserve to accept connections. */
+  for (i = 0; ; ++i)
+    {
+      int exit_code;
+      apr_exit_why_e exit_why;
+      svn_error_t *err;
+
+      if (apr_proc_wait(proc, &exit_code, &exit_why, APR_NOWAIT)
+          == APR_CHILD_DONE)
+        {
+          svn_stringbuf_t *output;
+
+          /* Builds without thread support don't know the option.  Any
+             other reason to exit is a failure. */
+          SVN_ERR(svn_stringbuf_from_file2(&output, stderr_path, pool));
+          if (   APR_PROC_CHECK_EXIT(exit_why) && exit_code == EXIT_FAILURE
+              && strstr(output->data, "invalid option")
+              && strstr(output->data, "--event-loop"))
+            return svn_error_create(SVN_ERR_TEST_SKIPPED, NULL,
+                                    "svnserve --event-loop is not "
+                                    "supported");
+
+          return svn_error_createf(SVN_ERR_TEST_FAILED, NULL,
+                                   "svnserve exited unexpectedly "
+                                   "(exit code %d):\n%s",
+                                   exit_code, output->data);
+        }
+
+      err = svn_ra_open5(&sessions[0], NULL, NULL, url, NULL, cbtable,
+                         NULL, NULL, session_pool);
+      if (!err)
+        break;
+      if (i == 100)
+        return svn_error_trace(err);
+
+      svn_error_clear(err);
+      apr_sleep(apr_time_from_msec(100));
+    }
+
+  for (i = 1; i < EVENT_LOOP_SESSIONS; ++i)
+    SVN_ERR(svn_ra_open5(&sessions[i], NULL, NULL, url, NULL, cbtable,
+                         NULL, NULL, session_pool));
+
+  SVN_ERR(commit_tree(sessions[0], pool));
+
+  /* All sessions are open and idle now.  Use them round-robin. */
+  for (pass = 0; pass < 3; ++pass)
+    for (i = 0; i < EVENT_LOOP_SESSIONS; ++i)
+      {
+        svn_revnum_t youngest;
+        svn_node_kind_t kind;
+
+        svn_pool_clear(scratch_pool);
+        SVN_ERR(svn_ra_get_latest_revnum(sessions[i], &youngest,
+                                         scratch_pool));
+        SVN_TEST_INT_ASSERT(youngest, 1);
+
+        SVN_ERR(svn_ra_check_path(sessions[i], "A/B/f", 1, &kind,
+                                  scratch_pool));
+        SVN_TEST_ASSERT(kind == svn_node_file);
+      }
+
+  /* Closed connections must not disturb the server. */
+  svn_pool_clear(session_pool);
+  SVN_ERR(svn_ra_open5(&sessions[0], NULL, NULL, url, NULL, cbtable,
+                       NULL, NULL, session_pool));
+  SVN_ERR(commit_two_changes(sessions[0], pool));
+  svn_pool_destroy(session_pool);
+
+  return SVN_NO_ERROR;
+}
+
 
 /* The test table.  */
 
@@ -1917,6 +2509,16 @@ static struct svn_test_descriptor_t test_funcs[] =
                        "test get-deleted-rev no delete"),
     SVN_TEST_OPTS_PASS(test_get_deleted_rev_errors,
                        "test get-deleted-rev errors"),
+    SVN_TEST_OPTS_PASS(get_files_test,
+                       "test svn_ra_get_files"),
+    SVN_TEST_OPTS_PASS(tunnel_stream_compression_test,
+                       "test ra_svn whole-stream compression"),
+    SVN_TEST_OPTS_PASS(tunnel_parallel_checkout_test,
+                       "test ra_svn checkout over several connections"),
+    SVN_TEST_OPTS_PASS(tunnel_parallel_checkout_many_test,
+                       "test ra_svn checkout of many files in parallel"),
+    SVN_TEST_OPTS_PASS(event_loop_svnserve_test,
+                       "test svnserve --event-loop"),
     SVN_TEST_NULL
   };
 
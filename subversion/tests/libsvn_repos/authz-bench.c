@@ -0,0 +1,387 @@
+/* authz-bench.c -- measure the throughput of authz path lookups
+ *
+ * ====================================================================
+ *    Licensed to the Apache Software Foundation (ASF) under one
+ *    or more contributor license agreements.  See the NOTICE file
+ *    distributed with this work for additional information
+ *    regarding copyright ownership.  The ASF licenses this file
+ *    to you under the Apache License, Version 2.0 (the
+ *    "License"); you may not use this file except in compliance
+ *    with the License.  You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *    Unless required by applicable law or agreed to in writing,
+ *    software distributed under the License is distributed on an
+ *    "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+ *    KIND, either express or implied.  See the License for the
+ *    specific language governing permissions and limitations
+ *    under the License.
+ * ====================================================================
+ */
+
+/* This is not a unit test.  It parses an authz file, either the one
+ * given on the command line or a generated one of about 40000 lines,
+ * and reports how many svn_repos_authz_check_access() calls per second
+ * it can answer for a few users.  It does so once for paths that are
+ * all different, as during a checkout, and once each for a small and a
+ * large set of paths that get checked over and over again, as during
+ * "log -v".
+ * The queried paths are derived from the section headers of the authz
+ * file and all data is generated from a fixed seed, so the numbers are
+ * comparable between runs.
+ */
+
+#define APR_WANT_STDIO
+#include <apr_want.h>
+
+#include <apr_general.h>
+#include <apr_time.h>
+
+#include "svn_ctype.h"
+#include "svn_error.h"
+#include "svn_io.h"
+#include "svn_pools.h"
+#include "svn_repos.h"
+#include "svn_string.h"
+
+#include "private/svn_repos_private.h"
+
+/* Number of projects, i.e. path sections, in the generated authz file. */
+#define GENERATED_PROJECTS 8000
+
+/* Number of groups and users in the generated authz file. */
+#define GENERATED_GROUPS 500
+#define GENERATED_USERS 1000
+
+/* Number of paths in the working sets that we check repeatedly. */
+#define WORKING_SET_SIZE 256
+#define LARGE_WORKING_SET_SIZE 3000
+
+/* Number of times we run each measurement.  We report the best run to
+ * filter out noise. */
+#define DEFAULT_REPEAT 3
+
+/* Name of the repository that we ask for. */
+#define REPOS_NAME "repo"
+
+/* Simple linear congruential pseudo-random number generator.
+ * Update *SEED and return the next pseudo-random number. */
+static apr_uint32_t
+next_rand(apr_uint32_t *seed)
+{
+  *seed = *seed * 1103515245 + 12345;
+  return *seed >> 8;
+}
+
+/* Return the contents of an authz file of about 40000 lines with a
+ * [groups] section and one section per project granting access to some
+ * groups and users.  Allocate the result in POOL. */
+static svn_stringbuf_t *
+make_authz(apr_pool_t *pool)
+{
+  svn_stringbuf_t *result = svn_stringbuf_create_ensure(0x100000, pool);
+  apr_uint32_t seed = 0x5eed;
+  int i, k;
+
+  svn_stringbuf_appendcstr(result, "[groups]\n");
+  for (i = 0; i < GENERATED_GROUPS; ++i)
+    {
+      svn_stringbuf_appendcstr(result, apr_psprintf(pool, "g%d = ", i));
+      for (k = 0; k < 10; ++k)
+        svn_stringbuf_appendcstr(result,
+              apr_psprintf(pool, "%suser%d", k ? ", " : "",
+                           (int)(next_rand(&seed) % GENERATED_USERS)));
+      svn_stringbuf_appendbyte(result, '\n');
+    }
+
+  svn_stringbuf_appendcstr(result, "\n[/]\n* = r\n\n");
+  for (i = 0; i < GENERATED_PROJECTS; ++i)
+    {
+      svn_stringbuf_appendcstr(result,
+            apr_psprintf(pool,
+                         "[/projects/p%d/trunk]\n"
+                         "* =\n"
+                         "@g%d = rw\n"
+                         "user%d = r\n"
+                         "\n",
+                         i,
+                         (int)(next_rand(&seed) % GENERATED_GROUPS),
+                         (int)(next_rand(&seed) % GENERATED_USERS)));
+    }
+
+  return result;
+}
+
+/* Return the paths of all non-glob sections in the authz file CONTENTS
+ * as an array of const char *.  Allocate the result in POOL. */
+static apr_array_header_t *
+get_section_paths(const svn_stringbuf_t *contents,
+                  apr_pool_t *pool)
+{
+  apr_array_header_t *result = apr_array_make(pool, 1024,
+                                              sizeof(const char *));
+  const char *line = contents->data;
+
+  while (*line)
+    {
+      const char *eol = strchr(line, '\n');
+      if (eol == NULL)
+        eol = line + strlen(line);
+
+      if (line[0] == '[')
+        {
+          const char *start = strchr(line, '/');
+          const char *end = memchr(line, ']', eol - line);
+
+          if (start && end && start < end && line[1] != ':')
+            APR_ARRAY_PUSH(result, const char *)
+              = apr_pstrmemdup(pool, start, end - start);
+        }
+
+      line = *eol ? eol + 1 : eol;
+    }
+
+  return result;
+}
+
+/* Return an array of COUNT paths (const char *) below the SECTIONS paths,
+ * picked at random.  Use and update the random number generator state in
+ * *SEED.  Allocate the result in POOL. */
+static apr_array_header_t *
+make_paths(const apr_array_header_t *sections,
+           int count,
+           apr_uint32_t *seed,
+           apr_pool_t *pool)
+{
+  apr_array_header_t *result = apr_array_make(pool, count,
+                                              sizeof(const char *));
+  int i;
+
+  for (i = 0; i < count; ++i)
+    {
+      const char *section
+        = APR_ARRAY_IDX(sections, next_rand(seed) % sections->nelts,
+                        const char *);
+      const char *path;
+
+      switch (next_rand(seed) % 3)
+        {
+          case 0:
+            path = section;
+            break;
+
+          case 1:
+            path = apr_psprintf(pool, "%s/dir%d", section,
+                                (int)(next_rand(seed) % 16));
+            break;
+
+          default:
+            path = apr_psprintf(pool, "%s/dir%d/file%d.c", section,
+                                (int)(next_rand(seed) % 16),
+                                (int)(next_rand(seed) % 64));
+            break;
+        }
+
+      /* The root section is "/", which would give us "//dir". */
+      if (path[0] == '/' && path[1] == '/')
+        ++path;
+
+      APR_ARRAY_PUSH(result, const char *) = path;
+    }
+
+  return result;
+}
+
+/* Check read access for USER to all PATHS in AUTHZ, ROUNDS times.  Start
+ * with a copy of AUTHZ that has not been used for lookups, yet.  Return
+ * the time it took in *DURATION.  Use POOL for temporary allocations. */
+static svn_error_t *
+run_checks(apr_interval_time_t *duration,
+           const svn_authz_t *authz,
+           const char *user,
+           const apr_array_header_t *paths,
+           int rounds,
+           apr_pool_t *pool)
+{
+  apr_pool_t *iterpool = svn_pool_create(pool);
+  svn_authz_t *copy;
+  apr_time_t start;
+  int i, k;
+
+  svn_repos__authz_share(&copy, authz, pool);
+
+  start = apr_time_now();
+  for (k = 0; k < rounds; ++k)
+    for (i = 0; i < paths->nelts; ++i)
+      {
+        svn_boolean_t access_granted;
+
+        svn_pool_clear(iterpool);
+        SVN_ERR(svn_repos_authz_check_access(copy, REPOS_NAME,
+                                             APR_ARRAY_IDX(paths, i,
+                                                           const char *),
+                                             user, svn_authz_read,
+                                             &access_granted, iterpool));
+      }
+
+  *duration = apr_time_now() - start;
+  svn_pool_destroy(iterpool);
+
+  return SVN_NO_ERROR;
+}
+
+/* Run the check for USER on PATHS, ROUNDS times over, REPEAT times and
+ * print the best result labeled with LABEL to stdout.  Use POOL for
+ * temporary allocations. */
+static svn_error_t *
+bench_checks(const svn_authz_t *authz,
+             const char *user,
+             const char *label,
+             const apr_array_header_t *paths,
+             int rounds,
+             int repeat,
+             apr_pool_t *pool)
+{
+  apr_pool_t *iterpool = svn_pool_create(pool);
+  apr_interval_time_t best = 0;
+  double checks = (double)paths->nelts * rounds;
+  int i;
+
+  for (i = 0; i < repeat; ++i)
+    {
+      apr_interval_time_t duration;
+
+      svn_pool_clear(iterpool);
+      SVN_ERR(run_checks(&duration, authz, user, paths, rounds, iterpool));
+      if (i == 0 || duration < best)
+        best = duration;
+    }
+
+  /* Avoid division by zero for tiny inputs. */
+  if (best == 0)
+    best = 1;
+
+  printf("%-12s %-10s %9.0f checks %12.0f checks/s\n",
+         user, label, checks, checks / (double)best * APR_USEC_PER_SEC);
+
+  svn_pool_destroy(iterpool);
+
+  return SVN_NO_ERROR;
+}
+
+/* Parse the authz file AUTHZ_FILE, or a generated one if that is NULL,
+ * and measure the lookup throughput for each of the USERS (const char *).
+ * Run each measurement REPEAT times.  Print the results to stdout.  Use
+ * POOL for temporary allocations. */
+static svn_error_t *
+bench_authz(const char *authz_file,
+            const apr_array_header_t *users,
+            int repeat,
+            apr_pool_t *pool)
+{
+  svn_stringbuf_t *contents;
+  apr_array_header_t *sections;
+  apr_array_header_t *distinct_paths;
+  apr_array_header_t *working_set;
+  apr_array_header_t *large_working_set;
+  svn_authz_t *authz;
+  apr_uint32_t seed = 0x5eed;
+  apr_time_t start;
+  int i;
+
+  if (authz_file)
+    SVN_ERR(svn_stringbuf_from_file2(&contents, authz_file, pool));
+  else
+    contents = make_authz(pool);
+
+  sections = get_section_paths(contents, pool);
+  if (sections->nelts == 0)
+    return svn_error_create(SVN_ERR_AUTHZ_INVALID_CONFIG, NULL,
+                            "No path sections in the authz file");
+
+  start = apr_time_now();
+  SVN_ERR(svn_repos_authz_parse2(&authz,
+                                 svn_stream_from_stringbuf(contents, pool),
+                                 NULL, NULL, NULL, pool, pool));
+  printf("parsed %d sections, %" APR_SIZE_T_FMT " bytes in %.3f s\n\n",
+         sections->nelts, contents->len,
+         (double)(apr_time_now() - start) / APR_USEC_PER_SEC);
+
+  distinct_paths = make_paths(sections, 100000, &seed, pool);
+  working_set = make_paths(sections, WORKING_SET_SIZE, &seed, pool);
+  large_working_set = make_paths(sections, LARGE_WORKING_SET_SIZE, &seed,
+                                 pool);
+
+  for (i = 0; i < users->nelts; ++i)
+    {
+      const char *user = APR_ARRAY_IDX(users, i, const char *);
+
+      SVN_ERR(bench_checks(authz, user, "distinct", distinct_paths, 1,
+                           repeat, pool));
+      SVN_ERR(bench_checks(authz, user, "repeated", working_set,
+                           distinct_paths->nelts / WORKING_SET_SIZE,
+                           repeat, pool));
+      SVN_ERR(bench_checks(authz, user, "large set", large_working_set,
+                           distinct_paths->nelts / LARGE_WORKING_SET_SIZE,
+                           repeat, pool));
+    }
+
+  return SVN_NO_ERROR;
+}
+
+int
+main(int argc, char **argv)
+{
+  apr_pool_t *pool;
+  apr_array_header_t *users;
+  const char *authz_file = NULL;
+  int repeat = DEFAULT_REPEAT;
+  svn_error_t *err;
+
+  while (argc > 1)
+    {
+      const char *const arg = argv[1];
+      if (arg[0] != '-')
+        break;
+
+      if (svn_ctype_isdigit(arg[1]))
+        repeat = atoi(arg + 1);
+      else
+        break;
+      --argc; ++argv;
+    }
+
+  if ((argc > 1 && argv[1][0] == '-') || repeat <= 0)
+    {
+      fprintf(stderr,
+              "Usage: authz-bench [-<repeat>] [AUTHZ-FILE [USER...]]\n");
+      exit(1);
+    }
+
+  apr_initialize();
+  pool = svn_pool_create(NULL);
+
+  users = apr_array_make(pool, 4, sizeof(const char *));
+  if (argc > 1)
+    {
+      authz_file = argv[1];
+      for (argc -= 2, argv += 2; argc > 0; --argc, ++argv)
+        APR_ARRAY_PUSH(users, const char *) = argv[0];
+    }
+
+  if (users->nelts == 0)
+    {
+      APR_ARRAY_PUSH(users, const char *) = "user1";
+      APR_ARRAY_PUSH(users, const char *) = "user500";
+      APR_ARRAY_PUSH(users, const char *) = "nobody";
+    }
+
+  err = bench_authz(authz_file, users, repeat, pool);
+  if (err)
+    svn_handle_error2(err, stderr, TRUE, "authz-bench: ");
+
+  svn_pool_destroy(pool);
+  apr_terminate();
+  exit(0);
+}
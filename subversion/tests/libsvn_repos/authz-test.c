@@ -26,6 +26,7 @@
 #include "svn_iter.h"
 #include "svn_hash.h"
 #include "private/svn_subr_private.h"
+#include "private/svn_repos_private.h"
 
 #include "../../libsvn_repos/authz.h"
 
@@ -511,6 +512,277 @@ reposful_reposless_stanzas_inherit(apr_pool_t *pool)
    return SVN_NO_ERROR;
 }
 
+static svn_error_t *
+test_authz_share(apr_pool_t *pool)
+{
+  const char rules[] =
+    "[/]"                 NL
+    "* = r"               NL
+    ""                    NL
+    "[/secret]"           NL
+    "userA = rw"          NL
+    "* ="                 NL
+    ;
+
+  svn_stringbuf_t *buf = svn_stringbuf_create(rules, pool);
+  svn_stream_t *stream = svn_stream_from_stringbuf(buf, pool);
+  svn_authz_t *authz, *copy1, *copy2;
+  svn_boolean_t access_granted;
+
+  SVN_ERR(svn_repos_authz_parse2(&authz, stream, NULL, NULL, NULL, pool,
+                                 pool));
+  svn_repos__authz_share(&copy1, authz, pool);
+  svn_repos__authz_share(&copy2, authz, pool);
+
+  /* Interleave users such that each copy keeps its own filtered tree. */
+  SVN_ERR(svn_repos_authz_check_access(copy1, "repo", "/secret/f", "userA",
+                                       svn_authz_write, &access_granted,
+                                       pool));
+  SVN_TEST_ASSERT(access_granted == TRUE);
+
+  SVN_ERR(svn_repos_authz_check_access(copy2, "repo", "/secret/f", "userB",
+                                       svn_authz_read, &access_granted,
+                                       pool));
+  SVN_TEST_ASSERT(access_granted == FALSE);
+
+  SVN_ERR(svn_repos_authz_check_access(copy1, "repo", "/secret", "userA",
+                                       svn_authz_read, &access_granted,
+                                       pool));
+  SVN_TEST_ASSERT(access_granted == TRUE);
+
+  SVN_ERR(svn_repos_authz_check_access(copy2, "repo", "/public", "userB",
+                                       svn_authz_read, &access_granted,
+                                       pool));
+  SVN_TEST_ASSERT(access_granted == TRUE);
+
+  /* The original is not affected by its copies. */
+  SVN_ERR(svn_repos_authz_check_access(authz, "repo", "/secret", "userB",
+                                       svn_authz_read, &access_granted,
+                                       pool));
+  SVN_TEST_ASSERT(access_granted == FALSE);
+
+  return SVN_NO_ERROR;
+}
+
+static svn_error_t *
+test_authz_lookup_cache(apr_pool_t *pool)
+{
+  const char rules[] =
+    "[/]"                 NL
+    "* = r"               NL
+    ""                    NL
+    "[/trunk]"            NL
+    "userA = rw"          NL
+    ""                    NL
+    "[/trunk/secret]"     NL
+    "* ="                 NL
+    "userA = r"           NL
+    ""                    NL
+    "[:glob:/**/*.key]"   NL
+    "* ="                 NL
+    ;
+
+  const char *paths[] =
+    {
+      "/", "/trunk", "/trunk/secret", "/trunk/secret/a",
+      "/trunk/src/main.c", "/trunk/src/x.key", "/tags/1.0/x.key",
+      "/branches", "/trunk/secret/a/b/c"
+    };
+  const svn_repos_authz_access_t required[] =
+    {
+      svn_authz_read,
+      svn_authz_write,
+      svn_authz_read | svn_authz_write,
+      svn_authz_read | svn_authz_recursive,
+      svn_authz_write | svn_authz_recursive
+    };
+  const char *users[] = { "userA", "userB" };
+  const int path_count = sizeof(paths) / sizeof(paths[0]);
+  const int required_count = sizeof(required) / sizeof(required[0]);
+  const int user_count = sizeof(users) / sizeof(users[0]);
+
+  svn_stringbuf_t *buf = svn_stringbuf_create(rules, pool);
+  svn_stream_t *stream = svn_stream_from_stringbuf(buf, pool);
+  apr_pool_t *iterpool = svn_pool_create(pool);
+  svn_authz_t *authz;
+  int pass, u, i, k;
+
+  SVN_ERR(svn_repos_authz_parse2(&authz, stream, NULL, NULL, NULL, pool,
+                                 pool));
+
+  /* Ask the same questions repeatedly and in varying order.  Compare the
+   * results with those of a pristine copy without any cached results.
+   * The filler paths evict entries from the lookup cache. */
+  for (pass = 0; pass < 3; ++pass)
+    for (u = 0; u < user_count; ++u)
+      for (i = 0; i < path_count; ++i)
+        for (k = 0; k < required_count; ++k)
+          {
+            const char *path = paths[(i + pass) % path_count];
+            const char *filler;
+            svn_authz_t *fresh;
+            svn_boolean_t cached_result, fresh_result, ignored;
+
+            svn_pool_clear(iterpool);
+            filler = apr_psprintf(iterpool, "/trunk/f%d", pass * 1000 + i);
+
+            SVN_ERR(svn_repos_authz_check_access(authz, "repo", path,
+                                                 users[u], required[k],
+                                                 &cached_result, iterpool));
+            SVN_ERR(svn_repos_authz_check_access(authz, "repo", filler,
+                                                 users[u], required[k],
+                                                 &ignored, iterpool));
+
+            svn_repos__authz_share(&fresh, authz, iterpool);
+            SVN_ERR(svn_repos_authz_check_access(fresh, "repo", path,
+                                                 users[u], required[k],
+                                                 &fresh_result, iterpool));
+            SVN_TEST_ASSERT(cached_result == fresh_result);
+          }
+
+  svn_pool_destroy(iterpool);
+
+  return SVN_NO_ERROR;
+}
+
+static svn_error_t *
+test_authz_lookup_cache_eviction(apr_pool_t *pool)
+{
+  const char rules[] =
+    "[/]"                 NL
+    "* = r"               NL
+    ""                    NL
+    "[/trunk/secret]"     NL
+    "* ="                 NL
+    ;
+
+  /* More paths than fit into the lookup cache. */
+  const int path_count = 10000;
+
+  svn_stringbuf_t *buf = svn_stringbuf_create(rules, pool);
+  svn_stream_t *stream = svn_stream_from_stringbuf(buf, pool);
+  apr_pool_t *iterpool = svn_pool_create(pool);
+  svn_authz_t *authz;
+  int pass, i;
+
+  SVN_ERR(svn_repos_authz_parse2(&authz, stream, NULL, NULL, NULL, pool,
+                                 pool));
+
+  /* Walk the paths forward and then backward, so that the second pass
+   * starts with cached results and then runs into evicted ones.  Every
+   * third path is not readable. */
+  for (pass = 0; pass < 2; ++pass)
+    for (i = 0; i < path_count; ++i)
+      {
+        int k = pass ? path_count - 1 - i : i;
+        svn_boolean_t expected = (k % 3 != 0);
+        svn_boolean_t access_granted;
+        const char *path;
+
+        svn_pool_clear(iterpool);
+        path = apr_psprintf(iterpool, "%s/f%d",
+                            expected ? "/trunk" : "/trunk/secret", k);
+
+        SVN_ERR(svn_repos_authz_check_access(authz, "repo", path, "user",
+                                             svn_authz_read,
+                                             &access_granted, iterpool));
+        SVN_TEST_ASSERT(access_granted == expected);
+      }
+
+  svn_pool_destroy(iterpool);
+
+  return SVN_NO_ERROR;
+}
+
+static svn_error_t *
+test_authz_check_paths(apr_pool_t *pool)
+{
+  const char rules[] =
+    "[/]"                   NL
+    "* = r"                 NL
+    ""                      NL
+    "[/vendor]"             NL
+    "* ="                   NL
+    "userA = r"             NL
+    ""                      NL
+    "[/vendor/libfoo/priv]" NL
+    "userA ="               NL
+    ""                      NL
+    "[/trunk/secret]"       NL
+    "* ="                   NL
+    ""                      NL
+    "[:glob:/**/*.key]"     NL
+    "* ="                   NL
+    ;
+
+  /* Deliberately not sorted. */
+  const char *test_paths[] =
+    {
+      "/vendor/libfoo/src/a.c", "/trunk", "/vendor/libfoo/priv/x",
+      "/vendor/libfoo/src/b.c", "/vendor/libfoo", "/trunk/secret/a",
+      "/trunk/secret", "/trunk/secret-not/a", "/trunk/src/id.key",
+      "/vendor/libfoo/src", "/vendor/libfoo/src/sub/c.c", "/",
+      "/vendor/libfoo/priv", "/trunk/src/main.c", "/vendor/libfoo/src/z.c",
+      "trunk/relative", "/vendor/libfoo/src/sub/d.key"
+    };
+  const svn_repos_authz_access_t required[] =
+    {
+      svn_authz_read,
+      svn_authz_write,
+      svn_authz_read | svn_authz_recursive
+    };
+  const char *users[] = { "userA", "userB", NULL };
+  const int path_count = sizeof(test_paths) / sizeof(test_paths[0]);
+  const int required_count = sizeof(required) / sizeof(required[0]);
+  const int user_count = sizeof(users) / sizeof(users[0]);
+
+  svn_stringbuf_t *buf = svn_stringbuf_create(rules, pool);
+  svn_stream_t *stream = svn_stream_from_stringbuf(buf, pool);
+  apr_array_header_t *paths = apr_array_make(pool, path_count,
+                                             sizeof(const char *));
+  svn_boolean_t *access_granted = apr_palloc(pool, path_count
+                                                   * sizeof(svn_boolean_t));
+  svn_authz_t *authz;
+  int u, i, k;
+
+  SVN_ERR(svn_repos_authz_parse2(&authz, stream, NULL, NULL, NULL, pool,
+                                 pool));
+  for (i = 0; i < path_count; ++i)
+    APR_ARRAY_PUSH(paths, const char *) = test_paths[i];
+
+  /* The batch results must match those of individual lookups. */
+  for (u = 0; u < user_count; ++u)
+    for (k = 0; k < required_count; ++k)
+      {
+        SVN_ERR(svn_repos__authz_check_paths(access_granted, authz, "repo",
+                                             paths, users[u], required[k],
+                                             pool));
+        for (i = 0; i < path_count; ++i)
+          {
+            svn_authz_t *fresh;
+            svn_boolean_t expected;
+            const char *path = test_paths[i];
+
+            if (path[0] != '/')
+              path = apr_pstrcat(pool, "/", path, SVN_VA_NULL);
+
+            svn_repos__authz_share(&fresh, authz, pool);
+            SVN_ERR(svn_repos_authz_check_access(fresh, "repo", path,
+                                                 users[u], required[k],
+                                                 &expected, pool));
+            if (access_granted[i] != expected)
+              return svn_error_createf(SVN_ERR_TEST_FAILED, NULL,
+                                       "Batch check of '%s' for user '%s' "
+                                       "returned %d instead of %d",
+                                       test_paths[i],
+                                       users[u] ? users[u] : "(anonymous)",
+                                       access_granted[i], expected);
+          }
+      }
+
+  return SVN_NO_ERROR;
+}
+
 static int max_threads = 4;
 
 static struct svn_test_descriptor_t test_funcs[] =
@@ -524,6 +796,14 @@ static struct svn_test_descriptor_t test_funcs[] =
                    "issue 4741 groups"),
     SVN_TEST_XFAIL2(reposful_reposless_stanzas_inherit,
                     "[foo:/] inherits [/]"),
+    SVN_TEST_PASS2(test_authz_share,
+                   "test svn_repos__authz_share"),
+    SVN_TEST_PASS2(test_authz_lookup_cache,
+                   "test cached authz lookup results"),
+    SVN_TEST_PASS2(test_authz_lookup_cache_eviction,
+                   "test authz lookup cache eviction"),
+    SVN_TEST_PASS2(test_authz_check_paths,
+                   "test svn_repos__authz_check_paths"),
     SVN_TEST_NULL
   };
 
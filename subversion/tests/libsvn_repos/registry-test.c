@@ -0,0 +1,324 @@
+/* registry-test.c --- tests for the svnserve repository registry
+ *
+ * ====================================================================
+ *    Licensed to the Apache Software Foundation (ASF) under one
+ *    or more contributor license agreements.  See the NOTICE file
+ *    distributed with this work for additional information
+ *    regarding copyright ownership.  The ASF licenses this file
+ *    to you under the Apache License, Version 2.0 (the
+ *    "License"); you may not use this file except in compliance
+ *    with the License.  You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *    Unless required by applicable law or agreed to in writing,
+ *    software distributed under the License is distributed on an
+ *    "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+ *    KIND, either express or implied.  See the License for the
+ *    specific language governing permissions and limitations
+ *    under the License.
+ * ====================================================================
+ */
+
+#include <apr_time.h>
+
+#include "svn_config.h"
+#include "svn_dirent_uri.h"
+#include "svn_fs.h"
+#include "svn_hash.h"
+#include "svn_io.h"
+#include "svn_pools.h"
+#include "svn_repos.h"
+
+#include "../../svnserve/registry.h"
+
+#include "../svn_test.h"
+#include "../svn_test_fs.h"
+
+/* Files touched less than 2 seconds before they are read don't get
+ * cached by the registry.  Wait a bit longer than that to make sure. */
+#define SETTLE_TIME apr_time_from_msec(2500)
+
+/* Number of connections that may use the same repository handle.
+ * Matches MAX_HANDLE_USES in registry.c. */
+#define MAX_HANDLE_USES 1000
+
+/* Key of the marker that we put into the FS config of every repository
+ * handle to tell them apart. */
+#define MARKER_KEY "registry-test-marker"
+
+/* What load_settings() reads. */
+typedef struct settings_t
+{
+  svn_authz_t *authz;
+  svn_config_t *pwdb;
+} settings_t;
+
+/* Baton for load_settings(). */
+typedef struct settings_baton_t
+{
+  const char *authz_path;
+  const char *passwd_path;
+
+  /* Number of times that the settings have been loaded. */
+  int loads;
+} settings_baton_t;
+
+/* Implements registry__load_func_t for a settings_baton_t BATON. */
+static svn_error_t *
+load_settings(void **object,
+              apr_array_header_t *dependencies,
+              void *baton,
+              apr_pool_t *result_pool,
+              apr_pool_t *scratch_pool)
+{
+  settings_baton_t *sb = baton;
+  settings_t *settings = apr_pcalloc(result_pool, sizeof(*settings));
+
+  APR_ARRAY_PUSH(dependencies, const char *) = sb->authz_path;
+  SVN_ERR(svn_repos_authz_read4(&settings->authz, sb->authz_path, NULL,
+                                TRUE, NULL, NULL, NULL, result_pool,
+                                scratch_pool));
+
+  APR_ARRAY_PUSH(dependencies, const char *) = sb->passwd_path;
+  SVN_ERR(svn_config_read3(&settings->pwdb, sb->passwd_path, TRUE,
+                           FALSE, FALSE, result_pool));
+
+  sb->loads++;
+  *object = settings;
+
+  return SVN_NO_ERROR;
+}
+
+/* Get the settings described by BATON from REGISTRY, allocated in
+ * RESULT_POOL.  Verify that they have been loaded EXPECTED_LOADS times
+ * so far, that USER has read access to the repository root exactly if
+ * READABLE is set and that USER's password is PASSWORD.  Return the
+ * settings in *SETTINGS_P. */
+static svn_error_t *
+check_settings(settings_t **settings_p,
+               registry_t *registry,
+               settings_baton_t *baton,
+               int expected_loads,
+               const char *user,
+               svn_boolean_t readable,
+               const char *password,
+               apr_pool_t *result_pool)
+{
+  void *object;
+  settings_t *settings;
+  svn_boolean_t granted;
+  const char *value;
+
+  SVN_ERR(registry__get_shared(&object, registry, "settings",
+                               load_settings, baton, result_pool,
+                               result_pool));
+  settings = object;
+  SVN_TEST_INT_ASSERT(baton->loads, expected_loads);
+
+  SVN_ERR(svn_repos_authz_check_access(settings->authz, NULL, "/", user,
+                                       svn_authz_read, &granted,
+                                       result_pool));
+  SVN_TEST_ASSERT(granted == readable);
+
+  svn_config_get(settings->pwdb, &value, "users", user, NULL);
+  SVN_TEST_STRING_ASSERT(value, password);
+
+  if (settings_p)
+    *settings_p = settings;
+
+  return SVN_NO_ERROR;
+}
+
+/* Replace the file at PATH with one that has CONTENTS.  Use SCRATCH_POOL
+ * for temporaries. */
+static svn_error_t *
+rewrite_file(const char *path,
+             const char *contents,
+             apr_pool_t *scratch_pool)
+{
+  return svn_error_trace(svn_io_write_atomic2(path, contents,
+                                              strlen(contents), path,
+                                              FALSE, scratch_pool));
+}
+
+static svn_error_t *
+test_registry_shared_settings(apr_pool_t *pool)
+{
+  registry_t *registry;
+  settings_baton_t baton = { 0 };
+  settings_t *first, *second;
+  apr_pool_t *conn_pool = svn_pool_create(pool);
+  const char *sandbox;
+  apr_time_t mtime;
+
+  SVN_ERR(svn_test_make_sandbox_dir(&sandbox, "registry-shared-settings",
+                                    pool));
+  baton.authz_path = svn_dirent_join(sandbox, "authz", pool);
+  baton.passwd_path = svn_dirent_join(sandbox, "passwd", pool);
+
+  SVN_ERR(svn_io_file_create(baton.authz_path,
+                             "[/]\nuser = r\n", pool));
+  SVN_ERR(svn_io_file_create(baton.passwd_path,
+                             "[users]\nuser = one\n", pool));
+  SVN_ERR(registry__create(&registry, pool));
+
+  /* The files have just been written and may change again within the
+   * same timestamp.  Every connection has to read them. */
+  SVN_ERR(check_settings(NULL, registry, &baton, 1, "user", TRUE, "one",
+                         conn_pool));
+  svn_pool_clear(conn_pool);
+  SVN_ERR(check_settings(NULL, registry, &baton, 2, "user", TRUE, "one",
+                         conn_pool));
+  svn_pool_clear(conn_pool);
+
+  /* Once they have settled, they are read only once. */
+  apr_sleep(SETTLE_TIME);
+  SVN_ERR(check_settings(&first, registry, &baton, 3, "user", TRUE, "one",
+                         conn_pool));
+  svn_pool_clear(conn_pool);
+  SVN_ERR(check_settings(&second, registry, &baton, 3, "user", TRUE, "one",
+                         conn_pool));
+  SVN_TEST_ASSERT(first == second);
+  svn_pool_clear(conn_pool);
+
+  /* A new password changes the size of the passwd file. */
+  SVN_ERR(rewrite_file(baton.passwd_path, "[users]\nuser = three\n",
+                       pool));
+  SVN_ERR(check_settings(NULL, registry, &baton, 4, "user", TRUE, "three",
+                         conn_pool));
+  svn_pool_clear(conn_pool);
+
+  apr_sleep(SETTLE_TIME);
+  SVN_ERR(check_settings(NULL, registry, &baton, 5, "user", TRUE, "three",
+                         conn_pool));
+  svn_pool_clear(conn_pool);
+  SVN_ERR(check_settings(NULL, registry, &baton, 5, "user", TRUE, "three",
+                         conn_pool));
+  svn_pool_clear(conn_pool);
+
+  /* Replace the authz rules with ones of the same size and restore the
+   * old mtime.  Only the ctime tells that the file has changed. */
+  SVN_ERR(svn_io_file_affected_time(&mtime, baton.authz_path, pool));
+  SVN_ERR(rewrite_file(baton.authz_path, "[/]\nresu = r\n", pool));
+  SVN_ERR(svn_io_set_file_affected_time(mtime, baton.authz_path, pool));
+  SVN_ERR(check_settings(NULL, registry, &baton, 6, "user", FALSE, "three",
+                         conn_pool));
+  svn_pool_destroy(conn_pool);
+
+  return SVN_NO_ERROR;
+}
+
+/* Open the repository at REPOS_ROOT through REGISTRY, allocated in
+ * RESULT_POOL, and tag the FS config with MARKER.  Return in *FOUND the
+ * marker of the handle that we got, i.e. MARKER if it is a new one. */
+static svn_error_t *
+open_repos(const char **found,
+           registry_t *registry,
+           const char *repos_root,
+           const char *marker,
+           apr_pool_t *result_pool)
+{
+  svn_repos_t *repos;
+  apr_hash_t *fs_config = apr_hash_make(result_pool);
+
+  svn_hash_sets(fs_config, MARKER_KEY, marker);
+  SVN_ERR(registry__open_repos(&repos, registry, repos_root, fs_config,
+                               result_pool, result_pool));
+
+  /* A reused handle keeps the FS config it has been opened with. */
+  fs_config = svn_fs_config(svn_repos_fs(repos), result_pool);
+  *found = apr_pstrdup(result_pool, svn_hash_gets(fs_config, MARKER_KEY));
+
+  return SVN_NO_ERROR;
+}
+
+static svn_error_t *
+test_registry_repos_handles(const svn_test_opts_t *opts,
+                            apr_pool_t *pool)
+{
+  registry_t *registry;
+  svn_repos_t *repos;
+  apr_pool_t *conn_pool = svn_pool_create(pool);
+  apr_pool_t *other_pool = svn_pool_create(pool);
+  const char *repos_root;
+  const char *format_path;
+  const char *found;
+  svn_stringbuf_t *format;
+  int i;
+
+  SVN_ERR(svn_test__create_repos(&repos, "test-registry-repos-handles",
+                                 opts, pool));
+  SVN_ERR(svn_dirent_get_absolute(&repos_root, svn_repos_path(repos, pool),
+                                  pool));
+  SVN_ERR(registry__create(&registry, pool));
+
+  /* The repository has just been created.  Its handles can't be
+   * validated and are not reused. */
+  SVN_ERR(open_repos(&found, registry, repos_root, "fresh 1", conn_pool));
+  SVN_TEST_STRING_ASSERT(found, "fresh 1");
+  svn_pool_clear(conn_pool);
+  SVN_ERR(open_repos(&found, registry, repos_root, "fresh 2", conn_pool));
+  SVN_TEST_STRING_ASSERT(found, "fresh 2");
+  svn_pool_clear(conn_pool);
+
+  /* Once the files have settled, the next connection gets the handle
+   * of the previous one. */
+  apr_sleep(SETTLE_TIME);
+  SVN_ERR(open_repos(&found, registry, repos_root, "stable", conn_pool));
+  SVN_TEST_STRING_ASSERT(found, "stable");
+  svn_pool_clear(conn_pool);
+  SVN_ERR(open_repos(&found, registry, repos_root, "unused", conn_pool));
+  SVN_TEST_STRING_ASSERT(found, "stable");
+
+  /* ... unless that one is still in use. */
+  SVN_ERR(open_repos(&found, registry, repos_root, "other", other_pool));
+  SVN_TEST_STRING_ASSERT(found, "other");
+  svn_pool_clear(other_pool);
+  svn_pool_clear(conn_pool);
+
+  /* The most recently returned handle gets used first.  After
+   * MAX_HANDLE_USES connections, it is replaced by a new one. */
+  for (i = 2; i < MAX_HANDLE_USES; ++i)
+    {
+      SVN_ERR(open_repos(&found, registry, repos_root, "unused", conn_pool));
+      SVN_TEST_STRING_ASSERT(found, "stable");
+      svn_pool_clear(conn_pool);
+    }
+
+  SVN_ERR(open_repos(&found, registry, repos_root, "unused", conn_pool));
+  SVN_TEST_STRING_ASSERT(found, "other");
+  SVN_ERR(open_repos(&found, registry, repos_root, "recycled", other_pool));
+  SVN_TEST_STRING_ASSERT(found, "recycled");
+  svn_pool_clear(other_pool);
+  svn_pool_clear(conn_pool);
+
+  /* Rewriting the repository format file, even with the same contents,
+   * invalidates all idle handles. */
+  format_path = svn_dirent_join(repos_root, "format", pool);
+  SVN_ERR(svn_stringbuf_from_file2(&format, format_path, pool));
+  SVN_ERR(rewrite_file(format_path, format->data, pool));
+  SVN_ERR(open_repos(&found, registry, repos_root, "reopened", conn_pool));
+  SVN_TEST_STRING_ASSERT(found, "reopened");
+
+  svn_pool_destroy(conn_pool);
+  svn_pool_destroy(other_pool);
+
+  return SVN_NO_ERROR;
+}
+
+/* The test table.  */
+
+static int max_threads = 2;
+
+static struct svn_test_descriptor_t test_funcs[] =
+  {
+    SVN_TEST_NULL,
+    SVN_TEST_PASS2(test_registry_shared_settings,
+                   "test invalidation of shared settings"),
+    SVN_TEST_OPTS_PASS(test_registry_repos_handles,
+                       "test reuse of repository handles"),
+    SVN_TEST_NULL
+  };
+
+SVN_TEST_MAIN
@@ -4466,6 +4466,296 @@ test_list(const svn_test_opts_t *opts,
   return SVN_NO_ERROR;
 }
 
+/* Implement svn_repos_notify_func_t.  Append the revisions of all
+   svn_repos_notify_verify_rev_end notifications to the array in BATON. */
+static void
+verify_notify(void *baton,
+              const svn_repos_notify_t *notify,
+              apr_pool_t *scratch_pool)
+{
+  apr_array_header_t *revisions = baton;
+
+  if (notify->action == svn_repos_notify_verify_rev_end)
+    APR_ARRAY_PUSH(revisions, svn_revnum_t) = notify->revision;
+}
+
+/* Implement svn_repos_verify_callback_t.  Count the errors in BATON. */
+static svn_error_t *
+verify_callback(void *baton,
+                svn_revnum_t revision,
+                svn_error_t *verify_err,
+                apr_pool_t *scratch_pool)
+{
+  *(int *)baton += 1;
+
+  return SVN_NO_ERROR;
+}
+
+static svn_error_t *
+test_verify_jobs(const svn_test_opts_t *opts,
+                 apr_pool_t *pool)
+{
+  svn_repos_t *repos;
+  svn_fs_t *fs;
+  svn_fs_txn_t *txn;
+  svn_fs_root_t *txn_root;
+  svn_revnum_t youngest_rev;
+  apr_array_header_t *revisions;
+  apr_pool_t *iterpool = svn_pool_create(pool);
+  int errors = 0;
+  int i;
+
+  /* Create a repository with a couple of revisions. */
+  SVN_ERR(svn_test__create_repos(&repos, "test-repo-verify-jobs", opts,
+                                 pool));
+  fs = svn_repos_fs(repos);
+
+  SVN_ERR(svn_fs_begin_txn(&txn, fs, 0, pool));
+  SVN_ERR(svn_fs_txn_root(&txn_root, txn, pool));
+  SVN_ERR(svn_test__create_greek_tree(txn_root, pool));
+  SVN_ERR(svn_repos_fs_commit_txn(NULL, repos, &youngest_rev, txn, pool));
+
+  for (i = 0; i < 20; ++i)
+    {
+      svn_pool_clear(iterpool);
+
+      SVN_ERR(svn_fs_begin_txn(&txn, fs, youngest_rev, iterpool));
+      SVN_ERR(svn_fs_txn_root(&txn_root, txn, iterpool));
+      SVN_ERR(svn_test__set_file_contents(txn_root, "iota",
+                                          apr_psprintf(iterpool,
+                                                       "iota %d\n", i),
+                                          iterpool));
+      SVN_ERR(svn_test__set_file_contents(txn_root, "A/mu",
+                                          apr_psprintf(iterpool,
+                                                       "mu %d\n", i),
+                                          iterpool));
+      SVN_ERR(svn_repos_fs_commit_txn(NULL, repos, &youngest_rev, txn,
+                                      iterpool));
+    }
+
+  svn_pool_destroy(iterpool);
+
+  /* Verify concurrently.  The notifications must still arrive in
+     revision order. */
+  revisions = apr_array_make(pool, 0, sizeof(svn_revnum_t));
+  SVN_ERR(svn_repos_verify_fs4(repos, 0, youngest_rev, FALSE, FALSE, 4,
+                               verify_notify, revisions,
+                               verify_callback, &errors,
+                               NULL, NULL, pool));
+
+  SVN_TEST_INT_ASSERT(errors, 0);
+  SVN_TEST_INT_ASSERT(revisions->nelts, (int)youngest_rev + 1);
+  for (i = 0; i < revisions->nelts; ++i)
+    SVN_TEST_ASSERT(APR_ARRAY_IDX(revisions, i, svn_revnum_t) == i);
+
+  return SVN_NO_ERROR;
+}
+
+/* Implement svn_repos_log_entry_receiver_t.  Append the revision of
+   LOG_ENTRY to the svn_stringbuf_t in BATON. */
+static svn_error_t *
+log_index_receiver(void *baton,
+                   svn_repos_log_entry_t *log_entry,
+                   apr_pool_t *scratch_pool)
+{
+  svn_stringbuf_t *revisions = baton;
+
+  svn_stringbuf_appendcstr(revisions,
+                           apr_psprintf(scratch_pool, " %ld",
+                                        log_entry->revision));
+
+  return SVN_NO_ERROR;
+}
+
+/* Run svn_repos_get_logs5() on REPOS for each of the PATHS with every
+   combination of the START, END and strict node history flags given in
+   RANGES and return the revisions reported as one line per query in
+   *RESULT.  Allocate the result in POOL. */
+static svn_error_t *
+get_log_index_logs(svn_stringbuf_t **result,
+                   svn_repos_t *repos,
+                   const char * const *paths,
+                   const svn_revnum_t ranges[][2],
+                   apr_pool_t *pool)
+{
+  apr_pool_t *iterpool = svn_pool_create(pool);
+  int i, k, strict;
+
+  *result = svn_stringbuf_create_empty(pool);
+  for (i = 0; paths[i]; ++i)
+    for (k = 0; SVN_IS_VALID_REVNUM(ranges[k][0]); ++k)
+      for (strict = 0; strict < 2; ++strict)
+        {
+          apr_array_header_t *log_paths
+            = apr_array_make(iterpool, 1, sizeof(const char *));
+
+          svn_pool_clear(iterpool);
+          APR_ARRAY_PUSH(log_paths, const char *) = paths[i];
+
+          svn_stringbuf_appendcstr(*result,
+                                   apr_psprintf(pool, "%s %ld:%ld %d:",
+                                                paths[i], ranges[k][0],
+                                                ranges[k][1], strict));
+          SVN_ERR(svn_repos_get_logs5(repos, log_paths,
+                                      ranges[k][0], ranges[k][1], 0,
+                                      strict, FALSE, NULL, NULL, NULL,
+                                      NULL, NULL,
+                                      log_index_receiver, *result,
+                                      iterpool));
+          svn_stringbuf_appendbyte(*result, '\n');
+        }
+
+  svn_pool_destroy(iterpool);
+
+  return SVN_NO_ERROR;
+}
+
+static svn_error_t *
+test_log_index(const svn_test_opts_t *opts,
+               apr_pool_t *pool)
+{
+  svn_repos_t *repos;
+  svn_fs_t *fs;
+  svn_fs_txn_t *txn;
+  svn_fs_root_t *txn_root, *rev_root;
+  svn_revnum_t youngest_rev, indexed_rev;
+  svn_stringbuf_t *indexed_logs, *plain_logs;
+  const char *db_path;
+  apr_pool_t *iterpool = svn_pool_create(pool);
+  int i;
+
+  static const char * const paths[] = {
+    "/A", "/A/mu", "/A/B", "A/D/G", "/A/D2", "/A/D2/G/rho", "/iota", NULL
+  };
+  static const svn_revnum_t ranges[][2] = {
+    { 8, 0 }, { 0, 8 }, { 7, 3 }, { 5, 5 }, { 4, 8 },
+    { SVN_INVALID_REVNUM, SVN_INVALID_REVNUM }
+  };
+
+  /* Changes to make in r2 to r8: the path to modify and the path to
+     copy A/D to or to delete, if any. */
+  static const struct
+  {
+    const char *modify;
+    const char *copy_to;
+    const char *delete_path;
+  } changes[] = {
+    { "A/mu", NULL, NULL },
+    { "iota", NULL, NULL },
+    { "A/D/G/pi", NULL, NULL },
+    { "A/D/gamma", "A/D2", NULL },
+    { "A/D2/G/rho", NULL, NULL },
+    { "A/B/E/alpha", NULL, "A/B/lambda" },
+    { "A/D2/G/rho", NULL, NULL }
+  };
+
+  SVN_ERR(svn_test__create_repos(&repos, "test-repo-log-index", opts,
+                                 pool));
+  fs = svn_repos_fs(repos);
+
+  SVN_ERR(svn_fs_begin_txn(&txn, fs, 0, pool));
+  SVN_ERR(svn_fs_txn_root(&txn_root, txn, pool));
+  SVN_ERR(svn_test__create_greek_tree(txn_root, pool));
+  SVN_ERR(svn_repos_fs_commit_txn(NULL, repos, &youngest_rev, txn, pool));
+
+  /* Build the index for r1.  Later commits will extend it. */
+  SVN_ERR(svn_repos__log_index_build(&indexed_rev, repos, NULL, NULL, pool));
+  SVN_TEST_INT_ASSERT(indexed_rev, 1);
+
+  for (i = 0; i < (int)(sizeof(changes) / sizeof(changes[0])); ++i)
+    {
+      svn_pool_clear(iterpool);
+
+      SVN_ERR(svn_fs_begin_txn(&txn, fs, youngest_rev, iterpool));
+      SVN_ERR(svn_fs_txn_root(&txn_root, txn, iterpool));
+      SVN_ERR(svn_test__set_file_contents(txn_root, changes[i].modify,
+                                          apr_psprintf(iterpool,
+                                                       "change %d\n", i),
+                                          iterpool));
+      if (changes[i].copy_to)
+        {
+          SVN_ERR(svn_fs_revision_root(&rev_root, fs, youngest_rev,
+                                       iterpool));
+          SVN_ERR(svn_fs_copy(rev_root, "A/D", txn_root, changes[i].copy_to,
+                              iterpool));
+        }
+      if (changes[i].delete_path)
+        SVN_ERR(svn_fs_delete(txn_root, changes[i].delete_path, iterpool));
+
+      SVN_ERR(svn_repos_fs_commit_txn(NULL, repos, &youngest_rev, txn,
+                                      iterpool));
+    }
+  svn_pool_destroy(iterpool);
+  SVN_TEST_INT_ASSERT(youngest_rev, 8);
+
+  /* The commits must have kept the index up to date. */
+  SVN_ERR(svn_repos__log_index_build(&indexed_rev, repos, NULL, NULL, pool));
+  SVN_TEST_INT_ASSERT(indexed_rev, youngest_rev);
+
+  /* Whatever log reports with the index must be exactly what it reports
+     when walking the node history. */
+  SVN_ERR(get_log_index_logs(&indexed_logs, repos, paths, ranges, pool));
+
+  db_path = svn_dirent_join(svn_repos_db_env(repos, pool), "log-index.db",
+                            pool);
+  SVN_ERR(svn_io_remove_file2(db_path, FALSE, pool));
+  SVN_ERR(get_log_index_logs(&plain_logs, repos, paths, ranges, pool));
+
+  SVN_TEST_STRING_ASSERT(indexed_logs->data, plain_logs->data);
+
+  return SVN_NO_ERROR;
+}
+
+/* Implement svn_repos_authz_func_t.  Count the calls in the int that
+   BATON points to and deny every other path. */
+static svn_error_t *
+alternating_authz_func(svn_boolean_t *allowed,
+                       svn_fs_root_t *root,
+                       const char *path,
+                       void *baton,
+                       apr_pool_t *pool)
+{
+  int *calls = baton;
+
+  *allowed = (*calls % 2) == 0;
+  ++*calls;
+
+  return SVN_NO_ERROR;
+}
+
+static svn_error_t *
+test_revision_access_lazy_authz(const svn_test_opts_t *opts,
+                                apr_pool_t *pool)
+{
+  svn_repos_t *repos;
+  svn_fs_t *fs;
+  svn_fs_txn_t *txn;
+  svn_fs_root_t *txn_root;
+  svn_revnum_t youngest_rev;
+  svn_repos_revision_access_level_t access_level;
+  int calls = 0;
+
+  SVN_ERR(svn_test__create_repos(&repos, "test-repo-access-lazy-authz",
+                                 opts, pool));
+  fs = svn_repos_fs(repos);
+
+  SVN_ERR(svn_fs_begin_txn(&txn, fs, 0, pool));
+  SVN_ERR(svn_fs_txn_root(&txn_root, txn, pool));
+  SVN_ERR(svn_test__create_greek_tree(txn_root, pool));
+  SVN_ERR(svn_repos_fs_commit_txn(NULL, repos, &youngest_rev, txn, pool));
+
+  /* Authz callbacks other than svn_repos__authz_read_func() may be
+     expensive per path.  They must not be asked about more changed paths
+     than needed: one readable and one unreadable path decide it. */
+  SVN_ERR(svn_repos_check_revision_access(&access_level, repos, youngest_rev,
+                                          alternating_authz_func, &calls,
+                                          pool));
+  SVN_TEST_ASSERT(access_level == svn_repos_revision_access_partial);
+  SVN_TEST_INT_ASSERT(calls, 2);
+
+  return SVN_NO_ERROR;
+}
+
 /* The test table.  */
 
 static int max_threads = 4;
@@ -4537,6 +4827,12 @@ static struct svn_test_descriptor_t test_funcs[] =
                    "optional authz wildcard performance test"),
     SVN_TEST_OPTS_PASS(test_list,
                        "test svn_repos_list"),
+    SVN_TEST_OPTS_PASS(test_verify_jobs,
+                       "test svn_repos_verify_fs4 with multiple jobs"),
+    SVN_TEST_OPTS_PASS(test_log_index,
+                       "test log with and without the log index"),
+    SVN_TEST_OPTS_PASS(test_revision_access_lazy_authz,
+                       "check revision access with a per-path authz"),
     SVN_TEST_NULL
   };
 
@@ -227,6 +227,151 @@ test_membuffer_cache_basic(apr_pool_t *pool)
   return basic_cache_test(cache, FALSE, pool);
 }
 
+static svn_error_t *
+test_membuffer_cache_shared(apr_pool_t *pool)
+{
+  svn_cache__t *cache;
+  svn_membuffer_t *membuffer;
+  svn_error_t *err;
+
+  err = svn_cache__membuffer_cache_create_shared(&membuffer, 10*1024, 1, 0,
+                                                 TRUE, pool);
+  if (err && err->apr_err == SVN_ERR_UNSUPPORTED_FEATURE)
+    return svn_error_create(SVN_ERR_TEST_SKIPPED, err,
+                            "shared memory caches not supported");
+  SVN_ERR(err);
+
+  /* Without a prefix pool, full keys must be stored and compared. */
+  SVN_ERR(svn_cache__create_membuffer_cache(&cache,
+                                            membuffer,
+                                            serialize_revnum,
+                                            deserialize_revnum,
+                                            APR_HASH_KEY_STRING,
+                                            "cache:",
+                                            SVN_CACHE__MEMBUFFER_DEFAULT_PRIORITY,
+                                            FALSE,
+                                            FALSE,
+                                            pool, pool));
+
+  return basic_cache_test(cache, FALSE, pool);
+}
+
+static svn_error_t *
+test_compressed_cache_basic(apr_pool_t *pool)
+{
+  svn_cache__t *cache;
+  svn_cache__compressed_store_t *store;
+
+  SVN_ERR(svn_cache__compressed_store_create(&store, 64*1024, TRUE, pool));
+  SVN_ERR(svn_cache__create_compressed(&cache,
+                                       store,
+                                       serialize_revnum,
+                                       deserialize_revnum,
+                                       APR_HASH_KEY_STRING,
+                                       "cache:",
+                                       pool));
+
+  return basic_cache_test(cache, FALSE, pool);
+}
+
+/* Return a string of LEN bytes of poorly compressible data that depends
+ * on SEED.  Allocate it in POOL. */
+static svn_stringbuf_t *
+make_noise(apr_size_t len,
+           apr_uint32_t seed,
+           apr_pool_t *pool)
+{
+  svn_stringbuf_t *result = svn_stringbuf_create_ensure(len, pool);
+  while (result->len < len)
+    {
+      seed = seed * 1103515245 + 12345;
+      svn_stringbuf_appendbyte(result, (char)(seed >> 16));
+    }
+
+  return result;
+}
+
+static svn_error_t *
+test_compressed_cache_admission(apr_pool_t *pool)
+{
+  enum { ENTRY_COUNT = 10, ENTRY_SIZE = 1500 };
+
+  svn_cache__t *cache;
+  svn_cache__compressed_store_t *store;
+  svn_cache__info_t info;
+  apr_uint64_t used_size;
+  svn_stringbuf_t *value;
+  svn_stringbuf_t *newcomer = make_noise(ENTRY_SIZE, 42, pool);
+  svn_boolean_t found;
+  int i, k;
+
+  /* Room for about ENTRY_COUNT entries. */
+  SVN_ERR(svn_cache__compressed_store_create(&store, 16*1024, TRUE, pool));
+  SVN_ERR(svn_cache__create_compressed(&cache, store, NULL, NULL,
+                                       APR_HASH_KEY_STRING, "text:", pool));
+
+  /* Objects larger than 1/8th of the store get ignored. */
+  SVN_TEST_ASSERT(svn_cache__is_cachable(cache, 2*1024));
+  SVN_TEST_ASSERT(!svn_cache__is_cachable(cache, 3*1024));
+
+  /* Fill the cache and make its contents popular. */
+  for (i = 0; i < ENTRY_COUNT; ++i)
+    {
+      const char *key = apr_psprintf(pool, "%d", i);
+      svn_stringbuf_t *text = make_noise(ENTRY_SIZE, i, pool);
+
+      SVN_ERR(svn_cache__get((void **)&value, &found, cache, key, pool));
+      SVN_TEST_ASSERT(!found);
+      SVN_ERR(svn_cache__set(cache, key, text, pool));
+
+      for (k = 0; k < 2; ++k)
+        {
+          SVN_ERR(svn_cache__get((void **)&value, &found, cache, key, pool));
+          SVN_TEST_ASSERT(found);
+          SVN_TEST_STRING_ASSERT(value->data, text->data);
+        }
+    }
+
+  /* Some newcomer that has only been requested once may not replace
+   * them. */
+  SVN_ERR(svn_cache__get((void **)&value, &found, cache, "new", pool));
+  SVN_TEST_ASSERT(!found);
+  SVN_ERR(svn_cache__set(cache, "new", newcomer, pool));
+  SVN_ERR(svn_cache__get_info(cache, &info, FALSE, pool));
+  SVN_TEST_ASSERT(info.rejections == 1);
+
+  SVN_ERR(svn_cache__get((void **)&value, &found, cache, "new", pool));
+  SVN_TEST_ASSERT(!found);
+
+  /* Once it has become more popular than the LRU entry, it gets in. */
+  for (k = 0; k < 3; ++k)
+    SVN_ERR(svn_cache__get((void **)&value, &found, cache, "new", pool));
+
+  SVN_ERR(svn_cache__set(cache, "new", newcomer, pool));
+  SVN_ERR(svn_cache__get((void **)&value, &found, cache, "new", pool));
+  SVN_TEST_ASSERT(found);
+  SVN_TEST_STRING_ASSERT(value->data, newcomer->data);
+
+  SVN_ERR(svn_cache__get_info(cache, &info, FALSE, pool));
+  SVN_TEST_ASSERT(info.rejections == 1);
+  SVN_TEST_ASSERT(info.used_size <= 16*1024);
+
+  /* Highly redundant data gets stored compressed. */
+  used_size = info.used_size;
+  value = svn_stringbuf_create_ensure(2000, pool);
+  svn_stringbuf_appendfill(value, 'x', 2000);
+  SVN_ERR(svn_cache__set(cache, "redundant", value, pool));
+  SVN_ERR(svn_cache__get_info(cache, &info, FALSE, pool));
+  SVN_TEST_ASSERT(info.used_size > used_size);
+  SVN_TEST_ASSERT(info.used_size < used_size + 200);
+
+  SVN_ERR(svn_cache__get((void **)&value, &found, cache, "redundant", pool));
+  SVN_TEST_ASSERT(found);
+  SVN_TEST_ASSERT(value->len == 2000 && value->data[1999] == 'x');
+
+  return SVN_NO_ERROR;
+}
+
 /* Implements svn_cache__deserialize_func_t */
 static svn_error_t *
 raise_error_deserialize_func(void **out,
@@ -590,6 +735,214 @@ test_membuffer_unaligned_fixed_keys(apr_pool_t *pool)
   return SVN_NO_ERROR;
 }
 
+/* Implements svn_cache__partial_getter_func_t.
+ * Return a copy of the stringbuf item's contents in *OUT. */
+static svn_error_t *
+get_stringbuf_contents(void **out,
+                       const void *data,
+                       apr_size_t data_len,
+                       void *baton,
+                       apr_pool_t *result_pool)
+{
+  *out = apr_pstrmemdup(result_pool, data, data_len - 1);
+  return SVN_NO_ERROR;
+}
+
+static svn_error_t *
+test_membuffer_partial_getter(apr_pool_t *pool)
+{
+  svn_cache__t *cache;
+  svn_membuffer_t *membuffer;
+  svn_stringbuf_t *small = svn_stringbuf_create("small item", pool);
+  svn_stringbuf_t *large = svn_stringbuf_create_empty(pool);
+  svn_stringbuf_t *answer;
+  const char *contents;
+  svn_boolean_t found;
+  int i;
+
+  /* Larger than what gets processed without locking the cache. */
+  for (i = 0; i < 1000; ++i)
+    svn_stringbuf_appendcstr(large, "0123456789abcdef");
+
+  SVN_ERR(svn_cache__membuffer_cache_create(&membuffer, 1024*1024, 0, 0,
+                                            TRUE, TRUE, pool));
+  SVN_ERR(svn_cache__create_membuffer_cache(&cache, membuffer, NULL, NULL,
+                                            APR_HASH_KEY_STRING, "cache:",
+                                            SVN_CACHE__MEMBUFFER_DEFAULT_PRIORITY,
+                                            FALSE, FALSE, pool, pool));
+
+  SVN_ERR(svn_cache__set(cache, "small", small, pool));
+  SVN_ERR(svn_cache__set(cache, "large", large, pool));
+
+  SVN_ERR(svn_cache__get_partial((void **)&contents, &found, cache, "small",
+                                 get_stringbuf_contents, NULL, pool));
+  SVN_TEST_ASSERT(found);
+  SVN_TEST_STRING_ASSERT(contents, small->data);
+
+  SVN_ERR(svn_cache__get_partial((void **)&contents, &found, cache, "large",
+                                 get_stringbuf_contents, NULL, pool));
+  SVN_TEST_ASSERT(found);
+  SVN_TEST_STRING_ASSERT(contents, large->data);
+
+  SVN_ERR(svn_cache__get_partial((void **)&contents, &found, cache, "none",
+                                 get_stringbuf_contents, NULL, pool));
+  SVN_TEST_ASSERT(!found);
+
+  /* Replaced items must not be returned with their old contents. */
+  svn_stringbuf_set(small, "replaced");
+  SVN_ERR(svn_cache__set(cache, "small", small, pool));
+  SVN_ERR(svn_cache__get((void **)&answer, &found, cache, "small", pool));
+  SVN_TEST_ASSERT(found);
+  SVN_TEST_STRING_ASSERT(answer->data, "replaced");
+
+  SVN_ERR(svn_cache__get_partial((void **)&contents, &found, cache, "small",
+                                 get_stringbuf_contents, NULL, pool));
+  SVN_TEST_ASSERT(found);
+  SVN_TEST_STRING_ASSERT(contents, "replaced");
+
+  return SVN_NO_ERROR;
+}
+
+
+/* Implements svn_cache__snapshot_tag_func_t.  Skip everything but
+ * the "snapshot:" prefixes. */
+static svn_error_t *
+snapshot_tag(const char **tag,
+             void *baton,
+             const char *prefix,
+             apr_pool_t *result_pool)
+{
+  *tag = strncmp(prefix, "snapshot:", 9) == 0 ? prefix + 9 : NULL;
+  return SVN_NO_ERROR;
+}
+
+/* Implements svn_cache__snapshot_accept_func_t.  Accept everything
+ * whose tag differs from the string in BATON. */
+static svn_error_t *
+snapshot_accept(svn_boolean_t *accept,
+                void *baton,
+                const char *prefix,
+                const char *tag,
+                apr_pool_t *scratch_pool)
+{
+  const char *rejected_tag = baton;
+  SVN_ERR_ASSERT(strncmp(prefix, "snapshot:", 9) == 0);
+  SVN_ERR_ASSERT(strcmp(prefix + 9, tag) == 0);
+
+  *accept = strcmp(tag, rejected_tag) != 0;
+  return SVN_NO_ERROR;
+}
+
+/* Create membuffer caches in MEMBUFFER for the string keys (*STRING_KEYS),
+ * fixed-size keys (*FIXED_KEYS) and some prefix that shall not be saved
+ * to snapshots (*SKIPPED).  Allocate them in POOL. */
+static svn_error_t *
+create_snapshot_caches(svn_cache__t **string_keys,
+                       svn_cache__t **fixed_keys,
+                       svn_cache__t **skipped,
+                       svn_membuffer_t *membuffer,
+                       apr_pool_t *pool)
+{
+  SVN_ERR(svn_cache__create_membuffer_cache(
+            string_keys, membuffer, serialize_revnum, deserialize_revnum,
+            APR_HASH_KEY_STRING, "snapshot:string",
+            SVN_CACHE__MEMBUFFER_DEFAULT_PRIORITY, FALSE, FALSE,
+            pool, pool));
+  SVN_ERR(svn_cache__create_membuffer_cache(
+            fixed_keys, membuffer, serialize_revnum, deserialize_revnum,
+            sizeof(svn_revnum_t), "snapshot:fixed",
+            SVN_CACHE__MEMBUFFER_DEFAULT_PRIORITY, FALSE, FALSE,
+            pool, pool));
+  SVN_ERR(svn_cache__create_membuffer_cache(
+            skipped, membuffer, serialize_revnum, deserialize_revnum,
+            APR_HASH_KEY_STRING, "volatile",
+            SVN_CACHE__MEMBUFFER_DEFAULT_PRIORITY, FALSE, FALSE,
+            pool, pool));
+
+  return SVN_NO_ERROR;
+}
+
+/* Verify that CACHE contains VALUE under KEY, if EXPECTED is set, and
+ * does not contain KEY otherwise. */
+static svn_error_t *
+verify_snapshot_entry(svn_cache__t *cache,
+                      const void *key,
+                      svn_revnum_t value,
+                      svn_boolean_t expected,
+                      apr_pool_t *pool)
+{
+  svn_revnum_t *answer;
+  svn_boolean_t found;
+
+  SVN_ERR(svn_cache__get((void **) &answer, &found, cache, key, pool));
+  SVN_TEST_ASSERT(found == expected);
+  if (found)
+    SVN_TEST_ASSERT(*answer == value);
+
+  return SVN_NO_ERROR;
+}
+
+static svn_error_t *
+test_membuffer_snapshot(apr_pool_t *pool)
+{
+  svn_membuffer_t *membuffer;
+  svn_cache__t *string_keys, *fixed_keys, *skipped;
+  svn_stringbuf_t *snapshot = svn_stringbuf_create_empty(pool);
+  svn_revnum_t rev = 42, value = 4711;
+
+  /* Fill the source cache. */
+  SVN_ERR(svn_cache__membuffer_cache_create(&membuffer, 10*1024, 1, 0,
+                                            TRUE, TRUE, pool));
+  SVN_ERR(create_snapshot_caches(&string_keys, &fixed_keys, &skipped,
+                                 membuffer, pool));
+
+  SVN_ERR(svn_cache__set(string_keys, "some key", &value, pool));
+  SVN_ERR(svn_cache__set(fixed_keys, &rev, &value, pool));
+  SVN_ERR(svn_cache__set(skipped, "some key", &value, pool));
+
+  SVN_ERR(svn_cache__membuffer_save(membuffer,
+                                    svn_stream_from_stringbuf(snapshot,
+                                                              pool),
+                                    snapshot_tag, NULL, pool));
+
+  /* Load the snapshot into an empty cache. */
+  SVN_ERR(svn_cache__membuffer_cache_create(&membuffer, 10*1024, 1, 0,
+                                            TRUE, TRUE, pool));
+  SVN_ERR(svn_cache__membuffer_load(membuffer,
+                                    svn_stream_from_stringbuf(snapshot,
+                                                              pool),
+                                    snapshot_accept, "", pool));
+  SVN_ERR(create_snapshot_caches(&string_keys, &fixed_keys, &skipped,
+                                 membuffer, pool));
+
+  SVN_ERR(verify_snapshot_entry(string_keys, "some key", value, TRUE, pool));
+  SVN_ERR(verify_snapshot_entry(fixed_keys, &rev, value, TRUE, pool));
+  SVN_ERR(verify_snapshot_entry(skipped, "some key", value, FALSE, pool));
+
+  /* Load it again but reject one of the prefixes. */
+  SVN_ERR(svn_cache__membuffer_cache_create(&membuffer, 10*1024, 1, 0,
+                                            TRUE, TRUE, pool));
+  SVN_ERR(svn_cache__membuffer_load(membuffer,
+                                    svn_stream_from_stringbuf(snapshot,
+                                                              pool),
+                                    snapshot_accept, "fixed", pool));
+  SVN_ERR(create_snapshot_caches(&string_keys, &fixed_keys, &skipped,
+                                 membuffer, pool));
+
+  SVN_ERR(verify_snapshot_entry(string_keys, "some key", value, TRUE, pool));
+  SVN_ERR(verify_snapshot_entry(fixed_keys, &rev, value, FALSE, pool));
+
+  /* Truncated snapshots must be detected. */
+  svn_stringbuf_chop(snapshot, 1);
+  SVN_TEST_ASSERT_ERROR(svn_cache__membuffer_load(
+                          membuffer,
+                          svn_stream_from_stringbuf(snapshot, pool),
+                          snapshot_accept, "", pool),
+                        SVN_ERR_STREAM_MALFORMED_DATA);
+
+  return SVN_NO_ERROR;
+}
+
 
 /* The test table.  */
 
@@ -606,6 +959,8 @@ static struct svn_test_descriptor_t test_funcs[] =
                        "memcache svn_cache with very long keys"),
     SVN_TEST_PASS2(test_membuffer_cache_basic,
                    "basic membuffer svn_cache test"),
+    SVN_TEST_PASS2(test_membuffer_cache_shared,
+                   "membuffer svn_cache in shared memory"),
     SVN_TEST_PASS2(test_membuffer_serializer_error_handling,
                    "test for error handling in membuffer svn_cache"),
     SVN_TEST_PASS2(test_membuffer_cache_clearing,
@@ -616,6 +971,14 @@ static struct svn_test_descriptor_t test_funcs[] =
                    "test membuffer cache with unaligned string keys"),
     SVN_TEST_PASS2(test_membuffer_unaligned_fixed_keys,
                    "test membuffer cache with unaligned fixed keys"),
+    SVN_TEST_PASS2(test_membuffer_partial_getter,
+                   "test membuffer cache partial getters"),
+    SVN_TEST_PASS2(test_membuffer_snapshot,
+                   "save and load membuffer cache snapshots"),
+    SVN_TEST_PASS2(test_compressed_cache_basic,
+                   "basic compressed svn_cache test"),
+    SVN_TEST_PASS2(test_compressed_cache_admission,
+                   "compressed svn_cache admission policy"),
     SVN_TEST_NULL
   };
 
@@ -0,0 +1,449 @@
+/* pristine-bench.c -- measure what compressing the pristine store costs
+ *
+ * ====================================================================
+ *    Licensed to the Apache Software Foundation (ASF) under one
+ *    or more contributor license agreements.  See the NOTICE file
+ *    distributed with this work for additional information
+ *    regarding copyright ownership.  The ASF licenses this file
+ *    to you under the Apache License, Version 2.0 (the
+ *    "License"); you may not use this file except in compliance
+ *    with the License.  You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *    Unless required by applicable law or agreed to in writing,
+ *    software distributed under the License is distributed on an
+ *    "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+ *    KIND, either express or implied.  See the License for the
+ *    specific language governing permissions and limitations
+ *    under the License.
+ * ====================================================================
+ */
+
+/* This is not a unit test.  For each given value of the
+ * "compress-pristines" option, it creates a working copy in the system's
+ * temporary directory the way a checkout would: it stores a distinct text
+ * for each of a few thousand files in the pristine store and installs the
+ * working files from there.  Then it runs status walks that have to
+ * compare every working file with its pristine text.  It reports the time
+ * spent on each of these steps and the size of the pristine store on disk.
+ * All data is generated from a fixed seed, so the numbers are comparable
+ * between runs.
+ */
+
+#define APR_WANT_STDIO
+#include <apr_want.h>
+
+#include <apr_general.h>
+#include <apr_strings.h>
+#include <apr_time.h>
+
+#include "svn_config.h"
+#include "svn_ctype.h"
+#include "svn_dirent_uri.h"
+#include "svn_error.h"
+#include "svn_hash.h"
+#include "svn_io.h"
+#include "svn_pools.h"
+#include "svn_string.h"
+#include "svn_wc.h"
+
+#include "../../libsvn_wc/wc.h"
+#include "../../libsvn_wc/wc_db.h"
+#include "../../libsvn_wc/workqueue.h"
+
+/* Default number of files in the working copy. */
+#define DEFAULT_FILES 5000
+
+/* Number of files per directory. */
+#define FILES_PER_DIR 100
+
+/* Number of status walks per setting.  We report the best run to filter
+ * out noise. */
+#define DEFAULT_REPEAT 3
+
+/* The repository that the working copy pretends to be a checkout of. */
+#define REPOS_ROOT_URL "file:///pristine-bench"
+#define REPOS_UUID "00000000-0000-0000-0000-000000000000"
+
+/* Simple linear congruential pseudo-random number generator.
+ * Update *SEED and return the next pseudo-random number. */
+static apr_uint32_t
+next_rand(apr_uint32_t *seed)
+{
+  *seed = *seed * 1103515245 + 12345;
+  return *seed >> 8;
+}
+
+/* Return a text of about SIZE bytes in lines of words, like source code.
+ * Use SEED for the pseudo-random numbers and allocate the result in
+ * POOL. */
+static svn_stringbuf_t *
+make_text(apr_size_t size,
+          apr_uint32_t *seed,
+          apr_pool_t *pool)
+{
+  static const char *const words[] = {
+    "if", "else", "return", "static", "const", "char", "int", "for",
+    "while", "struct", "svn_error_t", "apr_pool_t", "pool", "err", "i",
+    "NULL", "TRUE", "FALSE", "SVN_ERR", "(", ")", "{", "}", ";", "=="
+  };
+  svn_stringbuf_t *text = svn_stringbuf_create_ensure(size + 80, pool);
+
+  while (text->len < size)
+    {
+      int count = next_rand(seed) % 10 + 1;
+      int i;
+
+      for (i = 0; i < count; ++i)
+        {
+          svn_stringbuf_appendcstr(text, words[next_rand(seed)
+                                               % (sizeof(words)
+                                                  / sizeof(words[0]))]);
+          svn_stringbuf_appendbyte(text, ' ');
+        }
+      svn_stringbuf_appendbyte(text, '\n');
+    }
+
+  return text;
+}
+
+/* Create a working copy with FILE_COUNT files at WC_ABSPATH using WC_CTX,
+ * as a checkout would.  Store a distinct text of 1 to 32 kB for each file
+ * in the pristine store, add the files to the BASE tree in directories of
+ * FILES_PER_DIR files and install them with the work queue.  Set
+ * *STORE_TIME to the time spent storing the texts and *INSTALL_TIME to
+ * the time spent running the work queue.  Return the files in *FILES as
+ * const char * absolute paths allocated in RESULT_POOL.  Use SCRATCH_POOL
+ * for temporary allocations. */
+static svn_error_t *
+checkout_wc(apr_array_header_t **files,
+            apr_interval_time_t *store_time,
+            apr_interval_time_t *install_time,
+            svn_wc_context_t *wc_ctx,
+            const char *wc_abspath,
+            int file_count,
+            apr_pool_t *result_pool,
+            apr_pool_t *scratch_pool)
+{
+  svn_wc__db_t *db = wc_ctx->db;
+  apr_hash_t *no_props = apr_hash_make(scratch_pool);
+  apr_array_header_t *no_children = apr_array_make(scratch_pool, 0,
+                                                   sizeof(const char *));
+  apr_pool_t *iterpool = svn_pool_create(scratch_pool);
+  apr_uint32_t seed = 0x5eed;
+  const char *dir_abspath = NULL;
+  const char *dir_relpath = NULL;
+  apr_time_t start;
+  int i;
+
+  SVN_ERR(svn_wc_ensure_adm4(wc_ctx, wc_abspath,
+                             REPOS_ROOT_URL, REPOS_ROOT_URL, REPOS_UUID,
+                             1, svn_depth_infinity, scratch_pool));
+
+  *files = apr_array_make(result_pool, file_count, sizeof(const char *));
+  *store_time = 0;
+
+  for (i = 0; i < file_count; ++i)
+    {
+      svn_stream_t *stream;
+      svn_wc__db_install_data_t *install_data;
+      svn_checksum_t *sha1_checksum;
+      svn_checksum_t *md5_checksum;
+      svn_stringbuf_t *text;
+      const char *name;
+      const char *file_abspath;
+
+      svn_pool_clear(iterpool);
+
+      if (i % FILES_PER_DIR == 0)
+        {
+          dir_relpath = apr_psprintf(result_pool, "d%04d",
+                                     i / FILES_PER_DIR);
+          dir_abspath = svn_dirent_join(wc_abspath, dir_relpath,
+                                        result_pool);
+          SVN_ERR(svn_wc__db_base_add_directory(db, dir_abspath, wc_abspath,
+                                                dir_relpath, REPOS_ROOT_URL,
+                                                REPOS_UUID, 1, no_props, 1,
+                                                0, "bench", no_children,
+                                                svn_depth_infinity, NULL,
+                                                FALSE, NULL, NULL, NULL,
+                                                NULL, iterpool));
+        }
+
+      text = make_text(1024 << (next_rand(&seed) % 6), &seed, iterpool);
+
+      start = apr_time_now();
+      SVN_ERR(svn_wc__db_pristine_prepare_install(&stream, &install_data,
+                                                  &sha1_checksum,
+                                                  &md5_checksum,
+                                                  db, wc_abspath,
+                                                  iterpool, iterpool));
+      SVN_ERR(svn_stream_write(stream, text->data, &text->len));
+      SVN_ERR(svn_stream_close(stream));
+      SVN_ERR(svn_wc__db_pristine_install(install_data, sha1_checksum,
+                                          md5_checksum, iterpool));
+      *store_time += apr_time_now() - start;
+
+      name = apr_psprintf(iterpool, "f%05d.c", i);
+      file_abspath = svn_dirent_join(dir_abspath, name, result_pool);
+      SVN_ERR(svn_wc__db_base_add_file(db, file_abspath, wc_abspath,
+                                       svn_relpath_join(dir_relpath, name,
+                                                        iterpool),
+                                       REPOS_ROOT_URL, REPOS_UUID, 1,
+                                       no_props, 1, 0, "bench",
+                                       sha1_checksum,
+                                       NULL, FALSE, FALSE, NULL, NULL,
+                                       FALSE, FALSE, NULL, NULL,
+                                       iterpool));
+      APR_ARRAY_PUSH(*files, const char *) = file_abspath;
+    }
+
+  /* Queue the installs of one directory at a time, as an update would. */
+  for (i = 0; i < file_count; i += FILES_PER_DIR)
+    {
+      svn_skel_t *work_items = NULL;
+      int k;
+
+      svn_pool_clear(iterpool);
+      for (k = i; k < file_count && k < i + FILES_PER_DIR; ++k)
+        {
+          svn_skel_t *work_item;
+
+          SVN_ERR(svn_wc__wq_build_file_install(&work_item, db,
+                                                APR_ARRAY_IDX(*files, k,
+                                                              const char *),
+                                                NULL, FALSE, TRUE,
+                                                iterpool, iterpool));
+          work_items = svn_wc__wq_merge(work_items, work_item, iterpool);
+        }
+
+      SVN_ERR(svn_wc__db_wq_add(db, wc_abspath, work_items, iterpool));
+    }
+
+  svn_pool_clear(iterpool);
+  start = apr_time_now();
+  SVN_ERR(svn_wc__wq_run(db, wc_abspath, NULL, NULL, iterpool));
+  *install_time = apr_time_now() - start;
+
+  svn_pool_destroy(iterpool);
+
+  return SVN_NO_ERROR;
+}
+
+/* Implements svn_io_walk_func_t.  Add the size of regular files to
+ * BATON, an apr_off_t *. */
+static svn_error_t *
+add_file_size(void *baton,
+              const char *path,
+              const apr_finfo_t *finfo,
+              apr_pool_t *pool)
+{
+  apr_off_t *total = baton;
+
+  if (finfo->filetype == APR_REG)
+    *total += finfo->size;
+
+  return SVN_NO_ERROR;
+}
+
+/* Implements svn_wc_status_func4_t.  Count the nodes reported by a status
+ * walk that doesn't report unmodified nodes in BATON, an int *. */
+static svn_error_t *
+count_modified(void *baton,
+               const char *local_abspath,
+               const svn_wc_status3_t *status,
+               apr_pool_t *scratch_pool)
+{
+  int *modified = baton;
+
+  ++*modified;
+
+  return SVN_NO_ERROR;
+}
+
+/* Set the timestamps of all FILES (const char * absolute paths) to WHEN,
+ * so that status has to compare their contents with the pristine store.
+ * Use SCRATCH_POOL for temporary allocations. */
+static svn_error_t *
+touch_files(const apr_array_header_t *files,
+            apr_time_t when,
+            apr_pool_t *scratch_pool)
+{
+  apr_pool_t *iterpool = svn_pool_create(scratch_pool);
+  int i;
+
+  for (i = 0; i < files->nelts; ++i)
+    {
+      svn_pool_clear(iterpool);
+      SVN_ERR(svn_io_set_file_affected_time(when,
+                                            APR_ARRAY_IDX(files, i,
+                                                          const char *),
+                                            iterpool));
+    }
+
+  svn_pool_destroy(iterpool);
+
+  return SVN_NO_ERROR;
+}
+
+/* Measure a checkout of FILE_COUNT files into the temporary directory and
+ * REPEAT status walks over it with the "compress-pristines" option set to
+ * COMPRESSION.  Print the results to stdout and remove the working copy
+ * afterwards.  Use POOL for temporary allocations. */
+static svn_error_t *
+bench_compression(const char *compression,
+                  int file_count,
+                  int repeat,
+                  apr_pool_t *pool)
+{
+  apr_pool_t *iterpool = svn_pool_create(pool);
+  svn_config_t *config;
+  svn_wc_context_t *wc_ctx;
+  const char *temp_dir;
+  const char *wc_name;
+  const char *wc_abspath;
+  apr_array_header_t *files;
+  apr_interval_time_t store_time;
+  apr_interval_time_t install_time;
+  apr_interval_time_t best = 0;
+  apr_off_t store_size = 0;
+  apr_time_t when = apr_time_now() - apr_time_from_sec(3600);
+  svn_error_t *err;
+  int i;
+
+  SVN_ERR(svn_config_create2(&config, FALSE, FALSE, pool));
+  svn_config_set(config, SVN_CONFIG_SECTION_WORKING_COPY,
+                 SVN_CONFIG_OPTION_COMPRESS_PRISTINES, compression);
+  SVN_ERR(svn_wc_context_create(&wc_ctx, config, pool, pool));
+
+  SVN_ERR(svn_io_temp_dir(&temp_dir, pool));
+  wc_name = apr_psprintf(pool, "pristine-bench-%" APR_TIME_T_FMT,
+                         apr_time_now());
+  SVN_ERR(svn_dirent_get_absolute(&wc_abspath,
+                                  svn_dirent_join(temp_dir, wc_name, pool),
+                                  pool));
+
+  err = checkout_wc(&files, &store_time, &install_time, wc_ctx, wc_abspath,
+                    file_count, pool, pool);
+
+  if (!err)
+    err = svn_io_dir_walk2(svn_dirent_join_many(pool, wc_abspath,
+                                                svn_wc_get_adm_dir(pool),
+                                                "pristine", SVN_VA_NULL),
+                           APR_FINFO_TYPE | APR_FINFO_SIZE,
+                           add_file_size, &store_size, pool);
+
+  for (i = 0; i < repeat && !err; ++i)
+    {
+      apr_time_t start;
+      apr_interval_time_t duration;
+      int modified = 0;
+
+      svn_pool_clear(iterpool);
+      err = touch_files(files, when, iterpool);
+      if (err)
+        break;
+
+      start = apr_time_now();
+      err = svn_wc_walk_status(wc_ctx, wc_abspath, svn_depth_infinity,
+                               FALSE, FALSE, FALSE, NULL,
+                               count_modified, &modified,
+                               NULL, NULL, iterpool);
+      duration = apr_time_now() - start;
+
+      if (!err && modified)
+        err = svn_error_createf(SVN_ERR_TEST_FAILED, NULL,
+                                "status reported %d changed nodes",
+                                modified);
+
+      if (i == 0 || duration < best)
+        best = duration;
+    }
+
+  if (!err)
+    printf("%-5s %12.3f %12.3f %12.3f %12.1f\n",
+           compression,
+           (double)store_time / APR_USEC_PER_SEC,
+           (double)install_time / APR_USEC_PER_SEC,
+           (double)best / APR_USEC_PER_SEC,
+           (double)store_size / (1024 * 1024));
+
+  err = svn_error_compose_create(err, svn_wc_context_destroy(wc_ctx));
+  svn_pool_destroy(iterpool);
+
+  return svn_error_compose_create(err,
+                                  svn_io_remove_dir2(wc_abspath, TRUE,
+                                                     NULL, NULL, pool));
+}
+
+int
+main(int argc, char **argv)
+{
+  apr_pool_t *pool;
+  apr_array_header_t *compressions;
+  int file_count = DEFAULT_FILES;
+  int repeat = DEFAULT_REPEAT;
+  svn_error_t *err = SVN_NO_ERROR;
+  int i;
+
+  while (argc > 1)
+    {
+      const char *const arg = argv[1];
+      if (arg[0] != '-')
+        break;
+
+      if (svn_ctype_isdigit(arg[1]))
+        repeat = atoi(arg + 1);
+      else
+        break;
+      --argc; ++argv;
+    }
+
+  if ((argc > 1 && argv[1][0] == '-') || repeat <= 0)
+    {
+      fprintf(stderr,
+              "Usage: pristine-bench [-<repeat>] [FILES [no|lz4|zlib...]]\n");
+      exit(1);
+    }
+
+  apr_initialize();
+  pool = svn_pool_create(NULL);
+
+  compressions = apr_array_make(pool, 3, sizeof(const char *));
+  if (argc > 1)
+    {
+      file_count = atoi(argv[1]);
+      for (argc -= 2, argv += 2; argc > 0; --argc, ++argv)
+        APR_ARRAY_PUSH(compressions, const char *) = argv[0];
+    }
+
+  if (compressions->nelts == 0)
+    {
+      APR_ARRAY_PUSH(compressions, const char *) = "no";
+      APR_ARRAY_PUSH(compressions, const char *) = "lz4";
+      APR_ARRAY_PUSH(compressions, const char *) = "zlib";
+    }
+
+  if (file_count <= 0)
+    {
+      fprintf(stderr, "pristine-bench: FILES must be positive\n");
+      exit(1);
+    }
+
+  printf("%d files, times in seconds, best of %d status walks\n\n",
+         file_count, repeat);
+  printf("%-5s %12s %12s %12s %12s\n",
+         "", "store", "install", "status", "store MB");
+
+  for (i = 0; i < compressions->nelts && !err; ++i)
+    err = bench_compression(APR_ARRAY_IDX(compressions, i, const char *),
+                            file_count, repeat, pool);
+
+  if (err)
+    svn_handle_error2(err, stderr, TRUE, "pristine-bench: ");
+
+  svn_pool_destroy(pool);
+  apr_terminate();
+  exit(0);
+}
@@ -25,6 +25,7 @@
 #include <apr_general.h>
 
 #include "svn_types.h"
+#include "svn_config.h"
 
 /* Make sure SVN_DEPRECATED is defined as empty before including svn_io.h.
    We don't want to trigger deprecation warnings.  */
@@ -306,6 +307,189 @@ reject_mismatching_text(const svn_test_opts_t *opts,
 #endif
 }
 
+/* Check that the pristine store of the WC at WC_ABSPATH in DB yields TEXT
+ * for SHA1_CHECKSUM through all its APIs, and that it stores the text
+ * compressed if COMPRESSED. */
+static svn_error_t *
+verify_pristine_text(svn_wc__db_t *db,
+                     const char *wc_abspath,
+                     const svn_checksum_t *sha1_checksum,
+                     const svn_stringbuf_t *text,
+                     svn_boolean_t compressed,
+                     apr_pool_t *pool)
+{
+  svn_stream_t *contents;
+  svn_filesize_t size;
+  svn_stringbuf_t *read_back;
+  const char *pristine_abspath;
+  svn_boolean_t file_compressed;
+  apr_finfo_t finfo;
+
+  SVN_ERR(svn_wc__db_pristine_read(&contents, &size, db, wc_abspath,
+                                   sha1_checksum, pool, pool));
+  SVN_TEST_ASSERT(size == (svn_filesize_t)text->len);
+  SVN_ERR(svn_stringbuf_from_stream(&read_back, contents, text->len, pool));
+  SVN_TEST_ASSERT(svn_stringbuf_compare(read_back, text));
+
+  SVN_ERR(svn_wc__db_pristine_get_file(&pristine_abspath, &file_compressed,
+                                       db, wc_abspath, sha1_checksum,
+                                       pool, pool));
+  SVN_TEST_ASSERT(file_compressed == compressed);
+  SVN_ERR(svn_io_stat(&finfo, pristine_abspath, APR_FINFO_SIZE, pool));
+  if (compressed)
+    SVN_TEST_ASSERT(finfo.size < (apr_off_t)text->len);
+  else
+    SVN_TEST_ASSERT(finfo.size == (apr_off_t)text->len);
+
+  SVN_ERR(svn_wc__db_pristine_open_file(&contents, pristine_abspath,
+                                        file_compressed, pool, pool));
+  SVN_ERR(svn_stringbuf_from_stream(&read_back, contents, text->len, pool));
+  SVN_TEST_ASSERT(svn_stringbuf_compare(read_back, text));
+
+  /* The path API gives a plain file either way. */
+  SVN_ERR(svn_wc__db_pristine_get_path(&pristine_abspath, db, wc_abspath,
+                                       sha1_checksum, pool, pool));
+  SVN_ERR(svn_stringbuf_from_file2(&read_back, pristine_abspath, pool));
+  SVN_TEST_ASSERT(svn_stringbuf_compare(read_back, text));
+
+  return SVN_NO_ERROR;
+}
+
+/* Store a text in a compressed pristine store and convert the store to
+ * uncompressed texts and back. */
+static svn_error_t *
+compressed_pristine_store(const svn_test_opts_t *opts,
+                          apr_pool_t *pool)
+{
+  svn_wc__db_t *db;
+  const char *wc_abspath;
+  svn_config_t *config;
+  svn_wc__db_install_data_t *install_data;
+  svn_stream_t *pristine_stream;
+  svn_checksum_t *data_sha1, *data_md5;
+  svn_stringbuf_t *data = svn_stringbuf_create_empty(pool);
+  svn_boolean_t converted;
+  apr_size_t sz;
+  int i;
+
+  SVN_ERR(create_repos_and_wc(&wc_abspath, &db,
+                              "compressed_pristine_store", opts, pool));
+
+  /* Enough text for several compressed blocks. */
+  for (i = 0; i < 20000; i++)
+    svn_stringbuf_appendcstr(data, apr_psprintf(pool, "Line %d\n", i));
+
+  SVN_ERR(svn_config_create2(&config, FALSE, FALSE, pool));
+  svn_config_set(config, SVN_CONFIG_SECTION_WORKING_COPY,
+                 SVN_CONFIG_OPTION_COMPRESS_PRISTINES, "zlib");
+  SVN_ERR(svn_wc__db_open(&db, config, FALSE, FALSE, pool, pool));
+  SVN_ERR(svn_wc__db_pristine_convert_store(&converted, db, wc_abspath,
+                                            NULL, NULL, pool));
+  SVN_TEST_ASSERT(converted);
+
+  SVN_ERR(svn_wc__db_pristine_prepare_install(&pristine_stream,
+                                              &install_data,
+                                              &data_sha1, &data_md5,
+                                              db, wc_abspath,
+                                              pool, pool));
+  sz = data->len;
+  SVN_ERR(svn_stream_write(pristine_stream, data->data, &sz));
+  SVN_ERR(svn_stream_close(pristine_stream));
+  SVN_ERR(svn_wc__db_pristine_install(install_data,
+                                      data_sha1, data_md5, pool));
+
+  SVN_ERR(verify_pristine_text(db, wc_abspath, data_sha1, data, TRUE, pool));
+
+  /* Decompress the store. */
+  svn_config_set(config, SVN_CONFIG_SECTION_WORKING_COPY,
+                 SVN_CONFIG_OPTION_COMPRESS_PRISTINES, "no");
+  SVN_ERR(svn_wc__db_open(&db, config, FALSE, FALSE, pool, pool));
+  SVN_ERR(svn_wc__db_pristine_convert_store(&converted, db, wc_abspath,
+                                            NULL, NULL, pool));
+  SVN_TEST_ASSERT(converted);
+  SVN_ERR(verify_pristine_text(db, wc_abspath, data_sha1, data, FALSE, pool));
+
+  /* Nothing to do the second time. */
+  SVN_ERR(svn_wc__db_pristine_convert_store(&converted, db, wc_abspath,
+                                            NULL, NULL, pool));
+  SVN_TEST_ASSERT(! converted);
+
+  /* And compress it again, with the other method. */
+  svn_config_set(config, SVN_CONFIG_SECTION_WORKING_COPY,
+                 SVN_CONFIG_OPTION_COMPRESS_PRISTINES, "lz4");
+  SVN_ERR(svn_wc__db_open(&db, config, FALSE, FALSE, pool, pool));
+  SVN_ERR(svn_wc__db_pristine_convert_store(&converted, db, wc_abspath,
+                                            NULL, NULL, pool));
+  SVN_TEST_ASSERT(converted);
+  SVN_ERR(verify_pristine_text(db, wc_abspath, data_sha1, data, TRUE, pool));
+
+  return SVN_NO_ERROR;
+}
+
+/* Make text conflicts during an update, and while updating a moved file,
+ * in a working copy with a compressed pristine store.  The merges hand
+ * decompressed pristine copies to work items that run later. */
+static svn_error_t *
+compressed_store_update_conflict(const svn_test_opts_t *opts,
+                                 apr_pool_t *pool)
+{
+  svn_test__sandbox_t b;
+  svn_config_t *config;
+  svn_boolean_t converted;
+  svn_boolean_t text_conflicted;
+  svn_stringbuf_t *theirs;
+  apr_hash_t *tmp_dirents;
+
+  SVN_ERR(svn_test__sandbox_create(&b, "compressed_store_update_conflict",
+                                   opts, pool));
+  SVN_ERR(svn_config_create2(&config, FALSE, FALSE, pool));
+  svn_config_set(config, SVN_CONFIG_SECTION_WORKING_COPY,
+                 SVN_CONFIG_OPTION_COMPRESS_PRISTINES, "lz4");
+  SVN_ERR(svn_wc_context_destroy(b.wc_ctx));
+  SVN_ERR(svn_wc_context_create(&b.wc_ctx, config, pool, pool));
+  SVN_ERR(svn_wc__db_pristine_convert_store(&converted, b.wc_ctx->db,
+                                            b.wc_abspath, NULL, NULL, pool));
+  SVN_TEST_ASSERT(converted);
+
+  SVN_ERR(sbox_file_write(&b, "f", "line 1\nline 2\n"));
+  SVN_ERR(sbox_wc_add(&b, "f"));
+  SVN_ERR(sbox_file_write(&b, "g", "line 1\nline 2\n"));
+  SVN_ERR(sbox_wc_add(&b, "g"));
+  SVN_ERR(sbox_wc_commit(&b, ""));
+  SVN_ERR(sbox_file_write(&b, "f", "line 1\ntheirs\n"));
+  SVN_ERR(sbox_file_write(&b, "g", "line 1\ntheirs\n"));
+  SVN_ERR(sbox_wc_commit(&b, ""));
+  SVN_ERR(sbox_wc_update(&b, "", 1));
+
+  SVN_ERR(sbox_file_write(&b, "f", "line 1\nmine\n"));
+  SVN_ERR(sbox_wc_move(&b, "g", "h"));
+  SVN_ERR(sbox_file_write(&b, "h", "line 1\nmine\n"));
+  SVN_ERR(sbox_wc_update(&b, "", 2));
+
+  SVN_ERR(svn_wc_conflicted_p3(&text_conflicted, NULL, NULL, b.wc_ctx,
+                               sbox_wc_path(&b, "f"), pool));
+  SVN_TEST_ASSERT(text_conflicted);
+  SVN_ERR(svn_stringbuf_from_file2(&theirs, sbox_wc_path(&b, "f.r2"), pool));
+  SVN_TEST_STRING_ASSERT(theirs->data, "line 1\ntheirs\n");
+
+  /* Update the move destination, too. */
+  SVN_ERR(sbox_wc_resolve(&b, "g", svn_depth_empty,
+                          svn_wc_conflict_choose_mine_conflict));
+  SVN_ERR(svn_wc_conflicted_p3(&text_conflicted, NULL, NULL, b.wc_ctx,
+                               sbox_wc_path(&b, "h"), pool));
+  SVN_TEST_ASSERT(text_conflicted);
+
+  /* The work queue removed all decompressed copies once it was done. */
+  SVN_ERR(svn_io_get_dirents3(&tmp_dirents,
+                              svn_dirent_join_many(pool, b.wc_abspath,
+                                                   svn_wc_get_adm_dir(pool),
+                                                   "tmp", SVN_VA_NULL),
+                              TRUE, pool, pool));
+  SVN_TEST_ASSERT(apr_hash_count(tmp_dirents) == 0);
+
+  return SVN_NO_ERROR;
+}
+
 
 static int max_threads = -1;
 
@@ -318,6 +502,10 @@ static struct svn_test_descriptor_t test_funcs[] =
                        "pristine_delete_while_open"),
     SVN_TEST_OPTS_PASS(reject_mismatching_text,
                        "reject_mismatching_text"),
+    SVN_TEST_OPTS_PASS(compressed_pristine_store,
+                       "compressed_pristine_store"),
+    SVN_TEST_OPTS_PASS(compressed_store_update_conflict,
+                       "compressed_store_update_conflict"),
     SVN_TEST_NULL
   };
 
@@ -88,6 +88,7 @@ static const int slow_statements[] =
 {
   /* Operate on the entire WC */
   STMT_SELECT_ALL_NODES,                /* schema validation code */
+  STMT_SELECT_ALL_PRISTINES,            /* pristine store conversion */
 
   /* Updates all records for a repository (designed slow) */
   STMT_UPDATE_LOCK_REPOS_ID,
@@ -113,7 +114,7 @@ static const int slow_statements[] =
   -1 /* final marker */
 };
 
-/* Statements that just read the first record from a table,
+/* Statements that just read the first record(s) from a table,
    using the primary key. Specialized as different sqlite
    versions produce different results */
 static const int primary_key_statements[] =
@@ -122,6 +123,7 @@ static const int primary_key_statements[] =
      and primary key instead of adding a list? */
   STMT_LOOK_FOR_WORK,
   STMT_SELECT_WORK_ITEM,
+  STMT_SELECT_WORK_ITEMS,
 
   -1 /* final marker */
 };
@@ -24,6 +24,14 @@
 #include <apr_pools.h>
 #include <apr_general.h>
 #include <apr_md5.h>
+#include <apr_thread_proc.h>
+#include <apr_thread_mutex.h>
+
+#ifndef WIN32
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+#endif
 
 #define SVN_DEPRECATED
 
@@ -34,7 +42,9 @@
 #include "svn_repos.h"
 #include "svn_wc.h"
 #include "svn_client.h"
+#include "svn_config.h"
 #include "svn_hash.h"
+#include "svn_utf.h"
 
 #include "utils.h"
 
@@ -43,6 +53,7 @@
 #include "private/svn_dep_compat.h"
 #include "../../libsvn_wc/wc.h"
 #include "../../libsvn_wc/wc_db.h"
+#include "../../libsvn_wc/workqueue.h"
 #define SVN_WC__I_AM_WC_DB
 #include "../../libsvn_wc/wc_db_private.h"
 
@@ -493,6 +504,695 @@ test_internal_file_modified(const svn_test_opts_t *opts, apr_pool_t *pool)
   return SVN_NO_ERROR;
 }
 
+/* Implements svn_wc_status_func4_t.  Append a description of STATUS at
+   LOCAL_ABSPATH to the apr_array_header_t of strings in BATON. */
+static svn_error_t *
+record_status(void *baton,
+              const char *local_abspath,
+              const svn_wc_status3_t *status,
+              apr_pool_t *scratch_pool)
+{
+  apr_array_header_t *statuses = baton;
+
+  APR_ARRAY_PUSH(statuses, const char *)
+    = apr_psprintf(statuses->pool, "%s %d %d %d", local_abspath,
+                   status->node_status, status->text_status,
+                   status->prop_status);
+
+  return SVN_NO_ERROR;
+}
+
+static svn_error_t *
+test_parallel_status(const svn_test_opts_t *opts, apr_pool_t *pool)
+{
+  svn_test__sandbox_t b;
+  svn_config_t *config;
+  svn_wc_context_t *wc_ctx;
+  apr_array_header_t *expected, *actual;
+  apr_time_t time;
+  int i;
+
+  SVN_ERR(svn_test__sandbox_create(&b, "parallel_status", opts, pool));
+  SVN_ERR(sbox_add_and_commit_greek_tree(&b));
+
+  /* Text changes with and without a size change, a file that only got
+     touched, a scheduled deletion and some unversioned nodes. */
+  SVN_ERR(sbox_file_write(&b, "A/mu", "modified mu"));
+  SVN_ERR(svn_io_file_affected_time(&time, sbox_wc_path(&b, "A/B/E/alpha"),
+                                    pool));
+  SVN_ERR(sbox_file_write(&b, "A/B/E/alpha", "This is the file 'ALPHA'.\n"));
+  SVN_ERR(svn_io_set_file_affected_time(time + apr_time_from_sec(1),
+                                        sbox_wc_path(&b, "A/B/E/alpha"),
+                                        pool));
+  SVN_ERR(svn_io_set_file_affected_time(time + apr_time_from_sec(1),
+                                        sbox_wc_path(&b, "A/D/G/rho"),
+                                        pool));
+  SVN_ERR(sbox_wc_delete(&b, "A/D/H/chi"));
+  SVN_ERR(sbox_file_write(&b, "A/C/unversioned", "new file"));
+  SVN_ERR(svn_io_dir_make(sbox_wc_path(&b, "A/D/G/newdir"),
+                          APR_OS_DEFAULT, pool));
+
+  expected = apr_array_make(pool, 32, sizeof(const char *));
+  SVN_ERR(svn_wc_walk_status(b.wc_ctx, b.wc_abspath, svn_depth_infinity,
+                             TRUE, FALSE, FALSE, NULL,
+                             record_status, expected, NULL, NULL, pool));
+
+  SVN_ERR(svn_config_create2(&config, FALSE, FALSE, pool));
+  svn_config_set(config, SVN_CONFIG_SECTION_WORKING_COPY,
+                 SVN_CONFIG_OPTION_STATUS_THREADS, "4");
+  SVN_ERR(svn_wc_context_create(&wc_ctx, config, pool, pool));
+
+  actual = apr_array_make(pool, 32, sizeof(const char *));
+  SVN_ERR(svn_wc_walk_status(wc_ctx, b.wc_abspath, svn_depth_infinity,
+                             TRUE, FALSE, FALSE, NULL,
+                             record_status, actual, NULL, NULL, pool));
+
+  /* Same statuses in the same order. */
+  SVN_TEST_INT_ASSERT(actual->nelts, expected->nelts);
+  for (i = 0; i < expected->nelts; i++)
+    SVN_TEST_STRING_ASSERT(APR_ARRAY_IDX(actual, i, const char *),
+                           APR_ARRAY_IDX(expected, i, const char *));
+
+  return SVN_NO_ERROR;
+}
+
+static svn_error_t *
+test_status_candidates(const svn_test_opts_t *opts, apr_pool_t *pool)
+{
+  svn_test__sandbox_t b;
+  apr_hash_t *candidates;
+
+  SVN_ERR(svn_test__sandbox_create(&b, "status_candidates", opts, pool));
+  SVN_ERR(sbox_add_and_commit_greek_tree(&b));
+
+  SVN_ERR(sbox_wc_propset(&b, "p", "v", "A/mu"));
+  SVN_ERR(sbox_file_write(&b, "A/C/new", "new file"));
+  SVN_ERR(sbox_wc_add(&b, "A/C/new"));
+  SVN_ERR(sbox_wc_delete(&b, "A/D/H/chi"));
+  SVN_ERR(sbox_wc_switch(&b, "A/B/E", "/A/D/G", svn_depth_infinity));
+
+  SVN_ERR(svn_wc__db_read_status_candidates(&candidates, b.wc_ctx->db,
+                                            b.wc_abspath, pool, pool));
+  SVN_TEST_ASSERT(svn_hash_gets(candidates, sbox_wc_path(&b, "A/mu")));
+  SVN_TEST_ASSERT(svn_hash_gets(candidates, sbox_wc_path(&b, "A/C/new")));
+  SVN_TEST_ASSERT(svn_hash_gets(candidates, sbox_wc_path(&b, "A/D/H/chi")));
+  SVN_TEST_ASSERT(svn_hash_gets(candidates, sbox_wc_path(&b, "A/B/E")));
+  SVN_TEST_ASSERT(!svn_hash_gets(candidates, sbox_wc_path(&b, "iota")));
+  SVN_TEST_ASSERT(!svn_hash_gets(candidates, sbox_wc_path(&b, "A/B/E/pi")));
+  SVN_TEST_ASSERT(!svn_hash_gets(candidates, sbox_wc_path(&b, "A/D/G/rho")));
+  SVN_TEST_ASSERT(!svn_hash_gets(candidates, b.wc_abspath));
+
+  /* Only strict descendants of the target. */
+  SVN_ERR(svn_wc__db_read_status_candidates(&candidates, b.wc_ctx->db,
+                                            sbox_wc_path(&b, "A/D"),
+                                            pool, pool));
+  SVN_TEST_ASSERT(svn_hash_gets(candidates, sbox_wc_path(&b, "A/D/H/chi")));
+  SVN_TEST_ASSERT(!svn_hash_gets(candidates, sbox_wc_path(&b, "A/mu")));
+  SVN_TEST_ASSERT(!svn_hash_gets(candidates, sbox_wc_path(&b, "A/D")));
+
+  return SVN_NO_ERROR;
+}
+
+#if !defined(WIN32) && APR_HAS_THREADS
+/* A stand-in for svn-wc-watcher that answers journal requests with a
+   preset response. */
+typedef struct fake_watcher_t
+{
+  /* The listening socket and its path in the local encoding. */
+  int listen_fd;
+  const char *socket_path;
+
+  /* The answer to the journal command, or NULL to close the connection
+     without answering.  Protected by MUTEX. */
+  const char *response;
+  apr_thread_mutex_t *mutex;
+
+  apr_thread_t *thread;
+} fake_watcher_t;
+
+/* Thread function serving the fake_watcher_t DATA until it receives the
+   stop command. */
+static void * APR_THREAD_FUNC
+fake_watcher_thread(apr_thread_t *thread, void *data)
+{
+  fake_watcher_t *w = data;
+
+  while (TRUE)
+    {
+      char command[32];
+      const char *response;
+      ssize_t len;
+      int fd = accept(w->listen_fd, NULL, NULL);
+
+      if (fd < 0)
+        break;
+
+      len = read(fd, command, sizeof(command) - 1);
+      command[len > 0 ? len : 0] = '\0';
+      if (strcmp(command, SVN_WC__WATCHER_CMD_STOP "\n") == 0)
+        {
+          close(fd);
+          break;
+        }
+
+      apr_thread_mutex_lock(w->mutex);
+      response = w->response;
+      apr_thread_mutex_unlock(w->mutex);
+
+      /* Failing to send makes the request fail, which is fine. */
+      if (response
+          && strcmp(command, SVN_WC__WATCHER_CMD_JOURNAL "\n") == 0)
+        send(fd, response, strlen(response), 0);
+      close(fd);
+    }
+
+  apr_thread_exit(thread, APR_SUCCESS);
+  return NULL;
+}
+
+/* Pool cleanup function stopping the fake_watcher_t DATA. */
+static apr_status_t
+fake_watcher_cleanup(void *data)
+{
+  fake_watcher_t *w = data;
+  static const char command[] = SVN_WC__WATCHER_CMD_STOP "\n";
+  struct sockaddr_un addr;
+  apr_status_t thread_status;
+  int fd;
+
+  memset(&addr, 0, sizeof(addr));
+  addr.sun_family = AF_UNIX;
+  strcpy(addr.sun_path, w->socket_path);
+
+  fd = socket(AF_UNIX, SOCK_STREAM, 0);
+  if (fd >= 0)
+    {
+      if (connect(fd, (struct sockaddr *)&addr, sizeof(addr)) == 0
+          && write(fd, command, sizeof(command) - 1) > 0)
+        apr_thread_join(&thread_status, w->thread);
+      close(fd);
+    }
+
+  close(w->listen_fd);
+  unlink(w->socket_path);
+
+  return APR_SUCCESS;
+}
+
+/* Start a fake watcher listening at SOCKET_ABSPATH and return it in *W.
+   It stops when POOL gets cleared.  Return SVN_ERR_TEST_SKIPPED if the
+   path is too long for a Unix domain socket. */
+static svn_error_t *
+fake_watcher_start(fake_watcher_t **w,
+                   const char *socket_abspath,
+                   apr_pool_t *pool)
+{
+  fake_watcher_t *result = apr_pcalloc(pool, sizeof(*result));
+  struct sockaddr_un addr;
+
+  SVN_ERR(svn_utf_cstring_from_utf8(&result->socket_path,
+                                    svn_dirent_local_style(socket_abspath,
+                                                           pool),
+                                    pool));
+  if (strlen(result->socket_path) >= sizeof(addr.sun_path))
+    return svn_error_createf(SVN_ERR_TEST_SKIPPED, NULL,
+                             "Socket path '%s' is too long",
+                             result->socket_path);
+
+  memset(&addr, 0, sizeof(addr));
+  addr.sun_family = AF_UNIX;
+  strcpy(addr.sun_path, result->socket_path);
+
+  result->listen_fd = socket(AF_UNIX, SOCK_STREAM, 0);
+  SVN_TEST_ASSERT(result->listen_fd >= 0);
+  SVN_TEST_ASSERT(bind(result->listen_fd, (struct sockaddr *)&addr,
+                       sizeof(addr)) == 0);
+  SVN_TEST_ASSERT(listen(result->listen_fd, 4) == 0);
+
+  SVN_TEST_ASSERT(apr_thread_mutex_create(&result->mutex,
+                                          APR_THREAD_MUTEX_DEFAULT,
+                                          pool) == APR_SUCCESS);
+  SVN_TEST_ASSERT(apr_thread_create(&result->thread, NULL,
+                                    fake_watcher_thread, result,
+                                    pool) == APR_SUCCESS);
+  apr_pool_cleanup_register(pool, result, fake_watcher_cleanup,
+                            apr_pool_cleanup_null);
+
+  *w = result;
+  return SVN_NO_ERROR;
+}
+
+/* Make W answer with RESPONSE from now on. */
+static void
+fake_watcher_respond(fake_watcher_t *w,
+                     const char *response)
+{
+  apr_thread_mutex_lock(w->mutex);
+  w->response = response;
+  apr_thread_mutex_unlock(w->mutex);
+}
+
+/* Return a journal of the session SESSION listing the NULL-terminated
+   list of relpaths CHANGED, allocated in POOL. */
+static const char *
+make_journal(apr_pool_t *pool,
+             const char *session,
+             const char *const *changed)
+{
+  svn_stringbuf_t *journal
+    = svn_stringbuf_createf(pool, SVN_WC__WATCHER_GREETING "\n"
+                                  "session %s\n", session);
+  int i;
+
+  for (i = 0; changed[i]; i++)
+    svn_stringbuf_appendcstr(journal,
+                             apr_psprintf(pool, "path %s\n", changed[i]));
+  svn_stringbuf_appendcstr(journal, "end\n");
+
+  return journal->data;
+}
+
+/* Walk the status of TARGET in the working copy of B like 'svn status'
+   does and return descriptions of the reported nodes in *STATUSES. */
+static svn_error_t *
+walk_status(apr_array_header_t **statuses,
+            svn_test__sandbox_t *b,
+            const char *target,
+            apr_pool_t *pool)
+{
+  *statuses = apr_array_make(pool, 16, sizeof(const char *));
+  return svn_error_trace(svn_wc_walk_status(b->wc_ctx,
+                                            sbox_wc_path(b, target),
+                                            svn_depth_infinity,
+                                            FALSE /* get_all */,
+                                            FALSE /* no_ignore */,
+                                            FALSE /* ignore_text_mods */,
+                                            NULL, record_status, *statuses,
+                                            NULL, NULL, pool));
+}
+
+/* Check that walking the status of TARGET in B gives the same result
+   with W answering RESPONSE as without a journal. */
+static svn_error_t *
+check_journal_walk(svn_test__sandbox_t *b,
+                   fake_watcher_t *w,
+                   const char *target,
+                   const char *response,
+                   apr_pool_t *pool)
+{
+  apr_array_header_t *expected, *actual;
+  int i;
+
+  fake_watcher_respond(w, NULL);
+  SVN_ERR(walk_status(&expected, b, target, pool));
+
+  fake_watcher_respond(w, response);
+  SVN_ERR(walk_status(&actual, b, target, pool));
+
+  SVN_TEST_INT_ASSERT(actual->nelts, expected->nelts);
+  for (i = 0; i < expected->nelts; i++)
+    SVN_TEST_STRING_ASSERT(APR_ARRAY_IDX(actual, i, const char *),
+                           APR_ARRAY_IDX(expected, i, const char *));
+
+  return SVN_NO_ERROR;
+}
+
+/* Return the path of NAME in the administrative directory of B. */
+static const char *
+adm_path(svn_test__sandbox_t *b,
+         const char *name,
+         apr_pool_t *pool)
+{
+  return svn_dirent_join_many(pool, b->wc_abspath, svn_wc_get_adm_dir(pool),
+                              name, SVN_VA_NULL);
+}
+
+/* Return whether STATUSES mention LOCAL_ABSPATH. */
+static svn_boolean_t
+status_reported(const apr_array_header_t *statuses,
+                const char *local_abspath)
+{
+  int i;
+
+  for (i = 0; i < statuses->nelts; i++)
+    {
+      const char *status = APR_ARRAY_IDX(statuses, i, const char *);
+
+      if (strncmp(status, local_abspath, strlen(local_abspath)) == 0
+          && status[strlen(local_abspath)] == ' ')
+        return TRUE;
+    }
+
+  return FALSE;
+}
+#endif
+
+static svn_error_t *
+test_watcher_status(const svn_test_opts_t *opts, apr_pool_t *pool)
+{
+#if !defined(WIN32) && APR_HAS_THREADS
+  static const char *const nothing[] = { NULL };
+  static const char *const changes[] = { "A/mu", "A/C/new", "A/D/H/chi",
+                                         "A/B/F", "A/B/F2", "A/D/G/new",
+                                         NULL };
+  svn_test__sandbox_t b;
+  fake_watcher_t *w;
+  const char *journal;
+  svn_node_kind_t kind;
+
+  SVN_ERR(svn_test__sandbox_create(&b, "watcher", opts, pool));
+  SVN_ERR(sbox_add_and_commit_greek_tree(&b));
+  SVN_ERR(fake_watcher_start(&w, adm_path(&b, SVN_WC__WATCHER_SOCKET, pool),
+                             pool));
+
+  /* The first walk stores the baseline. */
+  SVN_ERR(check_journal_walk(&b, w, "", make_journal(pool, "s1", nothing),
+                             pool));
+  SVN_ERR(svn_io_check_path(adm_path(&b, SVN_WC__ADM_WATCHER_BASELINE,
+                                      pool),
+                             &kind, pool));
+  SVN_TEST_ASSERT(kind == svn_node_file);
+
+  /* A modification, an addition, a deletion, a directory renamed on disk
+     and an unversioned file. */
+  SVN_ERR(sbox_file_write(&b, "A/mu", "modified mu"));
+  SVN_ERR(sbox_file_write(&b, "A/C/new", "new file"));
+  SVN_ERR(sbox_wc_add(&b, "A/C/new"));
+  SVN_ERR(sbox_wc_delete(&b, "A/D/H/chi"));
+  SVN_ERR(svn_io_file_rename2(sbox_wc_path(&b, "A/B/F"),
+                              sbox_wc_path(&b, "A/B/F2"), FALSE, pool));
+  SVN_ERR(sbox_file_write(&b, "A/D/G/new", "unversioned"));
+
+  journal = make_journal(pool, "s1", changes);
+  SVN_ERR(check_journal_walk(&b, w, "", journal, pool));
+  SVN_ERR(check_journal_walk(&b, w, "A/D", journal, pool));
+
+  /* While the watcher's queue overflowed, it only sends the greeting. */
+  SVN_ERR(sbox_file_write(&b, "A/D/G/rho", "modified rho"));
+  SVN_ERR(check_journal_walk(&b, w, "", SVN_WC__WATCHER_GREETING "\n",
+                             pool));
+
+  /* A new session needs a new baseline, which then covers rho. */
+  journal = make_journal(pool, "s2", nothing);
+  SVN_ERR(check_journal_walk(&b, w, "", journal, pool));
+  SVN_ERR(check_journal_walk(&b, w, "", journal, pool));
+
+  return SVN_NO_ERROR;
+#else
+  return svn_error_create(SVN_ERR_TEST_SKIPPED, NULL,
+                          "svn-wc-watcher is not supported here");
+#endif
+}
+
+static svn_error_t *
+test_watcher_untrusted_socket(const svn_test_opts_t *opts, apr_pool_t *pool)
+{
+#if !defined(WIN32) && APR_HAS_THREADS
+  static const char *const nothing[] = { NULL };
+  svn_test__sandbox_t b;
+  apr_pool_t *watcher_pool = svn_pool_create(pool);
+  fake_watcher_t *w;
+  const char *socket_abspath;
+  const char *link_path;
+  apr_array_header_t *statuses;
+
+  SVN_ERR(svn_test__sandbox_create(&b, "watcher-link", opts, pool));
+  SVN_ERR(sbox_add_and_commit_greek_tree(&b));
+  socket_abspath = adm_path(&b, SVN_WC__WATCHER_SOCKET, pool);
+
+  /* A trusted watcher's journal decides what gets looked at, even if it
+     misses a change. */
+  SVN_ERR(fake_watcher_start(&w, socket_abspath, watcher_pool));
+  fake_watcher_respond(w, make_journal(pool, "s1", nothing));
+  SVN_ERR(walk_status(&statuses, &b, "", pool));
+  SVN_ERR(sbox_file_write(&b, "A/mu", "modified mu"));
+  SVN_ERR(walk_status(&statuses, &b, "", pool));
+  SVN_TEST_ASSERT(!status_reported(statuses, sbox_wc_path(&b, "A/mu")));
+  svn_pool_clear(watcher_pool);
+
+  /* Serve the same journal through a link that anybody could have
+     placed there.  It must be ignored. */
+  SVN_ERR(fake_watcher_start(&w, adm_path(&b, "w.sock", watcher_pool),
+                             watcher_pool));
+  fake_watcher_respond(w, make_journal(pool, "s1", nothing));
+  SVN_ERR(svn_utf_cstring_from_utf8(&link_path,
+                                    svn_dirent_local_style(socket_abspath,
+                                                           pool),
+                                    pool));
+  SVN_TEST_ASSERT(symlink("w.sock", link_path) == 0);
+
+  SVN_ERR(walk_status(&statuses, &b, "", pool));
+  SVN_TEST_ASSERT(status_reported(statuses, sbox_wc_path(&b, "A/mu")));
+
+  svn_pool_destroy(watcher_pool);
+  SVN_ERR(svn_io_remove_file2(socket_abspath, FALSE, pool));
+
+  return SVN_NO_ERROR;
+#else
+  return svn_error_create(SVN_ERR_TEST_SKIPPED, NULL,
+                          "svn-wc-watcher is not supported here");
+#endif
+}
+
+static svn_error_t *
+test_files_modified(const svn_test_opts_t *opts, apr_pool_t *pool)
+{
+  svn_test__sandbox_t b;
+  svn_config_t *config;
+  svn_wc_context_t *wc_ctx;
+  apr_array_header_t *paths;
+  apr_hash_t *modified;
+  apr_time_t time;
+  apr_time_t recorded_time;
+  static const char *const touched[] = { "iota", "A/mu", "A/B/E/beta" };
+  const int touched_count = sizeof(touched) / sizeof(touched[0]);
+  int i;
+
+  SVN_ERR(svn_test__sandbox_create(&b, "files_modified", opts, pool));
+  SVN_ERR(sbox_add_and_commit_greek_tree(&b));
+
+  /* Files that only got touched, a modification of the same size, one
+     with a different size and an untouched file. */
+  SVN_ERR(svn_io_file_affected_time(&time, sbox_wc_path(&b, "iota"), pool));
+  for (i = 0; i < touched_count; i++)
+    SVN_ERR(svn_io_set_file_affected_time(time + apr_time_from_sec(1),
+                                          sbox_wc_path(&b, touched[i]),
+                                          pool));
+  SVN_ERR(sbox_file_write(&b, "A/B/lambda", "This is the file 'LAMBDA'.\n"));
+  SVN_ERR(sbox_file_write(&b, "A/D/gamma", "modified gamma"));
+
+  paths = apr_array_make(pool, 6, sizeof(const char *));
+  for (i = 0; i < touched_count; i++)
+    APR_ARRAY_PUSH(paths, const char *) = sbox_wc_path(&b, touched[i]);
+  APR_ARRAY_PUSH(paths, const char *) = sbox_wc_path(&b, "A/B/lambda");
+  APR_ARRAY_PUSH(paths, const char *) = sbox_wc_path(&b, "A/D/gamma");
+  APR_ARRAY_PUSH(paths, const char *) = sbox_wc_path(&b, "A/B/E/alpha");
+
+  SVN_ERR(svn_config_create2(&config, FALSE, FALSE, pool));
+  svn_config_set(config, SVN_CONFIG_SECTION_WORKING_COPY,
+                 SVN_CONFIG_OPTION_STATUS_THREADS, "4");
+  SVN_ERR(svn_wc_context_create(&wc_ctx, config, pool, pool));
+  SVN_ERR(svn_wc__db_wclock_obtain(wc_ctx->db, b.wc_abspath, -1, FALSE,
+                                   pool));
+
+  SVN_ERR(svn_wc__internal_files_modified_p(&modified, wc_ctx->db, paths,
+                                            NULL, NULL, pool, pool));
+  SVN_TEST_INT_ASSERT(apr_hash_count(modified), paths->nelts);
+  for (i = 0; i < paths->nelts; i++)
+    {
+      const char *path = APR_ARRAY_IDX(paths, i, const char *);
+      svn_boolean_t *file_modified = svn_hash_gets(modified, path);
+      svn_boolean_t expected;
+
+      SVN_ERR(svn_wc__internal_file_modified_p(&expected, b.wc_ctx->db,
+                                               path, TRUE, pool));
+      SVN_TEST_ASSERT(file_modified && *file_modified == expected);
+    }
+  SVN_TEST_ASSERT(!*(svn_boolean_t *)svn_hash_gets(
+                     modified, sbox_wc_path(&b, "iota")));
+  SVN_TEST_ASSERT(*(svn_boolean_t *)svn_hash_gets(
+                    modified, sbox_wc_path(&b, "A/B/lambda")));
+
+  /* The timestamps of the touched files got repaired. */
+  for (i = 0; i < touched_count; i++)
+    {
+      SVN_ERR(svn_wc__db_read_info(NULL, NULL, NULL, NULL, NULL, NULL, NULL,
+                                   NULL, NULL, NULL, NULL, NULL, NULL, NULL,
+                                   NULL, NULL, NULL, NULL, &recorded_time,
+                                   NULL, NULL, NULL, NULL, NULL, NULL, NULL,
+                                   NULL, wc_ctx->db,
+                                   sbox_wc_path(&b, touched[i]),
+                                   pool, pool));
+      SVN_TEST_ASSERT(recorded_time == time + apr_time_from_sec(1));
+    }
+
+  SVN_ERR(svn_wc__db_wclock_release(wc_ctx->db, b.wc_abspath, pool));
+
+  return SVN_NO_ERROR;
+}
+
+/* Implements svn_cancel_func_t.  BATON points to the number of calls
+   that succeed before we report cancellation. */
+static svn_error_t *
+cancel_after(void *baton)
+{
+  int *remaining = baton;
+
+  if ((*remaining)-- <= 0)
+    return svn_error_create(SVN_ERR_CANCELLED, NULL, NULL);
+
+  return SVN_NO_ERROR;
+}
+
+static svn_error_t *
+test_files_modified_cancel(const svn_test_opts_t *opts, apr_pool_t *pool)
+{
+  svn_test__sandbox_t b;
+  svn_config_t *config;
+  svn_wc_context_t *wc_ctx;
+  apr_array_header_t *paths;
+  apr_hash_t *modified;
+  apr_time_t time;
+  svn_error_t *err;
+  static const char *const touched[] = { "iota", "A/mu" };
+  const int touched_count = sizeof(touched) / sizeof(touched[0]);
+  int remaining;
+  int i;
+
+  SVN_ERR(svn_test__sandbox_create(&b, "files_modified_cancel", opts,
+                                   pool));
+  SVN_ERR(sbox_add_and_commit_greek_tree(&b));
+
+  /* Touched files need to be compared with their pristines.  Without the
+     pristines, each comparison fails. */
+  SVN_ERR(svn_io_file_affected_time(&time, sbox_wc_path(&b, "iota"), pool));
+  paths = apr_array_make(pool, touched_count, sizeof(const char *));
+  for (i = 0; i < touched_count; i++)
+    {
+      const char *path = sbox_wc_path(&b, touched[i]);
+
+      SVN_ERR(svn_io_set_file_affected_time(time + apr_time_from_sec(1),
+                                            path, pool));
+      APR_ARRAY_PUSH(paths, const char *) = path;
+    }
+  SVN_ERR(svn_io_remove_dir2(svn_dirent_join_many(pool, b.wc_abspath,
+                                                  SVN_WC_ADM_DIR_NAME,
+                                                  "pristine",
+                                                  SVN_VA_NULL),
+                             FALSE, NULL, NULL, pool));
+
+  /* Compare in this thread only, so that the first file has been
+     compared when we cancel. */
+  SVN_ERR(svn_config_create2(&config, FALSE, FALSE, pool));
+  svn_config_set(config, SVN_CONFIG_SECTION_WORKING_COPY,
+                 SVN_CONFIG_OPTION_STATUS_THREADS, "1");
+  SVN_ERR(svn_wc_context_create(&wc_ctx, config, pool, pool));
+
+  /* One check per file while reading the DB and one after the first
+     comparison.  The failed comparison must not leak its error. */
+  remaining = touched_count;
+  err = svn_wc__internal_files_modified_p(&modified, wc_ctx->db, paths,
+                                          cancel_after, &remaining,
+                                          pool, pool);
+  SVN_TEST_ASSERT_ERROR(err, SVN_ERR_CANCELLED);
+
+  return SVN_NO_ERROR;
+}
+
+static svn_error_t *
+test_parallel_file_installs(const svn_test_opts_t *opts, apr_pool_t *pool)
+{
+  svn_test__sandbox_t b;
+  svn_config_t *config;
+  svn_wc_context_t *wc_ctx;
+  svn_skel_t *work_items = NULL;
+  svn_skel_t *work_item;
+  svn_stringbuf_t *contents;
+  svn_node_kind_t kind;
+  static const char *const files[] = {
+    "iota", "A/B/lambda", "A/B/E/alpha", "A/B/E/beta", "A/D/gamma",
+    "A/D/G/pi", "A/D/G/rho", "A/D/G/tau", "A/D/H/chi", "A/D/H/psi",
+    "A/D/H/omega"
+  };
+  const int file_count = sizeof(files) / sizeof(files[0]);
+  int i;
+
+  SVN_ERR(svn_test__sandbox_create(&b, "parallel_file_installs", opts,
+                                   pool));
+  SVN_ERR(sbox_add_and_commit_greek_tree(&b));
+
+  SVN_ERR(svn_config_create2(&config, FALSE, FALSE, pool));
+  svn_config_set(config, SVN_CONFIG_SECTION_WORKING_COPY,
+                 SVN_CONFIG_OPTION_INSTALL_THREADS, "4");
+  SVN_ERR(svn_wc_context_create(&wc_ctx, config, pool, pool));
+  SVN_ERR(svn_wc__db_wclock_obtain(wc_ctx->db, b.wc_abspath, -1, FALSE,
+                                   pool));
+
+  /* Reinstall all files but A/mu from the pristine store. */
+  for (i = 0; i < file_count; i++)
+    {
+      SVN_ERR(svn_io_remove_file2(sbox_wc_path(&b, files[i]), FALSE, pool));
+      SVN_ERR(svn_wc__wq_build_file_install(&work_item, wc_ctx->db,
+                                            sbox_wc_path(&b, files[i]),
+                                            NULL, FALSE, TRUE, pool, pool));
+      work_items = svn_wc__wq_merge(work_items, work_item, pool);
+    }
+
+  /* Install A/mu from another file and remove that file afterwards, which
+     must not happen in parallel.  Remove an unrelated file as well. */
+  SVN_ERR(sbox_file_write(&b, "A/mu.new", "new mu\n"));
+  SVN_ERR(svn_wc__wq_build_file_install(&work_item, wc_ctx->db,
+                                        sbox_wc_path(&b, "A/mu"),
+                                        sbox_wc_path(&b, "A/mu.new"),
+                                        FALSE, FALSE, pool, pool));
+  work_items = svn_wc__wq_merge(work_items, work_item, pool);
+  SVN_ERR(svn_wc__wq_build_file_remove(&work_item, wc_ctx->db, b.wc_abspath,
+                                       sbox_wc_path(&b, "A/mu.new"),
+                                       pool, pool));
+  work_items = svn_wc__wq_merge(work_items, work_item, pool);
+  SVN_ERR(sbox_file_write(&b, "A/C/junk", "junk\n"));
+  SVN_ERR(svn_wc__wq_build_file_remove(&work_item, wc_ctx->db, b.wc_abspath,
+                                       sbox_wc_path(&b, "A/C/junk"),
+                                       pool, pool));
+  work_items = svn_wc__wq_merge(work_items, work_item, pool);
+
+  SVN_ERR(svn_wc__db_wq_add(wc_ctx->db, b.wc_abspath, work_items, pool));
+  SVN_ERR(svn_wc__wq_run(wc_ctx->db, b.wc_abspath, NULL, NULL, pool));
+
+  for (i = 0; i < file_count; i++)
+    {
+      const char *path = sbox_wc_path(&b, files[i]);
+      svn_boolean_t modified;
+      svn_filesize_t recorded_size;
+      apr_finfo_t finfo;
+
+      SVN_ERR(svn_wc__internal_file_modified_p(&modified, wc_ctx->db, path,
+                                               TRUE, pool));
+      SVN_TEST_ASSERT(!modified);
+
+      /* The installs recorded the new sizes and timestamps. */
+      SVN_ERR(svn_wc__db_read_info(NULL, NULL, NULL, NULL, NULL, NULL, NULL,
+                                   NULL, NULL, NULL, NULL, NULL, NULL, NULL,
+                                   NULL, NULL, NULL, &recorded_size, NULL,
+                                   NULL, NULL, NULL, NULL, NULL, NULL, NULL,
+                                   NULL, wc_ctx->db, path, pool, pool));
+      SVN_ERR(svn_io_stat(&finfo, path, APR_FINFO_SIZE, pool));
+      SVN_TEST_ASSERT(recorded_size == finfo.size);
+    }
+
+  SVN_ERR(svn_stringbuf_from_file2(&contents, sbox_wc_path(&b, "A/mu"),
+                                   pool));
+  SVN_TEST_STRING_ASSERT(contents->data, "new mu\n");
+  SVN_ERR(svn_io_check_path(sbox_wc_path(&b, "A/mu.new"), &kind, pool));
+  SVN_TEST_ASSERT(kind == svn_node_none);
+  SVN_ERR(svn_io_check_path(sbox_wc_path(&b, "A/C/junk"), &kind, pool));
+  SVN_TEST_ASSERT(kind == svn_node_none);
+
+  SVN_ERR(svn_wc__db_wclock_release(wc_ctx->db, b.wc_abspath, pool));
+
+  return SVN_NO_ERROR;
+}
+
 /* ---------------------------------------------------------------------- */
 /* The list of test functions */
 
@@ -515,6 +1215,20 @@ static struct svn_test_descriptor_t test_funcs[] =
                        "test legacy commit2"),
     SVN_TEST_OPTS_PASS(test_internal_file_modified,
                        "test internal_file_modified"),
+    SVN_TEST_OPTS_PASS(test_parallel_status,
+                       "test status walk with multiple threads"),
+    SVN_TEST_OPTS_PASS(test_status_candidates,
+                       "test svn_wc__db_read_status_candidates"),
+    SVN_TEST_OPTS_PASS(test_watcher_status,
+                       "test status walks driven by svn-wc-watcher"),
+    SVN_TEST_OPTS_PASS(test_watcher_untrusted_socket,
+                       "test ignoring an untrusted watcher socket"),
+    SVN_TEST_OPTS_PASS(test_files_modified,
+                       "test svn_wc__internal_files_modified_p"),
+    SVN_TEST_OPTS_PASS(test_files_modified_cancel,
+                       "test cancelling svn_wc__internal_files_modified_p"),
+    SVN_TEST_OPTS_PASS(test_parallel_file_installs,
+                       "test running file installs in parallel"),
     SVN_TEST_NULL
   };
 
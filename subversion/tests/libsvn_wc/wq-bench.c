@@ -0,0 +1,428 @@
+/* wq-bench.c -- measure how fast the work queue installs files
+ *
+ * ====================================================================
+ *    Licensed to the Apache Software Foundation (ASF) under one
+ *    or more contributor license agreements.  See the NOTICE file
+ *    distributed with this work for additional information
+ *    regarding copyright ownership.  The ASF licenses this file
+ *    to you under the Apache License, Version 2.0 (the
+ *    "License"); you may not use this file except in compliance
+ *    with the License.  You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *    Unless required by applicable law or agreed to in writing,
+ *    software distributed under the License is distributed on an
+ *    "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+ *    KIND, either express or implied.  See the License for the
+ *    specific language governing permissions and limitations
+ *    under the License.
+ * ====================================================================
+ */
+
+/* This is not a unit test.  It creates a working copy in the system's
+ * temporary directory, adds BASE nodes for a few thousand files to it,
+ * as a checkout would, and reports how many files per second
+ * svn_wc__wq_run() installs from the pristine store for different
+ * values of the "install-threads" option.  A quarter of the files have
+ * svn:eol-style set, so they get translated on the way.  All data is
+ * generated from a fixed seed, so the numbers are comparable between
+ * runs.
+ */
+
+#define APR_WANT_STDIO
+#include <apr_want.h>
+
+#include <apr_general.h>
+#include <apr_strings.h>
+#include <apr_time.h>
+
+#include "svn_config.h"
+#include "svn_ctype.h"
+#include "svn_dirent_uri.h"
+#include "svn_error.h"
+#include "svn_hash.h"
+#include "svn_io.h"
+#include "svn_pools.h"
+#include "svn_props.h"
+#include "svn_string.h"
+#include "svn_wc.h"
+
+#include "../../libsvn_wc/wc.h"
+#include "../../libsvn_wc/wc_db.h"
+#include "../../libsvn_wc/workqueue.h"
+
+/* Default number of files to install. */
+#define DEFAULT_FILES 20000
+
+/* Number of files per directory. */
+#define FILES_PER_DIR 100
+
+/* Number of distinct file contents in the pristine store. */
+#define PRISTINE_COUNT 16
+
+/* Number of times we run each measurement.  We report the best run to
+ * filter out noise. */
+#define DEFAULT_REPEAT 3
+
+/* The repository that the working copy pretends to be a checkout of. */
+#define REPOS_ROOT_URL "file:///wq-bench"
+#define REPOS_UUID "00000000-0000-0000-0000-000000000000"
+
+/* Simple linear congruential pseudo-random number generator.
+ * Update *SEED and return the next pseudo-random number. */
+static apr_uint32_t
+next_rand(apr_uint32_t *seed)
+{
+  *seed = *seed * 1103515245 + 12345;
+  return *seed >> 8;
+}
+
+/* Return a text of about SIZE bytes in lines of words, like source code.
+ * Use SEED for the pseudo-random numbers and allocate the result in
+ * POOL. */
+static svn_stringbuf_t *
+make_text(apr_size_t size,
+          apr_uint32_t *seed,
+          apr_pool_t *pool)
+{
+  static const char *const words[] = {
+    "if", "else", "return", "static", "const", "char", "int", "for",
+    "while", "struct", "svn_error_t", "apr_pool_t", "pool", "err", "i",
+    "NULL", "TRUE", "FALSE", "SVN_ERR", "(", ")", "{", "}", ";", "=="
+  };
+  svn_stringbuf_t *text = svn_stringbuf_create_ensure(size + 80, pool);
+
+  while (text->len < size)
+    {
+      int count = next_rand(seed) % 10 + 1;
+      int i;
+
+      for (i = 0; i < count; ++i)
+        {
+          svn_stringbuf_appendcstr(text, words[next_rand(seed)
+                                               % (sizeof(words)
+                                                  / sizeof(words[0]))]);
+          svn_stringbuf_appendbyte(text, ' ');
+        }
+      svn_stringbuf_appendbyte(text, '\n');
+    }
+
+  return text;
+}
+
+/* Create a working copy at WC_ABSPATH using WC_CTX and add FILE_COUNT
+ * files to its BASE tree, spread over directories of FILES_PER_DIR files.
+ * Return the directories in *DIRS and the files in *FILES, both as
+ * const char * absolute paths allocated in RESULT_POOL.  Use
+ * SCRATCH_POOL for temporary allocations. */
+static svn_error_t *
+create_wc(apr_array_header_t **dirs,
+          apr_array_header_t **files,
+          svn_wc_context_t *wc_ctx,
+          const char *wc_abspath,
+          int file_count,
+          apr_pool_t *result_pool,
+          apr_pool_t *scratch_pool)
+{
+  svn_wc__db_t *db = wc_ctx->db;
+  const svn_checksum_t *checksums[PRISTINE_COUNT];
+  apr_hash_t *no_props = apr_hash_make(scratch_pool);
+  apr_hash_t *eol_props = apr_hash_make(scratch_pool);
+  apr_array_header_t *no_children = apr_array_make(scratch_pool, 0,
+                                                   sizeof(const char *));
+  apr_pool_t *iterpool = svn_pool_create(scratch_pool);
+  apr_uint32_t seed = 0x5eed;
+  const char *dir_abspath = NULL;
+  const char *dir_relpath = NULL;
+  int i;
+
+  svn_hash_sets(eol_props, SVN_PROP_EOL_STYLE,
+                svn_string_create("native", scratch_pool));
+
+  SVN_ERR(svn_wc_ensure_adm4(wc_ctx, wc_abspath,
+                             REPOS_ROOT_URL, REPOS_ROOT_URL, REPOS_UUID,
+                             1, svn_depth_infinity, scratch_pool));
+
+  /* Texts of 1 to 32 kB. */
+  for (i = 0; i < PRISTINE_COUNT; ++i)
+    {
+      svn_stream_t *stream;
+      svn_wc__db_install_data_t *install_data;
+      svn_checksum_t *sha1_checksum;
+      svn_checksum_t *md5_checksum;
+      svn_stringbuf_t *text;
+
+      svn_pool_clear(iterpool);
+      text = make_text(1024 << (i % 6), &seed, iterpool);
+      SVN_ERR(svn_wc__db_pristine_prepare_install(&stream, &install_data,
+                                                  &sha1_checksum,
+                                                  &md5_checksum,
+                                                  db, wc_abspath,
+                                                  scratch_pool, iterpool));
+      SVN_ERR(svn_stream_write(stream, text->data, &text->len));
+      SVN_ERR(svn_stream_close(stream));
+      SVN_ERR(svn_wc__db_pristine_install(install_data, sha1_checksum,
+                                          md5_checksum, iterpool));
+      checksums[i] = sha1_checksum;
+    }
+
+  *dirs = apr_array_make(result_pool, file_count / FILES_PER_DIR + 1,
+                         sizeof(const char *));
+  *files = apr_array_make(result_pool, file_count, sizeof(const char *));
+
+  for (i = 0; i < file_count; ++i)
+    {
+      const char *name;
+      const char *file_abspath;
+
+      svn_pool_clear(iterpool);
+
+      if (i % FILES_PER_DIR == 0)
+        {
+          dir_relpath = apr_psprintf(result_pool, "d%04d",
+                                     i / FILES_PER_DIR);
+          dir_abspath = svn_dirent_join(wc_abspath, dir_relpath,
+                                        result_pool);
+          SVN_ERR(svn_wc__db_base_add_directory(db, dir_abspath, wc_abspath,
+                                                dir_relpath, REPOS_ROOT_URL,
+                                                REPOS_UUID, 1, no_props, 1,
+                                                0, "bench", no_children,
+                                                svn_depth_infinity, NULL,
+                                                FALSE, NULL, NULL, NULL,
+                                                NULL, iterpool));
+          APR_ARRAY_PUSH(*dirs, const char *) = dir_abspath;
+        }
+
+      name = apr_psprintf(iterpool, "f%05d.c", i);
+      file_abspath = svn_dirent_join(dir_abspath, name, result_pool);
+      SVN_ERR(svn_wc__db_base_add_file(db, file_abspath, wc_abspath,
+                                       svn_relpath_join(dir_relpath, name,
+                                                        iterpool),
+                                       REPOS_ROOT_URL, REPOS_UUID, 1,
+                                       (i % 4) ? no_props : eol_props,
+                                       1, 0, "bench",
+                                       checksums[next_rand(&seed)
+                                                 % PRISTINE_COUNT],
+                                       NULL, FALSE, FALSE, NULL, NULL,
+                                       FALSE, FALSE, NULL, NULL,
+                                       iterpool));
+      APR_ARRAY_PUSH(*files, const char *) = file_abspath;
+    }
+
+  svn_pool_destroy(iterpool);
+
+  return SVN_NO_ERROR;
+}
+
+/* Remove the directories DIRS of the working copy at WC_ABSPATH from disk,
+ * recreate them empty and queue file install work items for all FILES
+ * (const char * absolute paths) in the working copy's work queue, using
+ * DB.  Use SCRATCH_POOL for temporary allocations. */
+static svn_error_t *
+queue_installs(svn_wc__db_t *db,
+               const char *wc_abspath,
+               const apr_array_header_t *dirs,
+               const apr_array_header_t *files,
+               apr_pool_t *scratch_pool)
+{
+  apr_pool_t *iterpool = svn_pool_create(scratch_pool);
+  int i;
+
+  for (i = 0; i < dirs->nelts; ++i)
+    {
+      const char *dir_abspath = APR_ARRAY_IDX(dirs, i, const char *);
+
+      svn_pool_clear(iterpool);
+      SVN_ERR(svn_io_remove_dir2(dir_abspath, TRUE, NULL, NULL, iterpool));
+      SVN_ERR(svn_io_dir_make(dir_abspath, APR_OS_DEFAULT, iterpool));
+    }
+
+  /* Queue the items of one directory at a time, as an update would. */
+  for (i = 0; i < files->nelts; i += FILES_PER_DIR)
+    {
+      svn_skel_t *work_items = NULL;
+      int k;
+
+      svn_pool_clear(iterpool);
+      for (k = i; k < files->nelts && k < i + FILES_PER_DIR; ++k)
+        {
+          svn_skel_t *work_item;
+
+          SVN_ERR(svn_wc__wq_build_file_install(&work_item, db,
+                                                APR_ARRAY_IDX(files, k,
+                                                              const char *),
+                                                NULL, FALSE, TRUE,
+                                                iterpool, iterpool));
+          work_items = svn_wc__wq_merge(work_items, work_item, iterpool);
+        }
+
+      SVN_ERR(svn_wc__db_wq_add(db, wc_abspath, work_items, iterpool));
+    }
+
+  svn_pool_destroy(iterpool);
+
+  return SVN_NO_ERROR;
+}
+
+/* Install all FILES in the working copy at WC_ABSPATH with DIRS REPEAT
+ * times, using THREADS install threads, and print the best result to
+ * stdout.  Use POOL for temporary allocations. */
+static svn_error_t *
+bench_installs(const char *wc_abspath,
+               const apr_array_header_t *dirs,
+               const apr_array_header_t *files,
+               int threads,
+               int repeat,
+               apr_pool_t *pool)
+{
+  apr_pool_t *iterpool = svn_pool_create(pool);
+  svn_config_t *config;
+  svn_wc_context_t *wc_ctx;
+  apr_interval_time_t best = 0;
+  int i;
+
+  SVN_ERR(svn_config_create2(&config, FALSE, FALSE, pool));
+  svn_config_set(config, SVN_CONFIG_SECTION_WORKING_COPY,
+                 SVN_CONFIG_OPTION_INSTALL_THREADS,
+                 apr_itoa(pool, threads));
+  SVN_ERR(svn_wc_context_create(&wc_ctx, config, pool, pool));
+
+  for (i = 0; i < repeat; ++i)
+    {
+      apr_time_t start;
+      apr_interval_time_t duration;
+
+      svn_pool_clear(iterpool);
+      SVN_ERR(queue_installs(wc_ctx->db, wc_abspath, dirs, files, iterpool));
+
+      start = apr_time_now();
+      SVN_ERR(svn_wc__wq_run(wc_ctx->db, wc_abspath, NULL, NULL, iterpool));
+      duration = apr_time_now() - start;
+
+      if (i == 0 || duration < best)
+        best = duration;
+    }
+
+  /* Avoid division by zero for tiny inputs. */
+  if (best == 0)
+    best = 1;
+
+  printf("%3d thread(s) %9d files %12.0f installs/s\n",
+         threads, files->nelts,
+         files->nelts / (double)best * APR_USEC_PER_SEC);
+
+  SVN_ERR(svn_wc_context_destroy(wc_ctx));
+  svn_pool_destroy(iterpool);
+
+  return SVN_NO_ERROR;
+}
+
+/* Create a working copy with FILE_COUNT files in the temporary directory
+ * and measure the install throughput for each of the THREADS (int).
+ * Run each measurement REPEAT times.  Print the results to stdout and
+ * remove the working copy afterwards.  Use POOL for temporary
+ * allocations. */
+static svn_error_t *
+bench_wq(int file_count,
+         const apr_array_header_t *threads,
+         int repeat,
+         apr_pool_t *pool)
+{
+  svn_wc_context_t *wc_ctx;
+  const char *temp_dir;
+  const char *wc_name;
+  const char *wc_abspath;
+  apr_array_header_t *dirs;
+  apr_array_header_t *files;
+  apr_time_t start;
+  svn_error_t *err = SVN_NO_ERROR;
+  int i;
+
+  SVN_ERR(svn_io_temp_dir(&temp_dir, pool));
+  wc_name = apr_psprintf(pool, "wq-bench-%" APR_TIME_T_FMT, apr_time_now());
+  SVN_ERR(svn_dirent_get_absolute(&wc_abspath,
+                                  svn_dirent_join(temp_dir, wc_name, pool),
+                                  pool));
+
+  start = apr_time_now();
+  SVN_ERR(svn_wc_context_create(&wc_ctx, NULL, pool, pool));
+  SVN_ERR(create_wc(&dirs, &files, wc_ctx, wc_abspath, file_count,
+                    pool, pool));
+  SVN_ERR(svn_wc_context_destroy(wc_ctx));
+  printf("created a working copy with %d files in %d directories "
+         "in %.3f s\n\n",
+         files->nelts, dirs->nelts,
+         (double)(apr_time_now() - start) / APR_USEC_PER_SEC);
+
+  for (i = 0; i < threads->nelts && !err; ++i)
+    err = bench_installs(wc_abspath, dirs, files,
+                         APR_ARRAY_IDX(threads, i, int), repeat, pool);
+
+  return svn_error_compose_create(err,
+                                  svn_io_remove_dir2(wc_abspath, FALSE,
+                                                     NULL, NULL, pool));
+}
+
+int
+main(int argc, char **argv)
+{
+  apr_pool_t *pool;
+  apr_array_header_t *threads;
+  int file_count = DEFAULT_FILES;
+  int repeat = DEFAULT_REPEAT;
+  svn_error_t *err;
+
+  while (argc > 1)
+    {
+      const char *const arg = argv[1];
+      if (arg[0] != '-')
+        break;
+
+      if (svn_ctype_isdigit(arg[1]))
+        repeat = atoi(arg + 1);
+      else
+        break;
+      --argc; ++argv;
+    }
+
+  if ((argc > 1 && argv[1][0] == '-') || repeat <= 0)
+    {
+      fprintf(stderr,
+              "Usage: wq-bench [-<repeat>] [FILES [THREADS...]]\n");
+      exit(1);
+    }
+
+  apr_initialize();
+  pool = svn_pool_create(NULL);
+
+  threads = apr_array_make(pool, 4, sizeof(int));
+  if (argc > 1)
+    {
+      file_count = atoi(argv[1]);
+      for (argc -= 2, argv += 2; argc > 0; --argc, ++argv)
+        APR_ARRAY_PUSH(threads, int) = atoi(argv[0]);
+    }
+
+  if (threads->nelts == 0)
+    {
+      APR_ARRAY_PUSH(threads, int) = 1;
+      APR_ARRAY_PUSH(threads, int) = 2;
+      APR_ARRAY_PUSH(threads, int) = 4;
+      APR_ARRAY_PUSH(threads, int) = 8;
+    }
+
+  if (file_count <= 0)
+    {
+      fprintf(stderr, "wq-bench: FILES must be positive\n");
+      exit(1);
+    }
+
+  err = bench_wq(file_count, threads, repeat, pool);
+  if (err)
+    svn_handle_error2(err, stderr, TRUE, "wq-bench: ");
+
+  svn_pool_destroy(pool);
+  apr_terminate();
+  exit(0);
+}
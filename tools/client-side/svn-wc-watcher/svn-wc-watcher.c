@@ -0,0 +1,711 @@
+/*
+ * svn-wc-watcher.c :  record the paths that change in a working copy
+ *
+ * ====================================================================
+ *    Licensed to the Apache Software Foundation (ASF) under one
+ *    or more contributor license agreements.  See the NOTICE file
+ *    distributed with this work for additional information
+ *    regarding copyright ownership.  The ASF licenses this file
+ *    to you under the Apache License, Version 2.0 (the
+ *    "License"); you may not use this file except in compliance
+ *    with the License.  You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *    Unless required by applicable law or agreed to in writing,
+ *    software distributed under the License is distributed on an
+ *    "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+ *    KIND, either express or implied.  See the License for the
+ *    specific language governing permissions and limitations
+ *    under the License.
+ * ====================================================================
+ */
+
+#include <stdio.h>
+#include <string.h>
+
+#include <apr_hash.h>
+#include <apr_strings.h>
+#include <apr_time.h>
+
+#ifdef __linux__
+#include <dirent.h>
+#include <errno.h>
+#include <poll.h>
+#include <sys/inotify.h>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <sys/time.h>
+#include <sys/un.h>
+#include <unistd.h>
+#endif
+
+#include "svn_cmdline.h"
+#include "svn_dirent_uri.h"
+#include "svn_error.h"
+#include "svn_hash.h"
+#include "svn_io.h"
+#include "svn_pools.h"
+#include "svn_string.h"
+#include "svn_utf.h"
+#include "svn_wc.h"
+
+#include "private/svn_wc_private.h"
+
+#include "svn_private_config.h"
+
+/* Used to terminate lines in large multi-line string literals. */
+#define NL APR_EOL_STR
+
+static const char *usage_summary =
+  "Watch the working copy rooted at WCROOT and tell Subversion which paths"  NL
+  "changed, so that 'svn status', 'svn commit' and similar operations only"  NL
+  "need to look at those paths instead of scanning the whole working copy."  NL
+  ""                                                                         NL
+  "The watcher detaches from the terminal unless --foreground is given and"  NL
+  "runs until it gets stopped with --stop or the working copy disappears."   NL
+  "It needs one inotify watch per directory of the working copy."            NL;
+
+/* Print a usage message for this program (PROGNAME), possibly with an
+   error message ERR_MSG, if not NULL.  */
+static void
+usage_maybe_with_err(const char *progname, const char *err_msg)
+{
+  FILE *out;
+
+  out = err_msg ? stderr : stdout;
+  fprintf(out, "Usage: %s [--foreground] WCROOT\n"
+               "       %s --stop WCROOT\n\n%s",
+          progname, progname, usage_summary);
+  if (err_msg)
+    fprintf(out, "\nERROR: %s\n", err_msg);
+}
+
+#ifdef __linux__
+
+/* The events that may change the status of a node. */
+#define WATCH_MASK (IN_CREATE | IN_DELETE | IN_MODIFY | IN_ATTRIB       \
+                    | IN_MOVED_FROM | IN_MOVED_TO | IN_DELETE_SELF      \
+                    | IN_MOVE_SELF | IN_ONLYDIR | IN_DONT_FOLLOW        \
+                    | IN_EXCL_UNLINK)
+
+/* Start a new session once the journal gets longer than this.  The next
+   status walk will then scan the whole working copy again. */
+#define MAX_CHANGED_PATHS 100000
+
+/* Seconds to wait for a client. */
+#define CLIENT_TIMEOUT 2
+
+typedef struct watcher_t
+{
+  /* The working copy root in local style and encoding. */
+  const char *root;
+
+  int inotify_fd;
+  int listen_fd;
+
+  /* Contains everything that belongs to the current session. */
+  apr_pool_t *session_pool;
+  const char *session;
+  unsigned int session_count;
+
+  /* Maps int watch descriptors to the relpaths of the directories. */
+  apr_hash_t *watches;
+
+  /* The paths that changed in this session, as keys. */
+  apr_hash_t *changed;
+
+  /* Set if an event may have been lost, i.e. a new session is needed. */
+  svn_boolean_t overflow;
+
+  /* Set if some directory couldn't be watched. */
+  svn_boolean_t broken;
+
+  /* Set if the watcher should exit. */
+  svn_boolean_t done;
+} watcher_t;
+
+/* Return RELPATH, a relpath in local style and encoding, joined with
+   NAME.  Allocate the result in RESULT_POOL. */
+static const char *
+join_relpath(const char *relpath,
+             const char *name,
+             apr_pool_t *result_pool)
+{
+  if (*relpath)
+    return apr_pstrcat(result_pool, relpath, "/", name, SVN_VA_NULL);
+
+  return apr_pstrdup(result_pool, name);
+}
+
+/* Add RELPATH to the journal of W. */
+static void
+record_change(watcher_t *w,
+              const char *relpath)
+{
+  /* The protocol is line based.  Report a change of the parent instead,
+     which makes Subversion look at all of its children. */
+  if (strchr(relpath, '\n'))
+    {
+      const char *slash = strrchr(relpath, '/');
+
+      relpath = slash ? apr_pstrmemdup(w->session_pool, relpath,
+                                       slash - relpath)
+                      : "";
+    }
+
+  if (svn_hash_gets(w->changed, relpath))
+    return;
+
+  svn_hash_sets(w->changed, apr_pstrdup(w->session_pool, relpath), "");
+  if (apr_hash_count(w->changed) > MAX_CHANGED_PATHS)
+    w->overflow = TRUE;
+}
+
+/* Watch the directory RELPATH and all its subdirectories in W.  If RECORD
+   is set, record everything found below RELPATH as changed.  Use
+   SCRATCH_POOL for temporary allocations. */
+static void
+add_watches(watcher_t *w,
+            const char *relpath,
+            svn_boolean_t record,
+            apr_pool_t *scratch_pool)
+{
+  apr_array_header_t *stack = apr_array_make(scratch_pool, 16,
+                                             sizeof(const char *));
+
+  APR_ARRAY_PUSH(stack, const char *) = relpath;
+  while (stack->nelts)
+    {
+      const char *dir_relpath = *(const char **)apr_array_pop(stack);
+      const char *dir_path = *dir_relpath
+                               ? apr_pstrcat(scratch_pool, w->root, "/",
+                                             dir_relpath, SVN_VA_NULL)
+                               : w->root;
+      struct dirent *entry;
+      DIR *dir;
+      int wd;
+
+      wd = inotify_add_watch(w->inotify_fd, dir_path, WATCH_MASK);
+      if (wd < 0)
+        {
+          /* Vanished directories are already in the journal. */
+          if (errno != ENOENT && errno != ENOTDIR)
+            w->broken = TRUE;
+          continue;
+        }
+
+      /* Adding a watch for a moved directory returns its old descriptor. */
+      apr_hash_set(w->watches, apr_pmemdup(w->session_pool, &wd, sizeof(wd)),
+                   sizeof(wd), apr_pstrdup(w->session_pool, dir_relpath));
+
+      dir = opendir(dir_path);
+      if (!dir)
+        {
+          if (errno != ENOENT && errno != ENOTDIR)
+            w->broken = TRUE;
+          continue;
+        }
+
+      while ((entry = readdir(dir)) != NULL)
+        {
+          const char *child_relpath;
+          svn_boolean_t is_dir;
+
+          if (strcmp(entry->d_name, ".") == 0
+              || strcmp(entry->d_name, "..") == 0
+              || svn_wc_is_adm_dir(entry->d_name, scratch_pool))
+            continue;
+
+          child_relpath = join_relpath(dir_relpath, entry->d_name,
+                                       scratch_pool);
+          if (record)
+            record_change(w, child_relpath);
+
+          if (entry->d_type == DT_UNKNOWN)
+            {
+              struct stat st;
+
+              is_dir = (lstat(apr_pstrcat(scratch_pool, w->root, "/",
+                                          child_relpath, SVN_VA_NULL),
+                              &st) == 0
+                        && S_ISDIR(st.st_mode));
+            }
+          else
+            is_dir = (entry->d_type == DT_DIR);
+
+          if (is_dir)
+            APR_ARRAY_PUSH(stack, const char *) = child_relpath;
+        }
+      closedir(dir);
+    }
+}
+
+/* Forget all changes of W and watch the whole working copy again. */
+static svn_error_t *
+new_session(watcher_t *w)
+{
+  apr_pool_t *scratch_pool;
+
+  /* Closing the descriptor removes all watches. */
+  if (w->inotify_fd >= 0)
+    close(w->inotify_fd);
+
+  w->inotify_fd = inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+  if (w->inotify_fd < 0)
+    return svn_error_wrap_apr(apr_get_os_error(),
+                              _("Can't initialize inotify"));
+
+  svn_pool_clear(w->session_pool);
+  w->watches = apr_hash_make(w->session_pool);
+  w->changed = apr_hash_make(w->session_pool);
+  w->overflow = FALSE;
+  w->broken = FALSE;
+  w->session = apr_psprintf(w->session_pool,
+                            "%ld-%" APR_TIME_T_FMT "-%u",
+                            (long)getpid(), apr_time_now(),
+                            ++w->session_count);
+
+  scratch_pool = svn_pool_create(w->session_pool);
+  add_watches(w, "", FALSE, scratch_pool);
+  svn_pool_destroy(scratch_pool);
+
+  return SVN_NO_ERROR;
+}
+
+/* Update the journal of W with EVENT.  Use SCRATCH_POOL for temporary
+   allocations. */
+static void
+handle_event(watcher_t *w,
+             const struct inotify_event *event,
+             apr_pool_t *scratch_pool)
+{
+  const char *dir_relpath;
+  const char *relpath;
+
+  if (event->mask & IN_Q_OVERFLOW)
+    {
+      w->overflow = TRUE;
+      return;
+    }
+
+  dir_relpath = apr_hash_get(w->watches, &event->wd, sizeof(event->wd));
+  if (!dir_relpath)
+    return;
+
+  if (event->mask & IN_IGNORED)
+    {
+      apr_hash_set(w->watches, &event->wd, sizeof(event->wd), NULL);
+      return;
+    }
+
+  /* The parent directory reports these for all but the root. */
+  if (event->mask & (IN_DELETE_SELF | IN_MOVE_SELF))
+    {
+      if (!*dir_relpath)
+        w->done = TRUE;
+      return;
+    }
+
+  if (!event->len || svn_wc_is_adm_dir(event->name, scratch_pool))
+    return;
+
+  relpath = join_relpath(dir_relpath, event->name, scratch_pool);
+  record_change(w, relpath);
+
+  if ((event->mask & IN_ISDIR)
+      && (event->mask & (IN_CREATE | IN_MOVED_TO)))
+    add_watches(w, relpath, TRUE, scratch_pool);
+}
+
+/* Process all pending events of W.  Use SCRATCH_POOL for temporary
+   allocations. */
+static svn_error_t *
+process_events(watcher_t *w,
+               apr_pool_t *scratch_pool)
+{
+  union
+  {
+    struct inotify_event event;
+    char data[16384];
+  } buffer;
+
+  while (!w->overflow)
+    {
+      ssize_t len = read(w->inotify_fd, buffer.data, sizeof(buffer.data));
+      const char *ptr;
+
+      if (len < 0 && errno == EINTR)
+        continue;
+      if (len < 0 && (errno == EAGAIN || errno == EWOULDBLOCK))
+        break;
+      if (len <= 0)
+        return svn_error_wrap_apr(apr_get_os_error(),
+                                  _("Can't read inotify events"));
+
+      for (ptr = buffer.data; ptr < buffer.data + len; )
+        {
+          const struct inotify_event *event = (const void *)ptr;
+
+          handle_event(w, event, scratch_pool);
+          ptr += sizeof(*event) + event->len;
+        }
+    }
+
+  if (w->overflow)
+    SVN_ERR(new_session(w));
+
+  return SVN_NO_ERROR;
+}
+
+/* Write the LEN bytes at DATA to the socket FD, ignoring errors. */
+static void
+send_all(int fd,
+         const char *data,
+         apr_size_t len)
+{
+  while (len > 0)
+    {
+      ssize_t count = send(fd, data, len, MSG_NOSIGNAL);
+
+      if (count < 0 && errno == EINTR)
+        continue;
+      if (count <= 0)
+        return;
+
+      data += count;
+      len -= count;
+    }
+}
+
+/* Accept a connection on the socket of W and answer its command.  Use
+   SCRATCH_POOL for temporary allocations. */
+static svn_error_t *
+serve_client(watcher_t *w,
+             apr_pool_t *scratch_pool)
+{
+  struct timeval timeout;
+  char command[64];
+  apr_size_t len = 0;
+  int fd;
+
+  fd = accept(w->listen_fd, NULL, NULL);
+  if (fd < 0)
+    return SVN_NO_ERROR;
+
+  timeout.tv_sec = CLIENT_TIMEOUT;
+  timeout.tv_usec = 0;
+  setsockopt(fd, SOL_SOCKET, SO_RCVTIMEO, &timeout, sizeof(timeout));
+  setsockopt(fd, SOL_SOCKET, SO_SNDTIMEO, &timeout, sizeof(timeout));
+
+  while (len < sizeof(command) - 1 && !memchr(command, '\n', len))
+    {
+      ssize_t count = read(fd, command + len, sizeof(command) - 1 - len);
+
+      if (count < 0 && errno == EINTR)
+        continue;
+      if (count <= 0)
+        break;
+
+      len += count;
+    }
+  command[len] = '\0';
+
+  if (strcmp(command, SVN_WC__WATCHER_CMD_STOP "\n") == 0)
+    {
+      w->done = TRUE;
+    }
+  else if (strcmp(command, SVN_WC__WATCHER_CMD_JOURNAL "\n") == 0)
+    {
+      svn_stringbuf_t *response;
+      apr_hash_index_t *hi;
+
+      /* Report everything that happened before the client asked. */
+      SVN_ERR(process_events(w, scratch_pool));
+
+      response = svn_stringbuf_create(SVN_WC__WATCHER_GREETING "\n",
+                                      scratch_pool);
+      if (!w->broken)
+        {
+          svn_stringbuf_appendcstr(response, "session ");
+          svn_stringbuf_appendcstr(response, w->session);
+          svn_stringbuf_appendbyte(response, '\n');
+
+          for (hi = apr_hash_first(scratch_pool, w->changed); hi;
+               hi = apr_hash_next(hi))
+            {
+              svn_stringbuf_appendcstr(response, "path ");
+              svn_stringbuf_appendcstr(response, apr_hash_this_key(hi));
+              svn_stringbuf_appendbyte(response, '\n');
+            }
+
+          svn_stringbuf_appendcstr(response, "end\n");
+        }
+
+      send_all(fd, response->data, response->len);
+    }
+
+  close(fd);
+
+  return SVN_NO_ERROR;
+}
+
+/* Fill in *ADDR for the socket path SOCKET_PATH, given in local style and
+   encoding. */
+static svn_error_t *
+make_address(struct sockaddr_un *addr,
+             const char *socket_path)
+{
+  if (strlen(socket_path) >= sizeof(addr->sun_path))
+    return svn_error_createf(SVN_ERR_BAD_FILENAME, NULL,
+                             _("The path '%s' is too long for a socket"),
+                             socket_path);
+
+  memset(addr, 0, sizeof(*addr));
+  addr->sun_family = AF_UNIX;
+  strcpy(addr->sun_path, socket_path);
+
+  return SVN_NO_ERROR;
+}
+
+/* Set *CONNECTED to whether a watcher listens at ADDR. */
+static void
+probe_socket(svn_boolean_t *connected,
+             const struct sockaddr_un *addr)
+{
+  int fd = socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0);
+
+  *connected = (fd >= 0
+                && connect(fd, (const struct sockaddr *)addr,
+                           sizeof(*addr)) == 0);
+  if (fd >= 0)
+    close(fd);
+}
+
+/* Create the listening socket of W at SOCKET_PATH, given in local style
+   and encoding. */
+static svn_error_t *
+create_socket(watcher_t *w,
+              const char *socket_path)
+{
+  struct sockaddr_un addr;
+  mode_t old_umask;
+  int result;
+
+  SVN_ERR(make_address(&addr, socket_path));
+
+  w->listen_fd = socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0);
+  if (w->listen_fd < 0)
+    return svn_error_wrap_apr(apr_get_os_error(),
+                              _("Can't create socket"));
+
+  /* Only the owner of the working copy may talk to us. */
+  old_umask = umask(077);
+  result = bind(w->listen_fd, (struct sockaddr *)&addr, sizeof(addr));
+  if (result && errno == EADDRINUSE)
+    {
+      svn_boolean_t running;
+
+      probe_socket(&running, &addr);
+      if (running)
+        {
+          umask(old_umask);
+          return svn_error_createf(SVN_ERR_WC_LOCKED, NULL,
+                                   _("A watcher is already running at '%s'"),
+                                   socket_path);
+        }
+
+      /* Left behind by a watcher that got killed. */
+      unlink(socket_path);
+      result = bind(w->listen_fd, (struct sockaddr *)&addr, sizeof(addr));
+    }
+  umask(old_umask);
+
+  if (result || listen(w->listen_fd, 16))
+    return svn_error_wrap_apr(apr_get_os_error(),
+                              _("Can't listen on socket '%s'"),
+                              socket_path);
+
+  return SVN_NO_ERROR;
+}
+
+/* Watch the working copy at WCROOT_ABSPATH until asked to stop.  Detach
+   from the terminal unless FOREGROUND is set.  Use POOL for all
+   allocations. */
+static svn_error_t *
+run_watcher(const char *wcroot_abspath,
+            const char *socket_path,
+            svn_boolean_t foreground,
+            apr_pool_t *pool)
+{
+  watcher_t w = { 0 };
+  apr_pool_t *iterpool;
+  svn_error_t *err;
+
+  SVN_ERR(svn_utf_cstring_from_utf8(&w.root,
+                                    svn_dirent_local_style(wcroot_abspath,
+                                                           pool),
+                                    pool));
+  w.inotify_fd = -1;
+  w.session_pool = svn_pool_create(pool);
+
+  SVN_ERR(create_socket(&w, socket_path));
+  err = new_session(&w);
+
+  if (!err && !foreground && daemon(0, 0))
+    err = svn_error_wrap_apr(apr_get_os_error(), _("Can't detach"));
+
+  iterpool = svn_pool_create(pool);
+  while (!err && !w.done)
+    {
+      struct pollfd fds[2];
+
+      svn_pool_clear(iterpool);
+
+      fds[0].fd = w.inotify_fd;
+      fds[0].events = POLLIN;
+      fds[1].fd = w.listen_fd;
+      fds[1].events = POLLIN;
+
+      if (poll(fds, 2, -1) < 0)
+        {
+          if (errno != EINTR)
+            err = svn_error_wrap_apr(apr_get_os_error(), _("Can't poll"));
+          continue;
+        }
+
+      if (fds[0].revents)
+        err = process_events(&w, iterpool);
+      if (!err && fds[1].revents)
+        err = serve_client(&w, iterpool);
+    }
+  svn_pool_destroy(iterpool);
+
+  unlink(socket_path);
+  close(w.listen_fd);
+  if (w.inotify_fd >= 0)
+    close(w.inotify_fd);
+
+  return svn_error_trace(err);
+}
+
+/* Ask the watcher at SOCKET_PATH, given in local style and encoding, to
+   exit. */
+static svn_error_t *
+stop_watcher(const char *socket_path)
+{
+  static const char command[] = SVN_WC__WATCHER_CMD_STOP "\n";
+  struct sockaddr_un addr;
+  int fd;
+
+  SVN_ERR(make_address(&addr, socket_path));
+
+  fd = socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0);
+  if (fd < 0 || connect(fd, (struct sockaddr *)&addr, sizeof(addr)))
+    {
+      svn_error_t *err = svn_error_wrap_apr(apr_get_os_error(),
+                                            _("No watcher is running at "
+                                              "'%s'"), socket_path);
+      if (fd >= 0)
+        close(fd);
+      return err;
+    }
+
+  send_all(fd, command, sizeof(command) - 1);
+  close(fd);
+
+  return SVN_NO_ERROR;
+}
+
+#endif /* __linux__ */
+
+/* Start or stop (if STOP is set) the watcher for the working copy root
+   WCROOT_ABSPATH.  Use POOL for all allocations. */
+static svn_error_t *
+sub_main(const char *wcroot_abspath,
+         svn_boolean_t stop,
+         svn_boolean_t foreground,
+         apr_pool_t *pool)
+{
+#ifdef __linux__
+  const char *adm_abspath;
+  const char *socket_path;
+  svn_node_kind_t kind;
+
+  adm_abspath = svn_dirent_join(wcroot_abspath, svn_wc_get_adm_dir(pool),
+                                pool);
+  SVN_ERR(svn_io_check_path(svn_dirent_join(adm_abspath, "wc.db", pool),
+                            &kind, pool));
+  if (kind != svn_node_file)
+    return svn_error_createf(SVN_ERR_WC_NOT_WORKING_COPY, NULL,
+                             _("'%s' is not the root of a working copy"),
+                             svn_dirent_local_style(wcroot_abspath, pool));
+
+  SVN_ERR(svn_utf_cstring_from_utf8(
+            &socket_path,
+            svn_dirent_local_style(svn_dirent_join(adm_abspath,
+                                                   SVN_WC__WATCHER_SOCKET,
+                                                   pool),
+                                   pool),
+            pool));
+
+  if (stop)
+    return svn_error_trace(stop_watcher(socket_path));
+
+  return svn_error_trace(run_watcher(wcroot_abspath, socket_path,
+                                     foreground, pool));
+#else
+  return svn_error_create(SVN_ERR_UNSUPPORTED_FEATURE, NULL,
+                          _("Watching working copies is only supported "
+                            "on Linux"));
+#endif
+}
+
+int
+main(int argc, const char **argv)
+{
+  apr_pool_t *pool;
+  svn_error_t *err = SVN_NO_ERROR;
+  svn_boolean_t stop = FALSE;
+  svn_boolean_t foreground = FALSE;
+  const char *wcroot_abspath;
+  int i = 1;
+
+  /* Initialize the app.  Send all error messages to 'stderr'.  */
+  if (svn_cmdline_init(argv[0], stderr) == EXIT_FAILURE)
+    return EXIT_FAILURE;
+
+  pool = svn_pool_create(NULL);
+
+  if (i < argc && strcmp(argv[i], "--stop") == 0)
+    stop = TRUE, i++;
+  else if (i < argc && strcmp(argv[i], "--foreground") == 0)
+    foreground = TRUE, i++;
+
+  if (i != argc - 1)
+    {
+      usage_maybe_with_err(argv[0], "Expected exactly one WCROOT.");
+      svn_pool_destroy(pool);
+      return EXIT_FAILURE;
+    }
+
+  /* Convert argv[i] into a UTF8, internal-format, absolute path. */
+  if ((err = svn_utf_cstring_to_utf8(&wcroot_abspath, argv[i], pool)))
+    goto cleanup;
+  wcroot_abspath = svn_dirent_internal_style(wcroot_abspath, pool);
+  if ((err = svn_dirent_get_absolute(&wcroot_abspath, wcroot_abspath, pool)))
+    goto cleanup;
+
+  err = sub_main(wcroot_abspath, stop, foreground, pool);
+
+ cleanup:
+  svn_pool_destroy(pool);
+
+  if (err)
+    {
+      svn_handle_error2(err, stderr, FALSE, "svn-wc-watcher: ");
+      svn_error_clear(err);
+      return EXIT_FAILURE;
+    }
+  return EXIT_SUCCESS;
+}